@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <bytecode.hxx>
+#include <fold.hxx>
+#include <hierarchy.hxx>
+#include <jit.hxx>
+#include <layout.hxx>
+#include <lower.hxx>
+#include <parser.hxx>
+#include <passmanager.hxx>
+#include <resolver.hxx>
+#include <typecheck.hxx>
+#include <vm.hxx>
+
+#include <flex/FlexLexer.h>
+
+/*
+ * match against the equivalent if/else chain, on the VM and the JIT. Dense
+ * integer cases become a jump table, sparse ones a binary search and strings
+ * a perfect hash; the chains compare one case after another.
+ *
+ * usage: match_bench [calls] [iterations]
+ */
+
+extern const std::string *Source;
+
+namespace
+{
+    const char *const Words[] = {"break", "case", "catch", "class", "const", "continue", "default", "delete",
+                                 "else", "enum", "export", "extends", "false", "finally", "for", "function"};
+    constexpr int Cases = 16;
+
+    std::string pattern(int64_t value, bool strings)
+    {
+        return strings ? "\"" + std::string(Words[value]) + "\"" : std::to_string(value);
+    }
+
+    // Arm i of each dispatcher returns i + 1, anything else 0.
+    std::string matchFunction(const std::string &name, const std::string &type, const std::vector<int64_t> &cases, bool strings)
+    {
+        std::string out = name + "(" + type + " x) int64 {\n    match x {\n";
+        for (size_t i = 0; i < cases.size(); ++i)
+            out += "        " + pattern(cases[i], strings) + " { return " + std::to_string(i + 1) + " }\n";
+        return out + "    }\n    return 0\n}\n";
+    }
+
+    std::string ifFunction(const std::string &name, const std::string &type, const std::vector<int64_t> &cases, bool strings)
+    {
+        std::string out = name + "(" + type + " x) int64 {\n";
+        for (size_t i = 0; i < cases.size(); ++i)
+            out += std::string(i ? "    else if " : "    if ") + "x == " + pattern(cases[i], strings) + " { return " + std::to_string(i + 1) + " }\n";
+        return out + "    return 0\n}\n";
+    }
+
+    std::string driver(const std::string &name, const std::string &dispatcher, const std::string &argument)
+    {
+        return name + "(int64 n) int64 {\n    var t : int64 = 0\n    for (var i : int64 = 0; i < n; i = i + 1) {\n        t = t + " +
+               dispatcher + "(" + argument + ")\n    }\n    return t\n}\n";
+    }
+
+    std::string program()
+    {
+        std::vector<int64_t> dense, sparse, words;
+        for (int i = 0; i < Cases; ++i)
+        {
+            dense.push_back(i);
+            sparse.push_back(int64_t(i) * i * 37);
+            words.push_back(i);
+        }
+
+        std::string out = "word(int64 i) string {\n    match i {\n";
+        for (int i = 0; i < Cases; ++i)
+            out += "        " + std::to_string(i) + " { return " + pattern(i, true) + " }\n";
+        out += "    }\n    return \"none\"\n}\n";
+
+        for (const char *kind : {"Match", "If"})
+        {
+            auto function = kind[0] == 'M' ? matchFunction : ifFunction;
+            out += function(std::string("dense") + kind, "int64", dense, false);
+            out += function(std::string("sparse") + kind, "int64", sparse, false);
+            out += function(std::string("strings") + kind, "string", words, true);
+            // A fifth of the lookups miss.
+            out += driver(std::string("runDense") + kind, std::string("dense") + kind, "i % 20");
+            out += driver(std::string("runSparse") + kind, std::string("sparse") + kind, "i % 20 * (i % 20) * 37");
+            out += driver(std::string("runStrings") + kind, std::string("strings") + kind, "word(i % 20)");
+        }
+        return out;
+    }
+
+    uint32_t findFunction(const Module &module, const std::string &name)
+    {
+        for (size_t i = 0; i < module.functions.size(); ++i)
+            if (module.functions[i].name == name)
+                return static_cast<uint32_t>(i);
+        std::fprintf(stderr, "missing function %s\n", name.c_str());
+        std::exit(1);
+    }
+
+    template <typename F>
+    double timeMs(int iterations, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t calls = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::string source = program();
+    Source = &source;
+    currentFile = "<bench>";
+
+    std::istringstream ss(source);
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, source);
+    ASTNodePtr ast = parser.parserProgram();
+
+    SymbolTable symbols;
+    resolveNames(ast.get(), symbols, source);
+    TypeInterner types;
+    checkTypes(ast.get(), symbols, types, source);
+    foldConstants(ast);
+    ClassHierarchy hierarchy;
+    hierarchy.build(ast.get(), source);
+    LayoutEngine layouts(nullptr, &hierarchy);
+    layouts.run(ast.get());
+
+    Module module = lowerToIR(ast.get(), hierarchy, layouts, source);
+    PassManager passes(1);
+    passes.addPipeline(2);
+    passes.run(module);
+    BytecodeProgram program = compileBytecode(module);
+    VM vm(program);
+    Jit jit(module, 2);
+
+    std::printf("%llu calls, %d iterations\n", static_cast<unsigned long long>(calls), iterations);
+    std::printf("%-10s %12s %12s %8s %12s %12s %8s\n", "workload", "vm match", "vm if", "speedup", "jit match", "jit if", "speedup");
+    for (const char *workload : {"Dense", "Sparse", "Strings"})
+    {
+        double ms[2][2];
+        uint64_t results[2][2];
+        for (int kind = 0; kind < 2; ++kind)
+        {
+            uint32_t function = findFunction(module, std::string("run") + workload + (kind == 0 ? "Match" : "If"));
+            Jit::ArrayEntry entry = jit.arrayEntry(function);
+            volatile uint64_t sink = 0;
+            ms[0][kind] = timeMs(iterations, [&]
+                                 { sink = results[0][kind] = vm.call(function, {calls}); });
+            ms[1][kind] = timeMs(iterations, [&]
+                                 { sink = results[1][kind] = entry(&calls); });
+        }
+        if (results[0][0] != results[0][1] || results[1][0] != results[1][1] || results[0][0] != results[1][0])
+        {
+            std::fprintf(stderr, "%s: match and if disagree\n", workload);
+            return 1;
+        }
+        std::printf("%-10s %9.2f ms %9.2f ms %7.2fx %9.2f ms %9.2f ms %7.2fx\n", workload,
+                    ms[0][0], ms[0][1], ms[0][1] / ms[0][0], ms[1][0], ms[1][1], ms[1][1] / ms[1][0]);
+    }
+    return 0;
+}
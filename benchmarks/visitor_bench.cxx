@@ -0,0 +1,277 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <dumper.hxx>
+#include <parser.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+#include <flex/FlexLexer.h>
+
+/*
+ * Traversal throughput of the CRTP visitor against the switch/static_cast
+ * recursion that printAST used before it was ported, and of the buffered
+ * ASTDumper against that original ostream-based printAST.
+ *
+ * usage: visitor_bench [functions] [iterations]
+ */
+
+extern const std::string *Source;
+
+namespace
+{
+    std::string makeProgram(int functions)
+    {
+        std::ostringstream os;
+        for (int i = 0; i < functions; ++i)
+        {
+            os << "f" << i << "(int64[a, b, c]) int64 {\n"
+               << "    var x : int64 = a + b * 3 - c / 2\n"
+               << "    const y : int64 = (x + 1) * (x - 1) + a * b * c\n"
+               << "    if x < y && a == b { x = x + y } else if c > 0 { x = c * 2 } else { x = 0 }\n"
+               << "    return x + y * (a - b) + c % 7\n"
+               << "}\n";
+        }
+        return os.str();
+    }
+
+    size_t legacyCount(const ASTNode *node)
+    {
+        if (!node)
+            return 0;
+
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+        {
+            size_t n = 1;
+            for (const auto &child : static_cast<const BlockNode *>(node)->children)
+                n += legacyCount(child.get());
+            return n;
+        }
+        case ASTNodeType::BinaryExpr:
+        {
+            auto *bin = static_cast<const BinaryExprNode *>(node);
+            return 1 + legacyCount(bin->left.get()) + legacyCount(bin->right.get());
+        }
+        case ASTNodeType::FunctionDecl:
+            return 1 + legacyCount(static_cast<const FunctionDeclNode *>(node)->body.get());
+        case ASTNodeType::ReturnExpr:
+            return 1 + legacyCount(static_cast<const ReturnExprNode *>(node)->expr.get());
+        case ASTNodeType::VarDecl:
+            return 1 + legacyCount(static_cast<const VarDeclNode *>(node)->value.get());
+        case ASTNodeType::IfExpr:
+        {
+            auto *ifn = static_cast<const IfExprNode *>(node);
+            return 1 + legacyCount(ifn->condition.get()) + legacyCount(ifn->thenBranch.get()) + legacyCount(ifn->elseBranch.get());
+        }
+        case ASTNodeType::AssignExpr:
+            return 1 + legacyCount(static_cast<const AssignExprNode *>(node)->value.get());
+        case ASTNodeType::ClassDecl:
+            return 1 + legacyCount(static_cast<const ClassDeclNode *>(node)->body.get());
+        default:
+            return 1;
+        }
+    }
+
+    struct NodeCounter : ASTVisitor<NodeCounter, size_t>
+    {
+        size_t visitBlock(const BlockNode *node)
+        {
+            size_t n = 1;
+            for (const auto &child : node->children)
+                n += visit(child.get());
+            return n;
+        }
+        size_t visitBinaryExpr(const BinaryExprNode *node) { return 1 + visit(node->left.get()) + visit(node->right.get()); }
+        size_t visitFunctionDecl(const FunctionDeclNode *node) { return 1 + visit(node->body.get()); }
+        size_t visitReturnExpr(const ReturnExprNode *node) { return 1 + visit(node->expr.get()); }
+        size_t visitVarDecl(const VarDeclNode *node) { return 1 + visit(node->value.get()); }
+        size_t visitIfExpr(const IfExprNode *node) { return 1 + visit(node->condition.get()) + visit(node->thenBranch.get()) + visit(node->elseBranch.get()); }
+        size_t visitAssignExpr(const AssignExprNode *node) { return 1 + visit(node->value.get()); }
+        size_t visitClassDecl(const ClassDeclNode *node) { return 1 + visit(node->body.get()); }
+        size_t visitLiteral(const LiteralNode *) { return 1; }
+        size_t visitIdentifier(const IdentifierNode *) { return 1; }
+        size_t visitSharedExpr(const SharedExprNode *) { return 1; }
+        size_t visitUnknown(const ASTNode *) { return 1; }
+    };
+
+    // printAST as it was before the visitor port, writing to a stream.
+    void legacyPrint(std::ostream &os, const ASTNode *node, int indentLevel = 0)
+    {
+        if (!node)
+            return;
+
+        auto ind = [&](int extra = 0)
+        {
+            os << std::string(indentLevel + extra, ' ');
+        };
+
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            ind();
+            os << "Block\n";
+            for (const auto &child : static_cast<const BlockNode *>(node)->children)
+                legacyPrint(os, child.get(), indentLevel + 2);
+            break;
+        case ASTNodeType::Literal:
+            ind();
+            os << "Literal: ";
+            std::visit([&](const auto &v)
+                       { os << v; }, static_cast<const LiteralNode *>(node)->value);
+            os << "\n";
+            break;
+        case ASTNodeType::Identifier:
+            ind();
+            os << "Identifier: " << static_cast<const IdentifierNode *>(node)->name << "\n";
+            break;
+        case ASTNodeType::BinaryExpr:
+        {
+            auto *bin = static_cast<const BinaryExprNode *>(node);
+            ind();
+            os << "BinaryExpr '" << bin->op << "'\n";
+            legacyPrint(os, bin->left.get(), indentLevel + 2);
+            legacyPrint(os, bin->right.get(), indentLevel + 2);
+            break;
+        }
+        case ASTNodeType::FunctionDecl:
+        {
+            auto *fn = static_cast<const FunctionDeclNode *>(node);
+            ind();
+            os << "FunctionDecl " << fn->name << " [" << fn->access << "] -> " << fn->returnType << "\n";
+            ind(2);
+            os << "Params:\n";
+            for (auto &p : fn->params)
+            {
+                ind(4);
+                os << p.first << " " << p.second << "\n";
+            }
+            ind(2);
+            os << "Body:\n";
+            legacyPrint(os, fn->body.get(), indentLevel + 4);
+            break;
+        }
+        case ASTNodeType::ReturnExpr:
+            ind();
+            os << "ReturnExpr\n";
+            legacyPrint(os, static_cast<const ReturnExprNode *>(node)->expr.get(), indentLevel + 2);
+            break;
+        case ASTNodeType::VarDecl:
+        {
+            auto *var = static_cast<const VarDeclNode *>(node);
+            ind();
+            os << (var->isConst ? "ConstDecl " : "VarDecl ") << var->name << " : " << var->varType << " [" << var->access << "]\n";
+            if (var->value)
+            {
+                ind(2);
+                os << "Initializer:\n";
+                legacyPrint(os, var->value.get(), indentLevel + 4);
+            }
+            break;
+        }
+        case ASTNodeType::IfExpr:
+        {
+            auto *ifn = static_cast<const IfExprNode *>(node);
+            ind();
+            os << "IfExpr\n";
+            ind(2);
+            os << "Condition:\n";
+            legacyPrint(os, ifn->condition.get(), indentLevel + 4);
+            ind(2);
+            os << "Then:\n";
+            legacyPrint(os, ifn->thenBranch.get(), indentLevel + 4);
+            if (ifn->elseBranch)
+            {
+                ind(2);
+                os << "Else:\n";
+                legacyPrint(os, ifn->elseBranch.get(), indentLevel + 4);
+            }
+            break;
+        }
+        case ASTNodeType::AssignExpr:
+        {
+            auto *as = static_cast<const AssignExprNode *>(node);
+            ind();
+            os << "AssignExpr " << as->name << "\n";
+            legacyPrint(os, as->value.get(), indentLevel + 2);
+            break;
+        }
+        default:
+            ind();
+            os << "UnknownNode\n";
+        }
+    }
+
+    template <typename F>
+    double timeMs(int iterations, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char *name, size_t nodes, int iterations, double ms)
+    {
+        std::printf("%-24s %10.2f ms  %8.1f Mnodes/s\n", name, ms, nodes * iterations / (ms * 1e3));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int functions = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    std::string source = makeProgram(functions);
+    Source = &source;
+    currentFile = "<bench>";
+
+    std::istringstream ss(source);
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, source);
+    ASTNodePtr ast = parser.parserProgram();
+
+    size_t nodes = NodeCounter().visit(ast.get());
+    if (nodes != legacyCount(ast.get()))
+    {
+        std::fprintf(stderr, "node counts disagree\n");
+        return 1;
+    }
+    std::printf("%zu nodes, %d iterations\n", nodes, iterations);
+
+    volatile size_t sink = 0;
+    report("switch/static_cast walk", nodes, iterations, timeMs(iterations, [&]
+                                                                 { sink = sink + legacyCount(ast.get()); }));
+    report("CRTP visitor walk", nodes, iterations, timeMs(iterations, [&]
+                                                           { sink = sink + NodeCounter().visit(ast.get()); }));
+
+    int printIterations = iterations / 4 + 1;
+    auto path = std::filesystem::temp_directory_path() / "vsharp_visitor_bench.txt";
+    {
+        std::ofstream out(path);
+        report("legacy printAST", nodes, printIterations, timeMs(printIterations, [&]
+                                                                 {
+            out.seekp(0);
+            legacyPrint(out, ast.get()); }));
+    }
+
+    for (auto [name, format] : {std::pair{"dumper (text)", DumpFormat::Text},
+                                std::pair{"dumper (json)", DumpFormat::Json},
+                                std::pair{"dumper (sexpr)", DumpFormat::SExpr}})
+    {
+        std::FILE *file = std::fopen(path.string().c_str(), "wb");
+        ASTDumper dumper(file, format);
+        report(name, nodes, printIterations, timeMs(printIterations, [&]
+                                                    {
+            std::fseek(file, 0, SEEK_SET);
+            dumper.dump(ast.get()); }));
+        std::fclose(file);
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
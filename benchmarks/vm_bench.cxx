@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <bytecode.hxx>
+#include <fold.hxx>
+#include <hierarchy.hxx>
+#include <layout.hxx>
+#include <lower.hxx>
+#include <parser.hxx>
+#include <passmanager.hxx>
+#include <resolver.hxx>
+#include <typecheck.hxx>
+#include <vm.hxx>
+
+#include <flex/FlexLexer.h>
+
+/*
+ * Interpreter throughput on call-, arithmetic- and branch-heavy code, with
+ * computed-goto dispatch against the switch loop. V# has no loops yet, so
+ * every workload recurses down a balanced tree of calls.
+ *
+ * usage: vm_bench [depth] [iterations]
+ */
+
+extern const std::string *Source;
+
+namespace
+{
+    const char *const Program = R"(
+fib(int64 n) int64 {
+    if (n < 2) {
+        return n
+    }
+    return fib(n - 1) + fib(n - 2)
+}
+mix(int64 a, int64 b) int64 {
+    var x : int64 = a * 31 + b
+    x = x * 7 - a + (b * 3 - x) * 5
+    x = x + (x - a) * (x - b) - 17
+    x = (x * 13 + a) * (b + 11) - x * 3
+    return x * 5 + (a - b) * (x + 9) - 2
+}
+arith(int64 depth, int64 x) int64 {
+    if (depth == 0) {
+        return mix(x, x + 3)
+    }
+    return arith(depth - 1, x + 1) + arith(depth - 1, x * 3)
+}
+classify(int64 x) int64 {
+    var r : int64 = 0
+    if (x % 2 == 0) {
+        if (x % 3 == 0) {
+            r = 1
+        } else if (x % 5 == 0) {
+            r = 2
+        } else {
+            r = 3
+        }
+    } else if (x % 7 < 3) {
+        r = 4
+    } else if (x % 11 > 6 && x % 13 != 0) {
+        r = 5
+    }
+    return r
+}
+branches(int64 depth, int64 x) int64 {
+    if (depth == 0) {
+        return classify(x)
+    }
+    return branches(depth - 1, x * 2) + branches(depth - 1, x * 2 + 1)
+}
+)";
+
+    uint32_t findFunction(const BytecodeProgram &program, const std::string &name)
+    {
+        for (size_t i = 0; i < program.functions.size(); ++i)
+            if (program.functions[i].name == name)
+                return static_cast<uint32_t>(i);
+        std::fprintf(stderr, "missing function %s\n", name.c_str());
+        std::exit(1);
+    }
+
+    template <typename F>
+    double timeMs(int iterations, F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int64_t depth = argc > 1 ? std::stoi(argv[1]) : 16;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::string source = Program;
+    Source = &source;
+    currentFile = "<bench>";
+
+    std::istringstream ss(source);
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, source);
+    ASTNodePtr ast = parser.parserProgram();
+
+    SymbolTable symbols;
+    resolveNames(ast.get(), symbols, source);
+    TypeInterner types;
+    checkTypes(ast.get(), symbols, types, source);
+    foldConstants(ast);
+    ClassHierarchy hierarchy;
+    hierarchy.build(ast.get(), source);
+    LayoutEngine layouts(nullptr, &hierarchy);
+    layouts.run(ast.get());
+
+    Module module = lowerToIR(ast.get(), hierarchy, layouts, source);
+    PassManager passes(1);
+    passes.addPipeline(2);
+    passes.run(module);
+    BytecodeProgram program = compileBytecode(module);
+
+    struct Workload
+    {
+        const char *name;
+        uint32_t function;
+        std::vector<uint64_t> args;
+    };
+    const Workload workloads[] = {
+        {"calls (fib)", findFunction(program, "fib"), {static_cast<uint64_t>(depth + 10)}},
+        {"arithmetic", findFunction(program, "arith"), {static_cast<uint64_t>(depth), 1}},
+        {"branches", findFunction(program, "branches"), {static_cast<uint64_t>(depth), 1}},
+    };
+
+    std::printf("depth %lld, %d iterations\n", static_cast<long long>(depth), iterations);
+    std::printf("%-16s %12s %12s %8s\n", "workload", "threaded", "switch", "speedup");
+    for (const auto &workload : workloads)
+    {
+        VM vm(program);
+        volatile uint64_t sink = 0;
+        uint64_t results[2];
+        double ms[2];
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            vm.setDispatch(mode == 0 ? Dispatch::Threaded : Dispatch::Switch);
+            ms[mode] = timeMs(iterations, [&]
+                              { sink = results[mode] = vm.call(workload.function, workload.args); });
+        }
+        if (results[0] != results[1])
+        {
+            std::fprintf(stderr, "%s: dispatch modes disagree\n", workload.name);
+            return 1;
+        }
+        std::printf("%-16s %9.2f ms %9.2f ms %7.2fx\n", workload.name, ms[0], ms[1], ms[1] / ms[0]);
+    }
+    return 0;
+}
@@ -5,7 +5,7 @@ class test {
         return c + d * 3
     }
 
-    public static test(int64[c, d]) int64 {
+    public static scaled(int64[c, d]) int64 {
 
         return c + d * 3
     }
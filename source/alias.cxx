@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+#include <alias.hxx>
+
+namespace
+{
+    constexpr char Magic[4] = {'V', 'S', 'A', 'L'};
+    // Bump whenever Type or TokenType are renumbered.
+    constexpr uint32_t FormatVersion = 2;
+
+    struct File
+    {
+        FILE *handle;
+        ~File()
+        {
+            if (handle)
+                fclose(handle);
+        }
+    };
+
+    template <typename T>
+    bool writeValue(FILE *f, T value)
+    {
+        return fwrite(&value, sizeof(T), 1, f) == 1;
+    }
+
+    template <typename T>
+    bool readValue(FILE *f, T &value)
+    {
+        return fread(&value, sizeof(T), 1, f) == 1;
+    }
+}
+
+bool AliasTable::define(std::string_view name, const Alias &alias)
+{
+    if (const Alias *existing = find(name))
+    {
+        if (existing->kind != alias.kind)
+            return false;
+        switch (alias.kind)
+        {
+        case AliasKind::Type:
+            return existing->type == alias.type;
+        case AliasKind::Keyword:
+            return existing->keyword == alias.keyword;
+        case AliasKind::Constant:
+            return existing->type == alias.type && existing->value == alias.value;
+        }
+        return false;
+    }
+
+    InternId id = names.intern(name);
+    if (id >= entries.size())
+        entries.resize(id + 1);
+    entries[id] = alias;
+    return true;
+}
+
+void AliasTable::merge(const AliasTable &other)
+{
+    for (InternId id = 0; id < other.entries.size(); ++id)
+        define(other.names.str(id), other.entries[id]);
+}
+
+bool AliasTable::save(const std::string &path) const
+{
+    File file{fopen(path.c_str(), "wb")};
+    if (!file.handle)
+        return false;
+
+    bool ok = fwrite(Magic, sizeof(Magic), 1, file.handle) == 1 &&
+              writeValue(file.handle, FormatVersion) &&
+              writeValue(file.handle, static_cast<uint32_t>(entries.size()));
+
+    for (InternId id = 0; ok && id < entries.size(); ++id)
+    {
+        const Alias &alias = entries[id];
+        std::string_view name = names.str(id);
+        uint16_t value = alias.kind == AliasKind::Keyword ? static_cast<uint16_t>(alias.keyword) : static_cast<uint16_t>(alias.type);
+        ok = writeValue(file.handle, static_cast<uint8_t>(alias.kind)) &&
+             writeValue(file.handle, value) &&
+             (alias.kind != AliasKind::Constant || writeValue(file.handle, alias.value)) &&
+             writeValue(file.handle, static_cast<uint32_t>(name.size())) &&
+             fwrite(name.data(), 1, name.size(), file.handle) == name.size();
+    }
+    return ok;
+}
+
+bool AliasTable::load(const std::string &path)
+{
+    File file{fopen(path.c_str(), "rb")};
+    if (!file.handle)
+        return false;
+
+    char magic[4];
+    uint32_t version, count;
+    if (fread(magic, sizeof(magic), 1, file.handle) != 1 || memcmp(magic, Magic, sizeof(Magic)) != 0 ||
+        !readValue(file.handle, version) || version != FormatVersion ||
+        !readValue(file.handle, count))
+        return false;
+
+    std::string name;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint8_t kind;
+        uint16_t value;
+        int64_t constant = 0;
+        uint32_t length;
+        if (!readValue(file.handle, kind) || !readValue(file.handle, value) ||
+            kind > static_cast<uint8_t>(AliasKind::Constant) ||
+            (kind == static_cast<uint8_t>(AliasKind::Constant) && !readValue(file.handle, constant)) ||
+            !readValue(file.handle, length) || length == 0 || length > 4096)
+            return false;
+
+        name.resize(length);
+        if (fread(name.data(), 1, length, file.handle) != length)
+            return false;
+
+        Alias alias{static_cast<AliasKind>(kind), Type::Void, TokenType::Identifier, constant};
+        if (alias.kind != AliasKind::Keyword)
+        {
+            if (value > static_cast<uint16_t>(Type::Float64))
+                return false;
+            alias.type = static_cast<Type>(value);
+        }
+        else
+        {
+            if (value >= static_cast<uint16_t>(TokenType::EndOfFile))
+                return false;
+            alias.keyword = static_cast<TokenType>(value);
+        }
+
+        if (!define(name, alias))
+            return false;
+    }
+    return true;
+}
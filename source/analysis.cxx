@@ -0,0 +1,176 @@
+#include <chrono>
+#include <analysis.hxx>
+
+const char *Analysis::name(size_t index)
+{
+    static const char *const names[] = {"dominators", "loops", "liveness"};
+    return names[index];
+}
+
+void LoopInfo::compute(const Function &fn, const DominatorTree &dom)
+{
+    loops.clear();
+    loopOf.assign(fn.blocks.size(), -1);
+
+    // Headers come in reverse post-order, so a loop is found before the
+    // loops nested in it and the innermost loop of a block is the last one
+    // to claim it.
+    for (BlockId header : dom.rpo)
+    {
+        Loop loop{header, {}, {}};
+        for (BlockId pred : fn.blocks[header].preds)
+            if (dom.dominates(header, pred))
+                loop.latches.push_back(pred);
+        if (loop.latches.empty())
+            continue;
+
+        std::vector<bool> inLoop(fn.blocks.size(), false);
+        inLoop[header] = true;
+        loop.blocks.push_back(header);
+        std::vector<BlockId> stack(loop.latches.begin(), loop.latches.end());
+        while (!stack.empty())
+        {
+            BlockId block = stack.back();
+            stack.pop_back();
+            if (inLoop[block] || !dom.reachable(block))
+                continue;
+            inLoop[block] = true;
+            loop.blocks.push_back(block);
+            for (BlockId pred : fn.blocks[block].preds)
+                stack.push_back(pred);
+        }
+
+        loop.parent = loopOf[header];
+        loop.depth = loop.parent < 0 ? 1 : loops[loop.parent].depth + 1;
+        int index = static_cast<int>(loops.size());
+        for (BlockId block : loop.blocks)
+            loopOf[block] = index;
+        loops.push_back(std::move(loop));
+    }
+}
+
+void Liveness::compute(const Function &fn, const DominatorTree &dom)
+{
+    size_t n = fn.blocks.size();
+    words = (fn.instrs.size() + 63) / 64;
+    in.assign(n * words, 0);
+    out.assign(n * words, 0);
+
+    // Upward-exposed uses and definitions of each block, plus the values its
+    // successors' phis take from it.
+    std::vector<uint64_t> uses(n * words, 0), defs(n * words, 0), phiUses(n * words, 0);
+    auto set = [this](std::vector<uint64_t> &sets, BlockId block, ValueId value)
+    {
+        sets[block * words + value / 64] |= uint64_t(1) << (value % 64);
+    };
+    auto has = [this](const std::vector<uint64_t> &sets, BlockId block, ValueId value)
+    {
+        return sets[block * words + value / 64] >> (value % 64) & 1;
+    };
+
+    for (BlockId b = 0; b < n; ++b)
+        for (ValueId v : fn.blocks[b].code)
+        {
+            const Instr &instr = fn.instrs[v];
+            const ValueId *ops = fn.operands(v);
+            if (instr.op == Opcode::Phi)
+            {
+                for (uint16_t i = 0; i < instr.count; i += 2)
+                    set(phiUses, ops[i + 1], ops[i]);
+            }
+            else
+            {
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    if (!has(defs, b, ops[i]))
+                        set(uses, b, ops[i]);
+            }
+            set(defs, b, v);
+        }
+
+    // Backward dataflow to a fixpoint; post-order visits successors first.
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (auto it = dom.rpo.rbegin(); it != dom.rpo.rend(); ++it)
+        {
+            BlockId b = *it;
+            uint64_t *blockOut = &out[b * words];
+            uint64_t *blockIn = &in[b * words];
+            for (size_t w = 0; w < words; ++w)
+            {
+                uint64_t o = phiUses[b * words + w];
+                for (BlockId succ : fn.blocks[b].succs)
+                    o |= in[succ * words + w];
+                uint64_t i = uses[b * words + w] | (o & ~defs[b * words + w]);
+                if (o != blockOut[w] || i != blockIn[w])
+                {
+                    blockOut[w] = o;
+                    blockIn[w] = i;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+template <typename Compute>
+void FunctionAnalyses::ensure(unsigned analysis, Compute &&compute)
+{
+    size_t index = analysis == Analysis::Dominators ? 0 : analysis == Analysis::Loops ? 1 : 2;
+    if (valid & analysis)
+    {
+        if (stats)
+            stats->reused[index].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    compute();
+    valid |= analysis;
+    if (stats)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        stats->nanos[index].fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+        stats->computed[index].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+const DominatorTree &FunctionAnalyses::dominators()
+{
+    ensure(Analysis::Dominators, [this]
+           {
+               if (!dom)
+                   dom = std::make_unique<DominatorTree>();
+               dom->compute(*fn); });
+    return *dom;
+}
+
+const LoopInfo &FunctionAnalyses::loops()
+{
+    // Dependencies are requested outside ensure() so their time is not counted twice.
+    const DominatorTree &tree = dominators();
+    ensure(Analysis::Loops, [this, &tree]
+           {
+               if (!loopInfo)
+                   loopInfo = std::make_unique<LoopInfo>();
+               loopInfo->compute(*fn, tree); });
+    return *loopInfo;
+}
+
+const Liveness &FunctionAnalyses::liveness()
+{
+    const DominatorTree &tree = dominators();
+    ensure(Analysis::Liveness, [this, &tree]
+           {
+               if (!live)
+                   live = std::make_unique<Liveness>();
+               live->compute(*fn, tree); });
+    return *live;
+}
+
+void FunctionAnalyses::invalidate(AnalysisSet preserved)
+{
+    if (!(preserved & Analysis::Dominators))
+        preserved &= ~Analysis::Loops;
+    valid &= preserved;
+}
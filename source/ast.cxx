@@ -1,180 +1,57 @@
-#include <iostream>
-#include <parser.hxx>
-#include <string.hxx>
+#include <cstdio>
+#include <dumper.hxx>
 
-static void indent(std::ostream &os, int n)
+BinaryExprNode::~BinaryExprNode()
 {
-    os << std::string(n, ' ');
-}
-
-void printAST(const ASTNode *node, int indentLevel)
-{
-    if (!node)
-        return;
-
-    auto ind = [&](int extra = 0)
-    {
-        indent(std::cout, indentLevel + extra);
-    };
-
-    switch (node->type)
-    {
-    case ASTNodeType::Block:
-    {
-        auto *blk = static_cast<const BlockNode *>(node);
-        ind();
-        std::cout << "Block\n";
-        for (const auto &child : blk->children)
-            printAST(child.get(), indentLevel + 2);
-        break;
-    }
-
-    case ASTNodeType::Literal:
-    {
-        auto *lit = static_cast<const LiteralNode *>(node);
-        ind();
-        std::cout << "Literal: ";
-
-        std::visit([](const auto &v)
-                   {
-            using T = std::decay_t<decltype(v)>;
-            if constexpr (std::is_same_v<T, bool>)
-                std::cout << (v ? "true" : "false");
-            else if constexpr (std::is_same_v<T, char>)
-            {
-                std::cout << "'";
-                switch (v)
-                {
-                case '\n': std::cout << "\\n"; break;
-                case '\t': std::cout << "\\t"; break;
-                case '\r': std::cout << "\\r"; break;
-                case '\\': std::cout << "\\\\"; break;
-                case '\'': std::cout << "\\'"; break;
-                default:   std::cout << v;
-                }
-                std::cout << "'";
-            }
-            else
-                std::cout << v; }, lit->value);
-
-        std::cout << "\n";
-        break;
-    }
-
-    case ASTNodeType::Identifier:
-    {
-        auto *id = static_cast<const IdentifierNode *>(node);
-        ind();
-        std::cout << "Identifier: " << id->name << "\n";
-        break;
-    }
-
-    case ASTNodeType::BinaryExpr:
-    {
-        auto *bin = static_cast<const BinaryExprNode *>(node);
-        ind();
-        std::cout << "BinaryExpr '" << bin->op << "'\n";
-        printAST(bin->left.get(), indentLevel + 2);
-        printAST(bin->right.get(), indentLevel + 2);
-        break;
-    }
-
-    case ASTNodeType::FunctionDecl:
-    {
-        auto *fn = static_cast<const FunctionDeclNode *>(node);
-        ind();
-        std::cout << "FunctionDecl " << fn->name
-                  << " [" << fn->access << "] -> "
-                  << fn->returnType << "\n";
-
-        ind(2);
-        std::cout << "Params:\n";
-        for (auto &p : fn->params)
-        {
-            ind(4);
-            std::cout << p.first << " " << p.second << "\n";
-        }
-
-        ind(2);
-        std::cout << "Body:\n";
-        printAST(fn->body.get(), indentLevel + 4);
-        break;
-    }
-
-    case ASTNodeType::ReturnExpr:
-    {
-        auto *ret = static_cast<const ReturnExprNode *>(node);
-        ind();
-        std::cout << "ReturnExpr\n";
-        printAST(ret->expr.get(), indentLevel + 2);
-        break;
-    }
-
-    case ASTNodeType::VarDecl:
-    {
-        auto *var = static_cast<const VarDeclNode *>(node);
-        ind();
-        std::cout
-            << (var->isConst ? "ConstDecl " : "VarDecl ")
-            << var->name << " : " << var->varType
-            << " [" << var->access << "]\n";
-
-        if (var->value)
+    // Frees a left-leaning chain one node at a time instead of recursively,
+    // following shared links whose target nothing else holds.
+    ASTNodePtr owned = std::move(left);
+    std::shared_ptr<const ASTNode> held;
+    for (;;)
+    {
+        ASTNode *node = owned ? owned.get() : held.use_count() == 1 ? const_cast<ASTNode *>(held.get()) : nullptr;
+        if (!node)
+            break;
+        if (node->type == ASTNodeType::BinaryExpr)
         {
-            ind(2);
-            std::cout << "Initializer:\n";
-            printAST(var->value.get(), indentLevel + 4);
+            ASTNodePtr next = std::move(static_cast<BinaryExprNode *>(node)->left);
+            owned = std::move(next);
+            held.reset();
         }
-        break;
-    }
-
-    case ASTNodeType::IfExpr:
-    {
-        auto *ifn = static_cast<const IfExprNode *>(node);
-        ind();
-        std::cout << "IfExpr\n";
-
-        ind(2);
-        std::cout << "Condition:\n";
-        printAST(ifn->condition.get(), indentLevel + 4);
-
-        ind(2);
-        std::cout << "Then:\n";
-        printAST(ifn->thenBranch.get(), indentLevel + 4);
-
-        if (ifn->elseBranch)
+        else if (node->type == ASTNodeType::SharedExpr)
         {
-            ind(2);
-            std::cout << "Else:\n";
-            printAST(ifn->elseBranch.get(), indentLevel + 4);
+            std::shared_ptr<const ASTNode> next = std::move(static_cast<SharedExprNode *>(node)->target);
+            owned.reset();
+            held = std::move(next);
         }
-        break;
+        else
+            break;
     }
+}
 
-    case ASTNodeType::AssignExpr:
+IfExprNode::~IfExprNode()
+{
+    // Frees an `else if` chain one arm at a time instead of recursively.
+    ASTNodePtr arm = std::move(elseBranch);
+    while (arm && arm->type == ASTNodeType::IfExpr)
     {
-        auto *as = static_cast<const AssignExprNode *>(node);
-        ind();
-        std::cout << "AssignExpr " << as->name << "\n";
-        printAST(as->value.get(), indentLevel + 2);
-        break;
+        ASTNodePtr next = std::move(static_cast<IfExprNode *>(arm.get())->elseBranch);
+        arm = std::move(next);
     }
+}
 
-    case ASTNodeType::ClassDecl:
+CallExprNode::~CallExprNode()
+{
+    // Frees a member-call chain one call at a time instead of recursively.
+    ASTNodePtr call = std::move(receiver);
+    while (call && call->type == ASTNodeType::FunctionCall)
     {
-        auto *cls = static_cast<const ClassDeclNode *>(node);
-        ind();
-        std::cout << "ClassDecl " << cls->name
-                  << " [" << cls->access << "]\n";
-
-        ind(2);
-        std::cout << "Body:\n";
-        printAST(cls->body.get(), indentLevel + 4);
-        break;
+        ASTNodePtr next = std::move(static_cast<CallExprNode *>(call.get())->receiver);
+        call = std::move(next);
     }
+}
 
-    default:
-        ind();
-        std::cout << "UnknownNode\n";
-    }
-}
\ No newline at end of file
+void printAST(const ASTNode *node, int indentLevel)
+{
+    ASTDumper(stdout, DumpFormat::Text).dump(node, indentLevel);
+}
@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <bytecode.hxx>
+
+namespace
+{
+    const uint8_t OperandWords[] = {
+#define VSHARP_BYTECODE_WORDS(name, words) words,
+        VSHARP_BYTECODE(VSHARP_BYTECODE_WORDS)
+#undef VSHARP_BYTECODE_WORDS
+    };
+
+    bool isNarrow(ValueType type)
+    {
+        return isIntegerValue(type) && valueBits(type) < 64;
+    }
+
+    NormKind normKind(ValueType type)
+    {
+        switch (type)
+        {
+        case ValueType::I8:
+            return NormKind::I8;
+        case ValueType::I16:
+            return NormKind::I16;
+        case ValueType::U16:
+            return NormKind::U16;
+        case ValueType::I32:
+            return NormKind::I32;
+        case ValueType::U32:
+            return NormKind::U32;
+        case ValueType::Bool:
+            return NormKind::Bool;
+        default:
+            return NormKind::U8;
+        }
+    }
+
+    class FunctionCompiler
+    {
+    public:
+        FunctionCompiler(const Module &module, const Function &fn, BytecodeProgram &program)
+            : module(module), fn(fn), code(program.code) {}
+
+        BytecodeFunction compile()
+        {
+            BytecodeFunction out;
+            out.name = fn.name;
+            out.params = static_cast<uint32_t>(fn.params.size());
+            out.returnsValue = fn.returnType != ValueType::Void;
+            out.entry = static_cast<uint32_t>(code.size());
+
+            registers = valueRegisters(fn);
+            uint32_t next = out.params;
+            for (uint32_t r : registers)
+                if (r != NoRegister)
+                    next = std::max(next, r + 1);
+            scratch = next++;
+            // Instances that stay in the frame take registers after the values.
+            objectRegisters.assign(fn.instrs.size(), 0);
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                    if (fn.instrs[v].op == Opcode::NewLocal)
+                    {
+                        objectRegisters[v] = next;
+                        next += static_cast<uint32_t>(std::max<uint64_t>(1, (module.classes[fn.instrs[v].imm].size + 7) / 8));
+                    }
+            out.frameSize = next;
+
+            blockOffsets.assign(fn.blocks.size(), 0);
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                blockOffsets[b] = static_cast<uint32_t>(code.size());
+                for (ValueId v : fn.blocks[b].code)
+                    compileInstr(b, v);
+            }
+            for (auto [at, block] : fixups)
+                code[at] = blockOffsets[block];
+            out.blocks = blockOffsets;
+            return out;
+        }
+
+    private:
+        const Module &module;
+        const Function &fn;
+        std::vector<uint32_t> &code;
+        std::vector<uint32_t> registers;
+        std::vector<uint32_t> objectRegisters;
+        uint32_t scratch = 0;
+        std::vector<uint32_t> blockOffsets;
+        std::vector<std::pair<size_t, BlockId>> fixups;
+
+        uint32_t reg(ValueId value) const { return registers[value]; }
+
+        void emit(Bytecode op, uint32_t a, std::initializer_list<uint32_t> operands = {})
+        {
+            code.push_back(static_cast<uint32_t>(op) | a << 8);
+            code.insert(code.end(), operands.begin(), operands.end());
+        }
+
+        void jump(Bytecode op, uint32_t a, BlockId target)
+        {
+            emit(op, a, {0});
+            fixups.push_back({code.size() - 1, target});
+        }
+
+        // Copies into the phis of target for the edge from block.
+        void edgeCopies(BlockId from, BlockId target)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> copies;
+            for (auto [phi, value] : phiCopies(fn, from, target))
+                copies.push_back({reg(phi), reg(value)});
+            for (auto [to, source] : sequentializeCopies(std::move(copies), scratch))
+                emit(Bytecode::Mov, to, {source});
+        }
+
+        bool hasPhis(BlockId block) const
+        {
+            const auto &list = fn.blocks[block].code;
+            return !list.empty() && fn.instrs[list.front()].op == Opcode::Phi;
+        }
+
+        void compileBinary(ValueId v, const Instr &instr)
+        {
+            uint32_t a = reg(v), b = reg(fn.operand(v, 0)), c = reg(fn.operand(v, 1));
+            ValueType type = instr.type;
+            ValueType operandType = fn.instrs[fn.operand(v, 0)].type;
+
+            if (isComparison(instr.op))
+            {
+                bool swap = instr.op == Opcode::Gt || instr.op == Opcode::Ge;
+                bool strict = instr.op == Opcode::Lt || instr.op == Opcode::Gt;
+                Bytecode op;
+                if (instr.op == Opcode::Eq || instr.op == Opcode::Ne)
+                {
+                    bool eq = instr.op == Opcode::Eq;
+                    if (operandType == ValueType::Str)
+                        op = eq ? Bytecode::EqStr : Bytecode::NeStr;
+                    else if (isFloatValue(operandType))
+                        op = eq ? Bytecode::EqF : Bytecode::NeF;
+                    else
+                        op = eq ? Bytecode::Eq : Bytecode::Ne;
+                }
+                else if (isFloatValue(operandType))
+                    op = strict ? Bytecode::LtF : Bytecode::LeF;
+                else if (isSignedValue(operandType))
+                    op = strict ? Bytecode::LtS : Bytecode::LeS;
+                else
+                    op = strict ? Bytecode::LtU : Bytecode::LeU;
+                emit(op, a, {swap ? c : b, swap ? b : c});
+                return;
+            }
+
+            bool normalize = false;
+            Bytecode op;
+            switch (instr.op)
+            {
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            {
+                size_t index = instr.op == Opcode::Add ? 0 : instr.op == Opcode::Sub ? 1 : 2;
+                static const Bytecode f64[] = {Bytecode::AddF64, Bytecode::SubF64, Bytecode::MulF64};
+                static const Bytecode f32[] = {Bytecode::AddF32, Bytecode::SubF32, Bytecode::MulF32};
+                static const Bytecode i32[] = {Bytecode::AddI32, Bytecode::SubI32, Bytecode::MulI32};
+                static const Bytecode i64[] = {Bytecode::Add, Bytecode::Sub, Bytecode::Mul};
+                if (type == ValueType::Str)
+                    op = Bytecode::Concat;
+                else if (type == ValueType::F64)
+                    op = f64[index];
+                else if (type == ValueType::F32)
+                    op = f32[index];
+                else if (type == ValueType::I32)
+                    op = i32[index];
+                else
+                {
+                    op = i64[index];
+                    normalize = isNarrow(type);
+                }
+                break;
+            }
+            case Opcode::Div:
+                if (type == ValueType::F64)
+                    op = Bytecode::DivF64;
+                else if (type == ValueType::F32)
+                    op = Bytecode::DivF32;
+                else if (isSignedValue(type))
+                {
+                    // Only the minimum divided by -1 leaves the range.
+                    op = Bytecode::DivS;
+                    normalize = isNarrow(type);
+                }
+                else
+                    op = Bytecode::DivU;
+                break;
+            case Opcode::Rem:
+                op = isSignedValue(type) ? Bytecode::RemS : Bytecode::RemU;
+                break;
+            case Opcode::And:
+                op = Bytecode::And;
+                break;
+            case Opcode::Shl:
+                op = Bytecode::Shl;
+                normalize = isNarrow(type);
+                break;
+            case Opcode::Shr:
+                op = isSignedValue(type) ? Bytecode::ShrS : Bytecode::ShrU;
+                break;
+            case Opcode::MulHigh:
+                op = isSignedValue(type) ? Bytecode::MulHiS : Bytecode::MulHiU;
+                break;
+            default:
+                op = Bytecode::Or;
+                break;
+            }
+            emit(op, a, {b, c});
+            if (normalize)
+                emit(Bytecode::Norm, a, {static_cast<uint32_t>(normKind(type))});
+        }
+
+        void compileInstr(BlockId block, ValueId v)
+        {
+            const Instr &instr = fn.instrs[v];
+            const ValueId *ops = fn.operands(v);
+            switch (instr.op)
+            {
+            case Opcode::Nop:
+            case Opcode::Param:
+            case Opcode::Phi:
+                break;
+            case Opcode::Undef:
+                emit(Bytecode::LoadK, reg(v), {0, 0});
+                break;
+            case Opcode::Const:
+                if (instr.type == ValueType::Str)
+                    emit(Bytecode::LoadStr, reg(v), {static_cast<uint32_t>(instr.imm)});
+                else
+                    emit(Bytecode::LoadK, reg(v), {static_cast<uint32_t>(instr.imm), static_cast<uint32_t>(static_cast<uint64_t>(instr.imm) >> 32)});
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Rem:
+            case Opcode::Or:
+            case Opcode::And:
+            case Opcode::Shl:
+            case Opcode::Shr:
+            case Opcode::MulHigh:
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+                compileBinary(v, instr);
+                break;
+            case Opcode::Call:
+            case Opcode::CallVirtual:
+            {
+                uint32_t dest = instr.type == ValueType::Void ? NoRegister : reg(v);
+                if (instr.op == Opcode::Call)
+                    emit(Bytecode::Call, dest, {static_cast<uint32_t>(instr.imm), instr.count});
+                else
+                {
+                    const Function &target = module.functions[instr.imm];
+                    const IRClass &cls = module.classes[target.classIndex];
+                    emit(Bytecode::CallVirtual, dest, {static_cast<uint32_t>(target.vtableSlot), static_cast<uint32_t>(cls.vptrOffset), instr.count});
+                }
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    code.push_back(reg(ops[i]));
+                break;
+            }
+            case Opcode::New:
+                emit(Bytecode::New, reg(v), {static_cast<uint32_t>(instr.imm)});
+                break;
+            case Opcode::NewLocal:
+                emit(Bytecode::NewLocal, reg(v), {static_cast<uint32_t>(instr.imm), objectRegisters[v]});
+                break;
+            case Opcode::LoadGlobal:
+                emit(Bytecode::LoadGlobal, reg(v), {static_cast<uint32_t>(instr.imm)});
+                break;
+            case Opcode::StoreGlobal:
+                emit(Bytecode::StoreGlobal, reg(ops[0]), {static_cast<uint32_t>(instr.imm)});
+                break;
+            case Opcode::LoadField:
+            {
+                Bytecode op;
+                switch (instr.type)
+                {
+                case ValueType::I8: op = Bytecode::LoadI8; break;
+                case ValueType::U8:
+                case ValueType::Bool:
+                case ValueType::Byte: op = Bytecode::LoadU8; break;
+                case ValueType::I16: op = Bytecode::LoadI16; break;
+                case ValueType::U16: op = Bytecode::LoadU16; break;
+                case ValueType::I32: op = Bytecode::LoadI32; break;
+                case ValueType::U32: op = Bytecode::LoadU32; break;
+                case ValueType::F32: op = Bytecode::LoadF32; break;
+                default: op = Bytecode::Load64; break;
+                }
+                emit(op, reg(v), {reg(ops[0]), static_cast<uint32_t>(instr.imm)});
+                break;
+            }
+            case Opcode::StoreField:
+            {
+                ValueType type = fn.instrs[ops[1]].type;
+                Bytecode op;
+                if (type == ValueType::F32)
+                    op = Bytecode::StoreF32;
+                else if (type == ValueType::Str || type == ValueType::Ptr || valueBits(type) == 64)
+                    op = Bytecode::Store64;
+                else if (valueBits(type) == 32)
+                    op = Bytecode::Store32;
+                else if (valueBits(type) == 16)
+                    op = Bytecode::Store16;
+                else
+                    op = Bytecode::Store8;
+                emit(op, reg(ops[1]), {reg(ops[0]), static_cast<uint32_t>(instr.imm)});
+                break;
+            }
+            case Opcode::Jump:
+            {
+                BlockId target = static_cast<BlockId>(instr.imm);
+                edgeCopies(block, target);
+                if (target != block + 1)
+                    jump(Bytecode::Jmp, 0, target);
+                break;
+            }
+            case Opcode::Branch:
+            {
+                uint64_t targets = static_cast<uint64_t>(instr.imm);
+                BlockId onTrue = static_cast<BlockId>(targets & 0xffffffff), onFalse = static_cast<BlockId>(targets >> 32);
+                uint32_t condition = reg(ops[0]);
+                if (!hasPhis(onTrue) && !hasPhis(onFalse))
+                {
+                    if (onTrue == block + 1)
+                        jump(Bytecode::Jf, condition, onFalse);
+                    else
+                    {
+                        jump(Bytecode::Jt, condition, onTrue);
+                        if (onFalse != block + 1)
+                            jump(Bytecode::Jmp, 0, onFalse);
+                    }
+                    break;
+                }
+
+                // Each edge gets its own copies, so the false edge branches
+                // to a stub emitted after the true edge.
+                emit(Bytecode::Jf, condition, {0});
+                size_t stub = code.size() - 1;
+                edgeCopies(block, onTrue);
+                jump(Bytecode::Jmp, 0, onTrue);
+                code[stub] = static_cast<uint32_t>(code.size());
+                edgeCopies(block, onFalse);
+                if (onFalse != block + 1)
+                    jump(Bytecode::Jmp, 0, onFalse);
+                break;
+            }
+            case Opcode::Switch:
+            {
+                const SwitchTable &table = fn.switches[instr.imm];
+                uint64_t low = static_cast<uint64_t>(table.low);
+                uint32_t size = static_cast<uint32_t>(table.targets.size());
+                emit(Bytecode::Switch, reg(ops[0]), {static_cast<uint32_t>(low), static_cast<uint32_t>(low >> 32), size});
+                size_t entries = code.size();
+                code.resize(entries + size + 1);
+                std::vector<std::pair<size_t, BlockId>> stubs;
+                for (uint32_t i = 0; i <= size; ++i)
+                {
+                    BlockId target = i < size ? table.targets[i] : table.otherwise;
+                    if (hasPhis(target))
+                        stubs.push_back({entries + i, target});
+                    else
+                        fixups.push_back({entries + i, target});
+                }
+
+                // A target with phis gets one stub holding the copies for
+                // this edge, shared by all of its entries.
+                for (BlockId target : successors(fn, v))
+                {
+                    if (!hasPhis(target))
+                        continue;
+                    for (auto [at, to] : stubs)
+                        if (to == target)
+                            code[at] = static_cast<uint32_t>(code.size());
+                    edgeCopies(block, target);
+                    jump(Bytecode::Jmp, 0, target);
+                }
+                break;
+            }
+            case Opcode::Hash:
+            {
+                uint64_t basis = static_cast<uint64_t>(instr.imm);
+                emit(Bytecode::HashStr, reg(v), {reg(ops[0]), static_cast<uint32_t>(basis), static_cast<uint32_t>(basis >> 32)});
+                break;
+            }
+            case Opcode::Return:
+                if (instr.count)
+                    emit(Bytecode::Ret, reg(ops[0]));
+                else
+                    emit(Bytecode::RetVoid, 0);
+                break;
+            }
+        }
+    };
+}
+
+const char *toString(Bytecode op)
+{
+    static const char *const names[] = {
+#define VSHARP_BYTECODE_NAME(name, words) #name,
+        VSHARP_BYTECODE(VSHARP_BYTECODE_NAME)
+#undef VSHARP_BYTECODE_NAME
+    };
+    return names[static_cast<size_t>(op)];
+}
+
+std::vector<uint32_t> valueRegisters(const Function &fn)
+{
+    // Parameters arrive in the first registers of the frame; every other
+    // value has a register of its own, in block order.
+    std::vector<uint32_t> registers(fn.instrs.size(), NoRegister);
+    uint32_t next = static_cast<uint32_t>(fn.params.size());
+    for (const auto &block : fn.blocks)
+        for (ValueId v : block.code)
+        {
+            const Instr &instr = fn.instrs[v];
+            if (instr.op == Opcode::Param)
+                registers[v] = static_cast<uint32_t>(instr.imm);
+            else if (instr.type != ValueType::Void)
+                registers[v] = next++;
+        }
+    return registers;
+}
+
+size_t instructionSize(const uint32_t *code)
+{
+    auto op = static_cast<Bytecode>(code[0] & 0xff);
+    size_t size = 1 + OperandWords[static_cast<size_t>(op)];
+    if (op == Bytecode::Call)
+        size += code[2];
+    else if (op == Bytecode::CallVirtual)
+        size += code[3];
+    else if (op == Bytecode::Switch)
+        size += code[3] + 1;
+    return size;
+}
+
+BytecodeProgram compileBytecode(const Module &module)
+{
+    BytecodeProgram program;
+    program.strings = module.strings;
+    program.initializer = module.initializer;
+    program.entry = module.entry;
+
+    for (const auto &global : module.globals)
+    {
+        program.globals.push_back(static_cast<uint64_t>(global.init));
+        program.stringGlobals.push_back(global.type == ValueType::Str);
+    }
+    for (const auto &cls : module.classes)
+        program.classes.push_back({cls.name, static_cast<uint32_t>(cls.size), cls.hasVptr, static_cast<uint32_t>(cls.vptrOffset), cls.vtable});
+
+    for (const auto &fn : module.functions)
+        program.functions.push_back(FunctionCompiler(module, fn, program).compile());
+    return program;
+}
+
+void BytecodeProgram::disassemble(FILE *out) const
+{
+    std::vector<int> starts(code.size() + 1, -1);
+    for (size_t i = 0; i < functions.size(); ++i)
+        starts[functions[i].entry] = static_cast<int>(i);
+
+    for (size_t pc = 0; pc < code.size(); pc += instructionSize(&code[pc]))
+    {
+        if (starts[pc] >= 0)
+        {
+            const BytecodeFunction &fn = functions[starts[pc]];
+            fprintf(out, "%s%s: params %u, registers %u\n", pc ? "\n" : "", fn.name.c_str(), fn.params, fn.frameSize);
+        }
+
+        const uint32_t *at = &code[pc];
+        auto op = static_cast<Bytecode>(at[0] & 0xff);
+        uint32_t a = at[0] >> 8;
+        fprintf(out, "  %5zu  %-12s", pc, toString(op));
+        switch (op)
+        {
+        case Bytecode::LoadK:
+            fprintf(out, "r%u, %" PRId64, a, static_cast<int64_t>(at[1] | static_cast<uint64_t>(at[2]) << 32));
+            break;
+        case Bytecode::LoadStr:
+            fprintf(out, "r%u, str#%u", a, at[1]);
+            break;
+        case Bytecode::Norm:
+        {
+            static const char *const kinds[] = {"bool", "i8", "u8", "i16", "u16", "i32", "u32"};
+            fprintf(out, "r%u, %s", a, kinds[at[1]]);
+            break;
+        }
+        case Bytecode::Jmp:
+            fprintf(out, "%u", at[1]);
+            break;
+        case Bytecode::Jt:
+        case Bytecode::Jf:
+            fprintf(out, "r%u, %u", a, at[1]);
+            break;
+        case Bytecode::Switch:
+            fprintf(out, "r%u from %" PRId64 " [", a, static_cast<int64_t>(at[1] | static_cast<uint64_t>(at[2]) << 32));
+            for (uint32_t i = 0; i < at[3]; ++i)
+                fprintf(out, "%s%u", i ? ", " : "", at[4 + i]);
+            fprintf(out, "], %u", at[4 + at[3]]);
+            break;
+        case Bytecode::HashStr:
+            fprintf(out, "r%u, r%u, %#" PRIx64, a, at[1], at[2] | static_cast<uint64_t>(at[3]) << 32);
+            break;
+        case Bytecode::Ret:
+            fprintf(out, "r%u", a);
+            break;
+        case Bytecode::RetVoid:
+            break;
+        case Bytecode::Call:
+        case Bytecode::CallVirtual:
+        {
+            bool isVirtual = op == Bytecode::CallVirtual;
+            uint32_t argc = isVirtual ? at[3] : at[2];
+            const uint32_t *args = at + (isVirtual ? 4 : 3);
+            if (a != NoRegister)
+                fprintf(out, "r%u, ", a);
+            if (isVirtual)
+                fprintf(out, "slot %u @%u (", at[1], at[2]);
+            else
+                fprintf(out, "%s(", functions[at[1]].name.c_str());
+            for (uint32_t i = 0; i < argc; ++i)
+                fprintf(out, "%sr%u", i ? ", " : "", args[i]);
+            fputc(')', out);
+            break;
+        }
+        case Bytecode::New:
+            fprintf(out, "r%u, %s", a, classes[at[1]].name.c_str());
+            break;
+        case Bytecode::NewLocal:
+            fprintf(out, "r%u, %s at r%u", a, classes[at[1]].name.c_str(), at[2]);
+            break;
+        case Bytecode::LoadGlobal:
+        case Bytecode::StoreGlobal:
+            fprintf(out, "r%u, global#%u", a, at[1]);
+            break;
+        case Bytecode::LoadI8:
+        case Bytecode::LoadU8:
+        case Bytecode::LoadI16:
+        case Bytecode::LoadU16:
+        case Bytecode::LoadI32:
+        case Bytecode::LoadU32:
+        case Bytecode::Load64:
+        case Bytecode::LoadF32:
+        case Bytecode::Store8:
+        case Bytecode::Store16:
+        case Bytecode::Store32:
+        case Bytecode::Store64:
+        case Bytecode::StoreF32:
+            fprintf(out, "r%u, [r%u+%u]", a, at[1], at[2]);
+            break;
+        default:
+            fprintf(out, "r%u", a);
+            for (size_t i = 1; i <= OperandWords[static_cast<size_t>(op)]; ++i)
+                fprintf(out, ", r%u", at[i]);
+            break;
+        }
+        fputc('\n', out);
+    }
+}
@@ -0,0 +1,705 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <cbackend.hxx>
+
+namespace
+{
+    const char *const Prelude = R"(#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__)
+#define VS_UNUSED __attribute__((unused))
+#else
+#define VS_UNUSED
+#endif
+
+typedef void (*vs_fn)(void);
+typedef const char *vs_str;
+
+#define VS_FIELD(type, object, offset) (*(type *)((char *)(object) + (offset)))
+#define VS_VTABLE(object, offset) VS_FIELD(vs_fn const *, object, offset)
+
+VS_UNUSED static void vs_trap(const char *message)
+{
+    fprintf(stderr, "Runtime error: %s\n", message);
+    abort();
+}
+
+VS_UNUSED static vs_str vs_concat(vs_str a, vs_str b)
+{
+    size_t n = strlen(a), m = strlen(b);
+    char *s = malloc(n + m + 1);
+    if (!s)
+        vs_trap("Out of memory");
+    memcpy(s, a, n);
+    memcpy(s + n, b, m + 1);
+    return s;
+}
+
+/* FNV-1a, as match on strings hashes them at compile time. */
+VS_UNUSED static uint64_t vs_hash(vs_str s, uint64_t h)
+{
+    for (; *s; ++s)
+        h = (h ^ (unsigned char)*s) * UINT64_C(0x100000001b3);
+    return h;
+}
+
+VS_UNUSED static void *vs_new(size_t size)
+{
+    void *object = calloc(1, size);
+    if (!object)
+        vs_trap("Out of memory");
+    return object;
+}
+
+/* Division traps on zero; the minimum divided by -1 wraps. */
+#define VS_SIGNED_DIVISION(bits)                                                           \
+    static inline int##bits##_t vs_divs##bits(int##bits##_t a, int##bits##_t b)           \
+    {                                                                                      \
+        if (b == 0)                                                                        \
+            vs_trap("Division by zero");                                                   \
+        return b == -1 ? (int##bits##_t)(0 - (uint##bits##_t)a) : a / b;                  \
+    }                                                                                      \
+    static inline int##bits##_t vs_rems##bits(int##bits##_t a, int##bits##_t b)           \
+    {                                                                                      \
+        if (b == 0)                                                                        \
+            vs_trap("Division by zero");                                                   \
+        return b == -1 ? 0 : a % b;                                                        \
+    }
+#define VS_UNSIGNED_DIVISION(bits)                                                         \
+    static inline uint##bits##_t vs_divu##bits(uint##bits##_t a, uint##bits##_t b)         \
+    {                                                                                      \
+        if (b == 0)                                                                        \
+            vs_trap("Division by zero");                                                   \
+        return a / b;                                                                      \
+    }                                                                                      \
+    static inline uint##bits##_t vs_remu##bits(uint##bits##_t a, uint##bits##_t b)         \
+    {                                                                                      \
+        if (b == 0)                                                                        \
+            vs_trap("Division by zero");                                                   \
+        return a % b;                                                                      \
+    }
+VS_SIGNED_DIVISION(32)
+VS_SIGNED_DIVISION(64)
+VS_UNSIGNED_DIVISION(32)
+VS_UNSIGNED_DIVISION(64)
+
+/* High halves of 128-bit products, which divisions by constants use. */
+static inline uint64_t vs_mulhu64(uint64_t a, uint64_t b)
+{
+    uint64_t low = (a & 0xffffffff) * (b & 0xffffffff);
+    uint64_t middle = (a >> 32) * (b & 0xffffffff) + (low >> 32);
+    uint64_t cross = (a & 0xffffffff) * (b >> 32) + (middle & 0xffffffff);
+    return (a >> 32) * (b >> 32) + (middle >> 32) + (cross >> 32);
+}
+
+static inline int64_t vs_mulhs64(int64_t a, int64_t b)
+{
+    uint64_t high = vs_mulhu64((uint64_t)a, (uint64_t)b);
+    return (int64_t)(high - (a < 0 ? (uint64_t)b : 0) - (b < 0 ? (uint64_t)a : 0));
+}
+)";
+
+    const char *cType(ValueType type)
+    {
+        switch (type)
+        {
+        case ValueType::Void: return "void";
+        case ValueType::Bool: return "bool";
+        case ValueType::I8: return "int8_t";
+        case ValueType::I16: return "int16_t";
+        case ValueType::I32: return "int32_t";
+        case ValueType::I64: return "int64_t";
+        case ValueType::U8:
+        case ValueType::Byte: return "uint8_t";
+        case ValueType::U16: return "uint16_t";
+        case ValueType::U32: return "uint32_t";
+        case ValueType::U64: return "uint64_t";
+        case ValueType::F32: return "float";
+        case ValueType::F64: return "double";
+        case ValueType::Str: return "vs_str";
+        case ValueType::Ptr: return "void *";
+        }
+        return "void";
+    }
+
+    // Space before a name: none after a pointer star.
+    std::string declare(ValueType type, const std::string &name)
+    {
+        std::string decl = cType(type);
+        if (decl.back() != '*')
+            decl += ' ';
+        return decl + name;
+    }
+
+    bool isKeyword(const std::string &name)
+    {
+        static const std::unordered_set<std::string> keywords = {
+            "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum",
+            "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return",
+            "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void",
+            "volatile", "while", "bool", "true", "false", "vptr"};
+        return keywords.count(name) != 0;
+    }
+
+    // Qualified IR names ("Outer.Inner.method", "f.1", "Shape.<init>") as C
+    // identifiers: dots become double underscores.
+    std::string mangle(const std::string &name)
+    {
+        std::string out;
+        for (size_t i = 0; i < name.size(); ++i)
+        {
+            if (name.compare(i, 6, "<init>") == 0)
+            {
+                out += "init_";
+                i += 5;
+            }
+            else if (name[i] == '.')
+                out += "__";
+            else
+                out += name[i];
+        }
+        return out;
+    }
+
+    std::string quote(const std::string &text)
+    {
+        std::string out = "\"";
+        for (unsigned char c : text)
+        {
+            if (c == '"' || c == '\\')
+                (out += '\\') += static_cast<char>(c);
+            else if (c == '\n')
+                out += "\\n";
+            else if (c == '\t')
+                out += "\\t";
+            else if (c < 0x20 || c >= 0x7f)
+            {
+                // Three octal digits, so a following digit is not absorbed.
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\%03o", c);
+                out += buffer;
+            }
+            else
+                out += static_cast<char>(c);
+        }
+        return out + '"';
+    }
+
+    std::string constant(const Module &module, ValueType type, int64_t imm)
+    {
+        char buffer[64];
+        switch (type)
+        {
+        case ValueType::Bool:
+            return imm ? "true" : "false";
+        case ValueType::Str:
+            return quote(module.strings[imm]);
+        case ValueType::F32:
+        case ValueType::F64:
+        {
+            double value;
+            std::memcpy(&value, &imm, sizeof(value));
+            const char *suffix = type == ValueType::F32 ? "f" : "";
+            if (std::isnan(value))
+                return type == ValueType::F32 ? "NAN" : "(double)NAN";
+            if (std::isinf(value))
+                return std::string(value < 0 ? "-" : "") + (type == ValueType::F32 ? "INFINITY" : "(double)INFINITY");
+            snprintf(buffer, sizeof(buffer), "%a%s", value, suffix);
+            return buffer;
+        }
+        case ValueType::I64:
+            if (imm == INT64_MIN)
+                return "INT64_MIN";
+            snprintf(buffer, sizeof(buffer), "INT64_C(%" PRId64 ")", imm);
+            return buffer;
+        case ValueType::U64:
+            snprintf(buffer, sizeof(buffer), "UINT64_C(%" PRIu64 ")", static_cast<uint64_t>(imm));
+            return buffer;
+        case ValueType::U32:
+            snprintf(buffer, sizeof(buffer), "%" PRIu64 "u", static_cast<uint64_t>(imm));
+            return buffer;
+        case ValueType::I32:
+            if (imm == INT32_MIN)
+                return "INT32_MIN";
+            snprintf(buffer, sizeof(buffer), "%" PRId64, imm);
+            return buffer;
+        case ValueType::Ptr:
+            return "NULL";
+        default:
+            snprintf(buffer, sizeof(buffer), "%" PRId64, imm);
+            return buffer;
+        }
+    }
+
+    struct Member
+    {
+        std::string name;
+        ValueType type;
+        uint64_t offset;
+        bool vptr = false;
+    };
+
+    class CEmitter
+    {
+    public:
+        CEmitter(const Module &module, FILE *out) : module(module), out(out) {}
+
+        void emit()
+        {
+            fputs("/* Generated by vsharp. */\n", out);
+            fputs(Prelude, out);
+
+            for (size_t i = 0; i < module.classes.size(); ++i)
+                emitStruct(i);
+
+            fputc('\n', out);
+            for (const auto &fn : module.functions)
+                fprintf(out, "VS_UNUSED static %s;\n", signature(fn).c_str());
+
+            if (!module.globals.empty())
+                fputc('\n', out);
+            for (const auto &global : module.globals)
+                fprintf(out, "static %s = %s;\n", declare(global.type, "vsg_" + mangle(global.name)).c_str(),
+                        constant(module, global.type, global.init).c_str());
+
+            // Only classes that are instantiated need their table.
+            std::vector<bool> created(module.classes.size(), false);
+            for (const auto &fn : module.functions)
+                for (const auto &instr : fn.instrs)
+                    if (instr.op == Opcode::New || instr.op == Opcode::NewLocal)
+                        created[instr.imm] = true;
+            for (size_t i = 0; i < module.classes.size(); ++i)
+            {
+                const IRClass &cls = module.classes[i];
+                if (!created[i] || !cls.hasVptr)
+                    continue;
+                fprintf(out, "\nstatic vs_fn const vs_vtable_%s[] = {\n", mangle(cls.name).c_str());
+                for (uint32_t method : cls.vtable)
+                    fprintf(out, "    (vs_fn)%s,\n", functionName(module.functions[method]).c_str());
+                fputs("};\n", out);
+            }
+
+            for (const auto &fn : module.functions)
+                emitFunction(fn);
+
+            if (module.entry >= 0)
+            {
+                const Function &entry = module.functions[module.entry];
+                fputs("\nint main(void)\n{\n", out);
+                fprintf(out, "    %s();\n", functionName(module.functions[module.initializer]).c_str());
+                if (isIntegerValue(entry.returnType))
+                    fprintf(out, "    return (int)%s();\n", functionName(entry).c_str());
+                else
+                    fprintf(out, "    %s();\n    return 0;\n", functionName(entry).c_str());
+                fputs("}\n", out);
+            }
+        }
+
+    private:
+        const Module &module;
+        FILE *out;
+        std::vector<std::vector<Member>> members; /**< Per class, by offset, base fields included */
+
+        // Per function being emitted.
+        const Function *fn = nullptr;
+        std::vector<uint32_t> uses;
+        std::vector<bool> targets;
+
+        std::string functionName(const Function &f) const
+        {
+            return "vs_" + mangle(f.name);
+        }
+
+        std::string structName(size_t cls) const
+        {
+            return "struct vs_" + mangle(module.classes[cls].name);
+        }
+
+        std::string signature(const Function &f) const
+        {
+            std::string text = declare(f.returnType, functionName(f)) + "(";
+            for (size_t i = 0; i < f.params.size(); ++i)
+                text += (i ? ", " : "") + declare(f.params[i], "p" + std::to_string(i));
+            return text + (f.params.empty() ? "void)" : ")");
+        }
+
+        void emitStruct(size_t index)
+        {
+            const IRClass &cls = module.classes[index];
+            std::vector<Member> list = cls.base >= 0 ? members[cls.base] : std::vector<Member>{};
+            if (cls.hasVptr && std::none_of(list.begin(), list.end(), [](const Member &m)
+                                            { return m.vptr; }))
+                list.push_back({"vptr", ValueType::Ptr, cls.vptrOffset, true});
+            for (const auto &field : cls.fields)
+            {
+                std::string name = isKeyword(field.name) ? field.name + "_" : field.name;
+                // A field hiding one of a base class keeps both members.
+                while (std::any_of(list.begin(), list.end(), [&](const Member &m)
+                                   { return m.name == name; }))
+                    name += "_";
+                list.push_back({name, field.type, field.offset});
+            }
+            std::stable_sort(list.begin(), list.end(), [](const Member &a, const Member &b)
+                             { return a.offset < b.offset; });
+            members.push_back(list);
+
+            std::string name = structName(index);
+            fprintf(out, "\n%s\n{\n", name.c_str());
+            uint64_t at = 0;
+            size_t pads = 0;
+            auto pad = [&](uint64_t to)
+            {
+                if (to > at)
+                    fprintf(out, "    uint8_t pad%zu[%" PRIu64 "];\n", pads++, to - at);
+                at = std::max(at, to);
+            };
+            for (const auto &member : list)
+            {
+                pad(member.offset);
+                if (member.vptr)
+                    fputs("    vs_fn const *vptr;\n", out);
+                else
+                    fprintf(out, "    %s;\n", declare(member.type, member.name).c_str());
+                // Strings take 16 bytes in the layout; only the pointer is used here.
+                at = member.offset + (member.type == ValueType::Str ? 8 : std::max(1u, valueBits(member.type) / 8));
+            }
+            pad(cls.size);
+            if (list.empty() && cls.size == 0)
+                fputs("    uint8_t unused;\n", out);
+            fputs("};\n", out);
+
+            std::string mangled = mangle(cls.name);
+            fprintf(out, "typedef char vs_size_%s[sizeof(%s) == %" PRIu64 " ? 1 : -1];\n", mangled.c_str(), name.c_str(),
+                    std::max<uint64_t>(cls.size, 1));
+        }
+
+        std::string value(ValueId v) const
+        {
+            const Instr &instr = fn->instrs[v];
+            switch (instr.op)
+            {
+            case Opcode::Const:
+                return constant(module, instr.type, instr.imm);
+            case Opcode::Undef:
+                return instr.type == ValueType::Str ? "\"\"" : constant(module, instr.type, 0);
+            case Opcode::Param:
+                return "p" + std::to_string(instr.imm);
+            default:
+                return "v" + std::to_string(v);
+            }
+        }
+
+        bool hasLocal(ValueId v) const
+        {
+            const Instr &instr = fn->instrs[v];
+            return instr.type != ValueType::Void && instr.op != Opcode::Const && instr.op != Opcode::Undef && instr.op != Opcode::Param;
+        }
+
+        // The class of a receiver, when it is the method's own or freshly made.
+        int classOf(ValueId object) const
+        {
+            const Instr &instr = fn->instrs[object];
+            if (instr.op == Opcode::New || instr.op == Opcode::NewLocal)
+                return static_cast<int>(instr.imm);
+            if (instr.op == Opcode::Param && instr.imm == 0 && fn->classIndex >= 0 && !fn->params.empty() && fn->params[0] == ValueType::Ptr)
+                return fn->classIndex;
+            return -1;
+        }
+
+        std::string field(ValueId object, ValueType type, int64_t offset) const
+        {
+            int cls = classOf(object);
+            if (cls >= 0)
+                for (const auto &member : members[cls])
+                    if (!member.vptr && member.offset == static_cast<uint64_t>(offset) && member.type == type)
+                        return "((" + structName(cls) + " *)" + value(object) + ")->" + member.name;
+            return "VS_FIELD(" + std::string(cType(type)) + ", " + value(object) + ", " + std::to_string(offset) + ")";
+        }
+
+        std::string arithmetic(const Instr &instr, ValueId v) const
+        {
+            std::string a = value(fn->operand(v, 0)), b = value(fn->operand(v, 1));
+            ValueType type = instr.type;
+            static const char *const symbols[] = {" + ", " - ", " * ", " / ", " % ", " | ", " & ", " << ", " >> "};
+            const char *symbol = symbols[static_cast<size_t>(instr.op) - static_cast<size_t>(Opcode::Add)];
+
+            if (type == ValueType::Str)
+                return "vs_concat(" + a + ", " + b + ")";
+            if (isFloatValue(type) || instr.op == Opcode::Or)
+                return a + symbol + b;
+
+            unsigned bits = valueBits(type);
+            bool isSigned = isSignedValue(type);
+            // Strength-reduced code mixes widths: operands are read as 64-bit values.
+            if (instr.op == Opcode::MulHigh)
+                return "(" + std::string(cType(type)) + ")" + (isSigned ? "vs_mulhs64(" : "vs_mulhu64(") + a + ", " + b + ")";
+            if (instr.op == Opcode::Shr)
+                return "(" + std::string(cType(type)) + ")((" + (isSigned ? "int64_t" : "uint64_t") + ")" + a + " >> " + b + ")";
+            if (instr.op == Opcode::And || instr.op == Opcode::Shl)
+                return "(" + std::string(cType(type)) + ")((uint64_t)" + a + symbol + b + ")";
+            if (instr.op == Opcode::Div || instr.op == Opcode::Rem)
+            {
+                std::string helper = std::string(instr.op == Opcode::Div ? "vs_div" : "vs_rem") + (isSigned ? "s" : "u") + (bits == 64 ? "64" : "32");
+                std::string call = helper + "(" + a + ", " + b + ")";
+                return bits < 32 ? "(" + std::string(cType(type)) + ")" + call : call;
+            }
+            // Unsigned int and wider do not promote, so they wrap as they are.
+            if (!isSigned && bits >= 32)
+                return a + symbol + b;
+            const char *wide = bits == 64 ? "uint64_t" : "uint32_t";
+            return "(" + std::string(cType(type)) + ")((" + wide + ")" + a + symbol + "(" + wide + ")" + b + ")";
+        }
+
+        std::string compare(const Instr &instr, ValueId v) const
+        {
+            ValueId lhs = fn->operand(v, 0);
+            std::string a = value(lhs), b = value(fn->operand(v, 1));
+            if (fn->instrs[lhs].type == ValueType::Str)
+                return "strcmp(" + a + ", " + b + (instr.op == Opcode::Eq ? ") == 0" : ") != 0");
+            static const char *const symbols[] = {" == ", " != ", " < ", " <= ", " > ", " >= "};
+            return a + symbols[static_cast<size_t>(instr.op) - static_cast<size_t>(Opcode::Eq)] + b;
+        }
+
+        std::string call(const Instr &instr, ValueId v) const
+        {
+            const Function &target = module.functions[instr.imm];
+            std::string args;
+            for (uint16_t i = 0; i < instr.count; ++i)
+                args += (i ? ", " : "") + value(fn->operand(v, i));
+
+            if (instr.op == Opcode::Call)
+                return functionName(target) + "(" + args + ")";
+
+            std::string type = std::string(cType(target.returnType)) + " (*)(";
+            for (size_t i = 0; i < target.params.size(); ++i)
+                type += (i ? ", " : "") + std::string(cType(target.params[i]));
+            type += ")";
+            const IRClass &cls = module.classes[target.classIndex];
+            return "((" + type + ")VS_VTABLE(" + value(fn->operand(v, 0)) + ", " + std::to_string(cls.vptrOffset) + ")[" +
+                   std::to_string(target.vtableSlot) + "])(" + args + ")";
+        }
+
+        void edge(BlockId from, BlockId to, const char *indent)
+        {
+            auto copies = phiCopies(*fn, from, to);
+            copies.erase(std::remove_if(copies.begin(), copies.end(), [](const auto &copy)
+                                        { return copy.first == copy.second; }),
+                         copies.end());
+
+            // Phis read their operands in parallel; temporaries keep a swap intact.
+            bool reads = false;
+            for (const auto &[phi, source] : copies)
+                for (const auto &other : copies)
+                    reads = reads || other.second == phi;
+            if (!reads)
+                for (const auto &[phi, source] : copies)
+                    fprintf(out, "%sv%u = %s;\n", indent, phi, value(source).c_str());
+            else
+            {
+                fprintf(out, "%s{\n", indent);
+                for (size_t i = 0; i < copies.size(); ++i)
+                    fprintf(out, "%s    %s = %s;\n", indent, declare(fn->instrs[copies[i].first].type, "t" + std::to_string(i)).c_str(),
+                            value(copies[i].second).c_str());
+                for (size_t i = 0; i < copies.size(); ++i)
+                    fprintf(out, "%s    v%u = t%zu;\n", indent, copies[i].first, i);
+                fprintf(out, "%s}\n", indent);
+            }
+            fprintf(out, "%sgoto b%u;\n", indent, to);
+        }
+
+        void emitFunction(const Function &f)
+        {
+            fn = &f;
+            uses.assign(f.instrs.size(), 0);
+            targets.assign(f.blocks.size(), false);
+            for (BlockId b = 0; b < f.blocks.size(); ++b)
+            {
+                for (BlockId succ : f.blocks[b].succs)
+                    targets[succ] = true;
+                for (ValueId v : f.blocks[b].code)
+                {
+                    const Instr &instr = f.instrs[v];
+                    size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                    for (size_t i = 0; i < instr.count; i += step)
+                        ++uses[f.operand(v, i)];
+                }
+            }
+
+            fprintf(out, "\nstatic %s\n{\n", signature(f).c_str());
+            bool locals = false;
+            for (const auto &block : f.blocks)
+                for (ValueId v : block.code)
+                {
+                    if (hasLocal(v) && (uses[v] || f.instrs[v].op == Opcode::Phi))
+                    {
+                        fprintf(out, "    %s;\n", declare(f.instrs[v].type, "v" + std::to_string(v)).c_str());
+                        locals = true;
+                    }
+                    if (f.instrs[v].op == Opcode::NewLocal)
+                    {
+                        fprintf(out, "    %s o%u;\n", structName(f.instrs[v].imm).c_str(), v);
+                        locals = true;
+                    }
+                }
+            for (size_t i = 0; i < f.params.size(); ++i)
+            {
+                bool used = false;
+                for (const auto &block : f.blocks)
+                    for (ValueId v : block.code)
+                        used = used || (f.instrs[v].op == Opcode::Param && f.instrs[v].imm == static_cast<int64_t>(i) && uses[v]);
+                if (!used)
+                {
+                    fprintf(out, "    (void)p%zu;\n", i);
+                    locals = true;
+                }
+            }
+            if (locals)
+                fputc('\n', out);
+
+            for (BlockId b = 0; b < f.blocks.size(); ++b)
+            {
+                if (targets[b])
+                    fprintf(out, "b%u:;\n", b);
+                for (ValueId v : f.blocks[b].code)
+                    emitInstr(b, v);
+            }
+            fputs("}\n", out);
+        }
+
+        void assign(ValueId v, const std::string &expression)
+        {
+            if (uses[v])
+                fprintf(out, "    v%u = %s;\n", v, expression.c_str());
+        }
+
+        void emitInstr(BlockId block, ValueId v)
+        {
+            const Instr &instr = fn->instrs[v];
+            switch (instr.op)
+            {
+            case Opcode::Nop:
+            case Opcode::Undef:
+            case Opcode::Const:
+            case Opcode::Param:
+            case Opcode::Phi:
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Rem:
+            case Opcode::Or:
+            case Opcode::And:
+            case Opcode::Shl:
+            case Opcode::Shr:
+            case Opcode::MulHigh:
+                // Division keeps its trap even when the quotient is unused.
+                if (uses[v])
+                    assign(v, arithmetic(instr, v));
+                else if (instr.op == Opcode::Div || instr.op == Opcode::Rem)
+                    fprintf(out, "    (void)%s;\n", arithmetic(instr, v).c_str());
+                break;
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+                assign(v, compare(instr, v));
+                break;
+            case Opcode::Call:
+            case Opcode::CallVirtual:
+                if (uses[v])
+                    assign(v, call(instr, v));
+                else
+                    fprintf(out, "    %s;\n", call(instr, v).c_str());
+                break;
+            case Opcode::New:
+            {
+                std::string name = structName(instr.imm);
+                fprintf(out, "    v%u = vs_new(sizeof(%s));\n", v, name.c_str());
+                if (module.classes[instr.imm].hasVptr)
+                    fprintf(out, "    ((%s *)v%u)->vptr = vs_vtable_%s;\n", name.c_str(), v, mangle(module.classes[instr.imm].name).c_str());
+                break;
+            }
+            case Opcode::NewLocal:
+            {
+                fprintf(out, "    memset(&o%u, 0, sizeof(o%u));\n", v, v);
+                if (module.classes[instr.imm].hasVptr)
+                    fprintf(out, "    o%u.vptr = vs_vtable_%s;\n", v, mangle(module.classes[instr.imm].name).c_str());
+                assign(v, "&o" + std::to_string(v));
+                break;
+            }
+            case Opcode::LoadGlobal:
+                assign(v, "vsg_" + mangle(module.globals[instr.imm].name));
+                break;
+            case Opcode::StoreGlobal:
+                fprintf(out, "    vsg_%s = %s;\n", mangle(module.globals[instr.imm].name).c_str(), value(fn->operand(v, 0)).c_str());
+                break;
+            case Opcode::LoadField:
+                assign(v, field(fn->operand(v, 0), instr.type, instr.imm));
+                break;
+            case Opcode::StoreField:
+            {
+                ValueId stored = fn->operand(v, 1);
+                fprintf(out, "    %s = %s;\n", field(fn->operand(v, 0), fn->instrs[stored].type, instr.imm).c_str(), value(stored).c_str());
+                break;
+            }
+            case Opcode::Jump:
+                edge(block, static_cast<BlockId>(instr.imm), "    ");
+                break;
+            case Opcode::Branch:
+            {
+                uint64_t both = static_cast<uint64_t>(instr.imm);
+                fprintf(out, "    if (%s)\n    {\n", value(fn->operand(v, 0)).c_str());
+                edge(block, static_cast<BlockId>(both & 0xffffffff), "        ");
+                fputs("    }\n", out);
+                edge(block, static_cast<BlockId>(both >> 32), "    ");
+                break;
+            }
+            case Opcode::Switch:
+            {
+                const SwitchTable &table = fn->switches[instr.imm];
+                ValueType type = fn->instrs[fn->operand(v, 0)].type;
+                fprintf(out, "    switch (%s)\n    {\n", value(fn->operand(v, 0)).c_str());
+                for (BlockId target : successors(*fn, v))
+                {
+                    if (target == table.otherwise)
+                        continue;
+                    for (size_t i = 0; i < table.targets.size(); ++i)
+                        if (table.targets[i] == target)
+                            fprintf(out, "    case %s:\n", constant(module, type, static_cast<int64_t>(static_cast<uint64_t>(table.low) + i)).c_str());
+                    edge(block, target, "        ");
+                }
+                fputs("    default:\n", out);
+                edge(block, table.otherwise, "        ");
+                fputs("    }\n", out);
+                break;
+            }
+            case Opcode::Hash:
+                assign(v, "vs_hash(" + value(fn->operand(v, 0)) + ", " + constant(module, ValueType::U64, instr.imm) + ")");
+                break;
+            case Opcode::Return:
+                if (instr.count)
+                    fprintf(out, "    return %s;\n", value(fn->operand(v, 0)).c_str());
+                else
+                    fputs("    return;\n", out);
+                break;
+            }
+        }
+    };
+}
+
+void emitC(const Module &module, FILE *out)
+{
+    CEmitter(module, out).emit();
+}
@@ -2,9 +2,25 @@
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <charconv>
 #include <sstream>
 #include <config.hxx>
 #include <parser.hxx>
+#include <hashcons.hxx>
+#include <dumper.hxx>
+#include <resolver.hxx>
+#include <typecheck.hxx>
+#include <fold.hxx>
+#include <layout.hxx>
+#include <hierarchy.hxx>
+#include <lower.hxx>
+#include <passmanager.hxx>
+#include <bytecode.hxx>
+#include <vm.hxx>
+#include <codegen.hxx>
+#include <cbackend.hxx>
+#include <jit.hxx>
+#include <tiering.hxx>
 
 #include <flex/FlexLexer.h>
 
@@ -20,6 +36,66 @@ void printVersion()
     std::cout << "VSharp Compiler v" << VSHARP_VERSION << std::endl;
 }
 
+// A prelude is either an alias table written by --emit-aliases or V# source
+// whose typedef/define declarations are collected. Either way its aliases are
+// added to the ones loaded by earlier preludes.
+bool loadPrelude(const std::string &path, AliasTable &aliases)
+{
+    AliasTable table;
+    if (table.load(path))
+    {
+        aliases.merge(table);
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const std::string *savedSource = Source;
+    std::string savedFile = currentFile;
+    Source = &source;
+    currentFile = path;
+    column = 1;
+
+    std::istringstream ss(source);
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, source);
+    parser.useAliases(aliases);
+    parser.parserProgram();
+    aliases.merge(parser.aliases);
+
+    Source = savedSource;
+    currentFile = savedFile;
+    column = 1;
+    return true;
+}
+
+// Reads the count after the '=' of a --flag=N option. Anything but a
+// decimal number that fits ends the run with an error.
+template <typename T>
+static T countFlag(const std::string &flag, size_t prefix)
+{
+    std::string_view text = std::string_view(flag).substr(prefix);
+    T value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size())
+    {
+        std::cerr << "Invalid value for " << flag.substr(0, prefix - 1) << ": '" << text << "' (expected a non-negative integer)" << std::endl;
+        exit(1);
+    }
+    return value;
+}
+
+// Both commands reject a flag they do not know, the same way, rather than
+// letting a typo such as --O2 silently change nothing.
+[[noreturn]] static void unknownFlag(const char *command, const std::string &flag)
+{
+    std::cerr << "Unknown flag for " << command << ": " << flag << std::endl;
+    exit(1);
+}
+
 void compileFile(const std::string &filename, const std::vector<std::string> &flags)
 {
     if (!std::filesystem::exists(filename))
@@ -39,25 +115,342 @@ void compileFile(const std::string &filename, const std::vector<std::string> &fl
         std::cerr << "File is empty: " << filename << std::endl;
     }
 
+    bool emitAst = false;
+    bool streamAst = false;
+    bool emitFoldedAst = false;
+    DumpFormat format = DumpFormat::Text;
+    AliasTable prelude;
+    std::string aliasOutput;
+    LayoutProfile layoutProfile;
+    bool emitLayout = false;
+    bool emitIr = false;
+    bool emitBytecode = false;
+    std::string objectOutput;
+    bool emitCSource = false;
+    std::string cOutput;
+    unsigned optLevel = 0;
+    unsigned threads = 0;
+    bool timePasses = false;
+    bool verifyIr = false;
+    bool remarks = false;
+    bool stats = false;
+    unsigned unroll = 0;
+    bool avx2 = false;
+    bool hashCons = false;
+    for (const auto &flag : flags)
+    {
+        if (flag.rfind("--prelude=", 0) == 0)
+        {
+            if (!loadPrelude(flag.substr(10), prelude))
+            {
+                std::cerr << "Cannot load prelude: " << flag.substr(10) << std::endl;
+                exit(1);
+            }
+        }
+        else if (flag.rfind("--layout-profile=", 0) == 0)
+        {
+            if (!layoutProfile.load(flag.substr(17)))
+            {
+                std::cerr << "Cannot load layout profile: " << flag.substr(17) << std::endl;
+                exit(1);
+            }
+        }
+        else if (flag == "--emit-layout")
+            emitLayout = true;
+        else if (flag == "--emit-ir")
+            emitIr = true;
+        else if (flag == "--emit-bytecode")
+            emitBytecode = true;
+        else if (flag.rfind("--emit-obj=", 0) == 0)
+            objectOutput = flag.substr(11);
+        else if (flag == "--emit-c")
+            emitCSource = true;
+        else if (flag.rfind("--emit-c=", 0) == 0)
+        {
+            emitCSource = true;
+            cOutput = flag.substr(9);
+        }
+        else if (flag == "-O0" || flag == "-O1" || flag == "-O2")
+            optLevel = static_cast<unsigned>(flag[2] - '0');
+        else if (flag.rfind("--threads=", 0) == 0)
+            threads = countFlag<unsigned>(flag, 10);
+        else if (flag == "--time-passes")
+            timePasses = true;
+        else if (flag == "--verify-ir")
+            verifyIr = true;
+        else if (flag == "--remarks")
+            remarks = true;
+        else if (flag == "--stats")
+            stats = true;
+        else if (flag.rfind("--unroll=", 0) == 0)
+            unroll = countFlag<unsigned>(flag, 9);
+        else if (flag == "-mavx2")
+            avx2 = true;
+        else if (flag.rfind("--emit-aliases=", 0) == 0)
+            aliasOutput = flag.substr(15);
+        else if (flag == "--emit-ast")
+            emitAst = true;
+        else if (flag.rfind("--emit-ast=", 0) == 0)
+        {
+            emitAst = true;
+            if (!parseDumpFormat(std::string_view(flag).substr(11), format))
+            {
+                std::cerr << "Unknown AST format: " << flag.substr(11) << " (expected text, json or sexpr)" << std::endl;
+                exit(1);
+            }
+        }
+        else if (flag == "--stream-ast")
+            streamAst = true;
+        else if (flag == "--emit-folded-ast")
+            emitFoldedAst = true;
+        else if (flag == "--hash-cons")
+            hashCons = true;
+        else
+            unknownFlag("compile", flag);
+    }
+    streamAst = streamAst && emitAst;
+
+    Source = &source;
+    currentFile = filename;
+
+    std::istringstream ss(source);
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, source);
+    parser.useAliases(prelude);
+
+    ASTDumper dumper(stdout, format);
+    if (streamAst)
+    {
+        dumper.begin();
+        parser.onTopLevel = [&dumper](const ASTNode *node)
+        {
+            dumper.item(node);
+        };
+    }
+
+    try
+    {
+        ASTNodePtr ast = parser.parserProgram();
+
+        // --emit-ast shows the parse tree, streamed or not, so both modes
+        // print the same thing; --emit-folded-ast shows it after folding.
+        if (streamAst)
+            dumper.end();
+        else if (emitAst)
+            dumper.dump(ast.get());
+
+        SymbolTable symbols;
+        resolveNames(ast.get(), symbols, source);
+
+        TypeInterner types;
+        checkTypes(ast.get(), symbols, types, source);
+
+        // Shared subtrees are folded and lowered once for all their occurrences.
+        HashConsTable hashTable;
+        if (hashCons)
+            hashTable.intern(ast);
+        foldConstants(ast);
+        if (emitFoldedAst)
+            ASTDumper(stdout, format).dump(ast.get());
+
+        ClassHierarchy hierarchy;
+        hierarchy.build(ast.get(), source);
+        devirtualize(ast.get(), hierarchy);
+
+        LayoutEngine layouts(&layoutProfile, &hierarchy);
+        layouts.run(ast.get());
+        if (emitLayout)
+            layouts.print(stdout);
+
+        if (emitIr || emitBytecode || !objectOutput.empty() || emitCSource || timePasses || verifyIr || remarks || stats)
+        {
+            Module module = lowerToIR(ast.get(), hierarchy, layouts, source);
+
+            PassManager passes(threads);
+            passes.addPipeline(optLevel);
+            passes.setTiming(timePasses);
+            passes.setVerify(verifyIr);
+            passes.setRemarks(remarks ? stderr : nullptr);
+            passes.setUnroll(unroll);
+            passes.run(module);
+
+            if (timePasses)
+                passes.printTiming(stderr);
+            if (stats)
+                passes.printStatistics(stderr);
+            if (emitIr)
+                module.print(stdout);
+            if (emitBytecode)
+                compileBytecode(module).disassemble(stdout);
+            if (!objectOutput.empty() && !emitObject(module, optLevel, avx2).write(objectOutput))
+            {
+                std::cerr << "Cannot write object file: " << objectOutput << std::endl;
+                exit(1);
+            }
+            if (emitCSource)
+            {
+                FILE *out = cOutput.empty() ? stdout : fopen(cOutput.c_str(), "w");
+                if (!out)
+                {
+                    std::cerr << "Cannot write C file: " << cOutput << std::endl;
+                    exit(1);
+                }
+                emitC(module, out);
+                if (out != stdout)
+                    fclose(out);
+            }
+        }
+
+        if (!aliasOutput.empty() && !parser.aliases.save(aliasOutput))
+        {
+            std::cerr << "Cannot write alias table: " << aliasOutput << std::endl;
+            exit(1);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+}
+
+void runFile(const std::string &filename, const std::vector<std::string> &flags)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open file: " << filename << std::endl;
+        exit(1);
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    unsigned optLevel = 1;
+    unsigned threads = 0;
+    Dispatch dispatch = Dispatch::Threaded;
+    bool jit = false;
+    bool perfMap = false;
+    bool tiered = false;
+    bool tierStats = false;
+    bool remarks = false;
+    bool stats = false;
+    unsigned unroll = 0;
+    bool hashCons = false;
+    TierOptions tierOptions;
+    AliasTable prelude;
+    for (const auto &flag : flags)
+    {
+        if (flag == "-O0" || flag == "-O1" || flag == "-O2")
+            optLevel = static_cast<unsigned>(flag[2] - '0');
+        else if (flag.rfind("--prelude=", 0) == 0)
+        {
+            if (!loadPrelude(flag.substr(10), prelude))
+            {
+                std::cerr << "Cannot load prelude: " << flag.substr(10) << std::endl;
+                exit(1);
+            }
+        }
+        else if (flag.rfind("--threads=", 0) == 0)
+            threads = countFlag<unsigned>(flag, 10);
+        else if (flag == "--dispatch=threaded")
+            dispatch = Dispatch::Threaded;
+        else if (flag == "--dispatch=switch")
+            dispatch = Dispatch::Switch;
+        else if (flag == "--jit")
+            jit = true;
+        else if (flag == "--perf-map")
+            perfMap = true;
+        else if (flag == "--tiered")
+            tiered = true;
+        else if (flag.rfind("--jit-threshold=", 0) == 0)
+            tierOptions.threshold = countFlag<uint32_t>(flag, 16);
+        else if (flag == "--jit-sync")
+            tierOptions.background = false;
+        else if (flag == "--tier-stats")
+            tierStats = true;
+        else if (flag == "--remarks")
+            remarks = true;
+        else if (flag == "--stats")
+            stats = true;
+        else if (flag.rfind("--unroll=", 0) == 0)
+            unroll = countFlag<unsigned>(flag, 9);
+        else if (flag == "--hash-cons")
+            hashCons = true;
+        else
+            unknownFlag("run", flag);
+    }
+
     Source = &source;
     currentFile = filename;
 
     std::istringstream ss(source);
     yyFlexLexer lexer(&ss);
     Parser parser(lexer, source);
+    parser.useAliases(prelude);
 
+    int status = 0;
     try
     {
         ASTNodePtr ast = parser.parserProgram();
 
-        if (std::find(flags.begin(), flags.end(), "--emit-ast") != flags.end())
+        SymbolTable symbols;
+        resolveNames(ast.get(), symbols, source);
+
+        TypeInterner types;
+        checkTypes(ast.get(), symbols, types, source);
+
+        // Shared subtrees are folded and lowered once for all their occurrences.
+        HashConsTable hashTable;
+        if (hashCons)
+            hashTable.intern(ast);
+        foldConstants(ast);
+
+        ClassHierarchy hierarchy;
+        hierarchy.build(ast.get(), source);
+        devirtualize(ast.get(), hierarchy);
+
+        LayoutProfile layoutProfile;
+        LayoutEngine layouts(&layoutProfile, &hierarchy);
+        layouts.run(ast.get());
+
+        Module module = lowerToIR(ast.get(), hierarchy, layouts, source);
+        PassManager passes(threads);
+        passes.addPipeline(optLevel);
+        passes.setRemarks(remarks ? stderr : nullptr);
+        passes.setUnroll(unroll);
+        passes.run(module);
+
+        if (tiered)
+        {
+            tierOptions.optLevel = optLevel;
+            TieredRunner runner(module, tierOptions);
+            status = runner.run();
+            if (tierStats)
+                runner.printStats(stderr);
+        }
+        else if (jit)
         {
-            printAST(ast.get());
+            Jit compiler(module, optLevel);
+            if (perfMap && !compiler.writePerfMap())
+                std::cerr << "Cannot write perf map" << std::endl;
+            status = compiler.run();
         }
+        else
+        {
+            BytecodeProgram program = compileBytecode(module);
+            VM vm(program);
+            vm.setDispatch(dispatch);
+            status = vm.run();
+            if (stats)
+                passes.addStatistic("vm", "heap allocations made", vm.allocations());
+        }
+        if (stats)
+            passes.printStatistics(stderr);
     }
     catch (const std::exception &e)
     {
         std::cerr << e.what() << std::endl;
         exit(1);
     }
-}
\ No newline at end of file
+    std::cout.flush();
+    exit(status);
+}
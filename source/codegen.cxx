@@ -0,0 +1,1373 @@
+#include <algorithm>
+#include <cstring>
+#include <codegen.hxx>
+#include <loops.hxx>
+#include <regalloc.hxx>
+#include <strength.hxx>
+#include <x86.hxx>
+
+namespace
+{
+    const Reg IntArgs[] = {Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9};
+    constexpr unsigned SseArgs = 8;
+
+    // Where the System V convention passes one argument: the index of an
+    // integer or SSE register, or of an eightbyte on the stack.
+    struct ArgLocation
+    {
+        bool stack;
+        bool sse;
+        unsigned index;
+    };
+
+    std::vector<ArgLocation> classifyArgs(const std::vector<ValueType> &types)
+    {
+        std::vector<ArgLocation> locations;
+        unsigned ints = 0, sses = 0, stack = 0;
+        for (ValueType type : types)
+        {
+            if (isFloatValue(type) && sses < SseArgs)
+                locations.push_back({false, true, sses++});
+            else if (!isFloatValue(type) && ints < std::size(IntArgs))
+                locations.push_back({false, false, ints++});
+            else
+                locations.push_back({true, false, stack++});
+        }
+        return locations;
+    }
+
+    unsigned fieldBytes(ValueType type)
+    {
+        unsigned bits = valueBits(type);
+        return bits >= 64 ? 8 : bits / 8;
+    }
+
+    AluOp aluOp(Opcode op)
+    {
+        return op == Opcode::Add ? AluOp::Add : op == Opcode::Sub ? AluOp::Sub
+                                            : op == Opcode::Or    ? AluOp::Or
+                                                                  : AluOp::And;
+    }
+
+    Cond comparison(Opcode op, bool isSigned)
+    {
+        switch (op)
+        {
+        case Opcode::Eq:
+            return Cond::E;
+        case Opcode::Ne:
+            return Cond::NE;
+        case Opcode::Lt:
+            return isSigned ? Cond::L : Cond::B;
+        case Opcode::Le:
+            return isSigned ? Cond::LE : Cond::BE;
+        case Opcode::Gt:
+            return isSigned ? Cond::G : Cond::A;
+        default:
+            return isSigned ? Cond::GE : Cond::AE;
+        }
+    }
+
+    class X86FunctionCompiler
+    {
+    public:
+        X86FunctionCompiler(const Module &module, const Function &fn, unsigned optLevel, bool avx2)
+            : module(module), fn(fn), optLevel(optLevel), avx2(avx2) {}
+
+        NativeFunction compile()
+        {
+            regs = allocateRegisters(fn, optLevel == 0   ? RegisterAllocator::None
+                                         : optLevel == 1 ? RegisterAllocator::LinearScan
+                                                         : RegisterAllocator::GraphColoring);
+
+            // Below the frame pointer: the preserved registers the function
+            // uses, save slots for r10 and r11, a scratch slot for edge copies,
+            // the spill slots and the instances that live in the frame.
+            size_t slots = regs.calleeSaved.size() + 3 + regs.slots;
+            objectSlots.assign(fn.instrs.size(), 0);
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                    if (fn.instrs[v].op == Opcode::NewLocal)
+                    {
+                        slots += std::max<uint64_t>(1, (module.classes[fn.instrs[v].imm].size + 7) / 8);
+                        objectSlots[v] = static_cast<uint32_t>(slots - 1);
+                    }
+            int32_t frame = static_cast<int32_t>(8 * slots);
+            frame = (frame + 15) & ~15;
+
+            a.setPeephole(optLevel > 0);
+            if (optLevel > 0)
+            {
+                uses.assign(fn.instrs.size(), 0);
+                for (const auto &block : fn.blocks)
+                    for (ValueId v : block.code)
+                    {
+                        const Instr &instr = fn.instrs[v];
+                        size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                        for (size_t i = 0; i < instr.count; i += step)
+                            ++uses[fn.operand(v, i)];
+                    }
+            }
+            if (optLevel > 1)
+                for (BlockId b = 0; b < fn.blocks.size(); ++b)
+                    planVectorLoop(b);
+
+            a.push(Reg::RBP);
+            a.mov(Reg::RBP, Reg::RSP);
+            a.alu(AluOp::Sub, Reg::RSP, frame);
+            for (size_t i = 0; i < regs.calleeSaved.size(); ++i)
+                a.store(frameSlot(i), regs.calleeSaved[i]);
+            storeParams();
+
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+                blockLabels.push_back(a.newLabel());
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                a.bind(blockLabels[b]);
+                const auto &code = fn.blocks[b].code;
+                for (size_t i = 0; i < code.size(); ++i)
+                    compileInstr(b, code[i], i + 1 < code.size() ? code[i + 1] : NoValue);
+            }
+            // Every division by zero leads here, out of the way of the code.
+            if (trapUsed)
+            {
+                a.bind(trap);
+                callRuntime(RuntimeFunction::Trap);
+            }
+            for (const auto &entry : tableEntries)
+            {
+                int32_t delta = static_cast<int32_t>(a.offset(entry.target) - entry.table);
+                std::memcpy(&a.bytes[entry.at], &delta, sizeof(delta));
+            }
+
+            out.instructions = a.instructionCount();
+            out.code = std::move(a.bytes);
+            return std::move(out);
+        }
+
+    private:
+        const Module &module;
+        const Function &fn;
+        unsigned optLevel;
+        bool avx2;
+        Assembler a;
+        NativeFunction out;
+        RegisterAssignment regs;
+        std::vector<uint32_t> uses;
+        std::vector<uint32_t> objectSlots; /**< Frame slot of the lowest word of each NewLocal */
+        std::vector<Assembler::Label> blockLabels;
+        ValueId fused = NoValue; /**< Comparison whose flags the next branch tests */
+        Cond fusedCond = Cond::NE;
+        ValueId folded = NoValue; /**< Small left shift the next addition does as a scaled index */
+        Assembler::Label trap;    /**< Call to vsharp_trap after the blocks */
+        bool trapUsed = false;
+
+        /** @brief A jump table entry, the offset of its target from the table, filled in at the end */
+        struct TableEntry
+        {
+            size_t at, table;
+            Assembler::Label target;
+        };
+        std::vector<TableEntry> tableEntries;
+
+        // A ReductionLoop entered from its preheader first runs whole vectors
+        // of iterations; the scalar loop then does what is left. Every value
+        // the vector loop computes gets a register from xmm2 up, leaving xmm0
+        // and xmm1 as scratch.
+        struct VectorLoop
+        {
+            ReductionLoop loop;
+            std::vector<std::pair<ValueId, Xmm>> xmms;
+            std::vector<Xmm> steps;          /**< Per induction variable, the step of a whole vector */
+            std::vector<ValueId> broadcasts; /**< Constants and values from before the loop */
+            std::vector<ValueId> body;       /**< Latch values computed in every lane */
+
+            Xmm xmm(ValueId v) const
+            {
+                for (auto [value, reg] : xmms)
+                    if (value == v)
+                        return reg;
+                return 0;
+            }
+        };
+        std::vector<VectorLoop> vectorLoops;
+
+        static constexpr uint32_t ScratchLocation = UINT32_MAX;
+
+        Mem frameSlot(size_t index) const { return {Reg::RBP, static_cast<int32_t>(-8 * (index + 1))}; }
+        Mem saveSlot(Reg reg) const { return frameSlot(regs.calleeSaved.size() + (reg == Reg::R10 ? 0 : 1)); }
+        Mem spillSlot(uint32_t slot) const { return frameSlot(regs.calleeSaved.size() + 3 + slot); }
+
+        // Edge copies move between locations: a register index below 16, a
+        // spill slot 16 and up, or the scratch slot.
+        uint32_t location(ValueId v) const
+        {
+            uint8_t reg = regs.reg[v];
+            if (reg == RegisterAssignment::Spilled)
+                return 16 + regs.slot[v];
+            return reg == RegisterAssignment::Unused ? NoValue : reg;
+        }
+
+        Mem locationSlot(uint32_t at) const
+        {
+            return at == ScratchLocation ? frameSlot(regs.calleeSaved.size() + 2) : spillSlot(at - 16);
+        }
+
+        void relocate(size_t at, NativeTarget target, uint32_t index)
+        {
+            out.relocations.push_back({static_cast<uint32_t>(at), target, index});
+        }
+
+        void callRuntime(RuntimeFunction function)
+        {
+            relocate(a.call(), NativeTarget::Runtime, static_cast<uint32_t>(function));
+        }
+
+        void load(Reg reg, ValueId v)
+        {
+            const Instr &instr = fn.instrs[v];
+            if (instr.op == Opcode::Const)
+            {
+                if (instr.type == ValueType::Str)
+                    relocate(a.leaRip(reg), NativeTarget::String, static_cast<uint32_t>(instr.imm));
+                else
+                    a.movImm(reg, instr.imm);
+            }
+            else if (instr.op == Opcode::Undef)
+                a.movImm(reg, 0);
+            else if (regs.reg[v] < 16)
+            {
+                if (static_cast<Reg>(regs.reg[v]) != reg)
+                    a.mov(reg, static_cast<Reg>(regs.reg[v]));
+            }
+            else
+                a.load(reg, spillSlot(regs.slot[v]), 8);
+        }
+
+        /** @brief The register holding a value, or scratch after loading it there */
+        Reg operand(ValueId v, Reg scratch)
+        {
+            if (regs.reg[v] < 16 && fn.instrs[v].op != Opcode::Const && fn.instrs[v].op != Opcode::Undef)
+                return static_cast<Reg>(regs.reg[v]);
+            load(scratch, v);
+            return scratch;
+        }
+
+        void store(ValueId v, Reg reg)
+        {
+            uint8_t at = regs.reg[v];
+            if (at == RegisterAssignment::Unused)
+                return;
+            if (at == RegisterAssignment::Spilled)
+                a.store(spillSlot(regs.slot[v]), reg);
+            else if (static_cast<Reg>(at) != reg)
+                a.mov(static_cast<Reg>(at), reg);
+        }
+
+        void move(uint32_t to, uint32_t from)
+        {
+            if (to < 16 && from < 16)
+                a.mov(static_cast<Reg>(to), static_cast<Reg>(from));
+            else if (from < 16)
+                a.store(locationSlot(to), static_cast<Reg>(from));
+            else if (to < 16)
+                a.load(static_cast<Reg>(to), locationSlot(from), 8);
+            else
+            {
+                a.load(Reg::RAX, locationSlot(from), 8);
+                a.store(locationSlot(to), Reg::RAX);
+            }
+        }
+
+        // Calls clobber r10 and r11; values kept there across one are saved
+        // in the frame around it.
+        void saveAcross(ValueId call, bool restore)
+        {
+            for (Reg reg : {Reg::R10, Reg::R11})
+                if (regs.saved[call] >> static_cast<unsigned>(reg) & 1)
+                {
+                    if (restore)
+                        a.load(reg, saveSlot(reg), 8);
+                    else
+                        a.store(saveSlot(reg), reg);
+                }
+        }
+
+        void epilogue()
+        {
+            for (size_t i = 0; i < regs.calleeSaved.size(); ++i)
+                a.load(regs.calleeSaved[i], frameSlot(i), 8);
+            a.leave();
+            a.ret();
+        }
+
+        // Wraps an integer result to the width of its type.
+        void normalize(Reg reg, ValueType type)
+        {
+            if (type == ValueType::Byte || type == ValueType::Bool)
+                a.extend(reg, 8, false);
+            else if (isIntegerValue(type))
+                a.extend(reg, valueBits(type), isSignedValue(type));
+        }
+
+        void storeParams()
+        {
+            std::vector<ArgLocation> locations = classifyArgs(fn.params);
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                {
+                    const Instr &instr = fn.instrs[v];
+                    if (instr.op != Opcode::Param)
+                        continue;
+                    ArgLocation at = locations[instr.imm];
+                    // Allocated registers are never argument registers, so
+                    // integers can go straight to theirs.
+                    Reg reg = regs.reg[v] < 16 && !isFloatValue(instr.type) ? static_cast<Reg>(regs.reg[v]) : Reg::RAX;
+                    if (at.stack)
+                        a.load(reg, {Reg::RBP, static_cast<int32_t>(16 + 8 * at.index)}, 8);
+                    else if (at.sse)
+                    {
+                        Xmm xmm = static_cast<Xmm>(at.index);
+                        if (instr.type == ValueType::F32)
+                            a.sse(SseOp::CvtSs2Sd, xmm, xmm);
+                        a.movq(reg, xmm);
+                    }
+                    else
+                        a.mov(reg, IntArgs[at.index]);
+                    if (at.stack && instr.type == ValueType::F32)
+                    {
+                        a.movq(0, reg);
+                        a.sse(SseOp::CvtSs2Sd, 0, 0);
+                        a.movq(reg, 0);
+                    }
+                    // Callers only guarantee the low bits of narrow integers.
+                    normalize(reg, instr.type);
+                    store(v, reg);
+                }
+        }
+
+        void edgeCopies(BlockId from, BlockId to)
+        {
+            // Values may share a location, so the parallel copy is ordered by
+            // location; constants are written last, as nothing reads them.
+            std::vector<std::pair<uint32_t, uint32_t>> copies;
+            std::vector<std::pair<uint32_t, ValueId>> constants;
+            for (auto [phi, value] : phiCopies(fn, from, to))
+            {
+                uint32_t to = location(phi), from = location(value);
+                if (to == NoValue)
+                    continue;
+                if (from == NoValue)
+                    constants.push_back({to, value});
+                else
+                    copies.push_back({to, from});
+            }
+            for (auto [dst, src] : sequentializeCopies(std::move(copies), ScratchLocation))
+                move(dst, src);
+            for (auto [dst, value] : constants)
+            {
+                Reg reg = dst < 16 ? static_cast<Reg>(dst) : Reg::RAX;
+                load(reg, value);
+                if (dst >= 16)
+                    a.store(locationSlot(dst), reg);
+            }
+        }
+
+        void planVectorLoop(BlockId header)
+        {
+            VectorLoop plan;
+            if (!matchReductionLoop(fn, header, plan.loop))
+                return;
+            const ReductionLoop &loop = plan.loop;
+            for (ValueId v : fn.blocks[header].code)
+                if (fn.instrs[v].op == Opcode::Phi && location(v) == NoValue)
+                    return;
+
+            unsigned next = 2;
+            auto assign = [&](ValueId v)
+            {
+                plan.xmms.push_back({v, static_cast<Xmm>(next++)});
+            };
+            for (const auto &iv : loop.inductions)
+            {
+                assign(iv.phi);
+                plan.steps.push_back(static_cast<Xmm>(next++));
+            }
+            for (const auto &acc : loop.accumulators)
+                assign(acc.phi);
+
+            // Lanes need an operand either computed in the loop or broadcast
+            // from before it.
+            auto use = [&](ValueId v)
+            {
+                if (plan.xmm(v))
+                    return true;
+                const Instr &instr = fn.instrs[v];
+                if (instr.op != Opcode::Const && (instr.block == loop.header || instr.block == loop.latch))
+                    return false;
+                plan.broadcasts.push_back(v);
+                assign(v);
+                return true;
+            };
+            for (ValueId v : fn.blocks[loop.latch].code)
+            {
+                Opcode op = fn.instrs[v].op;
+                if (op == Opcode::Const || op == Opcode::Jump)
+                    continue;
+                bool update = std::any_of(loop.accumulators.begin(), loop.accumulators.end(), [&](const ReductionLoop::Accumulator &acc)
+                                          { return acc.update == v; });
+                bool step = uses[v] == 1 && std::any_of(loop.inductions.begin(), loop.inductions.end(), [&](const ReductionLoop::Induction &iv)
+                                                         { return incoming(iv.phi, loop.latch) == v; });
+                if (update || step)
+                    continue;
+                // A shift amount is a constant of the instruction itself.
+                if (!use(fn.operand(v, 0)) || (op != Opcode::Shl && !use(fn.operand(v, 1))) || next > 16)
+                    return;
+                plan.body.push_back(v);
+                assign(v);
+            }
+            for (const auto &acc : loop.accumulators)
+                if (!use(acc.term))
+                    return;
+            if (next <= 16)
+                vectorLoops.push_back(std::move(plan));
+        }
+
+        ValueId incoming(ValueId phi, BlockId from) const
+        {
+            const ValueId *ops = fn.operands(phi);
+            for (uint16_t i = 0; i < fn.instrs[phi].count; i += 2)
+                if (ops[i + 1] == from)
+                    return ops[i];
+            return NoValue;
+        }
+
+        /** @brief Every lane of dst = rax */
+        void broadcast(Xmm dst)
+        {
+            if (avx2)
+            {
+                a.vmovq(dst, Reg::RAX);
+                a.vbroadcastq(dst, dst);
+                return;
+            }
+            a.movq(dst, Reg::RAX);
+            a.vec(VecOp::UnpackLoQ, dst, dst);
+        }
+
+        void compileVectorLoop(const VectorLoop &plan)
+        {
+            const ReductionLoop &loop = plan.loop;
+            unsigned vex = avx2 ? 256 : 0;
+            uint64_t lanes = avx2 ? 4 : 2;
+            Assembler::Label body = a.newLabel(), skip = a.newLabel();
+
+            // rdx = whole vectors of iterations left. A count that wraps to
+            // zero leaves everything to the scalar loop.
+            load(Reg::RAX, loop.counter);
+            load(Reg::RCX, loop.bound);
+            a.alu(AluOp::Cmp, Reg::RAX, Reg::RCX);
+            a.jcc(invert(comparison(loop.inclusive ? Opcode::Le : Opcode::Lt, loop.isSigned)), skip);
+            a.mov(Reg::RDX, Reg::RCX);
+            a.alu(AluOp::Sub, Reg::RDX, Reg::RAX);
+            if (loop.inclusive)
+                a.alu(AluOp::Add, Reg::RDX, 1);
+            a.shift(ShiftOp::Shr, Reg::RDX, avx2 ? 2 : 1);
+            a.jcc(Cond::E, skip);
+
+            for (ValueId v : plan.broadcasts)
+            {
+                load(Reg::RAX, v);
+                broadcast(plan.xmm(v));
+            }
+            for (size_t i = 0; i < loop.inductions.size(); ++i)
+            {
+                const auto &iv = loop.inductions[i];
+                Xmm dst = plan.xmm(iv.phi);
+                load(Reg::RAX, iv.phi);
+                a.movImm(Reg::RCX, iv.step);
+                if (avx2)
+                {
+                    a.vmovq(dst, Reg::RAX);
+                    a.alu(AluOp::Add, Reg::RAX, Reg::RCX);
+                    a.vmovq(0, Reg::RAX);
+                    a.vec(VecOp::UnpackLoQ, dst, 0, 128);
+                    a.alu(AluOp::Add, Reg::RAX, Reg::RCX);
+                    a.vmovq(0, Reg::RAX);
+                    a.alu(AluOp::Add, Reg::RAX, Reg::RCX);
+                    a.vmovq(1, Reg::RAX);
+                    a.vec(VecOp::UnpackLoQ, 0, 1, 128);
+                    a.vinserti128(dst, 0);
+                }
+                else
+                {
+                    a.movq(dst, Reg::RAX);
+                    a.alu(AluOp::Add, Reg::RAX, Reg::RCX);
+                    a.movq(0, Reg::RAX);
+                    a.vec(VecOp::UnpackLoQ, dst, 0);
+                }
+                a.movImm(Reg::RAX, static_cast<int64_t>(static_cast<uint64_t>(iv.step) * lanes));
+                broadcast(plan.steps[i]);
+
+                // The scalar loop resumes where the vector iterations end.
+                a.imul(Reg::RAX, Reg::RDX);
+                load(Reg::RCX, iv.phi);
+                a.alu(AluOp::Add, Reg::RCX, Reg::RAX);
+                store(iv.phi, Reg::RCX);
+            }
+            for (const auto &acc : loop.accumulators)
+                a.vec(VecOp::SubQ, plan.xmm(acc.phi), plan.xmm(acc.phi), vex);
+
+            a.bind(body);
+            for (ValueId v : plan.body)
+            {
+                const Instr &instr = fn.instrs[v];
+                Xmm dst = plan.xmm(v), x = plan.xmm(fn.operand(v, 0)), y = plan.xmm(fn.operand(v, 1));
+                if (instr.op == Opcode::Mul)
+                {
+                    // There is no 64-bit lane multiply: x * y is
+                    // lo(x) * lo(y) + (hi(x) * lo(y) + lo(x) * hi(y)) << 32.
+                    a.vec(VecOp::Move, 0, x, vex);
+                    a.vecShift(false, 0, 32, vex);
+                    a.vec(VecOp::MulUdq, 0, y, vex);
+                    a.vec(VecOp::Move, 1, y, vex);
+                    a.vecShift(false, 1, 32, vex);
+                    a.vec(VecOp::MulUdq, 1, x, vex);
+                    a.vec(VecOp::AddQ, 0, 1, vex);
+                    a.vecShift(true, 0, 32, vex);
+                    a.vec(VecOp::Move, dst, x, vex);
+                    a.vec(VecOp::MulUdq, dst, y, vex);
+                    a.vec(VecOp::AddQ, dst, 0, vex);
+                    continue;
+                }
+                a.vec(VecOp::Move, dst, x, vex);
+                if (instr.op == Opcode::Shl)
+                {
+                    a.vecShift(true, dst, static_cast<uint8_t>(fn.instrs[fn.operand(v, 1)].imm & 63), vex);
+                    continue;
+                }
+                a.vec(instr.op == Opcode::Add ? VecOp::AddQ : instr.op == Opcode::Sub ? VecOp::SubQ : VecOp::Or, dst, y, vex);
+            }
+            for (const auto &acc : loop.accumulators)
+            {
+                Opcode op = fn.instrs[acc.update].op;
+                a.vec(op == Opcode::Add ? VecOp::AddQ : op == Opcode::Sub ? VecOp::SubQ : VecOp::Or, plan.xmm(acc.phi), plan.xmm(acc.term), vex);
+            }
+            for (size_t i = 0; i < loop.inductions.size(); ++i)
+                a.vec(VecOp::AddQ, plan.xmm(loop.inductions[i].phi), plan.steps[i], vex);
+            a.alu(AluOp::Sub, Reg::RDX, 1);
+            a.jcc(Cond::NE, body);
+
+            // Lanes of a subtracting accumulator hold negated sums, so they
+            // are added up like the others.
+            auto combine = [&](const ReductionLoop::Accumulator &acc)
+            {
+                return fn.instrs[acc.update].op == Opcode::Or ? VecOp::Or : VecOp::AddQ;
+            };
+            if (avx2)
+            {
+                for (const auto &acc : loop.accumulators)
+                {
+                    a.vextracti128(0, plan.xmm(acc.phi));
+                    a.vec(combine(acc), plan.xmm(acc.phi), 0, 128);
+                }
+                a.vzeroupper();
+            }
+            for (const auto &acc : loop.accumulators)
+            {
+                Xmm sum = plan.xmm(acc.phi);
+                a.pshufd(0, sum, 0x4e);
+                a.vec(combine(acc), sum, 0);
+                a.movq(Reg::RCX, sum);
+                load(Reg::RAX, acc.phi);
+                a.alu(combine(acc) == VecOp::Or ? AluOp::Or : AluOp::Add, Reg::RAX, Reg::RCX);
+                store(acc.phi, Reg::RAX);
+            }
+            a.bind(skip);
+        }
+
+        bool hasPhis(BlockId block) const
+        {
+            const auto &list = fn.blocks[block].code;
+            return !list.empty() && fn.instrs[list.front()].op == Opcode::Phi;
+        }
+
+        void compileCompare(ValueId v, const Instr &instr, ValueId next)
+        {
+            ValueId lhs = fn.operand(v, 0), rhs = fn.operand(v, 1);
+            ValueType type = fn.instrs[lhs].type;
+
+            if (type == ValueType::Str)
+            {
+                load(Reg::RDI, lhs);
+                load(Reg::RSI, rhs);
+                callRuntime(RuntimeFunction::Strcmp);
+                a.extend(Reg::RAX, 32, true);
+                a.test(Reg::RAX, Reg::RAX);
+                a.setcc(instr.op == Opcode::Eq ? Cond::E : Cond::NE, Reg::RAX);
+                store(v, Reg::RAX);
+                return;
+            }
+
+            if (isFloatValue(type))
+            {
+                load(Reg::RAX, lhs);
+                load(Reg::RCX, rhs);
+                a.movq(0, Reg::RAX);
+                a.movq(1, Reg::RCX);
+                switch (instr.op)
+                {
+                case Opcode::Eq:
+                case Opcode::Ne:
+                {
+                    // Unordered operands set PF; they compare unequal.
+                    bool eq = instr.op == Opcode::Eq;
+                    a.sse(SseOp::UComISd, 0, 1);
+                    a.setcc(eq ? Cond::E : Cond::NE, Reg::RAX);
+                    a.setcc(eq ? Cond::NP : Cond::P, Reg::RCX);
+                    a.alu(eq ? AluOp::And : AluOp::Or, Reg::RAX, Reg::RCX);
+                    break;
+                }
+                case Opcode::Lt:
+                case Opcode::Le:
+                    a.sse(SseOp::UComISd, 1, 0);
+                    a.setcc(instr.op == Opcode::Lt ? Cond::A : Cond::AE, Reg::RAX);
+                    break;
+                default:
+                    a.sse(SseOp::UComISd, 0, 1);
+                    a.setcc(instr.op == Opcode::Gt ? Cond::A : Cond::AE, Reg::RAX);
+                    break;
+                }
+                store(v, Reg::RAX);
+                return;
+            }
+
+            int32_t imm;
+            if (immediate(rhs, imm))
+                a.alu(AluOp::Cmp, operand(lhs, Reg::RAX), imm);
+            else
+                a.alu(AluOp::Cmp, operand(lhs, Reg::RAX), operand(rhs, Reg::RCX));
+            Cond cond = comparison(instr.op, isSignedValue(type));
+            if (optLevel > 0 && uses[v] == 1 && next != NoValue && fn.instrs[next].op == Opcode::Branch && fn.operand(next, 0) == v)
+            {
+                fused = v;
+                fusedCond = cond;
+                return;
+            }
+            a.setcc(cond, Reg::RAX);
+            store(v, Reg::RAX);
+        }
+
+        /** @brief Whether v is an integer constant that fits a 32-bit immediate */
+        bool immediate(ValueId v, int32_t &imm) const
+        {
+            const Instr &instr = fn.instrs[v];
+            if (instr.op != Opcode::Const || !isIntegerValue(instr.type) || instr.imm < INT32_MIN || instr.imm > INT32_MAX)
+                return false;
+            imm = static_cast<int32_t>(instr.imm);
+            return true;
+        }
+
+        void compileArithmetic(ValueId v, const Instr &instr, ValueId next)
+        {
+            ValueId lhs = fn.operand(v, 0), rhs = fn.operand(v, 1);
+            ValueType type = instr.type;
+
+            if (type == ValueType::Str)
+            {
+                load(Reg::RDI, lhs);
+                load(Reg::RSI, rhs);
+                callRuntime(RuntimeFunction::Concat);
+                store(v, Reg::RAX);
+                return;
+            }
+
+            if (isFloatValue(type))
+            {
+                load(Reg::RAX, lhs);
+                load(Reg::RCX, rhs);
+                static const SseOp ops[] = {SseOp::AddSd, SseOp::SubSd, SseOp::MulSd, SseOp::DivSd};
+                a.movq(0, Reg::RAX);
+                a.movq(1, Reg::RCX);
+                a.sse(ops[static_cast<size_t>(instr.op) - static_cast<size_t>(Opcode::Add)], 0, 1);
+                if (type == ValueType::F32)
+                {
+                    a.sse(SseOp::CvtSd2Ss, 0, 0);
+                    a.sse(SseOp::CvtSs2Sd, 0, 0);
+                }
+                a.movq(Reg::RAX, 0);
+                store(v, Reg::RAX);
+                return;
+            }
+
+            // A shift by up to 3 used only by the addition right after it
+            // becomes the scaled index of an lea.
+            if (optLevel > 0 && instr.op == Opcode::Shl && uses[v] == 1 && fn.instrs[rhs].imm >= 0 && fn.instrs[rhs].imm <= 3 && next != NoValue)
+            {
+                const Instr &add = fn.instrs[next];
+                if (add.op == Opcode::Add && add.type == type && (fn.operand(next, 0) == v) != (fn.operand(next, 1) == v))
+                {
+                    folded = v;
+                    return;
+                }
+            }
+
+            Reg result = compileInteger(v, instr.op, lhs, rhs);
+            normalize(result, type);
+            store(v, result);
+        }
+
+        // Computes an integer operation into the register of its value if it
+        // has one, reading constants as immediates, and returns where the
+        // result is.
+        Reg compileInteger(ValueId v, Opcode op, ValueId lhs, ValueId rhs)
+        {
+            Reg dst = regs.reg[v] < 16 ? static_cast<Reg>(regs.reg[v]) : Reg::RAX;
+            bool commutative = op == Opcode::Add || op == Opcode::Mul || op == Opcode::Or || op == Opcode::And;
+            int32_t imm;
+            if (commutative && (lhs == folded || (immediate(lhs, imm) && rhs != folded)))
+                std::swap(lhs, rhs);
+
+            if (rhs == folded)
+            {
+                ValueId index = fn.operand(folded, 0);
+                uint8_t scale = static_cast<uint8_t>(fn.instrs[fn.operand(folded, 1)].imm);
+                folded = NoValue;
+                Reg base = operand(lhs, Reg::RAX);
+                a.lea(dst, {base, 0, operand(index, Reg::RCX), scale});
+                return dst;
+            }
+
+            switch (op)
+            {
+            case Opcode::Shl:
+            case Opcode::Shr:
+            {
+                ShiftOp shift = op == Opcode::Shl ? ShiftOp::Shl : isSignedValue(fn.instrs[v].type) ? ShiftOp::Sar : ShiftOp::Shr;
+                load(dst, lhs);
+                if (fn.instrs[rhs].op != Opcode::Const)
+                {
+                    load(Reg::RCX, rhs);
+                    a.shift(shift, dst);
+                }
+                else if (fn.instrs[rhs].imm & 63)
+                    a.shift(shift, dst, static_cast<uint8_t>(fn.instrs[rhs].imm & 63));
+                return dst;
+            }
+            case Opcode::MulHigh:
+                load(Reg::RAX, lhs);
+                load(Reg::RDX, rhs);
+                if (isSignedValue(fn.instrs[v].type))
+                    a.imul(Reg::RDX);
+                else
+                    a.mul(Reg::RDX);
+                return Reg::RDX;
+            case Opcode::Div:
+            case Opcode::Rem:
+                return compileDivision(op, isSignedValue(fn.instrs[v].type), lhs, rhs);
+            default:
+                break;
+            }
+
+            if (immediate(rhs, imm))
+            {
+                Reg x = operand(lhs, dst);
+                if (op == Opcode::Mul)
+                {
+                    if (imm == 3 || imm == 5 || imm == 9)
+                        a.lea(dst, {x, 0, x, static_cast<uint8_t>(imm == 3 ? 1 : imm == 5 ? 2 : 3)});
+                    else
+                        a.imul(dst, x, imm);
+                    return dst;
+                }
+                if ((op == Opcode::Add || op == Opcode::Sub) && x != dst && imm != INT32_MIN)
+                {
+                    a.lea(dst, {x, op == Opcode::Add ? imm : -imm});
+                    return dst;
+                }
+                if (x != dst)
+                    a.mov(dst, x);
+                a.alu(aluOp(op), dst, imm);
+                return dst;
+            }
+            if (op == Opcode::Sub && immediate(lhs, imm) && imm == 0)
+            {
+                load(dst, rhs);
+                a.neg(dst);
+                return dst;
+            }
+
+            Reg y = operand(rhs, Reg::RCX);
+            if (y == dst)
+            {
+                if (!commutative)
+                    dst = Reg::RAX;
+                else
+                {
+                    std::swap(lhs, rhs);
+                    y = operand(rhs, Reg::RCX);
+                }
+            }
+            load(dst, lhs);
+            if (op == Opcode::Mul)
+                a.imul(dst, y);
+            else
+                a.alu(aluOp(op), dst, y);
+            return dst;
+        }
+
+        Reg compileDivision(Opcode op, bool isSigned, ValueId lhs, ValueId rhs)
+        {
+            load(Reg::RAX, lhs);
+            load(Reg::RCX, rhs);
+            const Instr &divisor = fn.instrs[rhs];
+            if (divisor.op != Opcode::Const || divisor.imm == 0)
+            {
+                if (!trapUsed)
+                    trap = a.newLabel();
+                trapUsed = true;
+                a.test(Reg::RCX, Reg::RCX);
+                a.jcc(Cond::E, trap);
+            }
+            bool rem = op == Opcode::Rem;
+            if (!isSigned)
+            {
+                a.movImm(Reg::RDX, 0);
+                a.div(Reg::RCX);
+            }
+            else
+            {
+                // idiv faults on the minimum divided by -1; that case
+                // wraps to the negated dividend with no remainder.
+                Assembler::Label divide = a.newLabel(), done = a.newLabel();
+                a.alu(AluOp::Cmp, Reg::RCX, -1);
+                a.jcc(Cond::NE, divide);
+                if (rem)
+                    a.movImm(Reg::RDX, 0);
+                else
+                    a.neg(Reg::RAX);
+                a.jmp(done);
+                a.bind(divide);
+                a.cqo();
+                a.idiv(Reg::RCX);
+                a.bind(done);
+            }
+            return rem ? Reg::RDX : Reg::RAX;
+        }
+
+        void compileCall(ValueId v, const Instr &instr)
+        {
+            const Function &target = module.functions[instr.imm];
+            const ValueId *args = fn.operands(v);
+            std::vector<ArgLocation> locations = classifyArgs(target.params);
+
+            unsigned stackArgs = 0;
+            for (const auto &at : locations)
+                stackArgs += at.stack;
+            int32_t pop = static_cast<int32_t>(8 * (stackArgs + stackArgs % 2));
+            if (stackArgs % 2)
+                a.alu(AluOp::Sub, Reg::RSP, 8);
+            for (size_t i = instr.count; i-- > 0;)
+                if (locations[i].stack)
+                {
+                    load(Reg::RAX, args[i]);
+                    if (target.params[i] == ValueType::F32)
+                    {
+                        a.movq(0, Reg::RAX);
+                        a.sse(SseOp::CvtSd2Ss, 0, 0);
+                        a.movq(Reg::RAX, 0);
+                    }
+                    a.push(Reg::RAX);
+                }
+            for (size_t i = 0; i < instr.count; ++i)
+            {
+                const ArgLocation &at = locations[i];
+                if (at.stack)
+                    continue;
+                if (!at.sse)
+                {
+                    load(IntArgs[at.index], args[i]);
+                    continue;
+                }
+                Xmm xmm = static_cast<Xmm>(at.index);
+                load(Reg::RAX, args[i]);
+                a.movq(xmm, Reg::RAX);
+                if (target.params[i] == ValueType::F32)
+                    a.sse(SseOp::CvtSd2Ss, xmm, xmm);
+            }
+
+            if (instr.op == Opcode::Call)
+                relocate(a.call(), NativeTarget::Function, static_cast<uint32_t>(instr.imm));
+            else
+            {
+                // The receiver is the first argument, already in rdi.
+                const IRClass &cls = module.classes[target.classIndex];
+                a.load(Reg::RAX, {Reg::RDI, static_cast<int32_t>(cls.vptrOffset)}, 8);
+                a.load(Reg::RAX, {Reg::RAX, target.vtableSlot * 8}, 8);
+                a.call(Reg::RAX);
+            }
+            if (pop)
+                a.alu(AluOp::Add, Reg::RSP, pop);
+
+            if (instr.type == ValueType::Void)
+                return;
+            if (isFloatValue(instr.type))
+            {
+                if (instr.type == ValueType::F32)
+                    a.sse(SseOp::CvtSs2Sd, 0, 0);
+                a.movq(Reg::RAX, 0);
+            }
+            store(v, Reg::RAX);
+        }
+
+        void compileBranch(BlockId block, ValueId v, const Instr &instr)
+        {
+            uint64_t targets = static_cast<uint64_t>(instr.imm);
+            BlockId onTrue = static_cast<BlockId>(targets & 0xffffffff), onFalse = static_cast<BlockId>(targets >> 32);
+
+            Cond cond = fusedCond;
+            if (fn.operand(v, 0) != fused)
+            {
+                Reg condition = operand(fn.operand(v, 0), Reg::RAX);
+                a.test(condition, condition);
+                cond = Cond::NE;
+            }
+            fused = NoValue;
+
+            if (!hasPhis(onTrue) && !hasPhis(onFalse))
+            {
+                if (onTrue == block + 1)
+                    a.jcc(invert(cond), blockLabels[onFalse]);
+                else
+                {
+                    a.jcc(cond, blockLabels[onTrue]);
+                    if (onFalse != block + 1)
+                        a.jmp(blockLabels[onFalse]);
+                }
+                return;
+            }
+
+            Assembler::Label falseEdge = a.newLabel();
+            a.jcc(invert(cond), falseEdge);
+            edgeCopies(block, onTrue);
+            a.jmp(blockLabels[onTrue]);
+            a.bind(falseEdge);
+            edgeCopies(block, onFalse);
+            if (onFalse != block + 1)
+                a.jmp(blockLabels[onFalse]);
+        }
+
+        // Out-of-range values go to the default; the others index a table of
+        // 32-bit offsets from its own start, placed after the indirect jump.
+        void compileSwitch(BlockId block, ValueId v, const Instr &instr)
+        {
+            const SwitchTable &table = fn.switches[instr.imm];
+            std::vector<BlockId> targets = successors(fn, v);
+            std::vector<Assembler::Label> labels;
+            for (BlockId target : targets)
+                labels.push_back(hasPhis(target) ? a.newLabel() : blockLabels[target]);
+            auto label = [&](BlockId target)
+            { return labels[std::find(targets.begin(), targets.end(), target) - targets.begin()]; };
+
+            load(Reg::RAX, fn.operand(v, 0));
+            if (table.low >= INT32_MIN && table.low <= INT32_MAX)
+            {
+                if (table.low)
+                    a.alu(AluOp::Sub, Reg::RAX, static_cast<int32_t>(table.low));
+            }
+            else
+            {
+                a.movImm(Reg::RCX, table.low);
+                a.alu(AluOp::Sub, Reg::RAX, Reg::RCX);
+            }
+            a.alu(AluOp::Cmp, Reg::RAX, static_cast<int32_t>(table.targets.size()));
+            a.jcc(Cond::AE, label(table.otherwise));
+            size_t base = a.leaRip(Reg::RCX);
+            a.load(Reg::RAX, {Reg::RCX, 0, Reg::RAX, 2}, 4, true);
+            a.alu(AluOp::Add, Reg::RAX, Reg::RCX);
+            a.jmp(Reg::RAX);
+
+            a.align(4);
+            int32_t displacement = static_cast<int32_t>(a.size() - (base + 4));
+            std::memcpy(&a.bytes[base], &displacement, sizeof(displacement));
+            size_t start = a.size();
+            for (BlockId target : table.targets)
+            {
+                tableEntries.push_back({a.size(), start, label(target)});
+                a.bytes.insert(a.bytes.end(), 4, 0);
+            }
+
+            // Targets with phis are reached through stubs doing the copies.
+            for (size_t i = 0; i < targets.size(); ++i)
+                if (hasPhis(targets[i]))
+                {
+                    a.bind(labels[i]);
+                    edgeCopies(block, targets[i]);
+                    a.jmp(blockLabels[targets[i]]);
+                }
+        }
+
+        // FNV-1a over the bytes up to the terminating zero.
+        void compileHash(ValueId v, const Instr &instr)
+        {
+            Assembler::Label loop = a.newLabel(), done = a.newLabel();
+            load(Reg::RCX, fn.operand(v, 0));
+            a.movImm(Reg::RAX, instr.imm);
+            a.bind(loop);
+            a.load(Reg::RDX, {Reg::RCX, 0}, 1);
+            a.test(Reg::RDX, Reg::RDX);
+            a.jcc(Cond::E, done);
+            a.alu(AluOp::Xor, Reg::RAX, Reg::RDX);
+            a.movImm(Reg::RDX, 0x100000001b3);
+            a.imul(Reg::RAX, Reg::RDX);
+            a.alu(AluOp::Add, Reg::RCX, 1);
+            a.jmp(loop);
+            a.bind(done);
+            store(v, Reg::RAX);
+        }
+
+        void compileInstr(BlockId block, ValueId v, ValueId next)
+        {
+            // A call's result never lands in a register saved around it, so
+            // restoring after the result is stored is safe.
+            saveAcross(v, false);
+            compileOperation(block, v, next);
+            saveAcross(v, true);
+        }
+
+        void compileOperation(BlockId block, ValueId v, ValueId next)
+        {
+            const Instr &instr = fn.instrs[v];
+            const ValueId *ops = fn.operands(v);
+            switch (instr.op)
+            {
+            case Opcode::Nop:
+            case Opcode::Undef:
+            case Opcode::Const:
+            case Opcode::Param:
+            case Opcode::Phi:
+                break;
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Rem:
+            case Opcode::Or:
+            case Opcode::And:
+            case Opcode::Shl:
+            case Opcode::Shr:
+            case Opcode::MulHigh:
+                compileArithmetic(v, instr, next);
+                break;
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+                compileCompare(v, instr, next);
+                break;
+            case Opcode::Call:
+            case Opcode::CallVirtual:
+                compileCall(v, instr);
+                break;
+            case Opcode::New:
+            {
+                const IRClass &cls = module.classes[instr.imm];
+                a.movImm(Reg::RDI, 1);
+                a.movImm(Reg::RSI, static_cast<int64_t>(std::max<uint64_t>(cls.size, 1)));
+                callRuntime(RuntimeFunction::Calloc);
+                if (cls.hasVptr)
+                {
+                    relocate(a.leaRip(Reg::RCX), NativeTarget::Vtable, static_cast<uint32_t>(instr.imm));
+                    a.store({Reg::RAX, static_cast<int32_t>(cls.vptrOffset)}, Reg::RCX);
+                }
+                store(v, Reg::RAX);
+                break;
+            }
+            case Opcode::NewLocal:
+            {
+                const IRClass &cls = module.classes[instr.imm];
+                Mem object = frameSlot(objectSlots[v]);
+                a.movImm(Reg::RAX, 0);
+                for (uint64_t word = 0; word < std::max<uint64_t>(1, (cls.size + 7) / 8); ++word)
+                    a.store({Reg::RBP, object.disp + static_cast<int32_t>(8 * word)}, Reg::RAX);
+                a.lea(Reg::RAX, object);
+                if (cls.hasVptr)
+                {
+                    relocate(a.leaRip(Reg::RCX), NativeTarget::Vtable, static_cast<uint32_t>(instr.imm));
+                    a.store({Reg::RAX, static_cast<int32_t>(cls.vptrOffset)}, Reg::RCX);
+                }
+                store(v, Reg::RAX);
+                break;
+            }
+            case Opcode::LoadGlobal:
+                relocate(a.loadRip(Reg::RAX), NativeTarget::Global, static_cast<uint32_t>(instr.imm));
+                store(v, Reg::RAX);
+                break;
+            case Opcode::StoreGlobal:
+                load(Reg::RAX, ops[0]);
+                relocate(a.storeRip(Reg::RAX), NativeTarget::Global, static_cast<uint32_t>(instr.imm));
+                break;
+            case Opcode::LoadField:
+            {
+                Mem field{Reg::RAX, static_cast<int32_t>(instr.imm)};
+                load(Reg::RAX, ops[0]);
+                if (instr.type == ValueType::F32)
+                {
+                    a.loadFloat(0, field);
+                    a.sse(SseOp::CvtSs2Sd, 0, 0);
+                    a.movq(Reg::RAX, 0);
+                }
+                else
+                    a.load(Reg::RAX, field, fieldBytes(instr.type), isSignedValue(instr.type));
+                store(v, Reg::RAX);
+                break;
+            }
+            case Opcode::StoreField:
+            {
+                Mem field{Reg::RAX, static_cast<int32_t>(instr.imm)};
+                ValueType type = fn.instrs[ops[1]].type;
+                load(Reg::RAX, ops[0]);
+                load(Reg::RCX, ops[1]);
+                if (type == ValueType::F32)
+                {
+                    a.movq(0, Reg::RCX);
+                    a.sse(SseOp::CvtSd2Ss, 0, 0);
+                    a.storeFloat(field, 0);
+                }
+                else
+                    a.store(field, Reg::RCX, fieldBytes(type));
+                break;
+            }
+            case Opcode::Jump:
+            {
+                BlockId target = static_cast<BlockId>(instr.imm);
+                edgeCopies(block, target);
+                for (const auto &plan : vectorLoops)
+                    if (plan.loop.preheader == block && plan.loop.header == target)
+                        compileVectorLoop(plan);
+                if (target != block + 1)
+                    a.jmp(blockLabels[target]);
+                break;
+            }
+            case Opcode::Branch:
+                compileBranch(block, v, instr);
+                break;
+            case Opcode::Switch:
+                compileSwitch(block, v, instr);
+                break;
+            case Opcode::Hash:
+                compileHash(v, instr);
+                break;
+            case Opcode::Return:
+                if (instr.count)
+                {
+                    load(Reg::RAX, ops[0]);
+                    if (isFloatValue(fn.returnType))
+                    {
+                        a.movq(0, Reg::RAX);
+                        if (fn.returnType == ValueType::F32)
+                            a.sse(SseOp::CvtSd2Ss, 0, 0);
+                    }
+                }
+                epilogue();
+                break;
+            }
+        }
+    };
+
+    void append(ElfObject &object, const NativeFunction &fn, const std::vector<uint32_t> &functionSymbols,
+                std::vector<uint32_t> &runtimeSymbols, const std::vector<uint64_t> &globalOffsets, const std::vector<uint64_t> &stringOffsets,
+                const std::vector<uint64_t> &vtableOffsets)
+    {
+        std::vector<uint8_t> &text = object.contents(ElfObject::Text);
+        uint64_t base = text.size();
+        text.insert(text.end(), fn.code.begin(), fn.code.end());
+
+        for (const auto &reloc : fn.relocations)
+        {
+            uint64_t at = base + reloc.offset;
+            switch (reloc.target)
+            {
+            case NativeTarget::Function:
+                object.relocate(ElfObject::Text, at, functionSymbols[reloc.index], ElfReloc::PLT32, -4);
+                break;
+            case NativeTarget::Runtime:
+            {
+                // The helpers are emitted into the object once something needs them.
+                auto function = static_cast<RuntimeFunction>(reloc.index);
+                uint32_t &symbol = runtimeSymbols[reloc.index];
+                bool helper = function == RuntimeFunction::Concat || function == RuntimeFunction::Trap;
+                if (!symbol)
+                    symbol = helper ? object.defineSymbol(runtimeName(function), ElfObject::Text, 0, 0, false, true)
+                                    : object.externalSymbol(runtimeName(function));
+                object.relocate(ElfObject::Text, at, symbol, ElfReloc::PLT32, -4);
+                break;
+            }
+            case NativeTarget::Global:
+                object.relocate(ElfObject::Text, at, object.sectionSymbol(ElfObject::Data), ElfReloc::PC32, static_cast<int64_t>(globalOffsets[reloc.index]) - 4);
+                break;
+            case NativeTarget::String:
+                object.relocate(ElfObject::Text, at, object.sectionSymbol(ElfObject::Rodata), ElfReloc::PC32, static_cast<int64_t>(stringOffsets[reloc.index]) - 4);
+                break;
+            case NativeTarget::Vtable:
+                object.relocate(ElfObject::Text, at, object.sectionSymbol(ElfObject::Data), ElfReloc::PC32, static_cast<int64_t>(vtableOffsets[reloc.index]) - 4);
+                break;
+            }
+        }
+    }
+}
+
+const char *runtimeName(RuntimeFunction function)
+{
+    static const char *const names[] = {"calloc", "strcmp", "strlen", "malloc", "strcpy", "strcat", "vsharp_concat", "vsharp_trap"};
+    return names[static_cast<size_t>(function)];
+}
+
+std::string nativeSymbol(const Function &fn)
+{
+    return "vs." + fn.name;
+}
+
+NativeFunction compileX86(const Module &module, const Function &fn, unsigned optLevel, bool avx2)
+{
+    if (optLevel == 0)
+        return X86FunctionCompiler(module, fn, optLevel, avx2).compile();
+    // The VM may run the same IR, and there one division is cheaper than
+    // the instructions replacing it, so only this copy is reduced.
+    Function reduced = fn;
+    reduceStrength(reduced);
+    return X86FunctionCompiler(module, reduced, optLevel, avx2).compile();
+}
+
+NativeFunction concatHelperX86()
+{
+    NativeFunction out;
+    Assembler a;
+    auto call = [&](RuntimeFunction function)
+    {
+        out.relocations.push_back({static_cast<uint32_t>(a.call()), NativeTarget::Runtime, static_cast<uint32_t>(function)});
+    };
+
+    // Three pushes leave the stack 16-byte aligned for the calls.
+    a.push(Reg::RBX);
+    a.push(Reg::R12);
+    a.push(Reg::R13);
+    a.mov(Reg::RBX, Reg::RDI);
+    a.mov(Reg::R12, Reg::RSI);
+    call(RuntimeFunction::Strlen);
+    a.mov(Reg::R13, Reg::RAX);
+    a.mov(Reg::RDI, Reg::R12);
+    call(RuntimeFunction::Strlen);
+    a.alu(AluOp::Add, Reg::RAX, Reg::R13);
+    a.lea(Reg::RDI, {Reg::RAX, 1});
+    call(RuntimeFunction::Malloc);
+    a.mov(Reg::RDI, Reg::RAX);
+    a.mov(Reg::RSI, Reg::RBX);
+    call(RuntimeFunction::Strcpy);
+    a.mov(Reg::RDI, Reg::RAX);
+    a.mov(Reg::RSI, Reg::R12);
+    call(RuntimeFunction::Strcat);
+    a.pop(Reg::R13);
+    a.pop(Reg::R12);
+    a.pop(Reg::RBX);
+    a.ret();
+
+    out.code = std::move(a.bytes);
+    return out;
+}
+
+NativeFunction trapHelperX86()
+{
+    // The divide faults as the unguarded one would have.
+    NativeFunction out;
+    Assembler a;
+    a.movImm(Reg::RCX, 0);
+    a.div(Reg::RCX);
+    a.ret();
+    out.code = std::move(a.bytes);
+    return out;
+}
+
+ElfObject emitObject(const Module &module, unsigned optLevel, bool avx2)
+{
+    ElfObject object;
+
+    std::vector<uint8_t> &rodata = object.contents(ElfObject::Rodata);
+    std::vector<uint64_t> stringOffsets;
+    for (const auto &str : module.strings)
+    {
+        stringOffsets.push_back(rodata.size());
+        rodata.insert(rodata.end(), str.begin(), str.end());
+        rodata.push_back(0);
+    }
+
+    std::vector<uint8_t> &data = object.contents(ElfObject::Data);
+    std::vector<uint64_t> globalOffsets, vtableOffsets;
+    for (const auto &global : module.globals)
+    {
+        globalOffsets.push_back(data.size());
+        uint64_t value = static_cast<uint64_t>(global.init);
+        if (global.type == ValueType::Str)
+        {
+            object.relocate(ElfObject::Data, data.size(), object.sectionSymbol(ElfObject::Rodata), ElfReloc::Abs64, static_cast<int64_t>(stringOffsets[value]));
+            value = 0;
+        }
+        for (int i = 0; i < 8; ++i)
+            data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    // Every function symbol exists before any code refers to it.
+    std::vector<uint32_t> functionSymbols;
+    for (const auto &fn : module.functions)
+        functionSymbols.push_back(object.defineSymbol(nativeSymbol(fn), ElfObject::Text, 0, 0, true, true));
+
+    for (const auto &cls : module.classes)
+    {
+        vtableOffsets.push_back(data.size());
+        for (uint32_t method : cls.vtable)
+        {
+            object.relocate(ElfObject::Data, data.size(), functionSymbols[method], ElfReloc::Abs64, 0);
+            data.insert(data.end(), 8, 0);
+        }
+        if (!cls.vtable.empty())
+            object.defineSymbol("vs.vtable." + cls.name, ElfObject::Data, vtableOffsets.back(), 8 * cls.vtable.size(), false, false);
+    }
+
+    std::vector<uint32_t> runtimeSymbols(static_cast<size_t>(RuntimeFunction::Trap) + 1, 0);
+    std::vector<uint8_t> &text = object.contents(ElfObject::Text);
+    auto place = [&](const NativeFunction &fn, uint32_t symbol)
+    {
+        while (text.size() % 16)
+            text.push_back(0xcc);
+        uint64_t start = text.size();
+        append(object, fn, functionSymbols, runtimeSymbols, globalOffsets, stringOffsets, vtableOffsets);
+        object.placeSymbol(symbol, start, text.size() - start);
+    };
+
+    for (size_t i = 0; i < module.functions.size(); ++i)
+        place(compileX86(module, module.functions[i], optLevel, avx2), functionSymbols[i]);
+    if (uint32_t concat = runtimeSymbols[static_cast<size_t>(RuntimeFunction::Concat)])
+        place(concatHelperX86(), concat);
+    if (uint32_t trap = runtimeSymbols[static_cast<size_t>(RuntimeFunction::Trap)])
+        place(trapHelperX86(), trap);
+
+    if (module.entry >= 0)
+    {
+        const Function &entry = module.functions[module.entry];
+        Assembler a;
+        NativeFunction main;
+        a.push(Reg::RBP);
+        a.mov(Reg::RBP, Reg::RSP);
+        main.relocations.push_back({static_cast<uint32_t>(a.call()), NativeTarget::Function, module.initializer});
+        main.relocations.push_back({static_cast<uint32_t>(a.call()), NativeTarget::Function, static_cast<uint32_t>(module.entry)});
+        if (!isIntegerValue(entry.returnType))
+            a.movImm(Reg::RAX, 0);
+        a.pop(Reg::RBP);
+        a.ret();
+        main.code = std::move(a.bytes);
+        place(main, object.defineSymbol("main", ElfObject::Text, 0, 0, true, true));
+    }
+    return object;
+}
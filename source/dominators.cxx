@@ -0,0 +1,95 @@
+#include <dominators.hxx>
+
+void DominatorTree::compute(const Function &fn)
+{
+    size_t n = fn.blocks.size();
+    idom.assign(n, NoBlock);
+    order.assign(n, UINT32_MAX);
+    children.assign(n, {});
+    enter.assign(n, 0);
+    exit.assign(n, 0);
+    rpo.clear();
+    if (n == 0)
+        return;
+
+    // Iterative post-order DFS from the entry.
+    std::vector<BlockId> post;
+    std::vector<std::pair<BlockId, size_t>> stack{{0, 0}};
+    std::vector<bool> seen(n, false);
+    seen[0] = true;
+    while (!stack.empty())
+    {
+        auto &[block, next] = stack.back();
+        const auto &succs = fn.blocks[block].succs;
+        if (next < succs.size())
+        {
+            BlockId succ = succs[next++];
+            if (!seen[succ])
+            {
+                seen[succ] = true;
+                stack.push_back({succ, 0});
+            }
+            continue;
+        }
+        post.push_back(block);
+        stack.pop_back();
+    }
+    rpo.assign(post.rbegin(), post.rend());
+    for (uint32_t i = 0; i < rpo.size(); ++i)
+        order[rpo[i]] = i;
+
+    auto intersect = [this](BlockId a, BlockId b)
+    {
+        while (a != b)
+        {
+            while (order[a] > order[b])
+                a = idom[a];
+            while (order[b] > order[a])
+                b = idom[b];
+        }
+        return a;
+    };
+
+    idom[0] = 0;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); ++i)
+        {
+            BlockId block = rpo[i];
+            BlockId dom = NoBlock;
+            for (BlockId pred : fn.blocks[block].preds)
+            {
+                if (idom[pred] == NoBlock)
+                    continue;
+                dom = dom == NoBlock ? pred : intersect(pred, dom);
+            }
+            if (dom != idom[block])
+            {
+                idom[block] = dom;
+                changed = true;
+            }
+        }
+    }
+    idom[0] = NoBlock;
+
+    for (size_t i = 1; i < rpo.size(); ++i)
+        children[idom[rpo[i]]].push_back(rpo[i]);
+
+    uint32_t clock = 0;
+    std::vector<std::pair<BlockId, size_t>> walk{{0, 0}};
+    enter[0] = clock++;
+    while (!walk.empty())
+    {
+        auto &[block, next] = walk.back();
+        if (next < children[block].size())
+        {
+            BlockId child = children[block][next++];
+            enter[child] = clock++;
+            walk.push_back({child, 0});
+            continue;
+        }
+        exit[block] = clock++;
+        walk.pop_back();
+    }
+}
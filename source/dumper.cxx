@@ -0,0 +1,1105 @@
+#include <charconv>
+#include <cmath>
+#include <vector>
+#include <dumper.hxx>
+#include <string.hxx>
+#include <visitor.hxx>
+
+OutputBuffer::OutputBuffer(std::FILE *out, size_t capacity)
+    : out(out), data(new char[capacity]), capacity(capacity) {}
+
+OutputBuffer::~OutputBuffer()
+{
+    flush();
+}
+
+void OutputBuffer::writeSlow(std::string_view text)
+{
+    flush();
+    if (text.size() > capacity)
+    {
+        std::fwrite(text.data(), 1, text.size(), out);
+        return;
+    }
+    std::memcpy(data.get() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void OutputBuffer::indent(size_t n)
+{
+    static const std::string spaces(256, ' ');
+    while (n > spaces.size())
+    {
+        write(spaces);
+        n -= spaces.size();
+    }
+    write(std::string_view(spaces.data(), n));
+}
+
+void OutputBuffer::integer(int64_t value)
+{
+    char tmp[24];
+    auto result = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    write(std::string_view(tmp, result.ptr - tmp));
+}
+
+void OutputBuffer::unsignedInteger(uint64_t value)
+{
+    char tmp[24];
+    auto result = std::to_chars(tmp, tmp + sizeof(tmp), value);
+    write(std::string_view(tmp, result.ptr - tmp));
+}
+
+void OutputBuffer::floating(double value, int precision)
+{
+    char tmp[40];
+    int n = std::snprintf(tmp, sizeof(tmp), "%.*g", precision, value);
+    write(std::string_view(tmp, n));
+}
+
+void OutputBuffer::flush()
+{
+    if (used)
+        std::fwrite(data.get(), 1, used, out);
+    used = 0;
+    std::fflush(out);
+}
+
+namespace
+{
+    // The nodes down the left spine of an operator chain, outermost first.
+    std::vector<const BinaryExprNode *> leftSpine(const BinaryExprNode *bin)
+    {
+        std::vector<const BinaryExprNode *> spine{bin};
+        while (spine.back()->left->type == ASTNodeType::BinaryExpr)
+            spine.push_back(static_cast<const BinaryExprNode *>(spine.back()->left.get()));
+        return spine;
+    }
+
+    struct TextWriter : ASTVisitor<TextWriter>
+    {
+        OutputBuffer &out;
+        size_t level;
+
+        TextWriter(OutputBuffer &out, size_t level) : out(out), level(level) {}
+
+        void line(std::string_view text, size_t extra = 0)
+        {
+            out.indent(level + extra);
+            out.write(text);
+        }
+
+        void nested(const ASTNode *node, size_t extra)
+        {
+            level += extra;
+            visit(node);
+            level -= extra;
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            line("Block\n");
+            for (const auto &child : blk->children)
+                nested(child.get(), 2);
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            line("Literal: ");
+            std::visit([this](const auto &v)
+                       {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, bool>)
+                    out.write(v ? "true" : "false");
+                else if constexpr (std::is_same_v<T, char>)
+                {
+                    out.put('\'');
+                    switch (v)
+                    {
+                    case '\n': out.write("\\n"); break;
+                    case '\t': out.write("\\t"); break;
+                    case '\r': out.write("\\r"); break;
+                    case '\\': out.write("\\\\"); break;
+                    case '\'': out.write("\\'"); break;
+                    default:   out.put(v);
+                    }
+                    out.put('\'');
+                }
+                else if constexpr (std::is_same_v<T, std::string>)
+                    out.write(v);
+                else if constexpr (std::is_floating_point_v<T>)
+                    out.floating(v, 6);
+                else if constexpr (std::is_same_v<T, int8_t> || std::is_same_v<T, uint8_t>)
+                    out.put(static_cast<char>(v));
+                else if constexpr (std::is_signed_v<T>)
+                    out.integer(v);
+                else
+                    out.unsignedInteger(v); }, lit->value);
+            out.put('\n');
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            line("Identifier: ");
+            out.write(id->name);
+            out.put('\n');
+        }
+
+        // Printed nested as in the tree, but the left spine is walked with
+        // a loop: spine node i sits 2 * i deeper than the chain, and its
+        // right operand one level below it.
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            std::vector<const BinaryExprNode *> spine = leftSpine(bin);
+            for (size_t i = 0; i < spine.size(); ++i)
+            {
+                line("BinaryExpr '", 2 * i);
+                out.write(spine[i]->op);
+                out.write("'\n");
+            }
+            nested(spine.back()->left.get(), 2 * spine.size());
+            for (size_t i = spine.size(); i-- > 0;)
+                nested(spine[i]->right.get(), 2 * (i + 1));
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            line("FunctionDecl ");
+            out.write(fn->name);
+            out.write(" [");
+            out.write(toString_Access(fn->access));
+            out.write("] -> ");
+            out.write(toString_Type(fn->returnType));
+            for (const auto &attribute : fn->attributes)
+            {
+                out.write(" @");
+                out.write(attribute);
+            }
+            out.put('\n');
+
+            line("Params:\n", 2);
+            for (auto &p : fn->params)
+            {
+                line(toString_Type(p.first), 4);
+                out.put(' ');
+                out.write(p.second);
+                out.put('\n');
+            }
+
+            line("Body:\n", 2);
+            nested(fn->body.get(), 4);
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            line("ReturnExpr\n");
+            nested(ret->expr.get(), 2);
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            line(var->isConst ? "ConstDecl " : "VarDecl ");
+            out.write(var->name);
+            out.write(" : ");
+            out.write(toString_Type(var->varType));
+            out.write(" [");
+            out.write(toString_Access(var->access));
+            out.write("]\n");
+
+            if (var->value)
+            {
+                line("Initializer:\n", 2);
+                nested(var->value.get(), 4);
+            }
+        }
+
+        // An `else if` arm is printed 4 deeper than the one before, under its
+        // Else:, but the chain is followed with a loop.
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            size_t outer = level;
+            for (;;)
+            {
+                line("IfExpr\n");
+                line("Condition:\n", 2);
+                nested(ifn->condition.get(), 4);
+                line("Then:\n", 2);
+                nested(ifn->thenBranch.get(), 4);
+                const ASTNode *next = ifn->elseBranch.get();
+                if (!next)
+                    break;
+                line("Else:\n", 2);
+                level += 4;
+                if (next->type != ASTNodeType::IfExpr)
+                {
+                    visit(next);
+                    break;
+                }
+                ifn = static_cast<const IfExprNode *>(next);
+            }
+            level = outer;
+        }
+
+        void visitForExpr(const ForExprNode *loop)
+        {
+            line("ForExpr\n");
+            if (loop->init)
+            {
+                line("Init:\n", 2);
+                nested(loop->init.get(), 4);
+            }
+            if (loop->condition)
+            {
+                line("Condition:\n", 2);
+                nested(loop->condition.get(), 4);
+            }
+            if (loop->step)
+            {
+                line("Step:\n", 2);
+                nested(loop->step.get(), 4);
+            }
+            line("Body:\n", 2);
+            nested(loop->body.get(), 4);
+        }
+
+        void visitMatchExpr(const MatchExprNode *match)
+        {
+            line("MatchExpr\n");
+            line("Subject:\n", 2);
+            nested(match->subject.get(), 4);
+            for (const auto &arm : match->arms)
+            {
+                line("Arm:\n", 2);
+                for (const auto &pattern : arm.patterns)
+                    nested(pattern.get(), 4);
+                nested(arm.body.get(), 4);
+            }
+            if (match->otherwise)
+            {
+                line("Else:\n", 2);
+                nested(match->otherwise.get(), 4);
+            }
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            line("AssignExpr ");
+            out.write(as->name);
+            out.put('\n');
+            nested(as->value.get(), 2);
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            line(cls->isStructure ? "StructureDecl " : "ClassDecl ");
+            out.write(cls->name);
+            if (!cls->baseName.empty())
+            {
+                out.write(" : ");
+                out.write(cls->baseName);
+            }
+            out.write(" [");
+            out.write(toString_Access(cls->access));
+            out.write("]");
+            for (const auto &attribute : cls->attributes)
+            {
+                out.write(" @");
+                out.write(attribute);
+            }
+            out.put('\n');
+            line("Body:\n", 2);
+            nested(cls->body.get(), 4);
+        }
+
+        // Each call of a member-call chain is printed 4 deeper than the one
+        // it is the receiver of; the chain is followed with a loop and the
+        // arguments are printed on the way back out.
+        void visitCallExpr(const CallExprNode *call)
+        {
+            std::vector<const CallExprNode *> chain{call};
+            size_t outer = level;
+            for (;;)
+            {
+                line("CallExpr ");
+                out.write(call->name);
+                if (call->dispatch != DispatchKind::Static)
+                {
+                    out.write(" [");
+                    out.write(toString_Dispatch(call->dispatch));
+                    out.put(']');
+                }
+                out.put('\n');
+                if (!call->receiver)
+                    break;
+                line("Receiver:\n", 2);
+                level += 4;
+                if (call->receiver->type != ASTNodeType::FunctionCall)
+                {
+                    visit(call->receiver.get());
+                    break;
+                }
+                call = static_cast<const CallExprNode *>(call->receiver.get());
+                chain.push_back(call);
+            }
+            for (size_t i = chain.size(); i-- > 0;)
+            {
+                level = outer + 4 * i;
+                if (!chain[i]->args.empty())
+                {
+                    line("Args:\n", 2);
+                    for (auto &arg : chain[i]->args)
+                        nested(arg.get(), 4);
+                }
+            }
+            level = outer;
+        }
+
+        void visitSharedExpr(const SharedExprNode *shared)
+        {
+            static const char digits[] = "0123456789abcdef";
+            line("SharedExpr #");
+            size_t h = shared->hash & 0xffff;
+            bool leading = true;
+            for (int shift = 12; shift >= 0; shift -= 4)
+            {
+                size_t d = (h >> shift) & 0xf;
+                if (d == 0 && leading && shift != 0)
+                    continue;
+                leading = false;
+                out.put(digits[d]);
+            }
+            out.put('\n');
+            nested(shared->target.get(), 2);
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            line("UnknownNode\n");
+        }
+    };
+
+    void jsonString(OutputBuffer &out, std::string_view text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out.put('"');
+        size_t run = 0;
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            char c = text[i];
+            if (c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20)
+                continue;
+
+            out.write(text.substr(run, i - run));
+            run = i + 1;
+            switch (c)
+            {
+            case '"':
+                out.write("\\\"");
+                break;
+            case '\\':
+                out.write("\\\\");
+                break;
+            case '\n':
+                out.write("\\n");
+                break;
+            case '\t':
+                out.write("\\t");
+                break;
+            case '\r':
+                out.write("\\r");
+                break;
+            default:
+                out.write("\\u00");
+                out.put(hex[(c >> 4) & 0xf]);
+                out.put(hex[c & 0xf]);
+            }
+        }
+        out.write(text.substr(run));
+        out.put('"');
+    }
+
+    struct JsonWriter : ASTVisitor<JsonWriter>
+    {
+        OutputBuffer &out;
+
+        explicit JsonWriter(OutputBuffer &out) : out(out) {}
+
+        void open(std::string_view kind)
+        {
+            out.write("{\"kind\":\"");
+            out.write(kind);
+            out.put('"');
+        }
+
+        void key(std::string_view name)
+        {
+            out.write(",\"");
+            out.write(name);
+            out.write("\":");
+        }
+
+        void field(std::string_view name, std::string_view value)
+        {
+            key(name);
+            jsonString(out, value);
+        }
+
+        void child(std::string_view name, const ASTNode *node)
+        {
+            key(name);
+            if (node)
+                visit(node);
+            else
+                out.write("null");
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            open("Block");
+            key("children");
+            out.put('[');
+            bool first = true;
+            for (const auto &c : blk->children)
+            {
+                if (!first)
+                    out.put(',');
+                first = false;
+                visit(c.get());
+            }
+            out.write("]}");
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            open("Literal");
+            field("type", toString_Type(lit->literalType));
+            key("value");
+            std::visit([this](const auto &v)
+                       {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, bool>)
+                    out.write(v ? "true" : "false");
+                else if constexpr (std::is_same_v<T, char>)
+                    jsonString(out, std::string_view(&v, 1));
+                else if constexpr (std::is_same_v<T, std::string>)
+                    jsonString(out, v);
+                else if constexpr (std::is_floating_point_v<T>)
+                {
+                    if (std::isfinite(v))
+                        out.floating(v, 17);
+                    else
+                        out.write("null");
+                }
+                else if constexpr (std::is_signed_v<T>)
+                    out.integer(v);
+                else
+                    out.unsignedInteger(v); }, lit->value);
+            out.put('}');
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            open("Identifier");
+            field("name", id->name);
+            out.put('}');
+        }
+
+        // Nested as in the tree, but opened down the left spine with a loop.
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            std::vector<const BinaryExprNode *> spine = leftSpine(bin);
+            for (const BinaryExprNode *node : spine)
+            {
+                open("BinaryExpr");
+                field("op", node->op);
+                key("left");
+            }
+            visit(spine.back()->left.get());
+            for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+            {
+                child("right", (*it)->right.get());
+                out.put('}');
+            }
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            open("FunctionDecl");
+            field("name", fn->name);
+            field("access", toString_Access(fn->access));
+            field("modifier", toString_Modifier(fn->modifier));
+            field("returnType", toString_Type(fn->returnType));
+            if (!fn->attributes.empty())
+            {
+                key("attributes");
+                out.put('[');
+                for (size_t i = 0; i < fn->attributes.size(); ++i)
+                {
+                    if (i)
+                        out.put(',');
+                    jsonString(out, fn->attributes[i]);
+                }
+                out.put(']');
+            }
+            key("params");
+            out.put('[');
+            for (size_t i = 0; i < fn->params.size(); ++i)
+            {
+                if (i)
+                    out.put(',');
+                out.write("{\"type\":");
+                jsonString(out, toString_Type(fn->params[i].first));
+                out.write(",\"name\":");
+                jsonString(out, fn->params[i].second);
+                out.put('}');
+            }
+            out.put(']');
+            child("body", fn->body.get());
+            out.put('}');
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            open("ReturnExpr");
+            child("expr", ret->expr.get());
+            out.put('}');
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            open("VarDecl");
+            key("const");
+            out.write(var->isConst ? "true" : "false");
+            field("name", var->name);
+            field("type", toString_Type(var->varType));
+            field("access", toString_Access(var->access));
+            field("modifier", toString_Modifier(var->modifier));
+            child("value", var->value.get());
+            out.put('}');
+        }
+
+        // Nested as in the tree, but opened down an `else if` chain with a loop.
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            size_t arms = 0;
+            for (;; ++arms)
+            {
+                open("IfExpr");
+                child("condition", ifn->condition.get());
+                child("then", ifn->thenBranch.get());
+                const ASTNode *next = ifn->elseBranch.get();
+                if (!next || next->type != ASTNodeType::IfExpr)
+                {
+                    child("else", next);
+                    break;
+                }
+                key("else");
+                ifn = static_cast<const IfExprNode *>(next);
+            }
+            for (size_t i = 0; i <= arms; ++i)
+                out.put('}');
+        }
+
+        void visitForExpr(const ForExprNode *loop)
+        {
+            open("ForExpr");
+            child("init", loop->init.get());
+            child("condition", loop->condition.get());
+            child("step", loop->step.get());
+            child("body", loop->body.get());
+            out.put('}');
+        }
+
+        void visitMatchExpr(const MatchExprNode *match)
+        {
+            open("MatchExpr");
+            child("subject", match->subject.get());
+            key("arms");
+            out.put('[');
+            for (size_t i = 0; i < match->arms.size(); ++i)
+            {
+                if (i)
+                    out.put(',');
+                out.write("{\"patterns\":[");
+                for (size_t j = 0; j < match->arms[i].patterns.size(); ++j)
+                {
+                    if (j)
+                        out.put(',');
+                    visit(match->arms[i].patterns[j].get());
+                }
+                out.put(']');
+                child("body", match->arms[i].body.get());
+                out.put('}');
+            }
+            out.put(']');
+            child("else", match->otherwise.get());
+            out.put('}');
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            open("AssignExpr");
+            field("name", as->name);
+            child("value", as->value.get());
+            out.put('}');
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            open(cls->isStructure ? "StructureDecl" : "ClassDecl");
+            field("name", cls->name);
+            field("access", toString_Access(cls->access));
+            if (!cls->baseName.empty())
+                field("base", cls->baseName);
+            if (!cls->attributes.empty())
+            {
+                key("attributes");
+                out.put('[');
+                for (size_t i = 0; i < cls->attributes.size(); ++i)
+                {
+                    if (i)
+                        out.put(',');
+                    jsonString(out, cls->attributes[i]);
+                }
+                out.put(']');
+            }
+            child("body", cls->body.get());
+            out.put('}');
+        }
+
+        // Nested as in the tree, but opened down a member-call chain with a
+        // loop; the arguments are written on the way back out.
+        void visitCallExpr(const CallExprNode *call)
+        {
+            std::vector<const CallExprNode *> chain{call};
+            for (;;)
+            {
+                open("CallExpr");
+                field("name", call->name);
+                field("dispatch", toString_Dispatch(call->dispatch));
+                if (!call->receiver)
+                    break;
+                if (call->receiver->type != ASTNodeType::FunctionCall)
+                {
+                    child("receiver", call->receiver.get());
+                    break;
+                }
+                key("receiver");
+                call = static_cast<const CallExprNode *>(call->receiver.get());
+                chain.push_back(call);
+            }
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                key("args");
+                out.put('[');
+                for (size_t i = 0; i < (*it)->args.size(); ++i)
+                {
+                    if (i)
+                        out.put(',');
+                    visit((*it)->args[i].get());
+                }
+                out.write("]}");
+            }
+        }
+
+        void visitSharedExpr(const SharedExprNode *shared)
+        {
+            open("SharedExpr");
+            key("hash");
+            out.unsignedInteger(shared->hash);
+            child("target", shared->target.get());
+            out.put('}');
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            open("Unknown");
+            out.put('}');
+        }
+    };
+
+    void atom(OutputBuffer &out, std::string_view text)
+    {
+        bool plain = !text.empty();
+        for (char c : text)
+            if (c == ' ' || c == '(' || c == ')' || c == '"' || c == ';' || c == '\\' || static_cast<unsigned char>(c) < 0x20)
+                plain = false;
+        if (plain)
+            out.write(text);
+        else
+            jsonString(out, text);
+    }
+
+    struct SExprWriter : ASTVisitor<SExprWriter>
+    {
+        OutputBuffer &out;
+        size_t level;
+
+        SExprWriter(OutputBuffer &out, size_t level) : out(out), level(level) {}
+
+        void open(std::string_view head)
+        {
+            out.put('(');
+            out.write(head);
+        }
+
+        void word(std::string_view text)
+        {
+            out.put(' ');
+            atom(out, text);
+        }
+
+        void child(const ASTNode *node)
+        {
+            level += 2;
+            out.put('\n');
+            out.indent(level);
+            if (node)
+                visit(node);
+            else
+                out.write("nil");
+            level -= 2;
+        }
+
+        void visitBlock(const BlockNode *blk)
+        {
+            open("Block");
+            for (const auto &c : blk->children)
+                child(c.get());
+            out.put(')');
+        }
+
+        void visitLiteral(const LiteralNode *lit)
+        {
+            open("Literal");
+            word(toString_Type(lit->literalType));
+            out.put(' ');
+            std::visit([this](const auto &v)
+                       {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, bool>)
+                    out.write(v ? "true" : "false");
+                else if constexpr (std::is_same_v<T, char>)
+                    jsonString(out, std::string_view(&v, 1));
+                else if constexpr (std::is_same_v<T, std::string>)
+                    jsonString(out, v);
+                else if constexpr (std::is_floating_point_v<T>)
+                    out.floating(v, 17);
+                else if constexpr (std::is_signed_v<T>)
+                    out.integer(v);
+                else
+                    out.unsignedInteger(v); }, lit->value);
+            out.put(')');
+        }
+
+        void visitIdentifier(const IdentifierNode *id)
+        {
+            open("Identifier");
+            word(id->name);
+            out.put(')');
+        }
+
+        // Nested as in the tree, but opened down the left spine with a loop.
+        void visitBinaryExpr(const BinaryExprNode *bin)
+        {
+            std::vector<const BinaryExprNode *> spine = leftSpine(bin);
+            size_t outer = level;
+            for (size_t i = 0; i < spine.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    out.put('\n');
+                    out.indent(outer + 2 * i);
+                }
+                open("BinaryExpr");
+                word(spine[i]->op);
+            }
+            level = outer + 2 * (spine.size() - 1);
+            child(spine.back()->left.get());
+            for (size_t i = spine.size(); i-- > 0;)
+            {
+                level = outer + 2 * i;
+                child(spine[i]->right.get());
+                out.put(')');
+            }
+            level = outer;
+        }
+
+        void visitFunctionDecl(const FunctionDeclNode *fn)
+        {
+            open("FunctionDecl");
+            word(fn->name);
+            word(toString_Access(fn->access));
+            word(toString_Modifier(fn->modifier));
+            word(toString_Type(fn->returnType));
+            for (const auto &attribute : fn->attributes)
+                word(attribute);
+            out.write(" (Params");
+            for (auto &p : fn->params)
+            {
+                out.write(" (");
+                out.write(toString_Type(p.first));
+                word(p.second);
+                out.put(')');
+            }
+            out.put(')');
+            child(fn->body.get());
+            out.put(')');
+        }
+
+        void visitReturnExpr(const ReturnExprNode *ret)
+        {
+            open("ReturnExpr");
+            child(ret->expr.get());
+            out.put(')');
+        }
+
+        void visitVarDecl(const VarDeclNode *var)
+        {
+            open(var->isConst ? "ConstDecl" : "VarDecl");
+            word(var->name);
+            word(toString_Type(var->varType));
+            word(toString_Access(var->access));
+            word(toString_Modifier(var->modifier));
+            if (var->value)
+                child(var->value.get());
+            out.put(')');
+        }
+
+        // Nested as in the tree, but opened down an `else if` chain with a loop.
+        void visitIfExpr(const IfExprNode *ifn)
+        {
+            size_t outer = level;
+            size_t arms = 0;
+            for (;; ++arms)
+            {
+                open("IfExpr");
+                child(ifn->condition.get());
+                child(ifn->thenBranch.get());
+                const ASTNode *next = ifn->elseBranch.get();
+                if (!next || next->type != ASTNodeType::IfExpr)
+                {
+                    if (next)
+                        child(next);
+                    break;
+                }
+                level += 2;
+                out.put('\n');
+                out.indent(level);
+                ifn = static_cast<const IfExprNode *>(next);
+            }
+            for (size_t i = 0; i <= arms; ++i)
+                out.put(')');
+            level = outer;
+        }
+
+        void visitForExpr(const ForExprNode *loop)
+        {
+            open("ForExpr");
+            child(loop->init.get());
+            child(loop->condition.get());
+            child(loop->step.get());
+            child(loop->body.get());
+            out.put(')');
+        }
+
+        void visitMatchExpr(const MatchExprNode *match)
+        {
+            open("MatchExpr");
+            child(match->subject.get());
+            for (const auto &arm : match->arms)
+            {
+                level += 2;
+                out.put('\n');
+                out.indent(level);
+                out.write("(Arm");
+                for (const auto &pattern : arm.patterns)
+                    child(pattern.get());
+                child(arm.body.get());
+                out.put(')');
+                level -= 2;
+            }
+            if (match->otherwise)
+            {
+                level += 2;
+                out.put('\n');
+                out.indent(level);
+                out.write("(Else");
+                child(match->otherwise.get());
+                out.put(')');
+                level -= 2;
+            }
+            out.put(')');
+        }
+
+        void visitAssignExpr(const AssignExprNode *as)
+        {
+            open("AssignExpr");
+            word(as->name);
+            child(as->value.get());
+            out.put(')');
+        }
+
+        void visitClassDecl(const ClassDeclNode *cls)
+        {
+            open(cls->isStructure ? "StructureDecl" : "ClassDecl");
+            word(cls->name);
+            word(toString_Access(cls->access));
+            if (!cls->baseName.empty())
+            {
+                word(":");
+                word(cls->baseName);
+            }
+            for (const auto &attribute : cls->attributes)
+                word(attribute);
+            child(cls->body.get());
+            out.put(')');
+        }
+
+        // Nested as in the tree, but opened down a member-call chain with a
+        // loop: each call sits 4 deeper than the one it is the receiver of,
+        // and its arguments are written on the way back out.
+        void visitCallExpr(const CallExprNode *call)
+        {
+            std::vector<const CallExprNode *> chain{call};
+            size_t outer = level;
+            for (;;)
+            {
+                open("CallExpr");
+                word(call->name);
+                if (call->dispatch != DispatchKind::Static)
+                    word(toString_Dispatch(call->dispatch));
+                if (!call->receiver)
+                    break;
+                level += 2;
+                out.put('\n');
+                out.indent(level);
+                out.write("(Receiver");
+                if (call->receiver->type != ASTNodeType::FunctionCall)
+                {
+                    child(call->receiver.get());
+                    out.put(')');
+                    level -= 2;
+                    break;
+                }
+                level += 2;
+                out.put('\n');
+                out.indent(level);
+                call = static_cast<const CallExprNode *>(call->receiver.get());
+                chain.push_back(call);
+            }
+            for (size_t i = chain.size(); i-- > 0;)
+            {
+                level = outer + 4 * i;
+                for (auto &arg : chain[i]->args)
+                    child(arg.get());
+                out.put(')');
+                if (i > 0)
+                    out.put(')');
+            }
+            level = outer;
+        }
+
+        void visitSharedExpr(const SharedExprNode *shared)
+        {
+            open("SharedExpr ");
+            out.unsignedInteger(shared->hash);
+            child(shared->target.get());
+            out.put(')');
+        }
+
+        void visitUnknown(const ASTNode *)
+        {
+            out.write("(Unknown)");
+        }
+    };
+}
+
+ASTDumper::ASTDumper(std::FILE *out, DumpFormat format)
+    : buffer(out), format(format) {}
+
+void ASTDumper::dump(const ASTNode *root, int indentLevel)
+{
+    switch (format)
+    {
+    case DumpFormat::Text:
+        TextWriter(buffer, indentLevel).visit(root);
+        break;
+    case DumpFormat::Json:
+        JsonWriter(buffer).visit(root);
+        buffer.put('\n');
+        break;
+    case DumpFormat::SExpr:
+        SExprWriter(buffer, indentLevel).visit(root);
+        buffer.put('\n');
+        break;
+    }
+    buffer.flush();
+}
+
+void ASTDumper::begin()
+{
+    items = 0;
+    switch (format)
+    {
+    case DumpFormat::Text:
+        buffer.write("Block\n");
+        break;
+    case DumpFormat::Json:
+        buffer.write("{\"kind\":\"Block\",\"children\":[");
+        break;
+    case DumpFormat::SExpr:
+        buffer.write("(Block");
+        break;
+    }
+}
+
+void ASTDumper::item(const ASTNode *node)
+{
+    switch (format)
+    {
+    case DumpFormat::Text:
+        TextWriter(buffer, 2).visit(node);
+        break;
+    case DumpFormat::Json:
+        if (items)
+            buffer.put(',');
+        JsonWriter(buffer).visit(node);
+        break;
+    case DumpFormat::SExpr:
+        buffer.write("\n  ");
+        SExprWriter(buffer, 2).visit(node);
+        break;
+    }
+    ++items;
+    buffer.flush();
+}
+
+void ASTDumper::end()
+{
+    switch (format)
+    {
+    case DumpFormat::Text:
+        break;
+    case DumpFormat::Json:
+        buffer.write("]}\n");
+        break;
+    case DumpFormat::SExpr:
+        buffer.write(")\n");
+        break;
+    }
+    buffer.flush();
+}
+
+bool parseDumpFormat(std::string_view name, DumpFormat &format)
+{
+    if (name == "text")
+        format = DumpFormat::Text;
+    else if (name == "json")
+        format = DumpFormat::Json;
+    else if (name == "sexpr")
+        format = DumpFormat::SExpr;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <fstream>
+#include <elf.hxx>
+
+namespace
+{
+    enum : uint32_t
+    {
+        SHT_PROGBITS = 1,
+        SHT_SYMTAB = 2,
+        SHT_STRTAB = 3,
+        SHT_RELA = 4
+    };
+
+    enum : uint64_t
+    {
+        SHF_WRITE = 1,
+        SHF_ALLOC = 2,
+        SHF_EXECINSTR = 4,
+        SHF_INFO_LINK = 0x40
+    };
+
+    // Output section indices; the three content sections come first so
+    // ElfObject::Section doubles as their index.
+    enum : uint16_t
+    {
+        RelaText = 4,
+        RelaData,
+        RelaRodata,
+        SymTab,
+        StrTab,
+        ShStrTab,
+        NoteStack,
+        SectionCount
+    };
+
+    struct Writer
+    {
+        std::vector<uint8_t> &out;
+
+        template <typename T>
+        void put(T value)
+        {
+            for (size_t i = 0; i < sizeof(T); ++i)
+                out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+
+        void align(size_t alignment)
+        {
+            while (out.size() % alignment)
+                out.push_back(0);
+        }
+    };
+
+    struct SectionHeader
+    {
+        uint32_t name = 0, type = 0;
+        uint64_t flags = 0, offset = 0, size = 0;
+        uint32_t link = 0, info = 0;
+        uint64_t align = 1, entsize = 0;
+    };
+
+    uint32_t addString(std::string &table, const std::string &name)
+    {
+        if (name.empty())
+            return 0;
+        uint32_t at = static_cast<uint32_t>(table.size());
+        table += name;
+        table += '\0';
+        return at;
+    }
+}
+
+ElfObject::ElfObject()
+{
+    symbols.push_back({"", Undefined, 0, 0, false, false, false});
+    for (Section section : {Text, Data, Rodata})
+        symbols.push_back({"", section, 0, 0, false, false, true});
+}
+
+uint32_t ElfObject::defineSymbol(const std::string &name, Section section, uint64_t value, uint64_t size, bool global, bool function)
+{
+    symbols.push_back({name, section, value, size, global, function, false});
+    return static_cast<uint32_t>(symbols.size() - 1);
+}
+
+void ElfObject::placeSymbol(uint32_t symbol, uint64_t value, uint64_t size)
+{
+    symbols[symbol].value = value;
+    symbols[symbol].size = size;
+}
+
+uint32_t ElfObject::externalSymbol(const std::string &name)
+{
+    auto [it, inserted] = externals.emplace(name, static_cast<uint32_t>(symbols.size()));
+    if (inserted)
+        symbols.push_back({name, Undefined, 0, 0, true, false, false});
+    return it->second;
+}
+
+void ElfObject::relocate(Section section, uint64_t offset, uint32_t symbol, uint32_t type, int64_t addend)
+{
+    sections[section - 1].relocations.push_back({offset, symbol, type, addend});
+}
+
+std::vector<uint8_t> ElfObject::serialize() const
+{
+    // Locals must precede globals in the symbol table.
+    std::vector<uint32_t> order, remap(symbols.size());
+    for (int pass = 0; pass < 2; ++pass)
+        for (uint32_t i = 0; i < symbols.size(); ++i)
+            if (symbols[i].global == (pass == 1))
+            {
+                remap[i] = static_cast<uint32_t>(order.size());
+                order.push_back(i);
+            }
+    uint32_t firstGlobal = 0;
+    while (firstGlobal < order.size() && !symbols[order[firstGlobal]].global)
+        ++firstGlobal;
+
+    std::vector<uint8_t> out;
+    Writer w{out};
+    out.resize(64);
+
+    SectionHeader headers[SectionCount];
+    std::string shstrtab(1, '\0');
+    static const char *const names[SectionCount] = {"", ".text", ".data", ".rodata", ".rela.text", ".rela.data", ".rela.rodata",
+                                                    ".symtab", ".strtab", ".shstrtab", ".note.GNU-stack"};
+    for (size_t i = 1; i < SectionCount; ++i)
+        headers[i].name = addString(shstrtab, names[i]);
+
+    static const uint64_t flags[] = {SHF_ALLOC | SHF_EXECINSTR, SHF_ALLOC | SHF_WRITE, SHF_ALLOC};
+    static const uint64_t alignments[] = {16, 8, 16};
+    for (uint16_t i = 0; i < 3; ++i)
+    {
+        SectionHeader &h = headers[i + 1];
+        w.align(alignments[i]);
+        h.type = SHT_PROGBITS;
+        h.flags = flags[i];
+        h.align = alignments[i];
+        h.offset = out.size();
+        h.size = sections[i].bytes.size();
+        out.insert(out.end(), sections[i].bytes.begin(), sections[i].bytes.end());
+    }
+
+    for (uint16_t i = 0; i < 3; ++i)
+    {
+        SectionHeader &h = headers[RelaText + i];
+        w.align(8);
+        h.type = SHT_RELA;
+        h.flags = SHF_INFO_LINK;
+        h.link = SymTab;
+        h.info = i + 1;
+        h.align = 8;
+        h.entsize = 24;
+        h.offset = out.size();
+        for (const auto &reloc : sections[i].relocations)
+        {
+            w.put<uint64_t>(reloc.offset);
+            w.put<uint64_t>(static_cast<uint64_t>(remap[reloc.symbol]) << 32 | reloc.type);
+            w.put<int64_t>(reloc.addend);
+        }
+        h.size = out.size() - h.offset;
+    }
+
+    std::string strtab(1, '\0');
+    {
+        SectionHeader &h = headers[SymTab];
+        w.align(8);
+        h.type = SHT_SYMTAB;
+        h.link = StrTab;
+        h.info = firstGlobal;
+        h.align = 8;
+        h.entsize = 24;
+        h.offset = out.size();
+        for (uint32_t index : order)
+        {
+            const Symbol &symbol = symbols[index];
+            uint8_t type = symbol.isSection ? 3 : symbol.function ? 2 : symbol.section != Undefined ? 1 : 0;
+            w.put<uint32_t>(addString(strtab, symbol.name));
+            w.put<uint8_t>(static_cast<uint8_t>((symbol.global ? 1 : 0) << 4 | type));
+            w.put<uint8_t>(0);
+            w.put<uint16_t>(symbol.section);
+            w.put<uint64_t>(symbol.value);
+            w.put<uint64_t>(symbol.size);
+        }
+        h.size = out.size() - h.offset;
+    }
+
+    for (auto [index, table] : {std::pair<uint16_t, const std::string *>{StrTab, &strtab}, {ShStrTab, &shstrtab}})
+    {
+        SectionHeader &h = headers[index];
+        h.type = SHT_STRTAB;
+        h.offset = out.size();
+        h.size = table->size();
+        out.insert(out.end(), table->begin(), table->end());
+    }
+
+    headers[NoteStack].type = SHT_PROGBITS;
+    headers[NoteStack].offset = out.size();
+
+    w.align(8);
+    uint64_t sectionHeaders = out.size();
+    for (const auto &h : headers)
+    {
+        w.put<uint32_t>(h.name);
+        w.put<uint32_t>(h.type);
+        w.put<uint64_t>(h.flags);
+        w.put<uint64_t>(0);
+        w.put<uint64_t>(h.offset);
+        w.put<uint64_t>(h.size);
+        w.put<uint32_t>(h.link);
+        w.put<uint32_t>(h.info);
+        w.put<uint64_t>(h.align);
+        w.put<uint64_t>(h.entsize);
+    }
+
+    std::vector<uint8_t> header;
+    Writer e{header};
+    static const uint8_t ident[] = {0x7f, 'E', 'L', 'F', 2, 1, 1, 0}; // 64-bit, little endian, SysV
+    for (uint8_t b : ident)
+        e.put<uint8_t>(b);
+    e.put<uint64_t>(0);
+    e.put<uint16_t>(1);  // ET_REL
+    e.put<uint16_t>(62); // EM_X86_64
+    e.put<uint32_t>(1);
+    e.put<uint64_t>(0); // entry
+    e.put<uint64_t>(0); // program headers
+    e.put<uint64_t>(sectionHeaders);
+    e.put<uint32_t>(0);
+    e.put<uint16_t>(64);
+    e.put<uint16_t>(0);
+    e.put<uint16_t>(0);
+    e.put<uint16_t>(64);
+    e.put<uint16_t>(SectionCount);
+    e.put<uint16_t>(ShStrTab);
+    std::copy(header.begin(), header.end(), out.begin());
+    return out;
+}
+
+bool ElfObject::write(const std::string &path) const
+{
+    std::vector<uint8_t> bytes = serialize();
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
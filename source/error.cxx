@@ -35,9 +35,24 @@ static void printSourceLine(std::ostream &os, std::string_view source, size_t er
     os << "^" << '\n';
 }
 
+static bool throwing = false;
+
+void Error::setThrowing(bool enabled)
+{
+    throwing = enabled;
+}
+
+bool Error::isThrowing()
+{
+    return throwing;
+}
+
 [[noreturn]]
 void Error::report(const CompileError &err, std::string_view source)
 {
+    if (throwing)
+        throw err;
+
     std::cerr << err.token.File << ":" << err.token.Line << ":"
               << err.token.Column << ": "
               << err.type << ": "
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <escape.hxx>
+
+namespace
+{
+    /** @brief (user, operand index) pairs of every value of a function */
+    using UseLists = std::vector<std::vector<std::pair<ValueId, uint16_t>>>;
+
+    UseLists collectUses(const Function &fn)
+    {
+        UseLists uses(fn.instrs.size());
+        for (const auto &block : fn.blocks)
+            for (ValueId v : block.code)
+            {
+                const Instr &instr = fn.instrs[v];
+                size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                for (size_t i = 0; i < instr.count; i += step)
+                    uses[fn.operand(v, i)].push_back({v, static_cast<uint16_t>(i)});
+            }
+        return uses;
+    }
+
+    class EscapeAnalysis
+    {
+    public:
+        EscapeAnalysis(Module &module, const EscapeOptions &options)
+            : module(module), options(options), uses(module.functions.size()), escaping(module.functions.size()),
+              remarks(module.functions.size())
+        {
+            for (size_t f = 0; f < module.functions.size(); ++f)
+            {
+                uses[f] = collectUses(module.functions[f]);
+                escaping[f].assign(module.functions[f].params.size(), false);
+            }
+            // A virtual call bound to a class's slot may run what that slot
+            // holds in the class or in any class derived from it.
+            for (size_t c = 0; c < module.classes.size(); ++c)
+                for (size_t slot = 0; slot < module.classes[c].vtable.size(); ++slot)
+                    for (int base = static_cast<int>(c); base >= 0; base = module.classes[base].base)
+                        overrides[{base, static_cast<int>(slot)}].push_back(module.classes[c].vtable[slot]);
+        }
+
+        /** @brief Marks every parameter some path lets escape, until nothing changes */
+        void solve()
+        {
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t f = 0; f < module.functions.size(); ++f)
+                {
+                    const Function &fn = module.functions[f];
+                    for (const auto &block : fn.blocks)
+                        for (ValueId v : block.code)
+                        {
+                            const Instr &instr = fn.instrs[v];
+                            if (instr.op != Opcode::Param || instr.type != ValueType::Ptr || escaping[f][instr.imm])
+                                continue;
+                            if (escapes(f, v))
+                            {
+                                escaping[f][instr.imm] = true;
+                                changed = true;
+                            }
+                        }
+                }
+            }
+        }
+
+        /** @brief Rewrites the allocations of one function; safe to run on several at once */
+        EscapeResult run(uint32_t f)
+        {
+            Function &fn = module.functions[f];
+            std::vector<ValueId> allocations;
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                    if (fn.instrs[v].op == Opcode::New)
+                        allocations.push_back(v);
+
+            EscapeResult result;
+            result.sites = allocations.size();
+            Replacements replacements{std::vector<ValueId>(fn.instrs.size(), NoValue), {}};
+            for (ValueId v : allocations)
+            {
+                const IRClass &cls = module.classes[fn.instrs[v].imm];
+                if (escapes(f, v))
+                    remark(f, v, "stays on the heap: it escapes");
+                else if (scalarReplace(fn, uses[f], v, replacements))
+                {
+                    remark(f, v, "scalar-replaced");
+                    ++result.replaced;
+                }
+                else if (cls.size > EscapeOptions::MaxFrameObject)
+                    remark(f, v, "stays on the heap: " + std::to_string(cls.size) + " bytes is too large for the frame");
+                else
+                {
+                    fn.instrs[v].op = Opcode::NewLocal;
+                    remark(f, v, "allocated in the frame");
+                    ++result.stack;
+                }
+            }
+            if (result.replaced)
+                rewrite(fn, replacements.values);
+            return result;
+        }
+
+        void printRemarks() const
+        {
+            for (const auto &lines : remarks)
+                for (const auto &line : lines)
+                    fprintf(options.remarks, "%s\n", line.c_str());
+        }
+
+    private:
+        Module &module;
+        const EscapeOptions &options;
+        std::vector<UseLists> uses;
+        std::vector<std::vector<bool>> escaping; /**< Per function and parameter */
+        std::map<std::pair<int, int>, std::vector<uint32_t>> overrides; /**< Per class and slot */
+        std::vector<std::vector<std::string>> remarks;
+
+        /** @brief The value each scalar-replaced load became, and the zeros made for them */
+        struct Replacements
+        {
+            std::vector<ValueId> values;
+            std::map<ValueType, ValueId> zeros;
+        };
+
+        bool parameterEscapes(int64_t f, uint16_t index) const
+        {
+            return index >= escaping[f].size() || escaping[f][index];
+        }
+
+        bool escapes(uint32_t f, ValueId object) const
+        {
+            const Function &fn = module.functions[f];
+            for (auto [user, index] : uses[f][object])
+            {
+                const Instr &instr = fn.instrs[user];
+                switch (instr.op)
+                {
+                case Opcode::LoadField:
+                case Opcode::Eq:
+                case Opcode::Ne:
+                    break;
+                case Opcode::StoreField:
+                    if (index != 0)
+                        return true;
+                    break;
+                case Opcode::Call:
+                    if (parameterEscapes(instr.imm, index))
+                        return true;
+                    break;
+                case Opcode::CallVirtual:
+                {
+                    if (parameterEscapes(instr.imm, index))
+                        return true;
+                    const Function &bound = module.functions[instr.imm];
+                    auto targets = overrides.find({bound.classIndex, bound.vtableSlot});
+                    if (targets != overrides.end())
+                        for (uint32_t target : targets->second)
+                            if (parameterEscapes(target, index))
+                                return true;
+                    break;
+                }
+                default:
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Forwards the stores to an instance's fields to the loads
+         * after them when every access is in the allocating block. Records
+         * the loads in replacement and turns the accesses into Nops.
+         */
+        bool scalarReplace(Function &fn, const UseLists &lists, ValueId object, Replacements &replacements)
+        {
+            BlockId block = fn.instrs[object].block;
+            for (auto [user, index] : lists[object])
+            {
+                Opcode op = fn.instrs[user].op;
+                if (fn.instrs[user].block != block || index != 0 || (op != Opcode::LoadField && op != Opcode::StoreField))
+                    return false;
+            }
+
+            // Offset -> (type, value last stored, NoValue while zero).
+            std::map<int64_t, std::pair<ValueType, ValueId>> fields;
+            std::vector<std::pair<ValueId, ValueId>> loads; /**< Load, value; NoValue for zero */
+            auto resolve = [&](ValueId v)
+            {
+                return replacements.values[v] != NoValue ? replacements.values[v] : v;
+            };
+            const auto &code = fn.blocks[block].code;
+            for (size_t i = std::find(code.begin(), code.end(), object) - code.begin(); i < code.size(); ++i)
+            {
+                ValueId v = code[i];
+                const Instr &instr = fn.instrs[v];
+                if ((instr.op != Opcode::LoadField && instr.op != Opcode::StoreField) || fn.operand(v, 0) != object)
+                    continue;
+                ValueId value = instr.op == Opcode::StoreField ? resolve(fn.operand(v, 1)) : NoValue;
+                ValueType type = value != NoValue ? fn.instrs[value].type : instr.type;
+                auto [field, added] = fields.try_emplace(instr.imm, type, NoValue);
+                if (field->second.first != type)
+                    return false;
+                if (value != NoValue)
+                    field->second.second = value;
+                else
+                {
+                    // calloc leaves strings and pointers null, which no constant is.
+                    if (field->second.second == NoValue && (type == ValueType::Str || type == ValueType::Ptr))
+                        return false;
+                    loads.push_back({v, field->second.second});
+                }
+            }
+            int64_t end = INT64_MIN;
+            for (const auto &[offset, field] : fields)
+            {
+                if (offset < end)
+                    return false;
+                end = offset + std::max(1u, valueBits(field.first) / 8);
+            }
+
+            for (auto [load, value] : loads)
+                replacements.values[load] = value != NoValue ? value : zero(fn, fn.instrs[load].type, replacements.zeros);
+            for (auto [user, index] : lists[object])
+                fn.instrs[user].op = Opcode::Nop;
+            fn.instrs[object].op = Opcode::Nop;
+            return true;
+        }
+
+        ValueId zero(Function &fn, ValueType type, std::map<ValueType, ValueId> &zeros)
+        {
+            auto [it, added] = zeros.try_emplace(type, NoValue);
+            if (added)
+                it->second = fn.emitFront(0, Opcode::Const, type, 0);
+            return it->second;
+        }
+
+        // A load may have been replaced by a load of an instance replaced
+        // after it, so replacements are followed to the end.
+        void rewrite(Function &fn, const std::vector<ValueId> &replacement)
+        {
+            for (auto &block : fn.blocks)
+            {
+                block.code.erase(std::remove_if(block.code.begin(), block.code.end(), [&](ValueId v)
+                                                { return fn.instrs[v].op == Opcode::Nop; }),
+                                 block.code.end());
+                for (ValueId v : block.code)
+                {
+                    const Instr &instr = fn.instrs[v];
+                    ValueId *ops = fn.operands(v);
+                    size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                    for (size_t i = 0; i < instr.count; i += step)
+                        while (ops[i] < replacement.size() && replacement[ops[i]] != NoValue)
+                            ops[i] = replacement[ops[i]];
+                }
+            }
+        }
+
+        void remark(uint32_t f, ValueId object, const std::string &text)
+        {
+            if (!options.remarks)
+                return;
+            const Function &fn = module.functions[f];
+            const Instr &instr = fn.instrs[object];
+            remarks[f].push_back("remark: " + fn.name + ":" + std::to_string(instr.line) + ": '" + module.classes[instr.imm].name + "' " + text);
+        }
+    };
+}
+
+EscapeResult promoteAllocations(Module &module, ThreadPool &pool, const EscapeOptions &options)
+{
+    EscapeAnalysis analysis(module, options);
+    analysis.solve();
+
+    std::vector<EscapeResult> results(module.functions.size());
+    pool.parallelFor(module.functions.size(), [&](size_t f)
+                     { results[f] = analysis.run(static_cast<uint32_t>(f)); });
+    if (options.remarks)
+        analysis.printRemarks();
+
+    EscapeResult total;
+    for (const auto &result : results)
+    {
+        total.sites += result.sites;
+        total.stack += result.stack;
+        total.replaced += result.replaced;
+    }
+    return total;
+}
@@ -0,0 +1,321 @@
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fold.hxx>
+#include <types.hxx>
+#include <symbols.hxx>
+#include <visitor.hxx>
+
+namespace
+{
+    // Two's complement bit pattern of an integer literal, sign-extended to 64 bits.
+    uint64_t integerBits(const LiteralValue &value)
+    {
+        return std::visit([](auto x) -> uint64_t
+                          {
+            using T = decltype(x);
+            if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+            {
+                if constexpr (std::is_signed_v<T>)
+                    return static_cast<uint64_t>(static_cast<int64_t>(x));
+                else
+                    return static_cast<uint64_t>(x);
+            }
+            else
+                return 0; }, value);
+    }
+
+    double floatValue(const LiteralValue &value)
+    {
+        if (auto *f = std::get_if<float>(&value))
+            return *f;
+        if (auto *d = std::get_if<double>(&value))
+            return *d;
+        return 0.0;
+    }
+
+    // Truncates to the width of `type` and sign-extends signed results.
+    uint64_t wrap(uint64_t bits, Type type)
+    {
+        unsigned width = bitWidth(type);
+        if (width >= 64)
+            return bits;
+        uint64_t mask = (uint64_t(1) << width) - 1;
+        bits &= mask;
+        if (isSignedType(type) && (bits >> (width - 1)) & 1)
+            bits |= ~mask;
+        return bits;
+    }
+
+    LiteralValue makeInteger(Type type, uint64_t bits)
+    {
+        switch (type)
+        {
+        case Type::Int8:
+            return static_cast<int8_t>(bits);
+        case Type::Int16:
+            return static_cast<int16_t>(bits);
+        case Type::Int32:
+            return static_cast<int32_t>(bits);
+        case Type::Int64:
+            return static_cast<int64_t>(bits);
+        case Type::Uint8:
+            return static_cast<uint8_t>(bits);
+        case Type::Uint16:
+            return static_cast<uint16_t>(bits);
+        case Type::Uint32:
+            return static_cast<uint32_t>(bits);
+        default:
+            return static_cast<uint64_t>(bits);
+        }
+    }
+
+    template <typename T>
+    bool compare(const std::string &op, T a, T b)
+    {
+        if (op == "==")
+            return a == b;
+        if (op == "!=")
+            return a != b;
+        if (op == "<")
+            return a < b;
+        if (op == "<=")
+            return a <= b;
+        if (op == ">")
+            return a > b;
+        return a >= b;
+    }
+
+    bool isComparison(const std::string &op)
+    {
+        return op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=";
+    }
+
+    std::optional<LiteralValue> foldInteger(const std::string &op, Type type, uint64_t a, uint64_t b)
+    {
+        bool isSigned = isSignedType(type);
+        if (isComparison(op))
+        {
+            if (isSigned)
+                return compare(op, static_cast<int64_t>(a), static_cast<int64_t>(b));
+            return compare(op, a, b);
+        }
+
+        uint64_t r;
+        if (op == "+")
+            r = a + b;
+        else if (op == "-")
+            r = a - b;
+        else if (op == "*")
+            r = a * b;
+        else if (op == "|")
+            r = a | b;
+        else if (op == "/" || op == "%")
+        {
+            if (b == 0)
+                return std::nullopt;
+            if (isSigned)
+            {
+                int64_t sa = static_cast<int64_t>(a), sb = static_cast<int64_t>(b);
+                // INT64_MIN / -1 overflows; the wrapped quotient is INT64_MIN and the remainder 0.
+                if (sb == -1)
+                    r = op == "/" ? uint64_t(0) - a : 0;
+                else
+                    r = static_cast<uint64_t>(op == "/" ? sa / sb : sa % sb);
+            }
+            else
+                r = op == "/" ? a / b : a % b;
+        }
+        else
+            return std::nullopt;
+
+        return makeInteger(type, wrap(r, type));
+    }
+
+    template <typename T>
+    std::optional<LiteralValue> foldFloat(const std::string &op, T a, T b)
+    {
+        if (isComparison(op))
+            return compare(op, a, b);
+        if (op == "+")
+            return LiteralValue(static_cast<T>(a + b));
+        if (op == "-")
+            return LiteralValue(static_cast<T>(a - b));
+        if (op == "*")
+            return LiteralValue(static_cast<T>(a * b));
+        if (op == "/")
+            return LiteralValue(static_cast<T>(a / b));
+        return std::nullopt;
+    }
+
+    std::optional<LiteralValue> foldBoolean(const std::string &op, bool a, bool b)
+    {
+        if (op == "&&")
+            return a && b;
+        if (op == "|")
+            return a || b;
+        if (op == "==")
+            return a == b;
+        if (op == "!=")
+            return a != b;
+        return std::nullopt;
+    }
+
+    std::optional<LiteralValue> foldString(const std::string &op, const std::string &a, const std::string &b)
+    {
+        // String literals keep their quotes, so concatenation joins the bodies.
+        if (op == "+" && a.size() >= 2 && b.size() >= 2)
+            return a.substr(0, a.size() - 1) + b.substr(1);
+        if (op == "==")
+            return a == b;
+        if (op == "!=")
+            return a != b;
+        return std::nullopt;
+    }
+
+    std::optional<LiteralValue> foldLiterals(const std::string &op, const LiteralNode *l, const LiteralNode *r)
+    {
+        Type type = l->literalType;
+        if (type != r->literalType)
+            return std::nullopt;
+
+        if (isIntegerType(type))
+            return foldInteger(op, type, integerBits(l->value), integerBits(r->value));
+        if (type == Type::Float32)
+            return foldFloat<float>(op, static_cast<float>(floatValue(l->value)), static_cast<float>(floatValue(r->value)));
+        if (type == Type::Float64)
+            return foldFloat<double>(op, floatValue(l->value), floatValue(r->value));
+        if (type == Type::Boolean)
+            return foldBoolean(op, std::get<bool>(l->value), std::get<bool>(r->value));
+        if (type == Type::Byte && isComparison(op))
+            return compare(op, static_cast<unsigned char>(std::get<char>(l->value)), static_cast<unsigned char>(std::get<char>(r->value)));
+        if (type == Type::String)
+            return foldString(op, std::get<std::string>(l->value), std::get<std::string>(r->value));
+        return std::nullopt;
+    }
+
+    Type literalTypeOf(const LiteralValue &value, Type operandType)
+    {
+        if (std::holds_alternative<bool>(value))
+            return Type::Boolean;
+        return operandType;
+    }
+
+    struct ConstantFolder : ASTRewriter<ConstantFolder>
+    {
+        size_t folded = 0;
+        std::unordered_set<const VarDeclNode *> visited;
+
+        /** Canonical node of a hash-consed subtree -> its folded value, or null */
+        std::unordered_map<const ASTNode *, std::unique_ptr<LiteralNode>> shared;
+
+        static std::unique_ptr<LiteralNode> foldBinary(const BinaryExprNode *bin)
+        {
+            if (bin->left->type != ASTNodeType::Literal || bin->right->type != ASTNodeType::Literal)
+                return nullptr;
+
+            auto *l = static_cast<const LiteralNode *>(bin->left.get());
+            auto *r = static_cast<const LiteralNode *>(bin->right.get());
+            std::optional<LiteralValue> value = foldLiterals(bin->op, l, r);
+            if (!value)
+                return nullptr;
+
+            auto lit = std::make_unique<LiteralNode>(literalTypeOf(*value, l->literalType), std::move(*value));
+            lit->line = bin->line;
+            lit->column = bin->column;
+            lit->resolvedType = bin->resolvedType;
+            return lit;
+        }
+
+        ASTNodePtr rewriteBinaryExpr(ASTNodePtr node)
+        {
+            std::unique_ptr<LiteralNode> lit = foldBinary(static_cast<const BinaryExprNode *>(node.get()));
+            if (!lit)
+                return node;
+            ++folded;
+            return lit;
+        }
+
+        ASTNodePtr rewriteSharedExpr(ASTNodePtr node)
+        {
+            auto *reference = static_cast<const SharedExprNode *>(node.get());
+
+            // Every occurrence has the same operands, so the canonical node
+            // is folded in place once for all of them. A chain of canonical
+            // nodes linked through their left operands is folded innermost
+            // first by the loop rather than by recursion.
+            std::vector<BinaryExprNode *> pending;
+            const ASTNode *target = reference->target.get();
+            while (shared.emplace(target, nullptr).second)
+            {
+                auto *bin = const_cast<BinaryExprNode *>(static_cast<const BinaryExprNode *>(target));
+                pending.push_back(bin);
+                if (bin->left->type != ASTNodeType::SharedExpr)
+                    break;
+                target = static_cast<const SharedExprNode *>(bin->left.get())->target.get();
+            }
+            for (auto it = pending.rbegin(); it != pending.rend(); ++it)
+            {
+                rewrite((*it)->left);
+                rewrite((*it)->right);
+                shared[*it] = foldBinary(*it);
+            }
+
+            auto it = shared.find(reference->target.get());
+            if (!it->second)
+                return node;
+
+            ++folded;
+            auto lit = std::make_unique<LiteralNode>(it->second->literalType, it->second->value);
+            lit->line = reference->line;
+            lit->column = reference->column;
+            lit->resolvedType = reference->resolvedType;
+            return lit;
+        }
+
+        ASTNodePtr rewriteIdentifier(ASTNodePtr node)
+        {
+            auto *id = static_cast<IdentifierNode *>(node.get());
+            const Symbol *symbol = id->symbol;
+            if (!symbol || (symbol->kind != SymbolKind::Constant && symbol->kind != SymbolKind::Field))
+                return node;
+
+            auto *decl = static_cast<VarDeclNode *>(symbol->decl);
+            if (!decl->isConst)
+                return node;
+
+            // Constants may be used before their declaration, so fold the
+            // initializer on first use.
+            if (visited.insert(decl).second)
+                rewrite(decl->value);
+
+            if (!decl->value || decl->value->type != ASTNodeType::Literal)
+                return node;
+
+            auto *init = static_cast<const LiteralNode *>(decl->value.get());
+            ++folded;
+            auto lit = std::make_unique<LiteralNode>(init->literalType, init->value);
+            lit->line = id->line;
+            lit->column = id->column;
+            lit->resolvedType = init->resolvedType;
+            return lit;
+        }
+
+        void rewrite(ASTNodePtr &slot)
+        {
+            // Mark declarations before descending so a self-referencing
+            // initializer is never re-entered.
+            if (slot && slot->type == ASTNodeType::VarDecl)
+                visited.insert(static_cast<const VarDeclNode *>(slot.get()));
+            ASTRewriter::rewrite(slot);
+        }
+    };
+}
+
+size_t foldConstants(ASTNodePtr &root)
+{
+    ConstantFolder folder;
+    folder.rewrite(root);
+    return folder.folded;
+}
@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <unordered_map>
+#include <gvn.hxx>
+
+namespace
+{
+    /** @brief Generation of values that do not depend on memory */
+    constexpr uint32_t Pure = 0;
+
+    size_t combine(size_t seed, size_t value)
+    {
+        return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    }
+
+    // Add on strings is concatenation, which is not commutative.
+    bool isCommutative(const Instr &instr)
+    {
+        Opcode op = instr.op;
+        if (op == Opcode::Add)
+            return instr.type != ValueType::Str;
+        return op == Opcode::Mul || op == Opcode::Or || op == Opcode::And || op == Opcode::MulHigh || op == Opcode::Eq || op == Opcode::Ne;
+    }
+
+    /**
+     * @brief One walk over the dominator tree.
+     *
+     * The table maps an instruction to the first equal one that dominates
+     * it, keyed by opcode, type, immediate and operands. Loads also carry the
+     * memory generation they were made in; every store or call starts a new
+     * generation, as does entering a block that control can reach from
+     * elsewhere, and a load is only reused within its generation.
+     */
+    class ValueNumbering
+    {
+    public:
+        ValueNumbering(Function &fn, const std::vector<bool> &immutable)
+            : fn(fn), immutable(immutable), table(64, Hash{&fn}, Same{&fn}), replacement(fn.instrs.size(), NoValue)
+        {
+        }
+
+        bool run(const DominatorTree &dom);
+
+    private:
+        struct Hash
+        {
+            const Function *fn;
+            size_t operator()(ValueId v) const
+            {
+                const Instr &instr = fn->instrs[v];
+                size_t h = combine(static_cast<size_t>(instr.op) << 8 | static_cast<size_t>(instr.type), static_cast<size_t>(instr.imm));
+                if (instr.op == Opcode::Phi)
+                    h = combine(h, instr.block);
+                const ValueId *ops = fn->operands(v);
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    h = combine(h, ops[i]);
+                return h;
+            }
+        };
+
+        struct Same
+        {
+            const Function *fn;
+            bool operator()(ValueId a, ValueId b) const
+            {
+                const Instr &x = fn->instrs[a], &y = fn->instrs[b];
+                if (x.op != y.op || x.type != y.type || x.imm != y.imm || x.count != y.count)
+                    return false;
+                if (x.op == Opcode::Phi && x.block != y.block)
+                    return false;
+                return std::equal(fn->operands(a), fn->operands(a) + x.count, fn->operands(b));
+            }
+        };
+
+        struct Available
+        {
+            ValueId value;
+            uint32_t generation;
+        };
+
+        struct Undo
+        {
+            ValueId key;
+            Available previous;
+            bool existed;
+        };
+
+        Function &fn;
+        const std::vector<bool> &immutable;
+        std::unordered_map<ValueId, Available, Hash, Same> table;
+        std::vector<Undo> undo;
+        std::vector<ValueId> replacement;
+        uint32_t generations = Pure;
+
+        // Pure for values that never change, UINT32_MAX for instructions
+        // that are not numbered at all.
+        uint32_t generationOf(const Instr &instr, uint32_t memory) const
+        {
+            switch (instr.op)
+            {
+            case Opcode::Const:
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Div:
+            case Opcode::Rem:
+            case Opcode::Or:
+            case Opcode::And:
+            case Opcode::Shl:
+            case Opcode::Shr:
+            case Opcode::MulHigh:
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+            case Opcode::Hash:
+            case Opcode::Phi:
+                return Pure;
+            case Opcode::LoadGlobal:
+                return immutable[static_cast<size_t>(instr.imm)] ? Pure : memory;
+            case Opcode::LoadField:
+                return memory;
+            default:
+                return UINT32_MAX;
+            }
+        }
+
+        static bool clobbersMemory(Opcode op)
+        {
+            return op == Opcode::StoreGlobal || op == Opcode::StoreField || op == Opcode::NewLocal || op == Opcode::Call || op == Opcode::CallVirtual;
+        }
+
+        void rename(ValueId v)
+        {
+            const Instr &instr = fn.instrs[v];
+            ValueId *ops = fn.operands(v);
+            size_t step = instr.op == Opcode::Phi ? 2 : 1;
+            for (size_t i = 0; i < instr.count; i += step)
+                if (replacement[ops[i]] != NoValue)
+                    ops[i] = replacement[ops[i]];
+        }
+
+        /** @brief Numbers the code of one block; returns the memory generation at its end */
+        uint32_t visit(BlockId block, uint32_t memory);
+    };
+
+    uint32_t ValueNumbering::visit(BlockId block, uint32_t memory)
+    {
+        for (ValueId v : fn.blocks[block].code)
+        {
+            rename(v);
+            const Instr &instr = fn.instrs[v];
+            if (clobbersMemory(instr.op))
+            {
+                memory = ++generations;
+                continue;
+            }
+            uint32_t generation = generationOf(instr, memory);
+            if (generation == UINT32_MAX)
+                continue;
+            if (isCommutative(instr) && fn.operand(v, 0) > fn.operand(v, 1))
+                std::swap(fn.operands(v)[0], fn.operands(v)[1]);
+
+            auto [at, inserted] = table.try_emplace(v, Available{v, generation});
+            if (inserted)
+            {
+                undo.push_back({v, {}, false});
+                continue;
+            }
+            if (at->second.generation == Pure || at->second.generation == generation)
+            {
+                replacement[v] = at->second.value;
+                continue;
+            }
+            // A stale load: this one is available from here on.
+            undo.push_back({at->first, at->second, true});
+            at->second = {v, generation};
+        }
+        return memory;
+    }
+
+    bool ValueNumbering::run(const DominatorTree &dom)
+    {
+        struct Frame
+        {
+            BlockId block;
+            size_t child;
+            size_t undo;
+            uint32_t memory; /**< Generation at the end of the block */
+        };
+
+        std::vector<Frame> stack;
+        stack.push_back({0, 0, 0, visit(0, ++generations)});
+        while (!stack.empty())
+        {
+            Frame &top = stack.back();
+            if (top.child < dom.children[top.block].size())
+            {
+                BlockId child = dom.children[top.block][top.child++];
+                // Memory is only known to be unchanged along the one edge from the dominator.
+                uint32_t memory = fn.blocks[child].preds.size() == 1 ? top.memory : ++generations;
+                size_t mark = undo.size();
+                stack.push_back({child, 0, mark, visit(child, memory)});
+                continue;
+            }
+
+            for (size_t i = undo.size(); i > top.undo; --i)
+            {
+                const Undo &entry = undo[i - 1];
+                if (entry.existed)
+                    table.find(entry.key)->second = entry.previous;
+                else
+                    table.erase(entry.key);
+            }
+            undo.resize(top.undo);
+            stack.pop_back();
+        }
+
+        bool changed = false;
+        for (auto &block : fn.blocks)
+        {
+            // Phi operands along back edges were visited before their definitions.
+            for (ValueId v : block.code)
+                rename(v);
+            size_t before = block.code.size();
+            block.code.erase(std::remove_if(block.code.begin(), block.code.end(), [&](ValueId v)
+                                            { return replacement[v] != NoValue; }),
+                             block.code.end());
+            changed |= block.code.size() != before;
+        }
+        for (ValueId v = 0; v < fn.instrs.size(); ++v)
+            if (replacement[v] != NoValue)
+                fn.instrs[v].op = Opcode::Nop;
+        return changed;
+    }
+}
+
+bool numberValues(Function &fn, const DominatorTree &dom, const std::vector<bool> &immutableGlobals)
+{
+    if (fn.blocks.empty())
+        return false;
+
+    // The module initializer is where const globals get their value.
+    for (const auto &block : fn.blocks)
+        for (ValueId v : block.code)
+        {
+            const Instr &instr = fn.instrs[v];
+            if (instr.op == Opcode::StoreGlobal && immutableGlobals[static_cast<size_t>(instr.imm)])
+            {
+                std::vector<bool> none(immutableGlobals.size(), false);
+                return ValueNumbering(fn, none).run(dom);
+            }
+        }
+    return ValueNumbering(fn, immutableGlobals).run(dom);
+}
+
+bool numberValues(Module &module, ThreadPool &pool)
+{
+    std::vector<bool> immutable(module.globals.size());
+    for (size_t i = 0; i < module.globals.size(); ++i)
+        immutable[i] = module.globals[i].constant;
+
+    std::vector<char> changed(module.functions.size(), 0);
+    pool.parallelFor(module.functions.size(), [&](size_t index)
+                     {
+                         Function &fn = module.functions[index];
+                         DominatorTree dom;
+                         dom.compute(fn);
+                         changed[index] = numberValues(fn, dom, immutable);
+                     });
+    return std::find(changed.begin(), changed.end(), 1) != changed.end();
+}
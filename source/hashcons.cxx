@@ -0,0 +1,324 @@
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <hashcons.hxx>
+
+static size_t combine(size_t seed, size_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+static size_t hashLiteral(const LiteralNode *lit)
+{
+    size_t h = combine(static_cast<size_t>(lit->literalType), lit->value.index());
+    return std::visit([h](const auto &v) -> size_t
+                      {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::string>)
+            return combine(h, std::hash<std::string>{}(v));
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            // Hash the bit pattern so that 0.0 and -0.0 stay distinct.
+            uint64_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(T));
+            return combine(h, bits);
+        }
+        else
+            return combine(h, static_cast<size_t>(v)); }, lit->value);
+}
+
+static bool literalsEqual(const LiteralNode *a, const LiteralNode *b)
+{
+    if (a->literalType != b->literalType || a->value.index() != b->value.index())
+        return false;
+    return std::visit([b](const auto &v) -> bool
+                      {
+        using T = std::decay_t<decltype(v)>;
+        const T &w = std::get<T>(b->value);
+        if constexpr (std::is_floating_point_v<T>)
+            return std::memcmp(&v, &w, sizeof(T)) == 0;
+        else
+            return v == w; }, a->value);
+}
+
+static size_t hashBinary(const std::string &op, size_t left, size_t right)
+{
+    size_t h = combine(static_cast<size_t>(ASTNodeType::BinaryExpr), std::hash<std::string>{}(op));
+    return combine(combine(h, left), right);
+}
+
+size_t structuralHash(const ASTNode *node)
+{
+    if (!node)
+        return 0;
+
+    switch (node->type)
+    {
+    case ASTNodeType::SharedExpr:
+        return static_cast<const SharedExprNode *>(node)->hash;
+    case ASTNodeType::Literal:
+        return hashLiteral(static_cast<const LiteralNode *>(node));
+    case ASTNodeType::Identifier:
+        return combine(static_cast<size_t>(ASTNodeType::Identifier),
+                       std::hash<std::string>{}(static_cast<const IdentifierNode *>(node)->name));
+    case ASTNodeType::BinaryExpr:
+    {
+        // Down the left spine with a loop, then hashed from the inside out.
+        std::vector<const BinaryExprNode *> spine;
+        while (node->type == ASTNodeType::BinaryExpr)
+        {
+            spine.push_back(static_cast<const BinaryExprNode *>(node));
+            node = spine.back()->left.get();
+        }
+        size_t h = structuralHash(node);
+        for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+            h = hashBinary((*it)->op, h, structuralHash((*it)->right.get()));
+        return h;
+    }
+    case ASTNodeType::AssignExpr:
+    {
+        auto *as = static_cast<const AssignExprNode *>(node);
+        size_t h = combine(static_cast<size_t>(ASTNodeType::AssignExpr), std::hash<std::string>{}(as->name));
+        return combine(h, structuralHash(as->value.get()));
+    }
+    case ASTNodeType::ReturnExpr:
+        return combine(static_cast<size_t>(ASTNodeType::ReturnExpr),
+                       structuralHash(static_cast<const ReturnExprNode *>(node)->expr.get()));
+    default:
+        return static_cast<size_t>(node->type);
+    }
+}
+
+static const ASTNode *unwrap(const ASTNode *node)
+{
+    while (node && node->type == ASTNodeType::SharedExpr)
+        node = static_cast<const SharedExprNode *>(node)->target.get();
+    return node;
+}
+
+bool structurallyEqual(const ASTNode *a, const ASTNode *b)
+{
+    // Operator chains are compared down their left spines by the loop.
+    for (;;)
+    {
+        a = unwrap(a);
+        b = unwrap(b);
+        if (a == b)
+            return true;
+        if (!a || !b || a->type != b->type)
+            return false;
+        if (a->type != ASTNodeType::BinaryExpr)
+            break;
+
+        auto *x = static_cast<const BinaryExprNode *>(a);
+        auto *y = static_cast<const BinaryExprNode *>(b);
+        if (x->op != y->op || !structurallyEqual(x->right.get(), y->right.get()))
+            return false;
+        a = x->left.get();
+        b = y->left.get();
+    }
+
+    switch (a->type)
+    {
+    case ASTNodeType::Literal:
+        return literalsEqual(static_cast<const LiteralNode *>(a), static_cast<const LiteralNode *>(b));
+    case ASTNodeType::Identifier:
+    {
+        // Once names are resolved, equal spelling is not enough: the two
+        // occurrences must refer to the same declaration.
+        auto *x = static_cast<const IdentifierNode *>(a);
+        auto *y = static_cast<const IdentifierNode *>(b);
+        if (x->symbol && y->symbol)
+            return x->symbol == y->symbol;
+        return x->name == y->name;
+    }
+    case ASTNodeType::AssignExpr:
+    {
+        auto *x = static_cast<const AssignExprNode *>(a);
+        auto *y = static_cast<const AssignExprNode *>(b);
+        bool sameTarget = x->symbol && y->symbol ? x->symbol == y->symbol : x->name == y->name;
+        return sameTarget && structurallyEqual(x->value.get(), y->value.get());
+    }
+    case ASTNodeType::ReturnExpr:
+        return structurallyEqual(static_cast<const ReturnExprNode *>(a)->expr.get(),
+                                 static_cast<const ReturnExprNode *>(b)->expr.get());
+    default:
+        return false;
+    }
+}
+
+bool isPureExpression(const ASTNode *node)
+{
+    while (node && node->type == ASTNodeType::BinaryExpr)
+    {
+        auto *bin = static_cast<const BinaryExprNode *>(node);
+        if (!isPureExpression(bin->right.get()))
+            return false;
+        node = bin->left.get();
+    }
+    if (!node)
+        return false;
+
+    switch (node->type)
+    {
+    case ASTNodeType::Literal:
+    case ASTNodeType::Identifier:
+    case ASTNodeType::SharedExpr:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Operands of a canonical node are leaves or already-shared subtrees, so
+// they compare in constant time.
+static bool isCanonicalOperand(const ASTNode *node)
+{
+    return node->type == ASTNodeType::Literal ||
+           node->type == ASTNodeType::Identifier ||
+           node->type == ASTNodeType::SharedExpr;
+}
+
+static bool operandsEqual(const ASTNode *a, const ASTNode *b)
+{
+    if (a->type == ASTNodeType::SharedExpr && b->type == ASTNodeType::SharedExpr)
+        return static_cast<const SharedExprNode *>(a)->target == static_cast<const SharedExprNode *>(b)->target;
+    if (a->type == ASTNodeType::SharedExpr || b->type == ASTNodeType::SharedExpr)
+        return false;
+    return structurallyEqual(a, b);
+}
+
+void HashConsTable::intern(ASTNodePtr &root)
+{
+    internSlot(root);
+}
+
+void HashConsTable::internSlot(ASTNodePtr &slot)
+{
+    ASTNode *node = slot.get();
+    if (!node)
+        return;
+
+    switch (node->type)
+    {
+    case ASTNodeType::Block:
+        for (auto &child : static_cast<BlockNode *>(node)->children)
+            internSlot(child);
+        break;
+    case ASTNodeType::FunctionDecl:
+        internSlot(static_cast<FunctionDeclNode *>(node)->body);
+        break;
+    case ASTNodeType::ClassDecl:
+        internSlot(static_cast<ClassDeclNode *>(node)->body);
+        break;
+    case ASTNodeType::ReturnExpr:
+        internSlot(static_cast<ReturnExprNode *>(node)->expr);
+        break;
+    case ASTNodeType::VarDecl:
+        internSlot(static_cast<VarDeclNode *>(node)->value);
+        break;
+    case ASTNodeType::AssignExpr:
+        internSlot(static_cast<AssignExprNode *>(node)->value);
+        break;
+    case ASTNodeType::FunctionCall:
+    {
+        // Innermost receiver first, down a member-call chain with a loop.
+        std::vector<CallExprNode *> chain{static_cast<CallExprNode *>(node)};
+        while (chain.back()->receiver && chain.back()->receiver->type == ASTNodeType::FunctionCall)
+            chain.push_back(static_cast<CallExprNode *>(chain.back()->receiver.get()));
+        internSlot(chain.back()->receiver);
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            for (auto &arg : (*it)->args)
+                internSlot(arg);
+        break;
+    }
+    case ASTNodeType::IfExpr:
+    {
+        // Along an `else if` chain with a loop.
+        ASTNodePtr *at = &slot;
+        for (; *at && (*at)->type == ASTNodeType::IfExpr; at = &static_cast<IfExprNode &>(**at).elseBranch)
+        {
+            auto *ifn = static_cast<IfExprNode *>(at->get());
+            internSlot(ifn->condition);
+            internSlot(ifn->thenBranch);
+        }
+        internSlot(*at);
+        break;
+    }
+    case ASTNodeType::ForExpr:
+    {
+        auto *loop = static_cast<ForExprNode *>(node);
+        internSlot(loop->init);
+        internSlot(loop->condition);
+        internSlot(loop->step);
+        internSlot(loop->body);
+        break;
+    }
+    case ASTNodeType::MatchExpr:
+    {
+        auto *match = static_cast<MatchExprNode *>(node);
+        internSlot(match->subject);
+        for (auto &arm : match->arms)
+            internSlot(arm.body);
+        internSlot(match->otherwise);
+        break;
+    }
+    case ASTNodeType::BinaryExpr:
+    {
+        // Bottom-up along the left spine, so a chain costs no stack.
+        std::vector<ASTNodePtr *> spine;
+        for (ASTNodePtr *at = &slot; *at && (*at)->type == ASTNodeType::BinaryExpr; at = &static_cast<BinaryExprNode &>(**at).left)
+            spine.push_back(at);
+        internSlot(static_cast<BinaryExprNode &>(**spine.back()).left);
+        for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+        {
+            auto *bin = static_cast<BinaryExprNode *>((*it)->get());
+            internSlot(bin->right);
+            if (bin->left && bin->right && isCanonicalOperand(bin->left.get()) && isCanonicalOperand(bin->right.get()))
+                share(**it);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void HashConsTable::share(ASTNodePtr &slot)
+{
+    auto *bin = static_cast<BinaryExprNode *>(slot.get());
+    ASTNode *parent = bin->parent;
+    size_t line = bin->line, column = bin->column;
+    size_t hash = hashBinary(bin->op, structuralHash(bin->left.get()), structuralHash(bin->right.get()));
+
+    std::shared_ptr<const ASTNode> canonical;
+    auto range = table.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        auto *candidate = static_cast<const BinaryExprNode *>(it->second.get());
+        if (candidate->op == bin->op &&
+            operandsEqual(candidate->left.get(), bin->left.get()) &&
+            operandsEqual(candidate->right.get(), bin->right.get()))
+        {
+            canonical = it->second;
+            ++shared;
+            break;
+        }
+    }
+
+    if (!canonical)
+    {
+        bin->parent = nullptr;
+        canonical = std::shared_ptr<const ASTNode>(slot.release());
+        table.emplace(hash, canonical);
+    }
+
+    // The reference keeps the occurrence's own position; its type is the
+    // canonical node's, which structural equality guarantees.
+    auto reference = std::make_unique<SharedExprNode>(std::move(canonical), hash);
+    reference->parent = parent;
+    reference->line = line;
+    reference->column = column;
+    reference->resolvedType = reference->target->resolvedType;
+    slot = std::move(reference);
+}
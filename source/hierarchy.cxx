@@ -0,0 +1,177 @@
+#include <parser.hxx>
+#include <hierarchy.hxx>
+#include <visitor.hxx>
+#include <error.hxx>
+
+namespace
+{
+    bool sameSignature(const FunctionDeclNode *a, const FunctionDeclNode *b)
+    {
+        if (a->name != b->name || a->returnType != b->returnType || a->params.size() != b->params.size())
+            return false;
+        for (size_t i = 0; i < a->params.size(); ++i)
+            if (a->params[i].first != b->params[i].first)
+                return false;
+        return true;
+    }
+
+    [[noreturn]] void error(const std::string &message, const FunctionDeclNode *fn, const std::string &source)
+    {
+        Error::semantic(message, Token{TokenType::Identifier, fn->name, currentFile, fn->line, fn->column}, source);
+    }
+}
+
+void ClassHierarchy::build(ASTNode *root, const std::string &source)
+{
+    this->source = &source;
+    collect(root);
+    for (auto &[symbol, info] : classes)
+        if (symbol->baseClass)
+            classes[symbol->baseClass].subclasses.push_back(symbol);
+    for (auto &entry : classes)
+        buildVtable(entry.first);
+}
+
+void ClassHierarchy::collect(ASTNode *node)
+{
+    if (!node || node->type != ASTNodeType::Block)
+        return;
+    for (auto &child : static_cast<BlockNode *>(node)->children)
+    {
+        if (child->type != ASTNodeType::ClassDecl)
+            continue;
+        auto *cls = static_cast<ClassDeclNode *>(child.get());
+        classes[cls->symbol].decl = cls;
+        collect(cls->body.get());
+    }
+}
+
+void ClassHierarchy::buildVtable(const Symbol *cls)
+{
+    ClassInfo &info = classes[cls];
+    if (info.built)
+        return;
+    info.built = true;
+
+    if (cls->baseClass)
+    {
+        buildVtable(cls->baseClass);
+        info.vtable = classes[cls->baseClass].vtable;
+    }
+
+    if (!info.decl->body)
+        return;
+
+    for (auto &child : static_cast<BlockNode *>(info.decl->body.get())->children)
+    {
+        if (child->type != ASTNodeType::FunctionDecl)
+            continue;
+        auto *fn = static_cast<FunctionDeclNode *>(child.get());
+
+        int inherited = -1;
+        for (size_t i = 0; i < info.vtable.size(); ++i)
+            if (sameSignature(static_cast<FunctionDeclNode *>(info.vtable[i]->decl), fn))
+                inherited = static_cast<int>(i);
+
+        switch (fn->modifier)
+        {
+        case ModifierType::Override:
+            if (inherited < 0)
+                error("Method '" + fn->name + "' is marked override but overrides no virtual method", fn, *source);
+            info.vtable[inherited] = fn->symbol;
+            slots[fn->symbol] = inherited;
+            break;
+        case ModifierType::Virtual:
+            if (inherited >= 0)
+                error("Method '" + fn->name + "' redeclares an inherited virtual method, mark it override", fn, *source);
+            slots[fn->symbol] = static_cast<int>(info.vtable.size());
+            info.vtable.push_back(fn->symbol);
+            break;
+        default:
+            if (inherited >= 0)
+                error("Method '" + fn->name + "' hides an inherited virtual method, mark it override", fn, *source);
+            break;
+        }
+    }
+}
+
+Symbol *ClassHierarchy::implementation(const Symbol *cls, const Symbol *method) const
+{
+    int index = slot(method);
+    if (index < 0)
+        return const_cast<Symbol *>(method);
+    return classes.at(cls).vtable[index];
+}
+
+Symbol *ClassHierarchy::uniqueImplementation(const Symbol *cls, const Symbol *method) const
+{
+    Symbol *unique = implementation(cls, method);
+    std::vector<const Symbol *> pending(classes.at(cls).subclasses);
+    while (!pending.empty())
+    {
+        const Symbol *sub = pending.back();
+        pending.pop_back();
+        if (implementation(sub, method) != unique)
+            return nullptr;
+        const auto &subclasses = classes.at(sub).subclasses;
+        pending.insert(pending.end(), subclasses.begin(), subclasses.end());
+    }
+    return unique;
+}
+
+namespace
+{
+    struct Devirtualizer : ASTVisitor<Devirtualizer, void, false>
+    {
+        const ClassHierarchy &hierarchy;
+        const Symbol *currentClass = nullptr;
+        size_t count = 0;
+
+        explicit Devirtualizer(const ClassHierarchy &hierarchy) : hierarchy(hierarchy) {}
+
+        void visitClassDecl(ClassDeclNode *cls)
+        {
+            const Symbol *saved = currentClass;
+            currentClass = cls->symbol;
+            visit(cls->body.get());
+            currentClass = saved;
+        }
+
+        void visitCallNode(CallExprNode *call)
+        {
+            if (call->dispatch != DispatchKind::Virtual)
+                return;
+
+            Symbol *target = nullptr;
+            const ASTNode *receiver = call->receiver.get();
+            if (receiver && receiver->type == ASTNodeType::FunctionCall &&
+                static_cast<const CallExprNode *>(receiver)->symbol->kind == SymbolKind::Class)
+            {
+                // A new instance has exactly the class it was created as.
+                target = hierarchy.implementation(static_cast<const CallExprNode *>(receiver)->symbol, call->symbol);
+            }
+            else
+            {
+                const Symbol *cls = receiver ? receiver->resolvedType->classSymbol : currentClass;
+                target = hierarchy.uniqueImplementation(cls, call->symbol);
+            }
+
+            if (target)
+            {
+                call->symbol = target;
+                call->dispatch = DispatchKind::Direct;
+                ++count;
+            }
+        }
+
+        // Shared subtrees are pure, so they hold no calls.
+        void visitSharedExpr(SharedExprNode *) {}
+    };
+}
+
+size_t devirtualize(ASTNode *root, const ClassHierarchy &hierarchy)
+{
+    Devirtualizer devirtualizer(hierarchy);
+    devirtualizer.visit(root);
+    return devirtualizer.count;
+}
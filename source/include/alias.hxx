@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ast.hxx>
+#include <token.hxx>
+#include <interner.hxx>
+
+enum class AliasKind : uint8_t
+{
+    Type,    /**< typedef: names a canonical Type */
+    Keyword, /**< define: lexes as another keyword */
+    Constant /**< enumerator: an integer of the given type */
+};
+
+struct Alias
+{
+    AliasKind kind;
+    Type type;
+    TokenType keyword;
+    int64_t value = 0;
+};
+
+/**
+ * @brief Flat table of typedef/define aliases and enumerators.
+ *
+ * Aliases are resolved when they are declared, so an alias of an alias maps
+ * straight to the canonical Type or keyword and a lookup is a single hash
+ * probe. An enumeration is a Type alias of int32 whose members are Constant
+ * entries named Enumeration.Member. The table can be saved to and loaded from a compact binary file, so
+ * a shared prelude does not have to be re-parsed for every file.
+ */
+class AliasTable
+{
+public:
+    /** @brief Adds an alias; false if the name is already bound to something else */
+    bool define(std::string_view name, const Alias &alias);
+    void merge(const AliasTable &other);
+
+    const Alias *find(std::string_view name) const
+    {
+        if (entries.empty())
+            return nullptr;
+        InternId id = names.find(name);
+        return id == StringInterner::None ? nullptr : &entries[id];
+    }
+
+    bool empty() const { return entries.empty(); }
+    size_t size() const { return entries.size(); }
+
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+private:
+    StringInterner names;
+    std::vector<Alias> entries; // indexed by InternId
+};
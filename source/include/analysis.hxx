@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <ir.hxx>
+#include <dominators.hxx>
+
+/** @brief A natural loop: the header and every block that reaches a latch without passing it */
+struct Loop
+{
+    BlockId header;
+    std::vector<BlockId> latches; /**< Sources of the back edges */
+    std::vector<BlockId> blocks;  /**< Including the header */
+    int parent = -1;              /**< Enclosing loop */
+    unsigned depth = 1;
+};
+
+/**
+ * @brief Loop nest of a function, found from back edges to dominating
+ * headers. Back edges sharing a header form one loop.
+ */
+struct LoopInfo
+{
+    std::vector<Loop> loops; /**< Outer loops before the loops they contain */
+    std::vector<int> loopOf; /**< Innermost loop of each block, -1 outside loops */
+
+    void compute(const Function &fn, const DominatorTree &dom);
+
+    unsigned depth(BlockId block) const { return loopOf[block] < 0 ? 0 : loops[loopOf[block]].depth; }
+};
+
+/**
+ * @brief Values live on entry to and exit from each block.
+ *
+ * A phi operand is a use at the end of the predecessor it comes from, not
+ * in the phi's block, and a phi is defined at the top of its block.
+ */
+struct Liveness
+{
+    size_t words = 0;
+    std::vector<uint64_t> in, out; /**< One bitset of `words` words per block */
+
+    void compute(const Function &fn, const DominatorTree &dom);
+
+    bool liveIn(BlockId block, ValueId value) const { return test(in, block, value); }
+    bool liveOut(BlockId block, ValueId value) const { return test(out, block, value); }
+
+private:
+    bool test(const std::vector<uint64_t> &sets, BlockId block, ValueId value) const
+    {
+        return sets[block * words + value / 64] >> (value % 64) & 1;
+    }
+};
+
+namespace Analysis
+{
+    enum : unsigned
+    {
+        Dominators = 1 << 0,
+        Loops = 1 << 1,
+        Liveness = 1 << 2
+    };
+
+    constexpr size_t Count = 3;
+    const char *name(size_t index);
+}
+
+/** @brief Set of Analysis bits a pass leaves valid */
+using AnalysisSet = unsigned;
+
+constexpr AnalysisSet PreserveNone = 0;
+constexpr AnalysisSet PreserveAll = ~0u;
+/** @brief For passes that change instructions but not blocks or edges */
+constexpr AnalysisSet PreserveCFG = Analysis::Dominators | Analysis::Loops;
+
+/** @brief Time spent computing analyses, shared by every thread */
+struct AnalysisStats
+{
+    std::atomic<uint64_t> nanos[Analysis::Count] = {};
+    std::atomic<uint64_t> computed[Analysis::Count] = {};
+    std::atomic<uint64_t> reused[Analysis::Count] = {};
+};
+
+/**
+ * @brief Lazily computed analyses of one function.
+ *
+ * Results stay cached until a pass reports that it did not preserve them;
+ * dropping the dominator tree also drops the loops found with it.
+ */
+class FunctionAnalyses
+{
+public:
+    explicit FunctionAnalyses(const Function &fn, AnalysisStats *stats = nullptr) : fn(&fn), stats(stats) {}
+
+    const DominatorTree &dominators();
+    const LoopInfo &loops();
+    const Liveness &liveness();
+
+    void invalidate(AnalysisSet preserved);
+
+private:
+    const Function *fn;
+    AnalysisStats *stats;
+    unsigned valid = 0;
+    std::unique_ptr<DominatorTree> dom;
+    std::unique_ptr<LoopInfo> loopInfo;
+    std::unique_ptr<Liveness> live;
+
+    template <typename Compute>
+    void ensure(unsigned analysis, Compute &&compute);
+};
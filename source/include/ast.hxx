@@ -4,6 +4,7 @@
 #include <memory>
 #include <variant>
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 enum class ModifierType
@@ -58,8 +59,11 @@ enum class ASTNodeType
     FunctionCall,
     AssignExpr,
     ClassDecl,
+    SharedExpr,
 };
 struct ASTNode;
+struct Symbol;
+struct TypeInfo;
 
 using ASTNodePtr = std::unique_ptr<ASTNode>;
 using ASTNodeList = std::vector<ASTNodePtr>;
@@ -68,6 +72,8 @@ struct ASTNode
 {
     ASTNodeType type;
     ASTNode *parent;
+    size_t line = 0, column = 0;             /**< Position of the token the node was parsed from */
+    const TypeInfo *resolvedType = nullptr; /**< Set by the type checker */
 
     ASTNode(ASTNodeType t) : type(t), parent(nullptr) {}
 
@@ -99,6 +105,7 @@ struct TypeNode : ASTNode
 struct IdentifierNode : ASTNode
 {
     std::string name;
+    Symbol *symbol = nullptr; /**< Declaration bound by name resolution */
     IdentifierNode(std::string n) : ASTNode(ASTNodeType::Identifier), name(std::move(n)) {}
 };
 
@@ -110,6 +117,8 @@ struct BinaryExprNode : ASTNode
 
     BinaryExprNode(std::string o, ASTNodePtr l, ASTNodePtr r)
         : ASTNode(ASTNodeType::BinaryExpr), op(std::move(o)), left(std::move(l)), right(std::move(r)) {}
+
+    ~BinaryExprNode() override;
 };
 
 struct FunctionDeclNode : ASTNode
@@ -120,6 +129,17 @@ struct FunctionDeclNode : ASTNode
     ASTNodePtr body;
     AccessType access;
     ModifierType modifier;
+    std::vector<std::string> attributes; /**< Names from a preceding [attribute, ...] list */
+    Symbol *symbol = nullptr;
+    std::vector<Symbol *> paramSymbols;
+
+    bool hasAttribute(std::string_view attribute) const
+    {
+        for (const auto &a : attributes)
+            if (a == attribute)
+                return true;
+        return false;
+    }
 
     FunctionDeclNode(ModifierType modifier, std::string name, std::vector<std::pair<Type, std::string>> params, Type returnType, ASTNodePtr body, AccessType access)
         : ASTNode(ASTNodeType::FunctionDecl), name(std::move(name)), params(std::move(params)), returnType(returnType), body(std::move(body)), access(access), modifier(std::move(modifier)) {}
@@ -139,6 +159,7 @@ struct VarDeclNode : ASTNode
     ASTNodePtr value;
     ModifierType modifier;
     AccessType access;
+    Symbol *symbol = nullptr;
 
     VarDeclNode(bool isConst, std::string n, Type t, ASTNodePtr v, ModifierType modifier, AccessType access)
         : ASTNode(ASTNodeType::VarDecl), isConst(isConst), name(std::move(n)), varType(t), value(std::move(v)), modifier(std::move(modifier)), access(access) {}
@@ -152,12 +173,42 @@ struct IfExprNode : ASTNode
 
     IfExprNode(ASTNodePtr cond, ASTNodePtr thenB, ASTNodePtr elseB = nullptr)
         : ASTNode(ASTNodeType::IfExpr), condition(std::move(cond)), thenBranch(std::move(thenB)), elseBranch(std::move(elseB)) {}
+
+    ~IfExprNode() override;
+};
+
+struct ForExprNode : ASTNode
+{
+    ASTNodePtr init;      /**< Variable declaration or expression; may be null */
+    ASTNodePtr condition; /**< Null loops until a return */
+    ASTNodePtr step;      /**< May be null */
+    ASTNodePtr body;
+
+    ForExprNode(ASTNodePtr init, ASTNodePtr cond, ASTNodePtr step, ASTNodePtr body)
+        : ASTNode(ASTNodeType::ForExpr), init(std::move(init)), condition(std::move(cond)), step(std::move(step)), body(std::move(body)) {}
+};
+
+struct MatchArm
+{
+    ASTNodeList patterns; /**< Literals of the subject's type, or enumerators */
+    ASTNodePtr body;
+};
+
+struct MatchExprNode : ASTNode
+{
+    ASTNodePtr subject; /**< Integer, byte or string */
+    std::vector<MatchArm> arms;
+    ASTNodePtr otherwise; /**< The else arm; may be null */
+
+    MatchExprNode(ASTNodePtr subject, std::vector<MatchArm> arms, ASTNodePtr otherwise)
+        : ASTNode(ASTNodeType::MatchExpr), subject(std::move(subject)), arms(std::move(arms)), otherwise(std::move(otherwise)) {}
 };
 
 struct AssignExprNode : ASTNode
 {
     std::string name;
     ASTNodePtr value;
+    Symbol *symbol = nullptr;
 
     AssignExprNode(std::string name, ASTNodePtr value)
         : ASTNode(ASTNodeType::AssignExpr), name(std::move(name)), value(std::move(value)) {}
@@ -168,9 +219,63 @@ struct ClassDeclNode : ASTNode
     std::string name;
     AccessType access;
     ASTNodePtr body;
+    std::string baseName; /**< Empty when the class has no base */
+    bool isStructure = false;
+    std::vector<std::string> attributes; /**< Names from a preceding [attribute, ...] list */
+    Symbol *symbol = nullptr;
+
+    bool hasAttribute(std::string_view attribute) const
+    {
+        for (const auto &a : attributes)
+            if (a == attribute)
+                return true;
+        return false;
+    }
 
     ClassDeclNode(std::string name, AccessType access, ASTNodePtr body)
         : ASTNode(ASTNodeType::ClassDecl), name(std::move(name)), access(std::move(access)), body(std::move(body)) {}
 };
 
+enum class DispatchKind
+{
+    Static,  /**< Free function or non-virtual method */
+    Virtual, /**< Through the receiver's vtable */
+    Direct   /**< Virtual method bound by devirtualization */
+};
+
+/**
+ * @brief Call of a function or method, or instantiation of a class.
+ *
+ * receiver is the object of `a.f()` and null for an unqualified call, which
+ * inside a method targets the current instance.
+ */
+struct CallExprNode : ASTNode
+{
+    std::string name;
+    ASTNodePtr receiver;
+    ASTNodeList args;
+    Symbol *symbol = nullptr; /**< Callee, or the class being instantiated */
+    DispatchKind dispatch = DispatchKind::Static;
+
+    CallExprNode(std::string name, ASTNodePtr receiver, ASTNodeList args)
+        : ASTNode(ASTNodeType::FunctionCall), name(std::move(name)), receiver(std::move(receiver)), args(std::move(args)) {}
+
+    ~CallExprNode() override;
+};
+
+/**
+ * @brief Reference to a hash-consed expression subtree.
+ *
+ * Produced by HashConsTable; every occurrence of a structurally identical
+ * pure expression points at the same immutable canonical node.
+ */
+struct SharedExprNode : ASTNode
+{
+    std::shared_ptr<const ASTNode> target;
+    size_t hash;
+
+    SharedExprNode(std::shared_ptr<const ASTNode> target, size_t hash)
+        : ASTNode(ASTNodeType::SharedExpr), target(std::move(target)), hash(hash) {}
+};
+
 void printAST(const ASTNode *node, int indentLevel = 0);
\ No newline at end of file
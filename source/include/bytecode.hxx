@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <ir.hxx>
+
+/*
+ * Every instruction starts with a word holding the opcode in its low 8 bits
+ * and operand A, usually the destination register, in the upper 24. The
+ * operand words listed after the name follow it; Call and CallVirtual end
+ * with one word per argument register, and Switch with its jump table.
+ *
+ *   X(name, operand words)
+ */
+#define VSHARP_BYTECODE(X)                                                          \
+    X(Mov, 1)         /* A = B */                                                   \
+    X(LoadK, 2)       /* A = 64-bit constant, low word first */                     \
+    X(LoadStr, 1)     /* A = string constant B */                                   \
+    X(Add, 2)         /* A = B + C, wrapping at 64 bits */                          \
+    X(Sub, 2)                                                                       \
+    X(Mul, 2)                                                                       \
+    X(Or, 2)                                                                        \
+    X(And, 2)                                                                       \
+    X(Shl, 2)         /* A = B << C; C is below 64 */                               \
+    X(ShrS, 2)                                                                      \
+    X(ShrU, 2)                                                                      \
+    X(MulHiS, 2)      /* A = high 64 bits of B * C */                               \
+    X(MulHiU, 2)                                                                    \
+    X(AddI32, 2)      /* 32-bit signed arithmetic, result sign-extended */          \
+    X(SubI32, 2)                                                                    \
+    X(MulI32, 2)                                                                    \
+    X(DivS, 2)        /* Division traps on zero; min / -1 wraps */                  \
+    X(DivU, 2)                                                                      \
+    X(RemS, 2)                                                                      \
+    X(RemU, 2)                                                                      \
+    X(Norm, 1)        /* Wraps A in place to the width kind B */                    \
+    X(AddF64, 2)                                                                    \
+    X(SubF64, 2)                                                                    \
+    X(MulF64, 2)                                                                    \
+    X(DivF64, 2)                                                                    \
+    X(AddF32, 2)      /* float32 is held as a double and rounded after each op */   \
+    X(SubF32, 2)                                                                    \
+    X(MulF32, 2)                                                                    \
+    X(DivF32, 2)                                                                    \
+    X(Eq, 2)          /* A = B == C on the raw bits */                              \
+    X(Ne, 2)                                                                        \
+    X(LtS, 2)                                                                       \
+    X(LeS, 2)                                                                       \
+    X(LtU, 2)                                                                       \
+    X(LeU, 2)                                                                       \
+    X(EqF, 2)                                                                       \
+    X(NeF, 2)                                                                       \
+    X(LtF, 2)                                                                       \
+    X(LeF, 2)                                                                       \
+    X(Concat, 2)                                                                    \
+    X(EqStr, 2)                                                                     \
+    X(NeStr, 2)                                                                     \
+    X(HashStr, 3)     /* A = FNV-1a of string B from the 64-bit basis C, D */       \
+    X(Jmp, 1)         /* Jump to code offset B */                                   \
+    X(Jt, 1)          /* Jump to B if A is true */                                  \
+    X(Jf, 1)          /* Jump to B if A is false */                                 \
+    X(Switch, 3)      /* Jump to entry A - low (B, C) of the D entries after it, */ \
+                      /* or to the default entry that follows them */               \
+    X(Ret, 0)         /* Return A */                                                \
+    X(RetVoid, 0)                                                                   \
+    X(Call, 2)        /* A = function B (C arguments, then the registers) */        \
+    X(CallVirtual, 3) /* A = slot B of the vtable at offset C of argument 0, D args */ \
+    X(New, 1)         /* A = new instance of class B */                             \
+    X(NewLocal, 2)    /* A = zeroed instance of class B in registers C and up */    \
+    X(LoadGlobal, 1)  /* A = global B */                                            \
+    X(StoreGlobal, 1) /* global B = A */                                            \
+    X(LoadI8, 2)      /* A = field at B + offset C */                               \
+    X(LoadU8, 2)                                                                    \
+    X(LoadI16, 2)                                                                   \
+    X(LoadU16, 2)                                                                   \
+    X(LoadI32, 2)                                                                   \
+    X(LoadU32, 2)                                                                   \
+    X(Load64, 2)                                                                    \
+    X(LoadF32, 2)                                                                   \
+    X(Store8, 2)      /* field at B + offset C = A */                               \
+    X(Store16, 2)                                                                   \
+    X(Store32, 2)                                                                   \
+    X(Store64, 2)                                                                   \
+    X(StoreF32, 2)
+
+enum class Bytecode : uint8_t
+{
+#define VSHARP_BYTECODE_ENUM(name, words) name,
+    VSHARP_BYTECODE(VSHARP_BYTECODE_ENUM)
+#undef VSHARP_BYTECODE_ENUM
+    Count
+};
+
+/** @brief Width kinds of Bytecode::Norm */
+enum class NormKind : uint8_t
+{
+    Bool,
+    I8,
+    U8,
+    I16,
+    U16,
+    I32,
+    U32
+};
+
+/** @brief Register A of call instructions whose result is discarded */
+constexpr uint32_t NoRegister = 0xffffff;
+
+struct BytecodeFunction
+{
+    std::string name;
+    uint32_t entry = 0;     /**< Code offset of the first instruction */
+    uint32_t frameSize = 0; /**< Registers, parameters first */
+    uint32_t params = 0;
+    bool returnsValue = false;
+    std::vector<uint32_t> blocks; /**< Code offset of each IR block */
+};
+
+struct BytecodeClass
+{
+    std::string name;
+    uint32_t size = 0;
+    bool hasVptr = false;
+    uint32_t vptrOffset = 0;
+    std::vector<uint32_t> vtable; /**< Function indices */
+};
+
+/**
+ * @brief A module compiled for the VM: one code array shared by every
+ * function, plus the constant, global and class tables it refers to.
+ */
+struct BytecodeProgram
+{
+    std::vector<uint32_t> code;
+    std::vector<BytecodeFunction> functions;
+    std::vector<BytecodeClass> classes;
+    std::vector<std::string> strings;
+    std::vector<uint64_t> globals;    /**< Initial values, string globals as string indices */
+    std::vector<bool> stringGlobals;  /**< Globals whose initial value is a string index */
+    uint32_t initializer = 0;
+    int entry = -1;
+
+    void disassemble(FILE *out) const;
+};
+
+/**
+ * @brief The VM register holding each value of a function, NoRegister for
+ * values without one. A value keeps its register for the whole call.
+ */
+std::vector<uint32_t> valueRegisters(const Function &fn);
+
+/** @brief Number of words an instruction starting at code[pc] occupies */
+size_t instructionSize(const uint32_t *code);
+
+const char *toString(Bytecode op);
+
+/**
+ * @brief Compiles SSA IR to register bytecode. Every value gets its own
+ * register; phis become copies on the incoming edges.
+ */
+BytecodeProgram compileBytecode(const Module &module);
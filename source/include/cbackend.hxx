@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdio>
+#include <ir.hxx>
+
+/**
+ * @brief Translates a module to a self-contained C99 translation unit.
+ *
+ * Classes become structs with their fields at the offsets the layout
+ * engine chose and a table of function pointers for their virtual methods;
+ * integers map to the <stdint.h> types of the same width. Each function
+ * keeps its SSA shape: one local per value and a label per block. Wrapping
+ * arithmetic goes through unsigned types, so the output has no undefined
+ * behaviour for the C compiler to exploit. A module with main gets a C
+ * main that runs the module initializer first.
+ */
+void emitC(const Module &module, FILE *out);
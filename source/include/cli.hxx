@@ -3,8 +3,15 @@
 #include <string>
 #include <vector>
 
+class AliasTable;
+
 void printHelp();
 
 void printVersion();
 
+/** @brief Adds the aliases of a saved alias table or a V# source prelude to `aliases` */
+bool loadPrelude(const std::string &path, AliasTable &aliases);
+
 void compileFile(const std::string &filename, const std::vector<std::string>& flags);
+
+void runFile(const std::string &filename, const std::vector<std::string> &flags);
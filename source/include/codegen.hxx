@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <elf.hxx>
+#include <ir.hxx>
+
+/** @brief Helpers generated code calls; names are their link-time symbols */
+enum class RuntimeFunction : uint8_t
+{
+    Calloc,
+    Strcmp,
+    Strlen,
+    Malloc,
+    Strcpy,
+    Strcat,
+    Concat, /**< vsharp_concat(a, b): a freshly allocated a + b */
+    Trap    /**< vsharp_trap(): integer division by zero; does not return */
+};
+
+const char *runtimeName(RuntimeFunction function);
+
+/** @brief What a 32-bit field of generated code refers to */
+enum class NativeTarget : uint8_t
+{
+    Function, /**< rel32 of a call; index into Module::functions */
+    Runtime,  /**< rel32 of a call; a RuntimeFunction */
+    Global,   /**< RIP-relative; index into Module::globals */
+    String,   /**< RIP-relative; index into Module::strings */
+    Vtable    /**< RIP-relative; index into Module::classes */
+};
+
+struct NativeRelocation
+{
+    uint32_t offset; /**< Of the 32-bit field in NativeFunction::code */
+    NativeTarget target;
+    uint32_t index;
+};
+
+/** @brief Machine code of one function, position independent up to its relocations */
+struct NativeFunction
+{
+    std::vector<uint8_t> code;
+    std::vector<NativeRelocation> relocations;
+    size_t instructions = 0; /**< Machine instructions emitted */
+};
+
+/**
+ * @brief Compiles one function to x86-64 using the System V calling
+ * convention.
+ *
+ * Values live in the registers allocateRegisters gives them or in spill
+ * slots, going through fixed scratch registers where an instruction needs
+ * them, in a single pass over the blocks. Above -O0, the function is first
+ * strength reduced (see reduceStrength), comparisons feeding only the
+ * branch right after them are fused into it, constant operands become
+ * immediates, integer results are computed in their own registers with lea
+ * where it saves an instruction, and the Assembler's peephole rules run on
+ * the code as it is emitted. Strings are NUL-terminated char pointers and
+ * objects come from calloc; integer division by zero calls vsharp_trap.
+ *
+ * At -O2, loops that only reduce 64-bit integers into accumulators (see
+ * ReductionLoop) first run whole vectors of iterations at once, two lanes
+ * wide with SSE2 or four with avx2, and leave the rest to the scalar loop.
+ */
+NativeFunction compileX86(const Module &module, const Function &fn, unsigned optLevel, bool avx2 = false);
+
+/** @brief vsharp_concat, for when no runtime library provides it */
+NativeFunction concatHelperX86();
+
+/** @brief vsharp_trap for objects, which raises SIGFPE like an unguarded divide */
+NativeFunction trapHelperX86();
+
+/** @brief Link-time symbol of a V# function */
+std::string nativeSymbol(const Function &fn);
+
+/**
+ * @brief Compiles a module into a relocatable object. Functions are
+ * global symbols named by nativeSymbol; a module with main also gets a C
+ * main that runs the module initializer first. Division by zero raises
+ * SIGFPE.
+ */
+ElfObject emitObject(const Module &module, unsigned optLevel, bool avx2 = false);
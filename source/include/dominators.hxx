@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <ir.hxx>
+
+/**
+ * @brief Dominator tree of a function's CFG.
+ *
+ * Computed with the iterative algorithm of Cooper, Harvey and Kennedy over
+ * reverse post-order, which is simple and fast for the small, reducible
+ * graphs structured code produces. Only blocks reachable from the entry
+ * are part of the tree.
+ */
+struct DominatorTree
+{
+    std::vector<BlockId> idom;                  /**< Immediate dominator, NoBlock for the entry and unreachable blocks */
+    std::vector<BlockId> rpo;                   /**< Reachable blocks in reverse post-order */
+    std::vector<uint32_t> order;                /**< Position of each block in rpo, UINT32_MAX if unreachable */
+    std::vector<std::vector<BlockId>> children; /**< Dominator tree edges */
+    std::vector<uint32_t> enter, exit;          /**< DFS interval of each block in the tree */
+
+    void compute(const Function &fn);
+
+    bool reachable(BlockId block) const { return order[block] != UINT32_MAX; }
+
+    /** @brief True when a dominates b; every block dominates itself. O(1). */
+    bool dominates(BlockId a, BlockId b) const
+    {
+        return reachable(a) && reachable(b) && enter[a] <= enter[b] && exit[b] <= exit[a];
+    }
+};
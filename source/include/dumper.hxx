@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <ast.hxx>
+
+enum class DumpFormat
+{
+    Text,
+    Json,
+    SExpr
+};
+
+/**
+ * @brief Large reusable output buffer written out with fwrite in big blocks.
+ */
+class OutputBuffer
+{
+public:
+    static constexpr size_t DefaultCapacity = 1 << 16;
+
+    explicit OutputBuffer(std::FILE *out, size_t capacity = DefaultCapacity);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void write(std::string_view text)
+    {
+        if (text.size() > capacity - used)
+            return writeSlow(text);
+        std::memcpy(data.get() + used, text.data(), text.size());
+        used += text.size();
+    }
+    void put(char c)
+    {
+        if (used == capacity)
+            flush();
+        data[used++] = c;
+    }
+    void indent(size_t n);
+    void integer(int64_t value);
+    void unsignedInteger(uint64_t value);
+    void floating(double value, int precision);
+    void flush();
+
+private:
+    std::FILE *out;
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t used = 0;
+
+    void writeSlow(std::string_view text);
+};
+
+/**
+ * @brief Dumps an AST as indented text (the --emit-ast layout), JSON or
+ * S-expressions.
+ *
+ * dump() writes a whole tree. For streaming, call begin(), then item() for
+ * each top-level node as it finishes parsing, then end(); the result is
+ * identical to dumping the finished program block.
+ */
+class ASTDumper
+{
+public:
+    ASTDumper(std::FILE *out, DumpFormat format);
+
+    void dump(const ASTNode *root, int indentLevel = 0);
+
+    void begin();
+    void item(const ASTNode *node);
+    void end();
+
+private:
+    OutputBuffer buffer;
+    DumpFormat format;
+    size_t items = 0;
+};
+
+bool parseDumpFormat(std::string_view name, DumpFormat &format);
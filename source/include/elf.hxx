@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** @brief x86-64 relocation types the code generators emit */
+namespace ElfReloc
+{
+    constexpr uint32_t Abs64 = 1;
+    constexpr uint32_t PC32 = 2;
+    constexpr uint32_t PLT32 = 4;
+}
+
+/**
+ * @brief A relocatable x86-64 ELF64 object with .text, .data and .rodata,
+ * written without going through an assembler.
+ *
+ * Symbols may be added in any order; locals are moved before globals when
+ * the file is written, as the format requires.
+ */
+class ElfObject
+{
+public:
+    enum Section : uint16_t
+    {
+        Undefined = 0,
+        Text = 1,
+        Data = 2,
+        Rodata = 3
+    };
+
+    ElfObject();
+
+    std::vector<uint8_t> &contents(Section section) { return sections[section - 1].bytes; }
+
+    /** @brief Symbol of a section's start, for section-relative relocations */
+    uint32_t sectionSymbol(Section section) const { return section; }
+
+    uint32_t defineSymbol(const std::string &name, Section section, uint64_t value, uint64_t size, bool global, bool function);
+
+    /** @brief Sets the value and size of a defined symbol, once its contents are placed */
+    void placeSymbol(uint32_t symbol, uint64_t value, uint64_t size);
+
+    /** @brief An undefined global resolved by the linker, added once per name */
+    uint32_t externalSymbol(const std::string &name);
+
+    void relocate(Section section, uint64_t offset, uint32_t symbol, uint32_t type, int64_t addend);
+
+    std::vector<uint8_t> serialize() const;
+    bool write(const std::string &path) const;
+
+private:
+    struct Symbol
+    {
+        std::string name;
+        Section section;
+        uint64_t value, size;
+        bool global, function, isSection;
+    };
+
+    struct Relocation
+    {
+        uint64_t offset;
+        uint32_t symbol;
+        uint32_t type;
+        int64_t addend;
+    };
+
+    struct Contents
+    {
+        std::vector<uint8_t> bytes;
+        std::vector<Relocation> relocations;
+    };
+
+    Contents sections[3];
+    std::vector<Symbol> symbols;
+    std::unordered_map<std::string, uint32_t> externals;
+};
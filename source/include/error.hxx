@@ -22,6 +22,13 @@ struct CompileError
 
 namespace Error
 {
+    /**
+     * @brief When enabled, errors are thrown as CompileError instead of
+     * being printed and terminating the process (used by the LSP and fuzzers).
+     */
+    void setThrowing(bool enabled);
+    bool isThrowing();
+
     [[noreturn]]
     void report(const CompileError &err, std::string_view source);
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ir.hxx>
+#include <threadpool.hxx>
+
+struct EscapeOptions
+{
+    static constexpr uint64_t MaxFrameObject = 256; /**< Largest instance given frame space, in bytes */
+
+    FILE *remarks = nullptr; /**< Gets one line per allocation */
+};
+
+/** @brief What promoteAllocations did with the module's allocation sites */
+struct EscapeResult
+{
+    size_t sites = 0;    /**< New instructions before */
+    size_t stack = 0;    /**< Turned into NewLocal */
+    size_t replaced = 0; /**< Scalar-replaced, so no longer allocated at all */
+
+    size_t heap() const { return sites - stack - replaced; }
+    bool changed() const { return stack || replaced; }
+};
+
+/**
+ * @brief Interprocedural escape analysis of class instances.
+ *
+ * An instance escapes when it is stored anywhere, returned, merged by a
+ * phi, or passed to a parameter that escapes; reading or writing its
+ * fields, comparing it and calling methods whose receiver does not escape
+ * keep it local. Parameter summaries are solved over the call graph to a
+ * fixed point, and a virtual call counts every override its slot can reach.
+ *
+ * An instance that does not escape, whose fields are only accessed in the
+ * block that creates it, is scalar-replaced: loads take the value last
+ * stored, or zero, and the allocation disappears. Other instances that do
+ * not escape and are at most MaxFrameObject bytes become NewLocal, which
+ * the backends place in the frame.
+ */
+EscapeResult promoteAllocations(Module &module, ThreadPool &pool, const EscapeOptions &options);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <ast.hxx>
+
+/**
+ * @brief Evaluates constant binary expressions and propagates literal `const`
+ * declarations into their uses.
+ *
+ * Integer arithmetic wraps at the width of the operand type, float32 is
+ * evaluated in single precision. Division by a constant zero is left for the
+ * runtime. Expects a type-checked tree; returns the number of folded nodes.
+ */
+size_t foldConstants(ASTNodePtr &root);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <dominators.hxx>
+#include <ir.hxx>
+#include <threadpool.hxx>
+
+/**
+ * @brief Global value numbering: replaces every computation that repeats
+ * one dominating it by the earlier value.
+ *
+ * Blocks are visited in dominator-tree order with a scoped hash table of
+ * the values available so far, so the cost is linear in the size of the
+ * function. Constants, arithmetic, comparisons and phis are numbered
+ * everywhere, and so are loads of const globals, which only the module
+ * initializer stores. Other loads are reused while no store or call can
+ * have intervened: within a block, and into a block whose only predecessor
+ * is its dominator. Returns true when the function changed.
+ */
+bool numberValues(Function &fn, const DominatorTree &dom, const std::vector<bool> &immutableGlobals);
+
+/** @brief Runs numberValues on every function of a module, in parallel */
+bool numberValues(Module &module, ThreadPool &pool);
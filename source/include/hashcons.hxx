@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <ast.hxx>
+
+/**
+ * @brief Hash of an expression subtree that is equal for structurally equal
+ * trees. Shared subtrees hash like the subtree they stand for.
+ */
+size_t structuralHash(const ASTNode *node);
+
+/**
+ * @brief Deep structural comparison, looking through SharedExprNode.
+ * Resolved identifiers are equal only when bound to the same symbol.
+ */
+bool structurallyEqual(const ASTNode *a, const ASTNode *b);
+
+/** @brief True for expressions without side effects (literals, identifiers, operators over those). */
+bool isPureExpression(const ASTNode *node);
+
+/**
+ * @brief Hash-consing of pure expression subtrees.
+ *
+ * intern() rewrites a tree bottom-up so that every pure binary expression is
+ * replaced by a SharedExprNode, and structurally identical ones share a
+ * single canonical node. Because children are canonicalised before their
+ * parent, candidates are compared shallowly and the pass is linear in the
+ * size of the tree.
+ *
+ * Run it after type checking, which adapts literals to their context:
+ * canonical nodes are shared, so per-occurrence annotations cannot be
+ * attached to them afterwards. Constant folding and lowering handle each
+ * canonical node once however many occurrences refer to it.
+ */
+class HashConsTable
+{
+public:
+    void intern(ASTNodePtr &root);
+
+    size_t uniqueCount() const { return table.size(); }
+    size_t sharedCount() const { return shared; }
+
+private:
+    std::unordered_multimap<size_t, std::shared_ptr<const ASTNode>> table;
+    size_t shared = 0;
+
+    void internSlot(ASTNodePtr &slot);
+    void share(ASTNodePtr &slot);
+};
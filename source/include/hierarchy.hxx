@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <ast.hxx>
+#include <symbols.hxx>
+
+/**
+ * @brief Whole-program class hierarchy: subclasses and vtables.
+ *
+ * build() assigns every virtual method a vtable slot, inheriting the slots
+ * of the base class, and checks that `override` methods override a virtual
+ * method with the same signature and that virtual methods are not hidden.
+ * Expects a type-checked tree.
+ */
+class ClassHierarchy
+{
+public:
+    void build(ASTNode *root, const std::string &source);
+
+    /** @brief True when instances of cls carry a vtable pointer */
+    bool hasVtable(const Symbol *cls) const
+    {
+        auto it = classes.find(cls);
+        return it != classes.end() && !it->second.vtable.empty();
+    }
+
+    /** @brief Vtable slot of a virtual method, -1 for other functions */
+    int slot(const Symbol *method) const
+    {
+        auto it = slots.find(method);
+        return it == slots.end() ? -1 : it->second;
+    }
+
+    const std::vector<Symbol *> &vtable(const Symbol *cls) const { return classes.at(cls).vtable; }
+
+    /** @brief The method an instance of exactly cls runs for a virtual method */
+    Symbol *implementation(const Symbol *cls, const Symbol *method) const;
+
+    /**
+     * @brief The single method a virtual call can reach when the receiver is
+     * cls or any of its subclasses, or null if there are several.
+     */
+    Symbol *uniqueImplementation(const Symbol *cls, const Symbol *method) const;
+
+private:
+    struct ClassInfo
+    {
+        ClassDeclNode *decl = nullptr;
+        std::vector<const Symbol *> subclasses;
+        std::vector<Symbol *> vtable;
+        bool built = false;
+    };
+
+    std::unordered_map<const Symbol *, ClassInfo> classes;
+    std::unordered_map<const Symbol *, int> slots;
+    const std::string *source = nullptr;
+
+    void collect(ASTNode *node);
+    void buildVtable(const Symbol *cls);
+};
+
+/**
+ * @brief Binds virtual calls whose target class hierarchy analysis proves
+ * unique, or whose receiver is a freshly instantiated object of known exact
+ * class, to that method. Returns the number of calls made direct.
+ */
+size_t devirtualize(ASTNode *root, const ClassHierarchy &hierarchy);
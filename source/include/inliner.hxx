@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <ir.hxx>
+#include <threadpool.hxx>
+
+struct InlineOptions
+{
+    static constexpr int SmallThreshold = 8;  /**< -O1: callees barely bigger than the call */
+    static constexpr int LargeThreshold = 40; /**< -O2 */
+
+    int threshold = SmallThreshold; /**< Highest cost inlined without an attribute */
+    FILE *remarks = nullptr;        /**< Gets one line per call considered */
+};
+
+/**
+ * @brief Replaces direct calls by a copy of the callee's body.
+ *
+ * Functions are visited bottom-up over the strongly connected components of
+ * the call graph, so a callee is measured after its own calls were inlined
+ * and cleaned up. Components whose callees are all done are processed in
+ * parallel. Calls within a component, that is recursion, are never inlined,
+ * and virtual calls only once devirtualization made them direct.
+ *
+ * A call costs the callee's size minus the work the call itself takes, minus
+ * a bonus for each use of a parameter that receives a constant. Calls up to
+ * the threshold are inlined, along with every call to an [inline] function
+ * and none to a [noinline] one. Returns true when any call was inlined.
+ */
+bool inlineCalls(Module &module, ThreadPool &pool, const InlineOptions &options);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/** @brief Dense handle of an interned string; equal strings get equal ids */
+using InternId = uint32_t;
+
+/**
+ * @brief Interns strings into dense ids using an open-addressing table.
+ *
+ * Interned text lives in append-only chunks, so the views returned by str()
+ * stay valid for the lifetime of the interner.
+ */
+class StringInterner
+{
+public:
+    static constexpr InternId None = UINT32_MAX;
+
+    InternId intern(std::string_view text);
+    InternId find(std::string_view text) const;
+
+    std::string_view str(InternId id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+
+private:
+    std::vector<std::string_view> strings;
+    std::vector<uint32_t> hashes;
+    std::vector<uint32_t> slots; // id + 1, 0 marks an empty slot
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t chunkUsed = 0;
+    size_t chunkSize = 0;
+
+    const char *store(std::string_view text);
+    void grow();
+};
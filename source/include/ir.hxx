@@ -0,0 +1,307 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ast.hxx>
+
+struct Symbol;
+
+using ValueId = uint32_t;
+using BlockId = uint32_t;
+
+constexpr ValueId NoValue = UINT32_MAX;
+constexpr BlockId NoBlock = UINT32_MAX;
+
+enum class ValueType : uint8_t
+{
+    Void,
+    Bool,
+    I8,
+    I16,
+    I32,
+    I64,
+    U8,
+    U16,
+    U32,
+    U64,
+    F32,
+    F64,
+    Byte,
+    Str,
+    Ptr
+};
+
+enum class Opcode : uint8_t
+{
+    Nop,   /**< Removed instruction */
+    Undef, /**< Read of a variable with no reaching definition */
+    Const, /**< imm: integer, double bits for floats, string index for Str */
+    Param, /**< imm: parameter index */
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Rem,
+    Or,
+    And,
+    Shl,     /**< Operands: value, constant amount below 64 */
+    Shr,     /**< Arithmetic for signed types, logical for the others */
+    MulHigh, /**< High 64 bits of the 128-bit product; signed for I64, unsigned for U64 */
+    Eq, /**< Comparisons produce Bool from two operands of the same type */
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+    Phi,         /**< Operands: value, block pairs */
+    Call,        /**< imm: function index; operands: arguments */
+    CallVirtual, /**< imm: index of the statically bound method; operands: receiver, arguments */
+    New,         /**< imm: class index; allocates a zeroed instance */
+    NewLocal,    /**< imm: class index; a zeroed instance in the frame, dead once the function returns */
+    LoadGlobal,  /**< imm: global index */
+    StoreGlobal, /**< imm: global index; operand: value */
+    LoadField,   /**< imm: byte offset; operand: object */
+    StoreField,  /**< imm: byte offset; operands: object, value */
+    Hash,        /**< U64 hashString of operand string; imm: basis */
+    Jump,        /**< imm: target block */
+    Branch,      /**< operand: condition; imm: true block | false block << 32 */
+    Switch,      /**< operand: integer; imm: index into Function::switches */
+    Return       /**< operand: value, none for void */
+};
+
+/**
+ * @brief One SSA instruction, 24 bytes.
+ *
+ * The instruction's index in its function is the id of the value it
+ * defines. Operands live in the function's operand pool, [first, first + count).
+ */
+struct Instr
+{
+    Opcode op;
+    ValueType type;
+    uint16_t count;
+    BlockId block;
+    uint32_t first;
+    uint32_t line;
+    int64_t imm;
+};
+
+/**
+ * @brief Targets of a Switch. A value v goes to targets[v - low], the
+ * difference taken as unsigned, when that is in range and to otherwise
+ * when it is not.
+ */
+struct SwitchTable
+{
+    int64_t low = 0;
+    std::vector<BlockId> targets;
+    BlockId otherwise = NoBlock;
+};
+
+/** @brief FNV-1a over the bytes of a string, from a given offset basis */
+inline uint64_t hashString(std::string_view s, uint64_t basis)
+{
+    uint64_t h = basis;
+    for (unsigned char c : s)
+        h = (h ^ c) * 0x100000001b3ull;
+    return h;
+}
+
+/** @brief High 64 bits of the full product of a and b */
+inline uint64_t mulHigh(uint64_t a, uint64_t b, bool isSigned)
+{
+    uint64_t aLow = a & 0xffffffff, aHigh = a >> 32, bLow = b & 0xffffffff, bHigh = b >> 32;
+    uint64_t low = aLow * bLow, middle = aHigh * bLow + (low >> 32), cross = aLow * bHigh + (middle & 0xffffffff);
+    uint64_t high = aHigh * bHigh + (middle >> 32) + (cross >> 32);
+    // The signed product differs by b for a negative a and by a for a negative b.
+    if (isSigned)
+        high -= (a >> 63 ? b : 0) + (b >> 63 ? a : 0);
+    return high;
+}
+
+struct BasicBlock
+{
+    std::vector<ValueId> code; /**< Phis first, terminator last */
+    std::vector<BlockId> preds, succs;
+};
+
+enum class InlineHint : uint8_t
+{
+    Default, /**< Left to the cost model */
+    Always,  /**< [inline]: whenever the call is not recursive */
+    Never    /**< [noinline] */
+};
+
+/**
+ * @brief A function in SSA form.
+ *
+ * Instructions and operands are allocated from two flat per-function
+ * arrays; blocks only list instruction ids. Block 0 is the entry.
+ */
+struct Function
+{
+    std::string name;
+    ValueType returnType = ValueType::Void;
+    std::vector<ValueType> params; /**< Instance methods take the receiver first */
+    const FunctionDeclNode *decl = nullptr;
+    const Symbol *symbol = nullptr;
+    int classIndex = -1;  /**< Owning class of a method */
+    int vtableSlot = -1;  /**< Slot of a virtual method */
+    InlineHint inlining = InlineHint::Default;
+    bool exported = false; /**< [export]: an entry point tree shaking keeps */
+
+    std::vector<Instr> instrs;
+    std::vector<ValueId> operandPool;
+    std::vector<BasicBlock> blocks;
+    std::vector<SwitchTable> switches;
+
+    BlockId addBlock()
+    {
+        blocks.emplace_back();
+        return static_cast<BlockId>(blocks.size() - 1);
+    }
+
+    /** @brief Appends an instruction to the end of a block */
+    ValueId emit(BlockId block, Opcode op, ValueType type, const ValueId *ops, size_t count, int64_t imm = 0, uint32_t line = 0);
+    ValueId emit(BlockId block, Opcode op, ValueType type, std::initializer_list<ValueId> ops = {}, int64_t imm = 0, uint32_t line = 0)
+    {
+        return emit(block, op, type, ops.begin(), ops.size(), imm, line);
+    }
+
+    /** @brief Inserts an instruction after the phis of a block */
+    ValueId emitFront(BlockId block, Opcode op, ValueType type, int64_t imm = 0);
+
+    /** @brief Gives an instruction a fresh operand list */
+    void setOperands(ValueId value, const ValueId *ops, size_t count);
+
+    ValueId *operands(ValueId value) { return operandPool.data() + instrs[value].first; }
+    const ValueId *operands(ValueId value) const { return operandPool.data() + instrs[value].first; }
+    ValueId operand(ValueId value, size_t i) const { return operandPool[instrs[value].first + i]; }
+
+    ValueId terminator(BlockId block) const { return blocks[block].code.empty() ? NoValue : blocks[block].code.back(); }
+    bool isTerminated(BlockId block) const;
+
+    /** @brief Adds a control-flow edge, keeping preds and succs in sync */
+    void addEdge(BlockId from, BlockId to);
+
+    size_t liveInstructionCount() const;
+};
+
+struct Global
+{
+    std::string name;
+    ValueType type;
+    int64_t init = 0; /**< Initial value, encoded like Const */
+    bool constant = false; /**< Declared const: stored once, by the module initializer */
+    const Symbol *symbol = nullptr;
+};
+
+struct IRField
+{
+    std::string name;
+    ValueType type;
+    uint64_t offset;
+};
+
+struct IRClass
+{
+    std::string name;
+    int base = -1;
+    uint64_t size = 0;
+    uint64_t vptrOffset = 0;
+    bool hasVptr = false;
+    std::vector<uint32_t> vtable; /**< Function indices, by slot */
+    std::vector<IRField> fields;  /**< Own instance fields, in memory order */
+    uint32_t initializer = 0;     /**< Function storing the field initializers */
+};
+
+struct Module
+{
+    std::vector<Function> functions;
+    std::vector<Global> globals;
+    std::vector<IRClass> classes;
+    std::vector<std::string> strings;
+    uint32_t initializer = 0; /**< Runs the top-level statements */
+    int entry = -1;           /**< main, if there is one */
+
+    void print(FILE *out) const;
+};
+
+bool isTerminator(Opcode op);
+bool isComparison(Opcode op);
+bool isIntegerValue(ValueType type);
+bool isSignedValue(ValueType type);
+bool isFloatValue(ValueType type);
+unsigned valueBits(ValueType type);
+const char *toString(Opcode op);
+const char *toString(ValueType type);
+
+/**
+ * @brief Deletes blocks not reachable from the entry and renumbers the rest,
+ * dropping the phi operands that came from deleted blocks.
+ */
+void removeUnreachableBlocks(Function &fn);
+
+/**
+ * @brief Replaces phis whose operands are all the same value (or the phi
+ * itself) by that value, until none is left. Returns the number removed.
+ */
+size_t removeTrivialPhis(Function &fn);
+
+/**
+ * @brief The edges a terminator adds, in the order of succs: a Branch's
+ * true then false target, and each distinct target of a Switch once.
+ */
+std::vector<BlockId> successors(const Function &fn, ValueId terminator);
+
+/** @brief Replaces every block a terminator names by map(block) */
+template <typename Map>
+void mapTargets(Function &fn, ValueId terminator, Map map)
+{
+    Instr &instr = fn.instrs[terminator];
+    if (instr.op == Opcode::Jump)
+        instr.imm = map(static_cast<BlockId>(instr.imm));
+    else if (instr.op == Opcode::Branch)
+    {
+        uint64_t targets = static_cast<uint64_t>(instr.imm);
+        instr.imm = static_cast<int64_t>(map(static_cast<BlockId>(targets & 0xffffffff)) | static_cast<uint64_t>(map(static_cast<BlockId>(targets >> 32))) << 32);
+    }
+    else if (instr.op == Opcode::Switch)
+    {
+        SwitchTable &table = fn.switches[instr.imm];
+        for (BlockId &target : table.targets)
+            target = map(target);
+        table.otherwise = map(table.otherwise);
+    }
+}
+
+/** @brief Removes one from -> to edge and the phi operands flowing along it */
+void removeEdge(Function &fn, BlockId from, BlockId to);
+
+/** @brief Rewrites every use of from to to */
+void replaceAllUses(Function &fn, ValueId from, ValueId to);
+
+/** @brief The (phi, incoming value) pairs the edge from -> to assigns */
+std::vector<std::pair<ValueId, ValueId>> phiCopies(const Function &fn, BlockId from, BlockId to);
+
+/**
+ * @brief Orders a parallel copy of (destination, source) pairs into moves
+ * that read every source before it is overwritten, breaking cycles through
+ * scratch. Copies whose source is their destination are dropped.
+ */
+std::vector<std::pair<uint32_t, uint32_t>> sequentializeCopies(std::vector<std::pair<uint32_t, uint32_t>> copies, uint32_t scratch);
+
+void printFunction(FILE *out, const Module &module, const Function &fn);
+
+struct DominatorTree;
+
+/**
+ * @brief Checks the structural invariants of a function: terminators end
+ * blocks, edges agree with terminators and with each other, phis have one
+ * operand per predecessor, and every definition dominates its uses.
+ * Describes the first violation in message.
+ */
+bool verifyFunction(const Function &fn, const DominatorTree &dom, std::string &message);
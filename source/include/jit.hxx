@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <codegen.hxx>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define VSHARP_JIT 1
+#else
+#define VSHARP_JIT 0
+#endif
+
+struct JitError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Compiles a module's functions to x86-64 in memory as they are
+ * first called, and runs them in place.
+ *
+ * One address range under 2 GiB holds everything, so generated code reaches
+ * all of it with rel32 displacements: a read-write area with the globals,
+ * vtables and a table of function entry pointers, a read-only area with the
+ * strings, and the code. Code pages are never writable and executable at
+ * once; they are flipped to read-write while code is copied in and back to
+ * read-execute before anything runs.
+ *
+ * Every function has a stub jumping through its entry pointer. Until the
+ * function is compiled the pointer leads to a resolver, which compiles it,
+ * repoints the entry and vtables at the new code and continues into it with
+ * the caller's arguments intact. A division by zero calls a trap that
+ * reports it as the VM does: as a JitError out of call, or with the
+ * message on stderr and exit status 1 when no call is running. Objects
+ * and strings allocated by generated code belong to the Jit and are freed
+ * with it.
+ */
+class Jit
+{
+public:
+    static constexpr size_t DefaultCodeBytes = size_t(64) << 20;
+
+    Jit(const Module &module, unsigned optLevel, size_t codeBytes = DefaultCodeBytes);
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+    Jit &operator=(const Jit &) = delete;
+
+    /**
+     * @brief Records the stubs and every function compiled from now on in
+     * /tmp/perf-<pid>.map, where perf looks up symbols for JIT frames.
+     */
+    bool writePerfMap();
+
+    /** @brief Callable address of a function; calling it compiles it if needed */
+    const void *address(uint32_t function) const;
+
+    /**
+     * @brief Compiles a function now unless it already is, and returns its
+     * code. With freshPages the code starts on a page nothing has run from
+     * yet, which lets another thread compile while generated code runs.
+     */
+    const void *compile(uint32_t function, bool freshPages = false);
+
+    /**
+     * @brief Entry taking a function's arguments from an array of raw values,
+     * as the VM holds them: integers extended to 64 bits and floats as double
+     * bits. The result comes back the same way.
+     */
+    using ArrayEntry = uint64_t (*)(const uint64_t *args);
+    ArrayEntry arrayEntry(uint32_t function, bool freshPages = false);
+
+    /**
+     * @brief Compiles a function that is not part of the module, such as an
+     * entry into the middle of one, and returns an array entry for it. Its
+     * calls go to the module's functions; its runtime errors name the
+     * module function source.
+     */
+    ArrayEntry compileEntry(const Function &fn, uint32_t source, bool freshPages = false);
+
+    /**
+     * @brief Runs an array entry. A runtime error in the generated code it
+     * reaches comes back as a JitError saying "Runtime error in <function>:
+     * <message>", the VM's wording.
+     */
+    static uint64_t call(ArrayEntry entry, const uint64_t *args);
+
+    /** @brief The globals, one 8-byte slot each in module order */
+    uint64_t *globalSlots() const { return globals.empty() ? nullptr : reinterpret_cast<uint64_t *>(globals.front()); }
+
+    /** @brief Runs the module initializer and then main, returning main's result as the exit status */
+    int run();
+
+private:
+    const Module &module;
+    unsigned optLevel;
+
+    uint8_t *base = nullptr;
+    size_t reserved = 0;
+    uint8_t *code = nullptr;
+    size_t codeUsed = 0, codeCapacity = 0, stubBytes = 0;
+
+    uint64_t *entries = nullptr; /**< Per function, then per RuntimeFunction */
+    std::vector<uint8_t *> globals, strings, vtables;
+    std::vector<const uint8_t *> stubs, runtimeStubs;
+    std::vector<const uint8_t *> compiled;
+    std::vector<size_t> compiledBytes;
+    /** @brief Code of a module function or of an entry into one */
+    struct Placed
+    {
+        const uint8_t *start;
+        size_t size;
+        uint32_t function;
+    };
+    std::vector<Placed> placed;
+    FILE *perfMap = nullptr;
+    std::mutex lock; /**< Held while code is compiled or placed */
+    std::vector<void *> heap; /**< Blocks allocated by generated code */
+    std::mutex heapLock;
+
+    void emitStubs();
+    const uint8_t *place(NativeFunction fn, const std::string &name, bool freshPages = false);
+    void mapSymbol(const uint8_t *start, size_t size, const std::string &name);
+    /** @brief Code loading fn's arguments from an array and calling it; call is the offset of the call's rel32 */
+    NativeFunction arrayAdapter(const Function &fn, uint32_t &call) const;
+
+    static const void *resolve(Jit *jit, uint64_t function);
+    /** @brief The function whose code a call returning to returnAddress was made from */
+    std::string functionAt(const void *returnAddress);
+    [[noreturn]] static void trap(Jit *jit);
+    /** @brief Records a block for the destructor to free */
+    void *own(void *block);
+    static void *ownCalloc(Jit *jit, size_t count, size_t size);
+    static void *ownMalloc(Jit *jit, size_t size);
+    static char *ownConcat(Jit *jit, const char *a, const char *b);
+};
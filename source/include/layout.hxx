@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <ast.hxx>
+
+class ClassHierarchy;
+
+/** @brief Placement of one instance field */
+struct FieldLayout
+{
+    const VarDeclNode *decl;
+    uint64_t offset, size, align;
+    uint64_t accesses = 0; /**< From the profile, 0 without one */
+    bool hot = false;
+};
+
+/** @brief Instance layout of a class or structure */
+struct TypeLayout
+{
+    const ClassDeclNode *decl;
+    const TypeLayout *base = nullptr; /**< Layout of the base class subobject, at offset 0 */
+    bool hasVptr = false;
+    uint64_t vptrOffset = 0; /**< Shared by every class of a hierarchy */
+    uint64_t size = 0, align = 1;
+    uint64_t padding = 0;            /**< Bytes not covered by any field */
+    uint64_t declarationSize = 0;    /**< Size the declaration order would have had */
+    std::vector<FieldLayout> fields; /**< Own fields, in memory order */
+    size_t straddling = 0;           /**< Fields crossing a cache-line boundary */
+    bool keepOrder = false;
+    bool split = false; /**< Hot fields were moved ahead of cold ones */
+};
+
+/**
+ * @brief Field access counts, one "Type.field count" pair per line.
+ * Lines starting with '#' are ignored.
+ */
+class LayoutProfile
+{
+public:
+    bool load(const std::string &path);
+    bool empty() const { return counts.empty(); }
+    uint64_t count(std::string_view type, std::string_view field) const;
+    bool covers(std::string_view type) const { return types.count(std::string(type)) != 0; }
+
+private:
+    std::unordered_map<std::string, uint64_t> counts;
+    std::unordered_map<std::string, uint64_t> types;
+};
+
+/**
+ * @brief Computes instance layouts for every class and structure in a tree.
+ *
+ * Static fields are not part of an instance. A base class is laid out as a
+ * prefix of its subclasses, and a vtable pointer is only added to classes
+ * that have virtual methods. Fields are ordered by
+ * decreasing alignment and size, which leaves no interior padding for
+ * power-of-two sizes, unless the type carries [keep_order]. With a profile, fields
+ * accessed at least 1/HotFraction as often as the hottest field of the type
+ * are placed first so they share as few cache lines as possible.
+ * Expects a type-checked tree.
+ */
+class LayoutEngine
+{
+public:
+    static constexpr uint64_t CacheLineSize = 64;
+    static constexpr uint64_t HotFraction = 8;
+    static constexpr uint64_t PointerSize = 8;
+
+    explicit LayoutEngine(const LayoutProfile *profile = nullptr, const ClassHierarchy *hierarchy = nullptr)
+        : profile(profile), hierarchy(hierarchy) {}
+
+    void run(const ASTNode *root);
+
+    const TypeLayout *find(const ClassDeclNode *decl) const
+    {
+        auto it = index.find(decl);
+        return it == index.end() ? nullptr : it->second;
+    }
+    /** @brief Offset of an instance field, the same in every subclass */
+    uint64_t fieldOffset(const VarDeclNode *field) const { return offsets.at(field); }
+    const std::deque<TypeLayout> &layouts() const { return all; }
+
+    void print(FILE *out) const;
+
+private:
+    const LayoutProfile *profile;
+    const ClassHierarchy *hierarchy;
+    std::deque<TypeLayout> all;
+    std::unordered_map<const ClassDeclNode *, const TypeLayout *> index;
+    std::unordered_map<const VarDeclNode *, uint64_t> offsets;
+
+    const TypeLayout &layoutType(const ClassDeclNode *decl);
+};
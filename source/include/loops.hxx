@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <ir.hxx>
+#include <threadpool.hxx>
+
+struct LoopOptions
+{
+    static constexpr unsigned MaxFullUnroll = 16;     /**< Iterations a loop may have to be unrolled completely */
+    static constexpr unsigned FullUnrollBudget = 128; /**< Instructions a completely unrolled loop may take */
+    static constexpr unsigned PartialUnrollBudget = 256;
+    static constexpr unsigned DefaultUnroll = 2;      /**< Partial unroll factor at -O2 */
+
+    bool fullUnroll = false; /**< Unroll loops with a small constant trip count completely */
+    unsigned unroll = 1;     /**< Copies of the body in each iteration of other loops; 1 keeps them */
+    FILE *remarks = nullptr; /**< Gets one line per loop unrolled */
+};
+
+/**
+ * @brief Loop optimizations over the natural loops of each function, inner
+ * loops first.
+ *
+ * Every loop gets a preheader, a block outside it whose only successor is
+ * the header, so code has somewhere to go. Pure instructions whose operands
+ * are all defined outside the loop are hoisted there, and so are loads of
+ * globals that nothing in the loop can store. Multiplying an induction
+ * variable by a constant becomes a second induction variable that adds the
+ * product of the constant and the step instead.
+ *
+ * When the exit test compares an induction variable with constant start
+ * and step to a constant, the trip count is known: uses after the loop get
+ * the final value, a loop with nothing else left to do is deleted, and a
+ * short one may be unrolled completely. Other innermost loops that only
+ * leave from their header may be unrolled by a factor, keeping the exit
+ * test in each copy. Returns true when the function changed.
+ */
+bool optimizeLoops(Function &fn, const LoopOptions &options, std::vector<std::string> *remarks = nullptr);
+
+/** @brief Runs optimizeLoops on every function of a module, in parallel */
+bool optimizeLoops(Module &module, ThreadPool &pool, const LoopOptions &options);
+
+/**
+ * @brief A counted loop that only folds values into accumulators, the shape
+ * the native backend vectorizes.
+ *
+ * The header holds the phis and an exit test of `counter < bound` or
+ * `counter <= bound`; the one other block is the latch and computes, with
+ * 64-bit integer add, subtract, multiply, or and shifts left by a constant,
+ * the next value of each phi from the induction variables, constants and
+ * values defined before the loop. An induction variable steps by a constant; an accumulator adds,
+ * subtracts or ors one such value and is read by nothing else in the loop.
+ */
+struct ReductionLoop
+{
+    struct Induction
+    {
+        ValueId phi;
+        int64_t step;
+    };
+
+    struct Accumulator
+    {
+        ValueId phi;
+        ValueId update; /**< phi op term, in the latch */
+        ValueId term;
+    };
+
+    BlockId preheader, header, latch, exit;
+    ValueId counter;   /**< The induction variable the exit test reads; steps by 1 */
+    ValueId bound;     /**< Defined before the loop */
+    bool inclusive;    /**< counter <= bound rather than < */
+    bool isSigned;
+    std::vector<Induction> inductions;
+    std::vector<Accumulator> accumulators;
+};
+
+/** @brief Recognizes a ReductionLoop at a header */
+bool matchReductionLoop(const Function &fn, BlockId header, ReductionLoop &loop);
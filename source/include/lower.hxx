@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <ast.hxx>
+#include <ir.hxx>
+
+class ClassHierarchy;
+class LayoutEngine;
+
+/**
+ * @brief Lowers a checked tree to SSA form.
+ *
+ * Every function and method becomes a Function; instance methods take the
+ * receiver as parameter 0. Each class gets an initializer storing its field
+ * initializers, and the top-level statements and non-constant global
+ * initializers go to the module initializer. Local variables are put in SSA
+ * form while the CFG is built (Braun et al., "Simple and Efficient
+ * Construction of Static Single Assignment Form"), so no separate
+ * dominance-frontier pass is needed.
+ */
+Module lowerToIR(const ASTNode *root, const ClassHierarchy &hierarchy, const LayoutEngine &layouts, const std::string &source);
@@ -15,4 +15,6 @@ private:
     void handleInitialize(const json &request);
     void handleShutDown(const json &request);
     void handleCompletion(const json &request);
+    void handleDidChange(const json &request);
+    void publishDiagnostics(const std::string &uri, const std::string &text);
 };
\ No newline at end of file
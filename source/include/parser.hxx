@@ -1,6 +1,8 @@
 #pragma once
 
+#include <functional>
 #include <ast.hxx>
+#include <alias.hxx>
 #include <token.hxx>
 #include <flex/FlexLexer.h>
 
@@ -9,9 +11,19 @@ extern size_t column;
 
 struct Parser
 {
+    /** @brief Upper bound on recursive syntactic nesting; flat chains are not counted */
+    static constexpr int MaxNestingDepth = 1024;
+
     yyFlexLexer &lexer;
     Token current, nextToken;
     const std::string &Source;
+    int depth = 0;
+    AliasTable aliases;
+    std::vector<std::string> pendingAttributes;
+    Token attributeToken; /**< Start of the pending attribute list */
+
+    /** @brief Called with each top-level item as soon as it has been parsed */
+    std::function<void(const ASTNode *)> onTopLevel;
 
     Parser(yyFlexLexer &lexer, const std::string &source)
         : lexer(lexer), Source(source)
@@ -28,9 +40,30 @@ struct Parser
 
     Token next()
     {
-        int tok = lexer.yylex();
-        TokenType type = static_cast<TokenType>(tok);
-        return Token{type, lexer.YYText(), currentFile, static_cast<size_t>(lexer.lineno()), column};
+        TokenType type;
+        do
+            type = static_cast<TokenType>(lexer.yylex());
+        while (type == TokenType::Comment);
+        Token token{type, lexer.YYText(), currentFile, static_cast<size_t>(lexer.lineno()), column};
+        if (type == TokenType::Identifier && !aliases.empty())
+            applyAlias(token);
+        return token;
+    }
+
+    /** @brief Retags an identifier bound by `define` as the keyword it stands for */
+    void applyAlias(Token &token) const
+    {
+        const Alias *alias = aliases.find(token.Lexeme);
+        if (alias && alias->kind == AliasKind::Keyword)
+            token.Type = alias->keyword;
+    }
+
+    /** @brief Makes the aliases of a prelude visible to this parser */
+    void useAliases(const AliasTable &prelude)
+    {
+        aliases.merge(prelude);
+        applyAlias(current);
+        applyAlias(nextToken);
     }
 
     void expect(TokenType type);
@@ -38,11 +71,22 @@ struct Parser
     ASTNodePtr parserProgram();
     ASTNodePtr parseExpression(int minPrec = 1);
     ASTNodePtr parsePrimary();
+    ASTNodePtr parseCall(const Token &name, ASTNodePtr receiver);
+    ASTNodePtr parsePostfix(ASTNodePtr expr);
     ASTNodePtr parseFunction(ASTNode *parent = nullptr);
     Type parseType();
     ASTNodePtr parseVarDecl(ASTNode *parent = nullptr);
     ASTNodePtr parseIfExpr();
+    ASTNodePtr parseForExpr();
+    ASTNodePtr parseMatchExpr();
+    ASTNodePtr parseMatchPattern();
+    ASTNodePtr parseBlock();
     ASTNodePtr parseClassDecl();
+    void parseAlias();
+    void parseEnumeration();
+    void parseAttributes();
+    /** @brief Hands the pending attributes to a declaration that accepts only those in allowed */
+    std::vector<std::string> takeAttributes(std::initializer_list<std::string_view> allowed);
     AccessType parseAccessModifier();
     ModifierType parseModifiers();
     ASTNodePtr parseBody(TokenType endCase = TokenType::LeftBrace, ASTNode *pc = nullptr, bool shouldAdvance = true);
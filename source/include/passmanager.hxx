@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+#include <analysis.hxx>
+#include <ir.hxx>
+#include <threadpool.hxx>
+
+/**
+ * @brief A transformation of one function. run returns true when it changed
+ * the function, in which case every analysis outside preserves is dropped.
+ * Function passes must not touch other functions or the module.
+ */
+struct FunctionPass
+{
+    const char *name;
+    AnalysisSet preserves;
+    bool (*run)(Function &fn, FunctionAnalyses &analyses);
+};
+
+/** @brief A count a module pass reports for --stats, summed over its runs */
+struct Statistic
+{
+    const char *pass;
+    std::string name;
+    uint64_t value;
+};
+
+/** @brief What a module pass gets besides the module */
+struct PassContext
+{
+    ThreadPool &pool;
+    std::vector<Statistic> &statistics;
+    FILE *remarks = nullptr; /**< Where to explain optimization decisions, if anywhere */
+    unsigned unroll = 0;     /**< Loop unroll factor asked for, 0 for the level's default */
+};
+
+/** @brief A transformation of the whole module; changing it drops every cached analysis */
+struct ModulePass
+{
+    const char *name;
+    bool (*run)(Module &module, PassContext &context);
+};
+
+/**
+ * @brief Runs a pipeline of passes over a module.
+ *
+ * Consecutive function passes form a group that is applied to one function
+ * after another by a worker thread, so a function stays in cache while all
+ * of them run and functions are spread over every core. Analyses are cached
+ * per function across passes and groups until invalidated.
+ */
+class PassManager
+{
+public:
+    explicit PassManager(unsigned threads = 0) : pool(threads) {}
+
+    void add(const FunctionPass &pass);
+    void add(const ModulePass &pass);
+
+    /** @brief Adds the standard pipeline of an optimization level, 0 to 2 */
+    void addPipeline(unsigned level);
+
+    void run(Module &module);
+
+    /** @brief Collects per-pass time and IR size changes for printTiming */
+    void setTiming(bool enabled) { timing = enabled; }
+    /** @brief Verifies the IR before the pipeline and after every pass that changes it */
+    void setVerify(bool enabled) { verify = enabled; }
+    /** @brief Passes that make decisions, such as the inliner, report them here */
+    void setRemarks(FILE *out) { remarks = out; }
+    /** @brief Copies of a loop body per iteration; 1 turns partial unrolling off */
+    void setUnroll(unsigned factor) { unroll = factor; }
+    void printTiming(FILE *out) const;
+    /** @brief The counts module passes reported, in pipeline order */
+    void printStatistics(FILE *out) const;
+    /** @brief Adds to the count of (pass, name), creating it at zero */
+    void addStatistic(const char *pass, const std::string &name, uint64_t value);
+
+    /** @brief How often each analysis was computed and reused; collected while timing */
+    const AnalysisStats &analysisStatistics() const { return analysisStats; }
+
+    unsigned threads() const { return pool.size(); }
+    size_t size() const { return stages.size(); }
+
+private:
+    struct PassStats
+    {
+        std::atomic<uint64_t> nanos{0};
+        std::atomic<int64_t> bytes{0};
+        std::atomic<uint64_t> runs{0}, changed{0};
+    };
+
+    struct Stage
+    {
+        const char *name;
+        FunctionPass function{}; /**< Set for function passes */
+        ModulePass module{};     /**< Set for module passes */
+        PassStats stats;
+    };
+
+    ThreadPool pool;
+    std::deque<Stage> stages;
+    std::vector<FunctionAnalyses> analyses;
+    AnalysisStats analysisStats;
+    std::vector<Statistic> statistics;
+    bool timing = false;
+    bool verify = false;
+    FILE *remarks = nullptr;
+    unsigned unroll = 0;
+    uint64_t wallNanos = 0;
+    size_t functionCount = 0;
+
+    void runGroup(Module &module, size_t first, size_t last);
+    void check(const Function &fn, FunctionAnalyses &cache, const char *after) const;
+};
+
+/** @brief Bytes held by a function's instruction, operand and block arrays */
+size_t irBytes(const Function &fn);
+size_t irBytes(const Module &module);
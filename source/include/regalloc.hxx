@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <ir.hxx>
+#include <x86.hxx>
+
+enum class RegisterAllocator
+{
+    None,         /**< Every value in its own stack slot */
+    LinearScan,   /**< One pass over live intervals in code order */
+    GraphColoring /**< Chaitin-Briggs over exact interference; slower, fewer spills */
+};
+
+/**
+ * @brief Where each value of a function lives, for the x86-64 backend.
+ *
+ * Values go in the registers the code templates never name: r10 and r11,
+ * which calls clobber, and rbx and r12 to r15, which they preserve. A value
+ * live across a call prefers a preserved register; if it gets r10 or r11
+ * after all, its interval is split around the calls, which save and restore
+ * the register. Values left without a register share stack slots whenever
+ * their lifetimes do not overlap. Constants and undefined values are
+ * rematerialized at each use and get no location.
+ */
+struct RegisterAssignment
+{
+    static constexpr uint8_t Unused = 0xff;  /**< No location: not needed or never read */
+    static constexpr uint8_t Spilled = 0xfe; /**< In stack slot `slot` */
+
+    std::vector<uint8_t> reg;      /**< Reg index, Spilled or Unused, per value */
+    std::vector<uint32_t> slot;    /**< Per spilled value */
+    uint32_t slots = 0;            /**< Spill slots after coalescing */
+    std::vector<uint16_t> saved;   /**< Per call, the mask of clobbered registers holding values live across it */
+    std::vector<Reg> calleeSaved;  /**< Preserved registers the function uses */
+    uint32_t spilled = 0;          /**< Values that needed a location but got no register */
+};
+
+/** @brief Whether an instruction is compiled to a call, which clobbers r10 and r11 */
+bool isNativeCall(const Function &fn, ValueId value);
+
+/**
+ * @brief Assigns locations with the given allocator. Linear scan takes
+ * O(n log n) in the number of live intervals. Graph coloring first builds
+ * the interference graph, one edge per pair of values live at once, and
+ * then O((n + edges) log n) to simplify and select, so its cost follows
+ * register pressure rather than function length squared.
+ */
+RegisterAssignment allocateRegisters(const Function &fn, RegisterAllocator allocator);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <ast.hxx>
+#include <symbols.hxx>
+
+/**
+ * @brief Builds the scopes of a program and binds every identifier,
+ * assignment and declaration in it to a Symbol.
+ *
+ * Undefined and duplicate names are reported through Error::semantic. The
+ * pass visits each node once and every lookup is a constant-time probe per
+ * enclosing scope, so it is linear in the size of the program.
+ */
+void resolveNames(ASTNode *root, SymbolTable &table, const std::string &source);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <ir.hxx>
+
+/**
+ * @brief Turns branches with equal targets into jumps, deletes unreachable
+ * blocks, merges blocks into a predecessor that only jumps to them, and
+ * removes trivial phis. Returns true when the function changed.
+ */
+bool simplifyCFG(Function &fn);
+
+/**
+ * @brief Folds arithmetic and comparisons on constant operands, wrapping
+ * integers to their width, and turns branches on constants into jumps.
+ * Division by zero is left for run time. Returns true when the function changed.
+ */
+bool foldInstructions(Function &fn);
+
+/**
+ * @brief Removes instructions whose value is never used and that have no
+ * side effect. Returns true when the function changed.
+ */
+bool eliminateDeadCode(Function &fn);
+
+/**
+ * @brief Evaluates integer arithmetic or a comparison on two constants the
+ * way foldInstructions does. Empty for division by zero.
+ */
+std::optional<int64_t> foldInteger(Opcode op, ValueType type, int64_t a, int64_t b);
+
+/** @brief True for instructions that must run even when their value is unused, such as a division that may trap */
+bool hasSideEffects(const Function &fn, ValueId v);
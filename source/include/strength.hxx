@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <ir.hxx>
+
+/**
+ * @brief Rewrites integer multiplication, division and remainder by
+ * constants into cheaper operations.
+ *
+ * Multiplying by a power of two becomes a shift. Dividing by a power of
+ * two becomes a shift, with a bias for negative signed dividends, and the
+ * remainder a mask. Dividing by any other constant becomes a multiplication
+ * by a fixed-point reciprocal that keeps the high half of the product
+ * (Granlund and Montgomery), then a shift and a rounding correction. A
+ * remainder is the dividend minus the quotient times the divisor. Narrow
+ * values are normalized in 64 bits, so every width uses 64-bit
+ * reciprocals. Returns true when the function changed.
+ *
+ * Only pays off on hardware: the VM dispatches each instruction, so the
+ * native backend reduces its own copy of a function rather than the
+ * pipeline reducing the module.
+ */
+bool reduceStrength(Function &fn);
+
+/** @brief Reciprocal of a signed divisor d with |d| >= 2: q = (mulHigh(n, multiplier) (+/- n)) >> shift, rounded toward zero */
+struct SignedMagic
+{
+    int64_t multiplier;
+    unsigned shift;
+};
+
+/** @brief Reciprocal of an unsigned divisor below 2^63; add means the multiplier needs a 65th bit */
+struct UnsignedMagic
+{
+    uint64_t multiplier;
+    unsigned shift;
+    bool add;
+};
+
+SignedMagic signedMagic(int64_t divisor);
+UnsignedMagic unsignedMagic(uint64_t divisor);
@@ -5,6 +5,21 @@
 #include <error.hxx>
 
 [[nodiscard]]
+inline constexpr std::string_view toString_Dispatch(DispatchKind dispatch)
+{
+    switch (dispatch)
+    {
+    case DispatchKind::Static:
+        return "Static";
+    case DispatchKind::Virtual:
+        return "Virtual";
+    case DispatchKind::Direct:
+        return "Direct";
+    default:
+        return "Unknown";
+    }
+}
+
 inline constexpr std::string_view toString_Access(AccessType access)
 {
     switch (access)
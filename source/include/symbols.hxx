@@ -0,0 +1,135 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <ast.hxx>
+#include <interner.hxx>
+#include <types.hxx>
+
+enum class SymbolKind
+{
+    Variable,
+    Constant,
+    Parameter,
+    Function,
+    Method,
+    Field,
+    Class
+};
+
+enum class ScopeKind
+{
+    Global,
+    Class,
+    Function,
+    Block
+};
+
+struct Scope;
+
+/**
+ * @brief A declared name.
+ *
+ * decl is the declaring node: the VarDeclNode, FunctionDeclNode or
+ * ClassDeclNode, or for parameters the FunctionDeclNode with index giving
+ * the parameter position.
+ */
+struct Symbol
+{
+    SymbolKind kind;
+    InternId name;
+    Type type;
+    ASTNode *decl;
+    size_t index = 0;
+    Scope *scope = nullptr;
+    bool isStatic = false;
+    Symbol *nextOverload = nullptr;     /**< Next function of the same name in the same scope */
+    Scope *members = nullptr;           /**< Member scope of a class */
+    Symbol *baseClass = nullptr;        /**< Base of a class */
+    const TypeInfo *typeInfo = nullptr; /**< Interned type, set by the type checker */
+};
+
+/**
+ * @brief Open-addressing map from interned names to symbols.
+ */
+class SymbolMap
+{
+public:
+    Symbol *find(InternId name) const
+    {
+        if (slots.empty())
+            return nullptr;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hashId(name) & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (!slot.symbol || slot.name == name)
+                return slot.symbol;
+        }
+    }
+
+    /** @brief Inserts or replaces the symbol bound to name */
+    void insert(InternId name, Symbol *symbol);
+
+    size_t size() const { return count; }
+
+private:
+    struct Slot
+    {
+        InternId name;
+        Symbol *symbol;
+    };
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    static size_t hashId(InternId id) { return static_cast<size_t>(id) * 0x9e3779b97f4a7c15ull >> 16; }
+    void grow();
+};
+
+struct Scope
+{
+    ScopeKind kind;
+    Scope *parent;
+    ASTNode *owner; /**< ClassDeclNode, FunctionDeclNode or block owner; null for the global scope */
+    SymbolMap symbols;
+};
+
+/** @brief Looks a member up in a class and then in its bases */
+inline Symbol *findMember(const Symbol *cls, InternId name)
+{
+    for (; cls; cls = cls->baseClass)
+        if (Symbol *member = cls->members->symbols.find(name))
+            return member;
+    return nullptr;
+}
+
+/**
+ * @brief Owns every scope and symbol of a program, plus the name interner
+ * their keys come from. AST nodes point into it, so it must outlive them
+ * being used.
+ */
+struct SymbolTable
+{
+    StringInterner names;
+    std::deque<Scope> scopes;
+    std::deque<Symbol> symbols;
+
+    SymbolTable() { scopes.push_back({ScopeKind::Global, nullptr, nullptr, {}}); }
+
+    Scope *global() { return &scopes.front(); }
+
+    Scope *newScope(ScopeKind kind, Scope *parent, ASTNode *owner)
+    {
+        scopes.push_back({kind, parent, owner, {}});
+        return &scopes.back();
+    }
+
+    Symbol *newSymbol(SymbolKind kind, InternId name, Type type, ASTNode *decl)
+    {
+        symbols.push_back({kind, name, type, decl});
+        return &symbols.back();
+    }
+
+    std::string_view name(const Symbol *symbol) const { return names.str(symbol->name); }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running parallel loops.
+ *
+ * parallelFor() hands out indices one at a time from a shared counter, so
+ * uneven work items (a few huge functions among many small ones) balance
+ * themselves. The calling thread takes part in the loop, so a pool of one
+ * thread runs everything inline without any synchronization.
+ */
+class ThreadPool
+{
+public:
+    /** @brief threads == 0 uses one thread per hardware core */
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /**
+     * @brief Calls body(i) for every i in [0, count) and waits for all of
+     * them. The first exception thrown by body is rethrown here.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobSize = 0;
+    std::atomic<size_t> next{0};
+    size_t generation = 0;
+    unsigned busy = 0; /**< Workers that have not finished the current loop */
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void work();
+    void drain();
+};
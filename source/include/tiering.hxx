@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <bytecode.hxx>
+#include <jit.hxx>
+#include <vm.hxx>
+
+struct TierOptions
+{
+    uint32_t threshold = 1000; /**< Calls plus backward jumps before a function is compiled */
+    bool background = true;    /**< Compile on a worker thread rather than at the hot call */
+    unsigned optLevel = 1;     /**< For the native code */
+};
+
+/**
+ * @brief Runs a module in the VM and moves hot functions to the JIT.
+ *
+ * Every function starts in the interpreter, which counts its calls and the
+ * backward jumps taken inside it. At the threshold the function is compiled,
+ * on the worker thread or right away, and calls made after that go to the
+ * native code. Activations already running move over at their next jump back
+ * to a loop header: each header gets a copy of the function that starts
+ * there, taking the values live at the header from the VM's registers
+ * (on-stack replacement). Headers of loops nested in another loop that
+ * defines values they use have no such entry.
+ *
+ * Both tiers share the globals, but not strings or objects, whose
+ * representations differ. So only functions that handle scalars alone, and
+ * call only such functions, can move up. A division by zero in native code
+ * fails with the interpreter's message, through Jit::call.
+ */
+class TieredRunner
+{
+public:
+    TieredRunner(const Module &module, const TierOptions &options);
+    ~TieredRunner();
+
+    int run();
+
+    /** @brief Tier-up latency and the time spent in each tier */
+    void printStats(FILE *out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Record
+    {
+        bool eligible = false;
+        bool hot = false;
+        bool installed = false;
+        Clock::time_point hotAt;
+        std::chrono::nanoseconds latency{0}, compileTime{0};
+        std::vector<VM::OsrEntry> loops; /**< Entries at loop headers, once installed */
+    };
+
+    const Module &module;
+    TierOptions options;
+    BytecodeProgram program;
+    VM vm;
+    Jit jit;
+    std::vector<Record> records;
+    std::chrono::nanoseconds total{0}, compiling{0};
+
+    std::mutex queueLock;
+    std::condition_variable queued;
+    std::deque<uint32_t> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void onHot(uint32_t function);
+    void tierUp(uint32_t function, bool freshPages);
+    std::vector<VM::OsrEntry> loopEntries(uint32_t function, bool freshPages);
+    void work();
+    void stop();
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <ir.hxx>
+
+/** @brief What shakeModule removed */
+struct ShakeResult
+{
+    size_t functions = 0;
+    size_t classes = 0;
+    size_t globals = 0;
+    size_t strings = 0;
+    size_t stores = 0;      /**< Stores to globals nothing loads */
+    size_t irBytes = 0;     /**< Held by the removed functions, see irBytes */
+    size_t stringBytes = 0; /**< Of string data, terminators included */
+
+    bool changed() const { return functions || classes || globals || strings || stores; }
+};
+
+/**
+ * @brief Whole-program dead code elimination.
+ *
+ * Walks the module from its entry points: the initializer, main and every
+ * [export] function, or every function when there is neither main nor an
+ * export, since the object is then a library. A reachable function makes
+ * what it calls, instantiates, loads and names reachable; instantiating a
+ * class makes its vtable reachable, and a reachable class its base and
+ * field initializer. Classes that are never instantiated lose their vtable.
+ *
+ * Everything else is deleted, along with stores to globals nothing loads,
+ * and the functions, classes, globals and strings left are renumbered in
+ * their original order. Writes one line about what went to remarks.
+ */
+ShakeResult shakeModule(Module &module, FILE *remarks = nullptr);
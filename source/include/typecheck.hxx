@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <ast.hxx>
+#include <symbols.hxx>
+#include <types.hxx>
+
+/**
+ * @brief Type checks a resolved program.
+ *
+ * Every node gets its resolvedType (void for declarations and statements)
+ * and every symbol its interned typeInfo. Untyped numeric literals take the
+ * type their context expects, and their stored value is converted to that
+ * width, so later stages read types instead of recomputing them. There are
+ * no implicit conversions between variables of different types. Mismatches
+ * are reported through Error::type.
+ */
+void checkTypes(ASTNode *root, SymbolTable &symbols, TypeInterner &types, const std::string &source);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <ast.hxx>
+
+struct Symbol;
+
+enum class TypeKind
+{
+    Primitive,
+    Class,
+    Array,
+    Function
+};
+
+/**
+ * @brief Canonical semantic type. Types are interned by TypeInterner, so
+ * two types are equal exactly when their pointers (or ids) are equal.
+ */
+struct TypeInfo
+{
+    uint32_t id;
+    TypeKind kind;
+    Type primitive = Type::Void;                /**< Primitive */
+    const Symbol *classSymbol = nullptr;        /**< Class */
+    const TypeInfo *element = nullptr;          /**< Array element, function result */
+    std::vector<const TypeInfo *> params;       /**< Function parameters */
+    std::string name;
+
+    bool is(Type t) const { return kind == TypeKind::Primitive && primitive == t; }
+};
+
+class TypeInterner
+{
+public:
+    TypeInterner();
+
+    TypeInterner(const TypeInterner &) = delete;
+    TypeInterner &operator=(const TypeInterner &) = delete;
+
+    const TypeInfo *primitive(Type t) const { return primitives[static_cast<size_t>(t)]; }
+    const TypeInfo *classType(const Symbol *cls, std::string_view name);
+    const TypeInfo *arrayOf(const TypeInfo *element);
+    const TypeInfo *function(const TypeInfo *result, const std::vector<const TypeInfo *> &params);
+
+    size_t size() const { return types.size(); }
+
+private:
+    std::deque<TypeInfo> types;
+    std::vector<const TypeInfo *> primitives;
+    struct IdListHash
+    {
+        size_t operator()(const std::vector<uint32_t> &ids) const
+        {
+            size_t h = ids.size();
+            for (uint32_t id : ids)
+                h = h * 0x100000001b3ull ^ id;
+            return h;
+        }
+    };
+
+    std::unordered_map<const Symbol *, const TypeInfo *> classes;
+    std::unordered_map<const TypeInfo *, const TypeInfo *> arrays;
+    std::unordered_map<std::vector<uint32_t>, const TypeInfo *, IdListHash> functions;
+
+    TypeInfo *make(TypeKind kind, std::string name);
+};
+
+bool isIntegerType(Type t);
+bool isSignedType(Type t);
+bool isFloatType(Type t);
+bool isNumericType(Type t);
+/** @brief Width in bits of an integer or float type */
+unsigned bitWidth(Type t);
+
+/** @brief Storage size and alignment of a value of the type, in bytes */
+size_t sizeOf(const TypeInfo *type);
+size_t alignOf(const TypeInfo *type);
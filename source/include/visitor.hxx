@@ -0,0 +1,393 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+#include <ast.hxx>
+
+/**
+ * @brief Statically dispatched AST visitor (CRTP).
+ *
+ * Derived classes define any of the visitXxx hooks below; hooks they do not
+ * define fall back to the defaults here, which visit the children. Dispatch
+ * is a single switch on ASTNode::type resolved at compile time against the
+ * derived class, so no virtual calls are involved and hooks can be inlined.
+ *
+ * @tparam Derived  the concrete visitor
+ * @tparam R        the result type of every hook
+ * @tparam IsConst  whether nodes are visited through const pointers
+ */
+template <typename Derived, typename R = void, bool IsConst = true>
+struct ASTVisitor
+{
+    template <typename T>
+    using Ptr = std::conditional_t<IsConst, const T *, T *>;
+
+    R visit(Ptr<ASTNode> node)
+    {
+        if (!node)
+            return R();
+
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            return derived().visitBlock(static_cast<Ptr<BlockNode>>(node));
+        case ASTNodeType::Literal:
+            return derived().visitLiteral(static_cast<Ptr<LiteralNode>>(node));
+        case ASTNodeType::Identifier:
+            return derived().visitIdentifier(static_cast<Ptr<IdentifierNode>>(node));
+        case ASTNodeType::BinaryExpr:
+            return derived().visitBinaryExpr(static_cast<Ptr<BinaryExprNode>>(node));
+        case ASTNodeType::FunctionDecl:
+            return derived().visitFunctionDecl(static_cast<Ptr<FunctionDeclNode>>(node));
+        case ASTNodeType::ReturnExpr:
+            return derived().visitReturnExpr(static_cast<Ptr<ReturnExprNode>>(node));
+        case ASTNodeType::VarDecl:
+            return derived().visitVarDecl(static_cast<Ptr<VarDeclNode>>(node));
+        case ASTNodeType::IfExpr:
+            return derived().visitIfExpr(static_cast<Ptr<IfExprNode>>(node));
+        case ASTNodeType::ForExpr:
+            return derived().visitForExpr(static_cast<Ptr<ForExprNode>>(node));
+        case ASTNodeType::MatchExpr:
+            return derived().visitMatchExpr(static_cast<Ptr<MatchExprNode>>(node));
+        case ASTNodeType::AssignExpr:
+            return derived().visitAssignExpr(static_cast<Ptr<AssignExprNode>>(node));
+        case ASTNodeType::ClassDecl:
+            return derived().visitClassDecl(static_cast<Ptr<ClassDeclNode>>(node));
+        case ASTNodeType::FunctionCall:
+            return derived().visitCallExpr(static_cast<Ptr<CallExprNode>>(node));
+        case ASTNodeType::SharedExpr:
+            return derived().visitSharedExpr(static_cast<Ptr<SharedExprNode>>(node));
+        default:
+            return derived().visitUnknown(node);
+        }
+    }
+
+    R visitBlock(Ptr<BlockNode> node)
+    {
+        for (auto &child : node->children)
+            visit(child.get());
+        return R();
+    }
+
+    R visitLiteral(Ptr<LiteralNode>) { return R(); }
+    R visitIdentifier(Ptr<IdentifierNode>) { return R(); }
+
+    // Operator chains lean left and are as long as the source makes them, so
+    // the left spine is followed with a loop and only right operands recurse.
+    // visitBinaryNode is called for every node of the chain after both of its
+    // operands, in the order a recursive post-order walk would reach them.
+    R visitBinaryExpr(Ptr<BinaryExprNode> node)
+    {
+        std::vector<Ptr<BinaryExprNode>> spine;
+        Ptr<ASTNode> left = node;
+        while (left->type == ASTNodeType::BinaryExpr)
+        {
+            spine.push_back(static_cast<Ptr<BinaryExprNode>>(left));
+            left = spine.back()->left.get();
+        }
+        visit(left);
+        for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+        {
+            visit((*it)->right.get());
+            derived().visitBinaryNode(*it);
+        }
+        return R();
+    }
+
+    /** @brief One operator of a chain, once its operands are visited */
+    void visitBinaryNode(Ptr<BinaryExprNode>) {}
+
+    R visitFunctionDecl(Ptr<FunctionDeclNode> node)
+    {
+        visit(node->body.get());
+        return R();
+    }
+
+    R visitReturnExpr(Ptr<ReturnExprNode> node)
+    {
+        visit(node->expr.get());
+        return R();
+    }
+
+    R visitVarDecl(Ptr<VarDeclNode> node)
+    {
+        visit(node->value.get());
+        return R();
+    }
+
+    // `else if` arms hang off the previous arm's else branch and member calls
+    // off their receiver, so both chains are as long as the source makes them
+    // and are followed with loops. The loops only stand in for the default
+    // hook: a link is handed to visit() whenever Derived has its own.
+    R visitIfExpr(Ptr<IfExprNode> node)
+    {
+        constexpr bool ownHook = !std::is_same_v<decltype(&Derived::visitIfExpr), decltype(&ASTVisitor::visitIfExpr)>;
+        for (;;)
+        {
+            visit(node->condition.get());
+            visit(node->thenBranch.get());
+            Ptr<ASTNode> next = node->elseBranch.get();
+            if (ownHook || !next || next->type != ASTNodeType::IfExpr)
+            {
+                visit(next);
+                return R();
+            }
+            node = static_cast<Ptr<IfExprNode>>(next);
+        }
+    }
+
+    R visitForExpr(Ptr<ForExprNode> node)
+    {
+        visit(node->init.get());
+        visit(node->condition.get());
+        visit(node->step.get());
+        visit(node->body.get());
+        return R();
+    }
+
+    R visitMatchExpr(Ptr<MatchExprNode> node)
+    {
+        visit(node->subject.get());
+        for (auto &arm : node->arms)
+        {
+            for (auto &pattern : arm.patterns)
+                visit(pattern.get());
+            visit(arm.body.get());
+        }
+        visit(node->otherwise.get());
+        return R();
+    }
+
+    R visitAssignExpr(Ptr<AssignExprNode> node)
+    {
+        visit(node->value.get());
+        return R();
+    }
+
+    R visitClassDecl(Ptr<ClassDeclNode> node)
+    {
+        visit(node->body.get());
+        return R();
+    }
+
+    R visitCallExpr(Ptr<CallExprNode> node)
+    {
+        std::vector<Ptr<CallExprNode>> chain{node};
+        if constexpr (std::is_same_v<decltype(&Derived::visitCallExpr), decltype(&ASTVisitor::visitCallExpr)>)
+            while (chain.back()->receiver && chain.back()->receiver->type == ASTNodeType::FunctionCall)
+                chain.push_back(static_cast<Ptr<CallExprNode>>(chain.back()->receiver.get()));
+        visit(chain.back()->receiver.get());
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            for (auto &arg : (*it)->args)
+                visit(arg.get());
+            derived().visitCallNode(*it);
+        }
+        return R();
+    }
+
+    /** @brief One call of a chain, once its receiver and arguments are visited */
+    void visitCallNode(Ptr<CallExprNode>) {}
+
+    // Canonical shared subtrees are immutable, so only const visitors walk
+    // into them by default. Visitors of mutable nodes must define their own
+    // visitSharedExpr, deciding what to do about the occurrences they cannot
+    // change.
+    R visitSharedExpr(Ptr<SharedExprNode> node)
+    {
+        if constexpr (IsConst)
+            return visit(node->target.get());
+        else
+        {
+            static_assert(IsConst, "visitors of mutable nodes must define visitSharedExpr");
+            return R();
+        }
+    }
+
+    R visitUnknown(Ptr<ASTNode>) { return R(); }
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+/**
+ * @brief Statically dispatched post-order AST rewriter (CRTP).
+ *
+ * rewrite() first rewrites the children of a node, then hands ownership of
+ * the node to the matching rewriteXxx hook, whose return value takes the
+ * node's place in the tree. The defaults return the node unchanged.
+ */
+template <typename Derived>
+struct ASTRewriter
+{
+    void rewrite(ASTNodePtr &slot)
+    {
+        if (!slot)
+            return;
+
+        // Left-leaning operator chains, `else if` chains and member-call
+        // chains are rewritten bottom-up with loops rather than by recursing
+        // down the chain; the links are visited in the same order.
+        std::vector<ASTNodePtr *> chain;
+        switch (slot->type)
+        {
+        case ASTNodeType::BinaryExpr:
+        {
+            for (ASTNodePtr *at = &slot; *at && (*at)->type == ASTNodeType::BinaryExpr; at = &static_cast<BinaryExprNode &>(**at).left)
+                chain.push_back(at);
+            derived().rewrite(static_cast<BinaryExprNode &>(**chain.back()).left);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                derived().rewrite(static_cast<BinaryExprNode &>(***it).right);
+                replace(**it);
+            }
+            return;
+        }
+        case ASTNodeType::IfExpr:
+        {
+            ASTNodePtr *at = &slot;
+            for (; *at && (*at)->type == ASTNodeType::IfExpr; at = &static_cast<IfExprNode &>(**at).elseBranch)
+            {
+                auto &ifn = static_cast<IfExprNode &>(**at);
+                derived().rewrite(ifn.condition);
+                derived().rewrite(ifn.thenBranch);
+                chain.push_back(at);
+            }
+            derived().rewrite(*at);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+                replace(**it);
+            return;
+        }
+        case ASTNodeType::FunctionCall:
+        {
+            for (ASTNodePtr *at = &slot; *at && (*at)->type == ASTNodeType::FunctionCall; at = &static_cast<CallExprNode &>(**at).receiver)
+                chain.push_back(at);
+            derived().rewrite(static_cast<CallExprNode &>(**chain.back()).receiver);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                for (auto &arg : static_cast<CallExprNode &>(***it).args)
+                    derived().rewrite(arg);
+                replace(**it);
+            }
+            return;
+        }
+        default:
+            rewriteChildren(slot.get());
+            replace(slot);
+        }
+    }
+
+    ASTNodePtr rewriteBlock(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteLiteral(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteIdentifier(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteBinaryExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteFunctionDecl(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteReturnExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteVarDecl(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteIfExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteForExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteMatchExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteAssignExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteClassDecl(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteCallExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteSharedExpr(ASTNodePtr node) { return node; }
+    ASTNodePtr rewriteUnknown(ASTNodePtr node) { return node; }
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+
+    void replace(ASTNodePtr &slot)
+    {
+        ASTNode *parent = slot->parent;
+        slot = dispatch(std::move(slot));
+        if (slot)
+            slot->parent = parent;
+    }
+
+    void rewriteChildren(ASTNode *node)
+    {
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            for (auto &child : static_cast<BlockNode *>(node)->children)
+                derived().rewrite(child);
+            break;
+        case ASTNodeType::FunctionDecl:
+            derived().rewrite(static_cast<FunctionDeclNode *>(node)->body);
+            break;
+        case ASTNodeType::ReturnExpr:
+            derived().rewrite(static_cast<ReturnExprNode *>(node)->expr);
+            break;
+        case ASTNodeType::VarDecl:
+            derived().rewrite(static_cast<VarDeclNode *>(node)->value);
+            break;
+        case ASTNodeType::ForExpr:
+        {
+            auto *loop = static_cast<ForExprNode *>(node);
+            derived().rewrite(loop->init);
+            derived().rewrite(loop->condition);
+            derived().rewrite(loop->step);
+            derived().rewrite(loop->body);
+            break;
+        }
+        case ASTNodeType::MatchExpr:
+        {
+            auto *match = static_cast<MatchExprNode *>(node);
+            derived().rewrite(match->subject);
+            for (auto &arm : match->arms)
+            {
+                for (auto &pattern : arm.patterns)
+                    derived().rewrite(pattern);
+                derived().rewrite(arm.body);
+            }
+            derived().rewrite(match->otherwise);
+            break;
+        }
+        case ASTNodeType::AssignExpr:
+            derived().rewrite(static_cast<AssignExprNode *>(node)->value);
+            break;
+        case ASTNodeType::ClassDecl:
+            derived().rewrite(static_cast<ClassDeclNode *>(node)->body);
+            break;
+        default:
+            break;
+        }
+    }
+
+    ASTNodePtr dispatch(ASTNodePtr node)
+    {
+        switch (node->type)
+        {
+        case ASTNodeType::Block:
+            return derived().rewriteBlock(std::move(node));
+        case ASTNodeType::Literal:
+            return derived().rewriteLiteral(std::move(node));
+        case ASTNodeType::Identifier:
+            return derived().rewriteIdentifier(std::move(node));
+        case ASTNodeType::BinaryExpr:
+            return derived().rewriteBinaryExpr(std::move(node));
+        case ASTNodeType::FunctionDecl:
+            return derived().rewriteFunctionDecl(std::move(node));
+        case ASTNodeType::ReturnExpr:
+            return derived().rewriteReturnExpr(std::move(node));
+        case ASTNodeType::VarDecl:
+            return derived().rewriteVarDecl(std::move(node));
+        case ASTNodeType::IfExpr:
+            return derived().rewriteIfExpr(std::move(node));
+        case ASTNodeType::ForExpr:
+            return derived().rewriteForExpr(std::move(node));
+        case ASTNodeType::MatchExpr:
+            return derived().rewriteMatchExpr(std::move(node));
+        case ASTNodeType::AssignExpr:
+            return derived().rewriteAssignExpr(std::move(node));
+        case ASTNodeType::ClassDecl:
+            return derived().rewriteClassDecl(std::move(node));
+        case ASTNodeType::FunctionCall:
+            return derived().rewriteCallExpr(std::move(node));
+        case ASTNodeType::SharedExpr:
+            return derived().rewriteSharedExpr(std::move(node));
+        default:
+            return derived().rewriteUnknown(std::move(node));
+        }
+    }
+};
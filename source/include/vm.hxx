@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <bytecode.hxx>
+
+#if defined(__GNUC__) && !defined(VSHARP_VM_SWITCH_ONLY)
+#define VSHARP_VM_THREADED 1
+#else
+#define VSHARP_VM_THREADED 0
+#endif
+
+enum class Dispatch
+{
+    Threaded, /**< Computed goto to the next handler; switch where unsupported */
+    Switch
+};
+
+struct VMError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief Register VM for BytecodeProgram.
+ *
+ * Registers are untyped 64-bit slots holding unboxed values: integers
+ * wrapped to their width, floats as doubles, and strings and objects as
+ * pointers. Every call takes its frame from a contiguous register arena,
+ * so calling does not allocate. Objects and strings created by the program
+ * live until the VM is destroyed.
+ */
+class VM
+{
+public:
+    static constexpr size_t DefaultStackSlots = size_t(1) << 20;
+
+    explicit VM(const BytecodeProgram &program, size_t stackSlots = DefaultStackSlots);
+
+    /** @brief Native code called with a function's raw arguments in an array */
+    using NativeEntry = uint64_t (*)(const uint64_t *args);
+
+    void setDispatch(Dispatch mode) { dispatch = mode; }
+
+    /**
+     * @brief Counts calls to each function and backward jumps within it, and
+     * reports a function once the count reaches threshold (0 turns counting
+     * off). The hook runs inside the interpreter loop.
+     */
+    void setHotHook(uint32_t threshold, std::function<void(uint32_t)> hook);
+
+    /**
+     * @brief Routes later calls of a function to native code, which may
+     * only take and return scalars. Safe to call from any thread; calls
+     * already running finish in the interpreter.
+     */
+    void install(uint32_t function, NativeEntry entry) { natives[function].store(entry, std::memory_order_release); }
+
+    /**
+     * @brief How native entries are called, such as Jit::call, which turns
+     * their runtime errors into exceptions; by default they are called
+     * directly.
+     */
+    using NativeCall = uint64_t (*)(NativeEntry entry, const uint64_t *args);
+    void setNativeCall(NativeCall call) { nativeCall = call; }
+
+    /**
+     * @brief A loop header where an activation running in the interpreter
+     * can continue in native code. The entry takes the listed registers in
+     * order and returns what the function would.
+     */
+    struct OsrEntry
+    {
+        uint32_t offset; /**< Code offset of the header */
+        NativeEntry entry;
+        std::vector<uint32_t> registers;
+    };
+
+    /**
+     * @brief Moves activations of a function that are already running to
+     * native code the next time they jump back to one of the headers. The
+     * entries must stay alive while the VM runs. Safe to call from any thread.
+     */
+    void installOsr(uint32_t function, const std::vector<OsrEntry> *entries) { osr[function].store(entries, std::memory_order_release); }
+    /** @brief Activations that left the interpreter at a loop header */
+    uint64_t osrTransfers() const { return osrCount; }
+
+    /** @brief Moves the globals into storage shared with native code, one slot per global */
+    void useGlobals(uint64_t *slots);
+
+    /** @brief Time spent in native calls since the last reset, when timing is on */
+    void setNativeTiming(bool enabled) { timeNative = enabled; }
+    uint64_t nativeNanoseconds() const { return nativeNanos; }
+    /** @brief Instances run so far has put on the heap; frame instances are not counted */
+    size_t allocations() const { return objects.size(); }
+
+    /** @brief Calls a function with the given raw argument values and returns its raw result */
+    uint64_t call(uint32_t function, const std::vector<uint64_t> &args = {});
+
+    /**
+     * @brief Runs the module initializer and then main, returning main's
+     * result as the exit status (0 for a void main).
+     */
+    int run();
+
+private:
+    struct Frame
+    {
+        const uint32_t *pc; /**< Where the caller resumes */
+        uint64_t *base;
+        uint32_t function;
+        uint32_t dest;
+    };
+
+    const BytecodeProgram &program;
+    Dispatch dispatch = Dispatch::Threaded;
+    std::unique_ptr<uint64_t[]> stack;
+    uint64_t *stackEnd;
+    std::vector<Frame> frames;
+    std::vector<uint64_t> ownGlobals;
+    uint64_t *globals;
+    std::vector<uint32_t> counters;
+    std::unique_ptr<std::atomic<NativeEntry>[]> natives;
+    std::unique_ptr<std::atomic<const std::vector<OsrEntry> *>[]> osr;
+    uint64_t osrCount = 0;
+    uint32_t hotThreshold = 0;
+    std::function<void(uint32_t)> onHot;
+    NativeCall nativeCall = nullptr;
+    bool timeNative = false;
+    uint64_t nativeNanos = 0;
+    std::deque<std::string> strings;
+    std::vector<std::unique_ptr<uint64_t[]>> objects;
+
+    uint64_t execute(uint32_t function, uint64_t *base);
+#if VSHARP_VM_THREADED
+    uint64_t executeThreaded(uint32_t function, uint64_t *base);
+#endif
+    uint64_t executeSwitch(uint32_t function, uint64_t *base);
+
+    uint64_t allocate(uint32_t cls);
+    /** @brief Zeroes an instance in memory of the class's size and sets its vptr */
+    uint64_t construct(uint32_t cls, uint64_t *memory);
+    uint64_t callNative(NativeEntry entry, const uint64_t *args);
+    /** @brief The entry for a jump to target, if the function has one there */
+    const OsrEntry *osrEntry(uint32_t function, uint32_t target) const
+    {
+        const std::vector<OsrEntry> *entries = osr[function].load(std::memory_order_acquire);
+        if (entries)
+            for (const auto &entry : *entries)
+                if (entry.offset == target)
+                    return &entry;
+        return nullptr;
+    }
+    uint64_t enterOsr(const OsrEntry &entry, const uint64_t *registers);
+
+    void countHot(uint32_t function)
+    {
+        if (++counters[function] == hotThreshold && hotThreshold)
+            onHot(function);
+    }
+    [[noreturn]] void fail(uint32_t function, const std::string &message) const;
+};
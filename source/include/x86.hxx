@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class Reg : uint8_t
+{
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15
+};
+
+/** @brief SSE registers, numbered like Reg */
+using Xmm = uint8_t;
+
+/** @brief Condition codes in encoding order */
+enum class Cond : uint8_t
+{
+    O,
+    NO,
+    B,
+    AE,
+    E,
+    NE,
+    BE,
+    A,
+    S,
+    NS,
+    P,
+    NP,
+    L,
+    GE,
+    LE,
+    G
+};
+
+inline Cond invert(Cond cond)
+{
+    return static_cast<Cond>(static_cast<uint8_t>(cond) ^ 1);
+}
+
+/** @brief A [base + index * 2^scale + disp] memory operand */
+struct Mem
+{
+    Reg base;
+    int32_t disp = 0;
+    Reg index = Reg::RSP; /**< RSP, which cannot be an index, for none */
+    uint8_t scale = 0;
+
+    bool operator==(const Mem &other) const
+    {
+        return base == other.base && disp == other.disp && index == other.index && scale == other.scale;
+    }
+};
+
+enum class AluOp : uint8_t
+{
+    Add = 0,
+    Or = 1,
+    And = 4,
+    Sub = 5,
+    Xor = 6,
+    Cmp = 7
+};
+
+/** @brief Shifts by a constant, in the encoding's /digit order */
+enum class ShiftOp : uint8_t
+{
+    Shl = 4,
+    Shr = 5,
+    Sar = 7
+};
+
+enum class SseOp : uint8_t
+{
+    AddSd,
+    SubSd,
+    MulSd,
+    DivSd,
+    UComISd,
+    CvtSd2Ss, /**< Rounds a double to float, in place in the low lane */
+    CvtSs2Sd
+};
+
+/** @brief Packed integer operations on 64-bit lanes: dst = dst op src */
+enum class VecOp : uint8_t
+{
+    AddQ,
+    SubQ,
+    Or,
+    MulUdq,    /**< Unsigned product of the low 32 bits of each lane */
+    UnpackLoQ, /**< dst = {dst lane 0, src lane 0} */
+    Move
+};
+
+/** @brief The instructions the peephole optimizer can see and rewrite */
+enum class MachineOp : uint8_t
+{
+    Mov,    /**< dst = src */
+    MovImm, /**< dst = imm; clears flags when imm is 0 */
+    Load,   /**< dst = width bytes at mem */
+    Store,  /**< width bytes at mem = src */
+    Lea,
+    Alu,    /**< dst = dst alu src */
+    AluImm, /**< dst = dst alu imm */
+    Test,   /**< Flags of dst & src */
+    Setcc,  /**< dst = cond ? 1 : 0, zero-extended; two instructions */
+    Jmp,
+    Jcc,
+    Bind    /**< Not an instruction: label is bound here */
+};
+
+struct MachineInstr
+{
+    MachineOp op;
+    Reg dst = Reg::RAX, src = Reg::RAX;
+    Mem mem{Reg::RAX};
+    int64_t imm = 0;
+    uint8_t width = 8; /**< Bytes loaded or stored */
+    bool sign = false; /**< Of a narrow load */
+    AluOp alu = AluOp::Add;
+    Cond cond = Cond::E;
+    uint32_t label = 0;
+    size_t start = 0; /**< Offset in the code, once emitted */
+};
+
+/**
+ * @brief Encoder for the subset of x86-64 the code generators use.
+ *
+ * Operations are 64 bits wide unless the name or a width argument says
+ * otherwise. Branches to labels always use rel32 displacements and are
+ * patched when the label is bound; until then the waiting fields form a
+ * chain through their own displacements. Instructions that refer to something
+ * outside the buffer return the offset of their 32-bit displacement so the
+ * caller can record a relocation; the displacement is the last field of the
+ * instruction, so a PC-relative target needs an addend of -4.
+ *
+ * With the peephole optimizer on, moves, loads, stores, simple arithmetic,
+ * tests and jumps are checked against a table of rewrite rules as they are
+ * emitted, together with the few instructions right before them. A rule
+ * may drop or replace the new instruction or delete the ones before it;
+ * deletions only ever shorten the end of the code, so offsets handed out
+ * earlier stay valid, and bytes added without going through a rule (raw
+ * data, RIP-relative instructions) end the window the rules can see.
+ */
+class Assembler
+{
+public:
+    using Label = uint32_t;
+
+    std::vector<uint8_t> bytes;
+
+    size_t size() const { return bytes.size(); }
+    /** @brief Instructions emitted so far, not counting padding */
+    size_t instructionCount() const { return instructions; }
+    void setPeephole(bool enabled) { peephole = enabled; }
+
+    Label newLabel();
+    void bind(Label label);
+    bool isBound(Label label) const { return labels[label] >= 0; }
+    /** @brief Offset a bound label stands for */
+    size_t offset(Label label) const { return static_cast<size_t>(labels[label]); }
+
+    void jmp(Label label);
+    void jcc(Cond cond, Label label);
+
+    void mov(Reg dst, Reg src);
+    /** @brief Shortest encoding of dst = imm: xor, mov r32, sign-extended imm32 or movabs */
+    void movImm(Reg dst, int64_t imm);
+    /** @brief Loads and zero or sign extends a 1, 2, 4 or 8 byte value */
+    void load(Reg dst, Mem src, unsigned bytes, bool sign = false);
+    void store(Mem dst, Reg src, unsigned bytes = 8);
+    /** @brief Zero or sign extends the low bits of a register in place */
+    void extend(Reg reg, unsigned bits, bool sign);
+    void lea(Reg dst, Mem src);
+
+    void alu(AluOp op, Reg dst, Reg src);
+    void alu(AluOp op, Reg dst, int32_t imm);
+    void imul(Reg dst, Reg src);
+    /** @brief dst = src * imm */
+    void imul(Reg dst, Reg src, int32_t imm);
+    void test(Reg a, Reg b);
+    void neg(Reg reg);
+    void shift(ShiftOp op, Reg reg, uint8_t bits);
+    /** @brief Shifts by the low bits of cl */
+    void shift(ShiftOp op, Reg reg);
+    void cqo();
+    void idiv(Reg divisor);
+    void div(Reg divisor);
+    /** @brief rdx:rax = rax * src, unsigned */
+    void mul(Reg src);
+    /** @brief rdx:rax = rax * src, signed */
+    void imul(Reg src);
+    /** @brief reg = cond ? 1 : 0 over the whole register */
+    void setcc(Cond cond, Reg reg);
+
+    void push(Reg reg);
+    void pop(Reg reg);
+    void leave();
+    void ret();
+    void call(Reg target);
+    void jmp(Reg target);
+    void int3();
+
+    size_t call();
+    /** @brief Jumps through a 64-bit pointer at a RIP-relative address */
+    size_t jmpRip();
+    size_t leaRip(Reg dst);
+    size_t loadRip(Reg dst);
+    size_t storeRip(Reg src);
+
+    void movq(Xmm dst, Reg src);
+    void movq(Reg dst, Xmm src);
+    void sse(SseOp op, Xmm dst, Xmm src);
+    void loadFloat(Xmm dst, Mem src);
+    void storeFloat(Mem dst, Xmm src);
+
+    // Vector instructions take a VEX width: 0 for the SSE2 encoding, 128 or
+    // 256 for the AVX one, which zeroes or uses the upper half of the ymm
+    // register. The 256-bit integer forms need AVX2.
+    void vec(VecOp op, Xmm dst, Xmm src, unsigned vex = 0);
+    /** @brief Shifts every 64-bit lane by a constant */
+    void vecShift(bool left, Xmm reg, uint8_t bits, unsigned vex = 0);
+    void pshufd(Xmm dst, Xmm src, uint8_t order);
+    /** @brief movq(Xmm, Reg) in its VEX encoding */
+    void vmovq(Xmm dst, Reg src);
+    /** @brief Every lane of ymm dst = lane 0 of src */
+    void vbroadcastq(Xmm dst, Xmm src);
+    /** @brief Upper half of ymm dst = src */
+    void vinserti128(Xmm dst, Xmm src);
+    /** @brief dst = upper half of ymm src */
+    void vextracti128(Xmm dst, Xmm src);
+    /** @brief Leaves AVX code; required before SSE code and calls */
+    void vzeroupper();
+
+    /** @brief Pads with int3 up to a multiple of alignment */
+    void align(size_t alignment);
+
+private:
+    std::vector<int64_t> labels;  /**< Bound offset, -1 until bound */
+    std::vector<int64_t> pending; /**< Last rel32 field waiting for an unbound label, -1 for none */
+    size_t instructions = 0;
+    bool peephole = false;
+    std::vector<MachineInstr> window; /**< Last instructions the rules may rewrite, oldest first */
+    size_t windowEnd = 0;             /**< Code size right after the window */
+
+    void emit(MachineInstr instr);
+    void encode(MachineInstr &instr);
+    /** @brief Deletes the newest instruction of the window */
+    void drop();
+
+    void byte(uint8_t value) { bytes.push_back(value); }
+    void dword(uint32_t value);
+    void qword(uint64_t value);
+    void rex(bool wide, uint8_t reg, uint8_t rm, bool byteRegs = false);
+    void rex(bool wide, uint8_t reg, Mem mem, bool byteRegs = false);
+    void vex(uint8_t map, bool wide, unsigned bits, uint8_t reg, uint8_t vvvv, uint8_t rm);
+    void modrm(uint8_t reg, Mem mem);
+    void modrm(uint8_t reg, uint8_t rm) { byte(static_cast<uint8_t>(0xc0 | (reg & 7) << 3 | (rm & 7))); }
+    size_t rip(uint8_t reg);
+    void branch(Label label);
+};
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <string>
+#include <inliner.hxx>
+#include <simplify.hxx>
+
+namespace
+{
+    /** @brief Instructions a caller may grow to through calls inlined on cost alone */
+    constexpr size_t MaxCallerSize = 4000;
+    /** @brief Taken off the cost for each use of a parameter that gets a constant */
+    constexpr int ConstantUseBonus = 2;
+
+    constexpr uint32_t Unvisited = UINT32_MAX;
+
+    struct Summary
+    {
+        int size = 0;
+        std::vector<uint32_t> paramUses; /**< Per parameter index */
+    };
+
+    // Constants and parameters turn into immediates and arguments; the rest
+    // is roughly one machine instruction or bytecode each.
+    bool counts(Opcode op)
+    {
+        return op != Opcode::Nop && op != Opcode::Param && op != Opcode::Const && op != Opcode::Undef;
+    }
+
+    Summary summarize(const Function &fn)
+    {
+        Summary summary;
+        summary.paramUses.assign(fn.params.size(), 0);
+        for (const auto &block : fn.blocks)
+            for (ValueId v : block.code)
+            {
+                const Instr &instr = fn.instrs[v];
+                summary.size += counts(instr.op);
+                size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                for (size_t i = 0; i < instr.count; i += step)
+                {
+                    const Instr &used = fn.instrs[fn.operand(v, i)];
+                    if (used.op == Opcode::Param)
+                        ++summary.paramUses[static_cast<size_t>(used.imm)];
+                }
+            }
+        return summary;
+    }
+
+    /**
+     * @brief The call graph's strongly connected components, numbered so that
+     * every call leaves a component for one with a lower number or stays in it.
+     */
+    std::vector<uint32_t> components(const std::vector<std::vector<uint32_t>> &callees, uint32_t &count)
+    {
+        size_t n = callees.size();
+        std::vector<uint32_t> index(n, Unvisited), low(n), component(n);
+        std::vector<bool> onStack(n, false);
+        std::vector<uint32_t> stack;
+        std::vector<std::pair<uint32_t, size_t>> frames; // Function, next callee
+        uint32_t counter = 0;
+        count = 0;
+
+        // Tarjan's algorithm with an explicit stack; call chains can be long.
+        auto visit = [&](uint32_t f)
+        {
+            index[f] = low[f] = counter++;
+            stack.push_back(f);
+            onStack[f] = true;
+            frames.emplace_back(f, 0);
+        };
+        for (uint32_t root = 0; root < n; ++root)
+        {
+            if (index[root] != Unvisited)
+                continue;
+            visit(root);
+            while (!frames.empty())
+            {
+                auto &[f, next] = frames.back();
+                if (next < callees[f].size())
+                {
+                    uint32_t g = callees[f][next++];
+                    if (index[g] == Unvisited)
+                        visit(g);
+                    else if (onStack[g])
+                        low[f] = std::min(low[f], index[g]);
+                    continue;
+                }
+
+                uint32_t done = f;
+                frames.pop_back();
+                if (!frames.empty())
+                    low[frames.back().first] = std::min(low[frames.back().first], low[done]);
+                if (low[done] != index[done])
+                    continue;
+                uint32_t member;
+                do
+                {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    component[member] = count;
+                } while (member != done);
+                ++count;
+            }
+        }
+        return component;
+    }
+
+    /** @brief Replaces one call in fn by a copy of callee's body */
+    void inlineCall(Function &fn, ValueId call, const Function &callee)
+    {
+        BlockId from = fn.instrs[call].block;
+        uint32_t line = fn.instrs[call].line;
+        std::vector<ValueId> args(fn.operands(call), fn.operands(call) + fn.instrs[call].count);
+
+        // Whatever follows the call moves to a block the returns jump to.
+        BlockId rest = fn.addBlock();
+        {
+            auto &code = fn.blocks[from].code;
+            auto at = std::find(code.begin(), code.end(), call);
+            fn.blocks[rest].code.assign(at + 1, code.end());
+            code.erase(at, code.end());
+        }
+        for (ValueId v : fn.blocks[rest].code)
+            fn.instrs[v].block = rest;
+        fn.blocks[rest].succs = std::move(fn.blocks[from].succs);
+        fn.blocks[from].succs.clear();
+        for (BlockId succ : fn.blocks[rest].succs)
+        {
+            for (BlockId &p : fn.blocks[succ].preds)
+                if (p == from)
+                    p = rest;
+            for (ValueId v : fn.blocks[succ].code)
+            {
+                if (fn.instrs[v].op != Opcode::Phi)
+                    break;
+                ValueId *ops = fn.operands(v);
+                for (uint16_t i = 0; i < fn.instrs[v].count; i += 2)
+                    if (ops[i + 1] == from)
+                        ops[i + 1] = rest;
+            }
+        }
+
+        std::vector<BlockId> blockMap(callee.blocks.size());
+        for (BlockId &b : blockMap)
+            b = fn.addBlock();
+        std::vector<ValueId> valueMap(callee.instrs.size(), NoValue);
+        std::vector<ValueId> copies;
+        std::vector<ValueId> results; // Value, block pairs for the result phi
+
+        for (BlockId b = 0; b < callee.blocks.size(); ++b)
+        {
+            BlockId into = blockMap[b];
+            for (BlockId p : callee.blocks[b].preds)
+                fn.blocks[into].preds.push_back(blockMap[p]);
+            for (BlockId s : callee.blocks[b].succs)
+                fn.blocks[into].succs.push_back(blockMap[s]);
+
+            for (ValueId v : callee.blocks[b].code)
+            {
+                const Instr &instr = callee.instrs[v];
+                if (instr.op == Opcode::Param)
+                {
+                    valueMap[v] = args[static_cast<size_t>(instr.imm)];
+                    continue;
+                }
+                if (instr.op == Opcode::Return)
+                {
+                    if (instr.count)
+                    {
+                        results.push_back(callee.operand(v, 0));
+                        results.push_back(into);
+                    }
+                    fn.emit(into, Opcode::Jump, ValueType::Void, {}, rest, instr.line);
+                    fn.addEdge(into, rest);
+                    continue;
+                }
+
+                Instr copy = instr;
+                copy.block = into;
+                copy.count = 0;
+                if (copy.op == Opcode::Switch)
+                {
+                    fn.switches.push_back(callee.switches[copy.imm]);
+                    copy.imm = static_cast<int64_t>(fn.switches.size() - 1);
+                }
+                valueMap[v] = static_cast<ValueId>(fn.instrs.size());
+                fn.instrs.push_back(copy);
+                fn.blocks[into].code.push_back(valueMap[v]);
+                mapTargets(fn, valueMap[v], [&](BlockId target)
+                           { return blockMap[target]; });
+                copies.push_back(v);
+            }
+        }
+
+        std::vector<ValueId> ops;
+        for (ValueId v : copies)
+        {
+            const Instr &instr = callee.instrs[v];
+            if (!instr.count)
+                continue;
+            ops.assign(callee.operands(v), callee.operands(v) + instr.count);
+            for (size_t i = 0; i < ops.size(); ++i)
+                ops[i] = instr.op == Opcode::Phi && i % 2 ? blockMap[ops[i]] : valueMap[ops[i]];
+            fn.setOperands(valueMap[v], ops.data(), ops.size());
+        }
+
+        fn.emit(from, Opcode::Jump, ValueType::Void, {}, blockMap[0], line);
+        fn.addEdge(from, blockMap[0]);
+
+        // The call's id lives on as the phi of the returned values, so its
+        // uses need no rewriting; single-operand phis fold away later.
+        Instr &result = fn.instrs[call];
+        result.block = rest;
+        if (result.type == ValueType::Void)
+        {
+            result.op = Opcode::Nop;
+            return;
+        }
+        for (size_t i = 0; i < results.size(); i += 2)
+            results[i] = valueMap[results[i]];
+        result.op = results.empty() ? Opcode::Undef : Opcode::Phi;
+        result.count = 0;
+        fn.setOperands(call, results.data(), results.size());
+        fn.blocks[rest].code.insert(fn.blocks[rest].code.begin(), call);
+    }
+
+    struct Inliner
+    {
+        Module &module;
+        const InlineOptions &options;
+        std::vector<uint32_t> component;
+        std::vector<Summary> summaries;
+        std::vector<std::vector<std::string>> remarks;
+
+        void remark(uint32_t caller, const Instr &call, const char *format, const std::string &callee, int a = 0, int b = 0)
+        {
+            if (!options.remarks)
+                return;
+            char text[256];
+            snprintf(text, sizeof(text), format, a, b);
+            remarks[caller].push_back("remark: " + module.functions[caller].name + ":" + std::to_string(call.line) + ": '" + callee + "' " + text);
+        }
+
+        /** @brief Inlines the calls fn makes; returns true when it changed */
+        bool run(uint32_t caller)
+        {
+            Function &fn = module.functions[caller];
+            std::vector<ValueId> calls;
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                    if (fn.instrs[v].op == Opcode::Call || fn.instrs[v].op == Opcode::CallVirtual)
+                        calls.push_back(v);
+
+            size_t size = static_cast<size_t>(summarize(fn).size);
+            bool changed = false;
+            for (ValueId call : calls)
+            {
+                const Instr &instr = fn.instrs[call];
+                uint32_t target = static_cast<uint32_t>(instr.imm);
+                const Function &callee = module.functions[target];
+                if (instr.op == Opcode::CallVirtual)
+                {
+                    remark(caller, instr, "not inlined: virtual call", callee.name);
+                    continue;
+                }
+                if (component[target] == component[caller])
+                {
+                    remark(caller, instr, "not inlined: recursive call", callee.name);
+                    continue;
+                }
+                if (callee.inlining == InlineHint::Never)
+                {
+                    remark(caller, instr, "not inlined: marked noinline", callee.name);
+                    continue;
+                }
+
+                const Summary &summary = summaries[target];
+                if (callee.inlining == InlineHint::Always)
+                    remark(caller, instr, "inlined: marked inline", callee.name);
+                else
+                {
+                    // The call, its argument moves and the return go away.
+                    int cost = summary.size - 2 - instr.count;
+                    for (uint16_t i = 0; i < instr.count; ++i)
+                        if (fn.instrs[fn.operand(call, i)].op == Opcode::Const)
+                            cost -= ConstantUseBonus * static_cast<int>(summary.paramUses[i]);
+                    if (cost > options.threshold)
+                    {
+                        remark(caller, instr, "not inlined: cost %d exceeds threshold %d", callee.name, cost, options.threshold);
+                        continue;
+                    }
+                    if (size + static_cast<size_t>(summary.size) > MaxCallerSize)
+                    {
+                        remark(caller, instr, "not inlined: caller would grow past %d instructions", callee.name, static_cast<int>(MaxCallerSize));
+                        continue;
+                    }
+                    remark(caller, instr, "inlined: cost %d, threshold %d", callee.name, cost, options.threshold);
+                }
+                inlineCall(fn, call, callee);
+                size += static_cast<size_t>(summary.size);
+                changed = true;
+            }
+
+            if (changed)
+            {
+                // Arguments meet the callee's code; clean up before callers measure it.
+                foldInstructions(fn);
+                simplifyCFG(fn);
+                eliminateDeadCode(fn);
+                simplifyCFG(fn);
+            }
+            summaries[caller] = summarize(fn);
+            return changed;
+        }
+    };
+}
+
+bool inlineCalls(Module &module, ThreadPool &pool, const InlineOptions &options)
+{
+    size_t n = module.functions.size();
+    std::vector<std::vector<uint32_t>> callees(n);
+    for (uint32_t f = 0; f < n; ++f)
+    {
+        const Function &fn = module.functions[f];
+        for (const auto &block : fn.blocks)
+            for (ValueId v : block.code)
+                if (fn.instrs[v].op == Opcode::Call)
+                    callees[f].push_back(static_cast<uint32_t>(fn.instrs[v].imm));
+        std::sort(callees[f].begin(), callees[f].end());
+        callees[f].erase(std::unique(callees[f].begin(), callees[f].end()), callees[f].end());
+    }
+
+    Inliner inliner{module, options, {}, std::vector<Summary>(n), std::vector<std::vector<std::string>>(n)};
+    uint32_t count = 0;
+    inliner.component = components(callees, count);
+
+    // A component's level is one more than the highest level it calls into;
+    // components of one level only call into lower ones.
+    std::vector<std::vector<uint32_t>> members(count);
+    for (uint32_t f = 0; f < n; ++f)
+        members[inliner.component[f]].push_back(f);
+    std::vector<uint32_t> level(count, 0);
+    std::vector<std::vector<uint32_t>> levels;
+    for (uint32_t c = 0; c < count; ++c)
+    {
+        for (uint32_t f : members[c])
+            for (uint32_t g : callees[f])
+                if (inliner.component[g] != c)
+                    level[c] = std::max(level[c], level[inliner.component[g]] + 1);
+        if (level[c] >= levels.size())
+            levels.resize(level[c] + 1);
+        levels[level[c]].push_back(c);
+    }
+
+    std::vector<char> changed(n, 0);
+    for (const auto &ready : levels)
+        pool.parallelFor(ready.size(), [&](size_t i)
+                         {
+                             for (uint32_t f : members[ready[i]])
+                                 changed[f] = inliner.run(f);
+                         });
+
+    if (options.remarks)
+        for (const auto &lines : inliner.remarks)
+            for (const auto &line : lines)
+                fprintf(options.remarks, "%s\n", line.c_str());
+    return std::find(changed.begin(), changed.end(), 1) != changed.end();
+}
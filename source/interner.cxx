@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstring>
+#include <interner.hxx>
+
+static uint32_t hashString(std::string_view text)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : text)
+    {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+InternId StringInterner::find(std::string_view text) const
+{
+    if (slots.empty())
+        return None;
+
+    uint32_t hash = hashString(text);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        uint32_t slot = slots[i];
+        if (slot == 0)
+            return None;
+        if (hashes[slot - 1] == hash && strings[slot - 1] == text)
+            return slot - 1;
+    }
+}
+
+InternId StringInterner::intern(std::string_view text)
+{
+    if ((strings.size() + 1) * 2 > slots.size())
+        grow();
+
+    uint32_t hash = hashString(text);
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    for (;; i = (i + 1) & mask)
+    {
+        uint32_t slot = slots[i];
+        if (slot == 0)
+            break;
+        if (hashes[slot - 1] == hash && strings[slot - 1] == text)
+            return slot - 1;
+    }
+
+    InternId id = static_cast<InternId>(strings.size());
+    strings.emplace_back(store(text), text.size());
+    hashes.push_back(hash);
+    slots[i] = id + 1;
+    return id;
+}
+
+const char *StringInterner::store(std::string_view text)
+{
+    if (text.size() > chunkSize - chunkUsed)
+    {
+        chunkSize = std::max<size_t>(4096, text.size());
+        chunks.emplace_back(new char[chunkSize]);
+        chunkUsed = 0;
+    }
+    char *dest = chunks.back().get() + chunkUsed;
+    if (!text.empty())
+        std::memcpy(dest, text.data(), text.size());
+    chunkUsed += text.size();
+    return dest;
+}
+
+void StringInterner::grow()
+{
+    size_t capacity = slots.empty() ? 64 : slots.size() * 2;
+    slots.assign(capacity, 0);
+    size_t mask = capacity - 1;
+    for (uint32_t id = 0; id < strings.size(); ++id)
+    {
+        size_t i = hashes[id] & mask;
+        while (slots[i] != 0)
+            i = (i + 1) & mask;
+        slots[i] = id + 1;
+    }
+}
@@ -0,0 +1,634 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <ir.hxx>
+#include <dominators.hxx>
+
+ValueId Function::emit(BlockId block, Opcode op, ValueType type, const ValueId *ops, size_t count, int64_t imm, uint32_t line)
+{
+    ValueId id = static_cast<ValueId>(instrs.size());
+    uint32_t first = static_cast<uint32_t>(operandPool.size());
+    operandPool.insert(operandPool.end(), ops, ops + count);
+    instrs.push_back({op, type, static_cast<uint16_t>(count), block, first, line, imm});
+    blocks[block].code.push_back(id);
+    return id;
+}
+
+ValueId Function::emitFront(BlockId block, Opcode op, ValueType type, int64_t imm)
+{
+    ValueId id = static_cast<ValueId>(instrs.size());
+    instrs.push_back({op, type, 0, block, static_cast<uint32_t>(operandPool.size()), 0, imm});
+
+    auto &code = blocks[block].code;
+    auto at = code.begin();
+    if (op != Opcode::Phi)
+        while (at != code.end() && instrs[*at].op == Opcode::Phi)
+            ++at;
+    code.insert(at, id);
+    return id;
+}
+
+void Function::setOperands(ValueId value, const ValueId *ops, size_t count)
+{
+    Instr &instr = instrs[value];
+    if (count > instr.count)
+    {
+        // The old slots are abandoned; lists only grow while phis are built.
+        instr.first = static_cast<uint32_t>(operandPool.size());
+        operandPool.resize(operandPool.size() + count);
+    }
+    std::copy(ops, ops + count, operandPool.begin() + instr.first);
+    instr.count = static_cast<uint16_t>(count);
+}
+
+bool Function::isTerminated(BlockId block) const
+{
+    ValueId last = terminator(block);
+    return last != NoValue && isTerminator(instrs[last].op);
+}
+
+void Function::addEdge(BlockId from, BlockId to)
+{
+    blocks[from].succs.push_back(to);
+    blocks[to].preds.push_back(from);
+}
+
+size_t Function::liveInstructionCount() const
+{
+    size_t count = 0;
+    for (const auto &block : blocks)
+        count += block.code.size();
+    return count;
+}
+
+bool isTerminator(Opcode op)
+{
+    return op == Opcode::Jump || op == Opcode::Branch || op == Opcode::Switch || op == Opcode::Return;
+}
+
+bool isComparison(Opcode op)
+{
+    return op >= Opcode::Eq && op <= Opcode::Ge;
+}
+
+bool isIntegerValue(ValueType type)
+{
+    return type >= ValueType::I8 && type <= ValueType::U64;
+}
+
+bool isSignedValue(ValueType type)
+{
+    return type >= ValueType::I8 && type <= ValueType::I64;
+}
+
+bool isFloatValue(ValueType type)
+{
+    return type == ValueType::F32 || type == ValueType::F64;
+}
+
+unsigned valueBits(ValueType type)
+{
+    switch (type)
+    {
+    case ValueType::Bool:
+    case ValueType::Byte:
+    case ValueType::I8:
+    case ValueType::U8:
+        return 8;
+    case ValueType::I16:
+    case ValueType::U16:
+        return 16;
+    case ValueType::I32:
+    case ValueType::U32:
+    case ValueType::F32:
+        return 32;
+    case ValueType::Void:
+        return 0;
+    case ValueType::Str:
+        return 128;
+    default:
+        return 64;
+    }
+}
+
+const char *toString(Opcode op)
+{
+    static const char *const names[] = {
+        "nop", "undef", "const", "param", "add", "sub", "mul", "div", "rem", "or", "and", "shl", "shr", "mul.high",
+        "eq", "ne", "lt", "le", "gt", "ge", "phi", "call", "call.virtual", "new", "new.local",
+        "load.global", "store.global", "load.field", "store.field", "hash", "jump", "branch", "switch", "ret"};
+    return names[static_cast<size_t>(op)];
+}
+
+const char *toString(ValueType type)
+{
+    static const char *const names[] = {
+        "void", "bool", "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "f32", "f64", "byte", "str", "ptr"};
+    return names[static_cast<size_t>(type)];
+}
+
+void removeUnreachableBlocks(Function &fn)
+{
+    size_t n = fn.blocks.size();
+    std::vector<bool> live(n, false);
+    std::vector<BlockId> stack{0};
+    live[0] = true;
+    while (!stack.empty())
+    {
+        BlockId block = stack.back();
+        stack.pop_back();
+        for (BlockId succ : fn.blocks[block].succs)
+            if (!live[succ])
+            {
+                live[succ] = true;
+                stack.push_back(succ);
+            }
+    }
+
+    std::vector<BlockId> renumber(n, NoBlock);
+    BlockId next = 0;
+    for (BlockId b = 0; b < n; ++b)
+        if (live[b])
+            renumber[b] = next++;
+    if (next == n)
+        return;
+
+    std::vector<BasicBlock> blocks;
+    blocks.reserve(next);
+    for (BlockId b = 0; b < n; ++b)
+    {
+        BasicBlock &block = fn.blocks[b];
+        if (!live[b])
+        {
+            for (ValueId v : block.code)
+                fn.instrs[v].op = Opcode::Nop;
+            continue;
+        }
+
+        for (ValueId v : block.code)
+        {
+            Instr &instr = fn.instrs[v];
+            instr.block = renumber[b];
+            if (instr.op == Opcode::Phi)
+            {
+                // Keep only the incoming pairs from live predecessors.
+                ValueId *ops = fn.operands(v);
+                uint16_t kept = 0;
+                for (uint16_t i = 0; i < instr.count; i += 2)
+                    if (live[ops[i + 1]])
+                    {
+                        ops[kept] = ops[i];
+                        ops[kept + 1] = renumber[ops[i + 1]];
+                        kept += 2;
+                    }
+                instr.count = kept;
+            }
+            else if (isTerminator(instr.op))
+                mapTargets(fn, v, [&](BlockId target)
+                           { return renumber[target]; });
+        }
+
+        std::vector<BlockId> preds;
+        for (BlockId p : block.preds)
+            if (live[p])
+                preds.push_back(renumber[p]);
+        block.preds = std::move(preds);
+        for (BlockId &s : block.succs)
+            s = renumber[s];
+        blocks.push_back(std::move(block));
+    }
+    fn.blocks = std::move(blocks);
+}
+
+std::vector<BlockId> successors(const Function &fn, ValueId terminator)
+{
+    const Instr &instr = fn.instrs[terminator];
+    switch (instr.op)
+    {
+    case Opcode::Jump:
+        return {static_cast<BlockId>(instr.imm)};
+    case Opcode::Branch:
+        return {static_cast<BlockId>(static_cast<uint64_t>(instr.imm) & 0xffffffff), static_cast<BlockId>(static_cast<uint64_t>(instr.imm) >> 32)};
+    case Opcode::Switch:
+    {
+        const SwitchTable &table = fn.switches[instr.imm];
+        std::vector<BlockId> targets;
+        for (BlockId target : table.targets)
+            if (std::find(targets.begin(), targets.end(), target) == targets.end())
+                targets.push_back(target);
+        if (std::find(targets.begin(), targets.end(), table.otherwise) == targets.end())
+            targets.push_back(table.otherwise);
+        return targets;
+    }
+    default:
+        return {};
+    }
+}
+
+void removeEdge(Function &fn, BlockId from, BlockId to)
+{
+    auto &succs = fn.blocks[from].succs;
+    succs.erase(std::find(succs.begin(), succs.end(), to));
+    auto &preds = fn.blocks[to].preds;
+    preds.erase(std::find(preds.begin(), preds.end(), from));
+
+    for (ValueId v : fn.blocks[to].code)
+    {
+        Instr &instr = fn.instrs[v];
+        if (instr.op != Opcode::Phi)
+            break;
+        ValueId *ops = fn.operands(v);
+        for (uint16_t i = 0; i < instr.count; i += 2)
+            if (ops[i + 1] == from)
+            {
+                std::copy(ops + i + 2, ops + instr.count, ops + i);
+                instr.count -= 2;
+                break;
+            }
+    }
+}
+
+void replaceAllUses(Function &fn, ValueId from, ValueId to)
+{
+    for (auto &block : fn.blocks)
+        for (ValueId v : block.code)
+        {
+            ValueId *ops = fn.operands(v);
+            const Instr &instr = fn.instrs[v];
+            size_t step = instr.op == Opcode::Phi ? 2 : 1;
+            for (size_t i = 0; i < instr.count; i += step)
+                if (ops[i] == from)
+                    ops[i] = to;
+        }
+}
+
+std::vector<std::pair<ValueId, ValueId>> phiCopies(const Function &fn, BlockId from, BlockId to)
+{
+    std::vector<std::pair<ValueId, ValueId>> copies;
+    for (ValueId v : fn.blocks[to].code)
+    {
+        const Instr &instr = fn.instrs[v];
+        if (instr.op != Opcode::Phi)
+            break;
+        for (uint16_t i = 0; i < instr.count; i += 2)
+            if (fn.operand(v, i + 1) == from)
+            {
+                copies.push_back({v, fn.operand(v, i)});
+                break;
+            }
+    }
+    return copies;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> sequentializeCopies(std::vector<std::pair<uint32_t, uint32_t>> copies, uint32_t scratch)
+{
+    copies.erase(std::remove_if(copies.begin(), copies.end(), [](const auto &copy)
+                                { return copy.first == copy.second; }),
+                 copies.end());
+
+    std::vector<std::pair<uint32_t, uint32_t>> moves;
+    while (!copies.empty())
+    {
+        // A copy is safe once no other pending copy still reads its destination.
+        auto ready = std::find_if(copies.begin(), copies.end(), [&](const auto &copy)
+                                  { return std::none_of(copies.begin(), copies.end(), [&](const auto &other)
+                                                        { return other.second == copy.first; }); });
+        if (ready != copies.end())
+        {
+            moves.push_back(*ready);
+            copies.erase(ready);
+            continue;
+        }
+        uint32_t saved = copies.front().first;
+        moves.push_back({scratch, saved});
+        for (auto &copy : copies)
+            if (copy.second == saved)
+                copy.second = scratch;
+    }
+    return moves;
+}
+
+size_t removeTrivialPhis(Function &fn)
+{
+    // Forwarding table instead of use lists: resolve every operand once at
+    // the end rather than rewriting uses per removed phi.
+    std::vector<ValueId> forward(fn.instrs.size(), NoValue);
+    auto resolve = [&forward](ValueId v)
+    {
+        while (forward[v] != NoValue)
+            v = forward[v];
+        return v;
+    };
+
+    size_t removed = 0;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (auto &block : fn.blocks)
+        {
+            for (ValueId phi : block.code)
+            {
+                const Instr &instr = fn.instrs[phi];
+                if (instr.op != Opcode::Phi)
+                    break;
+                if (forward[phi] != NoValue)
+                    continue;
+
+                ValueId same = NoValue;
+                bool trivial = true;
+                const ValueId *ops = fn.operands(phi);
+                for (uint16_t i = 0; i < instr.count && trivial; i += 2)
+                {
+                    ValueId v = resolve(ops[i]);
+                    if (v == same || v == phi)
+                        continue;
+                    trivial = same == NoValue;
+                    same = v;
+                }
+                if (!trivial || same == NoValue)
+                    continue;
+
+                forward[phi] = same;
+                ++removed;
+                changed = true;
+            }
+        }
+    }
+
+    if (!removed)
+        return 0;
+
+    for (auto &block : fn.blocks)
+    {
+        auto &code = block.code;
+        code.erase(std::remove_if(code.begin(), code.end(), [&](ValueId v)
+                                  { return forward[v] != NoValue; }),
+                   code.end());
+        for (ValueId v : code)
+        {
+            ValueId *ops = fn.operands(v);
+            const Instr &instr = fn.instrs[v];
+            size_t step = instr.op == Opcode::Phi ? 2 : 1;
+            for (size_t i = 0; i < instr.count; i += step)
+                ops[i] = resolve(ops[i]);
+        }
+    }
+    for (ValueId v = 0; v < forward.size(); ++v)
+        if (forward[v] != NoValue)
+            fn.instrs[v].op = Opcode::Nop;
+    return removed;
+}
+
+namespace
+{
+    void printConstant(FILE *out, const Module &module, ValueType type, int64_t imm)
+    {
+        if (type == ValueType::F32 || type == ValueType::F64)
+        {
+            double value;
+            std::memcpy(&value, &imm, sizeof(value));
+            fprintf(out, "%.17g", value);
+        }
+        else if (type == ValueType::Str)
+        {
+            fputc('"', out);
+            for (char c : module.strings[imm])
+            {
+                if (c == '"' || c == '\\')
+                    fprintf(out, "\\%c", c);
+                else if (c == '\n')
+                    fputs("\\n", out);
+                else if (c == '\t')
+                    fputs("\\t", out);
+                else
+                    fputc(c, out);
+            }
+            fputc('"', out);
+        }
+        else if (isSignedValue(type))
+            fprintf(out, "%" PRId64, imm);
+        else
+            fprintf(out, "%" PRIu64, static_cast<uint64_t>(imm));
+    }
+}
+
+void printFunction(FILE *out, const Module &module, const Function &fn)
+{
+    DominatorTree dom;
+    dom.compute(fn);
+
+    fprintf(out, "function %s(", fn.name.c_str());
+    for (size_t i = 0; i < fn.params.size(); ++i)
+        fprintf(out, "%s%s", i ? ", " : "", toString(fn.params[i]));
+    fprintf(out, ") %s%s%s {\n", toString(fn.returnType),
+            fn.inlining == InlineHint::Always ? " inline" : fn.inlining == InlineHint::Never ? " noinline" : "",
+            fn.exported ? " export" : "");
+
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+    {
+        const BasicBlock &block = fn.blocks[b];
+        fprintf(out, "bb%u:", b);
+        if (!block.preds.empty())
+        {
+            fputs("  ; preds", out);
+            for (BlockId p : block.preds)
+                fprintf(out, " bb%u", p);
+        }
+        if (dom.reachable(b) && dom.idom[b] != NoBlock)
+            fprintf(out, "; idom bb%u", dom.idom[b]);
+        fputc('\n', out);
+
+        for (ValueId v : block.code)
+        {
+            const Instr &instr = fn.instrs[v];
+            const ValueId *ops = fn.operands(v);
+            fputs("  ", out);
+            if (instr.type != ValueType::Void)
+                fprintf(out, "%%%u = ", v);
+            fprintf(out, "%s", toString(instr.op));
+            if (instr.type != ValueType::Void)
+                fprintf(out, " %s", toString(instr.type));
+
+            switch (instr.op)
+            {
+            case Opcode::Const:
+                fputc(' ', out);
+                printConstant(out, module, instr.type, instr.imm);
+                break;
+            case Opcode::Param:
+                fprintf(out, " #%" PRId64, instr.imm);
+                break;
+            case Opcode::Phi:
+                for (uint16_t i = 0; i < instr.count; i += 2)
+                    fprintf(out, "%s [%%%u, bb%u]", i ? "," : "", ops[i], ops[i + 1]);
+                break;
+            case Opcode::Call:
+            case Opcode::CallVirtual:
+                fprintf(out, " @%s(", module.functions[instr.imm].name.c_str());
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    fprintf(out, "%s%%%u", i ? ", " : "", ops[i]);
+                fputc(')', out);
+                break;
+            case Opcode::New:
+            case Opcode::NewLocal:
+                fprintf(out, " %s", module.classes[instr.imm].name.c_str());
+                break;
+            case Opcode::LoadGlobal:
+            case Opcode::StoreGlobal:
+                fprintf(out, " @%s", module.globals[instr.imm].name.c_str());
+                if (instr.count)
+                    fprintf(out, ", %%%u", ops[0]);
+                break;
+            case Opcode::LoadField:
+            case Opcode::StoreField:
+                fprintf(out, " %%%u+%" PRId64, ops[0], instr.imm);
+                if (instr.count > 1)
+                    fprintf(out, ", %%%u", ops[1]);
+                break;
+            case Opcode::Jump:
+                fprintf(out, " bb%" PRId64, instr.imm);
+                break;
+            case Opcode::Branch:
+                fprintf(out, " %%%u, bb%" PRIu64 ", bb%" PRIu64, ops[0],
+                        static_cast<uint64_t>(instr.imm) & 0xffffffff, static_cast<uint64_t>(instr.imm) >> 32);
+                break;
+            case Opcode::Hash:
+                fprintf(out, " %%%u, %#" PRIx64, ops[0], static_cast<uint64_t>(instr.imm));
+                break;
+            case Opcode::Switch:
+            {
+                const SwitchTable &table = fn.switches[instr.imm];
+                fprintf(out, " %%%u from %" PRId64 " [", ops[0], table.low);
+                for (size_t i = 0; i < table.targets.size(); ++i)
+                    fprintf(out, "%sbb%u", i ? ", " : "", table.targets[i]);
+                fprintf(out, "], bb%u", table.otherwise);
+                break;
+            }
+            default:
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    fprintf(out, "%s%%%u", i ? ", " : " ", ops[i]);
+                break;
+            }
+            fputc('\n', out);
+        }
+    }
+    fputs("}\n", out);
+}
+
+void Module::print(FILE *out) const
+{
+    for (const auto &global : globals)
+    {
+        fprintf(out, "global %s@%s : %s = ", global.constant ? "const " : "", global.name.c_str(), toString(global.type));
+        printConstant(out, *this, global.type, global.init);
+        fputc('\n', out);
+    }
+    for (const auto &cls : classes)
+    {
+        fprintf(out, "class %s size %llu", cls.name.c_str(), static_cast<unsigned long long>(cls.size));
+        if (cls.base >= 0)
+            fprintf(out, " : %s", classes[cls.base].name.c_str());
+        if (cls.hasVptr)
+        {
+            fprintf(out, " vtable@%llu [", static_cast<unsigned long long>(cls.vptrOffset));
+            for (size_t i = 0; i < cls.vtable.size(); ++i)
+                fprintf(out, "%s@%s", i ? ", " : "", functions[cls.vtable[i]].name.c_str());
+            fputc(']', out);
+        }
+        fputc('\n', out);
+    }
+    if (!globals.empty() || !classes.empty())
+        fputc('\n', out);
+
+    for (size_t i = 0; i < functions.size(); ++i)
+    {
+        if (i)
+            fputc('\n', out);
+        printFunction(out, *this, functions[i]);
+    }
+}
+
+bool verifyFunction(const Function &fn, const DominatorTree &dom, std::string &message)
+{
+    auto fail = [&](BlockId block, const std::string &what)
+    {
+        message = fn.name + ": bb" + std::to_string(block) + ": " + what;
+        return false;
+    };
+
+    std::vector<uint32_t> position(fn.instrs.size(), UINT32_MAX);
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        for (uint32_t i = 0; i < fn.blocks[b].code.size(); ++i)
+        {
+            ValueId v = fn.blocks[b].code[i];
+            if (position[v] != UINT32_MAX)
+                return fail(b, "%" + std::to_string(v) + " is listed twice");
+            position[v] = i;
+        }
+
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+    {
+        const BasicBlock &block = fn.blocks[b];
+        if (!fn.isTerminated(b))
+            return fail(b, "block does not end in a terminator");
+
+        for (BlockId s : block.succs)
+            if (std::count(block.succs.begin(), block.succs.end(), s) != std::count(fn.blocks[s].preds.begin(), fn.blocks[s].preds.end(), b))
+                return fail(b, "edge to bb" + std::to_string(s) + " is missing from its predecessors");
+
+        std::vector<BlockId> targets = successors(fn, block.code.back());
+        std::vector<BlockId> succs = block.succs;
+        std::sort(targets.begin(), targets.end());
+        std::sort(succs.begin(), succs.end());
+        if (targets != succs)
+            return fail(b, "successors do not match the terminator");
+
+        bool phis = true;
+        for (ValueId v : block.code)
+        {
+            const Instr &instr = fn.instrs[v];
+            std::string at = "%" + std::to_string(v) + ": ";
+            if (instr.op == Opcode::Nop)
+                return fail(b, at + "removed instruction is still listed");
+            if (instr.block != b)
+                return fail(b, at + "instruction records bb" + std::to_string(instr.block));
+            if (isTerminator(instr.op) && v != block.code.back())
+                return fail(b, at + "terminator in the middle of a block");
+            if (instr.op == Opcode::Phi)
+            {
+                if (!phis)
+                    return fail(b, at + "phi after a non-phi instruction");
+                if (instr.count != 2 * block.preds.size())
+                    return fail(b, at + "phi does not have one operand per predecessor");
+            }
+            else
+                phis = false;
+
+            if (!dom.reachable(b))
+                continue;
+            const ValueId *ops = fn.operands(v);
+            size_t step = instr.op == Opcode::Phi ? 2 : 1;
+            for (size_t i = 0; i < instr.count; i += step)
+            {
+                ValueId op = ops[i];
+                if (op >= fn.instrs.size() || position[op] == UINT32_MAX)
+                    return fail(b, at + "uses %" + std::to_string(op) + ", which is not in any block");
+                BlockId def = fn.instrs[op].block;
+                bool dominated;
+                if (instr.op == Opcode::Phi)
+                {
+                    if (std::find(block.preds.begin(), block.preds.end(), ops[i + 1]) == block.preds.end())
+                        return fail(b, at + "phi names bb" + std::to_string(ops[i + 1]) + ", which is not a predecessor");
+                    dominated = !dom.reachable(ops[i + 1]) || dom.dominates(def, ops[i + 1]);
+                }
+                else if (def == b)
+                    dominated = position[op] < position[v];
+                else
+                    dominated = dom.dominates(def, b);
+                if (!dominated)
+                    return fail(b, at + "use of %" + std::to_string(op) + " is not dominated by its definition");
+            }
+        }
+    }
+    return true;
+}
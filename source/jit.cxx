@@ -0,0 +1,547 @@
+#include <csetjmp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <jit.hxx>
+#include <x86.hxx>
+
+#if VSHARP_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t RuntimeFunctions = static_cast<size_t>(RuntimeFunction::Trap) + 1;
+
+    // Where Jit::trap returns to on this thread, and what it reports.
+    thread_local std::jmp_buf *trapPoint = nullptr;
+    thread_local std::string trapMessage;
+
+    size_t roundUp(size_t value, size_t to)
+    {
+        return (value + to - 1) / to * to;
+    }
+
+    char *concat(const char *a, const char *b)
+    {
+        size_t n = std::strlen(a), m = std::strlen(b);
+        char *s = static_cast<char *>(std::malloc(n + m + 1));
+        std::memcpy(s, a, n);
+        std::memcpy(s + n, b, m + 1);
+        return s;
+    }
+
+    uint64_t runtimeAddress(RuntimeFunction function)
+    {
+        switch (function)
+        {
+        case RuntimeFunction::Calloc: return reinterpret_cast<uint64_t>(&::calloc);
+        case RuntimeFunction::Strcmp: return reinterpret_cast<uint64_t>(&::strcmp);
+        case RuntimeFunction::Strlen: return reinterpret_cast<uint64_t>(&::strlen);
+        case RuntimeFunction::Malloc: return reinterpret_cast<uint64_t>(&::malloc);
+        case RuntimeFunction::Strcpy: return reinterpret_cast<uint64_t>(&::strcpy);
+        case RuntimeFunction::Strcat: return reinterpret_cast<uint64_t>(&::strcat);
+        case RuntimeFunction::Concat: return reinterpret_cast<uint64_t>(&concat);
+        case RuntimeFunction::Trap: return 0;
+        }
+        return 0;
+    }
+
+    void patchRel32(std::vector<uint8_t> &code, size_t field, const uint8_t *placedAt, const void *target)
+    {
+        int64_t disp = static_cast<const uint8_t *>(target) - (placedAt + field + 4);
+        int32_t rel = static_cast<int32_t>(disp);
+        std::memcpy(&code[field], &rel, sizeof(rel));
+    }
+}
+
+Jit::Jit(const Module &module, unsigned optLevel, size_t codeBytes)
+    : module(module), optLevel(optLevel), compiled(module.functions.size(), nullptr), compiledBytes(module.functions.size(), 0)
+{
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    size_t writable = 8 * (module.functions.size() + RuntimeFunctions + module.globals.size());
+    for (const auto &cls : module.classes)
+        writable += 8 * cls.vtable.size();
+    size_t readOnly = 0;
+    for (const auto &str : module.strings)
+        readOnly += str.size() + 1;
+    writable = roundUp(writable, page);
+    readOnly = roundUp(readOnly, page);
+    codeCapacity = roundUp(codeBytes, page);
+
+    // rel32 reaches 2 GiB either way; keep the whole range inside that.
+    reserved = writable + readOnly + codeCapacity;
+    if (reserved >= (size_t(1) << 31))
+        throw JitError("JIT address range too large");
+    void *range = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (range == MAP_FAILED)
+        throw JitError("Cannot reserve memory for the JIT");
+    base = static_cast<uint8_t *>(range);
+    code = base + writable + readOnly;
+
+    // The destructor does not run if construction fails.
+    try
+    {
+        if (writable && mprotect(base, writable, PROT_READ | PROT_WRITE) != 0)
+            throw JitError("Cannot map JIT data");
+        uint8_t *at = base;
+        entries = reinterpret_cast<uint64_t *>(at);
+        at += 8 * (module.functions.size() + RuntimeFunctions);
+        for (size_t i = 0; i < RuntimeFunctions; ++i)
+            entries[module.functions.size() + i] = runtimeAddress(static_cast<RuntimeFunction>(i));
+
+        uint8_t *text = base + writable;
+        if (readOnly && mprotect(text, readOnly, PROT_READ | PROT_WRITE) != 0)
+            throw JitError("Cannot map JIT strings");
+        for (const auto &str : module.strings)
+        {
+            strings.push_back(text);
+            std::memcpy(text, str.c_str(), str.size() + 1);
+            text += str.size() + 1;
+        }
+        if (readOnly)
+            mprotect(base + writable, readOnly, PROT_READ);
+
+        for (const auto &global : module.globals)
+        {
+            globals.push_back(at);
+            uint64_t value = global.type == ValueType::Str ? reinterpret_cast<uint64_t>(strings[global.init]) : static_cast<uint64_t>(global.init);
+            std::memcpy(at, &value, 8);
+            at += 8;
+        }
+
+        emitStubs();
+
+        // Vtables hold stubs, so virtual calls also compile on first use.
+        for (const auto &cls : module.classes)
+        {
+            vtables.push_back(at);
+            for (uint32_t method : cls.vtable)
+            {
+                uint64_t stub = reinterpret_cast<uint64_t>(stubs[method]);
+                std::memcpy(at, &stub, 8);
+                at += 8;
+            }
+        }
+    }
+    catch (...)
+    {
+        munmap(base, reserved);
+        throw;
+    }
+}
+
+Jit::~Jit()
+{
+    if (perfMap)
+        fclose(perfMap);
+    if (base)
+        munmap(base, reserved);
+    for (void *block : heap)
+        std::free(block);
+}
+
+void Jit::emitStubs()
+{
+    Assembler a;
+    std::vector<std::pair<size_t, const void *>> fields;
+
+    // The resolver is entered by a jump from a stub, with the function index
+    // in r11 and the caller's arguments still in place. It saves the argument
+    // registers, compiles, restores them and jumps to the new code.
+    const Reg saved[] = {Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9};
+    constexpr int SseArgs = 8;
+    Assembler::Label resolver = a.newLabel();
+    a.bind(resolver);
+    a.push(Reg::RBP);
+    a.mov(Reg::RBP, Reg::RSP);
+    for (Reg reg : saved)
+        a.push(reg);
+    a.alu(AluOp::Sub, Reg::RSP, 8 * SseArgs);
+    for (int i = 0; i < SseArgs; ++i)
+    {
+        a.movq(Reg::RAX, static_cast<Xmm>(i));
+        a.store({Reg::RSP, 8 * i}, Reg::RAX);
+    }
+    a.movImm(Reg::RDI, static_cast<int64_t>(reinterpret_cast<uintptr_t>(this)));
+    a.mov(Reg::RSI, Reg::R11);
+    a.movImm(Reg::RAX, static_cast<int64_t>(reinterpret_cast<uintptr_t>(&Jit::resolve)));
+    a.call(Reg::RAX);
+    a.mov(Reg::R11, Reg::RAX);
+    for (int i = 0; i < SseArgs; ++i)
+    {
+        a.load(Reg::RAX, {Reg::RSP, 8 * i}, 8);
+        a.movq(static_cast<Xmm>(i), Reg::RAX);
+    }
+    a.alu(AluOp::Add, Reg::RSP, 8 * SseArgs);
+    for (size_t i = std::size(saved); i-- > 0;)
+        a.pop(saved[i]);
+    a.pop(Reg::RBP);
+    a.jmp(Reg::R11);
+
+    std::vector<size_t> stubAt, lazyAt, runtimeAt;
+    for (size_t i = 0; i < module.functions.size(); ++i)
+    {
+        a.align(8);
+        stubAt.push_back(a.size());
+        fields.push_back({a.jmpRip(), &entries[i]});
+        lazyAt.push_back(a.size());
+        a.movImm(Reg::R11, static_cast<int64_t>(i));
+        a.jmp(resolver);
+    }
+    // Allocations go through the Jit, which frees them when it is destroyed,
+    // and traps to it to find the function; their stubs shift the arguments
+    // up one register to pass it first.
+    for (size_t i = 0; i < RuntimeFunctions; ++i)
+    {
+        a.align(8);
+        runtimeAt.push_back(a.size());
+        const void *owner = nullptr;
+        switch (static_cast<RuntimeFunction>(i))
+        {
+        case RuntimeFunction::Calloc: owner = reinterpret_cast<const void *>(&Jit::ownCalloc); break;
+        case RuntimeFunction::Malloc: owner = reinterpret_cast<const void *>(&Jit::ownMalloc); break;
+        case RuntimeFunction::Concat: owner = reinterpret_cast<const void *>(&Jit::ownConcat); break;
+        case RuntimeFunction::Trap: owner = reinterpret_cast<const void *>(&Jit::trap); break;
+        default: break;
+        }
+        if (!owner)
+        {
+            fields.push_back({a.jmpRip(), &entries[module.functions.size() + i]});
+            continue;
+        }
+        a.mov(Reg::RDX, Reg::RSI);
+        a.mov(Reg::RSI, Reg::RDI);
+        a.movImm(Reg::RDI, static_cast<int64_t>(reinterpret_cast<uintptr_t>(this)));
+        a.movImm(Reg::RAX, static_cast<int64_t>(reinterpret_cast<uintptr_t>(owner)));
+        a.jmp(Reg::RAX);
+    }
+
+    // Nothing is placed before the stubs, so they start the code area.
+    NativeFunction out;
+    out.code = std::move(a.bytes);
+    for (const auto &[field, target] : fields)
+        patchRel32(out.code, field, code, target);
+    stubBytes = out.code.size();
+    const uint8_t *start = place(std::move(out), "vsharp.stubs");
+
+    for (size_t i = 0; i < module.functions.size(); ++i)
+    {
+        stubs.push_back(start + stubAt[i]);
+        entries[i] = reinterpret_cast<uint64_t>(start + lazyAt[i]);
+    }
+    for (size_t at : runtimeAt)
+        runtimeStubs.push_back(start + at);
+}
+
+const uint8_t *Jit::place(NativeFunction fn, const std::string &name, bool freshPages)
+{
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = roundUp(codeUsed, freshPages ? page : 16);
+    if (start + fn.code.size() > codeCapacity)
+        throw JitError("JIT code space exhausted");
+    uint8_t *at = code + start;
+
+    for (const auto &reloc : fn.relocations)
+    {
+        const void *target = nullptr;
+        switch (reloc.target)
+        {
+        case NativeTarget::Function:
+            target = compiled[reloc.index] ? compiled[reloc.index] : stubs[reloc.index];
+            break;
+        case NativeTarget::Runtime:
+            target = runtimeStubs[reloc.index];
+            break;
+        case NativeTarget::Global:
+            target = globals[reloc.index];
+            break;
+        case NativeTarget::String:
+            target = strings[reloc.index];
+            break;
+        case NativeTarget::Vtable:
+            target = vtables[reloc.index];
+            break;
+        }
+        patchRel32(fn.code, reloc.offset, at, target);
+    }
+
+    // Only the pages being written lose execute permission, and only until
+    // the copy is done.
+    uint8_t *first = code + (freshPages ? start : codeUsed / page * page);
+    size_t length = roundUp(static_cast<size_t>(at + fn.code.size() - first), page);
+    if (mprotect(first, length, PROT_READ | PROT_WRITE) != 0)
+        throw JitError("Cannot make JIT code writable");
+    if (!freshPages)
+        std::memset(code + codeUsed, 0xcc, start - codeUsed);
+    std::memcpy(at, fn.code.data(), fn.code.size());
+    if (mprotect(first, length, PROT_READ | PROT_EXEC) != 0)
+        throw JitError("Cannot make JIT code executable");
+
+    codeUsed = start + fn.code.size();
+    mapSymbol(at, fn.code.size(), name);
+    return at;
+}
+
+const void *Jit::compile(uint32_t function, bool freshPages)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (compiled[function])
+        return compiled[function];
+
+    const Function &fn = module.functions[function];
+    const uint8_t *entry = place(compileX86(module, fn, optLevel, __builtin_cpu_supports("avx2")), nativeSymbol(fn), freshPages);
+    compiled[function] = entry;
+    compiledBytes[function] = static_cast<size_t>(code + codeUsed - entry);
+    placed.push_back({entry, compiledBytes[function], function});
+
+    // Generated code may be reading these on another thread; aligned 8-byte
+    // stores are seen whole.
+    uint64_t address = reinterpret_cast<uint64_t>(entry);
+    __atomic_store_n(&entries[function], address, __ATOMIC_RELEASE);
+    for (size_t c = 0; c < module.classes.size(); ++c)
+        for (size_t slot = 0; slot < module.classes[c].vtable.size(); ++slot)
+            if (module.classes[c].vtable[slot] == function)
+                __atomic_store_n(reinterpret_cast<uint64_t *>(vtables[c] + 8 * slot), address, __ATOMIC_RELEASE);
+    return entry;
+}
+
+NativeFunction Jit::arrayAdapter(const Function &fn, uint32_t &call) const
+{
+    const Reg intArgs[] = {Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9};
+    constexpr unsigned SseArgs = 8;
+
+    // The System V locations of the arguments, as the code generator assigns them.
+    std::vector<size_t> stack;
+    std::vector<std::pair<size_t, unsigned>> ints, sses;
+    for (size_t i = 0; i < fn.params.size(); ++i)
+    {
+        if (isFloatValue(fn.params[i]) && sses.size() < SseArgs)
+            sses.push_back({i, static_cast<unsigned>(sses.size())});
+        else if (!isFloatValue(fn.params[i]) && ints.size() < std::size(intArgs))
+            ints.push_back({i, static_cast<unsigned>(ints.size())});
+        else
+            stack.push_back(i);
+    }
+
+    Assembler a;
+    NativeFunction out;
+    a.push(Reg::RBP);
+    a.mov(Reg::RBP, Reg::RSP);
+    a.mov(Reg::R10, Reg::RDI);
+    if (stack.size() % 2)
+        a.alu(AluOp::Sub, Reg::RSP, 8);
+    for (size_t i = stack.size(); i-- > 0;)
+    {
+        a.load(Reg::RAX, {Reg::R10, static_cast<int32_t>(8 * stack[i])}, 8);
+        if (fn.params[stack[i]] == ValueType::F32)
+        {
+            a.movq(0, Reg::RAX);
+            a.sse(SseOp::CvtSd2Ss, 0, 0);
+            a.movq(Reg::RAX, 0);
+        }
+        a.push(Reg::RAX);
+    }
+    for (const auto &[param, xmm] : sses)
+    {
+        a.load(Reg::RAX, {Reg::R10, static_cast<int32_t>(8 * param)}, 8);
+        a.movq(static_cast<Xmm>(xmm), Reg::RAX);
+        if (fn.params[param] == ValueType::F32)
+            a.sse(SseOp::CvtSd2Ss, static_cast<Xmm>(xmm), static_cast<Xmm>(xmm));
+    }
+    for (const auto &[param, reg] : ints)
+        a.load(intArgs[reg], {Reg::R10, static_cast<int32_t>(8 * param)}, 8);
+    call = static_cast<uint32_t>(a.call());
+
+    if (isFloatValue(fn.returnType))
+    {
+        if (fn.returnType == ValueType::F32)
+            a.sse(SseOp::CvtSs2Sd, 0, 0);
+        a.movq(Reg::RAX, 0);
+    }
+    else if (fn.returnType == ValueType::Bool || fn.returnType == ValueType::Byte)
+        a.extend(Reg::RAX, 8, false);
+    else if (isIntegerValue(fn.returnType))
+        a.extend(Reg::RAX, valueBits(fn.returnType), isSignedValue(fn.returnType));
+    a.leave();
+    a.ret();
+    out.code = std::move(a.bytes);
+    return out;
+}
+
+Jit::ArrayEntry Jit::arrayEntry(uint32_t function, bool freshPages)
+{
+    const Function &fn = module.functions[function];
+    uint32_t call;
+    NativeFunction out = arrayAdapter(fn, call);
+    out.relocations.push_back({call, NativeTarget::Function, function});
+
+    std::lock_guard<std::mutex> guard(lock);
+    return reinterpret_cast<ArrayEntry>(const_cast<uint8_t *>(place(std::move(out), "vsharp.entry." + fn.name, freshPages)));
+}
+
+Jit::ArrayEntry Jit::compileEntry(const Function &fn, uint32_t source, bool freshPages)
+{
+    // The adapter and the function are placed as one piece, so the call
+    // between them needs no relocation.
+    uint32_t call;
+    NativeFunction out = arrayAdapter(fn, call);
+    NativeFunction body = compileX86(module, fn, optLevel, __builtin_cpu_supports("avx2"));
+    size_t start = roundUp(out.code.size(), 16);
+    out.code.resize(start, 0xcc);
+    out.code.insert(out.code.end(), body.code.begin(), body.code.end());
+    int32_t rel = static_cast<int32_t>(start - (call + 4));
+    std::memcpy(&out.code[call], &rel, sizeof(rel));
+    for (NativeRelocation reloc : body.relocations)
+    {
+        reloc.offset += static_cast<uint32_t>(start);
+        out.relocations.push_back(reloc);
+    }
+
+    size_t bytes = out.code.size();
+    std::lock_guard<std::mutex> guard(lock);
+    const uint8_t *entry = place(std::move(out), nativeSymbol(fn), freshPages);
+    placed.push_back({entry, bytes, source});
+    return reinterpret_cast<ArrayEntry>(const_cast<uint8_t *>(entry));
+}
+
+const void *Jit::resolve(Jit *jit, uint64_t function)
+{
+    // Generated frames have no unwind tables, so nothing may be thrown
+    // through them.
+    try
+    {
+        return jit->compile(static_cast<uint32_t>(function));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::exit(1);
+    }
+}
+
+std::string Jit::functionAt(const void *returnAddress)
+{
+    auto at = static_cast<const uint8_t *>(returnAddress);
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto &range : placed)
+        if (at > range.start && at <= range.start + range.size)
+            return module.functions[range.function].name;
+    return "native code";
+}
+
+void Jit::trap(Jit *jit)
+{
+    // The call to vsharp_trap is the last thing in its function, so the
+    // return address may be just past the function's code.
+    trapMessage = "Runtime error in " + jit->functionAt(__builtin_return_address(0)) + ": Division by zero";
+    if (!trapPoint)
+    {
+        std::cerr << trapMessage << std::endl;
+        std::exit(1);
+    }
+    std::longjmp(*trapPoint, 1);
+}
+
+uint64_t Jit::call(ArrayEntry entry, const uint64_t *args)
+{
+    // Nothing between here and the trap has a destructor to run: generated
+    // frames call only generated code and the runtime.
+    std::jmp_buf point;
+    std::jmp_buf *outer = trapPoint;
+    trapPoint = &point;
+    if (setjmp(point))
+    {
+        trapPoint = outer;
+        throw JitError(trapMessage);
+    }
+    uint64_t result = entry(args);
+    trapPoint = outer;
+    return result;
+}
+
+void *Jit::own(void *block)
+{
+    std::lock_guard<std::mutex> guard(heapLock);
+    heap.push_back(block);
+    return block;
+}
+
+void *Jit::ownCalloc(Jit *jit, size_t count, size_t size)
+{
+    return jit->own(std::calloc(count, size));
+}
+
+void *Jit::ownMalloc(Jit *jit, size_t size)
+{
+    return jit->own(std::malloc(size));
+}
+
+char *Jit::ownConcat(Jit *jit, const char *a, const char *b)
+{
+    return static_cast<char *>(jit->own(concat(a, b)));
+}
+
+bool Jit::writePerfMap()
+{
+    if (perfMap)
+        return true;
+    std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+    perfMap = fopen(path.c_str(), "w");
+    if (!perfMap)
+        return false;
+    mapSymbol(code, stubBytes, "vsharp.stubs");
+    for (size_t i = 0; i < compiled.size(); ++i)
+        if (compiled[i])
+            mapSymbol(compiled[i], compiledBytes[i], nativeSymbol(module.functions[i]));
+    return true;
+}
+
+void Jit::mapSymbol(const uint8_t *start, size_t size, const std::string &name)
+{
+    if (!perfMap)
+        return;
+    fprintf(perfMap, "%lx %zx %s\n", static_cast<unsigned long>(reinterpret_cast<uintptr_t>(start)), size, name.c_str());
+    fflush(perfMap);
+}
+
+const void *Jit::address(uint32_t function) const
+{
+    return stubs[function];
+}
+
+int Jit::run()
+{
+    call(arrayEntry(module.initializer), nullptr);
+    if (module.entry < 0)
+        throw JitError("No main function to run");
+
+    uint64_t status = call(arrayEntry(static_cast<uint32_t>(module.entry)), nullptr);
+    return isIntegerValue(module.functions[module.entry].returnType) ? static_cast<int>(status) : 0;
+}
+
+#else
+
+Jit::Jit(const Module &module, unsigned optLevel, size_t) : module(module), optLevel(optLevel)
+{
+    throw JitError("The JIT is only available on x86-64 Linux");
+}
+
+Jit::~Jit() {}
+
+bool Jit::writePerfMap() { return false; }
+
+const void *Jit::address(uint32_t) const { return nullptr; }
+
+const void *Jit::compile(uint32_t, bool) { return nullptr; }
+
+Jit::ArrayEntry Jit::arrayEntry(uint32_t, bool) { return nullptr; }
+
+Jit::ArrayEntry Jit::compileEntry(const Function &, uint32_t, bool) { return nullptr; }
+
+uint64_t Jit::call(ArrayEntry entry, const uint64_t *args) { return entry(args); }
+
+int Jit::run() { return 0; }
+
+#endif
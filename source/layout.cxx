@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <layout.hxx>
+#include <string.hxx>
+#include <symbols.hxx>
+#include <hierarchy.hxx>
+#include <types.hxx>
+
+bool LayoutProfile::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string name;
+        uint64_t count;
+        if (!(fields >> name >> count))
+            return false;
+
+        size_t dot = name.find('.');
+        if (dot == std::string::npos || dot == 0 || dot + 1 == name.size())
+            return false;
+
+        counts[name] += count;
+        types[name.substr(0, dot)] += count;
+    }
+    return true;
+}
+
+uint64_t LayoutProfile::count(std::string_view type, std::string_view field) const
+{
+    std::string key;
+    key.reserve(type.size() + field.size() + 1);
+    key.append(type).append(1, '.').append(field);
+    auto it = counts.find(key);
+    return it == counts.end() ? 0 : it->second;
+}
+
+namespace
+{
+    uint64_t alignTo(uint64_t offset, uint64_t align)
+    {
+        return (offset + align - 1) & ~(align - 1);
+    }
+
+    // Assigns offsets in the given order and returns the unpadded end.
+    uint64_t place(std::vector<FieldLayout> &fields, uint64_t offset)
+    {
+        for (auto &field : fields)
+        {
+            offset = alignTo(offset, field.align);
+            field.offset = offset;
+            offset += field.size;
+        }
+        return offset;
+    }
+}
+
+void LayoutEngine::run(const ASTNode *root)
+{
+    if (!root)
+        return;
+
+    if (root->type == ASTNodeType::ClassDecl)
+        layoutType(static_cast<const ClassDeclNode *>(root));
+
+    const ASTNode *body = root->type == ASTNodeType::ClassDecl ? static_cast<const ClassDeclNode *>(root)->body.get() : root;
+    if (body && body->type == ASTNodeType::Block)
+        for (auto &child : static_cast<const BlockNode *>(body)->children)
+            if (child->type == ASTNodeType::ClassDecl)
+                run(child.get());
+}
+
+const TypeLayout &LayoutEngine::layoutType(const ClassDeclNode *decl)
+{
+    if (const TypeLayout *done = find(decl))
+        return *done;
+
+    // Bases are laid out first, their fields form a prefix of the instance.
+    const TypeLayout *base = nullptr;
+    if (const Symbol *baseClass = decl->symbol->baseClass)
+        base = &layoutType(static_cast<const ClassDeclNode *>(baseClass->decl));
+
+    TypeLayout &layout = all.emplace_back();
+    layout.decl = decl;
+    layout.base = base;
+    layout.keepOrder = decl->hasAttribute("keep_order");
+    index[decl] = &layout;
+
+    // The base subobject sits at offset 0 so a subclass pointer is also a
+    // valid base pointer. Only classes with virtual methods pay for a vtable
+    // pointer; the first class of a hierarchy that needs one places it after
+    // its base and every subclass inherits that position.
+    uint64_t start = 0;
+    if (base)
+    {
+        start = base->size;
+        layout.align = base->align;
+        layout.vptrOffset = base->vptrOffset;
+    }
+    bool ownVptr = hierarchy && hierarchy->hasVtable(decl->symbol) && !(base && base->hasVptr);
+    layout.hasVptr = ownVptr || (base && base->hasVptr);
+    if (ownVptr)
+    {
+        start = alignTo(start, PointerSize);
+        layout.vptrOffset = start;
+        start += PointerSize;
+        layout.align = std::max(layout.align, PointerSize);
+    }
+
+    auto &fields = layout.fields;
+    if (decl->body)
+    {
+        for (auto &child : static_cast<const BlockNode *>(decl->body.get())->children)
+        {
+            if (child->type != ASTNodeType::VarDecl)
+                continue;
+            auto *var = static_cast<const VarDeclNode *>(child.get());
+            if (var->modifier == ModifierType::Static)
+                continue;
+
+            const TypeInfo *type = var->symbol->typeInfo;
+            fields.push_back({var, 0, sizeOf(type), alignOf(type)});
+        }
+    }
+
+    for (auto &field : fields)
+        layout.align = std::max(layout.align, field.align);
+
+    layout.declarationSize = alignTo(place(fields, start), layout.align);
+
+    if (!layout.keepOrder)
+    {
+        bool profiled = profile && profile->covers(decl->name);
+        if (profiled)
+        {
+            uint64_t hottest = 0;
+            for (auto &field : fields)
+            {
+                field.accesses = profile->count(decl->name, field.decl->name);
+                hottest = std::max(hottest, field.accesses);
+            }
+            for (auto &field : fields)
+            {
+                field.hot = field.accesses > 0 && field.accesses * HotFraction >= hottest;
+                layout.split |= !field.hot;
+            }
+        }
+
+        std::stable_sort(fields.begin(), fields.end(), [](const FieldLayout &a, const FieldLayout &b)
+                         {
+            if (a.hot != b.hot)
+                return a.hot;
+            if (a.align != b.align)
+                return a.align > b.align;
+            // Larger fields first keeps 16-byte fields on 16-byte offsets, so
+            // they never straddle a line.
+            return a.size > b.size; });
+        place(fields, start);
+    }
+
+    uint64_t used = (ownVptr ? PointerSize : 0) + (base ? base->size - base->padding : 0);
+    layout.straddling = base ? base->straddling : 0;
+    for (auto &field : fields)
+    {
+        used += field.size;
+        if (field.size && field.offset / CacheLineSize != (field.offset + field.size - 1) / CacheLineSize)
+            ++layout.straddling;
+    }
+
+    for (auto &field : fields)
+        offsets[field.decl] = field.offset;
+
+    uint64_t end = fields.empty() ? start : fields.back().offset + fields.back().size;
+    layout.size = alignTo(end, layout.align);
+    layout.padding = layout.size - used;
+    return layout;
+}
+
+void LayoutEngine::print(FILE *out) const
+{
+    for (const auto &layout : all)
+    {
+        fprintf(out, "%s %s: size %llu, align %llu, padding %llu, straddling %zu",
+                layout.decl->isStructure ? "structure" : "class", layout.decl->name.c_str(),
+                (unsigned long long)layout.size, (unsigned long long)layout.align,
+                (unsigned long long)layout.padding, layout.straddling);
+        if (layout.keepOrder)
+            fprintf(out, " [keep_order]");
+        else if (layout.size < layout.declarationSize)
+            fprintf(out, " (declaration order: %llu)", (unsigned long long)layout.declarationSize);
+        fputc('\n', out);
+
+        if (layout.base)
+            fprintf(out, "  %6u %4llu  <base %s>\n", 0u, (unsigned long long)layout.base->size,
+                    layout.base->decl->name.c_str());
+        if (layout.hasVptr && !(layout.base && layout.base->hasVptr))
+            fprintf(out, "  %6llu %4llu  <vptr>\n", (unsigned long long)layout.vptrOffset, (unsigned long long)PointerSize);
+        for (const auto &field : layout.fields)
+        {
+            fprintf(out, "  %6llu %4llu  %s : %s", (unsigned long long)field.offset, (unsigned long long)field.size,
+                    field.decl->name.c_str(), std::string(toString_Type(field.decl->varType)).c_str());
+            if (layout.split)
+                fprintf(out, field.hot ? "  hot (%llu)" : "  cold (%llu)", (unsigned long long)field.accesses);
+            if (field.offset / CacheLineSize != (field.offset + field.size - 1) / CacheLineSize)
+                fprintf(out, "  straddles line %llu", (unsigned long long)(field.offset / CacheLineSize));
+            fputc('\n', out);
+        }
+    }
+}
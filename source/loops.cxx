@@ -0,0 +1,837 @@
+#include <algorithm>
+#include <analysis.hxx>
+#include <loops.hxx>
+#include <simplify.hxx>
+
+namespace
+{
+    /** @brief Exit tests simulated further than this leave the trip count unknown */
+    constexpr uint64_t MaxSimulatedTrips = 1 << 16;
+
+    BlockId trueTarget(const Instr &branch) { return static_cast<BlockId>(static_cast<uint64_t>(branch.imm) & 0xffffffff); }
+    BlockId falseTarget(const Instr &branch) { return static_cast<BlockId>(static_cast<uint64_t>(branch.imm) >> 32); }
+
+    bool isWideInteger(ValueType type)
+    {
+        return type == ValueType::I64 || type == ValueType::U64;
+    }
+
+    /** @brief The incoming value of a phi along the edge from a block */
+    ValueId incoming(const Function &fn, ValueId phi, BlockId from)
+    {
+        for (uint16_t i = 0; i < fn.instrs[phi].count; i += 2)
+            if (fn.operand(phi, i + 1) == from)
+                return fn.operand(phi, i);
+        return NoValue;
+    }
+
+    /** @brief Makes every edge from -> to of a block's terminator go to a new target */
+    void retarget(Function &fn, BlockId block, BlockId to, BlockId target)
+    {
+        mapTargets(fn, fn.terminator(block), [&](BlockId succ)
+                   { return succ == to ? target : succ; });
+        for (BlockId &succ : fn.blocks[block].succs)
+            if (succ == to)
+            {
+                succ = target;
+                auto &preds = fn.blocks[to].preds;
+                preds.erase(std::find(preds.begin(), preds.end(), block));
+                fn.blocks[target].preds.push_back(block);
+            }
+    }
+
+    /** @brief Emits an instruction right before the terminator of a block */
+    ValueId emitBeforeEnd(Function &fn, BlockId block, Opcode op, ValueType type, std::initializer_list<ValueId> ops, int64_t imm = 0)
+    {
+        ValueId v = fn.emit(block, op, type, ops, imm);
+        auto &code = fn.blocks[block].code;
+        std::swap(code[code.size() - 1], code[code.size() - 2]);
+        return v;
+    }
+
+    ValueId emitPhi(Function &fn, BlockId block, ValueType type, const std::vector<ValueId> &pairs)
+    {
+        ValueId phi = fn.emitFront(block, Opcode::Phi, type);
+        fn.setOperands(phi, pairs.data(), pairs.size());
+        return phi;
+    }
+
+    /** @brief A phi of the header stepping by a constant every iteration */
+    struct Induction
+    {
+        ValueId phi;
+        ValueId init; /**< From the preheader */
+        int64_t step;
+    };
+
+    class LoopOptimizer
+    {
+    public:
+        LoopOptimizer(Function &fn, const LoopOptions &options, std::vector<std::string> *remarks)
+            : fn(fn), options(options), remarks(remarks) {}
+
+        bool run();
+
+    private:
+        Function &fn;
+        const LoopOptions &options;
+        std::vector<std::string> *remarks;
+        DominatorTree dom;
+        LoopInfo info;
+        std::vector<BlockId> preheaders; /**< Per loop, NoBlock for none */
+        std::vector<bool> inLoop;
+
+        void analyze();
+        void mark(const Loop &loop);
+        bool ensurePreheaders();
+        bool hoist(const Loop &loop, BlockId preheader);
+        std::vector<Induction> inductions(const Loop &loop, BlockId preheader) const;
+        bool reduceStrength(const Loop &loop, BlockId preheader);
+        bool tripCount(const Loop &loop, BlockId preheader, uint64_t &trips) const;
+        BlockId onlyExit(const Loop &loop) const;
+        bool replaceExitValues(const Loop &loop, BlockId preheader, uint64_t trips);
+        bool deleteIfDead(const Loop &loop, BlockId preheader, BlockId exit);
+        bool simplifyCountedLoops();
+        bool unrollLoops();
+        void unroll(const Loop &loop, BlockId exit, unsigned copies, bool complete);
+        size_t size(const Loop &loop) const;
+        void remark(const Loop &loop, const std::string &text);
+    };
+
+    void LoopOptimizer::analyze()
+    {
+        dom.compute(fn);
+        info.compute(fn, dom);
+        preheaders.assign(info.loops.size(), NoBlock);
+        for (size_t i = 0; i < info.loops.size(); ++i)
+        {
+            const Loop &loop = info.loops[i];
+            const auto &preds = fn.blocks[loop.header].preds;
+            if (preds.size() != loop.latches.size() + 1)
+                continue;
+            for (BlockId pred : preds)
+                if (std::find(loop.latches.begin(), loop.latches.end(), pred) == loop.latches.end() && fn.blocks[pred].succs.size() == 1)
+                    preheaders[i] = pred;
+        }
+    }
+
+    void LoopOptimizer::mark(const Loop &loop)
+    {
+        inLoop.assign(fn.blocks.size(), false);
+        for (BlockId block : loop.blocks)
+            inLoop[block] = true;
+    }
+
+    bool LoopOptimizer::ensurePreheaders()
+    {
+        bool changed = false;
+        for (size_t i = 0; i < info.loops.size(); ++i)
+        {
+            const Loop &loop = info.loops[i];
+            if (preheaders[i] != NoBlock)
+                continue;
+            std::vector<BlockId> entries;
+            for (BlockId pred : fn.blocks[loop.header].preds)
+                if (std::find(loop.latches.begin(), loop.latches.end(), pred) == loop.latches.end())
+                    entries.push_back(pred);
+            // A branch with both targets at the header enters twice; simplifyCFG turns it into a jump.
+            std::vector<BlockId> distinct = entries;
+            std::sort(distinct.begin(), distinct.end());
+            if (entries.empty() || std::unique(distinct.begin(), distinct.end()) != distinct.end())
+                continue;
+
+            BlockId preheader = fn.addBlock();
+            for (ValueId phi : fn.blocks[loop.header].code)
+            {
+                if (fn.instrs[phi].op != Opcode::Phi)
+                    break;
+                std::vector<ValueId> outside, kept;
+                for (uint16_t k = 0; k < fn.instrs[phi].count; k += 2)
+                {
+                    ValueId value = fn.operand(phi, k), from = fn.operand(phi, k + 1);
+                    bool entry = std::find(entries.begin(), entries.end(), from) != entries.end();
+                    (entry ? outside : kept).insert((entry ? outside : kept).end(), {value, from});
+                }
+                ValueId value = outside.size() == 2 ? outside[0] : emitPhi(fn, preheader, fn.instrs[phi].type, outside);
+                kept.insert(kept.end(), {value, preheader});
+                fn.setOperands(phi, kept.data(), kept.size());
+            }
+            for (BlockId entry : entries)
+                retarget(fn, entry, loop.header, preheader);
+            fn.emit(preheader, Opcode::Jump, ValueType::Void, {}, loop.header);
+            fn.addEdge(preheader, loop.header);
+            changed = true;
+        }
+        if (changed)
+            analyze();
+        return changed;
+    }
+
+    bool LoopOptimizer::hoist(const Loop &loop, BlockId preheader)
+    {
+        mark(loop);
+        bool calls = false;
+        std::vector<bool> stored;
+        for (BlockId block : loop.blocks)
+            for (ValueId v : fn.blocks[block].code)
+            {
+                const Instr &instr = fn.instrs[v];
+                calls |= instr.op == Opcode::Call || instr.op == Opcode::CallVirtual;
+                if (instr.op == Opcode::StoreGlobal)
+                {
+                    stored.resize(std::max<size_t>(stored.size(), static_cast<size_t>(instr.imm) + 1));
+                    stored[instr.imm] = true;
+                }
+            }
+
+        auto invariant = [&](ValueId v)
+        {
+            const Instr &instr = fn.instrs[v];
+            for (uint16_t i = 0; i < instr.count; ++i)
+                if (inLoop[fn.instrs[fn.operand(v, i)].block])
+                    return false;
+            switch (instr.op)
+            {
+            case Opcode::Const:
+                return true;
+            case Opcode::Div:
+            case Opcode::Rem:
+            {
+                // Hoisting must not make a division by zero happen that the loop skips.
+                const Instr &divisor = fn.instrs[fn.operand(v, 1)];
+                if (!isFloatValue(instr.type) && (divisor.op != Opcode::Const || divisor.imm == 0))
+                    return false;
+                return instr.type != ValueType::Str;
+            }
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::Or:
+            case Opcode::And:
+            case Opcode::Shl:
+            case Opcode::Shr:
+            case Opcode::MulHigh:
+                return instr.type != ValueType::Str;
+            case Opcode::Eq:
+            case Opcode::Ne:
+            case Opcode::Lt:
+            case Opcode::Le:
+            case Opcode::Gt:
+            case Opcode::Ge:
+                return fn.instrs[fn.operand(v, 0)].type != ValueType::Str;
+            case Opcode::LoadGlobal:
+                return !calls && (static_cast<size_t>(instr.imm) >= stored.size() || !stored[instr.imm]);
+            default:
+                return false;
+            }
+        };
+
+        // Dominators first, so operands are hoisted before their uses.
+        std::vector<BlockId> order = loop.blocks;
+        std::sort(order.begin(), order.end(), [&](BlockId a, BlockId b)
+                  { return dom.order[a] < dom.order[b]; });
+        auto &target = fn.blocks[preheader].code;
+        bool changed = false;
+        for (BlockId block : order)
+        {
+            auto &code = fn.blocks[block].code;
+            size_t kept = 0;
+            for (ValueId v : code)
+            {
+                if (!invariant(v))
+                {
+                    code[kept++] = v;
+                    continue;
+                }
+                target.insert(target.end() - 1, v);
+                fn.instrs[v].block = preheader;
+                changed = true;
+            }
+            code.resize(kept);
+        }
+        return changed;
+    }
+
+    std::vector<Induction> LoopOptimizer::inductions(const Loop &loop, BlockId preheader) const
+    {
+        std::vector<Induction> found;
+        if (loop.latches.size() != 1)
+            return found;
+        BlockId latch = loop.latches[0];
+        for (ValueId phi : fn.blocks[loop.header].code)
+        {
+            const Instr &instr = fn.instrs[phi];
+            if (instr.op != Opcode::Phi)
+                break;
+            if (!isIntegerValue(instr.type) || instr.count != 4)
+                continue;
+            ValueId next = incoming(fn, phi, latch);
+            const Instr &update = fn.instrs[next];
+            if (update.op != Opcode::Add && update.op != Opcode::Sub)
+                continue;
+            ValueId lhs = fn.operand(next, 0), rhs = fn.operand(next, 1);
+            if (update.op == Opcode::Add && rhs == phi)
+                std::swap(lhs, rhs);
+            if (lhs != phi || fn.instrs[rhs].op != Opcode::Const)
+                continue;
+            int64_t step = fn.instrs[rhs].imm;
+            if (update.op == Opcode::Sub)
+                step = *foldInteger(Opcode::Sub, instr.type, 0, step);
+            found.push_back({phi, incoming(fn, phi, preheader), step});
+        }
+        return found;
+    }
+
+    bool LoopOptimizer::reduceStrength(const Loop &loop, BlockId preheader)
+    {
+        std::vector<Induction> ivs = inductions(loop, preheader);
+        if (ivs.empty())
+            return false;
+        BlockId latch = loop.latches[0];
+        bool changed = false;
+        for (BlockId block : loop.blocks)
+            for (size_t at = 0; at < fn.blocks[block].code.size(); ++at)
+            {
+                ValueId v = fn.blocks[block].code[at];
+                if (fn.instrs[v].op != Opcode::Mul)
+                    continue;
+                ValueId lhs = fn.operand(v, 0), rhs = fn.operand(v, 1);
+                if (fn.instrs[lhs].op == Opcode::Const)
+                    std::swap(lhs, rhs);
+                auto iv = std::find_if(ivs.begin(), ivs.end(), [&](const Induction &candidate)
+                                       { return candidate.phi == lhs; });
+                if (iv == ivs.end() || fn.instrs[rhs].op != Opcode::Const)
+                    continue;
+
+                // i * k steps by step * k along with i.
+                ValueType type = fn.instrs[v].type;
+                int64_t factor = fn.instrs[rhs].imm;
+                ValueId scale = emitBeforeEnd(fn, preheader, Opcode::Const, type, {}, factor);
+                ValueId start = emitBeforeEnd(fn, preheader, Opcode::Mul, type, {iv->init, scale});
+                ValueId step = emitBeforeEnd(fn, preheader, Opcode::Const, type, {}, *foldInteger(Opcode::Mul, type, iv->step, factor));
+                ValueId phi = emitPhi(fn, loop.header, type, {start, preheader, start, latch});
+                ValueId next = emitBeforeEnd(fn, latch, Opcode::Add, type, {phi, step});
+                fn.operands(phi)[2] = next;
+                replaceAllUses(fn, v, phi);
+
+                auto &code = fn.blocks[block].code;
+                code.erase(std::find(code.begin(), code.end(), v));
+                fn.instrs[v].op = Opcode::Nop;
+                at = static_cast<size_t>(-1);
+                changed = true;
+            }
+        return changed;
+    }
+
+    BlockId LoopOptimizer::onlyExit(const Loop &loop) const
+    {
+        BlockId exit = NoBlock;
+        for (BlockId block : loop.blocks)
+            for (BlockId succ : fn.blocks[block].succs)
+                if (!inLoop[succ])
+                {
+                    if (block != loop.header || exit != NoBlock)
+                        return NoBlock;
+                    exit = succ;
+                }
+        return exit;
+    }
+
+    bool LoopOptimizer::tripCount(const Loop &loop, BlockId preheader, uint64_t &trips) const
+    {
+        ValueId branch = fn.terminator(loop.header);
+        if (fn.instrs[branch].op != Opcode::Branch)
+            return false;
+        ValueId test = fn.operand(branch, 0);
+        const Instr &compare = fn.instrs[test];
+        if (!isComparison(compare.op))
+            return false;
+        ValueId lhs = fn.operand(test, 0), rhs = fn.operand(test, 1);
+        bool stayOnTrue = inLoop[trueTarget(fn.instrs[branch])];
+
+        for (const Induction &iv : inductions(loop, preheader))
+        {
+            bool left = lhs == iv.phi;
+            ValueId limit = left ? rhs : lhs;
+            if ((!left && rhs != iv.phi) || fn.instrs[limit].op != Opcode::Const || fn.instrs[iv.init].op != Opcode::Const)
+                continue;
+            ValueType type = fn.instrs[iv.phi].type;
+            int64_t value = fn.instrs[iv.init].imm, bound = fn.instrs[limit].imm;
+            for (uint64_t n = 0; n <= MaxSimulatedTrips; ++n)
+            {
+                bool stays = *(left ? foldInteger(compare.op, type, value, bound) : foldInteger(compare.op, type, bound, value)) != 0;
+                if (stays != stayOnTrue)
+                {
+                    trips = n;
+                    return true;
+                }
+                value = *foldInteger(Opcode::Add, type, value, iv.step);
+            }
+        }
+        return false;
+    }
+
+    bool LoopOptimizer::replaceExitValues(const Loop &loop, BlockId preheader, uint64_t trips)
+    {
+        bool changed = false;
+        for (const Induction &iv : inductions(loop, preheader))
+        {
+            if (fn.instrs[iv.init].op != Opcode::Const)
+                continue;
+            ValueType type = fn.instrs[iv.phi].type;
+            int64_t last = *foldInteger(Opcode::Add, type, fn.instrs[iv.init].imm, *foldInteger(Opcode::Mul, type, static_cast<int64_t>(trips), iv.step));
+            ValueId constant = NoValue;
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                if (inLoop[b] || !dom.reachable(b))
+                    continue;
+                for (ValueId v : fn.blocks[b].code)
+                {
+                    ValueId *ops = fn.operands(v);
+                    size_t step = fn.instrs[v].op == Opcode::Phi ? 2 : 1;
+                    for (size_t i = 0; i < fn.instrs[v].count; i += step)
+                        if (ops[i] == iv.phi)
+                        {
+                            if (constant == NoValue)
+                                constant = emitBeforeEnd(fn, preheader, Opcode::Const, type, {}, last);
+                            ops[i] = constant;
+                            changed = true;
+                        }
+                }
+            }
+        }
+        return changed;
+    }
+
+    bool LoopOptimizer::deleteIfDead(const Loop &loop, BlockId preheader, BlockId exit)
+    {
+        for (BlockId block : loop.blocks)
+            for (ValueId v : fn.blocks[block].code)
+            {
+                Opcode op = fn.instrs[v].op;
+                if (hasSideEffects(fn, v) && op != Opcode::Jump && op != Opcode::Branch)
+                    return false;
+            }
+        for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        {
+            if (inLoop[b] || !dom.reachable(b))
+                continue;
+            for (ValueId v : fn.blocks[b].code)
+            {
+                size_t step = fn.instrs[v].op == Opcode::Phi ? 2 : 1;
+                for (size_t i = 0; i < fn.instrs[v].count; i += step)
+                    if (inLoop[fn.instrs[fn.operand(v, i)].block])
+                        return false;
+            }
+        }
+
+        // Values flowing out along the exit edge now come from the preheader.
+        for (ValueId phi : fn.blocks[exit].code)
+        {
+            if (fn.instrs[phi].op != Opcode::Phi)
+                break;
+            ValueId *ops = fn.operands(phi);
+            for (uint16_t i = 0; i < fn.instrs[phi].count; i += 2)
+                if (ops[i + 1] == loop.header)
+                    ops[i + 1] = preheader;
+        }
+        retarget(fn, preheader, loop.header, exit);
+        removeEdge(fn, loop.header, exit);
+        removeUnreachableBlocks(fn);
+        return true;
+    }
+
+    bool LoopOptimizer::simplifyCountedLoops()
+    {
+        bool changed = false;
+        for (size_t i = info.loops.size(); i-- > 0;)
+        {
+            const Loop &loop = info.loops[i];
+            BlockId preheader = preheaders[i];
+            uint64_t trips;
+            if (preheader == NoBlock)
+                continue;
+            mark(loop);
+            BlockId exit = onlyExit(loop);
+            if (exit == NoBlock || !tripCount(loop, preheader, trips))
+                continue;
+            changed |= replaceExitValues(loop, preheader, trips);
+            if (deleteIfDead(loop, preheader, exit))
+            {
+                // Blocks were renumbered; start over on what is left.
+                analyze();
+                i = info.loops.size();
+            }
+        }
+        return changed;
+    }
+
+    size_t LoopOptimizer::size(const Loop &loop) const
+    {
+        size_t count = 0;
+        for (BlockId block : loop.blocks)
+            count += fn.blocks[block].code.size();
+        return count;
+    }
+
+    void LoopOptimizer::remark(const Loop &loop, const std::string &text)
+    {
+        if (remarks)
+            remarks->push_back("remark: " + fn.name + ":" + std::to_string(fn.instrs[fn.terminator(loop.header)].line) + ": loop " + text);
+    }
+
+    bool LoopOptimizer::unrollLoops()
+    {
+        std::vector<BlockId> headers;
+        for (size_t i = 0; i < info.loops.size(); ++i)
+        {
+            bool innermost = std::none_of(info.loops.begin(), info.loops.end(), [&](const Loop &inner)
+                                          { return inner.parent == static_cast<int>(i); });
+            if (innermost && preheaders[i] != NoBlock && info.loops[i].latches.size() == 1)
+                headers.push_back(info.loops[i].header);
+        }
+
+        bool changed = false;
+        for (BlockId header : headers)
+        {
+            // Block numbers survive unrolling, which only adds blocks.
+            size_t index = static_cast<size_t>(info.loopOf[header]);
+            const Loop &loop = info.loops[index];
+            BlockId preheader = preheaders[index];
+            mark(loop);
+            BlockId exit = onlyExit(loop);
+            ValueId branch = fn.terminator(header);
+            if (exit == NoBlock || fn.blocks[exit].preds.size() != 1 || fn.instrs[branch].op != Opcode::Branch)
+                continue;
+
+            size_t body = size(loop);
+            uint64_t trips;
+            if (options.fullUnroll && tripCount(loop, preheader, trips) && trips <= LoopOptions::MaxFullUnroll &&
+                (trips + 1) * body <= LoopOptions::FullUnrollBudget)
+            {
+                remark(loop, "unrolled completely: " + std::to_string(trips) + " iterations");
+                unroll(loop, exit, static_cast<unsigned>(trips), true);
+            }
+            else if (options.unroll > 1 && body * options.unroll <= LoopOptions::PartialUnrollBudget)
+            {
+                ReductionLoop reduction;
+                if (matchReductionLoop(fn, header, reduction))
+                {
+                    remark(loop, "not unrolled: left for the vectorizer");
+                    continue;
+                }
+                remark(loop, "unrolled by " + std::to_string(options.unroll));
+                unroll(loop, exit, options.unroll - 1, false);
+            }
+            else
+                continue;
+            changed = true;
+            analyze();
+        }
+        return changed;
+    }
+
+    void LoopOptimizer::unroll(const Loop &loop, BlockId exit, unsigned copies, bool complete)
+    {
+        BlockId header = loop.header, latch = loop.latches[0];
+        size_t values = fn.instrs.size();
+        std::vector<ValueId> phis;
+        for (ValueId v : fn.blocks[header].code)
+            if (fn.instrs[v].op == Opcode::Phi)
+                phis.push_back(v);
+
+        // maps[k] takes a value of the loop to its copy in iteration k; the
+        // original is iteration 0.
+        std::vector<std::vector<ValueId>> maps(copies + 1);
+        std::vector<BlockId> headers{header}, latches{latch};
+        auto lookup = [&](unsigned k, ValueId v)
+        { return k == 0 || maps[k][v] == NoValue ? v : maps[k][v]; };
+
+        for (unsigned k = 1; k <= copies; ++k)
+        {
+            std::vector<ValueId> &map = maps[k];
+            map.assign(values, NoValue);
+            std::vector<BlockId> blockMap(fn.blocks.size(), NoBlock);
+            for (BlockId block : loop.blocks)
+                blockMap[block] = fn.addBlock();
+
+            // The copy of the header is entered from one latch only, so its
+            // phis become whatever the previous iteration passed back.
+            for (ValueId phi : phis)
+                map[phi] = lookup(k - 1, incoming(fn, phi, latch));
+            for (BlockId block : loop.blocks)
+            {
+                std::vector<ValueId> code = fn.blocks[block].code;
+                for (ValueId v : code)
+                {
+                    if (block == header && fn.instrs[v].op == Opcode::Phi)
+                        continue;
+                    Instr instr = fn.instrs[v];
+                    if (instr.op == Opcode::Switch)
+                    {
+                        fn.switches.push_back(fn.switches[instr.imm]);
+                        instr.imm = static_cast<int64_t>(fn.switches.size() - 1);
+                    }
+                    std::vector<ValueId> ops(fn.operands(v), fn.operands(v) + instr.count);
+                    map[v] = fn.emit(blockMap[block], instr.op, instr.type, ops.data(), ops.size(), instr.imm, instr.line);
+                }
+            }
+
+            for (BlockId block : loop.blocks)
+                for (ValueId v : fn.blocks[blockMap[block]].code)
+                {
+                    Instr &instr = fn.instrs[v];
+                    ValueId *ops = fn.operands(v);
+                    for (uint16_t i = 0; i < instr.count; ++i)
+                        ops[i] = instr.op == Opcode::Phi && i % 2 ? blockMap[ops[i]] : lookup(k, ops[i]);
+                    // Back edges go to the original header until the copies are chained.
+                    auto target = [&](BlockId to)
+                    { return inLoop[to] && to != header ? blockMap[to] : to; };
+                    if (!isTerminator(instr.op))
+                        continue;
+                    mapTargets(fn, v, target);
+                    for (BlockId succ : successors(fn, v))
+                        fn.addEdge(blockMap[block], succ);
+                }
+
+            for (ValueId phi : fn.blocks[exit].code)
+            {
+                if (fn.instrs[phi].op != Opcode::Phi)
+                    break;
+                std::vector<ValueId> ops(fn.operands(phi), fn.operands(phi) + fn.instrs[phi].count);
+                ops.insert(ops.end(), {lookup(k, incoming(fn, phi, header)), blockMap[header]});
+                fn.setOperands(phi, ops.data(), ops.size());
+            }
+
+            headers.push_back(blockMap[header]);
+            latches.push_back(blockMap[latch]);
+        }
+
+        // Chain the copies: every latch but the last goes on to the next header.
+        for (unsigned k = 1; k <= copies; ++k)
+            retarget(fn, latches[k - 1], header, headers[k]);
+
+        for (ValueId phi : phis)
+        {
+            ValueId *ops = fn.operands(phi);
+            for (uint16_t i = 0; i < fn.instrs[phi].count; i += 2)
+                if (ops[i + 1] == latch)
+                {
+                    ops[i] = lookup(copies, ops[i]);
+                    ops[i + 1] = latches.back();
+                }
+        }
+
+        // Values of the header used after the loop now arrive from any of the
+        // headers, so they meet in a phi at the exit.
+        std::vector<ValueId> merged(values, NoValue);
+        size_t original = inLoop.size();
+        for (BlockId b = 0; b < original; ++b)
+        {
+            if (inLoop[b])
+                continue;
+            // The exit gains phis on the way.
+            std::vector<ValueId> code = fn.blocks[b].code;
+            for (ValueId v : code)
+            {
+                if (b == exit && fn.instrs[v].op == Opcode::Phi)
+                    continue;
+                size_t step = fn.instrs[v].op == Opcode::Phi ? 2 : 1;
+                for (size_t i = 0; i < fn.instrs[v].count; i += step)
+                {
+                    ValueId op = fn.operand(v, i);
+                    if (op >= values || !inLoop[fn.instrs[op].block])
+                        continue;
+                    if (merged[op] == NoValue)
+                    {
+                        std::vector<ValueId> pairs;
+                        for (unsigned k = 0; k <= copies; ++k)
+                            pairs.insert(pairs.end(), {lookup(k, op), headers[k]});
+                        merged[op] = emitPhi(fn, exit, fn.instrs[op].type, pairs);
+                    }
+                    fn.operands(v)[i] = merged[op];
+                }
+            }
+        }
+
+        if (complete)
+        {
+            // The trip count decides every test: each copy of the header but
+            // the last stays in the loop, and the last one leaves. Settling
+            // them here leaves the exit a single predecessor, so its phis go
+            // and the values computed after the loop fold along with it.
+            for (unsigned k = 0; k <= copies; ++k)
+            {
+                ValueId branch = fn.terminator(headers[k]);
+                Instr &instr = fn.instrs[branch];
+                BlockId stay = trueTarget(instr) == exit ? falseTarget(instr) : trueTarget(instr);
+                BlockId taken = k == copies ? exit : stay;
+                removeEdge(fn, headers[k], k == copies ? stay : exit);
+                instr.op = Opcode::Jump;
+                instr.count = 0;
+                instr.imm = taken;
+            }
+        }
+    }
+
+    bool LoopOptimizer::run()
+    {
+        // Earlier passes may leave unreachable blocks; removing them
+        // renumbers the rest, which stales cached analyses.
+        size_t blocks = fn.blocks.size();
+        removeUnreachableBlocks(fn);
+        bool changed = fn.blocks.size() != blocks;
+        analyze();
+        if (info.loops.empty())
+            return changed;
+
+        changed |= ensurePreheaders();
+        for (size_t i = info.loops.size(); i-- > 0;)
+            if (preheaders[i] != NoBlock)
+            {
+                changed |= hoist(info.loops[i], preheaders[i]);
+                changed |= reduceStrength(info.loops[i], preheaders[i]);
+            }
+        changed |= simplifyCountedLoops();
+        if (options.fullUnroll || options.unroll > 1)
+            changed |= unrollLoops();
+
+        removeUnreachableBlocks(fn);
+        changed |= removeTrivialPhis(fn) > 0;
+        return changed;
+    }
+}
+
+bool optimizeLoops(Function &fn, const LoopOptions &options, std::vector<std::string> *remarks)
+{
+    if (fn.blocks.empty())
+        return false;
+    return LoopOptimizer(fn, options, remarks).run();
+}
+
+bool optimizeLoops(Module &module, ThreadPool &pool, const LoopOptions &options)
+{
+    std::vector<char> changed(module.functions.size(), 0);
+    std::vector<std::vector<std::string>> remarks(module.functions.size());
+    pool.parallelFor(module.functions.size(), [&](size_t index)
+                     { changed[index] = optimizeLoops(module.functions[index], options, options.remarks ? &remarks[index] : nullptr); });
+    if (options.remarks)
+        for (const auto &lines : remarks)
+            for (const auto &line : lines)
+                fprintf(options.remarks, "%s\n", line.c_str());
+    return std::find(changed.begin(), changed.end(), 1) != changed.end();
+}
+
+bool matchReductionLoop(const Function &fn, BlockId header, ReductionLoop &loop)
+{
+    const BasicBlock &head = fn.blocks[header];
+    ValueId branch = fn.terminator(header);
+    if (head.preds.size() != 2 || branch == NoValue || fn.instrs[branch].op != Opcode::Branch)
+        return false;
+
+    bool stayOnTrue = false;
+    loop.latch = NoBlock;
+    for (bool onTrue : {true, false})
+    {
+        BlockId target = onTrue ? trueTarget(fn.instrs[branch]) : falseTarget(fn.instrs[branch]);
+        const BasicBlock &block = fn.blocks[target];
+        if (target != header && block.preds.size() == 1 && block.succs.size() == 1 && block.succs[0] == header)
+        {
+            loop.latch = target;
+            loop.exit = onTrue ? falseTarget(fn.instrs[branch]) : trueTarget(fn.instrs[branch]);
+            stayOnTrue = onTrue;
+        }
+    }
+    if (loop.latch == NoBlock || loop.exit == loop.latch || loop.exit == header)
+        return false;
+    loop.header = header;
+    loop.preheader = head.preds[0] == loop.latch ? head.preds[1] : head.preds[0];
+    if (loop.preheader == loop.latch || fn.blocks[loop.preheader].succs.size() != 1)
+        return false;
+
+    // The header holds nothing but phis, the exit test and the branch.
+    const auto &code = head.code;
+    ValueId test = fn.operand(branch, 0);
+    if (code.size() < 3 || code[code.size() - 2] != test || !isComparison(fn.instrs[test].op))
+        return false;
+    auto inBody = [&](ValueId v)
+    { return fn.instrs[v].block == header || fn.instrs[v].block == loop.latch; };
+
+    loop.inductions.clear();
+    loop.accumulators.clear();
+    for (size_t i = 0; i + 2 < code.size(); ++i)
+    {
+        ValueId phi = code[i];
+        const Instr &instr = fn.instrs[phi];
+        if (instr.op != Opcode::Phi || !isWideInteger(instr.type))
+            return false;
+        ValueId next = incoming(fn, phi, loop.latch);
+        const Instr &update = fn.instrs[next];
+        if (update.block != loop.latch || (update.op != Opcode::Add && update.op != Opcode::Sub && update.op != Opcode::Or))
+            return false;
+        ValueId lhs = fn.operand(next, 0), rhs = fn.operand(next, 1);
+        if (update.op != Opcode::Sub && rhs == phi)
+            std::swap(lhs, rhs);
+        if (lhs != phi || rhs == phi)
+            return false;
+        if (update.op != Opcode::Or && fn.instrs[rhs].op == Opcode::Const)
+            loop.inductions.push_back({phi, update.op == Opcode::Add ? fn.instrs[rhs].imm : static_cast<int64_t>(0 - static_cast<uint64_t>(fn.instrs[rhs].imm))});
+        else
+            loop.accumulators.push_back({phi, next, rhs});
+    }
+
+    // Normalize the test to the counter staying below or at the bound.
+    ValueId lhs = fn.operand(test, 0), rhs = fn.operand(test, 1);
+    Opcode op = fn.instrs[test].op;
+    if (!stayOnTrue)
+    {
+        static const Opcode inverse[] = {Opcode::Ne, Opcode::Eq, Opcode::Ge, Opcode::Gt, Opcode::Le, Opcode::Lt};
+        op = inverse[static_cast<size_t>(op) - static_cast<size_t>(Opcode::Eq)];
+    }
+    if (op == Opcode::Gt || op == Opcode::Ge)
+    {
+        std::swap(lhs, rhs);
+        op = op == Opcode::Gt ? Opcode::Lt : Opcode::Le;
+    }
+    if (op != Opcode::Lt && op != Opcode::Le)
+        return false;
+    auto counter = std::find_if(loop.inductions.begin(), loop.inductions.end(), [&](const ReductionLoop::Induction &iv)
+                                { return iv.phi == lhs && iv.step == 1; });
+    if (counter == loop.inductions.end() || inBody(rhs))
+        return false;
+    loop.counter = lhs;
+    loop.bound = rhs;
+    loop.inclusive = op == Opcode::Le;
+    loop.isSigned = isSignedValue(fn.instrs[lhs].type);
+
+    // The latch only computes terms; accumulators feed their own update alone.
+    auto isAccumulator = [&](ValueId v)
+    {
+        return std::any_of(loop.accumulators.begin(), loop.accumulators.end(), [&](const ReductionLoop::Accumulator &acc)
+                           { return acc.phi == v || acc.update == v; });
+    };
+    for (ValueId v : fn.blocks[loop.latch].code)
+    {
+        const Instr &instr = fn.instrs[v];
+        if (instr.op == Opcode::Jump)
+            continue;
+        bool shift = instr.op == Opcode::Shl && fn.instrs[fn.operand(v, 1)].op == Opcode::Const;
+        if (instr.op != Opcode::Const && instr.op != Opcode::Add && instr.op != Opcode::Sub && instr.op != Opcode::Mul && instr.op != Opcode::Or && !shift)
+            return false;
+        if (instr.op != Opcode::Const && !isWideInteger(instr.type))
+            return false;
+        bool ownUpdate = std::any_of(loop.accumulators.begin(), loop.accumulators.end(), [&](const ReductionLoop::Accumulator &acc)
+                                     { return acc.update == v; });
+        for (uint16_t i = 0; i < instr.count; ++i)
+        {
+            ValueId op = fn.operand(v, i);
+            if (isAccumulator(op) && !(ownUpdate && fn.instrs[op].op == Opcode::Phi))
+                return false;
+        }
+    }
+    for (ValueId v : head.code)
+        for (uint16_t i = 0; fn.instrs[v].op != Opcode::Phi && i < fn.instrs[v].count; ++i)
+            if (isAccumulator(fn.operand(v, i)))
+                return false;
+    return true;
+}
@@ -0,0 +1,1239 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <parser.hxx>
+#include <lower.hxx>
+#include <hierarchy.hxx>
+#include <layout.hxx>
+#include <symbols.hxx>
+#include <visitor.hxx>
+#include <error.hxx>
+
+namespace
+{
+    ValueType valueType(Type type)
+    {
+        switch (type)
+        {
+        case Type::Void:
+            return ValueType::Void;
+        case Type::Boolean:
+            return ValueType::Bool;
+        case Type::Byte:
+            return ValueType::Byte;
+        case Type::String:
+            return ValueType::Str;
+        case Type::Int8:
+            return ValueType::I8;
+        case Type::Int16:
+            return ValueType::I16;
+        case Type::Int32:
+            return ValueType::I32;
+        case Type::Int64:
+            return ValueType::I64;
+        case Type::Uint8:
+            return ValueType::U8;
+        case Type::Uint16:
+            return ValueType::U16;
+        case Type::Uint32:
+            return ValueType::U32;
+        case Type::Uint64:
+            return ValueType::U64;
+        case Type::Float32:
+            return ValueType::F32;
+        case Type::Float64:
+            return ValueType::F64;
+        }
+        return ValueType::Void;
+    }
+
+    // Class instances are referenced through pointers.
+    ValueType valueType(const TypeInfo *type)
+    {
+        if (!type)
+            return ValueType::Void;
+        return type->kind == TypeKind::Primitive ? valueType(type->primitive) : ValueType::Ptr;
+    }
+
+    int64_t doubleBits(double value)
+    {
+        int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // String literals keep their quotes and escapes in the tree.
+    std::string unquote(const std::string &literal)
+    {
+        std::string_view body = literal;
+        if (body.size() >= 2 && body.front() == '"' && body.back() == '"')
+            body = body.substr(1, body.size() - 2);
+
+        std::string out;
+        for (size_t i = 0; i < body.size(); ++i)
+        {
+            if (body[i] != '\\' || i + 1 == body.size())
+            {
+                out += body[i];
+                continue;
+            }
+            switch (body[++i])
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case '0': out += '\0'; break;
+            default: out += body[i]; break;
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief When match becomes a Switch: at least MinSwitchCases values
+     * spread over at most SwitchDensity slots each and MaxSwitchRange in all.
+     * Fewer cases become a chain of compares, sparser ones a binary search.
+     */
+    constexpr size_t MinSwitchCases = 4;
+    constexpr uint64_t SwitchDensity = 3;
+    constexpr uint64_t MaxSwitchRange = 4096;
+    /** @brief Hash seeds tried per table size when looking for a perfect hash of match strings */
+    constexpr unsigned HashSeeds = 64;
+    constexpr uint64_t HashBasis = 0xcbf29ce484222325;
+
+    struct MatchCase
+    {
+        int64_t value; /**< Constant as encoded for the subject's type */
+        BlockId arm;
+    };
+
+    bool isLocal(const Symbol *symbol)
+    {
+        return (symbol->kind == SymbolKind::Variable || symbol->kind == SymbolKind::Constant || symbol->kind == SymbolKind::Parameter) &&
+               (symbol->scope->kind == ScopeKind::Function || symbol->scope->kind == ScopeKind::Block);
+    }
+
+    bool isInstanceField(const Symbol *symbol)
+    {
+        return symbol->kind == SymbolKind::Field && !symbol->isStatic;
+    }
+
+    [[noreturn]] void error(const std::string &message, const ASTNode *at, const std::string &lexeme, const std::string &source)
+    {
+        Error::semantic(message, Token{TokenType::Identifier, lexeme, currentFile, at->line, at->column}, source);
+    }
+
+    class ModuleLowering;
+
+    /**
+     * @brief Builds the CFG of one function, keeping local variables in SSA
+     * form as it goes: a block's current definition of each variable is kept
+     * in defs, reads in blocks whose predecessors are not all known yet get an
+     * incomplete phi completed when the block is sealed, and phis found to be
+     * trivial are forwarded to the value they stand for.
+     */
+    class FunctionLowering : public ASTVisitor<FunctionLowering, ValueId>
+    {
+    public:
+        FunctionLowering(ModuleLowering &module, Function &fn) : module(module), fn(fn)
+        {
+            current = newBlock();
+            seal(current);
+        }
+
+        void lowerFunction(const FunctionDeclNode *decl, bool instance);
+        void lowerClassInitializer(const ClassDeclNode *cls, int baseInitializer);
+        void lowerModuleInitializer(const BlockNode *program);
+        void finish();
+
+        ValueId lower(const ASTNode *node)
+        {
+            uint32_t saved = line;
+            line = static_cast<uint32_t>(node->line);
+            ValueId value = visit(node);
+            line = saved;
+            return value;
+        }
+
+        ValueId visitBlock(const BlockNode *node);
+        ValueId visitLiteral(const LiteralNode *node);
+        ValueId visitIdentifier(const IdentifierNode *node);
+        ValueId visitBinaryExpr(const BinaryExprNode *node);
+        ValueId visitFunctionDecl(const FunctionDeclNode *node);
+        ValueId visitReturnExpr(const ReturnExprNode *node);
+        ValueId visitVarDecl(const VarDeclNode *node);
+        ValueId visitIfExpr(const IfExprNode *node);
+        ValueId visitForExpr(const ForExprNode *node);
+        ValueId visitMatchExpr(const MatchExprNode *node);
+        ValueId visitAssignExpr(const AssignExprNode *node);
+        ValueId visitClassDecl(const ClassDeclNode *node);
+        ValueId visitCallExpr(const CallExprNode *node);
+        ValueId visitSharedExpr(const SharedExprNode *node);
+        ValueId visitUnknown(const ASTNode *node);
+
+    private:
+        ModuleLowering &module;
+        Function &fn;
+        BlockId current;
+        uint32_t line = 0;
+        ValueId self = NoValue; /**< Receiver of an instance method or class initializer */
+
+        std::unordered_map<const Symbol *, uint32_t> variables;
+        std::vector<ValueType> variableTypes;
+        std::unordered_map<uint64_t, ValueId> defs; /**< block << 32 | variable */
+        std::vector<bool> sealed;
+        std::vector<std::vector<std::pair<uint32_t, ValueId>>> incompletePhis;
+        std::vector<ValueId> forward; /**< Removed phi -> value replacing it */
+        struct SharedReads
+        {
+            std::vector<const Symbol *> locals; /**< Local variables the subtree reads, once each */
+            bool memory = false;                /**< Whether it reads fields or globals */
+        };
+        struct SharedValue
+        {
+            ValueId value;
+            bool readsMemory;
+            uint32_t memoryGeneration; /**< Memory writes seen when the value was computed */
+        };
+        /** Canonical node of a hash-consed subtree -> what it reads, worked out once */
+        std::unordered_map<const ASTNode *, SharedReads> sharedReads;
+        /** Canonical node -> its value in sharedBlock, until a write it depends on */
+        std::unordered_map<const ASTNode *, SharedValue> sharedValues;
+        /** Local variable -> canonical nodes in sharedValues that read it */
+        std::unordered_map<const Symbol *, std::vector<const ASTNode *>> sharedReaders;
+        BlockId sharedBlock = NoBlock;
+        uint32_t memoryGeneration = 0;
+
+        void addReads(const ASTNode *operand, SharedReads &reads)
+        {
+            if (operand->type == ASTNodeType::SharedExpr)
+            {
+                const SharedReads &inner = readsOf(static_cast<const SharedExprNode *>(operand)->target.get());
+                for (const Symbol *symbol : inner.locals)
+                    if (std::find(reads.locals.begin(), reads.locals.end(), symbol) == reads.locals.end())
+                        reads.locals.push_back(symbol);
+                reads.memory |= inner.memory;
+            }
+            else if (operand->type == ASTNodeType::Identifier)
+            {
+                const Symbol *symbol = static_cast<const IdentifierNode *>(operand)->symbol;
+                if (!isLocal(symbol))
+                    reads.memory = true;
+                else if (std::find(reads.locals.begin(), reads.locals.end(), symbol) == reads.locals.end())
+                    reads.locals.push_back(symbol);
+            }
+        }
+
+        // Operands of a canonical node are leaves or shared nodes, so its
+        // reads follow from theirs. Canonical nodes linked through their left
+        // operands are worked out innermost first by the loop.
+        const SharedReads &readsOf(const ASTNode *canonical)
+        {
+            std::vector<const BinaryExprNode *> pending;
+            for (const ASTNode *node = canonical; !sharedReads.count(node);)
+            {
+                pending.push_back(static_cast<const BinaryExprNode *>(node));
+                const ASTNode *left = pending.back()->left.get();
+                if (left->type != ASTNodeType::SharedExpr)
+                    break;
+                node = static_cast<const SharedExprNode *>(left)->target.get();
+            }
+            for (auto it = pending.rbegin(); it != pending.rend(); ++it)
+            {
+                SharedReads reads;
+                addReads((*it)->left.get(), reads);
+                addReads((*it)->right.get(), reads);
+                sharedReads.emplace(*it, std::move(reads));
+            }
+            return sharedReads.at(canonical);
+        }
+
+        /**
+         * @brief Forgets shared values that read `symbol`, or memory when it
+         * is null. Values are indexed by the locals they read, and memory
+         * writes bump a generation, so neither scans the other values.
+         */
+        void invalidateShared(const Symbol *symbol)
+        {
+            if (!symbol)
+            {
+                ++memoryGeneration;
+                return;
+            }
+            auto it = sharedReaders.find(symbol);
+            if (it == sharedReaders.end())
+                return;
+            for (const ASTNode *canonical : it->second)
+                sharedValues.erase(canonical);
+            sharedReaders.erase(it);
+        }
+
+        ValueId emit(Opcode op, ValueType type, std::initializer_list<ValueId> ops = {}, int64_t imm = 0)
+        {
+            return fn.emit(current, op, type, ops, imm, line);
+        }
+        ValueId emit(Opcode op, ValueType type, const std::vector<ValueId> &ops, int64_t imm)
+        {
+            return fn.emit(current, op, type, ops.data(), ops.size(), imm, line);
+        }
+
+        BlockId newBlock()
+        {
+            sealed.push_back(false);
+            incompletePhis.emplace_back();
+            return fn.addBlock();
+        }
+
+        void jump(BlockId to)
+        {
+            emit(Opcode::Jump, ValueType::Void, {}, to);
+            fn.addEdge(current, to);
+        }
+
+        void branch(ValueId condition, BlockId onTrue, BlockId onFalse)
+        {
+            emit(Opcode::Branch, ValueType::Void, {condition}, static_cast<int64_t>(onTrue | static_cast<uint64_t>(onFalse) << 32));
+            fn.addEdge(current, onTrue);
+            fn.addEdge(current, onFalse);
+        }
+
+        void switchOn(ValueId value, SwitchTable table)
+        {
+            fn.switches.push_back(std::move(table));
+            ValueId term = emit(Opcode::Switch, ValueType::Void, {value}, static_cast<int64_t>(fn.switches.size() - 1));
+            for (BlockId succ : successors(fn, term))
+                fn.addEdge(current, succ);
+        }
+
+        ValueId lowerBinary(const BinaryExprNode *node, ValueId lhs);
+        ValueId lowerCall(const CallExprNode *node, ValueId receiver);
+        ValueId findShared(const SharedExprNode *node) const;
+        ValueId rememberShared(const SharedExprNode *node, ValueId value);
+        void compareChain(ValueId subject, ValueType type, const MatchCase *first, const MatchCase *last, BlockId otherwise);
+        void dispatchIntegers(ValueId subject, ValueType type, const MatchCase *first, const MatchCase *last, BlockId otherwise);
+        void dispatchStrings(ValueId subject, const std::vector<MatchCase> &cases, BlockId otherwise);
+
+        ValueId zero(ValueType type);
+        ValueId store(const Symbol *symbol, ValueId value, const ASTNode *at);
+
+        uint32_t variable(const Symbol *symbol)
+        {
+            auto [it, inserted] = variables.emplace(symbol, static_cast<uint32_t>(variableTypes.size()));
+            if (inserted)
+                variableTypes.push_back(valueType(symbol->typeInfo));
+            return it->second;
+        }
+
+        static uint64_t key(BlockId block, uint32_t var) { return static_cast<uint64_t>(block) << 32 | var; }
+
+        ValueId resolve(ValueId value) const
+        {
+            while (value < forward.size() && forward[value] != NoValue)
+                value = forward[value];
+            return value;
+        }
+
+        void writeVariable(uint32_t var, BlockId block, ValueId value) { defs[key(block, var)] = value; }
+
+        ValueId readVariable(uint32_t var, BlockId block)
+        {
+            auto it = defs.find(key(block, var));
+            if (it != defs.end())
+                return resolve(it->second);
+            return readVariableRecursive(var, block);
+        }
+
+        ValueId readVariableRecursive(uint32_t var, BlockId block)
+        {
+            ValueType type = variableTypes[var];
+            const auto &preds = fn.blocks[block].preds;
+            ValueId value;
+            if (!sealed[block])
+            {
+                value = fn.emitFront(block, Opcode::Phi, type);
+                incompletePhis[block].push_back({var, value});
+            }
+            else if (preds.size() == 1)
+                value = readVariable(var, preds[0]);
+            else if (preds.empty())
+                value = fn.emitFront(block, Opcode::Undef, type);
+            else
+            {
+                // Break cycles through loops by defining the phi first.
+                value = fn.emitFront(block, Opcode::Phi, type);
+                writeVariable(var, block, value);
+                value = addPhiOperands(var, value);
+            }
+            writeVariable(var, block, value);
+            return value;
+        }
+
+        ValueId addPhiOperands(uint32_t var, ValueId phi)
+        {
+            BlockId block = fn.instrs[phi].block;
+            std::vector<ValueId> ops;
+            for (BlockId pred : fn.blocks[block].preds)
+            {
+                ops.push_back(readVariable(var, pred));
+                ops.push_back(pred);
+            }
+            fn.setOperands(phi, ops.data(), ops.size());
+            return tryRemoveTrivialPhi(phi);
+        }
+
+        ValueId tryRemoveTrivialPhi(ValueId phi)
+        {
+            ValueId same = NoValue;
+            const Instr &instr = fn.instrs[phi];
+            for (uint16_t i = 0; i < instr.count; i += 2)
+            {
+                ValueId op = resolve(fn.operand(phi, i));
+                if (op == same || op == phi)
+                    continue;
+                if (same != NoValue)
+                    return phi;
+                same = op;
+            }
+
+            BlockId block = instr.block;
+            if (same == NoValue)
+                same = fn.emitFront(block, Opcode::Undef, instr.type);
+
+            // Phis using this one may become trivial too; removeTrivialPhis
+            // catches those once the function is complete.
+            auto &code = fn.blocks[block].code;
+            code.erase(std::find(code.begin(), code.end(), phi));
+            fn.instrs[phi].op = Opcode::Nop;
+            if (forward.size() <= phi)
+                forward.resize(phi + 1, NoValue);
+            forward[phi] = same;
+            return same;
+        }
+
+        void seal(BlockId block)
+        {
+            for (size_t i = 0; i < incompletePhis[block].size(); ++i)
+            {
+                auto [var, phi] = incompletePhis[block][i];
+                addPhiOperands(var, phi);
+            }
+            incompletePhis[block].clear();
+            sealed[block] = true;
+        }
+    };
+
+    class ModuleLowering
+    {
+    public:
+        Module module;
+        const ClassHierarchy &hierarchy;
+        const LayoutEngine &layouts;
+        const std::string &source;
+
+        std::unordered_map<const Symbol *, uint32_t> functionIndex, globalIndex, classIndex;
+        std::unordered_map<const ClassDeclNode *, uint32_t> classInitializer;
+
+        ModuleLowering(const ClassHierarchy &hierarchy, const LayoutEngine &layouts, const std::string &source)
+            : hierarchy(hierarchy), layouts(layouts), source(source)
+        {
+            module.strings.push_back("");
+        }
+
+        void run(const ASTNode *root)
+        {
+            if (!root || root->type != ASTNodeType::Block)
+                return;
+            const auto *program = static_cast<const BlockNode *>(root);
+
+            module.initializer = addFunction("<init>");
+            collect(program, nullptr, "");
+            linkClasses();
+
+            // Every Function is allocated, so references into the vector stay valid.
+            {
+                FunctionLowering lowering(*this, module.functions[module.initializer]);
+                lowering.lowerModuleInitializer(program);
+                lowering.finish();
+            }
+            for (auto &[decl, owner] : functionDecls)
+            {
+                Function &fn = module.functions[functionIndex.at(decl->symbol)];
+                FunctionLowering lowering(*this, fn);
+                lowering.lowerFunction(decl, owner && !decl->symbol->isStatic);
+                lowering.finish();
+            }
+            for (const ClassDeclNode *cls : classDecls)
+            {
+                const Symbol *base = cls->symbol->baseClass;
+                FunctionLowering lowering(*this, module.functions[classInitializer.at(cls)]);
+                lowering.lowerClassInitializer(cls, base ? static_cast<int>(classInitializer.at(static_cast<const ClassDeclNode *>(base->decl))) : -1);
+                lowering.finish();
+            }
+        }
+
+        uint32_t internString(const std::string &literal)
+        {
+            std::string value = unquote(literal);
+            auto [it, inserted] = strings.emplace(value, static_cast<uint32_t>(module.strings.size()));
+            if (inserted)
+                module.strings.push_back(std::move(value));
+            return it->second;
+        }
+
+        /** @brief Encodes a literal like the imm of a Const of the given type */
+        int64_t encode(const LiteralNode *literal, ValueType type)
+        {
+            return std::visit([&](const auto &value) -> int64_t
+                              {
+                                  using T = std::decay_t<decltype(value)>;
+                                  if constexpr (std::is_same_v<T, std::string>)
+                                      return internString(value);
+                                  else if constexpr (std::is_same_v<T, char>)
+                                      return static_cast<unsigned char>(value);
+                                  else
+                                  {
+                                      if (isFloatValue(type))
+                                          return doubleBits(static_cast<double>(value));
+                                      return static_cast<int64_t>(value);
+                                  } },
+                              literal->value);
+        }
+
+        uint32_t fieldOffset(const Symbol *field) const
+        {
+            return static_cast<uint32_t>(layouts.fieldOffset(static_cast<const VarDeclNode *>(field->decl)));
+        }
+
+    private:
+        std::vector<std::pair<const FunctionDeclNode *, const ClassDeclNode *>> functionDecls;
+        std::vector<const ClassDeclNode *> classDecls;
+        std::unordered_map<std::string, uint32_t> strings;
+        std::unordered_map<std::string, unsigned> names;
+
+        uint32_t addFunction(std::string name)
+        {
+            // Overloads share a source name; keep IR names unique.
+            unsigned &seen = names[name];
+            if (seen++)
+                name += "." + std::to_string(seen - 1);
+            module.functions.emplace_back();
+            module.functions.back().name = std::move(name);
+            return static_cast<uint32_t>(module.functions.size() - 1);
+        }
+
+        void collect(const BlockNode *body, const ClassDeclNode *owner, const std::string &prefix)
+        {
+            for (const auto &child : body->children)
+            {
+                switch (child->type)
+                {
+                case ASTNodeType::FunctionDecl:
+                {
+                    const auto *decl = static_cast<const FunctionDeclNode *>(child.get());
+                    uint32_t index = addFunction(prefix + decl->name);
+                    Function &fn = module.functions[index];
+                    fn.decl = decl;
+                    fn.symbol = decl->symbol;
+                    fn.returnType = valueType(decl->returnType);
+                    if (decl->hasAttribute("inline"))
+                        fn.inlining = InlineHint::Always;
+                    else if (decl->hasAttribute("noinline"))
+                        fn.inlining = InlineHint::Never;
+                    fn.exported = decl->hasAttribute("export");
+                    if (owner && !decl->symbol->isStatic)
+                        fn.params.push_back(ValueType::Ptr);
+                    for (const auto &param : decl->params)
+                        fn.params.push_back(valueType(param.first));
+                    if (owner)
+                    {
+                        fn.classIndex = static_cast<int>(classIndex.at(owner->symbol));
+                        fn.vtableSlot = hierarchy.slot(decl->symbol);
+                    }
+                    else if (decl->name == "main" && module.entry < 0)
+                        module.entry = static_cast<int>(index);
+                    functionIndex[decl->symbol] = index;
+                    functionDecls.push_back({decl, owner});
+                    break;
+                }
+                case ASTNodeType::ClassDecl:
+                {
+                    const auto *cls = static_cast<const ClassDeclNode *>(child.get());
+                    std::string name = prefix + cls->name;
+                    const TypeLayout *layout = layouts.find(cls);
+
+                    classIndex[cls->symbol] = static_cast<uint32_t>(module.classes.size());
+                    module.classes.emplace_back();
+                    IRClass &ir = module.classes.back();
+                    ir.name = name;
+                    if (layout)
+                    {
+                        ir.size = layout->size;
+                        ir.hasVptr = layout->hasVptr;
+                        ir.vptrOffset = layout->vptrOffset;
+                        for (const auto &field : layout->fields)
+                            ir.fields.push_back({field.decl->name, valueType(field.decl->symbol->typeInfo), field.offset});
+                    }
+
+                    uint32_t init = addFunction(name + ".<init>");
+                    module.functions[init].params.push_back(ValueType::Ptr);
+                    module.functions[init].classIndex = static_cast<int>(classIndex[cls->symbol]);
+                    module.classes[classIndex[cls->symbol]].initializer = init;
+                    classInitializer[cls] = init;
+                    classDecls.push_back(cls);
+
+                    collect(static_cast<const BlockNode *>(cls->body.get()), cls, name + ".");
+                    break;
+                }
+                case ASTNodeType::VarDecl:
+                {
+                    const auto *decl = static_cast<const VarDeclNode *>(child.get());
+                    if (owner && !decl->symbol->isStatic)
+                        break;
+
+                    Global global;
+                    global.name = prefix + decl->name;
+                    global.type = valueType(decl->symbol->typeInfo);
+                    global.symbol = decl->symbol;
+                    global.constant = decl->isConst;
+                    if (decl->value && decl->value->type == ASTNodeType::Literal)
+                        global.init = encode(static_cast<const LiteralNode *>(decl->value.get()), global.type);
+                    globalIndex[decl->symbol] = static_cast<uint32_t>(module.globals.size());
+                    module.globals.push_back(std::move(global));
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+        }
+
+        void linkClasses()
+        {
+            for (const ClassDeclNode *cls : classDecls)
+            {
+                IRClass &ir = module.classes[classIndex.at(cls->symbol)];
+                if (cls->symbol->baseClass)
+                    ir.base = static_cast<int>(classIndex.at(cls->symbol->baseClass));
+                if (hierarchy.hasVtable(cls->symbol))
+                    for (const Symbol *method : hierarchy.vtable(cls->symbol))
+                        ir.vtable.push_back(functionIndex.at(method));
+            }
+        }
+    };
+
+    void FunctionLowering::lowerFunction(const FunctionDeclNode *decl, bool instance)
+    {
+        line = static_cast<uint32_t>(decl->line);
+        int64_t index = 0;
+        if (instance)
+            self = emit(Opcode::Param, ValueType::Ptr, {}, index++);
+        for (const Symbol *param : decl->paramSymbols)
+        {
+            uint32_t var = variable(param);
+            writeVariable(var, current, emit(Opcode::Param, variableTypes[var], {}, index++));
+        }
+
+        lower(decl->body.get());
+
+        if (!fn.isTerminated(current))
+        {
+            // Falling off the end of a non-void function yields no particular value.
+            if (fn.returnType == ValueType::Void)
+                emit(Opcode::Return, ValueType::Void);
+            else
+                emit(Opcode::Return, ValueType::Void, {emit(Opcode::Undef, fn.returnType)});
+        }
+    }
+
+    void FunctionLowering::lowerClassInitializer(const ClassDeclNode *cls, int baseInitializer)
+    {
+        line = static_cast<uint32_t>(cls->line);
+        self = emit(Opcode::Param, ValueType::Ptr);
+        if (baseInitializer >= 0)
+            emit(Opcode::Call, ValueType::Void, {self}, baseInitializer);
+
+        // Instances start zeroed, so only fields with an initializer are stored.
+        for (const auto &child : static_cast<const BlockNode *>(cls->body.get())->children)
+        {
+            if (child->type != ASTNodeType::VarDecl)
+                continue;
+            const auto *field = static_cast<const VarDeclNode *>(child.get());
+            if (field->symbol->isStatic || !field->value)
+                continue;
+            store(field->symbol, lower(field->value.get()), field);
+        }
+        emit(Opcode::Return, ValueType::Void);
+    }
+
+    void FunctionLowering::lowerModuleInitializer(const BlockNode *program)
+    {
+        // Globals with literal initializers are already in Global::init; the
+        // rest are computed here, in declaration order with the statements.
+        for (const auto &child : program->children)
+        {
+            switch (child->type)
+            {
+            case ASTNodeType::FunctionDecl:
+                break;
+            case ASTNodeType::ClassDecl:
+            {
+                // Static fields of the class and its nested classes.
+                std::vector<const ClassDeclNode *> pending{static_cast<const ClassDeclNode *>(child.get())};
+                while (!pending.empty())
+                {
+                    const ClassDeclNode *cls = pending.back();
+                    pending.pop_back();
+                    for (const auto &member : static_cast<const BlockNode *>(cls->body.get())->children)
+                    {
+                        if (member->type == ASTNodeType::ClassDecl)
+                            pending.push_back(static_cast<const ClassDeclNode *>(member.get()));
+                        else if (member->type == ASTNodeType::VarDecl)
+                        {
+                            const auto *field = static_cast<const VarDeclNode *>(member.get());
+                            if (field->symbol->isStatic && field->value && field->value->type != ASTNodeType::Literal)
+                                store(field->symbol, lower(field->value.get()), field);
+                        }
+                    }
+                }
+                break;
+            }
+            case ASTNodeType::VarDecl:
+            {
+                const auto *decl = static_cast<const VarDeclNode *>(child.get());
+                if (decl->value && decl->value->type != ASTNodeType::Literal)
+                    store(decl->symbol, lower(decl->value.get()), decl);
+                break;
+            }
+            default:
+                lower(child.get());
+                break;
+            }
+        }
+        if (!fn.isTerminated(current))
+            emit(Opcode::Return, ValueType::Void);
+    }
+
+    void FunctionLowering::finish()
+    {
+        // Uses of phis removed while building still name them.
+        if (!forward.empty())
+            for (auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                {
+                    ValueId *ops = fn.operands(v);
+                    size_t step = fn.instrs[v].op == Opcode::Phi ? 2 : 1;
+                    for (size_t i = 0; i < fn.instrs[v].count; i += step)
+                        ops[i] = resolve(ops[i]);
+                }
+
+        removeUnreachableBlocks(fn);
+        removeTrivialPhis(fn);
+    }
+
+    ValueId FunctionLowering::zero(ValueType type)
+    {
+        // String index 0 is the empty string.
+        return emit(Opcode::Const, type);
+    }
+
+    ValueId FunctionLowering::store(const Symbol *symbol, ValueId value, const ASTNode *at)
+    {
+        invalidateShared(isLocal(symbol) ? symbol : nullptr);
+        if (isLocal(symbol))
+            writeVariable(variable(symbol), current, value);
+        else if (isInstanceField(symbol))
+        {
+            if (self == NoValue)
+            {
+                const std::string &name = static_cast<const VarDeclNode *>(symbol->decl)->name;
+                error("Instance field '" + name + "' used without an instance", at, name, module.source);
+            }
+            emit(Opcode::StoreField, ValueType::Void, {self, value}, module.fieldOffset(symbol));
+        }
+        else
+            emit(Opcode::StoreGlobal, ValueType::Void, {value}, module.globalIndex.at(symbol));
+        return value;
+    }
+
+    ValueId FunctionLowering::visitBlock(const BlockNode *node)
+    {
+        for (const auto &child : node->children)
+            lower(child.get());
+        return NoValue;
+    }
+
+    ValueId FunctionLowering::visitLiteral(const LiteralNode *node)
+    {
+        ValueType type = valueType(node->resolvedType);
+        return emit(Opcode::Const, type, {}, module.encode(node, type));
+    }
+
+    ValueId FunctionLowering::visitIdentifier(const IdentifierNode *node)
+    {
+        const Symbol *symbol = node->symbol;
+        if (isLocal(symbol))
+            return readVariable(variable(symbol), current);
+        if (isInstanceField(symbol))
+        {
+            if (self == NoValue)
+                error("Instance field '" + node->name + "' used without an instance", node, node->name, module.source);
+            return emit(Opcode::LoadField, valueType(symbol->typeInfo), {self}, module.fieldOffset(symbol));
+        }
+        auto global = module.globalIndex.find(symbol);
+        if (global == module.globalIndex.end())
+            error("'" + node->name + "' cannot be used as a value", node, node->name, module.source);
+        return emit(Opcode::LoadGlobal, module.module.globals[global->second].type, {}, global->second);
+    }
+
+    ValueId FunctionLowering::visitBinaryExpr(const BinaryExprNode *node)
+    {
+        // Operator chains lean left and can be as long as the source, so the
+        // spine is lowered with a loop from its innermost operand outwards.
+        // Hash-consing links a chain through shared references, which the
+        // loop follows too unless their value can be reused.
+        std::vector<const ASTNode *> spine;
+        const ASTNode *operand = node;
+        for (;;)
+        {
+            if (operand->type == ASTNodeType::BinaryExpr)
+            {
+                spine.push_back(operand);
+                operand = static_cast<const BinaryExprNode *>(operand)->left.get();
+            }
+            else if (operand->type == ASTNodeType::SharedExpr && findShared(static_cast<const SharedExprNode *>(operand)) == NoValue)
+            {
+                spine.push_back(operand);
+                operand = static_cast<const SharedExprNode *>(operand)->target.get();
+            }
+            else
+                break;
+        }
+
+        ValueId value = lower(operand);
+        uint32_t saved = line;
+        for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+        {
+            line = static_cast<uint32_t>((*it)->line);
+            if ((*it)->type == ASTNodeType::SharedExpr)
+                value = rememberShared(static_cast<const SharedExprNode *>(*it), value);
+            else
+                value = lowerBinary(static_cast<const BinaryExprNode *>(*it), value);
+        }
+        line = saved;
+        return value;
+    }
+
+    ValueId FunctionLowering::lowerBinary(const BinaryExprNode *node, ValueId lhs)
+    {
+        const std::string &op = node->op;
+        if (op == "&&")
+        {
+            ValueId no = emit(Opcode::Const, ValueType::Bool);
+            BlockId from = current;
+            BlockId rhsBlock = newBlock(), join = newBlock();
+            emit(Opcode::Branch, ValueType::Void, {lhs}, static_cast<int64_t>(rhsBlock | static_cast<uint64_t>(join) << 32));
+            fn.addEdge(from, rhsBlock);
+            fn.addEdge(from, join);
+            seal(rhsBlock);
+
+            current = rhsBlock;
+            ValueId rhs = lower(node->right.get());
+            BlockId rhsEnd = current;
+            jump(join);
+            seal(join);
+
+            current = join;
+            ValueId phi = fn.emitFront(join, Opcode::Phi, ValueType::Bool);
+            ValueId ops[] = {no, from, rhs, rhsEnd};
+            fn.setOperands(phi, ops, 4);
+            return phi;
+        }
+
+        static const std::unordered_map<std::string, Opcode> opcodes = {
+            {"+", Opcode::Add}, {"-", Opcode::Sub}, {"*", Opcode::Mul}, {"/", Opcode::Div}, {"%", Opcode::Rem}, {"|", Opcode::Or},
+            {"==", Opcode::Eq}, {"!=", Opcode::Ne}, {"<", Opcode::Lt}, {"<=", Opcode::Le}, {">", Opcode::Gt}, {">=", Opcode::Ge}};
+        auto it = opcodes.find(op);
+        if (it == opcodes.end())
+            error("Operator '" + op + "' cannot be lowered", node, op, module.source);
+
+        ValueId rhs = lower(node->right.get());
+        return emit(it->second, valueType(node->resolvedType), {lhs, rhs});
+    }
+
+    ValueId FunctionLowering::visitFunctionDecl(const FunctionDeclNode *node)
+    {
+        error("Nested function '" + node->name + "' is not supported", node, node->name, module.source);
+    }
+
+    ValueId FunctionLowering::visitClassDecl(const ClassDeclNode *node)
+    {
+        error("Nested class '" + node->name + "' is not supported here", node, node->name, module.source);
+    }
+
+    ValueId FunctionLowering::visitUnknown(const ASTNode *node)
+    {
+        error("Construct cannot be lowered", node, "", module.source);
+    }
+
+    ValueId FunctionLowering::visitReturnExpr(const ReturnExprNode *node)
+    {
+        if (node->expr)
+            emit(Opcode::Return, ValueType::Void, {lower(node->expr.get())});
+        else
+            emit(Opcode::Return, ValueType::Void);
+
+        // Code after a return is unreachable; it is built and then dropped.
+        current = newBlock();
+        seal(current);
+        return NoValue;
+    }
+
+    ValueId FunctionLowering::visitVarDecl(const VarDeclNode *node)
+    {
+        ValueId value = node->value ? lower(node->value.get()) : zero(valueType(node->symbol->typeInfo));
+        store(node->symbol, value, node);
+        return NoValue;
+    }
+
+    ValueId FunctionLowering::visitIfExpr(const IfExprNode *node)
+    {
+        // The arms of an `else if` chain are lowered by this loop, each in
+        // the else block of the one before. Their joins are then closed
+        // innermost first, as recursion would.
+        uint32_t saved = line;
+        std::vector<BlockId> joins;
+        for (;;)
+        {
+            line = static_cast<uint32_t>(node->line);
+            ValueId condition = lower(node->condition.get());
+            BlockId from = current;
+            BlockId thenBlock = newBlock();
+            BlockId elseBlock = node->elseBranch ? newBlock() : NoBlock;
+            BlockId join = newBlock();
+            BlockId falseTarget = node->elseBranch ? elseBlock : join;
+            joins.push_back(join);
+
+            emit(Opcode::Branch, ValueType::Void, {condition}, static_cast<int64_t>(thenBlock | static_cast<uint64_t>(falseTarget) << 32));
+            fn.addEdge(from, thenBlock);
+            fn.addEdge(from, falseTarget);
+            seal(thenBlock);
+
+            current = thenBlock;
+            lower(node->thenBranch.get());
+            if (!fn.isTerminated(current))
+                jump(join);
+
+            if (!node->elseBranch)
+                break;
+            seal(elseBlock);
+            current = elseBlock;
+            if (node->elseBranch->type == ASTNodeType::IfExpr)
+            {
+                node = static_cast<const IfExprNode *>(node->elseBranch.get());
+                continue;
+            }
+            lower(node->elseBranch.get());
+            if (!fn.isTerminated(current))
+                jump(join);
+            break;
+        }
+
+        for (size_t i = joins.size(); i-- > 0;)
+        {
+            // Each outer arm's else branch ends where the inner chain joined.
+            if (i + 1 < joins.size() && !fn.isTerminated(current))
+                jump(joins[i]);
+            seal(joins[i]);
+            current = joins[i];
+        }
+        line = saved;
+        return NoValue;
+    }
+
+    ValueId FunctionLowering::visitForExpr(const ForExprNode *node)
+    {
+        if (node->init)
+            lower(node->init.get());
+
+        // The header stays unsealed until the latch is known, so variables
+        // the loop assigns get their phis there.
+        BlockId header = newBlock();
+        BlockId body = newBlock(), exit = newBlock();
+        jump(header);
+        current = header;
+        if (node->condition)
+        {
+            ValueId condition = lower(node->condition.get());
+            emit(Opcode::Branch, ValueType::Void, {condition}, static_cast<int64_t>(body | static_cast<uint64_t>(exit) << 32));
+            fn.addEdge(current, body);
+            fn.addEdge(current, exit);
+        }
+        else
+            jump(body);
+        seal(body);
+        seal(exit);
+
+        current = body;
+        lower(node->body.get());
+        if (node->step && !fn.isTerminated(current))
+            lower(node->step.get());
+        if (!fn.isTerminated(current))
+            jump(header);
+        seal(header);
+
+        current = exit;
+        return NoValue;
+    }
+
+    ValueId FunctionLowering::visitMatchExpr(const MatchExprNode *node)
+    {
+        ValueId subject = lower(node->subject.get());
+        ValueType type = valueType(node->subject->resolvedType);
+        BlockId join = newBlock();
+        BlockId otherwise = node->otherwise ? newBlock() : join;
+
+        std::vector<BlockId> arms;
+        std::vector<MatchCase> cases;
+        for (const auto &arm : node->arms)
+        {
+            arms.push_back(newBlock());
+            for (const auto &pattern : arm.patterns)
+                cases.push_back({module.encode(static_cast<const LiteralNode *>(pattern.get()), type), arms.back()});
+        }
+
+        if (type == ValueType::Str)
+            dispatchStrings(subject, cases, otherwise);
+        else
+        {
+            std::sort(cases.begin(), cases.end(), [&](const MatchCase &x, const MatchCase &y)
+                      { return isSignedValue(type) ? x.value < y.value : static_cast<uint64_t>(x.value) < static_cast<uint64_t>(y.value); });
+            dispatchIntegers(subject, type, cases.data(), cases.data() + cases.size(), otherwise);
+        }
+
+        // Every arm's predecessors are known once the dispatch is built.
+        for (size_t i = 0; i < arms.size(); ++i)
+        {
+            seal(arms[i]);
+            current = arms[i];
+            lower(node->arms[i].body.get());
+            if (!fn.isTerminated(current))
+                jump(join);
+        }
+        if (node->otherwise)
+        {
+            seal(otherwise);
+            current = otherwise;
+            lower(node->otherwise.get());
+            if (!fn.isTerminated(current))
+                jump(join);
+        }
+
+        seal(join);
+        current = join;
+        return NoValue;
+    }
+
+    void FunctionLowering::compareChain(ValueId subject, ValueType type, const MatchCase *first, const MatchCase *last, BlockId otherwise)
+    {
+        for (const MatchCase *c = first; c != last; ++c)
+        {
+            ValueId equal = emit(Opcode::Eq, ValueType::Bool, {subject, emit(Opcode::Const, type, {}, c->value)});
+            BlockId next = c + 1 == last ? otherwise : newBlock();
+            branch(equal, c->arm, next);
+            if (c + 1 != last)
+            {
+                seal(next);
+                current = next;
+            }
+        }
+    }
+
+    void FunctionLowering::dispatchIntegers(ValueId subject, ValueType type, const MatchCase *first, const MatchCase *last, BlockId otherwise)
+    {
+        size_t count = static_cast<size_t>(last - first);
+        if (count == 0)
+        {
+            jump(otherwise);
+            return;
+        }
+
+        // Cases are sorted, so the span is the distance from the first to the last.
+        uint64_t range = static_cast<uint64_t>(last[-1].value) - static_cast<uint64_t>(first->value);
+        if (count >= MinSwitchCases && range < MaxSwitchRange && range < SwitchDensity * count)
+        {
+            SwitchTable table;
+            table.low = first->value;
+            table.targets.assign(range + 1, otherwise);
+            for (const MatchCase *c = first; c != last; ++c)
+                table.targets[static_cast<uint64_t>(c->value) - static_cast<uint64_t>(first->value)] = c->arm;
+            table.otherwise = otherwise;
+            switchOn(subject, std::move(table));
+            return;
+        }
+        if (count < MinSwitchCases)
+        {
+            compareChain(subject, type, first, last, otherwise);
+            return;
+        }
+
+        // Split at the median; each half may still hold a dense run.
+        const MatchCase *middle = first + count / 2;
+        ValueId below = emit(Opcode::Lt, ValueType::Bool, {subject, emit(Opcode::Const, type, {}, middle->value)});
+        BlockId low = newBlock(), high = newBlock();
+        branch(below, low, high);
+        seal(low);
+        seal(high);
+        current = low;
+        dispatchIntegers(subject, type, first, middle, otherwise);
+        current = high;
+        dispatchIntegers(subject, type, middle, last, otherwise);
+    }
+
+    void FunctionLowering::dispatchStrings(ValueId subject, const std::vector<MatchCase> &cases, BlockId otherwise)
+    {
+        if (cases.size() < MinSwitchCases)
+        {
+            compareChain(subject, ValueType::Str, cases.data(), cases.data() + cases.size(), otherwise);
+            return;
+        }
+
+        // Look for a basis and table size under which no two strings share a
+        // slot, so each slot needs one compare; failing that, take the one
+        // with the shortest chains.
+        const auto &strings = module.module.strings;
+        uint64_t basis = HashBasis, size = cases.size();
+        size_t longest = SIZE_MAX;
+        std::vector<size_t> load;
+        for (uint64_t n = cases.size(); n <= 2 * cases.size() && longest > 1; ++n)
+            for (unsigned seed = 0; seed < HashSeeds && longest > 1; ++seed)
+            {
+                uint64_t candidate = HashBasis + seed * 0x9e3779b97f4a7c15ull;
+                load.assign(n, 0);
+                size_t chain = 0;
+                for (const MatchCase &c : cases)
+                    chain = std::max(chain, ++load[hashString(strings[c.value], candidate) % n]);
+                if (chain < longest)
+                {
+                    longest = chain;
+                    basis = candidate;
+                    size = n;
+                }
+            }
+
+        std::vector<std::vector<MatchCase>> slots(size);
+        for (const MatchCase &c : cases)
+            slots[hashString(strings[c.value], basis) % size].push_back(c);
+
+        ValueId hash = emit(Opcode::Hash, ValueType::U64, {subject}, static_cast<int64_t>(basis));
+        ValueId slot = emit(Opcode::Rem, ValueType::U64, {hash, emit(Opcode::Const, ValueType::U64, {}, static_cast<int64_t>(size))});
+        SwitchTable table;
+        table.otherwise = otherwise;
+        for (const auto &chain : slots)
+            table.targets.push_back(chain.empty() ? otherwise : newBlock());
+        std::vector<BlockId> targets = table.targets;
+        switchOn(slot, std::move(table));
+
+        for (size_t i = 0; i < size; ++i)
+            if (!slots[i].empty())
+            {
+                seal(targets[i]);
+                current = targets[i];
+                compareChain(subject, ValueType::Str, slots[i].data(), slots[i].data() + slots[i].size(), otherwise);
+            }
+    }
+
+    ValueId FunctionLowering::visitAssignExpr(const AssignExprNode *node)
+    {
+        return store(node->symbol, lower(node->value.get()), node);
+    }
+
+    ValueId FunctionLowering::visitCallExpr(const CallExprNode *node)
+    {
+        // A member-call chain is lowered innermost call first by a loop, each
+        // result being the receiver of the next call.
+        std::vector<const CallExprNode *> chain{node};
+        while (chain.back()->receiver && chain.back()->receiver->type == ASTNodeType::FunctionCall)
+            chain.push_back(static_cast<const CallExprNode *>(chain.back()->receiver.get()));
+
+        uint32_t saved = line;
+        ValueId receiver = chain.back()->receiver ? lower(chain.back()->receiver.get()) : self;
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            line = static_cast<uint32_t>((*it)->line);
+            receiver = lowerCall(*it, receiver);
+        }
+        line = saved;
+        return receiver;
+    }
+
+    ValueId FunctionLowering::lowerCall(const CallExprNode *node, ValueId receiver)
+    {
+        const Symbol *callee = node->symbol;
+        if (callee->kind == SymbolKind::Class)
+        {
+            uint32_t cls = module.classIndex.at(callee);
+            ValueId object = emit(Opcode::New, ValueType::Ptr, {}, cls);
+            invalidateShared(nullptr);
+            emit(Opcode::Call, ValueType::Void, {object}, module.module.classes[cls].initializer);
+            return object;
+        }
+
+        std::vector<ValueId> args;
+        if (callee->kind == SymbolKind::Method && !callee->isStatic)
+        {
+            if (receiver == NoValue)
+                error("Method '" + node->name + "' called without an instance", node, node->name, module.source);
+            args.push_back(receiver);
+        }
+        for (const auto &arg : node->args)
+            args.push_back(lower(arg.get()));
+
+        const Function &target = module.module.functions[module.functionIndex.at(callee)];
+        Opcode op = node->dispatch == DispatchKind::Virtual ? Opcode::CallVirtual : Opcode::Call;
+        invalidateShared(nullptr);
+        return emit(op, target.returnType, args, module.functionIndex.at(callee));
+    }
+
+    // Every occurrence of a shared subtree computes the same value until
+    // something it reads is written, so one in the current block is reused.
+    ValueId FunctionLowering::findShared(const SharedExprNode *node) const
+    {
+        if (sharedBlock != current)
+            return NoValue;
+        auto it = sharedValues.find(node->target.get());
+        if (it == sharedValues.end() || (it->second.readsMemory && it->second.memoryGeneration != memoryGeneration))
+            return NoValue;
+        return it->second.value;
+    }
+
+    ValueId FunctionLowering::rememberShared(const SharedExprNode *node, ValueId value)
+    {
+        // Values never outlive their block, so a new block starts afresh.
+        if (sharedBlock != current)
+        {
+            sharedValues.clear();
+            sharedReaders.clear();
+            sharedBlock = current;
+        }
+        const ASTNode *canonical = node->target.get();
+        const SharedReads &reads = readsOf(canonical);
+        sharedValues[canonical] = {value, reads.memory, memoryGeneration};
+        for (const Symbol *symbol : reads.locals)
+            sharedReaders[symbol].push_back(canonical);
+        return value;
+    }
+
+    ValueId FunctionLowering::visitSharedExpr(const SharedExprNode *node)
+    {
+        ValueId value = findShared(node);
+        return value != NoValue ? value : rememberShared(node, visit(node->target.get()));
+    }
+}
+
+Module lowerToIR(const ASTNode *root, const ClassHierarchy &hierarchy, const LayoutEngine &layouts, const std::string &source)
+{
+    ModuleLowering lowering(hierarchy, layouts, source);
+    lowering.run(root);
+    return std::move(lowering.module);
+}
@@ -1,6 +1,14 @@
 #include <iostream>
+#include <sstream>
 #include <token.hxx>
 #include <lsp.hxx>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <typecheck.hxx>
+#include <hierarchy.hxx>
+#include <string.hxx>
+
+extern const std::string *Source;
 
 void LSPServer::runLSP()
 {
@@ -19,6 +27,8 @@ void LSPServer::runLSP()
             handleInitialize(request);
         else if (method == "textDocument/completion")
             handleCompletion(request);
+        else if (method == "textDocument/didOpen" || method == "textDocument/didChange")
+            handleDidChange(request);
         else if (method == "shutdown")
             handleShutDown(request);
         else if (method == "exit")
@@ -77,7 +87,7 @@ void LSPServer::handleInitialize(const json &request)
     response["jsonrpc"] = "2.0";
     response["id"] = request["id"];
     response["result"] = {
-        {"capabilities", {{"completionProvider", {{"resolveProvider", false}}}}}};
+        {"capabilities", {{"completionProvider", {{"resolveProvider", false}}}, {"textDocumentSync", 1}}}};
     sendMessage(response);
 }
 
@@ -88,4 +98,96 @@ void LSPServer::handleShutDown(const json &request)
     response["id"] = request["id"];
     response["result"] = nullptr;
     sendMessage(response);
-}
\ No newline at end of file
+}
+
+void LSPServer::handleDidChange(const json &request)
+{
+    const json &params = request["params"];
+    std::string uri = params["textDocument"].value("uri", "");
+
+    // Documents are synchronised in full, so the last change holds the text.
+    std::string text;
+    if (params.contains("contentChanges") && !params["contentChanges"].empty())
+        text = params["contentChanges"].back().value("text", "");
+    else
+        text = params["textDocument"].value("text", "");
+
+    publishDiagnostics(uri, text);
+}
+
+static json makeRange(size_t line, size_t column, size_t length)
+{
+    // Token columns point just past the token; LSP positions are zero-based.
+    size_t ln = line > 0 ? line - 1 : 0;
+    size_t end = column > 0 ? column - 1 : 0;
+    size_t start = end >= length ? end - length : 0;
+    return {{"start", {{"line", ln}, {"character", start}}},
+            {"end", {{"line", ln}, {"character", end}}}};
+}
+
+namespace
+{
+    // The front end reads the source and reports errors through globals; a
+    // request points them at its own document only while it runs.
+    struct FrontEndState
+    {
+        const std::string *source = Source;
+        std::string file = currentFile;
+        size_t col = column;
+        bool throwing = Error::isThrowing();
+
+        ~FrontEndState()
+        {
+            Source = source;
+            currentFile = file;
+            column = col;
+            Error::setThrowing(throwing);
+        }
+    };
+}
+
+void LSPServer::publishDiagnostics(const std::string &uri, const std::string &text)
+{
+    json diagnostics = json::array();
+
+    FrontEndState saved;
+    Error::setThrowing(true);
+    Source = &text;
+    currentFile = uri;
+    column = 1;
+
+    try
+    {
+        std::istringstream ss(text);
+        yyFlexLexer lexer(&ss);
+        Parser parser(lexer, text);
+        ASTNodePtr ast = parser.parserProgram();
+
+        SymbolTable symbols;
+        resolveNames(ast.get(), symbols, text);
+        TypeInterner types;
+        checkTypes(ast.get(), symbols, types, text);
+        ClassHierarchy hierarchy;
+        hierarchy.build(ast.get(), text);
+    }
+    catch (const CompileError &err)
+    {
+        diagnostics.push_back({{"range", makeRange(err.token.Line, err.token.Column, err.token.Lexeme.size())},
+                               {"severity", 1},
+                               {"source", "vsharp"},
+                               {"message", std::string(toString_Error(err.type)) + ": " + err.message}});
+    }
+    catch (const std::exception &e)
+    {
+        diagnostics.push_back({{"range", makeRange(1, 1, 0)},
+                               {"severity", 1},
+                               {"source", "vsharp"},
+                               {"message", e.what()}});
+    }
+
+    json notification;
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = "textDocument/publishDiagnostics";
+    notification["params"] = {{"uri", uri}, {"diagnostics", diagnostics}};
+    sendMessage(notification);
+}
@@ -38,6 +38,17 @@ int main(int argc, char *argv[])
         std::vector<std::string> flags(args.begin() + 1, args.end());
         compileFile(file, flags);
     };
+    commands["run"] = [](const auto &args)
+    {
+        if (args.empty())
+        {
+            std::cerr << "Error: No file provided." << std::endl;
+            exit(1);
+        }
+        std::string file = args[0];
+        std::vector<std::string> flags(args.begin() + 1, args.end());
+        runFile(file, flags);
+    };
 
     std::string command = argv[1];
     std::vector<std::string> args(argv + 2, argv + argc);
@@ -1,8 +1,40 @@
 #include <stdexcept>
+#include <algorithm>
+#include <charconv>
 #include <parser.hxx>
 #include <string.hxx>
 #include <error.hxx>
 
+namespace
+{
+    // Tracks recursion into nested constructs (parentheses, blocks, classes,
+    // nested ifs) so adversarial input produces a syntax error instead of
+    // exhausting the stack. Flat chains such as `else if` arms, operator
+    // sequences and member calls are parsed by loops and do not take a level;
+    // the passes walk all three with loops too.
+    struct NestingGuard
+    {
+        Parser &parser;
+
+        explicit NestingGuard(Parser &parser) : parser(parser)
+        {
+            if (parser.depth >= Parser::MaxNestingDepth)
+                Error::syntax("Nesting exceeds the limit of " + std::to_string(Parser::MaxNestingDepth) + " levels", parser.current, parser.Source);
+            ++parser.depth;
+        }
+        ~NestingGuard() { --parser.depth; }
+    };
+}
+
+template <typename T, typename... Args>
+static std::unique_ptr<T> makeNode(const Token &at, Args &&...args)
+{
+    auto node = std::make_unique<T>(std::forward<Args>(args)...);
+    node->line = at.Line;
+    node->column = at.Column;
+    return node;
+}
+
 int Parser::precedence(TokenType type) const
 {
     switch (type)
@@ -42,11 +74,32 @@ void Parser::expect(TokenType type)
 
 ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode *parent, bool shouldAdvance)
 {
+    NestingGuard guard(*this);
     ASTNodeList expressions;
     while (current.Type != endcase && current.Type != TokenType::EndOfFile)
     {
         ASTNodePtr node;
 
+        if (current.Type == TokenType::KwTypedef || current.Type == TokenType::KwDefine)
+        {
+            parseAlias();
+            if (current.Type == TokenType::Semicolon)
+                advance();
+            continue;
+        }
+
+        if (current.Type == TokenType::KwEnumeration)
+        {
+            parseEnumeration();
+            continue;
+        }
+
+        if (current.Type == TokenType::LeftBracket)
+        {
+            parseAttributes();
+            continue;
+        }
+
         bool hasAccess = false;
         if (current.Type == TokenType::KwPublic ||
             current.Type == TokenType::KwPrivate)
@@ -67,7 +120,7 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode *parent, bool shouldAdva
         if (hasAccess)
         {
             Token next = peekToken();
-            if (next.Type == TokenType::KwClass)
+            if (next.Type == TokenType::KwClass || next.Type == TokenType::KwStructure)
             {
                 node = parseClassDecl();
             }
@@ -83,7 +136,7 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode *parent, bool shouldAdva
         }
         else if (node.get() == nullptr)
         {
-            if (current.Type == TokenType::KwClass)
+            if (current.Type == TokenType::KwClass || current.Type == TokenType::KwStructure)
             {
                 node = parseClassDecl();
                 node.get()->parent = parent;
@@ -93,6 +146,16 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode *parent, bool shouldAdva
                 node = parseVarDecl(parent);
                 node.get()->parent = parent;
             }
+            else if (current.Type == TokenType::KwStatic ||
+                     current.Type == TokenType::KwVirtual ||
+                     current.Type == TokenType::KwOverride)
+            {
+                Token next = peekToken();
+                if (next.Type == TokenType::KwVar || next.Type == TokenType::KwConst)
+                    node = parseVarDecl(parent);
+                else
+                    node = parseFunction(parent);
+            }
             else
             {
                 Token next = peekToken();
@@ -113,12 +176,19 @@ ASTNodePtr Parser::parseBody(TokenType endcase, ASTNode *parent, bool shouldAdva
                 }
             }
         }
+        if (!pendingAttributes.empty())
+            Error::syntax("Attribute '" + pendingAttributes.front() + "' does not apply to this declaration", attributeToken, Source);
+        if (onTopLevel && parent == nullptr && depth == 1)
+            onTopLevel(node.get());
         expressions.push_back(std::move(node));
 
         if (current.Type == TokenType::Semicolon)
             advance();
     }
 
+    if (!pendingAttributes.empty())
+        Error::syntax("Attribute '" + pendingAttributes.front() + "' is not followed by a declaration", attributeToken, Source);
+
     if (shouldAdvance)
         advance();
     auto block = std::make_unique<BlockNode>();
@@ -138,29 +208,53 @@ ASTNodePtr Parser::parsePrimary()
     {
     case TokenType::KwIf:
         return parseIfExpr();
+    case TokenType::KwFor:
+        return parseForExpr();
+    case TokenType::KwMatch:
+        return parseMatchExpr();
     case TokenType::KwVar:
     case TokenType::KwConst:
         return parseVarDecl();
     case TokenType::KwReturn:
+    {
+        Token keyword = current;
         advance();
-        return std::make_unique<ReturnExprNode>(parseExpression());
+        return makeNode<ReturnExprNode>(keyword, parseExpression());
+    }
     case TokenType::Integer:
     {
-        int64_t value = std::stoi(std::string(current.Lexeme));
+        int64_t value = 0;
+        const std::string &lex = current.Lexeme;
+        if (std::from_chars(lex.data(), lex.data() + lex.size(), value).ec != std::errc())
+            Error::syntax("Integer literal out of range", current, Source);
+        auto node = makeNode<LiteralNode>(current, Type::Int64, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::Int64, value);
+        return node;
     }
     case TokenType::Float:
     {
-        double value = std::stod(std::string(current.Lexeme));
+        double value = 0;
+        try
+        {
+            value = std::stod(current.Lexeme);
+        }
+        catch (const std::out_of_range &)
+        {
+            Error::syntax("Floating-point literal out of range", current, Source);
+        }
+        auto node = makeNode<LiteralNode>(current, Type::Float64, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::Float64, value);
+        return node;
     }
     case TokenType::Unsigned:
     {
-        uint64_t value = std::stoul(std::string(current.Lexeme));
+        uint64_t value = 0;
+        const std::string &lex = current.Lexeme;
+        if (std::from_chars(lex.data(), lex.data() + lex.size() - 1, value).ec != std::errc())
+            Error::syntax("Unsigned integer literal out of range", current, Source);
+        auto node = makeNode<LiteralNode>(current, Type::Uint64, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::Uint64, value);
+        return node;
     }
     case TokenType::Byte:
     {
@@ -195,41 +289,94 @@ ASTNodePtr Parser::parsePrimary()
                 break;
             }
         }
+        auto node = makeNode<LiteralNode>(current, Type::Byte, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::Byte, value);
+        return node;
     }
     case TokenType::String:
     {
         std::string value(current.Lexeme);
+        auto node = makeNode<LiteralNode>(current, Type::String, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::String, value);
+        return node;
     }
     case TokenType::Boolean:
     {
         bool value = (current.Lexeme == "true");
+        auto node = makeNode<LiteralNode>(current, Type::Boolean, value);
         advance();
-        return std::make_unique<LiteralNode>(Type::Boolean, value);
+        return node;
     }
     case TokenType::Identifier:
     {
-        std::string name(current.Lexeme);
+        Token name = current;
         advance();
-        return std::make_unique<IdentifierNode>(name);
+        if (current.Type == TokenType::LeftParen)
+            return parsePostfix(parseCall(name, nullptr));
+        // Enumerators are constants named Enumeration.Member.
+        if (current.Type == TokenType::Dot && nextToken.Type == TokenType::Identifier && aliases.find(name.Lexeme))
+        {
+            advance();
+            const Alias *member = aliases.find(name.Lexeme + "." + current.Lexeme);
+            if (!member || member->kind != AliasKind::Constant)
+                Error::syntax("'" + current.Lexeme + "' is not a member of '" + name.Lexeme + "'", current, Source);
+            auto node = makeNode<LiteralNode>(name, Type::Int32, static_cast<int32_t>(member->value));
+            advance();
+            return node;
+        }
+        return parsePostfix(makeNode<IdentifierNode>(name, name.Lexeme));
     }
     case TokenType::LeftParen:
     {
         advance();
         ASTNodePtr expr = parseExpression();
         expect(TokenType::RightParen);
-        return expr;
+        return parsePostfix(std::move(expr));
     }
     default:
         Error::syntax("Unexpected token in expression", current, Source);
     }
 }
 
+ASTNodePtr Parser::parseCall(const Token &name, ASTNodePtr receiver)
+{
+    expect(TokenType::LeftParen);
+    ASTNodeList args;
+    while (current.Type != TokenType::RightParen)
+    {
+        args.push_back(parseExpression());
+        if (current.Type == TokenType::Comma)
+            advance();
+        else if (current.Type != TokenType::RightParen)
+            Error::syntax("Expected ',' or ')' in argument list", current, Source);
+    }
+    advance();
+
+    return makeNode<CallExprNode>(name, std::string(name.Lexeme), std::move(receiver), std::move(args));
+}
+
+ASTNodePtr Parser::parsePostfix(ASTNodePtr expr)
+{
+    NestingGuard guard(*this);
+    while (current.Type == TokenType::Dot)
+    {
+        // Each member call wraps the previous expression as its receiver.
+        advance();
+        if (current.Type != TokenType::Identifier)
+            Error::syntax("Expected member name after '.'", current, Source);
+        Token name = current;
+        advance();
+        if (current.Type != TokenType::LeftParen)
+            Error::syntax("Only member calls are supported, expected '('", current, Source);
+        expr = parseCall(name, std::move(expr));
+    }
+    return expr;
+}
+
 ASTNodePtr Parser::parseExpression(int minPrec)
 {
+    NestingGuard guard(*this);
+
     if (current.Type == TokenType::Identifier)
     {
         Token ident = current;
@@ -240,7 +387,8 @@ ASTNodePtr Parser::parseExpression(int minPrec)
             advance();
             advance();
             ASTNodePtr value = parseExpression();
-            return std::make_unique<AssignExprNode>(
+            return makeNode<AssignExprNode>(
+                ident,
                 std::string(ident.Lexeme),
                 std::move(value));
         }
@@ -258,7 +406,7 @@ ASTNodePtr Parser::parseExpression(int minPrec)
         advance();
         ASTNodePtr right = parseExpression(prec + 1);
 
-        left = std::make_unique<BinaryExprNode>(std::string(op.Lexeme), std::move(left), std::move(right));
+        left = makeNode<BinaryExprNode>(op, std::string(op.Lexeme), std::move(left), std::move(right));
     }
 
     return left;
@@ -266,6 +414,11 @@ ASTNodePtr Parser::parseExpression(int minPrec)
 
 ASTNodePtr Parser::parseFunction(ASTNode *parent)
 {
+    // Taken before the body, whose statements may carry attributes of their own.
+    std::vector<std::string> attributes = takeAttributes({"inline", "noinline", "export"});
+    if (std::find(attributes.begin(), attributes.end(), "inline") != attributes.end() &&
+        std::find(attributes.begin(), attributes.end(), "noinline") != attributes.end())
+        Error::syntax("Attributes 'inline' and 'noinline' conflict", attributeToken, Source);
 
     AccessType access = parseAccessModifier();
     if (access == AccessType::Default && parent != nullptr)
@@ -281,6 +434,7 @@ ASTNodePtr Parser::parseFunction(ASTNode *parent)
 
     if (current.Type != TokenType::Identifier)
         throw std::runtime_error("Expected function name at line " + std::to_string(current.Line));
+    Token nameToken = current;
     std::string name(current.Lexeme);
     advance();
 
@@ -333,18 +487,10 @@ ASTNodePtr Parser::parseFunction(ASTNode *parent)
 
     ASTNodePtr body = std::make_unique<BlockNode>();
     if (current.Type == TokenType::LeftBrace)
-    {
-        advance();
-        ASTNodeList expressions;
-        while (current.Type != TokenType::RightBrace && current.Type != TokenType::EndOfFile)
-        {
-            expressions.push_back(parseExpression());
-        }
-        expect(TokenType::RightBrace);
-        static_cast<BlockNode *>(body.get())->children = std::move(expressions);
-    }
+        body = parseBlock();
 
-    auto node = std::make_unique<FunctionDeclNode>(modifier, name, params, retType, std::move(body), access);
+    auto node = makeNode<FunctionDeclNode>(nameToken, modifier, name, params, retType, std::move(body), access);
+    node->attributes = std::move(attributes);
     node.get()->parent = parent;
     return node;
 }
@@ -395,11 +541,90 @@ Type Parser::parseType()
     case TokenType::KwVoid:
         advance();
         return Type::Void;
+    case TokenType::Identifier:
+        if (const Alias *alias = aliases.find(current.Lexeme); alias && alias->kind == AliasKind::Type)
+        {
+            advance();
+            return alias->type;
+        }
+        [[fallthrough]];
     default:
         throw std::runtime_error("Expected type at line " + std::to_string(current.Line));
     }
 }
 
+void Parser::parseAlias()
+{
+    bool isTypedef = current.Type == TokenType::KwTypedef;
+    advance();
+
+    Alias alias{AliasKind::Type, Type::Void, TokenType::Identifier};
+    if (isTypedef)
+        alias.type = parseType();
+    else
+    {
+        if (current.Type < TokenType::KwPublic || current.Type >= TokenType::EndOfFile)
+            Error::syntax("Expected a keyword after 'define'", current, Source);
+        alias.kind = AliasKind::Keyword;
+        alias.keyword = current.Type;
+        advance();
+    }
+
+    if (current.Type != TokenType::Identifier)
+        Error::syntax("Expected alias name", current, Source);
+    if (!aliases.define(current.Lexeme, alias))
+        Error::syntax("Alias '" + current.Lexeme + "' is already defined", current, Source);
+
+    // The lookahead was lexed before the alias existed.
+    applyAlias(nextToken);
+    advance();
+}
+
+void Parser::parseEnumeration()
+{
+    expect(TokenType::KwEnumeration);
+    if (current.Type != TokenType::Identifier)
+        Error::syntax("Expected enumeration name", current, Source);
+    std::string name = current.Lexeme;
+    if (!aliases.define(name, Alias{AliasKind::Type, Type::Int32, TokenType::Identifier}))
+        Error::syntax("Alias '" + name + "' is already defined", current, Source);
+    advance();
+    expect(TokenType::LeftBrace);
+
+    // Members count up from zero, or from the last explicit value.
+    int64_t value = 0;
+    while (current.Type != TokenType::RightBrace)
+    {
+        if (current.Type != TokenType::Identifier)
+            Error::syntax("Expected enumerator name", current, Source);
+        Token member = current;
+        advance();
+        if (current.Type == TokenType::Assign)
+        {
+            advance();
+            bool negative = current.Type == TokenType::Minus;
+            if (negative)
+                advance();
+            if (current.Type != TokenType::Integer ||
+                std::from_chars(current.Lexeme.data(), current.Lexeme.data() + current.Lexeme.size(), value).ec != std::errc())
+                Error::syntax("Expected an integer enumerator value", current, Source);
+            value = negative ? -value : value;
+            advance();
+        }
+        if (value < INT32_MIN || value > INT32_MAX)
+            Error::syntax("Enumerator '" + member.Lexeme + "' does not fit in int32", member, Source);
+        if (!aliases.define(name + "." + member.Lexeme, Alias{AliasKind::Constant, Type::Int32, TokenType::Identifier, value}))
+            Error::syntax("Enumerator '" + member.Lexeme + "' is already defined", member, Source);
+        ++value;
+
+        if (current.Type == TokenType::Comma)
+            advance();
+        else if (current.Type != TokenType::RightBrace)
+            Error::syntax("Expected ',' or '}' in enumeration", current, Source);
+    }
+    advance();
+}
+
 ASTNodePtr Parser::parseVarDecl(ASTNode *parent)
 {
     AccessType access = parseAccessModifier();
@@ -420,6 +645,7 @@ ASTNodePtr Parser::parseVarDecl(ASTNode *parent)
 
     if (current.Type != TokenType::Identifier)
         throw std::runtime_error("Expected variable name at line " + std::to_string(current.Line));
+    Token nameToken = current;
     std::string name(current.Lexeme);
     advance();
 
@@ -433,53 +659,156 @@ ASTNodePtr Parser::parseVarDecl(ASTNode *parent)
         advance();
         value = parseExpression();
     }
-    auto node = std::make_unique<VarDeclNode>(isConst, name, varType, std::move(value), modifier, access);
+    auto node = makeNode<VarDeclNode>(nameToken, isConst, name, varType, std::move(value), modifier, access);
     node.get()->parent = parent;
     return node;
 }
 
-ASTNodePtr Parser::parseIfExpr()
+ASTNodePtr Parser::parseBlock()
 {
-    expect(TokenType::KwIf);
-
-    ASTNodePtr condition = parseExpression();
     expect(TokenType::LeftBrace);
-
-    ASTNodeList thenExpressions;
+    ASTNodeList expressions;
     while (current.Type != TokenType::RightBrace && current.Type != TokenType::EndOfFile)
     {
-        thenExpressions.push_back(parseExpression());
+        expressions.push_back(parseExpression());
     }
     expect(TokenType::RightBrace);
-    ASTNodePtr thenBlock = std::make_unique<BlockNode>();
-    static_cast<BlockNode *>(thenBlock.get())->children = std::move(thenExpressions);
+    auto block = std::make_unique<BlockNode>();
+    block->children = std::move(expressions);
+    return block;
+}
 
-    ASTNodePtr elseBranch = nullptr;
-    if (current.Type == TokenType::KwElse)
+ASTNodePtr Parser::parseIfExpr()
+{
+    NestingGuard guard(*this);
+
+    // `else if` chains are parsed iteratively, each link hanging off the
+    // previous node's else branch.
+    ASTNodePtr root;
+    ASTNodePtr *slot = &root;
+    for (;;)
     {
+        Token keyword = current;
+        expect(TokenType::KwIf);
+
+        ASTNodePtr condition = parseExpression();
+        ASTNodePtr thenBlock = parseBlock();
+
+        auto node = makeNode<IfExprNode>(keyword, std::move(condition), std::move(thenBlock));
+        IfExprNode *ifNode = node.get();
+        *slot = std::move(node);
+
+        if (current.Type != TokenType::KwElse)
+            break;
+
         advance();
         if (current.Type == TokenType::KwIf)
         {
-            elseBranch = parseIfExpr();
+            slot = &ifNode->elseBranch;
         }
         else if (current.Type == TokenType::LeftBrace)
         {
-            advance();
-            ASTNodeList elseExpressions;
-            while (current.Type != TokenType::RightBrace && current.Type != TokenType::EndOfFile)
-            {
-                elseExpressions.push_back(parseExpression());
-            }
-            expect(TokenType::RightBrace);
-            elseBranch = std::make_unique<BlockNode>();
-            static_cast<BlockNode *>(elseBranch.get())->children = std::move(elseExpressions);
+            ifNode->elseBranch = parseBlock();
+            break;
         }
         else
         {
             throw std::runtime_error("Expected '{' or 'if' after 'else' at line " + std::to_string(current.Line));
         }
     }
-    return std::make_unique<IfExprNode>(std::move(condition), std::move(thenBlock), std::move(elseBranch));
+    return root;
+}
+
+ASTNodePtr Parser::parseForExpr()
+{
+    NestingGuard guard(*this);
+
+    Token keyword = current;
+    expect(TokenType::KwFor);
+    expect(TokenType::LeftParen);
+
+    // for (init; condition; step), each part optional.
+    ASTNodePtr init, condition, step;
+    if (current.Type != TokenType::Semicolon)
+        init = parseExpression();
+    expect(TokenType::Semicolon);
+    if (current.Type != TokenType::Semicolon)
+        condition = parseExpression();
+    expect(TokenType::Semicolon);
+    if (current.Type != TokenType::RightParen)
+        step = parseExpression();
+    expect(TokenType::RightParen);
+
+    ASTNodePtr body = parseBlock();
+    return makeNode<ForExprNode>(keyword, std::move(init), std::move(condition), std::move(step), std::move(body));
+}
+
+ASTNodePtr Parser::parseMatchPattern()
+{
+    // Negative integers are the one place a sign is part of a literal.
+    if (current.Type == TokenType::Minus && nextToken.Type == TokenType::Integer)
+    {
+        Token sign = current;
+        advance();
+        auto node = parsePrimary();
+        auto *literal = static_cast<LiteralNode *>(node.get());
+        literal->value = -std::get<int64_t>(literal->value);
+        literal->line = sign.Line;
+        literal->column = sign.Column;
+        return node;
+    }
+    Token start = current;
+    switch (current.Type)
+    {
+    case TokenType::Integer:
+    case TokenType::Unsigned:
+    case TokenType::Byte:
+    case TokenType::String:
+    case TokenType::Identifier:
+        break;
+    default:
+        Error::syntax("Expected a literal or enumerator in match arm", start, Source);
+    }
+    auto node = parsePrimary();
+    if (node->type != ASTNodeType::Literal)
+        Error::syntax("Expected a literal or enumerator in match arm", start, Source);
+    return node;
+}
+
+ASTNodePtr Parser::parseMatchExpr()
+{
+    NestingGuard guard(*this);
+
+    Token keyword = current;
+    expect(TokenType::KwMatch);
+    ASTNodePtr subject = parseExpression();
+    expect(TokenType::LeftBrace);
+
+    // match subject { 1, 2 { ... } 3 { ... } else { ... } }
+    std::vector<MatchArm> arms;
+    ASTNodePtr otherwise;
+    while (current.Type != TokenType::RightBrace)
+    {
+        if (current.Type == TokenType::KwElse)
+        {
+            if (otherwise)
+                Error::syntax("Match has more than one 'else' arm", current, Source);
+            advance();
+            otherwise = parseBlock();
+            continue;
+        }
+        MatchArm arm;
+        arm.patterns.push_back(parseMatchPattern());
+        while (current.Type == TokenType::Comma)
+        {
+            advance();
+            arm.patterns.push_back(parseMatchPattern());
+        }
+        arm.body = parseBlock();
+        arms.push_back(std::move(arm));
+    }
+    advance();
+    return makeNode<MatchExprNode>(keyword, std::move(subject), std::move(arms), std::move(otherwise));
 }
 
 ASTNodePtr Parser::parseClassDecl()
@@ -489,15 +818,32 @@ ASTNodePtr Parser::parseClassDecl()
     {
         access = AccessType::Public;
     }
-    expect(TokenType::KwClass);
+    bool isStructure = current.Type == TokenType::KwStructure;
+    if (isStructure)
+        advance();
+    else
+        expect(TokenType::KwClass);
     if (current.Type != TokenType::Identifier)
     {
         throw std::runtime_error("Expected class name at line " + std::to_string(current.Line));
     }
     std::string name(current.Lexeme);
 
+    auto clazz = makeNode<ClassDeclNode>(current, name, access, nullptr);
+    clazz->isStructure = isStructure;
+    clazz->attributes = takeAttributes({"keep_order"});
     advance();
-    ASTNodePtr clazz = std::make_unique<ClassDeclNode>(name, access, nullptr);
+
+    if (current.Type == TokenType::Colon)
+    {
+        if (isStructure)
+            Error::syntax("Structures cannot inherit", current, Source);
+        advance();
+        if (current.Type != TokenType::Identifier)
+            Error::syntax("Expected base class name", current, Source);
+        clazz->baseName = current.Lexeme;
+        advance();
+    }
 
     ASTNodePtr body = std::make_unique<BlockNode>();
     if (current.Type == TokenType::LeftBrace)
@@ -511,10 +857,43 @@ ASTNodePtr Parser::parseClassDecl()
     {
         throw std::runtime_error("Expected '{' after class name at line " + std::to_string(current.Line));
     }
-    ((ClassDeclNode *)clazz.get())->body = std::move(body);
+    clazz->body = std::move(body);
     return clazz;
 }
 
+void Parser::parseAttributes()
+{
+    static constexpr std::string_view known[] = {"keep_order", "inline", "noinline", "export"};
+
+    attributeToken = current;
+    expect(TokenType::LeftBracket);
+    while (true)
+    {
+        if (current.Type != TokenType::Identifier)
+            Error::syntax("Expected attribute name", current, Source);
+        if (std::find(std::begin(known), std::end(known), current.Lexeme) == std::end(known))
+            Error::syntax("Unknown attribute '" + current.Lexeme + "'", current, Source);
+        pendingAttributes.push_back(current.Lexeme);
+        advance();
+
+        if (current.Type == TokenType::Comma)
+            advance();
+        else
+            break;
+    }
+    expect(TokenType::RightBracket);
+}
+
+std::vector<std::string> Parser::takeAttributes(std::initializer_list<std::string_view> allowed)
+{
+    for (const auto &attribute : pendingAttributes)
+        if (std::find(allowed.begin(), allowed.end(), attribute) == allowed.end())
+            Error::syntax("Attribute '" + attribute + "' does not apply to this declaration", attributeToken, Source);
+    std::vector<std::string> attributes = std::move(pendingAttributes);
+    pendingAttributes.clear();
+    return attributes;
+}
+
 AccessType Parser::parseAccessModifier()
 {
     if (current.Type == TokenType::KwPublic)
@@ -0,0 +1,290 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <escape.hxx>
+#include <gvn.hxx>
+#include <inliner.hxx>
+#include <loops.hxx>
+#include <passmanager.hxx>
+#include <simplify.hxx>
+#include <treeshake.hxx>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    uint64_t nanosSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Peak resident set size of the process in KiB, 0 where unknown.
+    uint64_t peakMemory()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#if defined(__APPLE__)
+        return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    const FunctionPass SimplifyCFG{"simplify-cfg", PreserveNone, [](Function &fn, FunctionAnalyses &)
+                                   { return simplifyCFG(fn); }};
+    const FunctionPass Fold{"fold", PreserveNone, [](Function &fn, FunctionAnalyses &)
+                            { return foldInstructions(fn); }};
+    const FunctionPass DeadCode{"dce", PreserveCFG, [](Function &fn, FunctionAnalyses &)
+                                { return eliminateDeadCode(fn); }};
+    const ModulePass Inline{"inline", [](Module &module, PassContext &context)
+                            { return inlineCalls(module, context.pool, {InlineOptions::SmallThreshold, context.remarks}); }};
+    const ModulePass InlineAggressive{"inline", [](Module &module, PassContext &context)
+                                      { return inlineCalls(module, context.pool, {InlineOptions::LargeThreshold, context.remarks}); }};
+    void count(std::vector<Statistic> &statistics, const char *pass, const std::string &name, uint64_t value)
+    {
+        for (auto &statistic : statistics)
+            if (strcmp(statistic.pass, pass) == 0 && statistic.name == name)
+            {
+                statistic.value += value;
+                return;
+            }
+        statistics.push_back({pass, name, value});
+    }
+
+    const ModulePass TreeShake{"tree-shake", [](Module &module, PassContext &context)
+                               {
+                                   ShakeResult result = shakeModule(module, context.remarks);
+                                   count(context.statistics, "tree-shake", "functions removed", result.functions);
+                                   count(context.statistics, "tree-shake", "classes removed", result.classes);
+                                   count(context.statistics, "tree-shake", "globals removed", result.globals);
+                                   count(context.statistics, "tree-shake", "strings removed", result.strings);
+                                   return result.changed();
+                               }};
+    // Sites are counted statically; a site in a loop allocates once per iteration.
+    const ModulePass Escape{"escape", [](Module &module, PassContext &context)
+                            {
+                                EscapeResult result = promoteAllocations(module, context.pool, {context.remarks});
+                                count(context.statistics, "escape", "heap allocation sites before", result.sites);
+                                count(context.statistics, "escape", "heap allocation sites after", result.heap());
+                                count(context.statistics, "escape", "instances allocated in the frame", result.stack);
+                                count(context.statistics, "escape", "instances scalar-replaced", result.replaced);
+                                return result.changed();
+                            }};
+    const ModulePass ValueNumbering{"gvn", [](Module &module, PassContext &context)
+                                    { return numberValues(module, context.pool); }};
+    const ModulePass Loops{"loops", [](Module &module, PassContext &context)
+                           { return optimizeLoops(module, context.pool, {false, context.unroll ? context.unroll : 1, context.remarks}); }};
+    const ModulePass LoopsAggressive{"loops", [](Module &module, PassContext &context)
+                                     { return optimizeLoops(module, context.pool, {true, context.unroll ? context.unroll : LoopOptions::DefaultUnroll, context.remarks}); }};
+}
+
+size_t irBytes(const Function &fn)
+{
+    size_t bytes = fn.instrs.capacity() * sizeof(Instr) + fn.operandPool.capacity() * sizeof(ValueId) + fn.blocks.capacity() * sizeof(BasicBlock);
+    for (const auto &block : fn.blocks)
+        bytes += (block.code.capacity() + block.preds.capacity() + block.succs.capacity()) * sizeof(uint32_t);
+    return bytes;
+}
+
+size_t irBytes(const Module &module)
+{
+    size_t bytes = 0;
+    for (const auto &fn : module.functions)
+        bytes += irBytes(fn);
+    return bytes;
+}
+
+void PassManager::add(const FunctionPass &pass)
+{
+    Stage &stage = stages.emplace_back();
+    stage.name = pass.name;
+    stage.function = pass;
+}
+
+void PassManager::add(const ModulePass &pass)
+{
+    Stage &stage = stages.emplace_back();
+    stage.name = pass.name;
+    stage.module = pass;
+}
+
+void PassManager::addPipeline(unsigned level)
+{
+    if (level == 0)
+        return;
+
+    // Declarations the program never uses would go through every pass below.
+    add(TreeShake);
+    add(SimplifyCFG);
+    add(Fold);
+    // The cost model measures callees after their own cleanup.
+    add(DeadCode);
+    add(level >= 2 ? InlineAggressive : Inline);
+    add(SimplifyCFG);
+    add(Fold);
+    // Callees inlined everywhere and calls in folded branches are gone now.
+    add(TreeShake);
+    // Inlining put constructors and methods next to the allocations they use.
+    add(Escape);
+    // Inlined bodies repeat much of what their callers computed already.
+    add(ValueNumbering);
+    // Hoisted and strength-reduced code, the exit values of evaluated loops
+    // and unrolled copies fold further.
+    add(level >= 2 ? LoopsAggressive : Loops);
+    // Collapsing blocks removes phis, which exposes more constants.
+    add(SimplifyCFG);
+    add(Fold);
+    add(DeadCode);
+    add(SimplifyCFG);
+}
+
+void PassManager::run(Module &module)
+{
+    auto start = std::chrono::steady_clock::now();
+    functionCount = module.functions.size();
+
+    auto resetAnalyses = [&]
+    {
+        analyses.clear();
+        analyses.reserve(module.functions.size());
+        for (const auto &fn : module.functions)
+            analyses.emplace_back(fn, timing ? &analysisStats : nullptr);
+    };
+    resetAnalyses();
+    if (verify)
+        pool.parallelFor(module.functions.size(), [&](size_t index)
+                         { check(module.functions[index], analyses[index], "lowering"); });
+
+    for (size_t first = 0; first < stages.size();)
+    {
+        Stage &stage = stages[first];
+        if (stage.module.run)
+        {
+            auto passStart = std::chrono::steady_clock::now();
+            size_t before = timing ? irBytes(module) : 0;
+            PassContext context{pool, statistics, remarks, unroll};
+            bool changed = stage.module.run(module, context);
+            stage.stats.nanos += nanosSince(passStart);
+            if (timing)
+                stage.stats.bytes += static_cast<int64_t>(irBytes(module)) - static_cast<int64_t>(before);
+            stage.stats.runs += 1;
+            if (changed)
+            {
+                stage.stats.changed += 1;
+                resetAnalyses();
+                if (verify)
+                    for (size_t i = 0; i < module.functions.size(); ++i)
+                        check(module.functions[i], analyses[i], stage.name);
+            }
+            ++first;
+            continue;
+        }
+
+        size_t last = first;
+        while (last < stages.size() && !stages[last].module.run)
+            ++last;
+        runGroup(module, first, last);
+        first = last;
+    }
+
+    analyses.clear();
+    wallNanos += nanosSince(start);
+}
+
+void PassManager::runGroup(Module &module, size_t first, size_t last)
+{
+    pool.parallelFor(module.functions.size(), [&](size_t index)
+                     {
+                         Function &fn = module.functions[index];
+                         FunctionAnalyses &cache = analyses[index];
+                         for (size_t s = first; s < last; ++s)
+                         {
+                             Stage &stage = stages[s];
+                             if (!timing)
+                             {
+                                 if (stage.function.run(fn, cache))
+                                 {
+                                     cache.invalidate(stage.function.preserves);
+                                     if (verify)
+                                         check(fn, cache, stage.name);
+                                 }
+                                 continue;
+                             }
+
+                             size_t before = irBytes(fn);
+                             auto start = std::chrono::steady_clock::now();
+                             bool changed = stage.function.run(fn, cache);
+                             if (changed)
+                                 cache.invalidate(stage.function.preserves);
+                             stage.stats.nanos.fetch_add(nanosSince(start), std::memory_order_relaxed);
+                             stage.stats.bytes.fetch_add(static_cast<int64_t>(irBytes(fn)) - static_cast<int64_t>(before), std::memory_order_relaxed);
+                             stage.stats.runs.fetch_add(1, std::memory_order_relaxed);
+                             if (changed)
+                             {
+                                 stage.stats.changed.fetch_add(1, std::memory_order_relaxed);
+                                 if (verify)
+                                     check(fn, cache, stage.name);
+                             }
+                         } });
+}
+
+void PassManager::check(const Function &fn, FunctionAnalyses &cache, const char *after) const
+{
+    std::string message;
+    if (!verifyFunction(fn, cache.dominators(), message))
+        throw std::runtime_error(std::string("IR verification failed after ") + after + ": " + message);
+}
+
+void PassManager::printTiming(FILE *out) const
+{
+    uint64_t total = 0;
+    for (const auto &stage : stages)
+        total += stage.stats.nanos;
+
+    fputs("===-----------------------------------------------------------===\n", out);
+    fputs("                  Pass execution timing report\n", out);
+    fputs("===-----------------------------------------------------------===\n", out);
+    fprintf(out, "  Wall time: %.3f ms, %u threads, %zu functions\n", wallNanos / 1e6, threads(), functionCount);
+    fprintf(out, "  Pass time is summed over threads and includes the analyses a pass requested.\n\n");
+
+    fprintf(out, "  %10s  %6s  %15s  %12s  %s\n", "Time (ms)", "Share", "Changed", "IR delta", "Pass");
+    for (const auto &stage : stages)
+    {
+        uint64_t nanos = stage.stats.nanos;
+        fprintf(out, "  %10.3f  %5.1f%%  %7" PRIu64 "/%-7" PRIu64 "  %+8.1f KiB  %s%s\n",
+                nanos / 1e6, total ? 100.0 * nanos / total : 0.0,
+                stage.stats.changed.load(), stage.stats.runs.load(),
+                stage.stats.bytes / 1024.0, stage.name, stage.module.run ? " (module)" : "");
+    }
+    fprintf(out, "  %10.3f  %5.1f%%  %15s  %12s  %s\n\n", total / 1e6, 100.0, "", "", "Total");
+
+    fprintf(out, "  %10s  %8s  %8s  %s\n", "Time (ms)", "Computed", "Reused", "Analysis");
+    for (size_t i = 0; i < Analysis::Count; ++i)
+        fprintf(out, "  %10.3f  %8" PRIu64 "  %8" PRIu64 "  %s\n", analysisStats.nanos[i] / 1e6,
+                analysisStats.computed[i].load(), analysisStats.reused[i].load(), Analysis::name(i));
+
+    if (uint64_t peak = peakMemory())
+        fprintf(out, "\n  Peak resident memory: %" PRIu64 " KiB\n", peak);
+}
+
+void PassManager::addStatistic(const char *pass, const std::string &name, uint64_t value)
+{
+    count(statistics, pass, name, value);
+}
+
+void PassManager::printStatistics(FILE *out) const
+{
+    fputs("===-----------------------------------------------------------===\n", out);
+    fputs("                      ... Statistics Collected ...\n", out);
+    fputs("===-----------------------------------------------------------===\n\n", out);
+    for (const auto &statistic : statistics)
+        fprintf(out, "%10" PRIu64 " %-12s - %s\n", statistic.value, statistic.pass, statistic.name.c_str());
+}
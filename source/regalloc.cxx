@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <regalloc.hxx>
+
+namespace
+{
+    const Reg CallerSaved[] = {Reg::R10, Reg::R11};
+    const Reg CalleeSaved[] = {Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15};
+    constexpr uint32_t None = UINT32_MAX;
+
+    bool isCallerSaved(uint8_t reg)
+    {
+        return reg == static_cast<uint8_t>(Reg::R10) || reg == static_cast<uint8_t>(Reg::R11);
+    }
+
+    struct Interval
+    {
+        ValueId value;
+        uint32_t start, end; /**< Code positions, both inclusive */
+        uint32_t weight = 0; /**< Definition plus uses */
+        bool crossesCall = false;
+    };
+
+    /**
+     * Live intervals of the values that need a location. Each instruction
+     * has an even position in block order; a block's end is one past its
+     * terminator, where edge copies read phi operands. Liveness is found per
+     * value by walking backwards from its uses to its definition, so the
+     * cost is the size of the live ranges rather than blocks times values.
+     */
+    class LiveRanges
+    {
+    public:
+        std::vector<Interval> intervals;
+        std::vector<uint32_t> intervalOf;                 /**< Per value, None without a location */
+        std::vector<std::pair<uint32_t, ValueId>> calls;  /**< Position and value, in code order */
+        std::vector<std::vector<uint32_t>> liveOut;       /**< Per block, interval indices; only when exact */
+
+        LiveRanges(const Function &fn, bool exact) : fn(fn)
+        {
+            size_t n = fn.instrs.size();
+            position.assign(n, 0);
+            blockOf.assign(n, 0);
+            blockStart.assign(fn.blocks.size(), 0);
+            blockEnd.assign(fn.blocks.size(), 0);
+            uint32_t at = 0;
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                blockStart[b] = at;
+                for (ValueId v : fn.blocks[b].code)
+                {
+                    position[v] = at;
+                    blockOf[v] = b;
+                    if (isNativeCall(fn, v))
+                        calls.push_back({at, v});
+                    at += 2;
+                }
+                blockEnd[b] = at == blockStart[b] ? at : at - 1;
+            }
+
+            // Def-use chains, as (user, operand index) pairs grouped by value.
+            std::vector<uint32_t> count(n + 1, 0);
+            forEachUse([&](ValueId value, ValueId, uint32_t)
+                       { ++count[value + 1]; });
+            for (size_t i = 0; i < n; ++i)
+                count[i + 1] += count[i];
+            useStart = count;
+            users.resize(count[n]);
+            forEachUse([&](ValueId value, ValueId user, uint32_t index)
+                       { users[count[value]++] = {user, index}; });
+
+            intervalOf.assign(n, None);
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                {
+                    const Instr &instr = fn.instrs[v];
+                    if (instr.type == ValueType::Void || instr.op == Opcode::Const || instr.op == Opcode::Undef || useStart[v] == useStart[v + 1])
+                        continue;
+                    intervalOf[v] = static_cast<uint32_t>(intervals.size());
+                    intervals.push_back({v, position[v], position[v], 1 + useStart[v + 1] - useStart[v]});
+                }
+
+            if (exact)
+                liveOut.resize(fn.blocks.size());
+            liveInMark.assign(fn.blocks.size(), None);
+            liveOutMark.assign(fn.blocks.size(), None);
+            for (uint32_t i = 0; i < intervals.size(); ++i)
+                walk(i, exact);
+
+            for (auto &interval : intervals)
+            {
+                auto call = std::upper_bound(calls.begin(), calls.end(), std::make_pair(interval.start, NoValue));
+                interval.crossesCall = call != calls.end() && call->first < interval.end;
+            }
+        }
+
+    private:
+        const Function &fn;
+        std::vector<uint32_t> position, blockStart, blockEnd;
+        std::vector<BlockId> blockOf;
+        std::vector<uint32_t> useStart;
+        std::vector<std::pair<ValueId, uint32_t>> users;
+        std::vector<uint32_t> liveInMark, liveOutMark;
+        std::vector<BlockId> worklist;
+
+        template <typename Visit>
+        void forEachUse(Visit &&visit) const
+        {
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                {
+                    const Instr &instr = fn.instrs[v];
+                    size_t step = instr.op == Opcode::Phi ? 2 : 1;
+                    for (uint32_t i = 0; i < instr.count; i += static_cast<uint32_t>(step))
+                        visit(fn.operand(v, i), v, i);
+                }
+        }
+
+        void walk(uint32_t index, bool exact)
+        {
+            Interval &interval = intervals[index];
+            BlockId home = blockOf[interval.value];
+
+            auto liveOutOf = [&](BlockId block)
+            {
+                interval.end = std::max(interval.end, blockEnd[block]);
+                if (liveOutMark[block] == index)
+                    return;
+                liveOutMark[block] = index;
+                if (exact)
+                    liveOut[block].push_back(index);
+            };
+            auto liveInOf = [&](BlockId block)
+            {
+                if (block == home || liveInMark[block] == index)
+                    return;
+                liveInMark[block] = index;
+                interval.start = std::min(interval.start, blockStart[block]);
+                worklist.push_back(block);
+            };
+
+            for (uint32_t u = useStart[interval.value]; u < useStart[interval.value + 1]; ++u)
+            {
+                auto [user, operand] = users[u];
+                if (fn.instrs[user].op == Opcode::Phi)
+                {
+                    BlockId pred = fn.operand(user, operand + 1);
+                    liveOutOf(pred);
+                    liveInOf(pred);
+                }
+                else
+                {
+                    interval.end = std::max(interval.end, position[user]);
+                    liveInOf(blockOf[user]);
+                }
+            }
+            while (!worklist.empty())
+            {
+                BlockId block = worklist.back();
+                worklist.pop_back();
+                for (BlockId pred : fn.blocks[block].preds)
+                {
+                    liveOutOf(pred);
+                    liveInOf(pred);
+                }
+            }
+        }
+    };
+
+    // Picks a free register, preferring one calls preserve for values live
+    // across them and one they clobber otherwise, which costs no save in the
+    // prologue.
+    uint8_t pickRegister(bool crossesCall, uint16_t taken)
+    {
+        auto first = [&](const Reg *regs, size_t count) -> uint8_t
+        {
+            for (size_t i = 0; i < count; ++i)
+                if (!(taken >> static_cast<unsigned>(regs[i]) & 1))
+                    return static_cast<uint8_t>(regs[i]);
+            return RegisterAssignment::Spilled;
+        };
+        uint8_t preferred = crossesCall ? first(CalleeSaved, std::size(CalleeSaved)) : first(CallerSaved, std::size(CallerSaved));
+        if (preferred != RegisterAssignment::Spilled)
+            return preferred;
+        return crossesCall ? first(CallerSaved, std::size(CallerSaved)) : first(CalleeSaved, std::size(CalleeSaved));
+    }
+
+    void linearScan(const LiveRanges &ranges, RegisterAssignment &out)
+    {
+        std::vector<uint32_t> order(ranges.intervals.size());
+        for (uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                  { return ranges.intervals[a].start < ranges.intervals[b].start; });
+
+        // Active intervals, each holding the register in out.reg.
+        std::vector<uint32_t> active;
+        uint16_t taken = 0;
+        for (uint32_t index : order)
+        {
+            const Interval &current = ranges.intervals[index];
+
+            // An interval ending where another starts hands its register
+            // over: operands are read before the result is written.
+            for (size_t i = 0; i < active.size();)
+            {
+                const Interval &other = ranges.intervals[active[i]];
+                if (other.end <= current.start)
+                {
+                    taken &= static_cast<uint16_t>(~(1u << out.reg[other.value]));
+                    active[i] = active.back();
+                    active.pop_back();
+                }
+                else
+                    ++i;
+            }
+
+            uint8_t reg = pickRegister(current.crossesCall, taken);
+            if (reg == RegisterAssignment::Spilled)
+            {
+                // Spill whichever of the current and active intervals ends last.
+                size_t victim = active.size();
+                uint32_t furthest = current.end;
+                for (size_t i = 0; i < active.size(); ++i)
+                    if (ranges.intervals[active[i]].end > furthest)
+                    {
+                        furthest = ranges.intervals[active[i]].end;
+                        victim = i;
+                    }
+                if (victim == active.size())
+                {
+                    out.reg[current.value] = RegisterAssignment::Spilled;
+                    continue;
+                }
+                ValueId evicted = ranges.intervals[active[victim]].value;
+                reg = out.reg[evicted];
+                out.reg[evicted] = RegisterAssignment::Spilled;
+                active[victim] = active.back();
+                active.pop_back();
+                taken &= static_cast<uint16_t>(~(1u << reg));
+            }
+            out.reg[current.value] = reg;
+            taken |= static_cast<uint16_t>(1u << reg);
+            active.push_back(index);
+        }
+
+        // Clobbered registers holding values across calls are saved around them.
+        for (const auto &interval : ranges.intervals)
+        {
+            uint8_t reg = out.reg[interval.value];
+            if (!interval.crossesCall || !isCallerSaved(reg))
+                continue;
+            auto call = std::upper_bound(ranges.calls.begin(), ranges.calls.end(), std::make_pair(interval.start, NoValue));
+            for (; call != ranges.calls.end() && call->first < interval.end; ++call)
+                out.saved[call->second] |= static_cast<uint16_t>(1u << reg);
+        }
+    }
+
+    void graphColoring(const Function &fn, LiveRanges &ranges, RegisterAssignment &out)
+    {
+        size_t n = ranges.intervals.size();
+        for (auto &interval : ranges.intervals)
+            interval.crossesCall = false;
+        std::vector<std::vector<uint32_t>> adjacent(n);
+        std::unordered_set<uint64_t> edges;
+        auto interfere = [&](uint32_t a, uint32_t b)
+        {
+            if (a == b)
+                return;
+            uint64_t key = a < b ? uint64_t(a) << 32 | b : uint64_t(b) << 32 | a;
+            if (edges.insert(key).second)
+            {
+                adjacent[a].push_back(b);
+                adjacent[b].push_back(a);
+            }
+        };
+
+        // Walk each block backwards from its live-out set; a definition
+        // interferes with everything live after it.
+        std::vector<uint32_t> live, slotIn(n, None);
+        auto add = [&](uint32_t i)
+        {
+            if (slotIn[i] != None)
+                return;
+            slotIn[i] = static_cast<uint32_t>(live.size());
+            live.push_back(i);
+        };
+        auto remove = [&](uint32_t i)
+        {
+            if (slotIn[i] == None)
+                return;
+            uint32_t at = slotIn[i];
+            live[at] = live.back();
+            slotIn[live[at]] = at;
+            live.pop_back();
+            slotIn[i] = None;
+        };
+        std::vector<std::vector<uint32_t>> acrossCall(fn.instrs.size());
+        for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        {
+            for (uint32_t i : live)
+                slotIn[i] = None;
+            live.clear();
+            for (uint32_t i : ranges.liveOut[b])
+                add(i);
+
+            const auto &code = fn.blocks[b].code;
+            size_t phis = 0;
+            while (phis < code.size() && fn.instrs[code[phis]].op == Opcode::Phi)
+                ++phis;
+            for (size_t k = code.size(); k-- > phis;)
+            {
+                ValueId v = code[k];
+                uint32_t def = ranges.intervalOf[v];
+                if (def != None)
+                {
+                    remove(def);
+                    for (uint32_t other : live)
+                        interfere(def, other);
+                }
+                if (isNativeCall(fn, v))
+                {
+                    acrossCall[v] = live;
+                    for (uint32_t other : live)
+                        ranges.intervals[other].crossesCall = true;
+                }
+                const Instr &instr = fn.instrs[v];
+                for (uint16_t i = 0; i < instr.count; ++i)
+                    if (uint32_t use = ranges.intervalOf[fn.operand(v, i)]; use != None)
+                        add(use);
+            }
+            // Phis are defined together at the top of the block.
+            for (size_t k = 0; k < phis; ++k)
+                if (uint32_t def = ranges.intervalOf[code[k]]; def != None)
+                    remove(def);
+            for (size_t k = 0; k < phis; ++k)
+            {
+                uint32_t def = ranges.intervalOf[code[k]];
+                if (def == None)
+                    continue;
+                for (uint32_t other : live)
+                    interfere(def, other);
+                for (size_t j = 0; j < k; ++j)
+                    if (uint32_t phi = ranges.intervalOf[code[j]]; phi != None)
+                        interfere(def, phi);
+            }
+        }
+
+        // Simplify: remove nodes of degree below the register count, and when
+        // none is left, the cheapest per neighbour as an optimistic spill.
+        // Costs only grow as neighbours go, so the spill queue is updated
+        // lazily: an entry popped with a stale cost goes back with the new one.
+        const unsigned colors = static_cast<unsigned>(std::size(CallerSaved) + std::size(CalleeSaved));
+        std::vector<uint32_t> degree(n), stack, low;
+        std::vector<bool> removed(n, false);
+        auto spillCost = [&](uint32_t i)
+        {
+            return static_cast<double>(ranges.intervals[i].weight) / static_cast<double>(degree[i] + 1);
+        };
+        using Candidate = std::pair<double, uint32_t>;
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> spills;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            degree[i] = static_cast<uint32_t>(adjacent[i].size());
+            if (degree[i] < colors)
+                low.push_back(i);
+            else
+                spills.push({spillCost(i), i});
+        }
+        size_t remaining = n;
+        while (remaining)
+        {
+            uint32_t node = None;
+            while (!low.empty() && node == None)
+            {
+                node = low.back();
+                low.pop_back();
+                if (removed[node])
+                    node = None;
+            }
+            while (node == None)
+            {
+                auto [cost, i] = spills.top();
+                spills.pop();
+                if (removed[i])
+                    continue;
+                if (double now = spillCost(i); now != cost)
+                    spills.push({now, i});
+                else
+                    node = i;
+            }
+            removed[node] = true;
+            --remaining;
+            stack.push_back(node);
+            for (uint32_t other : adjacent[node])
+                if (!removed[other] && degree[other]-- == colors)
+                    low.push_back(other);
+        }
+
+        // Select in reverse, giving each node a color its neighbours lack.
+        while (!stack.empty())
+        {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            uint16_t taken = 0;
+            for (uint32_t other : adjacent[node])
+            {
+                uint8_t reg = out.reg[ranges.intervals[other].value];
+                if (reg < 16)
+                    taken |= static_cast<uint16_t>(1u << reg);
+            }
+            out.reg[ranges.intervals[node].value] = pickRegister(ranges.intervals[node].crossesCall, taken);
+        }
+
+        for (ValueId call = 0; call < acrossCall.size(); ++call)
+            for (uint32_t other : acrossCall[call])
+            {
+                uint8_t reg = out.reg[ranges.intervals[other].value];
+                if (isCallerSaved(reg))
+                    out.saved[call] |= static_cast<uint16_t>(1u << reg);
+            }
+    }
+
+    // Spilled values whose intervals do not overlap share a slot.
+    void assignSlots(const LiveRanges &ranges, RegisterAssignment &out)
+    {
+        std::vector<const Interval *> spilled;
+        for (const auto &interval : ranges.intervals)
+            if (out.reg[interval.value] == RegisterAssignment::Spilled)
+                spilled.push_back(&interval);
+        std::sort(spilled.begin(), spilled.end(), [](const Interval *a, const Interval *b)
+                  { return a->start < b->start; });
+
+        // Occupied slots by the end of their occupant, and slots free again.
+        using Occupied = std::pair<uint32_t, uint32_t>;
+        std::priority_queue<Occupied, std::vector<Occupied>, std::greater<Occupied>> occupied;
+        std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> free;
+        uint32_t slots = 0;
+        for (const Interval *interval : spilled)
+        {
+            while (!occupied.empty() && occupied.top().first <= interval->start)
+            {
+                free.push(occupied.top().second);
+                occupied.pop();
+            }
+            uint32_t slot = slots;
+            if (free.empty())
+                ++slots;
+            else
+            {
+                slot = free.top();
+                free.pop();
+            }
+            occupied.push({interval->end, slot});
+            out.slot[interval->value] = slot;
+        }
+        out.slots = slots;
+        out.spilled = static_cast<uint32_t>(spilled.size());
+    }
+}
+
+bool isNativeCall(const Function &fn, ValueId value)
+{
+    const Instr &instr = fn.instrs[value];
+    switch (instr.op)
+    {
+    case Opcode::Call:
+    case Opcode::CallVirtual:
+    case Opcode::New:
+        return true;
+    case Opcode::Add:
+        return instr.type == ValueType::Str;
+    case Opcode::Eq:
+    case Opcode::Ne:
+        return fn.instrs[fn.operand(value, 0)].type == ValueType::Str;
+    default:
+        return false;
+    }
+}
+
+RegisterAssignment allocateRegisters(const Function &fn, RegisterAllocator allocator)
+{
+    RegisterAssignment out;
+    out.reg.assign(fn.instrs.size(), RegisterAssignment::Unused);
+    out.slot.assign(fn.instrs.size(), 0);
+    out.saved.assign(fn.instrs.size(), 0);
+
+    LiveRanges ranges(fn, allocator == RegisterAllocator::GraphColoring);
+    switch (allocator)
+    {
+    case RegisterAllocator::None:
+        for (const auto &interval : ranges.intervals)
+        {
+            out.reg[interval.value] = RegisterAssignment::Spilled;
+            out.slot[interval.value] = out.slots++;
+        }
+        out.spilled = out.slots;
+        return out;
+    case RegisterAllocator::LinearScan:
+        linearScan(ranges, out);
+        break;
+    case RegisterAllocator::GraphColoring:
+        graphColoring(fn, ranges, out);
+        break;
+    }
+    assignSlots(ranges, out);
+
+    uint16_t used = 0;
+    for (uint8_t reg : out.reg)
+        if (reg < 16)
+            used |= static_cast<uint16_t>(1u << reg);
+    for (Reg reg : CalleeSaved)
+        if (used >> static_cast<unsigned>(reg) & 1)
+            out.calleeSaved.push_back(reg);
+    return out;
+}
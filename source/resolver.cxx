@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <parser.hxx>
+#include <resolver.hxx>
+#include <visitor.hxx>
+#include <error.hxx>
+
+namespace
+{
+    bool isCallable(const Symbol *symbol)
+    {
+        return symbol->kind == SymbolKind::Function || symbol->kind == SymbolKind::Method;
+    }
+
+    bool sameParameters(const Symbol *a, const Symbol *b)
+    {
+        const auto &x = static_cast<const FunctionDeclNode *>(a->decl)->params;
+        const auto &y = static_cast<const FunctionDeclNode *>(b->decl)->params;
+        return std::equal(x.begin(), x.end(), y.begin(), y.end(),
+                          [](const auto &p, const auto &q) { return p.first == q.first; });
+    }
+
+    struct Resolver : ASTVisitor<Resolver, void, false>
+    {
+        SymbolTable &table;
+        const std::string &source;
+        Scope *scope;
+        FunctionDeclNode *function = nullptr;
+        std::vector<std::pair<FunctionDeclNode *, Scope *>> deferred;
+        std::vector<ClassDeclNode *> classes;
+
+        Resolver(SymbolTable &table, const std::string &source)
+            : table(table), source(source), scope(table.global()) {}
+
+        [[noreturn]] void error(const std::string &message, const ASTNode *at, const std::string &name)
+        {
+            Error::semantic(message, Token{TokenType::Identifier, name, currentFile, at->line, at->column}, source);
+        }
+
+        Symbol *declare(SymbolKind kind, const std::string &name, Type type, ASTNode *decl, bool isStatic)
+        {
+            InternId id = table.names.intern(name);
+            Symbol *symbol = table.newSymbol(kind, id, type, decl);
+            symbol->scope = scope;
+            symbol->isStatic = isStatic;
+
+            if (Symbol *existing = scope->symbols.find(id))
+            {
+                if (!isCallable(existing) || !isCallable(symbol))
+                    error("Duplicate declaration of '" + name + "'", decl, name);
+
+                // Overloads are told apart by parameter types alone, so a
+                // call could never select the second of two equal signatures.
+                for (;; existing = existing->nextOverload)
+                {
+                    if (sameParameters(existing, symbol))
+                        error("'" + name + "' is already declared with this signature", decl, name);
+                    if (!existing->nextOverload)
+                        break;
+                }
+                existing->nextOverload = symbol;
+                return symbol;
+            }
+
+            scope->symbols.insert(id, symbol);
+            return symbol;
+        }
+
+        Symbol *lookup(const std::string &name) const
+        {
+            InternId id = table.names.find(name);
+            if (id == StringInterner::None)
+                return nullptr;
+            for (Scope *s = scope; s; s = s->parent)
+            {
+                if (Symbol *symbol = s->symbols.find(id))
+                    return symbol;
+                if (s->kind == ScopeKind::Class)
+                    if (Symbol *symbol = findMember(static_cast<ClassDeclNode *>(s->owner)->symbol->baseClass, id))
+                        return symbol;
+            }
+            return nullptr;
+        }
+
+        void checkStaticAccess(const Symbol *symbol, const ASTNode *at, const std::string &name)
+        {
+            bool instanceMember = (symbol->kind == SymbolKind::Field || symbol->kind == SymbolKind::Method) && !symbol->isStatic;
+            if (instanceMember && function && function->modifier == ModifierType::Static)
+                error("Cannot access instance member '" + name + "' from static function '" + function->name + "'", at, name);
+        }
+
+        // Declares the classes, functions and class members of a body up
+        // front so that they can be referenced before their definition.
+        void predeclare(BlockNode *body, bool isClassBody)
+        {
+            for (auto &child : body->children)
+            {
+                switch (child->type)
+                {
+                case ASTNodeType::ClassDecl:
+                {
+                    auto *cls = static_cast<ClassDeclNode *>(child.get());
+                    cls->symbol = declare(SymbolKind::Class, cls->name, Type::Void, cls, false);
+                    Scope *outer = scope;
+                    scope = table.newScope(ScopeKind::Class, outer, cls);
+                    cls->symbol->members = scope;
+                    classes.push_back(cls);
+                    if (cls->body)
+                        predeclare(static_cast<BlockNode *>(cls->body.get()), true);
+                    scope = outer;
+                    break;
+                }
+                case ASTNodeType::FunctionDecl:
+                {
+                    auto *fn = static_cast<FunctionDeclNode *>(child.get());
+                    fn->symbol = declare(isClassBody ? SymbolKind::Method : SymbolKind::Function,
+                                         fn->name, fn->returnType, fn, fn->modifier == ModifierType::Static);
+                    break;
+                }
+                case ASTNodeType::VarDecl:
+                {
+                    if (!isClassBody)
+                        break;
+                    auto *var = static_cast<VarDeclNode *>(child.get());
+                    var->symbol = declare(SymbolKind::Field, var->name, var->varType, var, var->modifier == ModifierType::Static);
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+        }
+
+        void linkBases()
+        {
+            for (ClassDeclNode *cls : classes)
+            {
+                if (cls->baseName.empty())
+                    continue;
+
+                Scope *saved = scope;
+                scope = cls->symbol->scope;
+                Symbol *base = lookup(cls->baseName);
+                scope = saved;
+
+                if (!base || base->kind != SymbolKind::Class)
+                    error("Undefined base class '" + cls->baseName + "'", cls, cls->baseName);
+                if (static_cast<ClassDeclNode *>(base->decl)->isStructure)
+                    error("Cannot inherit from structure '" + cls->baseName + "'", cls, cls->baseName);
+                cls->symbol->baseClass = base;
+            }
+
+            // A chain longer than the number of classes must contain a cycle.
+            for (ClassDeclNode *cls : classes)
+            {
+                size_t length = 0;
+                for (Symbol *b = cls->symbol->baseClass; b; b = b->baseClass)
+                    if (++length > classes.size())
+                        error("Class '" + cls->name + "' inherits from itself", cls, cls->name);
+            }
+        }
+
+        void resolveProgram(BlockNode *program)
+        {
+            predeclare(program, false);
+            linkBases();
+            for (auto &child : program->children)
+            {
+                if (child->type == ASTNodeType::FunctionDecl)
+                    deferred.emplace_back(static_cast<FunctionDeclNode *>(child.get()), scope);
+                else
+                    visit(child.get());
+            }
+
+            // Bodies are resolved once every global is declared. The list
+            // can grow while it is processed (methods of nested classes).
+            for (size_t i = 0; i < deferred.size(); ++i)
+                resolveFunction(deferred[i].first, deferred[i].second);
+        }
+
+        void resolveFunction(FunctionDeclNode *fn, Scope *outer)
+        {
+            Scope *saved = scope;
+            scope = table.newScope(ScopeKind::Function, outer, fn);
+            function = fn;
+
+            fn->paramSymbols.clear();
+            for (size_t i = 0; i < fn->params.size(); ++i)
+            {
+                Symbol *param = declare(SymbolKind::Parameter, fn->params[i].second, fn->params[i].first, fn, false);
+                param->index = i;
+                fn->paramSymbols.push_back(param);
+            }
+
+            if (fn->body)
+                for (auto &child : static_cast<BlockNode *>(fn->body.get())->children)
+                    visit(child.get());
+
+            function = nullptr;
+            scope = saved;
+        }
+
+        void visitClassDecl(ClassDeclNode *cls)
+        {
+            Scope *saved = scope;
+            scope = cls->symbol->members;
+            if (cls->body)
+            {
+                for (auto &child : static_cast<BlockNode *>(cls->body.get())->children)
+                {
+                    switch (child->type)
+                    {
+                    case ASTNodeType::FunctionDecl:
+                        deferred.emplace_back(static_cast<FunctionDeclNode *>(child.get()), scope);
+                        break;
+                    case ASTNodeType::VarDecl:
+                        visit(static_cast<VarDeclNode *>(child.get())->value.get());
+                        break;
+                    default:
+                        visit(child.get());
+                        break;
+                    }
+                }
+            }
+            scope = saved;
+        }
+
+        void visitFunctionDecl(FunctionDeclNode *fn)
+        {
+            deferred.emplace_back(fn, scope);
+        }
+
+        void visitVarDecl(VarDeclNode *var)
+        {
+            visit(var->value.get());
+            var->symbol = declare(var->isConst ? SymbolKind::Constant : SymbolKind::Variable,
+                                  var->name, var->varType, var, var->modifier == ModifierType::Static);
+        }
+
+        void visitIfExpr(IfExprNode *ifn)
+        {
+            // Every later arm of an `else if` chain gets a scope of its own,
+            // as the else branch it is. Those scopes declare nothing, so they
+            // are all opened in the chain's enclosing scope, which keeps
+            // lookups from walking one scope per earlier arm; the chain
+            // itself is followed with a loop.
+            Scope *saved = scope;
+            for (;;)
+            {
+                visit(ifn->condition.get());
+                visitScoped(ifn->thenBranch.get());
+                ASTNode *next = ifn->elseBranch.get();
+                if (!next || next->type != ASTNodeType::IfExpr)
+                {
+                    visitScoped(next);
+                    break;
+                }
+                scope = table.newScope(ScopeKind::Block, saved, next);
+                ifn = static_cast<IfExprNode *>(next);
+            }
+            scope = saved;
+        }
+
+        void visitForExpr(ForExprNode *loop)
+        {
+            // The loop variable is visible in the condition, step and body only.
+            Scope *saved = scope;
+            scope = table.newScope(ScopeKind::Block, saved, loop);
+            visit(loop->init.get());
+            visit(loop->condition.get());
+            visit(loop->step.get());
+            visitScoped(loop->body.get());
+            scope = saved;
+        }
+
+        void visitMatchExpr(MatchExprNode *match)
+        {
+            visit(match->subject.get());
+            for (auto &arm : match->arms)
+                visitScoped(arm.body.get());
+            visitScoped(match->otherwise.get());
+        }
+
+        void visitScoped(ASTNode *node)
+        {
+            if (!node)
+                return;
+            Scope *saved = scope;
+            scope = table.newScope(ScopeKind::Block, saved, node);
+            visit(node);
+            scope = saved;
+        }
+
+        void visitIdentifier(IdentifierNode *id)
+        {
+            Symbol *symbol = lookup(id->name);
+            if (!symbol)
+                error("Undefined identifier '" + id->name + "'", id, id->name);
+            checkStaticAccess(symbol, id, id->name);
+            id->symbol = symbol;
+        }
+
+        void visitCallNode(CallExprNode *call)
+        {
+            // Methods called through a receiver are looked up by the type
+            // checker, which knows the receiver's class.
+            if (call->receiver)
+                return;
+
+            Symbol *symbol = lookup(call->name);
+            if (!symbol)
+                error("Undefined function '" + call->name + "'", call, call->name);
+            if (!isCallable(symbol) && symbol->kind != SymbolKind::Class)
+                error("'" + call->name + "' is not a function", call, call->name);
+            call->symbol = symbol;
+        }
+
+        void visitAssignExpr(AssignExprNode *as)
+        {
+            visit(as->value.get());
+
+            Symbol *symbol = lookup(as->name);
+            if (!symbol)
+                error("Undefined variable '" + as->name + "'", as, as->name);
+            if (isCallable(symbol) || symbol->kind == SymbolKind::Class)
+                error("Cannot assign to '" + as->name + "', it is not a variable", as, as->name);
+            bool constField = symbol->kind == SymbolKind::Field && static_cast<VarDeclNode *>(symbol->decl)->isConst;
+            if (symbol->kind == SymbolKind::Constant || constField)
+                error("Cannot assign to constant '" + as->name + "'", as, as->name);
+            checkStaticAccess(symbol, as, as->name);
+            as->symbol = symbol;
+        }
+
+        // Hash-consing runs on resolved trees, so shared names are bound already.
+        void visitSharedExpr(SharedExprNode *) {}
+    };
+}
+
+void resolveNames(ASTNode *root, SymbolTable &table, const std::string &source)
+{
+    if (!root)
+        return;
+
+    Resolver resolver(table, source);
+    if (root->type == ASTNodeType::Block)
+        resolver.resolveProgram(static_cast<BlockNode *>(root));
+    else
+        resolver.visit(root);
+}
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <simplify.hxx>
+
+namespace
+{
+    // Integer constants are kept sign-extended for signed types and
+    // zero-extended for the others.
+    int64_t normalize(ValueType type, uint64_t value)
+    {
+        if (type == ValueType::Bool)
+            return value != 0;
+        unsigned bits = valueBits(type);
+        if (bits >= 64)
+            return static_cast<int64_t>(value);
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        value &= mask;
+        if (isSignedValue(type) && value >> (bits - 1))
+            value |= ~mask;
+        return static_cast<int64_t>(value);
+    }
+
+    double toDouble(int64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    int64_t fromDouble(double value)
+    {
+        int64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    template <typename T>
+    std::optional<int64_t> compare(Opcode op, T a, T b)
+    {
+        switch (op)
+        {
+        case Opcode::Eq: return a == b;
+        case Opcode::Ne: return a != b;
+        case Opcode::Lt: return a < b;
+        case Opcode::Le: return a <= b;
+        case Opcode::Gt: return a > b;
+        case Opcode::Ge: return a >= b;
+        default: return std::nullopt;
+        }
+    }
+
+    template <typename T>
+    std::optional<int64_t> foldFloat(Opcode op, T a, T b)
+    {
+        auto encode = [](T value)
+        { return fromDouble(static_cast<double>(value)); };
+        switch (op)
+        {
+        case Opcode::Add: return encode(a + b);
+        case Opcode::Sub: return encode(a - b);
+        case Opcode::Mul: return encode(a * b);
+        case Opcode::Div: return encode(a / b);
+        default: return compare(op, a, b);
+        }
+    }
+
+    bool isConstant(const Function &fn, ValueId value)
+    {
+        return fn.instrs[value].op == Opcode::Const;
+    }
+
+    void makeConstant(Function &fn, ValueId value, int64_t imm)
+    {
+        Instr &instr = fn.instrs[value];
+        instr.op = Opcode::Const;
+        instr.count = 0;
+        instr.imm = imm;
+    }
+
+    void makeJump(Function &fn, ValueId branch, BlockId target)
+    {
+        Instr &instr = fn.instrs[branch];
+        instr.op = Opcode::Jump;
+        instr.count = 0;
+        instr.imm = target;
+    }
+}
+
+std::optional<int64_t> foldInteger(Opcode op, ValueType type, int64_t a, int64_t b)
+{
+    uint64_t ua = static_cast<uint64_t>(a), ub = static_cast<uint64_t>(b);
+    switch (op)
+    {
+    case Opcode::Add: return normalize(type, ua + ub);
+    case Opcode::Sub: return normalize(type, ua - ub);
+    case Opcode::Mul: return normalize(type, ua * ub);
+    case Opcode::Or: return normalize(type, ua | ub);
+    case Opcode::And: return normalize(type, ua & ub);
+    case Opcode::Shl: return normalize(type, ua << (ub & 63));
+    case Opcode::Shr:
+        if (isSignedValue(type))
+            return normalize(type, static_cast<uint64_t>(a >> (ub & 63)));
+        return normalize(type, ua >> (ub & 63));
+    case Opcode::MulHigh: return normalize(type, mulHigh(ua, ub, isSignedValue(type)));
+    case Opcode::Div:
+    case Opcode::Rem:
+        if (b == 0)
+            return std::nullopt;
+        if (!isSignedValue(type))
+            return normalize(type, op == Opcode::Div ? ua / ub : ua % ub);
+        // The minimum divided by -1 wraps instead of trapping.
+        if (b == -1)
+            return normalize(type, op == Opcode::Div ? uint64_t(0) - ua : 0);
+        return normalize(type, static_cast<uint64_t>(op == Opcode::Div ? a / b : a % b));
+    default:
+        break;
+    }
+    if (isSignedValue(type))
+        return compare(op, a, b);
+    return compare(op, ua, ub);
+}
+
+bool hasSideEffects(const Function &fn, ValueId v)
+{
+    const Instr &instr = fn.instrs[v];
+    switch (instr.op)
+    {
+    case Opcode::Param:
+    case Opcode::Call:
+    case Opcode::CallVirtual:
+    case Opcode::StoreGlobal:
+    case Opcode::StoreField:
+    case Opcode::Jump:
+    case Opcode::Branch:
+    case Opcode::Switch:
+    case Opcode::Return:
+        return true;
+    case Opcode::Div:
+    case Opcode::Rem:
+    {
+        // An integer division by zero traps, which must still happen when
+        // the quotient is unused.
+        if (isFloatValue(instr.type))
+            return false;
+        const Instr &divisor = fn.instrs[fn.operand(v, 1)];
+        return divisor.op != Opcode::Const || divisor.imm == 0;
+    }
+    default:
+        return false;
+    }
+}
+
+bool simplifyCFG(Function &fn)
+{
+    bool changed = false;
+
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+    {
+        ValueId last = fn.terminator(b);
+        if (last == NoValue || fn.instrs[last].op != Opcode::Branch)
+            continue;
+        uint64_t targets = static_cast<uint64_t>(fn.instrs[last].imm);
+        BlockId onTrue = static_cast<BlockId>(targets & 0xffffffff), onFalse = static_cast<BlockId>(targets >> 32);
+        if (onTrue != onFalse)
+            continue;
+        // Both edges carry the same values into the target's phis.
+        removeEdge(fn, b, onFalse);
+        makeJump(fn, last, onTrue);
+        changed = true;
+    }
+
+    // Merge a block into its only predecessor when that predecessor only
+    // jumps to it.
+    for (BlockId b = 1; b < fn.blocks.size(); ++b)
+    {
+        BasicBlock &block = fn.blocks[b];
+        if (block.preds.size() != 1 || block.preds[0] == b)
+            continue;
+        BlockId pred = block.preds[0];
+        BasicBlock &into = fn.blocks[pred];
+        if (into.succs.size() != 1)
+            continue;
+
+        for (ValueId v : block.code)
+            if (fn.instrs[v].op == Opcode::Phi)
+            {
+                replaceAllUses(fn, v, fn.operand(v, 0));
+                fn.instrs[v].op = Opcode::Nop;
+            }
+
+        fn.instrs[into.code.back()].op = Opcode::Nop;
+        into.code.pop_back();
+        for (ValueId v : block.code)
+            if (fn.instrs[v].op != Opcode::Nop)
+            {
+                fn.instrs[v].block = pred;
+                into.code.push_back(v);
+            }
+        into.succs = std::move(block.succs);
+        for (BlockId succ : into.succs)
+        {
+            for (BlockId &p : fn.blocks[succ].preds)
+                if (p == b)
+                    p = pred;
+            for (ValueId v : fn.blocks[succ].code)
+            {
+                if (fn.instrs[v].op != Opcode::Phi)
+                    break;
+                ValueId *ops = fn.operands(v);
+                for (uint16_t i = 0; i < fn.instrs[v].count; i += 2)
+                    if (ops[i + 1] == b)
+                        ops[i + 1] = pred;
+            }
+        }
+        block.code.clear();
+        block.preds.clear();
+        block.succs.clear();
+        changed = true;
+    }
+
+    size_t before = fn.blocks.size();
+    removeUnreachableBlocks(fn);
+    changed |= fn.blocks.size() != before;
+    changed |= removeTrivialPhis(fn) != 0;
+    return changed;
+}
+
+bool foldInstructions(Function &fn)
+{
+    bool changed = false;
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        for (ValueId v : fn.blocks[b].code)
+        {
+            Instr &instr = fn.instrs[v];
+            if (instr.op == Opcode::Branch && isConstant(fn, fn.operand(v, 0)))
+            {
+                uint64_t targets = static_cast<uint64_t>(instr.imm);
+                BlockId onTrue = static_cast<BlockId>(targets & 0xffffffff), onFalse = static_cast<BlockId>(targets >> 32);
+                bool condition = fn.instrs[fn.operand(v, 0)].imm != 0;
+                if (onTrue != onFalse)
+                    removeEdge(fn, b, condition ? onFalse : onTrue);
+                else
+                    removeEdge(fn, b, onFalse);
+                makeJump(fn, v, condition ? onTrue : onFalse);
+                changed = true;
+                continue;
+            }
+            if (instr.op == Opcode::Switch && isConstant(fn, fn.operand(v, 0)))
+            {
+                const SwitchTable &table = fn.switches[instr.imm];
+                uint64_t index = static_cast<uint64_t>(fn.instrs[fn.operand(v, 0)].imm) - static_cast<uint64_t>(table.low);
+                BlockId target = index < table.targets.size() ? table.targets[index] : table.otherwise;
+                for (BlockId succ : successors(fn, v))
+                    if (succ != target)
+                        removeEdge(fn, b, succ);
+                makeJump(fn, v, target);
+                changed = true;
+                continue;
+            }
+
+            if (instr.count != 2 || instr.op < Opcode::Add || instr.op > Opcode::Ge)
+                continue;
+            ValueId lhs = fn.operand(v, 0), rhs = fn.operand(v, 1);
+            if (!isConstant(fn, lhs) || !isConstant(fn, rhs))
+                continue;
+
+            // Strength-reduced code reads narrow values as 64-bit ones, so
+            // arithmetic takes its width from the result.
+            ValueType type = isComparison(instr.op) ? fn.instrs[lhs].type : instr.type;
+            int64_t a = fn.instrs[lhs].imm, b = fn.instrs[rhs].imm;
+            std::optional<int64_t> result;
+            if (type == ValueType::F64)
+                result = foldFloat(instr.op, toDouble(a), toDouble(b));
+            else if (type == ValueType::F32)
+                result = foldFloat(instr.op, static_cast<float>(toDouble(a)), static_cast<float>(toDouble(b)));
+            else if (isIntegerValue(type) || type == ValueType::Bool || type == ValueType::Byte)
+                result = foldInteger(instr.op, type, a, b);
+            if (!result)
+                continue;
+            makeConstant(fn, v, *result);
+            changed = true;
+        }
+    return changed;
+}
+
+bool eliminateDeadCode(Function &fn)
+{
+    std::vector<bool> live(fn.instrs.size(), false);
+    std::vector<ValueId> worklist;
+    for (const auto &block : fn.blocks)
+        for (ValueId v : block.code)
+            if (hasSideEffects(fn, v))
+            {
+                live[v] = true;
+                worklist.push_back(v);
+            }
+
+    while (!worklist.empty())
+    {
+        ValueId v = worklist.back();
+        worklist.pop_back();
+        const Instr &instr = fn.instrs[v];
+        size_t step = instr.op == Opcode::Phi ? 2 : 1;
+        for (size_t i = 0; i < instr.count; i += step)
+        {
+            ValueId op = fn.operand(v, i);
+            if (!live[op])
+            {
+                live[op] = true;
+                worklist.push_back(op);
+            }
+        }
+    }
+
+    bool changed = false;
+    for (auto &block : fn.blocks)
+    {
+        size_t before = block.code.size();
+        block.code.erase(std::remove_if(block.code.begin(), block.code.end(), [&](ValueId v)
+                                        { return !live[v]; }),
+                         block.code.end());
+        changed |= block.code.size() != before;
+    }
+    for (ValueId v = 0; v < fn.instrs.size(); ++v)
+        if (!live[v])
+            fn.instrs[v].op = Opcode::Nop;
+    return changed;
+}
@@ -0,0 +1,272 @@
+#include <map>
+#include <strength.hxx>
+
+namespace
+{
+    bool isPowerOfTwo(uint64_t value)
+    {
+        return value && !(value & (value - 1));
+    }
+
+    unsigned log2(uint64_t value)
+    {
+        unsigned bits = 0;
+        while (value >>= 1)
+            ++bits;
+        return bits;
+    }
+
+    /**
+     * @brief Rebuilds the code of one block at a time, appending the
+     * replacement of each instruction before the instruction itself, which
+     * turns into the last step so that its uses stay valid.
+     */
+    class StrengthReducer
+    {
+    public:
+        explicit StrengthReducer(Function &fn) : fn(fn) {}
+
+        bool run()
+        {
+            bool changed = false;
+            for (BlockId b = 0; b < fn.blocks.size(); ++b)
+            {
+                std::vector<ValueId> code = std::move(fn.blocks[b].code);
+                fn.blocks[b].code.clear();
+                block = b;
+                for (ValueId v : code)
+                {
+                    changed |= reduce(v);
+                    fn.blocks[b].code.push_back(v);
+                }
+            }
+            return changed;
+        }
+
+    private:
+        Function &fn;
+        BlockId block = 0;
+        uint32_t line = 0;
+        std::map<std::pair<ValueType, int64_t>, ValueId> constants;
+
+        // Constants go to the entry block, where they dominate every use.
+        ValueId constant(ValueType type, int64_t value)
+        {
+            auto [it, added] = constants.try_emplace({type, value}, NoValue);
+            if (added)
+                it->second = fn.emitFront(0, Opcode::Const, type, value);
+            return it->second;
+        }
+
+        ValueId emit(Opcode op, ValueType type, ValueId lhs, ValueId rhs)
+        {
+            return fn.emit(block, op, type, {lhs, rhs}, 0, line);
+        }
+
+        ValueId shift(Opcode op, ValueType type, ValueId value, unsigned bits)
+        {
+            return emit(op, type, value, constant(ValueType::I64, bits));
+        }
+
+        void become(ValueId v, Opcode op, ValueId lhs, ValueId rhs)
+        {
+            ValueId ops[] = {lhs, rhs};
+            fn.instrs[v].op = op;
+            fn.setOperands(v, ops, 2);
+        }
+
+        // x + (2^k - 1) for a negative x, so that shifting right by k
+        // rounds toward zero.
+        ValueId biased(ValueId x, unsigned k)
+        {
+            ValueId sign = k == 1 ? x : shift(Opcode::Shr, ValueType::I64, x, 63);
+            ValueId bias = shift(Opcode::Shr, ValueType::U64, sign, 64 - k);
+            return emit(Opcode::Add, ValueType::I64, x, bias);
+        }
+
+        ValueId signedQuotient(ValueId x, int64_t divisor)
+        {
+            uint64_t magnitude = divisor < 0 ? 0 - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor);
+            if (isPowerOfTwo(magnitude))
+            {
+                unsigned k = log2(magnitude);
+                ValueId q = shift(Opcode::Shr, ValueType::I64, biased(x, k), k);
+                return divisor < 0 ? emit(Opcode::Sub, ValueType::I64, constant(ValueType::I64, 0), q) : q;
+            }
+            SignedMagic magic = signedMagic(divisor);
+            ValueId q = emit(Opcode::MulHigh, ValueType::I64, x, constant(ValueType::I64, magic.multiplier));
+            if (divisor > 0 && magic.multiplier < 0)
+                q = emit(Opcode::Add, ValueType::I64, q, x);
+            else if (divisor < 0 && magic.multiplier > 0)
+                q = emit(Opcode::Sub, ValueType::I64, q, x);
+            if (magic.shift)
+                q = shift(Opcode::Shr, ValueType::I64, q, magic.shift);
+            // Adding the sign bit rounds a negative quotient up toward zero.
+            return emit(Opcode::Add, ValueType::I64, q, shift(Opcode::Shr, ValueType::U64, q, 63));
+        }
+
+        ValueId unsignedQuotient(ValueId x, uint64_t divisor)
+        {
+            if (isPowerOfTwo(divisor))
+                return shift(Opcode::Shr, ValueType::U64, x, log2(divisor));
+            UnsignedMagic magic = unsignedMagic(divisor);
+            ValueId high = emit(Opcode::MulHigh, ValueType::U64, x, constant(ValueType::U64, static_cast<int64_t>(magic.multiplier)));
+            if (!magic.add)
+                return magic.shift ? shift(Opcode::Shr, ValueType::U64, high, magic.shift) : high;
+            // The 65-bit multiplier: (x - high) / 2 + high is (x + high) / 2 without overflow.
+            ValueId half = shift(Opcode::Shr, ValueType::U64, emit(Opcode::Sub, ValueType::U64, x, high), 1);
+            ValueId sum = emit(Opcode::Add, ValueType::U64, half, high);
+            return magic.shift > 1 ? shift(Opcode::Shr, ValueType::U64, sum, magic.shift - 1) : sum;
+        }
+
+        bool reduce(ValueId v)
+        {
+            const Instr &instr = fn.instrs[v];
+            if (instr.count != 2 || !isIntegerValue(instr.type))
+                return false;
+            Opcode op = instr.op;
+            ValueType type = instr.type;
+            ValueId x = fn.operand(v, 0), y = fn.operand(v, 1);
+            line = instr.line;
+
+            if (op == Opcode::Mul)
+            {
+                if (fn.instrs[x].op == Opcode::Const)
+                    std::swap(x, y);
+                if (fn.instrs[y].op != Opcode::Const)
+                    return false;
+                uint64_t factor = static_cast<uint64_t>(fn.instrs[y].imm);
+                if (!isPowerOfTwo(factor) || factor == 1)
+                    return false;
+                become(v, Opcode::Shl, x, constant(ValueType::I64, log2(factor)));
+                return true;
+            }
+            if ((op != Opcode::Div && op != Opcode::Rem) || fn.instrs[y].op != Opcode::Const)
+                return false;
+
+            int64_t divisor = fn.instrs[y].imm;
+            bool isSigned = isSignedValue(type);
+            if (divisor == 1 || (isSigned && divisor == -1))
+            {
+                if (op == Opcode::Div && divisor == 1)
+                    return false;
+                // The minimum divided by -1 wraps, just like its negation.
+                if (op == Opcode::Div)
+                    become(v, Opcode::Sub, constant(type, 0), x);
+                else
+                {
+                    Instr &zero = fn.instrs[v];
+                    zero.op = Opcode::Const;
+                    zero.count = 0;
+                    zero.imm = 0;
+                }
+                return true;
+            }
+            // Dividing by zero must still trap. Unsigned quotients by 2^63 and
+            // up are 0 or 1 and are left as they are.
+            if (divisor == 0 || (!isSigned && divisor < 0 && !isPowerOfTwo(divisor)))
+                return false;
+
+            if (op == Opcode::Div)
+            {
+                // The quotient is in range, so the division takes over the
+                // last step of the sequence with its own type.
+                ValueId q = isSigned ? signedQuotient(x, divisor) : unsignedQuotient(x, static_cast<uint64_t>(divisor));
+                fn.blocks[block].code.pop_back();
+                become(v, fn.instrs[q].op, fn.operand(q, 0), fn.operand(q, 1));
+                fn.instrs[q].op = Opcode::Nop;
+                return true;
+            }
+
+            uint64_t magnitude = isSigned && divisor < 0 ? 0 - static_cast<uint64_t>(divisor) : static_cast<uint64_t>(divisor);
+            if (isPowerOfTwo(magnitude))
+            {
+                if (!isSigned)
+                {
+                    become(v, Opcode::And, x, constant(type, divisor - 1));
+                    return true;
+                }
+                unsigned k = log2(magnitude);
+                ValueId multiple = emit(Opcode::And, ValueType::I64, biased(x, k), constant(ValueType::I64, static_cast<int64_t>(0 - magnitude)));
+                become(v, Opcode::Sub, x, multiple);
+                return true;
+            }
+            ValueId q = isSigned ? signedQuotient(x, divisor) : unsignedQuotient(x, static_cast<uint64_t>(divisor));
+            become(v, Opcode::Sub, x, emit(Opcode::Mul, type, q, y));
+            return true;
+        }
+    };
+}
+
+SignedMagic signedMagic(int64_t divisor)
+{
+    // Hacker's Delight, figure 10-1, for 64 bits: the smallest shift whose
+    // multiplier is exact for every dividend.
+    const uint64_t two63 = uint64_t(1) << 63;
+    uint64_t d = static_cast<uint64_t>(divisor);
+    uint64_t magnitude = divisor < 0 ? 0 - d : d;
+    uint64_t t = two63 + (d >> 63);
+    uint64_t limit = t - 1 - t % magnitude;
+    unsigned p = 63;
+    uint64_t q1 = two63 / limit, r1 = two63 - q1 * limit;
+    uint64_t q2 = two63 / magnitude, r2 = two63 - q2 * magnitude;
+    uint64_t delta;
+    do
+    {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= limit)
+        {
+            ++q1;
+            r1 -= limit;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= magnitude)
+        {
+            ++q2;
+            r2 -= magnitude;
+        }
+        delta = magnitude - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    uint64_t multiplier = q2 + 1;
+    return {static_cast<int64_t>(divisor < 0 ? 0 - multiplier : multiplier), p - 64};
+}
+
+UnsignedMagic unsignedMagic(uint64_t divisor)
+{
+    // Hacker's Delight, figure 10-2, for 64 bits.
+    const uint64_t two63 = uint64_t(1) << 63;
+    bool add = false;
+    unsigned p = 63;
+    uint64_t q = (two63 - 1) / divisor, r = (two63 - 1) - q * divisor;
+    uint64_t scale = 0, delta;
+    do
+    {
+        ++p;
+        scale = p == 64 ? 1 : 2 * scale;
+        if (r + 1 >= divisor - r)
+        {
+            if (q >= two63 - 1)
+                add = true;
+            q = 2 * q + 1;
+            r = 2 * r + 1 - divisor;
+        }
+        else
+        {
+            if (q >= two63)
+                add = true;
+            q = 2 * q;
+            r = 2 * r + 1;
+        }
+        delta = divisor - 1 - r;
+    } while (p < 128 && scale < delta);
+    return {q + 1, p - 64, add};
+}
+
+bool reduceStrength(Function &fn)
+{
+    return StrengthReducer(fn).run();
+}
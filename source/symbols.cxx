@@ -0,0 +1,34 @@
+#include <symbols.hxx>
+
+void SymbolMap::insert(InternId name, Symbol *symbol)
+{
+    if ((count + 1) * 2 > slots.size())
+        grow();
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashId(name) & mask;; i = (i + 1) & mask)
+    {
+        Slot &slot = slots[i];
+        if (!slot.symbol)
+        {
+            slot = {name, symbol};
+            ++count;
+            return;
+        }
+        if (slot.name == name)
+        {
+            slot.symbol = symbol;
+            return;
+        }
+    }
+}
+
+void SymbolMap::grow()
+{
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? 8 : old.size() * 2, Slot{0, nullptr});
+    count = 0;
+    for (const Slot &slot : old)
+        if (slot.symbol)
+            insert(slot.name, slot.symbol);
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <utility>
+#include <threadpool.hxx>
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back([this]
+                             { work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::drain()
+{
+    for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < jobSize; i = next.fetch_add(1, std::memory_order_relaxed))
+    {
+        try
+        {
+            (*job)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure)
+                failure = std::current_exception();
+            // Stop handing out work; the loop is failing anyway.
+            next.store(jobSize, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ThreadPool::work()
+{
+    size_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]
+                      { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0)
+            done.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    if (count == 0)
+        return;
+    if (workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobSize = count;
+        next.store(0, std::memory_order_relaxed);
+        failure = nullptr;
+        // Every worker checks in once per loop, so none can still be reading
+        // this job when the next one is installed.
+        busy = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]
+              { return busy == 0; });
+    job = nullptr;
+    if (failure)
+        std::rethrow_exception(std::exchange(failure, nullptr));
+}
@@ -0,0 +1,287 @@
+#include <cinttypes>
+#include <analysis.hxx>
+#include <tiering.hxx>
+
+namespace
+{
+    bool isScalar(ValueType type)
+    {
+        return type != ValueType::Str && type != ValueType::Ptr;
+    }
+
+    // Whether a function's own code stays away from strings and objects.
+    bool handlesScalarsOnly(const Function &fn)
+    {
+        if (!isScalar(fn.returnType))
+            return false;
+        for (ValueType type : fn.params)
+            if (!isScalar(type))
+                return false;
+        for (const auto &instr : fn.instrs)
+            if (instr.op != Opcode::Nop && (!isScalar(instr.type) || instr.op == Opcode::CallVirtual || instr.op == Opcode::New || instr.op == Opcode::NewLocal))
+                return false;
+        return true;
+    }
+
+    /*
+     * A copy of fn that starts at a loop header. Its parameters are the
+     * values live there, listed in state: the header's phis, which take them
+     * as the operand from the new entry, then the values defined before the
+     * loop, which they replace. Values the loop can define again, as in an
+     * inner loop, would need new phis; such headers get no entry.
+     */
+    bool entryAtHeader(const Function &fn, const Liveness &live, BlockId header, Function &out, std::vector<ValueId> &state)
+    {
+        std::vector<bool> reached(fn.blocks.size(), false);
+        std::vector<BlockId> work{header};
+        reached[header] = true;
+        while (!work.empty())
+        {
+            BlockId block = work.back();
+            work.pop_back();
+            for (BlockId succ : fn.blocks[block].succs)
+                if (!reached[succ])
+                {
+                    reached[succ] = true;
+                    work.push_back(succ);
+                }
+        }
+        if (reached[0])
+            return false;
+
+        state.clear();
+        for (ValueId v : fn.blocks[header].code)
+            if (fn.instrs[v].op == Opcode::Phi)
+                state.push_back(v);
+        const size_t phis = state.size();
+        for (ValueId v = 0; v < fn.instrs.size(); ++v)
+            if (live.liveIn(header, v))
+            {
+                if (reached[fn.instrs[v].block])
+                    return false;
+                state.push_back(v);
+            }
+
+        // The old entry block becomes the new one; what it held is dead.
+        out = fn;
+        out.name = fn.name + ".osr" + std::to_string(header);
+        out.params.clear();
+        out.exported = false;
+        for (BlockId succ : std::vector<BlockId>(out.blocks[0].succs))
+            removeEdge(out, 0, succ);
+        for (ValueId v : out.blocks[0].code)
+            out.instrs[v].op = Opcode::Nop;
+        out.blocks[0].code.clear();
+
+        for (size_t i = 0; i < state.size(); ++i)
+        {
+            ValueType type = fn.instrs[state[i]].type;
+            ValueId param = out.emit(0, Opcode::Param, type, {}, static_cast<int64_t>(i));
+            out.params.push_back(type);
+            if (i < phis)
+            {
+                std::vector<ValueId> ops(out.operands(state[i]), out.operands(state[i]) + out.instrs[state[i]].count);
+                ops.push_back(param);
+                ops.push_back(0);
+                out.setOperands(state[i], ops.data(), ops.size());
+            }
+            else
+                replaceAllUses(out, state[i], param);
+        }
+        out.emit(0, Opcode::Jump, ValueType::Void, {}, header);
+        out.addEdge(0, header);
+        removeUnreachableBlocks(out);
+
+        DominatorTree dom;
+        dom.compute(out);
+        std::string message;
+        return verifyFunction(out, dom, message);
+    }
+
+    double milliseconds(std::chrono::nanoseconds time)
+    {
+        return static_cast<double>(time.count()) / 1e6;
+    }
+}
+
+TieredRunner::TieredRunner(const Module &module, const TierOptions &options)
+    : module(module), options(options), program(compileBytecode(module)), vm(program), jit(module, options.optLevel),
+      records(module.functions.size())
+{
+    // A function can move up if it and everything it calls handle scalars only.
+    for (size_t i = 0; i < module.functions.size(); ++i)
+        records[i].eligible = handlesScalarsOnly(module.functions[i]);
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (size_t i = 0; i < module.functions.size(); ++i)
+        {
+            if (!records[i].eligible)
+                continue;
+            const Function &fn = module.functions[i];
+            for (const auto &instr : fn.instrs)
+                if (instr.op == Opcode::Call && !records[instr.imm].eligible)
+                {
+                    records[i].eligible = false;
+                    changed = true;
+                    break;
+                }
+        }
+    }
+
+    if (uint64_t *slots = jit.globalSlots())
+        vm.useGlobals(slots);
+    vm.setNativeCall(&Jit::call);
+    vm.setHotHook(options.threshold, [this](uint32_t function)
+                  { onHot(function); });
+    if (options.background)
+        worker = std::thread(&TieredRunner::work, this);
+}
+
+TieredRunner::~TieredRunner()
+{
+    stop();
+}
+
+void TieredRunner::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        stopping = true;
+    }
+    queued.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+int TieredRunner::run()
+{
+    vm.setNativeTiming(true);
+    Clock::time_point start = Clock::now();
+    int status = vm.run();
+    total = Clock::now() - start;
+    stop();
+    return status;
+}
+
+void TieredRunner::onHot(uint32_t function)
+{
+    Record &record = records[function];
+    if (!record.eligible || record.hot)
+        return;
+    record.hot = true;
+    record.hotAt = Clock::now();
+
+    if (!options.background)
+    {
+        tierUp(function, false);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        queue.push_back(function);
+    }
+    queued.notify_one();
+}
+
+std::vector<VM::OsrEntry> TieredRunner::loopEntries(uint32_t function, bool freshPages)
+{
+    const Function &fn = module.functions[function];
+    DominatorTree dom;
+    dom.compute(fn);
+    LoopInfo loops;
+    loops.compute(fn, dom);
+    Liveness live;
+    live.compute(fn, dom);
+    std::vector<uint32_t> registers = valueRegisters(fn);
+
+    std::vector<VM::OsrEntry> entries;
+    for (const Loop &loop : loops.loops)
+    {
+        Function entryFn;
+        std::vector<ValueId> state;
+        if (!entryAtHeader(fn, live, loop.header, entryFn, state))
+            continue;
+        VM::OsrEntry entry;
+        entry.offset = program.functions[function].blocks[loop.header];
+        entry.entry = jit.compileEntry(entryFn, function, freshPages);
+        for (ValueId v : state)
+            entry.registers.push_back(registers[v]);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+void TieredRunner::tierUp(uint32_t function, bool freshPages)
+{
+    Clock::time_point start = Clock::now();
+    jit.compile(function, freshPages);
+    VM::NativeEntry entry = jit.arrayEntry(function, freshPages);
+    std::vector<VM::OsrEntry> loops = loopEntries(function, freshPages);
+    Clock::time_point end = Clock::now();
+    vm.install(function, entry);
+
+    std::lock_guard<std::mutex> guard(queueLock);
+    Record &record = records[function];
+    if (!loops.empty())
+    {
+        record.loops = std::move(loops);
+        vm.installOsr(function, &record.loops);
+    }
+    record.installed = true;
+    record.latency = end - record.hotAt;
+    record.compileTime = end - start;
+    if (!freshPages)
+        compiling += record.compileTime;
+}
+
+void TieredRunner::work()
+{
+    // Code compiled here goes on fresh pages, so the generated code the main
+    // thread is running never loses execute permission.
+    std::unique_lock<std::mutex> guard(queueLock);
+    for (;;)
+    {
+        queued.wait(guard, [this]
+                    { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+        uint32_t function = queue.front();
+        queue.pop_front();
+        guard.unlock();
+        tierUp(function, true);
+        guard.lock();
+    }
+}
+
+void TieredRunner::printStats(FILE *out) const
+{
+    std::chrono::nanoseconds native(vm.nativeNanoseconds());
+    std::chrono::nanoseconds interpreted = total - native - compiling;
+
+    size_t eligible = 0, installed = 0;
+    std::chrono::nanoseconds latency{0}, longest{0}, compileTime{0};
+    for (const auto &record : records)
+    {
+        eligible += record.eligible;
+        if (!record.installed)
+            continue;
+        ++installed;
+        latency += record.latency;
+        longest = std::max(longest, record.latency);
+        compileTime += record.compileTime;
+    }
+
+    fprintf(out, "Tiers (threshold %u, %s compilation):\n", options.threshold, options.background ? "background" : "synchronous");
+    fprintf(out, "  functions: %zu, can tier up: %zu, tiered up: %zu\n", records.size(), eligible, installed);
+    fprintf(out, "  interpreter: %.3f ms, native: %.3f ms, compiling: %.3f ms\n", milliseconds(interpreted), milliseconds(native),
+            milliseconds(compileTime));
+    fprintf(out, "  entered at loop headers: %" PRIu64 "\n", vm.osrTransfers());
+    if (installed)
+        fprintf(out, "  tier-up latency: mean %.3f ms, max %.3f ms\n", milliseconds(latency) / static_cast<double>(installed),
+                milliseconds(longest));
+    for (size_t i = 0; i < records.size(); ++i)
+        if (records[i].installed)
+            fprintf(out, "  %-24s latency %.3f ms, compile %.3f ms\n", module.functions[i].name.c_str(), milliseconds(records[i].latency),
+                    milliseconds(records[i].compileTime));
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <passmanager.hxx>
+#include <treeshake.hxx>
+
+namespace
+{
+    constexpr uint32_t Removed = UINT32_MAX;
+
+    class TreeShaker
+    {
+    public:
+        explicit TreeShaker(Module &module)
+            : module(module), liveFunctions(module.functions.size(), false), liveClasses(module.classes.size(), false),
+              instantiated(module.classes.size(), false), loaded(module.globals.size(), false), liveStrings(module.strings.size(), false)
+        {
+        }
+
+        ShakeResult run()
+        {
+            markRoots();
+            while (!worklist.empty())
+            {
+                uint32_t f = worklist.back();
+                worklist.pop_back();
+                scan(module.functions[f]);
+            }
+            for (size_t g = 0; g < module.globals.size(); ++g)
+                if (loaded[g] && module.globals[g].type == ValueType::Str)
+                    liveStrings[static_cast<size_t>(module.globals[g].init)] = true;
+
+            ShakeResult result;
+            for (size_t f = 0; f < module.functions.size(); ++f)
+                if (liveFunctions[f])
+                    result.stores += removeDeadStores(module.functions[f]);
+                else
+                    result.irBytes += irBytes(module.functions[f]);
+            for (size_t s = 0; s < module.strings.size(); ++s)
+                if (!liveStrings[s])
+                    result.stringBytes += module.strings[s].size() + 1;
+            // No object ever points at the vtable of a class without instances.
+            for (size_t c = 0; c < module.classes.size(); ++c)
+                if (!instantiated[c])
+                    module.classes[c].vtable.clear();
+
+            std::vector<uint32_t> functionMap = compact(module.functions, liveFunctions, result.functions);
+            std::vector<uint32_t> classMap = compact(module.classes, liveClasses, result.classes);
+            std::vector<uint32_t> globalMap = compact(module.globals, loaded, result.globals);
+            std::vector<uint32_t> stringMap = compact(module.strings, liveStrings, result.strings);
+            if (!result.changed())
+                return result;
+
+            for (auto &fn : module.functions)
+            {
+                if (fn.classIndex >= 0)
+                    fn.classIndex = static_cast<int>(classMap[fn.classIndex]);
+                for (auto &instr : fn.instrs)
+                {
+                    switch (instr.op)
+                    {
+                    case Opcode::Call:
+                    case Opcode::CallVirtual:
+                        instr.imm = functionMap[instr.imm];
+                        break;
+                    case Opcode::New:
+                    case Opcode::NewLocal:
+                        instr.imm = classMap[instr.imm];
+                        break;
+                    case Opcode::LoadGlobal:
+                    case Opcode::StoreGlobal:
+                        instr.imm = globalMap[instr.imm];
+                        break;
+                    case Opcode::Const:
+                        if (instr.type == ValueType::Str)
+                            instr.imm = stringMap[instr.imm];
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            }
+            for (size_t c = 0; c < module.classes.size(); ++c)
+            {
+                IRClass &cls = module.classes[c];
+                if (cls.base >= 0)
+                    cls.base = static_cast<int>(classMap[cls.base]);
+                cls.initializer = functionMap[cls.initializer];
+                for (uint32_t &method : cls.vtable)
+                    method = functionMap[method];
+            }
+            for (auto &global : module.globals)
+                if (global.type == ValueType::Str)
+                    global.init = stringMap[global.init];
+            module.initializer = functionMap[module.initializer];
+            if (module.entry >= 0)
+                module.entry = static_cast<int>(functionMap[module.entry]);
+            return result;
+        }
+
+    private:
+        Module &module;
+        std::vector<bool> liveFunctions, liveClasses, instantiated, loaded, liveStrings;
+        std::vector<uint32_t> worklist;
+
+        void markRoots()
+        {
+            markFunction(module.initializer);
+            if (module.entry >= 0)
+                markFunction(static_cast<uint32_t>(module.entry));
+            bool exports = false;
+            for (uint32_t f = 0; f < module.functions.size(); ++f)
+                if (module.functions[f].exported)
+                {
+                    markFunction(f);
+                    exports = true;
+                }
+            if (module.entry < 0 && !exports)
+                for (uint32_t f = 0; f < module.functions.size(); ++f)
+                    markFunction(f);
+            // The empty string is what a Str global without an initializer holds.
+            if (!liveStrings.empty())
+                liveStrings[0] = true;
+        }
+
+        void markFunction(uint32_t f)
+        {
+            if (liveFunctions[f])
+                return;
+            liveFunctions[f] = true;
+            worklist.push_back(f);
+            if (module.functions[f].classIndex >= 0)
+                markClass(static_cast<uint32_t>(module.functions[f].classIndex));
+        }
+
+        void markClass(uint32_t c)
+        {
+            if (liveClasses[c])
+                return;
+            liveClasses[c] = true;
+            const IRClass &cls = module.classes[c];
+            markFunction(cls.initializer);
+            if (cls.base >= 0)
+                markClass(static_cast<uint32_t>(cls.base));
+        }
+
+        // Any slot of an instance may be called through its vtable.
+        void instantiate(uint32_t c)
+        {
+            markClass(c);
+            if (instantiated[c])
+                return;
+            instantiated[c] = true;
+            for (uint32_t method : module.classes[c].vtable)
+                markFunction(method);
+        }
+
+        void scan(const Function &fn)
+        {
+            for (const auto &block : fn.blocks)
+                for (ValueId v : block.code)
+                {
+                    const Instr &instr = fn.instrs[v];
+                    switch (instr.op)
+                    {
+                    case Opcode::Call:
+                    case Opcode::CallVirtual:
+                        markFunction(static_cast<uint32_t>(instr.imm));
+                        break;
+                    case Opcode::New:
+                    case Opcode::NewLocal:
+                        instantiate(static_cast<uint32_t>(instr.imm));
+                        break;
+                    case Opcode::LoadGlobal:
+                        loaded[static_cast<size_t>(instr.imm)] = true;
+                        break;
+                    case Opcode::Const:
+                        if (instr.type == ValueType::Str)
+                            liveStrings[static_cast<size_t>(instr.imm)] = true;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+        }
+
+        size_t removeDeadStores(Function &fn)
+        {
+            size_t removed = 0;
+            for (auto &block : fn.blocks)
+            {
+                auto end = std::remove_if(block.code.begin(), block.code.end(), [&](ValueId v)
+                                          {
+                                              Instr &instr = fn.instrs[v];
+                                              if (instr.op != Opcode::StoreGlobal || loaded[static_cast<size_t>(instr.imm)])
+                                                  return false;
+                                              instr.op = Opcode::Nop;
+                                              instr.count = 0;
+                                              return true; });
+                removed += static_cast<size_t>(block.code.end() - end);
+                block.code.erase(end, block.code.end());
+            }
+            return removed;
+        }
+
+        /** @brief Keeps the live elements in order; returns old index to new */
+        template <typename T>
+        static std::vector<uint32_t> compact(std::vector<T> &items, const std::vector<bool> &live, size_t &removed)
+        {
+            std::vector<uint32_t> map(items.size(), Removed);
+            uint32_t next = 0;
+            for (size_t i = 0; i < items.size(); ++i)
+                if (live[i])
+                {
+                    if (next != i)
+                        items[next] = std::move(items[i]);
+                    map[i] = next++;
+                }
+            removed = items.size() - next;
+            items.resize(next);
+            return map;
+        }
+    };
+}
+
+ShakeResult shakeModule(Module &module, FILE *remarks)
+{
+    size_t functions = module.functions.size(), classes = module.classes.size(), globals = module.globals.size(), strings = module.strings.size();
+    ShakeResult result = TreeShaker(module).run();
+    if (remarks && result.changed())
+        fprintf(remarks, "remark: tree-shake: removed %zu of %zu functions, %zu of %zu classes, %zu of %zu globals, %zu of %zu strings, "
+                         "%zu stores to unread globals; %zu bytes of IR, %zu bytes of string data\n",
+                result.functions, functions, result.classes, classes, result.globals, globals, result.strings, strings,
+                result.stores, result.irBytes, result.stringBytes);
+    return result;
+}
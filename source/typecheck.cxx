@@ -0,0 +1,543 @@
+#include <limits>
+#include <set>
+#include <parser.hxx>
+#include <typecheck.hxx>
+#include <visitor.hxx>
+#include <string.hxx>
+#include <error.hxx>
+
+namespace
+{
+    bool isArithmetic(const std::string &op)
+    {
+        return op == "+" || op == "-" || op == "*" || op == "/" || op == "%";
+    }
+
+    bool isOrdering(const std::string &op)
+    {
+        return op == "<" || op == "<=" || op == ">" || op == ">=";
+    }
+
+    bool isEquality(const std::string &op)
+    {
+        return op == "==" || op == "!=";
+    }
+
+    bool fitsInteger(bool negative, uint64_t magnitude, Type target)
+    {
+        if (negative)
+        {
+            if (!isSignedType(target))
+                return false;
+            uint64_t limit = uint64_t(1) << (bitWidth(target) - 1);
+            return magnitude <= limit;
+        }
+        unsigned bits = isSignedType(target) ? bitWidth(target) - 1 : bitWidth(target);
+        return bits >= 64 || magnitude < (uint64_t(1) << bits);
+    }
+
+    template <typename T>
+    void storeInteger(LiteralNode *lit, bool negative, uint64_t magnitude)
+    {
+        if constexpr (std::is_signed_v<T>)
+            lit->value = static_cast<T>(negative ? -static_cast<int64_t>(magnitude - 1) - 1 : static_cast<int64_t>(magnitude));
+        else
+            lit->value = static_cast<T>(magnitude);
+    }
+
+    void storeInteger(LiteralNode *lit, Type target, bool negative, uint64_t magnitude)
+    {
+        switch (target)
+        {
+        case Type::Int8:
+            return storeInteger<int8_t>(lit, negative, magnitude);
+        case Type::Int16:
+            return storeInteger<int16_t>(lit, negative, magnitude);
+        case Type::Int32:
+            return storeInteger<int32_t>(lit, negative, magnitude);
+        case Type::Int64:
+            return storeInteger<int64_t>(lit, negative, magnitude);
+        case Type::Uint8:
+            return storeInteger<uint8_t>(lit, negative, magnitude);
+        case Type::Uint16:
+            return storeInteger<uint16_t>(lit, negative, magnitude);
+        case Type::Uint32:
+            return storeInteger<uint32_t>(lit, negative, magnitude);
+        default:
+            return storeInteger<uint64_t>(lit, negative, magnitude);
+        }
+    }
+
+    struct TypeChecker : ASTVisitor<TypeChecker, const TypeInfo *, false>
+    {
+        SymbolTable &symbols;
+        TypeInterner &types;
+        const std::string &source;
+        const TypeInfo *hint = nullptr;
+        const FunctionDeclNode *function = nullptr;
+
+        TypeChecker(SymbolTable &symbols, TypeInterner &types, const std::string &source)
+            : symbols(symbols), types(types), source(source) {}
+
+        [[noreturn]] void error(const std::string &message, const ASTNode *at, const std::string &lexeme)
+        {
+            Error::type(message, Token{TokenType::Identifier, lexeme, currentFile, at->line, at->column}, source);
+        }
+
+        const TypeInfo *voidType() const { return types.primitive(Type::Void); }
+
+        const TypeInfo *check(ASTNode *node, const TypeInfo *expected)
+        {
+            if (!node)
+                return nullptr;
+            const TypeInfo *saved = hint;
+            hint = expected;
+            const TypeInfo *t = visit(node);
+            hint = saved;
+            node->resolvedType = t;
+            return t;
+        }
+
+        void expectType(ASTNode *node, const TypeInfo *expected, const std::string &what)
+        {
+            const TypeInfo *actual = check(node, expected);
+            if (actual != expected)
+                error("Cannot use a value of type '" + actual->name + "' as " + what + " of type '" + expected->name + "'", node, actual->name);
+        }
+
+        void assignSymbolTypes()
+        {
+            for (Symbol &symbol : symbols.symbols)
+            {
+                switch (symbol.kind)
+                {
+                case SymbolKind::Class:
+                    symbol.typeInfo = types.classType(&symbol, symbols.name(&symbol));
+                    break;
+                case SymbolKind::Function:
+                case SymbolKind::Method:
+                {
+                    auto *fn = static_cast<FunctionDeclNode *>(symbol.decl);
+                    std::vector<const TypeInfo *> params;
+                    for (auto &p : fn->params)
+                        params.push_back(types.primitive(p.first));
+                    symbol.typeInfo = types.function(types.primitive(fn->returnType), params);
+                    break;
+                }
+                default:
+                    symbol.typeInfo = types.primitive(symbol.type);
+                    break;
+                }
+            }
+        }
+
+        // Literals, and arithmetic made only of literals, take their type
+        // from context.
+        bool isAdaptable(const ASTNode *node) const
+        {
+            // Down the left spine by iteration, so long chains cost no stack.
+            while (node->type == ASTNodeType::BinaryExpr)
+            {
+                auto *bin = static_cast<const BinaryExprNode *>(node);
+                if (!isArithmetic(bin->op) || !isAdaptable(bin->right.get()))
+                    return false;
+                node = bin->left.get();
+            }
+            if (node->type == ASTNodeType::Literal)
+                return isNumericType(static_cast<const LiteralNode *>(node)->literalType);
+            return false;
+        }
+
+        bool adaptLiteral(LiteralNode *lit, Type target)
+        {
+            if (lit->literalType == target)
+                return true;
+
+            if (isFloatType(lit->literalType))
+            {
+                if (!isFloatType(target))
+                    return false;
+                double v = std::visit([](auto x) -> double
+                                      {
+                    if constexpr (std::is_arithmetic_v<decltype(x)>)
+                        return static_cast<double>(x);
+                    else
+                        return 0.0; }, lit->value);
+                if (target == Type::Float32)
+                    lit->value = static_cast<float>(v);
+                else
+                    lit->value = v;
+                lit->literalType = target;
+                return true;
+            }
+
+            if (!isIntegerType(lit->literalType))
+                return false;
+
+            bool negative = false;
+            uint64_t magnitude = 0;
+            std::visit([&](auto x)
+                       {
+                using T = decltype(x);
+                if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+                {
+                    if constexpr (std::is_signed_v<T>)
+                    {
+                        negative = x < 0;
+                        magnitude = negative ? uint64_t(0) - static_cast<uint64_t>(static_cast<int64_t>(x)) : static_cast<uint64_t>(x);
+                    }
+                    else
+                        magnitude = x;
+                } }, lit->value);
+
+            if (isFloatType(target))
+            {
+                double v = negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
+                if (target == Type::Float32)
+                    lit->value = static_cast<float>(v);
+                else
+                    lit->value = v;
+                lit->literalType = target;
+                return true;
+            }
+
+            if (!isIntegerType(target))
+                return false;
+
+            if (!fitsInteger(negative, magnitude, target))
+            {
+                std::string text = (negative ? "-" : "") + std::to_string(magnitude);
+                error("Literal " + text + " does not fit in '" + std::string(toString_Type(target)) + "'", lit, text);
+            }
+
+            storeInteger(lit, target, negative, magnitude);
+            lit->literalType = target;
+            return true;
+        }
+
+        const TypeInfo *visitLiteral(LiteralNode *lit)
+        {
+            if (hint && hint->kind == TypeKind::Primitive && adaptLiteral(lit, hint->primitive))
+                return hint;
+            return types.primitive(lit->literalType);
+        }
+
+        const TypeInfo *visitIdentifier(IdentifierNode *id)
+        {
+            return id->symbol->typeInfo;
+        }
+
+        // The hint a binary node passes to its left operand, given its own.
+        const TypeInfo *operandHint(const BinaryExprNode *bin, const TypeInfo *expected)
+        {
+            const std::string &op = bin->op;
+            if (isArithmetic(op))
+                return expected && expected->kind == TypeKind::Primitive && isNumericType(expected->primitive) ? expected : nullptr;
+            if (isOrdering(op) || isEquality(op))
+                return nullptr;
+            if (op == "&&")
+                return types.primitive(Type::Boolean);
+            if (op == "|")
+                return expected;
+            error("Unsupported operator '" + op + "'", bin, op);
+        }
+
+        // Checks the right operand against the already checked left one,
+        // letting a literal side take the other's type.
+        std::pair<const TypeInfo *, const TypeInfo *> checkOperands(BinaryExprNode *bin, const TypeInfo *lt)
+        {
+            const TypeInfo *rt = check(bin->right.get(), lt);
+            if (lt != rt && isAdaptable(bin->left.get()))
+                lt = check(bin->left.get(), rt);
+            if (lt != rt)
+                error("Operand types '" + lt->name + "' and '" + rt->name + "' do not match for '" + bin->op + "'", bin, bin->op);
+            return {lt, rt};
+        }
+
+        // The type of a binary node whose left operand has type lt.
+        const TypeInfo *checkBinary(BinaryExprNode *bin, const TypeInfo *lt)
+        {
+            const std::string &op = bin->op;
+
+            if (isArithmetic(op))
+            {
+                auto [left, rt] = checkOperands(bin, lt);
+                if (op == "+" && left->is(Type::String))
+                    return left;
+                if (left->kind != TypeKind::Primitive || !isNumericType(left->primitive))
+                    error("Operator '" + op + "' requires numeric operands, got '" + left->name + "'", bin, op);
+                if (op == "%" && !isIntegerType(left->primitive))
+                    error("Operator '%' requires integer operands, got '" + left->name + "'", bin, op);
+                return left;
+            }
+
+            if (isOrdering(op))
+            {
+                auto [left, rt] = checkOperands(bin, lt);
+                if (left->kind != TypeKind::Primitive || !(isNumericType(left->primitive) || left->primitive == Type::Byte))
+                    error("Operator '" + op + "' requires numeric operands, got '" + left->name + "'", bin, op);
+                return types.primitive(Type::Boolean);
+            }
+
+            if (isEquality(op))
+            {
+                auto [left, rt] = checkOperands(bin, lt);
+                if (left->is(Type::Void))
+                    error("Cannot compare values of type 'void'", bin, op);
+                return types.primitive(Type::Boolean);
+            }
+
+            if (op == "&&")
+            {
+                const TypeInfo *boolean = types.primitive(Type::Boolean);
+                if (lt != boolean)
+                    error("Cannot use a value of type '" + lt->name + "' as an operand of '&&' of type '" + boolean->name + "'", bin->left.get(),
+                          lt->name);
+                expectType(bin->right.get(), boolean, "an operand of '&&'");
+                return boolean;
+            }
+
+            auto [left, rt] = checkOperands(bin, lt);
+            if (left->kind != TypeKind::Primitive || !(isIntegerType(left->primitive) || left->primitive == Type::Boolean))
+                error("Operator '|' requires integer or boolean operands, got '" + left->name + "'", bin, op);
+            return left;
+        }
+
+        const TypeInfo *visitBinaryExpr(BinaryExprNode *bin)
+        {
+            // Operator chains lean left and are as long as the source makes
+            // them, so the left spine is walked with a loop: hints flow down
+            // it, then types come back up one node at a time.
+            std::vector<BinaryExprNode *> spine;
+            const TypeInfo *expected = hint;
+            ASTNode *node = bin;
+            while (node->type == ASTNodeType::BinaryExpr)
+            {
+                auto *inner = static_cast<BinaryExprNode *>(node);
+                spine.push_back(inner);
+                expected = operandHint(inner, expected);
+                node = inner->left.get();
+            }
+
+            const TypeInfo *t = check(node, expected);
+            for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+            {
+                t = checkBinary(*it, t);
+                (*it)->resolvedType = t;
+            }
+            return t;
+        }
+
+        static bool isVirtual(const FunctionDeclNode *fn)
+        {
+            return fn->modifier == ModifierType::Virtual || fn->modifier == ModifierType::Override;
+        }
+
+        // Picks the overload whose parameters match the arguments. With a
+        // single candidate of the right arity, literals adapt to it.
+        Symbol *selectOverload(CallExprNode *call, Symbol *candidates)
+        {
+            std::vector<Symbol *> viable;
+            for (Symbol *s = candidates; s; s = s->nextOverload)
+                if (static_cast<FunctionDeclNode *>(s->decl)->params.size() == call->args.size())
+                    viable.push_back(s);
+
+            if (viable.empty())
+                error("No overload of '" + call->name + "' takes " + std::to_string(call->args.size()) + " argument(s)", call, call->name);
+
+            if (viable.size() == 1)
+            {
+                auto *fn = static_cast<FunctionDeclNode *>(viable[0]->decl);
+                for (size_t i = 0; i < call->args.size(); ++i)
+                    expectType(call->args[i].get(), types.primitive(fn->params[i].first),
+                               "argument " + std::to_string(i + 1) + " of '" + call->name + "'");
+                return viable[0];
+            }
+
+            std::vector<const TypeInfo *> argTypes;
+            for (auto &arg : call->args)
+                argTypes.push_back(check(arg.get(), nullptr));
+
+            for (Symbol *candidate : viable)
+            {
+                auto *fn = static_cast<FunctionDeclNode *>(candidate->decl);
+                bool matches = true;
+                for (size_t i = 0; i < argTypes.size() && matches; ++i)
+                    matches = argTypes[i] == types.primitive(fn->params[i].first);
+                if (matches)
+                    return candidate;
+            }
+            error("No overload of '" + call->name + "' matches the argument types", call, call->name);
+        }
+
+        // A member-call chain is checked innermost call first by a loop, each
+        // call's type becoming the receiver type of the next.
+        const TypeInfo *visitCallExpr(CallExprNode *call)
+        {
+            std::vector<CallExprNode *> chain{call};
+            while (chain.back()->receiver && chain.back()->receiver->type == ASTNodeType::FunctionCall)
+                chain.push_back(static_cast<CallExprNode *>(chain.back()->receiver.get()));
+
+            const TypeInfo *receiver = check(chain.back()->receiver.get(), nullptr);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            {
+                receiver = checkCall(*it, receiver);
+                (*it)->resolvedType = receiver;
+            }
+            return receiver;
+        }
+
+        const TypeInfo *checkCall(CallExprNode *call, const TypeInfo *receiver)
+        {
+            Symbol *candidates = call->symbol;
+            if (call->receiver)
+            {
+                if (receiver->kind != TypeKind::Class)
+                    error("Cannot call method '" + call->name + "' on a value of type '" + receiver->name + "'", call, call->name);
+
+                InternId id = symbols.names.find(call->name);
+                candidates = id == StringInterner::None ? nullptr : findMember(receiver->classSymbol, id);
+                if (!candidates || candidates->kind != SymbolKind::Method)
+                    error("Class '" + receiver->name + "' has no method '" + call->name + "'", call, call->name);
+            }
+
+            if (candidates->kind == SymbolKind::Class)
+            {
+                if (!call->args.empty())
+                    error("Class '" + call->name + "' has no constructor taking arguments", call, call->name);
+                return candidates->typeInfo;
+            }
+
+            Symbol *callee = selectOverload(call, candidates);
+            auto *fn = static_cast<FunctionDeclNode *>(callee->decl);
+            if (!call->receiver && callee->kind == SymbolKind::Method && !callee->isStatic &&
+                function && function->modifier == ModifierType::Static)
+                error("Cannot call instance method '" + call->name + "' from static function '" + function->name + "'", call, call->name);
+
+            call->symbol = callee;
+            if (callee->kind == SymbolKind::Method && isVirtual(fn))
+                call->dispatch = DispatchKind::Virtual;
+            return types.primitive(fn->returnType);
+        }
+
+        const TypeInfo *visitAssignExpr(AssignExprNode *as)
+        {
+            const TypeInfo *target = as->symbol->typeInfo;
+            expectType(as->value.get(), target, "the new value of '" + as->name + "'");
+            return target;
+        }
+
+        const TypeInfo *visitVarDecl(VarDeclNode *var)
+        {
+            const TypeInfo *declared = types.primitive(var->varType);
+            if (declared->is(Type::Void))
+                error("Variable '" + var->name + "' cannot have type 'void'", var, var->name);
+            if (var->value)
+                expectType(var->value.get(), declared, "the initializer of '" + var->name + "'");
+            return voidType();
+        }
+
+        const TypeInfo *visitReturnExpr(ReturnExprNode *ret)
+        {
+            if (!function)
+                error("'return' outside of a function", ret, "return");
+
+            const TypeInfo *expected = types.primitive(function->returnType);
+            if (expected->is(Type::Void) && ret->expr)
+                error("Function '" + function->name + "' returns void but a value is returned", ret, "return");
+            if (ret->expr)
+                expectType(ret->expr.get(), expected, "the result of '" + function->name + "'");
+            return voidType();
+        }
+
+        const TypeInfo *visitIfExpr(IfExprNode *ifn)
+        {
+            // The arms of an `else if` chain are checked by this loop.
+            for (;;)
+            {
+                expectType(ifn->condition.get(), types.primitive(Type::Boolean), "an if condition");
+                check(ifn->thenBranch.get(), nullptr);
+                ASTNode *next = ifn->elseBranch.get();
+                if (!next || next->type != ASTNodeType::IfExpr)
+                {
+                    check(next, nullptr);
+                    return voidType();
+                }
+                ifn = static_cast<IfExprNode *>(next);
+                ifn->resolvedType = voidType();
+            }
+        }
+
+        const TypeInfo *visitForExpr(ForExprNode *loop)
+        {
+            check(loop->init.get(), nullptr);
+            if (loop->condition)
+                expectType(loop->condition.get(), types.primitive(Type::Boolean), "a for condition");
+            check(loop->step.get(), nullptr);
+            check(loop->body.get(), nullptr);
+            return voidType();
+        }
+
+        const TypeInfo *visitMatchExpr(MatchExprNode *match)
+        {
+            const TypeInfo *subject = check(match->subject.get(), nullptr);
+            if (subject->kind != TypeKind::Primitive ||
+                !(isIntegerType(subject->primitive) || subject->is(Type::Byte) || subject->is(Type::String)))
+                error("Cannot match on a value of type '" + subject->name + "'", match->subject.get(), subject->name);
+
+            // Patterns take the subject's type, so equal values compare equal.
+            std::set<LiteralValue> seen;
+            for (auto &arm : match->arms)
+            {
+                for (auto &pattern : arm.patterns)
+                {
+                    expectType(pattern.get(), subject, "a match pattern");
+                    if (!seen.insert(static_cast<LiteralNode *>(pattern.get())->value).second)
+                        error("Pattern is already matched by an earlier arm", pattern.get(), subject->name);
+                }
+                check(arm.body.get(), nullptr);
+            }
+            check(match->otherwise.get(), nullptr);
+            return voidType();
+        }
+
+        const TypeInfo *visitBlock(BlockNode *blk)
+        {
+            for (auto &child : blk->children)
+                check(child.get(), nullptr);
+            return voidType();
+        }
+
+        const TypeInfo *visitFunctionDecl(FunctionDeclNode *fn)
+        {
+            const FunctionDeclNode *saved = function;
+            function = fn;
+            check(fn->body.get(), nullptr);
+            function = saved;
+            return voidType();
+        }
+
+        const TypeInfo *visitClassDecl(ClassDeclNode *cls)
+        {
+            check(cls->body.get(), nullptr);
+            return voidType();
+        }
+
+        const TypeInfo *visitSharedExpr(SharedExprNode *shared)
+        {
+            return shared->target->resolvedType;
+        }
+
+        const TypeInfo *visitUnknown(ASTNode *)
+        {
+            return voidType();
+        }
+    };
+}
+
+void checkTypes(ASTNode *root, SymbolTable &symbols, TypeInterner &types, const std::string &source)
+{
+    TypeChecker checker(symbols, types, source);
+    checker.assignSymbolTypes();
+    checker.check(root, nullptr);
+}
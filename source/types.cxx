@@ -0,0 +1,164 @@
+#include <types.hxx>
+#include <string.hxx>
+
+TypeInterner::TypeInterner()
+{
+    for (Type t : {Type::Void, Type::Boolean, Type::Byte, Type::String,
+                   Type::Int8, Type::Int16, Type::Int32, Type::Int64,
+                   Type::Uint8, Type::Uint16, Type::Uint32, Type::Uint64,
+                   Type::Float32, Type::Float64})
+    {
+        TypeInfo *info = make(TypeKind::Primitive, std::string(toString_Type(t)));
+        info->primitive = t;
+        if (primitives.size() <= static_cast<size_t>(t))
+            primitives.resize(static_cast<size_t>(t) + 1);
+        primitives[static_cast<size_t>(t)] = info;
+    }
+}
+
+TypeInfo *TypeInterner::make(TypeKind kind, std::string name)
+{
+    TypeInfo info;
+    info.id = static_cast<uint32_t>(types.size());
+    info.kind = kind;
+    info.name = std::move(name);
+    types.push_back(std::move(info));
+    return &types.back();
+}
+
+const TypeInfo *TypeInterner::classType(const Symbol *cls, std::string_view name)
+{
+    auto it = classes.find(cls);
+    if (it != classes.end())
+        return it->second;
+    TypeInfo *info = make(TypeKind::Class, std::string(name));
+    info->classSymbol = cls;
+    classes.emplace(cls, info);
+    return info;
+}
+
+const TypeInfo *TypeInterner::arrayOf(const TypeInfo *element)
+{
+    auto it = arrays.find(element);
+    if (it != arrays.end())
+        return it->second;
+    TypeInfo *info = make(TypeKind::Array, element->name + "[]");
+    info->element = element;
+    arrays.emplace(element, info);
+    return info;
+}
+
+const TypeInfo *TypeInterner::function(const TypeInfo *result, const std::vector<const TypeInfo *> &params)
+{
+    std::vector<uint32_t> key;
+    key.reserve(params.size() + 1);
+    key.push_back(result->id);
+    for (const TypeInfo *p : params)
+        key.push_back(p->id);
+
+    auto it = functions.find(key);
+    if (it != functions.end())
+        return it->second;
+
+    std::string name = "(";
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        if (i)
+            name += ", ";
+        name += params[i]->name;
+    }
+    name += ") " + result->name;
+
+    TypeInfo *info = make(TypeKind::Function, std::move(name));
+    info->element = result;
+    info->params = params;
+    functions.emplace(std::move(key), info);
+    return info;
+}
+
+bool isIntegerType(Type t)
+{
+    switch (t)
+    {
+    case Type::Int8:
+    case Type::Int16:
+    case Type::Int32:
+    case Type::Int64:
+    case Type::Uint8:
+    case Type::Uint16:
+    case Type::Uint32:
+    case Type::Uint64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isSignedType(Type t)
+{
+    return t == Type::Int8 || t == Type::Int16 || t == Type::Int32 || t == Type::Int64;
+}
+
+bool isFloatType(Type t)
+{
+    return t == Type::Float32 || t == Type::Float64;
+}
+
+bool isNumericType(Type t)
+{
+    return isIntegerType(t) || isFloatType(t);
+}
+
+unsigned bitWidth(Type t)
+{
+    switch (t)
+    {
+    case Type::Boolean:
+    case Type::Byte:
+    case Type::Int8:
+    case Type::Uint8:
+        return 8;
+    case Type::Int16:
+    case Type::Uint16:
+        return 16;
+    case Type::Int32:
+    case Type::Uint32:
+    case Type::Float32:
+        return 32;
+    case Type::Int64:
+    case Type::Uint64:
+    case Type::Float64:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+size_t sizeOf(const TypeInfo *type)
+{
+    switch (type->kind)
+    {
+    case TypeKind::Primitive:
+        if (type->primitive == Type::Void)
+            return 0;
+        if (type->primitive == Type::String)
+            return 16; // data pointer and length
+        return bitWidth(type->primitive) / 8;
+    case TypeKind::Array:
+        return 16;
+    case TypeKind::Class:
+    case TypeKind::Function:
+        return 8;
+    }
+    return 0;
+}
+
+size_t alignOf(const TypeInfo *type)
+{
+    if (type->kind == TypeKind::Primitive && type->primitive == Type::String)
+        return 8;
+    if (type->kind == TypeKind::Array)
+        return 8;
+    size_t size = sizeOf(type);
+    return size ? size : 1;
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vm.hxx>
+
+namespace
+{
+    double toDouble(uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t fromDouble(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t fromFloat(float value)
+    {
+        return fromDouble(static_cast<double>(value));
+    }
+
+    float toFloat(uint64_t bits)
+    {
+        return static_cast<float>(toDouble(bits));
+    }
+
+    const std::string &str(uint64_t value)
+    {
+        return *reinterpret_cast<const std::string *>(static_cast<uintptr_t>(value));
+    }
+
+    uint64_t fromPointer(const void *pointer)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+    }
+
+    uint8_t *field(uint64_t object, uint32_t offset)
+    {
+        return reinterpret_cast<uint8_t *>(static_cast<uintptr_t>(object)) + offset;
+    }
+
+    template <typename T>
+    T load(uint64_t object, uint32_t offset)
+    {
+        T value;
+        std::memcpy(&value, field(object, offset), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void store(uint64_t object, uint32_t offset, T value)
+    {
+        std::memcpy(field(object, offset), &value, sizeof(T));
+    }
+
+    uint64_t normalize(NormKind kind, uint64_t value)
+    {
+        switch (kind)
+        {
+        case NormKind::Bool: return value != 0;
+        case NormKind::I8: return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(value)));
+        case NormKind::U8: return static_cast<uint8_t>(value);
+        case NormKind::I16: return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(value)));
+        case NormKind::U16: return static_cast<uint16_t>(value);
+        case NormKind::I32: return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(value)));
+        case NormKind::U32: return static_cast<uint32_t>(value);
+        }
+        return value;
+    }
+
+    uint64_t signExtend32(uint64_t value)
+    {
+        return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(value)));
+    }
+}
+
+VM::VM(const BytecodeProgram &program, size_t stackSlots)
+    : program(program), stack(new uint64_t[stackSlots]), stackEnd(stack.get() + stackSlots), ownGlobals(program.globals),
+      counters(program.functions.size(), 0), natives(new std::atomic<NativeEntry>[program.functions.size()]),
+      osr(new std::atomic<const std::vector<OsrEntry> *>[program.functions.size()])
+{
+    for (size_t i = 0; i < ownGlobals.size(); ++i)
+        if (program.stringGlobals[i])
+            ownGlobals[i] = fromPointer(&program.strings[ownGlobals[i]]);
+    globals = ownGlobals.data();
+    for (size_t i = 0; i < program.functions.size(); ++i)
+    {
+        natives[i].store(nullptr, std::memory_order_relaxed);
+        osr[i].store(nullptr, std::memory_order_relaxed);
+    }
+    frames.reserve(256);
+}
+
+void VM::setHotHook(uint32_t threshold, std::function<void(uint32_t)> hook)
+{
+    hotThreshold = threshold;
+    onHot = std::move(hook);
+}
+
+void VM::useGlobals(uint64_t *slots)
+{
+    std::copy(globals, globals + program.globals.size(), slots);
+    globals = slots;
+}
+
+uint64_t VM::callNative(NativeEntry entry, const uint64_t *args)
+{
+    if (!timeNative)
+        return nativeCall ? nativeCall(entry, args) : entry(args);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t result = nativeCall ? nativeCall(entry, args) : entry(args);
+    nativeNanos += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    return result;
+}
+
+uint64_t VM::enterOsr(const OsrEntry &entry, const uint64_t *registers)
+{
+    std::vector<uint64_t> args(entry.registers.size());
+    for (size_t i = 0; i < args.size(); ++i)
+        args[i] = registers[entry.registers[i]];
+    ++osrCount;
+    return callNative(entry.entry, args.data());
+}
+
+void VM::fail(uint32_t function, const std::string &message) const
+{
+    throw VMError("Runtime error in " + program.functions[function].name + ": " + message);
+}
+
+uint64_t VM::allocate(uint32_t cls)
+{
+    size_t words = std::max<size_t>(1, (program.classes[cls].size + 7) / 8);
+    objects.emplace_back(new uint64_t[words]);
+    return construct(cls, objects.back().get());
+}
+
+uint64_t VM::construct(uint32_t cls, uint64_t *memory)
+{
+    const BytecodeClass &info = program.classes[cls];
+    std::fill(memory, memory + std::max<size_t>(1, (info.size + 7) / 8), 0);
+    uint64_t object = fromPointer(memory);
+    if (info.hasVptr)
+        store<const uint32_t *>(object, info.vptrOffset, info.vtable.data());
+    return object;
+}
+
+uint64_t VM::call(uint32_t function, const std::vector<uint64_t> &args)
+{
+    const BytecodeFunction &fn = program.functions[function];
+    if (args.size() != fn.params)
+        throw VMError("Function " + fn.name + " takes " + std::to_string(fn.params) + " arguments");
+
+    // Calls from outside start at the bottom of the arena; they do not nest.
+    uint64_t *base = stack.get();
+    if (base + fn.frameSize > stackEnd)
+        fail(function, "Stack overflow");
+    std::copy(args.begin(), args.end(), base);
+    frames.clear();
+    return execute(function, base);
+}
+
+int VM::run()
+{
+    call(program.initializer);
+    if (program.entry < 0)
+        throw VMError("No main function to run");
+    uint64_t result = call(static_cast<uint32_t>(program.entry));
+    return program.functions[program.entry].returnsValue ? static_cast<int>(result) : 0;
+}
+
+uint64_t VM::execute(uint32_t function, uint64_t *base)
+{
+#if VSHARP_VM_THREADED
+    if (dispatch == Dispatch::Threaded)
+        return executeThreaded(function, base);
+#endif
+    return executeSwitch(function, base);
+}
+
+// The interpreter loop is written once and expanded twice: with a handler
+// table and computed goto, where every handler ends in its own indirect
+// jump that the branch predictor can learn separately, and as a plain
+// switch for compilers without labels as values.
+
+#if VSHARP_VM_THREADED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define VM_LOOP executeThreaded
+#define VM_THREADED_LOOP 1
+#include "vmloop.inc"
+#undef VM_LOOP
+#undef VM_THREADED_LOOP
+#pragma GCC diagnostic pop
+#endif
+
+#define VM_LOOP executeSwitch
+#define VM_THREADED_LOOP 0
+#include "vmloop.inc"
+#undef VM_LOOP
+#undef VM_THREADED_LOOP
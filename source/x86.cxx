@@ -0,0 +1,935 @@
+#include <cstring>
+#include <x86.hxx>
+
+namespace
+{
+    uint8_t index(Reg reg)
+    {
+        return static_cast<uint8_t>(reg);
+    }
+
+    bool fitsInt8(int64_t value)
+    {
+        return value >= INT8_MIN && value <= INT8_MAX;
+    }
+
+    bool fitsInt32(int64_t value)
+    {
+        return value >= INT32_MIN && value <= INT32_MAX;
+    }
+
+    // SPL, BPL, SIL and DIL are only addressable with a REX prefix.
+    bool needsRexForByte(Reg reg)
+    {
+        return index(reg) >= 4 && index(reg) < 8;
+    }
+
+    using Window = std::vector<MachineInstr>;
+
+    /** @brief What a peephole rule does besides changing the new instruction */
+    struct Rewrite
+    {
+        size_t drop = 0;                  /**< Instructions deleted from the end of the window */
+        std::vector<MachineInstr> insert; /**< Emitted in their place, before the new instruction */
+        bool keep = true;                 /**< Whether the new instruction is still emitted */
+    };
+
+    struct PeepholeRule
+    {
+        const char *name;
+        bool (*apply)(const Window &window, MachineInstr &next, Rewrite &rewrite);
+    };
+
+    bool writes(const MachineInstr &instr, Reg reg)
+    {
+        switch (instr.op)
+        {
+        case MachineOp::Mov:
+        case MachineOp::MovImm:
+        case MachineOp::Load:
+        case MachineOp::Lea:
+        case MachineOp::Setcc:
+            return instr.dst == reg;
+        case MachineOp::Alu:
+        case MachineOp::AluImm:
+            return instr.dst == reg && instr.alu != AluOp::Cmp;
+        default:
+            return false;
+        }
+    }
+
+    bool keepsFlags(const MachineInstr &instr)
+    {
+        switch (instr.op)
+        {
+        case MachineOp::Mov:
+        case MachineOp::Load:
+        case MachineOp::Store:
+        case MachineOp::Lea:
+        case MachineOp::Setcc:
+            return true;
+        case MachineOp::MovImm:
+            return instr.imm != 0;
+        default:
+            return false;
+        }
+    }
+
+    bool reads(const Mem &mem, Reg reg)
+    {
+        return mem.base == reg || mem.index == reg;
+    }
+
+    // The instruction whose flags are still set when the test ending the
+    // window runs, if it also computed the register tested, possibly
+    // copied through moves since.
+    const MachineInstr *flagSource(const Window &window)
+    {
+        Reg value = window.back().dst;
+        for (size_t i = window.size() - 1; i-- > 0;)
+        {
+            const MachineInstr &instr = window[i];
+            if (writes(instr, value))
+            {
+                if (instr.op == MachineOp::Mov)
+                {
+                    value = instr.src;
+                    continue;
+                }
+                return instr.op == MachineOp::Alu || instr.op == MachineOp::AluImm || instr.op == MachineOp::Setcc ? &instr : nullptr;
+            }
+            if (!keepsFlags(instr))
+                return nullptr;
+        }
+        return nullptr;
+    }
+
+    bool isSelfTest(const Window &window)
+    {
+        return !window.empty() && window.back().op == MachineOp::Test && window.back().dst == window.back().src;
+    }
+
+    /** @brief The rewrites, tried in order on every instruction emitted */
+    const PeepholeRule Rules[] = {
+        // mov r, r
+        {"mov-self", [](const Window &, MachineInstr &next, Rewrite &rewrite)
+         {
+             rewrite.keep = !(next.op == MachineOp::Mov && next.dst == next.src);
+             return !rewrite.keep;
+         }},
+        // mov a, b; mov b, a
+        {"mov-back", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (window.empty() || next.op != MachineOp::Mov)
+                 return false;
+             const MachineInstr &last = window.back();
+             rewrite.keep = !(last.op == MachineOp::Mov && last.dst == next.src && last.src == next.dst);
+             return !rewrite.keep;
+         }},
+        // The same move, load, store or lea twice in a row, where the first
+        // does not change what the second reads.
+        {"repeat", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (window.empty() || window.back().op != next.op)
+                 return false;
+             const MachineInstr &last = window.back();
+             bool same = false;
+             switch (next.op)
+             {
+             case MachineOp::Mov:
+                 same = last.dst == next.dst && last.src == next.src;
+                 break;
+             case MachineOp::MovImm:
+                 same = last.dst == next.dst && last.imm == next.imm;
+                 break;
+             case MachineOp::Load:
+             case MachineOp::Lea:
+                 same = last.dst == next.dst && last.mem == next.mem && last.width == next.width && last.sign == next.sign && !reads(next.mem, next.dst);
+                 break;
+             case MachineOp::Store:
+                 same = last.src == next.src && last.mem == next.mem && last.width == next.width;
+                 break;
+             default:
+                 break;
+             }
+             rewrite.keep = !same;
+             return same;
+         }},
+        // store [m], a; load b, [m] becomes mov b, a
+        {"store-load", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (window.empty() || next.op != MachineOp::Load || next.width != 8)
+                 return false;
+             const MachineInstr &last = window.back();
+             if (last.op != MachineOp::Store || last.width != 8 || !(last.mem == next.mem))
+                 return false;
+             if (next.dst == last.src)
+                 rewrite.keep = false;
+             else
+                 next = {MachineOp::Mov, next.dst, last.src};
+             return true;
+         }},
+        // load a, [m]; store [m], a
+        {"load-store", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (window.empty() || next.op != MachineOp::Store || next.width != 8)
+                 return false;
+             const MachineInstr &last = window.back();
+             rewrite.keep = !(last.op == MachineOp::Load && last.width == 8 && last.mem == next.mem && last.dst == next.src && !reads(next.mem, next.src));
+             return !rewrite.keep;
+         }},
+        // store [m], a; store [m], b
+        {"dead-store", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (window.empty() || next.op != MachineOp::Store)
+                 return false;
+             const MachineInstr &last = window.back();
+             rewrite.drop = last.op == MachineOp::Store && last.mem == next.mem && last.width == next.width;
+             return rewrite.drop != 0;
+         }},
+        // cmp r, 0 is test r, r, which is shorter
+        {"cmp-zero", [](const Window &, MachineInstr &next, Rewrite &)
+         {
+             if (next.op != MachineOp::AluImm || next.alu != AluOp::Cmp || next.imm != 0)
+                 return false;
+             next = {MachineOp::Test, next.dst, next.dst};
+             return true;
+         }},
+        // add r, x; mov s, r; test s, s; jne: the add set the zero and sign flags already
+        {"redundant-test", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (next.op != MachineOp::Jcc || !isSelfTest(window))
+                 return false;
+             if (next.cond != Cond::E && next.cond != Cond::NE && next.cond != Cond::S && next.cond != Cond::NS)
+                 return false;
+             const MachineInstr *source = flagSource(window);
+             rewrite.drop = source && source->op != MachineOp::Setcc;
+             return rewrite.drop != 0;
+         }},
+        // setcc c, r; test r, r; jne L becomes jc L, keeping r
+        {"setcc-branch", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (next.op != MachineOp::Jcc || (next.cond != Cond::E && next.cond != Cond::NE) || !isSelfTest(window))
+                 return false;
+             const MachineInstr *source = flagSource(window);
+             if (!source || source->op != MachineOp::Setcc)
+                 return false;
+             next.cond = next.cond == Cond::NE ? source->cond : invert(source->cond);
+             rewrite.drop = 1;
+             return true;
+         }},
+        // jmp L; L:
+        {"jump-next", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (next.op != MachineOp::Bind || window.empty())
+                 return false;
+             rewrite.drop = window.back().op == MachineOp::Jmp && window.back().label == next.label;
+             return rewrite.drop != 0;
+         }},
+        // jcc L; jmp M; L: becomes jncc M
+        {"branch-over-jump", [](const Window &window, MachineInstr &next, Rewrite &rewrite)
+         {
+             if (next.op != MachineOp::Bind || window.size() < 2)
+                 return false;
+             const MachineInstr &branch = window[window.size() - 2], &jump = window.back();
+             if (branch.op != MachineOp::Jcc || branch.label != next.label || jump.op != MachineOp::Jmp || jump.label == next.label)
+                 return false;
+             MachineInstr inverted{MachineOp::Jcc};
+             inverted.cond = invert(branch.cond);
+             inverted.label = jump.label;
+             rewrite.drop = 2;
+             rewrite.insert.push_back(inverted);
+             return true;
+         }},
+    };
+
+    constexpr size_t WindowSize = 6;
+}
+
+void Assembler::dword(uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        byte(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void Assembler::qword(uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        byte(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void Assembler::rex(bool wide, uint8_t reg, uint8_t rm, bool byteRegs)
+{
+    uint8_t prefix = static_cast<uint8_t>(0x40 | wide << 3 | (reg >> 3 & 1) << 2 | (rm >> 3 & 1));
+    if (prefix != 0x40 || byteRegs)
+        byte(prefix);
+}
+
+void Assembler::rex(bool wide, uint8_t reg, Mem mem, bool byteRegs)
+{
+    uint8_t prefix = static_cast<uint8_t>(0x40 | wide << 3 | (reg >> 3 & 1) << 2 | (index(mem.index) >> 3 & 1) << 1 | (index(mem.base) >> 3 & 1));
+    if (prefix != 0x40 || byteRegs)
+        byte(prefix);
+}
+
+void Assembler::modrm(uint8_t reg, Mem mem)
+{
+    uint8_t base = index(mem.base) & 7;
+    bool indexed = mem.index != Reg::RSP;
+    uint8_t mod = mem.disp == 0 && base != 5 ? 0 : fitsInt8(mem.disp) ? 1 : 2;
+    byte(static_cast<uint8_t>(mod << 6 | (reg & 7) << 3 | (indexed ? 4 : base)));
+    if (indexed)
+        byte(static_cast<uint8_t>(mem.scale << 6 | (index(mem.index) & 7) << 3 | base));
+    else if (base == 4)
+        byte(0x24);
+    if (mod == 1)
+        byte(static_cast<uint8_t>(mem.disp));
+    else if (mod == 2)
+        dword(static_cast<uint32_t>(mem.disp));
+}
+
+size_t Assembler::rip(uint8_t reg)
+{
+    byte(static_cast<uint8_t>((reg & 7) << 3 | 5));
+    size_t at = size();
+    dword(0);
+    return at;
+}
+
+Assembler::Label Assembler::newLabel()
+{
+    labels.push_back(-1);
+    pending.push_back(-1);
+    return static_cast<Label>(labels.size() - 1);
+}
+
+void Assembler::emit(MachineInstr instr)
+{
+    if (size() != windowEnd)
+        window.clear();
+    for (bool again = peephole; again;)
+    {
+        again = false;
+        for (const auto &rule : Rules)
+        {
+            Rewrite rewrite;
+            if (!rule.apply(window, instr, rewrite))
+                continue;
+            for (size_t i = 0; i < rewrite.drop; ++i)
+                drop();
+            for (auto &extra : rewrite.insert)
+                encode(extra);
+            if (!rewrite.keep)
+                return;
+            again = true;
+            break;
+        }
+    }
+    encode(instr);
+}
+
+void Assembler::encode(MachineInstr &instr)
+{
+    instr.start = size();
+    switch (instr.op)
+    {
+    case MachineOp::Bind:
+    {
+        Label label = instr.label;
+        labels[label] = static_cast<int64_t>(size());
+        for (int64_t at = pending[label]; at >= 0;)
+        {
+            int32_t next;
+            std::memcpy(&next, &bytes[at], 4);
+            int32_t rel = static_cast<int32_t>(labels[label] - (at + 4));
+            std::memcpy(&bytes[at], &rel, 4);
+            at = next;
+        }
+        pending[label] = -1;
+        // Code after a label also runs after the jumps to it.
+        window.clear();
+        windowEnd = size();
+        return;
+    }
+    case MachineOp::Jmp:
+        byte(0xe9);
+        branch(instr.label);
+        break;
+    case MachineOp::Jcc:
+        byte(0x0f);
+        byte(static_cast<uint8_t>(0x80 + static_cast<uint8_t>(instr.cond)));
+        branch(instr.label);
+        break;
+    case MachineOp::Mov:
+        rex(true, index(instr.src), index(instr.dst));
+        byte(0x89);
+        modrm(index(instr.src), index(instr.dst));
+        break;
+    case MachineOp::MovImm:
+    {
+        uint8_t dst = index(instr.dst);
+        if (instr.imm == 0)
+        {
+            rex(false, dst, dst);
+            byte(0x31);
+            modrm(dst, dst);
+        }
+        else if (instr.imm > 0 && instr.imm <= UINT32_MAX)
+        {
+            rex(false, 0, dst);
+            byte(static_cast<uint8_t>(0xb8 + (dst & 7)));
+            dword(static_cast<uint32_t>(instr.imm));
+        }
+        else if (fitsInt32(instr.imm))
+        {
+            rex(true, 0, dst);
+            byte(0xc7);
+            modrm(0, dst);
+            dword(static_cast<uint32_t>(instr.imm));
+        }
+        else
+        {
+            rex(true, 0, dst);
+            byte(static_cast<uint8_t>(0xb8 + (dst & 7)));
+            qword(static_cast<uint64_t>(instr.imm));
+        }
+        break;
+    }
+    case MachineOp::Load:
+        switch (instr.width)
+        {
+        case 1:
+        case 2:
+            rex(true, index(instr.dst), instr.mem);
+            byte(0x0f);
+            byte(instr.width == 1 ? (instr.sign ? 0xbe : 0xb6) : (instr.sign ? 0xbf : 0xb7));
+            break;
+        case 4:
+            rex(instr.sign, index(instr.dst), instr.mem);
+            byte(instr.sign ? 0x63 : 0x8b);
+            break;
+        default:
+            rex(true, index(instr.dst), instr.mem);
+            byte(0x8b);
+            break;
+        }
+        modrm(index(instr.dst), instr.mem);
+        break;
+    case MachineOp::Store:
+        if (instr.width == 2)
+            byte(0x66);
+        rex(instr.width == 8, index(instr.src), instr.mem, instr.width == 1 && needsRexForByte(instr.src));
+        byte(instr.width == 1 ? 0x88 : 0x89);
+        modrm(index(instr.src), instr.mem);
+        break;
+    case MachineOp::Lea:
+        rex(true, index(instr.dst), instr.mem);
+        byte(0x8d);
+        modrm(index(instr.dst), instr.mem);
+        break;
+    case MachineOp::Alu:
+        rex(true, index(instr.src), index(instr.dst));
+        byte(static_cast<uint8_t>(static_cast<uint8_t>(instr.alu) << 3 | 1));
+        modrm(index(instr.src), index(instr.dst));
+        break;
+    case MachineOp::AluImm:
+        rex(true, 0, index(instr.dst));
+        if (fitsInt8(instr.imm))
+        {
+            byte(0x83);
+            modrm(static_cast<uint8_t>(instr.alu), index(instr.dst));
+            byte(static_cast<uint8_t>(instr.imm));
+        }
+        else
+        {
+            byte(0x81);
+            modrm(static_cast<uint8_t>(instr.alu), index(instr.dst));
+            dword(static_cast<uint32_t>(instr.imm));
+        }
+        break;
+    case MachineOp::Test:
+        rex(true, index(instr.src), index(instr.dst));
+        byte(0x85);
+        modrm(index(instr.src), index(instr.dst));
+        break;
+    case MachineOp::Setcc:
+        rex(false, 0, index(instr.dst), needsRexForByte(instr.dst));
+        byte(0x0f);
+        byte(static_cast<uint8_t>(0x90 + static_cast<uint8_t>(instr.cond)));
+        modrm(0, index(instr.dst));
+        extend(instr.dst, 8, false);
+        break;
+    }
+    ++instructions;
+    window.push_back(instr);
+    if (window.size() > WindowSize)
+        window.erase(window.begin());
+    windowEnd = size();
+}
+
+void Assembler::drop()
+{
+    const MachineInstr &last = window.back();
+    // A jump to an unbound label heads that label's chain of waiting fields.
+    if ((last.op == MachineOp::Jmp || last.op == MachineOp::Jcc) && labels[last.label] < 0)
+    {
+        int32_t previous;
+        std::memcpy(&previous, &bytes[size() - 4], 4);
+        pending[last.label] = previous;
+    }
+    instructions -= last.op == MachineOp::Setcc ? 2 : 1;
+    bytes.resize(last.start);
+    window.pop_back();
+    windowEnd = size();
+}
+
+void Assembler::bind(Label label)
+{
+    MachineInstr instr{MachineOp::Bind};
+    instr.label = label;
+    emit(instr);
+}
+
+void Assembler::branch(Label label)
+{
+    if (labels[label] >= 0)
+    {
+        dword(static_cast<uint32_t>(labels[label] - static_cast<int64_t>(size() + 4)));
+        return;
+    }
+    int64_t previous = pending[label];
+    pending[label] = static_cast<int64_t>(size());
+    dword(static_cast<uint32_t>(static_cast<int32_t>(previous)));
+}
+
+void Assembler::jmp(Label label)
+{
+    MachineInstr instr{MachineOp::Jmp};
+    instr.label = label;
+    emit(instr);
+}
+
+void Assembler::jcc(Cond cond, Label label)
+{
+    MachineInstr instr{MachineOp::Jcc};
+    instr.cond = cond;
+    instr.label = label;
+    emit(instr);
+}
+
+void Assembler::mov(Reg dst, Reg src)
+{
+    emit({MachineOp::Mov, dst, src});
+}
+
+void Assembler::movImm(Reg dst, int64_t imm)
+{
+    MachineInstr instr{MachineOp::MovImm, dst};
+    instr.imm = imm;
+    emit(instr);
+}
+
+void Assembler::load(Reg dst, Mem src, unsigned width, bool sign)
+{
+    MachineInstr instr{MachineOp::Load, dst};
+    instr.mem = src;
+    instr.width = width;
+    instr.sign = sign;
+    emit(instr);
+}
+
+void Assembler::store(Mem dst, Reg src, unsigned width)
+{
+    MachineInstr instr{MachineOp::Store, Reg::RAX, src};
+    instr.mem = dst;
+    instr.width = width;
+    emit(instr);
+}
+
+void Assembler::extend(Reg reg, unsigned bits, bool sign)
+{
+    if (bits < 64)
+        ++instructions;
+    uint8_t r = index(reg);
+    switch (bits)
+    {
+    case 8:
+        rex(sign, r, r, needsRexForByte(reg));
+        byte(0x0f);
+        byte(sign ? 0xbe : 0xb6);
+        break;
+    case 16:
+        rex(sign, r, r);
+        byte(0x0f);
+        byte(sign ? 0xbf : 0xb7);
+        break;
+    case 32:
+        // movsxd, or a 32-bit mov that clears the upper half.
+        rex(sign, r, r);
+        byte(sign ? 0x63 : 0x89);
+        break;
+    default:
+        return;
+    }
+    modrm(r, r);
+}
+
+void Assembler::lea(Reg dst, Mem src)
+{
+    MachineInstr instr{MachineOp::Lea, dst};
+    instr.mem = src;
+    emit(instr);
+}
+
+void Assembler::alu(AluOp op, Reg dst, Reg src)
+{
+    MachineInstr instr{MachineOp::Alu, dst, src};
+    instr.alu = op;
+    emit(instr);
+}
+
+void Assembler::alu(AluOp op, Reg dst, int32_t imm)
+{
+    MachineInstr instr{MachineOp::AluImm, dst};
+    instr.alu = op;
+    instr.imm = imm;
+    emit(instr);
+}
+
+void Assembler::imul(Reg dst, Reg src)
+{
+    ++instructions;
+    rex(true, index(dst), index(src));
+    byte(0x0f);
+    byte(0xaf);
+    modrm(index(dst), index(src));
+}
+
+void Assembler::imul(Reg dst, Reg src, int32_t imm)
+{
+    ++instructions;
+    rex(true, index(dst), index(src));
+    byte(fitsInt8(imm) ? 0x6b : 0x69);
+    modrm(index(dst), index(src));
+    if (fitsInt8(imm))
+        byte(static_cast<uint8_t>(imm));
+    else
+        dword(static_cast<uint32_t>(imm));
+}
+
+void Assembler::test(Reg a, Reg b)
+{
+    emit({MachineOp::Test, a, b});
+}
+
+void Assembler::neg(Reg reg)
+{
+    ++instructions;
+    rex(true, 0, index(reg));
+    byte(0xf7);
+    modrm(3, index(reg));
+}
+
+void Assembler::shift(ShiftOp op, Reg reg, uint8_t bits)
+{
+    ++instructions;
+    rex(true, 0, index(reg));
+    byte(bits == 1 ? 0xd1 : 0xc1);
+    modrm(static_cast<uint8_t>(op), index(reg));
+    if (bits != 1)
+        byte(bits);
+}
+
+void Assembler::shift(ShiftOp op, Reg reg)
+{
+    ++instructions;
+    rex(true, 0, index(reg));
+    byte(0xd3);
+    modrm(static_cast<uint8_t>(op), index(reg));
+}
+
+void Assembler::mul(Reg src)
+{
+    ++instructions;
+    rex(true, 0, index(src));
+    byte(0xf7);
+    modrm(4, index(src));
+}
+
+void Assembler::imul(Reg src)
+{
+    ++instructions;
+    rex(true, 0, index(src));
+    byte(0xf7);
+    modrm(5, index(src));
+}
+
+void Assembler::cqo()
+{
+    ++instructions;
+    byte(0x48);
+    byte(0x99);
+}
+
+void Assembler::idiv(Reg divisor)
+{
+    ++instructions;
+    rex(true, 0, index(divisor));
+    byte(0xf7);
+    modrm(7, index(divisor));
+}
+
+void Assembler::div(Reg divisor)
+{
+    ++instructions;
+    rex(true, 0, index(divisor));
+    byte(0xf7);
+    modrm(6, index(divisor));
+}
+
+void Assembler::setcc(Cond cond, Reg reg)
+{
+    MachineInstr instr{MachineOp::Setcc, reg};
+    instr.cond = cond;
+    emit(instr);
+}
+
+void Assembler::push(Reg reg)
+{
+    ++instructions;
+    rex(false, 0, index(reg));
+    byte(static_cast<uint8_t>(0x50 + (index(reg) & 7)));
+}
+
+void Assembler::pop(Reg reg)
+{
+    ++instructions;
+    rex(false, 0, index(reg));
+    byte(static_cast<uint8_t>(0x58 + (index(reg) & 7)));
+}
+
+void Assembler::leave()
+{
+    ++instructions;
+    byte(0xc9);
+}
+
+void Assembler::ret()
+{
+    ++instructions;
+    byte(0xc3);
+}
+
+void Assembler::int3()
+{
+    ++instructions;
+    byte(0xcc);
+}
+
+void Assembler::call(Reg target)
+{
+    ++instructions;
+    rex(false, 0, index(target));
+    byte(0xff);
+    modrm(2, index(target));
+}
+
+void Assembler::jmp(Reg target)
+{
+    ++instructions;
+    rex(false, 0, index(target));
+    byte(0xff);
+    modrm(4, index(target));
+}
+
+size_t Assembler::jmpRip()
+{
+    ++instructions;
+    byte(0xff);
+    return rip(4);
+}
+
+size_t Assembler::call()
+{
+    ++instructions;
+    byte(0xe8);
+    size_t at = size();
+    dword(0);
+    return at;
+}
+
+size_t Assembler::leaRip(Reg dst)
+{
+    ++instructions;
+    rex(true, index(dst), 0);
+    byte(0x8d);
+    return rip(index(dst));
+}
+
+size_t Assembler::loadRip(Reg dst)
+{
+    ++instructions;
+    rex(true, index(dst), 0);
+    byte(0x8b);
+    return rip(index(dst));
+}
+
+size_t Assembler::storeRip(Reg src)
+{
+    ++instructions;
+    rex(true, index(src), 0);
+    byte(0x89);
+    return rip(index(src));
+}
+
+void Assembler::movq(Xmm dst, Reg src)
+{
+    ++instructions;
+    byte(0x66);
+    rex(true, dst, index(src));
+    byte(0x0f);
+    byte(0x6e);
+    modrm(dst, index(src));
+}
+
+void Assembler::movq(Reg dst, Xmm src)
+{
+    ++instructions;
+    byte(0x66);
+    rex(true, src, index(dst));
+    byte(0x0f);
+    byte(0x7e);
+    modrm(src, index(dst));
+}
+
+void Assembler::sse(SseOp op, Xmm dst, Xmm src)
+{
+    ++instructions;
+    static const uint8_t prefixes[] = {0xf2, 0xf2, 0xf2, 0xf2, 0x66, 0xf2, 0xf3};
+    static const uint8_t opcodes[] = {0x58, 0x5c, 0x59, 0x5e, 0x2e, 0x5a, 0x5a};
+    byte(prefixes[static_cast<size_t>(op)]);
+    rex(false, dst, src);
+    byte(0x0f);
+    byte(opcodes[static_cast<size_t>(op)]);
+    modrm(dst, src);
+}
+
+void Assembler::loadFloat(Xmm dst, Mem src)
+{
+    ++instructions;
+    byte(0xf3);
+    rex(false, dst, src);
+    byte(0x0f);
+    byte(0x10);
+    modrm(dst, src);
+}
+
+void Assembler::storeFloat(Mem dst, Xmm src)
+{
+    ++instructions;
+    byte(0xf3);
+    rex(false, src, dst);
+    byte(0x0f);
+    byte(0x11);
+    modrm(src, dst);
+}
+
+void Assembler::align(size_t alignment)
+{
+    while (size() % alignment)
+        byte(0xcc);
+}
+
+void Assembler::vex(uint8_t map, bool wide, unsigned bits, uint8_t reg, uint8_t vvvv, uint8_t rm)
+{
+    // Three-byte form; R, X, B and vvvv are stored inverted and pp selects 66.
+    byte(0xc4);
+    byte(static_cast<uint8_t>((reg & 8 ? 0 : 0x80) | 0x40 | (rm & 8 ? 0 : 0x20) | map));
+    byte(static_cast<uint8_t>(wide << 7 | (~vvvv & 15) << 3 | (bits == 256) << 2 | 1));
+}
+
+void Assembler::vec(VecOp op, Xmm dst, Xmm src, unsigned vex)
+{
+    ++instructions;
+    static const uint8_t opcodes[] = {0xd4, 0xfb, 0xeb, 0xf4, 0x6c, 0x6f};
+    if (vex)
+        this->vex(1, false, vex, dst, op == VecOp::Move ? 0 : dst, src);
+    else
+    {
+        byte(0x66);
+        rex(false, dst, src);
+        byte(0x0f);
+    }
+    byte(opcodes[static_cast<size_t>(op)]);
+    modrm(dst, src);
+}
+
+void Assembler::vecShift(bool left, Xmm reg, uint8_t bits, unsigned vex)
+{
+    ++instructions;
+    uint8_t digit = left ? 6 : 2;
+    if (vex)
+        this->vex(1, false, vex, 0, reg, reg);
+    else
+    {
+        byte(0x66);
+        rex(false, 0, reg);
+        byte(0x0f);
+    }
+    byte(0x73);
+    modrm(digit, reg);
+    byte(bits);
+}
+
+void Assembler::pshufd(Xmm dst, Xmm src, uint8_t order)
+{
+    ++instructions;
+    byte(0x66);
+    rex(false, dst, src);
+    byte(0x0f);
+    byte(0x70);
+    modrm(dst, src);
+    byte(order);
+}
+
+void Assembler::vmovq(Xmm dst, Reg src)
+{
+    ++instructions;
+    vex(1, true, 128, dst, 0, index(src));
+    byte(0x6e);
+    modrm(dst, index(src));
+}
+
+void Assembler::vbroadcastq(Xmm dst, Xmm src)
+{
+    ++instructions;
+    vex(2, false, 256, dst, 0, src);
+    byte(0x59);
+    modrm(dst, src);
+}
+
+void Assembler::vinserti128(Xmm dst, Xmm src)
+{
+    ++instructions;
+    vex(3, false, 256, dst, dst, src);
+    byte(0x38);
+    modrm(dst, src);
+    byte(1);
+}
+
+void Assembler::vextracti128(Xmm dst, Xmm src)
+{
+    ++instructions;
+    vex(3, false, 256, src, 0, dst);
+    byte(0x39);
+    modrm(src, dst);
+    byte(1);
+}
+
+void Assembler::vzeroupper()
+{
+    ++instructions;
+    byte(0xc5);
+    byte(0xf8);
+    byte(0x77);
+}
@@ -0,0 +1,38 @@
+# Checks that --emit-ast prints the same tree whether or not it is streamed,
+# and that --emit-folded-ast is the one showing folded constants.
+#
+# usage: cmake -DVSHARP=<compiler> -DSOURCE=<file.vs> -P ast_dump_modes.cmake
+
+foreach(format text json sexpr)
+    execute_process(
+        COMMAND ${VSHARP} compile ${SOURCE} --emit-ast=${format}
+        OUTPUT_VARIABLE whole
+        RESULT_VARIABLE wholeResult
+    )
+    execute_process(
+        COMMAND ${VSHARP} compile ${SOURCE} --emit-ast=${format} --stream-ast
+        OUTPUT_VARIABLE streamed
+        RESULT_VARIABLE streamedResult
+    )
+    if(NOT wholeResult EQUAL 0 OR NOT streamedResult EQUAL 0)
+        message(FATAL_ERROR "${format}: compiling ${SOURCE} failed")
+    endif()
+    if(NOT whole STREQUAL streamed)
+        message(FATAL_ERROR "${format}: streamed dump differs:\n${whole}\n---\n${streamed}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${VSHARP} compile ${SOURCE} --emit-ast=sexpr
+    OUTPUT_VARIABLE parsed
+)
+execute_process(
+    COMMAND ${VSHARP} compile ${SOURCE} --emit-folded-ast --emit-ast=sexpr
+    OUTPUT_VARIABLE folded
+)
+if(NOT parsed MATCHES "BinaryExpr \\+" OR parsed MATCHES "Literal int64 5")
+    message(FATAL_ERROR "--emit-ast did not print the parse tree:\n${parsed}")
+endif()
+if(NOT folded MATCHES "Literal int64 5")
+    message(FATAL_ERROR "--emit-folded-ast did not print folded constants:\n${folded}")
+endif()
@@ -0,0 +1,893 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <elf.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cbackend.hxx>
+#include <codegen.hxx>
+#include <escape.hxx>
+#include <jit.hxx>
+#include <regalloc.hxx>
+#include <strength.hxx>
+#include <treeshake.hxx>
+#include <x86.hxx>
+
+#include "support.hxx"
+
+static size_t instructions(const std::string &source, const std::string &name, unsigned optLevel)
+{
+    Module module = compile(source, optLevel);
+    return compileX86(module, function(module, name), optLevel).instructions;
+}
+
+static void TestPeepholeMoves()
+{
+    Assembler a;
+    a.setPeephole(true);
+    a.mov(Reg::RAX, Reg::RAX);
+    a.mov(Reg::RAX, Reg::RCX);
+    a.mov(Reg::RCX, Reg::RAX);
+    a.mov(Reg::RAX, Reg::RCX);
+    expect(a.instructionCount() == 1, "TestPeepholeMoves", "moves were not removed, got " + std::to_string(a.instructionCount()));
+
+    Mem slot{Reg::RBP, -8};
+    a.store(slot, Reg::RDX);
+    a.load(Reg::RDX, slot, 8);
+    a.load(Reg::RSI, slot, 8);
+    expect(a.instructionCount() == 3, "TestPeepholeMoves", "reload after a store was kept");
+    std::vector<uint8_t> move = {0x48, 0x89, 0xd6};
+    expect(std::equal(move.begin(), move.end(), a.bytes.end() - 3), "TestPeepholeMoves", "second load is not mov rsi, rdx");
+    std::cout << "[PASS] TestPeepholeMoves\n";
+}
+
+static void TestPeepholeBranches()
+{
+    Assembler a;
+    a.setPeephole(true);
+    Assembler::Label next = a.newLabel(), far = a.newLabel();
+    a.alu(AluOp::Cmp, Reg::RAX, 0);
+    a.jcc(Cond::E, next);
+    a.jmp(far);
+    a.bind(next);
+    a.jmp(far);
+    a.bind(far);
+    a.ret();
+    // test rax, rax; jne far; ret, with both jumps to far resolved.
+    std::vector<uint8_t> expected = {0x48, 0x85, 0xc0, 0x0f, 0x85, 0x00, 0x00, 0x00, 0x00, 0xc3};
+    expect(a.bytes == expected, "TestPeepholeBranches", "unexpected code");
+    expect(a.instructionCount() == 3, "TestPeepholeBranches", "wrong instruction count");
+
+    Assembler b;
+    b.setPeephole(true);
+    Assembler::Label done = b.newLabel();
+    b.alu(AluOp::Sub, Reg::RCX, 1);
+    b.mov(Reg::RAX, Reg::RCX);
+    b.test(Reg::RAX, Reg::RAX);
+    b.jcc(Cond::NE, done);
+    b.bind(done);
+    expect(b.instructionCount() == 3, "TestPeepholeBranches", "test after sub was kept");
+    std::cout << "[PASS] TestPeepholeBranches\n";
+}
+
+static void TestStrengthReduction()
+{
+    std::string source = R"(div7(int64 x) int64 {
+    return x / 7 + x % 10
+}
+udiv(uint32 x) uint32 {
+    return x / 1000 + x % 16
+}
+)";
+    Module module = compile(source, 1);
+    for (const char *name : {"div7", "udiv"})
+    {
+        Function fn = function(module, name);
+        expect(reduceStrength(fn), name, "nothing was reduced");
+        expect(count(fn, Opcode::Div) == 0 && count(fn, Opcode::Rem) == 0, name, "division by a constant was kept");
+        expect(count(fn, Opcode::MulHigh) > 0, name, "no reciprocal multiplication");
+    }
+    std::cout << "[PASS] TestStrengthReduction\n";
+}
+
+static void TestInstructionCounts()
+{
+    // Regression bounds: the counts when these were written.
+    struct Case
+    {
+        const char *name;
+        const char *source;
+        size_t bound;
+    };
+    std::vector<Case> cases = {
+        {"lea", "f(int64 c, int64 d) int64 {\n    return c + d * 3\n}\n", 10},
+        {"scaled", "f(int64 c, int64 d) int64 {\n    return c + d * 8\n}\n", 9},
+        {"divide", "f(int64 x) int64 {\n    return x / 10\n}\n", 16},
+        {"modulo", "f(uint64 x) uint64 {\n    return x % 16\n}\n", 8},
+    };
+    for (const auto &c : cases)
+    {
+        size_t optimized = instructions(c.source, "f", 1), plain = instructions(c.source, "f", 0);
+        expect(optimized <= c.bound, c.name, std::to_string(optimized) + " instructions, expected at most " + std::to_string(c.bound));
+        expect(optimized < plain, c.name, "no fewer instructions than at -O0");
+    }
+    std::cout << "[PASS] TestInstructionCounts\n";
+}
+
+static void TestDivisionResults()
+{
+    std::string source = "q(int64 x) int64 {\n    return x / 7 * 1000 + x % 7\n}\n"
+                         "neg(int64 x) int64 {\n    return x / (0 - 4) * 1000 + x % (0 - 4)\n}\n"
+                         "u(uint64 x) uint64 {\n    return x / 641 * 1000 + x % 641\n}\n";
+    Module module = compile(source, 2);
+    Jit jit(module, 2);
+    auto call = [&](const char *name, uint64_t arg)
+    {
+        for (uint32_t i = 0; i < module.functions.size(); ++i)
+            if (module.functions[i].name == name)
+                return jit.arrayEntry(i)(&arg);
+        fail(name, "missing function");
+        return uint64_t(0);
+    };
+    // Generated code wraps on overflow; the expected values wrap the same
+    // way in unsigned arithmetic rather than overflow int64.
+    auto wrapped = [](int64_t quotient, int64_t remainder) { return static_cast<uint64_t>(quotient) * 1000 + static_cast<uint64_t>(remainder); };
+    for (int64_t x : {int64_t(0), int64_t(6), int64_t(-6), int64_t(-7), int64_t(123456789), INT64_MIN, INT64_MAX})
+    {
+        uint64_t y = static_cast<uint64_t>(x);
+        expect(call("q", y) == wrapped(x / 7, x % 7), "TestDivisionResults", "x / 7 of " + std::to_string(x));
+        expect(call("neg", y) == wrapped(x / -4, x % -4), "TestDivisionResults", "x / -4 of " + std::to_string(x));
+        expect(call("u", y) == y / 641 * 1000 + y % 641, "TestDivisionResults", "x / 641 of " + std::to_string(y));
+    }
+    std::cout << "[PASS] TestDivisionResults\n";
+}
+
+static void TestDivisionByZero()
+{
+    // The error names the function that divided, as the VM's does.
+    std::string source = "[noinline]\nratio(int64 a, int64 b) int64 {\n    return a / b\n}\n"
+                         "[noinline]\nwrap(uint32 a, uint32 b) uint32 {\n    return a % b\n}\n"
+                         "[noinline]\nouter(int64 a, int64 b) int64 {\n    return ratio(a, b) + 1\n}\n"
+                         "main() int64 {\n    if wrap(3, 2) == 1 { return outer(1, 0) }\n    return 0\n}\n";
+    for (unsigned level : {0u, 1u, 2u})
+    {
+        Module module = compile(source, level);
+        Jit jit(module, level);
+        auto error = [&](const char *name, uint64_t a, uint64_t b)
+        {
+            uint64_t args[] = {a, b};
+            try
+            {
+                Jit::call(jit.arrayEntry(functionIndex(module, name)), args);
+            }
+            catch (const JitError &e)
+            {
+                return std::string(e.what());
+            }
+            return std::string();
+        };
+        std::string at = "-O" + std::to_string(level) + ": ";
+        expect(error("ratio", 7, 0) == "Runtime error in ratio: Division by zero", "TestDivisionByZero", at + "signed division");
+        expect(error("wrap", 7, 0) == "Runtime error in wrap: Division by zero", "TestDivisionByZero", at + "unsigned remainder");
+        expect(error("outer", 7, 0) == "Runtime error in ratio: Division by zero", "TestDivisionByZero", at + "division in a callee");
+        expect(error("outer", 7, 2).empty(), "TestDivisionByZero", at + "a non-zero divisor traps");
+
+        std::string message;
+        try
+        {
+            jit.run();
+        }
+        catch (const JitError &e)
+        {
+            message = e.what();
+        }
+        expect(message == "Runtime error in ratio: Division by zero", "TestDivisionByZero", at + "run: " + message);
+    }
+    std::cout << "[PASS] TestDivisionByZero\n";
+}
+
+static void TestTreeShaking()
+{
+    std::string source = R"(var used : int64 = 1
+var unused : string = "never loaded"
+class Base {
+    virtual f() int64 { return 1 }
+}
+class Kept : Base {
+    override f() int64 { return 2 }
+}
+class Dropped {
+    virtual g() int64 { return 3 }
+}
+helper() int64 { return used }
+orphan() int64 { return Dropped().g() }
+[export]
+api() int64 { return 4 }
+main() int64 {
+    return Kept().f() + helper()
+}
+)";
+    Module module = compile(source, 0);
+    ShakeResult result = shakeModule(module);
+    expect(result.functions == 4 && result.classes == 1 && result.globals == 1 && result.strings == 1, "TestTreeShaking",
+           "removed " + std::to_string(result.functions) + " functions, " + std::to_string(result.classes) + " classes");
+    expect(result.irBytes > 0 && result.stringBytes == 13, "TestTreeShaking", "removed bytes not counted");
+    for (const char *name : {"main", "api", "helper", "Kept.f", "<init>"})
+        function(module, name);
+    for (const auto &fn : module.functions)
+        expect(fn.name != "orphan" && fn.name != "Base.f", "TestTreeShaking", fn.name + " was kept");
+    expect(module.functions[module.entry].name == "main" && module.functions[module.initializer].name == "<init>", "TestTreeShaking", "roots were not renumbered");
+    expect(module.classes[0].vtable.empty(), "TestTreeShaking", "vtable of a class without instances was kept");
+
+    Jit jit(module, 0);
+    expect(jit.run() == 3, "TestTreeShaking", "wrong result after shaking");
+    expect(!shakeModule(module).changed(), "TestTreeShaking", "second run changed the module");
+    std::cout << "[PASS] TestTreeShaking\n";
+}
+
+static void TestEscapeAnalysis()
+{
+    std::string source = R"(class Point {
+    var x : int64 = 3
+    var y : int64 = 4
+    virtual norm() int64 { return x * x + y * y }
+    [noinline]
+    virtual scaled(int64 k) int64 {
+        if (k > 0) {
+            return x * k
+        }
+        return y
+    }
+}
+main() int64 {
+    return Point().norm() + Point().scaled(2)
+}
+)";
+    Module module = compile(source, 0);
+    ThreadPool pool(1);
+    EscapeResult result = promoteAllocations(module, pool, {});
+    expect(result.sites == 2 && result.replaced == 0 && result.stack == 2, "TestEscapeAnalysis",
+           "before inlining: " + std::to_string(result.stack) + " in the frame, " + std::to_string(result.replaced) + " replaced");
+
+    module = compile(source, 1);
+    expect(count(function(module, "main"), Opcode::New) == 0, "TestEscapeAnalysis", "an instance stayed on the heap");
+    Jit jit(module, 1);
+    expect(jit.run() == 31, "TestEscapeAnalysis", "wrong result");
+    std::cout << "[PASS] TestEscapeAnalysis\n";
+}
+
+static void TestEscapeThroughArguments()
+{
+    // The language cannot hand an instance to anything but the receiver of a
+    // method yet, so the methods are made to keep theirs in a global by hand.
+    std::string source = R"(class Box {
+    var v : int64 = 1
+    keep() int64 { return v }
+    peek() int64 { return v }
+    virtual get() int64 { return v }
+}
+class Leaky : Box {
+    override get() int64 { return v + 1 }
+}
+main() int64 {
+    return Box().keep() + Box().peek() + Box().get()
+}
+)";
+    Module module = compile(source, 0);
+    module.globals.push_back({"kept", ValueType::Ptr});
+    auto leak = [&](const std::string &name)
+    {
+        Function &fn = module.functions[functionIndex(module, name)];
+        ValueId self = fn.blocks[0].code.front();
+        expect(fn.instrs[self].op == Opcode::Param, "TestEscapeThroughArguments", name + " does not start with its receiver");
+        fn.emit(0, Opcode::StoreGlobal, ValueType::Void, {self}, static_cast<int64_t>(module.globals.size() - 1));
+        auto &code = fn.blocks[0].code;
+        std::iter_swap(code.end() - 2, code.end() - 1);
+    };
+    leak("Box.keep");
+    leak("Leaky.get");
+
+    // Box.get may run Leaky.get once the call goes through the vtable.
+    Function &main = module.functions[functionIndex(module, "main")];
+    std::vector<ValueId> allocations;
+    for (ValueId v : main.blocks[0].code)
+    {
+        if (main.instrs[v].op == Opcode::New)
+            allocations.push_back(v);
+        if (main.instrs[v].op == Opcode::Call && main.instrs[v].imm == functionIndex(module, "Box.get"))
+            main.instrs[v].op = Opcode::CallVirtual;
+    }
+
+    ThreadPool pool(1);
+    EscapeResult result = promoteAllocations(module, pool, {});
+    expect(allocations.size() == 3 && result.sites == 3 && result.stack == 1 && result.replaced == 0, "TestEscapeThroughArguments",
+           std::to_string(result.stack) + " in the frame, " + std::to_string(result.replaced) + " replaced");
+    expect(main.instrs[allocations[0]].op == Opcode::New, "TestEscapeThroughArguments", "instance passed to an escaping parameter left the heap");
+    expect(main.instrs[allocations[1]].op == Opcode::NewLocal, "TestEscapeThroughArguments", "instance only read by its method stayed on the heap");
+    expect(main.instrs[allocations[2]].op == Opcode::New, "TestEscapeThroughArguments", "instance an override lets escape left the heap");
+    std::cout << "[PASS] TestEscapeThroughArguments\n";
+}
+
+/** @brief Symbols and relocations of a relocatable ELF64 file */
+struct ObjectReader
+{
+    struct Symbol
+    {
+        std::string name;
+        uint16_t section;
+        uint64_t size;
+        bool global, function;
+    };
+
+    struct Relocation
+    {
+        std::string section; /**< Section the relocation applies to */
+        std::string symbol;  /**< Symbol name, or the section name for section symbols */
+        uint32_t type;
+    };
+
+    std::vector<Symbol> symbols;
+    std::vector<Relocation> relocations;
+    size_t firstGlobal = 0;
+    bool localsFirst = true;
+
+    explicit ObjectReader(const std::vector<uint8_t> &bytes)
+    {
+        const auto *header = reinterpret_cast<const Elf64_Ehdr *>(bytes.data());
+        expect(bytes.size() >= sizeof(Elf64_Ehdr) && memcmp(header->e_ident, ELFMAG, SELFMAG) == 0 &&
+                   header->e_ident[EI_CLASS] == ELFCLASS64 && header->e_type == ET_REL && header->e_machine == EM_X86_64,
+               "TestObjectFile", "not an x86-64 relocatable ELF64 file");
+
+        const auto *sections = reinterpret_cast<const Elf64_Shdr *>(bytes.data() + header->e_shoff);
+        const char *sectionNames = reinterpret_cast<const char *>(bytes.data() + sections[header->e_shstrndx].sh_offset);
+        auto sectionName = [&](size_t index)
+        { return std::string(sectionNames + sections[index].sh_name); };
+
+        const Elf64_Shdr *symtab = nullptr;
+        for (size_t i = 0; i < header->e_shnum; ++i)
+            if (sections[i].sh_type == SHT_SYMTAB)
+                symtab = &sections[i];
+        expect(symtab != nullptr, "TestObjectFile", "no symbol table");
+
+        const char *names = reinterpret_cast<const char *>(bytes.data() + sections[symtab->sh_link].sh_offset);
+        const auto *syms = reinterpret_cast<const Elf64_Sym *>(bytes.data() + symtab->sh_offset);
+        firstGlobal = symtab->sh_info;
+        for (size_t i = 0; i < symtab->sh_size / sizeof(Elf64_Sym); ++i)
+        {
+            const Elf64_Sym &sym = syms[i];
+            bool global = ELF64_ST_BIND(sym.st_info) == STB_GLOBAL;
+            localsFirst &= global == (i >= firstGlobal);
+            std::string name = ELF64_ST_TYPE(sym.st_info) == STT_SECTION ? sectionName(sym.st_shndx) : names + sym.st_name;
+            symbols.push_back({name, sym.st_shndx, sym.st_size, global, ELF64_ST_TYPE(sym.st_info) == STT_FUNC});
+        }
+
+        for (size_t i = 0; i < header->e_shnum; ++i)
+        {
+            if (sections[i].sh_type != SHT_RELA)
+                continue;
+            const auto *relas = reinterpret_cast<const Elf64_Rela *>(bytes.data() + sections[i].sh_offset);
+            for (size_t r = 0; r < sections[i].sh_size / sizeof(Elf64_Rela); ++r)
+                relocations.push_back({sectionName(sections[i].sh_info), symbols[ELF64_R_SYM(relas[r].r_info)].name,
+                                       static_cast<uint32_t>(ELF64_R_TYPE(relas[r].r_info))});
+        }
+    }
+
+    const Symbol *find(const std::string &name) const
+    {
+        for (const auto &symbol : symbols)
+            if (symbol.name == name)
+                return &symbol;
+        return nullptr;
+    }
+
+    bool relocates(const std::string &section, const std::string &symbol, uint32_t type) const
+    {
+        return std::any_of(relocations.begin(), relocations.end(), [&](const Relocation &r)
+                           { return r.section == section && r.symbol == symbol && r.type == type; });
+    }
+};
+
+static void TestRegisterPressure()
+{
+    // Twenty values live across the calls that define the others, twice
+    // over: more than the seven allocatable registers, so values spill, and
+    // the second group can reuse the first group's slots.
+    const int Live = 20;
+    std::string source = "[noinline]\nmix(int64[x]) int64 {\n    return x * 3 + 1\n}\n[noinline]\npressure(int64[seed]) int64 {\n";
+    for (const char *group : {"a", "b"})
+    {
+        std::string sum;
+        for (int i = 0; i < Live; ++i)
+        {
+            source += "    var " + std::string(group) + std::to_string(i) + " : int64 = mix(seed + " + std::to_string(i) + ")\n";
+            sum += (i ? " + " : "") + std::string(group) + std::to_string(i) + " * " + std::to_string(i + 1);
+        }
+        source += "    seed = seed + " + sum + "\n";
+    }
+    source += "    return seed\n}\nmain() int64 {\n    return pressure(5) % 1000003\n}\n";
+
+    int64_t seed = 5;
+    for (int group = 0; group < 2; ++group)
+    {
+        int64_t sum = 0;
+        for (int i = 0; i < Live; ++i)
+            sum += ((seed + i) * 3 + 1) * (i + 1);
+        seed += sum;
+    }
+    const int expected = static_cast<int>(seed % 1000003);
+
+    for (unsigned level : {1u, 2u})
+    {
+        std::string test = "TestRegisterPressure -O" + std::to_string(level);
+        Module module = compile(source, level);
+        const Function &fn = function(module, "pressure");
+
+        RegisterAssignment none = allocateRegisters(fn, RegisterAllocator::None);
+        RegisterAssignment scan = allocateRegisters(fn, RegisterAllocator::LinearScan);
+        RegisterAssignment coloring = allocateRegisters(fn, RegisterAllocator::GraphColoring);
+        expect(none.slots == none.spilled && none.spilled > 2 * Live, test, "-O0 allocation does not give each value a slot");
+        for (const auto *regs : {&scan, &coloring})
+        {
+            const char *name = regs == &scan ? "linear scan" : "graph coloring";
+            expect(regs->spilled > 0 && regs->spilled < none.spilled, test, std::string(name) + ": " + std::to_string(regs->spilled) + " values spilled");
+            expect(regs->slots < regs->spilled, test, std::string(name) + ": spill slots not shared, " + std::to_string(regs->slots) + " for " +
+                                                          std::to_string(regs->spilled) + " values");
+            expect(regs->calleeSaved.size() == 5, test, std::string(name) + ": preserved registers left unused");
+            // Values that got r10 or r11 across a call are saved around it.
+            bool split = std::any_of(regs->saved.begin(), regs->saved.end(), [](uint16_t mask)
+                                     { return mask != 0; });
+            expect(split, test, std::string(name) + ": no value kept in a clobbered register across a call");
+        }
+        expect(coloring.spilled <= scan.spilled, test,
+               "graph coloring spilled " + std::to_string(coloring.spilled) + ", linear scan " + std::to_string(scan.spilled));
+
+        Jit jit(module, level);
+        int result = jit.run();
+        expect(result == expected, test, "native result " + std::to_string(result) + ", expected " + std::to_string(expected));
+        expect(runVM(source) == expected, test, "interpreter disagrees");
+    }
+    std::cout << "[PASS] TestRegisterPressure\n";
+}
+
+static bool haveCompiler()
+{
+    return std::system("cc --version > /dev/null 2>&1") == 0;
+}
+
+/**
+ * @brief Builds an executable from one input with cc and runs it, deleting
+ * both afterwards. Returns the exit status, or -1 if cc or the program failed.
+ */
+static int buildAndRun(const std::string &input, const std::string &flags)
+{
+    std::string executable = input + ".exe";
+    int built = std::system(("cc " + flags + " " + input + " -o " + executable).c_str());
+    int status = built == 0 ? std::system(executable.c_str()) : -1;
+    std::filesystem::remove(input);
+    std::filesystem::remove(executable);
+    return status != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void TestObjectFile()
+{
+    std::string source = R"(var counter : int64 = 40
+var label : string = "vs"
+class Box {
+    var v : int64 = 1
+    public virtual get() int64 { return v }
+    public virtual twice() int64 { return get() * 2 }
+}
+class Big : Box {
+    public override get() int64 { return v + 1 }
+}
+[noinline]
+bump(int64[k]) int64 {
+    counter = counter + k
+    return counter
+}
+main() int64 {
+    var s : string = label + "!"
+    var extra : int64 = 0
+    if s == "vs!" { extra = 1 }
+    return bump(1) + extra + Box().twice() + Big().twice()
+}
+)";
+    Module module = compile(source, 1);
+    ObjectReader object(emitObject(module, 1).serialize());
+
+    expect(object.localsFirst && object.firstGlobal > 0, "TestObjectFile", "local symbols do not precede globals");
+    const auto *main = object.find("main");
+    const auto *bump = object.find("vs.bump");
+    expect(main && main->global && main->function && main->section == ElfObject::Text && main->size > 0, "TestObjectFile",
+           "no C main in .text");
+    expect(bump && bump->global && bump->function && bump->section == ElfObject::Text && bump->size > 0, "TestObjectFile",
+           "vs.bump not defined in .text");
+    const auto *external = object.find("strcmp");
+    expect(external && external->global && external->section == SHN_UNDEF, "TestObjectFile", "strcmp is not left to the linker");
+    const auto *vtable = object.find("vs.vtable.Box");
+    expect(vtable && !vtable->global && vtable->section == ElfObject::Data && vtable->size == 16, "TestObjectFile",
+           "Box's vtable is not a local two-slot symbol in .data");
+
+    // Calls go through the PLT, data is addressed relative to the section,
+    // and pointers stored in .data are absolute.
+    expect(object.relocates(".text", "vs.bump", R_X86_64_PLT32), "TestObjectFile", "call to bump is not relocated");
+    expect(object.relocates(".text", "strcmp", R_X86_64_PLT32), "TestObjectFile", "call to strcmp is not relocated");
+    expect(object.relocates(".text", ".data", R_X86_64_PC32), "TestObjectFile", "global access is not relocated");
+    expect(object.relocates(".text", ".rodata", R_X86_64_PC32), "TestObjectFile", "string constant is not relocated");
+    expect(object.relocates(".data", ".rodata", R_X86_64_64), "TestObjectFile", "string global is not relocated");
+    expect(object.relocates(".data", "vs.Box.twice", R_X86_64_64) && object.relocates(".data", "vs.Big.get", R_X86_64_64),
+           "TestObjectFile", "vtable slots are not relocated");
+    for (const auto &r : object.relocations)
+        expect(r.type == R_X86_64_PLT32 || r.type == R_X86_64_PC32 || r.type == R_X86_64_64, "TestObjectFile",
+               "unexpected relocation type " + std::to_string(r.type));
+
+    // The linked program returns main's result as its exit status.
+    if (!haveCompiler())
+    {
+        std::cout << "[SKIP] TestObjectFile: no cc to link with\n";
+        return;
+    }
+    for (unsigned level : {0u, 1u, 2u})
+    {
+        Module linked = compile(source, level);
+        std::string path = scratchFile("vsharp_object_O" + std::to_string(level), ".o");
+        expect(emitObject(linked, level).write(path), "TestObjectFile", "cannot write " + path);
+        int status = buildAndRun(path, "");
+        expect(status == 41 + 1 + 2 + 4, "TestObjectFile", "linked program returned " + std::to_string(status) + " at -O" + std::to_string(level));
+    }
+    std::cout << "[PASS] TestObjectFile\n";
+}
+
+static void TestCBackend()
+{
+    std::string source = R"(var counter : int64 = 40
+var label : string = "vs"
+class Box {
+    var v : int64 = 1
+    var small : int8 = 100
+    public virtual get() int64 { return v }
+    public virtual twice() int64 { return get() * 2 }
+    public wrapped() int64 {
+        small = small + 100
+        if small < 0 { return 1 }
+        return 0
+    }
+}
+class Big : Box {
+    public override get() int64 { return v + 1 }
+}
+[noinline]
+bump(int64[k]) int64 {
+    counter = counter + k
+    return counter
+}
+pick(int64[x]) int64 {
+    match x {
+        1 { return 10 }
+        2, 3 { return 20 }
+        else { return 0 }
+    }
+}
+name(string[s]) int64 {
+    match s {
+        "" { return 1 }
+        "box" { return 2 }
+        else { return 0 }
+    }
+}
+main() int64 {
+    var s : string = label + "!"
+    var extra : int64 = 0
+    if s == "vs!" { extra = 1 }
+    var total : int64 = 0
+    for (var i : int64 = 0; i < 4; i = i + 1) {
+        total = total + pick(i)
+    }
+    var octet : uint8 = 200
+    octet = octet + 100
+    if octet == 44 { extra = extra + 2 }
+    return bump(1) + extra + Box().twice() + Big().twice() + total + Box().wrapped() * 100 + name("box") * 10
+}
+)";
+    const int expected = 41 + 3 + 2 + 4 + 50 + 100 + 20;
+    expect(runVM(source) == expected, "TestCBackend", "wrong result from the VM");
+
+    if (!haveCompiler())
+    {
+        std::cout << "[SKIP] TestCBackend: no cc to compile with\n";
+        return;
+    }
+    for (unsigned level : {0u, 1u, 2u})
+    {
+        Module module = compile(source, level);
+        std::string path = scratchFile("vsharp_c_O" + std::to_string(level), ".c");
+        FILE *out = fopen(path.c_str(), "w");
+        expect(out != nullptr, "TestCBackend", "cannot write " + path);
+        emitC(module, out);
+        fclose(out);
+
+        int status = buildAndRun(path, "-std=c99 -Wall -Werror");
+        expect(status == expected, "TestCBackend",
+               "C output returned " + std::to_string(status) + " at -O" + std::to_string(level) + " (-1: it did not compile)");
+    }
+    std::cout << "[PASS] TestCBackend\n";
+}
+
+/** @brief Permissions ("r-xp" and so on) of the mapping holding an address, from /proc/self/maps */
+static std::string protection(const void *address)
+{
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    uintptr_t at = reinterpret_cast<uintptr_t>(address);
+    while (std::getline(maps, line))
+    {
+        unsigned long start, end;
+        char perms[5] = {};
+        if (sscanf(line.c_str(), "%lx-%lx %4s", &start, &end, perms) == 3 && at >= start && at < end)
+            return perms;
+    }
+    return "";
+}
+
+/** @brief True when no mapping of the process is writable and executable at once */
+static bool writeXorExecute()
+{
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line))
+    {
+        char perms[5] = {};
+        if (sscanf(line.c_str(), "%*x-%*x %4s", perms) == 1 && perms[1] == 'w' && perms[2] == 'x')
+            return false;
+    }
+    return true;
+}
+
+struct PerfMapEntry
+{
+    uintptr_t start;
+    size_t size;
+    std::string name;
+};
+
+static std::vector<PerfMapEntry> readPerfMap()
+{
+    std::ifstream file("/tmp/perf-" + std::to_string(getpid()) + ".map");
+    std::vector<PerfMapEntry> entries;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        PerfMapEntry entry;
+        fields >> std::hex >> entry.start >> entry.size;
+        std::getline(fields >> std::ws, entry.name);
+        expect(!fields.fail() && !entry.name.empty(), "TestJit", "malformed perf map line: " + line);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+static void TestJit()
+{
+    std::string source = R"(var base : int64 = 5
+class Counter {
+    var n : int64 = 0
+    public virtual add(int64 k) int64 {
+        n = n + k
+        return n
+    }
+}
+[noinline]
+square(int64 x) int64 {
+    return x * x
+}
+[noinline]
+increment(int64 x) int64 {
+    return x + 1
+}
+main() int64 {
+    if base == 0 { return increment(0) }
+    return square(base) + Counter().add(3)
+}
+)";
+    Module module = compile(source, 1);
+    uint32_t square = functionIndex(module, "square"), increment = functionIndex(module, "increment");
+
+    {
+        Jit jit(module, 1);
+        expect(jit.writePerfMap(), "TestJit", "cannot write the perf map");
+        expect(writeXorExecute(), "TestJit", "a mapping is writable and executable after setup");
+        expect(protection(jit.address(square)) == "r-xp", "TestJit", "stubs are not read-execute");
+        expect(protection(jit.globalSlots()) == "rw-p", "TestJit", "globals are not read-write");
+
+        // Functions are compiled through their stubs the first time they run.
+        expect(jit.run() == 28, "TestJit", "wrong result");
+        expect(jit.globalSlots()[0] == 5, "TestJit", "initializer did not set the global");
+        const void *code = jit.compile(square);
+        expect(code != jit.address(square), "TestJit", "compiled code is the stub");
+        expect(protection(code) == "r-xp" && writeXorExecute(), "TestJit", "code pages left writable");
+
+        // Code placed on fresh pages while other code exists; still W^X.
+        Jit::ArrayEntry entry = jit.arrayEntry(increment, true);
+        uint64_t arg = 41;
+        expect(entry(&arg) == 42 && protection(reinterpret_cast<const void *>(entry)) == "r-xp" && writeXorExecute(),
+               "TestJit", "fresh-page entry");
+
+        // The map names the stubs first, then each function as it is compiled.
+        std::vector<PerfMapEntry> entries = readPerfMap();
+        expect(!entries.empty() && entries[0].name == "vsharp.stubs" && entries[0].size > 0, "TestJit",
+               "perf map does not start with the stubs");
+        auto named = [&](const std::string &name)
+        {
+            return std::find_if(entries.begin(), entries.end(), [&](const PerfMapEntry &e)
+                                { return e.name == name; });
+        };
+        auto squareEntry = named("vs.square");
+        expect(squareEntry != entries.end() && squareEntry->start == reinterpret_cast<uintptr_t>(code) && squareEntry->size > 0,
+               "TestJit", "vs.square is not in the perf map at its code");
+        expect(named("vs.main") != entries.end(), "TestJit", "main is missing from the perf map");
+    }
+
+    // Functions compiled before the map was opened are listed with their size.
+    {
+        Jit jit(module, 1);
+        const void *code = jit.compile(square);
+        expect(jit.writePerfMap(), "TestJit", "cannot write the perf map");
+        std::vector<PerfMapEntry> entries = readPerfMap();
+        expect(entries.size() == 2 && entries[1].name == "vs.square" && entries[1].start == reinterpret_cast<uintptr_t>(code) &&
+                   entries[1].size > 0,
+               "TestJit", "function compiled earlier is missing or has no size");
+    }
+    std::filesystem::remove("/tmp/perf-" + std::to_string(getpid()) + ".map");
+    std::cout << "[PASS] TestJit\n";
+}
+
+/** @brief Whether code holds a packed 64-bit add: paddq, with or without a REX prefix */
+static bool hasPaddq(const std::vector<uint8_t> &code)
+{
+    for (size_t i = 0; i + 3 < code.size(); ++i)
+        if (code[i] == 0x66 && ((code[i + 1] == 0x0f && code[i + 2] == 0xd4) ||
+                                ((code[i + 1] & 0xf0) == 0x40 && code[i + 2] == 0x0f && code[i + 3] == 0xd4)))
+            return true;
+    return false;
+}
+
+/** @brief Whether code leaves AVX with vzeroupper */
+static bool hasVzeroupper(const std::vector<uint8_t> &code)
+{
+    static const uint8_t bytes[] = {0xc5, 0xf8, 0x77};
+    return std::search(code.begin(), code.end(), bytes, bytes + 3) != code.end();
+}
+
+static void TestVectorReduction()
+{
+    // Both loops are left for the vectorizer at -O2: sum's i * 3 becomes a
+    // second induction variable, and mixed subtracts, multiplies by a value
+    // from before the loop and runs to an inclusive bound.
+    std::string functions = R"([noinline]
+sum(int64[n]) int64 {
+    var t : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) {
+        t = t + i * 3
+    }
+    return t
+}
+[noinline]
+mixed(int64 n, int64 k) int64 {
+    var s : int64 = 0
+    var p : int64 = 0
+    for (var i : int64 = 1; i <= n; i = i + 1) {
+        s = s - (i + k)
+        p = p + i * k
+    }
+    return s + p
+}
+)";
+    auto sum = [](int64_t n)
+    {
+        int64_t t = 0;
+        for (int64_t i = 0; i < n; ++i)
+            t += i * 3;
+        return t;
+    };
+    auto mixed = [](int64_t n, int64_t k)
+    {
+        int64_t s = 0, p = 0;
+        for (int64_t i = 1; i <= n; ++i)
+        {
+            s -= i + k;
+            p += i * k;
+        }
+        return s + p;
+    };
+    // Trip counts of 0, 1, odd ones and ones that are not a multiple of
+    // either vector width, which leave iterations to the scalar loop.
+    const std::vector<int64_t> trips = {-3, 0, 1, 2, 3, 4, 5, 6, 7, 9, 13, 1001};
+
+    Module module = compile(functions + "main() int64 {\n    return sum(5) + mixed(5, 2)\n}\n", 2);
+    for (const char *name : {"sum", "mixed"})
+    {
+        const Function &fn = function(module, name);
+        NativeFunction scalar = compileX86(module, fn, 1), sse = compileX86(module, fn, 2, false), avx = compileX86(module, fn, 2, true);
+        expect(!hasPaddq(scalar.code) && hasPaddq(sse.code) && !hasVzeroupper(sse.code), "TestVectorReduction",
+               std::string(name) + ": no SSE loop at -O2");
+        expect(hasVzeroupper(avx.code), "TestVectorReduction", std::string(name) + ": no AVX2 loop at -O2");
+        // The vector loop comes on top of the scalar one, which finishes the
+        // iterations left over.
+        expect(sse.instructions > scalar.instructions && avx.instructions > scalar.instructions, "TestVectorReduction",
+               std::string(name) + ": vector loop missing from the instruction count");
+        // Setting up the lanes and combining them again stays small.
+        expect(sse.instructions < scalar.instructions + 72 && avx.instructions < scalar.instructions + 72, "TestVectorReduction",
+               std::string(name) + ": " + std::to_string(sse.instructions) + " SSE and " + std::to_string(avx.instructions) +
+                   " AVX2 instructions");
+    }
+
+    // The JIT picks the widest the processor has.
+    {
+        Jit jit(module, 2);
+        Jit::ArrayEntry sumEntry = jit.arrayEntry(functionIndex(module, "sum"));
+        Jit::ArrayEntry mixedEntry = jit.arrayEntry(functionIndex(module, "mixed"));
+        for (int64_t n : trips)
+        {
+            uint64_t args[] = {static_cast<uint64_t>(n), 7};
+            expect(static_cast<int64_t>(sumEntry(args)) == sum(n), "TestVectorReduction", "JIT sum wrong for " + std::to_string(n));
+            expect(static_cast<int64_t>(mixedEntry(args)) == mixed(n, 7), "TestVectorReduction",
+                   "JIT mixed wrong for " + std::to_string(n));
+        }
+    }
+
+    // Linked objects run the SSE loop everywhere and the AVX2 one where the
+    // processor has it. main returns the number of wrong results.
+    if (!haveCompiler())
+    {
+        std::cout << "[SKIP] TestVectorReduction: no cc to link with\n";
+        return;
+    }
+    auto literal = [](int64_t value)
+    {
+        return value < 0 ? "(0 - " + std::to_string(-value) + ")" : std::to_string(value);
+    };
+    std::string main = "main() int64 {\n    var wrong : int64 = 0\n";
+    for (int64_t n : trips)
+    {
+        main += "    if sum(" + literal(n) + ") != " + literal(sum(n)) + " { wrong = wrong + 1 }\n";
+        main += "    if mixed(" + literal(n) + ", 7) != " + literal(mixed(n, 7)) + " { wrong = wrong + 1 }\n";
+    }
+    main += "    return wrong\n}\n";
+    Module linked = compile(functions + main, 2);
+    for (bool avx2 : {false, true})
+    {
+        if (avx2 && !__builtin_cpu_supports("avx2"))
+            continue;
+        std::string path = scratchFile(avx2 ? "vsharp_avx2" : "vsharp_sse", ".o");
+        expect(emitObject(linked, 2, avx2).write(path), "TestVectorReduction", "cannot write " + path);
+        int status = buildAndRun(path, "");
+        expect(status == 0, "TestVectorReduction", std::string(avx2 ? "AVX2" : "SSE") + " program returned " + std::to_string(status));
+    }
+    std::cout << "[PASS] TestVectorReduction\n";
+}
+
+int main()
+{
+    TestPeepholeMoves();
+    TestPeepholeBranches();
+    TestStrengthReduction();
+    TestInstructionCounts();
+    TestDivisionResults();
+    TestDivisionByZero();
+    TestTreeShaking();
+    TestEscapeAnalysis();
+    TestEscapeThroughArguments();
+    TestRegisterPressure();
+    TestObjectFile();
+    TestCBackend();
+    TestJit();
+    TestVectorReduction();
+    return 0;
+}
@@ -0,0 +1,11 @@
+const k : int64 = 2 + 3
+const twice : int64 = k * 2
+
+class Limits {
+    const small : int8 = 100 + 27
+    public wide() int64 { return twice + 1 }
+}
+
+main() int64 {
+    return Limits().wide() - twice
+}
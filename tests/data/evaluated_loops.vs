@@ -0,0 +1,36 @@
+// Loops with a constant trip count that the loop pass works out entirely:
+// only their result may be left, folded.
+
+// CHECK-O1: function count\(\) i64
+// CHECK-O1-NEXT: ^bb0:$
+// CHECK-O1-NEXT: = const i64 225$
+// CHECK-O1-NEXT: ^  ret
+// CHECK-O2: function count\(\) i64
+// CHECK-O2-NEXT: ^bb0:$
+// CHECK-O2-NEXT: = const i64 225$
+// CHECK-O2-NEXT: ^  ret
+[noinline]
+count() int64 {
+    var i : int64 = 0
+    for (i = 0; i < 225; i = i + 1) {
+    }
+    return i % 256
+}
+
+// Only -O2 unrolls the loop completely.
+// CHECK-O2: function squares\(\) i64
+// CHECK-O2-NEXT: ^bb0:$
+// CHECK-O2-NEXT: = const i64 247$
+// CHECK-O2-NEXT: ^  ret
+[noinline]
+squares() int64 {
+    var s : int64 = 0
+    for (var j : int64 = 0; j < 15; j = j + 1) {
+        s = s + j * j
+    }
+    return s % 256
+}
+
+main() int64 {
+    return count() + squares()
+}
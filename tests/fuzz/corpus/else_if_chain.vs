@@ -0,0 +1,1103 @@
+f(int64 x) int64 {
+    if x == 0 { return 0 }
+    else if x == 1 { return 1 }
+    else if x == 2 { return 2 }
+    else if x == 3 { return 3 }
+    else if x == 4 { return 4 }
+    else if x == 5 { return 5 }
+    else if x == 6 { return 6 }
+    else if x == 7 { return 7 }
+    else if x == 8 { return 8 }
+    else if x == 9 { return 9 }
+    else if x == 10 { return 10 }
+    else if x == 11 { return 11 }
+    else if x == 12 { return 12 }
+    else if x == 13 { return 13 }
+    else if x == 14 { return 14 }
+    else if x == 15 { return 15 }
+    else if x == 16 { return 16 }
+    else if x == 17 { return 17 }
+    else if x == 18 { return 18 }
+    else if x == 19 { return 19 }
+    else if x == 20 { return 20 }
+    else if x == 21 { return 21 }
+    else if x == 22 { return 22 }
+    else if x == 23 { return 23 }
+    else if x == 24 { return 24 }
+    else if x == 25 { return 25 }
+    else if x == 26 { return 26 }
+    else if x == 27 { return 27 }
+    else if x == 28 { return 28 }
+    else if x == 29 { return 29 }
+    else if x == 30 { return 30 }
+    else if x == 31 { return 31 }
+    else if x == 32 { return 32 }
+    else if x == 33 { return 33 }
+    else if x == 34 { return 34 }
+    else if x == 35 { return 35 }
+    else if x == 36 { return 36 }
+    else if x == 37 { return 37 }
+    else if x == 38 { return 38 }
+    else if x == 39 { return 39 }
+    else if x == 40 { return 40 }
+    else if x == 41 { return 41 }
+    else if x == 42 { return 42 }
+    else if x == 43 { return 43 }
+    else if x == 44 { return 44 }
+    else if x == 45 { return 45 }
+    else if x == 46 { return 46 }
+    else if x == 47 { return 47 }
+    else if x == 48 { return 48 }
+    else if x == 49 { return 49 }
+    else if x == 50 { return 50 }
+    else if x == 51 { return 51 }
+    else if x == 52 { return 52 }
+    else if x == 53 { return 53 }
+    else if x == 54 { return 54 }
+    else if x == 55 { return 55 }
+    else if x == 56 { return 56 }
+    else if x == 57 { return 57 }
+    else if x == 58 { return 58 }
+    else if x == 59 { return 59 }
+    else if x == 60 { return 60 }
+    else if x == 61 { return 61 }
+    else if x == 62 { return 62 }
+    else if x == 63 { return 63 }
+    else if x == 64 { return 64 }
+    else if x == 65 { return 65 }
+    else if x == 66 { return 66 }
+    else if x == 67 { return 67 }
+    else if x == 68 { return 68 }
+    else if x == 69 { return 69 }
+    else if x == 70 { return 70 }
+    else if x == 71 { return 71 }
+    else if x == 72 { return 72 }
+    else if x == 73 { return 73 }
+    else if x == 74 { return 74 }
+    else if x == 75 { return 75 }
+    else if x == 76 { return 76 }
+    else if x == 77 { return 77 }
+    else if x == 78 { return 78 }
+    else if x == 79 { return 79 }
+    else if x == 80 { return 80 }
+    else if x == 81 { return 81 }
+    else if x == 82 { return 82 }
+    else if x == 83 { return 83 }
+    else if x == 84 { return 84 }
+    else if x == 85 { return 85 }
+    else if x == 86 { return 86 }
+    else if x == 87 { return 87 }
+    else if x == 88 { return 88 }
+    else if x == 89 { return 89 }
+    else if x == 90 { return 90 }
+    else if x == 91 { return 91 }
+    else if x == 92 { return 92 }
+    else if x == 93 { return 93 }
+    else if x == 94 { return 94 }
+    else if x == 95 { return 95 }
+    else if x == 96 { return 96 }
+    else if x == 97 { return 97 }
+    else if x == 98 { return 98 }
+    else if x == 99 { return 99 }
+    else if x == 100 { return 0 }
+    else if x == 101 { return 1 }
+    else if x == 102 { return 2 }
+    else if x == 103 { return 3 }
+    else if x == 104 { return 4 }
+    else if x == 105 { return 5 }
+    else if x == 106 { return 6 }
+    else if x == 107 { return 7 }
+    else if x == 108 { return 8 }
+    else if x == 109 { return 9 }
+    else if x == 110 { return 10 }
+    else if x == 111 { return 11 }
+    else if x == 112 { return 12 }
+    else if x == 113 { return 13 }
+    else if x == 114 { return 14 }
+    else if x == 115 { return 15 }
+    else if x == 116 { return 16 }
+    else if x == 117 { return 17 }
+    else if x == 118 { return 18 }
+    else if x == 119 { return 19 }
+    else if x == 120 { return 20 }
+    else if x == 121 { return 21 }
+    else if x == 122 { return 22 }
+    else if x == 123 { return 23 }
+    else if x == 124 { return 24 }
+    else if x == 125 { return 25 }
+    else if x == 126 { return 26 }
+    else if x == 127 { return 27 }
+    else if x == 128 { return 28 }
+    else if x == 129 { return 29 }
+    else if x == 130 { return 30 }
+    else if x == 131 { return 31 }
+    else if x == 132 { return 32 }
+    else if x == 133 { return 33 }
+    else if x == 134 { return 34 }
+    else if x == 135 { return 35 }
+    else if x == 136 { return 36 }
+    else if x == 137 { return 37 }
+    else if x == 138 { return 38 }
+    else if x == 139 { return 39 }
+    else if x == 140 { return 40 }
+    else if x == 141 { return 41 }
+    else if x == 142 { return 42 }
+    else if x == 143 { return 43 }
+    else if x == 144 { return 44 }
+    else if x == 145 { return 45 }
+    else if x == 146 { return 46 }
+    else if x == 147 { return 47 }
+    else if x == 148 { return 48 }
+    else if x == 149 { return 49 }
+    else if x == 150 { return 50 }
+    else if x == 151 { return 51 }
+    else if x == 152 { return 52 }
+    else if x == 153 { return 53 }
+    else if x == 154 { return 54 }
+    else if x == 155 { return 55 }
+    else if x == 156 { return 56 }
+    else if x == 157 { return 57 }
+    else if x == 158 { return 58 }
+    else if x == 159 { return 59 }
+    else if x == 160 { return 60 }
+    else if x == 161 { return 61 }
+    else if x == 162 { return 62 }
+    else if x == 163 { return 63 }
+    else if x == 164 { return 64 }
+    else if x == 165 { return 65 }
+    else if x == 166 { return 66 }
+    else if x == 167 { return 67 }
+    else if x == 168 { return 68 }
+    else if x == 169 { return 69 }
+    else if x == 170 { return 70 }
+    else if x == 171 { return 71 }
+    else if x == 172 { return 72 }
+    else if x == 173 { return 73 }
+    else if x == 174 { return 74 }
+    else if x == 175 { return 75 }
+    else if x == 176 { return 76 }
+    else if x == 177 { return 77 }
+    else if x == 178 { return 78 }
+    else if x == 179 { return 79 }
+    else if x == 180 { return 80 }
+    else if x == 181 { return 81 }
+    else if x == 182 { return 82 }
+    else if x == 183 { return 83 }
+    else if x == 184 { return 84 }
+    else if x == 185 { return 85 }
+    else if x == 186 { return 86 }
+    else if x == 187 { return 87 }
+    else if x == 188 { return 88 }
+    else if x == 189 { return 89 }
+    else if x == 190 { return 90 }
+    else if x == 191 { return 91 }
+    else if x == 192 { return 92 }
+    else if x == 193 { return 93 }
+    else if x == 194 { return 94 }
+    else if x == 195 { return 95 }
+    else if x == 196 { return 96 }
+    else if x == 197 { return 97 }
+    else if x == 198 { return 98 }
+    else if x == 199 { return 99 }
+    else if x == 200 { return 0 }
+    else if x == 201 { return 1 }
+    else if x == 202 { return 2 }
+    else if x == 203 { return 3 }
+    else if x == 204 { return 4 }
+    else if x == 205 { return 5 }
+    else if x == 206 { return 6 }
+    else if x == 207 { return 7 }
+    else if x == 208 { return 8 }
+    else if x == 209 { return 9 }
+    else if x == 210 { return 10 }
+    else if x == 211 { return 11 }
+    else if x == 212 { return 12 }
+    else if x == 213 { return 13 }
+    else if x == 214 { return 14 }
+    else if x == 215 { return 15 }
+    else if x == 216 { return 16 }
+    else if x == 217 { return 17 }
+    else if x == 218 { return 18 }
+    else if x == 219 { return 19 }
+    else if x == 220 { return 20 }
+    else if x == 221 { return 21 }
+    else if x == 222 { return 22 }
+    else if x == 223 { return 23 }
+    else if x == 224 { return 24 }
+    else if x == 225 { return 25 }
+    else if x == 226 { return 26 }
+    else if x == 227 { return 27 }
+    else if x == 228 { return 28 }
+    else if x == 229 { return 29 }
+    else if x == 230 { return 30 }
+    else if x == 231 { return 31 }
+    else if x == 232 { return 32 }
+    else if x == 233 { return 33 }
+    else if x == 234 { return 34 }
+    else if x == 235 { return 35 }
+    else if x == 236 { return 36 }
+    else if x == 237 { return 37 }
+    else if x == 238 { return 38 }
+    else if x == 239 { return 39 }
+    else if x == 240 { return 40 }
+    else if x == 241 { return 41 }
+    else if x == 242 { return 42 }
+    else if x == 243 { return 43 }
+    else if x == 244 { return 44 }
+    else if x == 245 { return 45 }
+    else if x == 246 { return 46 }
+    else if x == 247 { return 47 }
+    else if x == 248 { return 48 }
+    else if x == 249 { return 49 }
+    else if x == 250 { return 50 }
+    else if x == 251 { return 51 }
+    else if x == 252 { return 52 }
+    else if x == 253 { return 53 }
+    else if x == 254 { return 54 }
+    else if x == 255 { return 55 }
+    else if x == 256 { return 56 }
+    else if x == 257 { return 57 }
+    else if x == 258 { return 58 }
+    else if x == 259 { return 59 }
+    else if x == 260 { return 60 }
+    else if x == 261 { return 61 }
+    else if x == 262 { return 62 }
+    else if x == 263 { return 63 }
+    else if x == 264 { return 64 }
+    else if x == 265 { return 65 }
+    else if x == 266 { return 66 }
+    else if x == 267 { return 67 }
+    else if x == 268 { return 68 }
+    else if x == 269 { return 69 }
+    else if x == 270 { return 70 }
+    else if x == 271 { return 71 }
+    else if x == 272 { return 72 }
+    else if x == 273 { return 73 }
+    else if x == 274 { return 74 }
+    else if x == 275 { return 75 }
+    else if x == 276 { return 76 }
+    else if x == 277 { return 77 }
+    else if x == 278 { return 78 }
+    else if x == 279 { return 79 }
+    else if x == 280 { return 80 }
+    else if x == 281 { return 81 }
+    else if x == 282 { return 82 }
+    else if x == 283 { return 83 }
+    else if x == 284 { return 84 }
+    else if x == 285 { return 85 }
+    else if x == 286 { return 86 }
+    else if x == 287 { return 87 }
+    else if x == 288 { return 88 }
+    else if x == 289 { return 89 }
+    else if x == 290 { return 90 }
+    else if x == 291 { return 91 }
+    else if x == 292 { return 92 }
+    else if x == 293 { return 93 }
+    else if x == 294 { return 94 }
+    else if x == 295 { return 95 }
+    else if x == 296 { return 96 }
+    else if x == 297 { return 97 }
+    else if x == 298 { return 98 }
+    else if x == 299 { return 99 }
+    else if x == 300 { return 0 }
+    else if x == 301 { return 1 }
+    else if x == 302 { return 2 }
+    else if x == 303 { return 3 }
+    else if x == 304 { return 4 }
+    else if x == 305 { return 5 }
+    else if x == 306 { return 6 }
+    else if x == 307 { return 7 }
+    else if x == 308 { return 8 }
+    else if x == 309 { return 9 }
+    else if x == 310 { return 10 }
+    else if x == 311 { return 11 }
+    else if x == 312 { return 12 }
+    else if x == 313 { return 13 }
+    else if x == 314 { return 14 }
+    else if x == 315 { return 15 }
+    else if x == 316 { return 16 }
+    else if x == 317 { return 17 }
+    else if x == 318 { return 18 }
+    else if x == 319 { return 19 }
+    else if x == 320 { return 20 }
+    else if x == 321 { return 21 }
+    else if x == 322 { return 22 }
+    else if x == 323 { return 23 }
+    else if x == 324 { return 24 }
+    else if x == 325 { return 25 }
+    else if x == 326 { return 26 }
+    else if x == 327 { return 27 }
+    else if x == 328 { return 28 }
+    else if x == 329 { return 29 }
+    else if x == 330 { return 30 }
+    else if x == 331 { return 31 }
+    else if x == 332 { return 32 }
+    else if x == 333 { return 33 }
+    else if x == 334 { return 34 }
+    else if x == 335 { return 35 }
+    else if x == 336 { return 36 }
+    else if x == 337 { return 37 }
+    else if x == 338 { return 38 }
+    else if x == 339 { return 39 }
+    else if x == 340 { return 40 }
+    else if x == 341 { return 41 }
+    else if x == 342 { return 42 }
+    else if x == 343 { return 43 }
+    else if x == 344 { return 44 }
+    else if x == 345 { return 45 }
+    else if x == 346 { return 46 }
+    else if x == 347 { return 47 }
+    else if x == 348 { return 48 }
+    else if x == 349 { return 49 }
+    else if x == 350 { return 50 }
+    else if x == 351 { return 51 }
+    else if x == 352 { return 52 }
+    else if x == 353 { return 53 }
+    else if x == 354 { return 54 }
+    else if x == 355 { return 55 }
+    else if x == 356 { return 56 }
+    else if x == 357 { return 57 }
+    else if x == 358 { return 58 }
+    else if x == 359 { return 59 }
+    else if x == 360 { return 60 }
+    else if x == 361 { return 61 }
+    else if x == 362 { return 62 }
+    else if x == 363 { return 63 }
+    else if x == 364 { return 64 }
+    else if x == 365 { return 65 }
+    else if x == 366 { return 66 }
+    else if x == 367 { return 67 }
+    else if x == 368 { return 68 }
+    else if x == 369 { return 69 }
+    else if x == 370 { return 70 }
+    else if x == 371 { return 71 }
+    else if x == 372 { return 72 }
+    else if x == 373 { return 73 }
+    else if x == 374 { return 74 }
+    else if x == 375 { return 75 }
+    else if x == 376 { return 76 }
+    else if x == 377 { return 77 }
+    else if x == 378 { return 78 }
+    else if x == 379 { return 79 }
+    else if x == 380 { return 80 }
+    else if x == 381 { return 81 }
+    else if x == 382 { return 82 }
+    else if x == 383 { return 83 }
+    else if x == 384 { return 84 }
+    else if x == 385 { return 85 }
+    else if x == 386 { return 86 }
+    else if x == 387 { return 87 }
+    else if x == 388 { return 88 }
+    else if x == 389 { return 89 }
+    else if x == 390 { return 90 }
+    else if x == 391 { return 91 }
+    else if x == 392 { return 92 }
+    else if x == 393 { return 93 }
+    else if x == 394 { return 94 }
+    else if x == 395 { return 95 }
+    else if x == 396 { return 96 }
+    else if x == 397 { return 97 }
+    else if x == 398 { return 98 }
+    else if x == 399 { return 99 }
+    else if x == 400 { return 0 }
+    else if x == 401 { return 1 }
+    else if x == 402 { return 2 }
+    else if x == 403 { return 3 }
+    else if x == 404 { return 4 }
+    else if x == 405 { return 5 }
+    else if x == 406 { return 6 }
+    else if x == 407 { return 7 }
+    else if x == 408 { return 8 }
+    else if x == 409 { return 9 }
+    else if x == 410 { return 10 }
+    else if x == 411 { return 11 }
+    else if x == 412 { return 12 }
+    else if x == 413 { return 13 }
+    else if x == 414 { return 14 }
+    else if x == 415 { return 15 }
+    else if x == 416 { return 16 }
+    else if x == 417 { return 17 }
+    else if x == 418 { return 18 }
+    else if x == 419 { return 19 }
+    else if x == 420 { return 20 }
+    else if x == 421 { return 21 }
+    else if x == 422 { return 22 }
+    else if x == 423 { return 23 }
+    else if x == 424 { return 24 }
+    else if x == 425 { return 25 }
+    else if x == 426 { return 26 }
+    else if x == 427 { return 27 }
+    else if x == 428 { return 28 }
+    else if x == 429 { return 29 }
+    else if x == 430 { return 30 }
+    else if x == 431 { return 31 }
+    else if x == 432 { return 32 }
+    else if x == 433 { return 33 }
+    else if x == 434 { return 34 }
+    else if x == 435 { return 35 }
+    else if x == 436 { return 36 }
+    else if x == 437 { return 37 }
+    else if x == 438 { return 38 }
+    else if x == 439 { return 39 }
+    else if x == 440 { return 40 }
+    else if x == 441 { return 41 }
+    else if x == 442 { return 42 }
+    else if x == 443 { return 43 }
+    else if x == 444 { return 44 }
+    else if x == 445 { return 45 }
+    else if x == 446 { return 46 }
+    else if x == 447 { return 47 }
+    else if x == 448 { return 48 }
+    else if x == 449 { return 49 }
+    else if x == 450 { return 50 }
+    else if x == 451 { return 51 }
+    else if x == 452 { return 52 }
+    else if x == 453 { return 53 }
+    else if x == 454 { return 54 }
+    else if x == 455 { return 55 }
+    else if x == 456 { return 56 }
+    else if x == 457 { return 57 }
+    else if x == 458 { return 58 }
+    else if x == 459 { return 59 }
+    else if x == 460 { return 60 }
+    else if x == 461 { return 61 }
+    else if x == 462 { return 62 }
+    else if x == 463 { return 63 }
+    else if x == 464 { return 64 }
+    else if x == 465 { return 65 }
+    else if x == 466 { return 66 }
+    else if x == 467 { return 67 }
+    else if x == 468 { return 68 }
+    else if x == 469 { return 69 }
+    else if x == 470 { return 70 }
+    else if x == 471 { return 71 }
+    else if x == 472 { return 72 }
+    else if x == 473 { return 73 }
+    else if x == 474 { return 74 }
+    else if x == 475 { return 75 }
+    else if x == 476 { return 76 }
+    else if x == 477 { return 77 }
+    else if x == 478 { return 78 }
+    else if x == 479 { return 79 }
+    else if x == 480 { return 80 }
+    else if x == 481 { return 81 }
+    else if x == 482 { return 82 }
+    else if x == 483 { return 83 }
+    else if x == 484 { return 84 }
+    else if x == 485 { return 85 }
+    else if x == 486 { return 86 }
+    else if x == 487 { return 87 }
+    else if x == 488 { return 88 }
+    else if x == 489 { return 89 }
+    else if x == 490 { return 90 }
+    else if x == 491 { return 91 }
+    else if x == 492 { return 92 }
+    else if x == 493 { return 93 }
+    else if x == 494 { return 94 }
+    else if x == 495 { return 95 }
+    else if x == 496 { return 96 }
+    else if x == 497 { return 97 }
+    else if x == 498 { return 98 }
+    else if x == 499 { return 99 }
+    else if x == 500 { return 0 }
+    else if x == 501 { return 1 }
+    else if x == 502 { return 2 }
+    else if x == 503 { return 3 }
+    else if x == 504 { return 4 }
+    else if x == 505 { return 5 }
+    else if x == 506 { return 6 }
+    else if x == 507 { return 7 }
+    else if x == 508 { return 8 }
+    else if x == 509 { return 9 }
+    else if x == 510 { return 10 }
+    else if x == 511 { return 11 }
+    else if x == 512 { return 12 }
+    else if x == 513 { return 13 }
+    else if x == 514 { return 14 }
+    else if x == 515 { return 15 }
+    else if x == 516 { return 16 }
+    else if x == 517 { return 17 }
+    else if x == 518 { return 18 }
+    else if x == 519 { return 19 }
+    else if x == 520 { return 20 }
+    else if x == 521 { return 21 }
+    else if x == 522 { return 22 }
+    else if x == 523 { return 23 }
+    else if x == 524 { return 24 }
+    else if x == 525 { return 25 }
+    else if x == 526 { return 26 }
+    else if x == 527 { return 27 }
+    else if x == 528 { return 28 }
+    else if x == 529 { return 29 }
+    else if x == 530 { return 30 }
+    else if x == 531 { return 31 }
+    else if x == 532 { return 32 }
+    else if x == 533 { return 33 }
+    else if x == 534 { return 34 }
+    else if x == 535 { return 35 }
+    else if x == 536 { return 36 }
+    else if x == 537 { return 37 }
+    else if x == 538 { return 38 }
+    else if x == 539 { return 39 }
+    else if x == 540 { return 40 }
+    else if x == 541 { return 41 }
+    else if x == 542 { return 42 }
+    else if x == 543 { return 43 }
+    else if x == 544 { return 44 }
+    else if x == 545 { return 45 }
+    else if x == 546 { return 46 }
+    else if x == 547 { return 47 }
+    else if x == 548 { return 48 }
+    else if x == 549 { return 49 }
+    else if x == 550 { return 50 }
+    else if x == 551 { return 51 }
+    else if x == 552 { return 52 }
+    else if x == 553 { return 53 }
+    else if x == 554 { return 54 }
+    else if x == 555 { return 55 }
+    else if x == 556 { return 56 }
+    else if x == 557 { return 57 }
+    else if x == 558 { return 58 }
+    else if x == 559 { return 59 }
+    else if x == 560 { return 60 }
+    else if x == 561 { return 61 }
+    else if x == 562 { return 62 }
+    else if x == 563 { return 63 }
+    else if x == 564 { return 64 }
+    else if x == 565 { return 65 }
+    else if x == 566 { return 66 }
+    else if x == 567 { return 67 }
+    else if x == 568 { return 68 }
+    else if x == 569 { return 69 }
+    else if x == 570 { return 70 }
+    else if x == 571 { return 71 }
+    else if x == 572 { return 72 }
+    else if x == 573 { return 73 }
+    else if x == 574 { return 74 }
+    else if x == 575 { return 75 }
+    else if x == 576 { return 76 }
+    else if x == 577 { return 77 }
+    else if x == 578 { return 78 }
+    else if x == 579 { return 79 }
+    else if x == 580 { return 80 }
+    else if x == 581 { return 81 }
+    else if x == 582 { return 82 }
+    else if x == 583 { return 83 }
+    else if x == 584 { return 84 }
+    else if x == 585 { return 85 }
+    else if x == 586 { return 86 }
+    else if x == 587 { return 87 }
+    else if x == 588 { return 88 }
+    else if x == 589 { return 89 }
+    else if x == 590 { return 90 }
+    else if x == 591 { return 91 }
+    else if x == 592 { return 92 }
+    else if x == 593 { return 93 }
+    else if x == 594 { return 94 }
+    else if x == 595 { return 95 }
+    else if x == 596 { return 96 }
+    else if x == 597 { return 97 }
+    else if x == 598 { return 98 }
+    else if x == 599 { return 99 }
+    else if x == 600 { return 0 }
+    else if x == 601 { return 1 }
+    else if x == 602 { return 2 }
+    else if x == 603 { return 3 }
+    else if x == 604 { return 4 }
+    else if x == 605 { return 5 }
+    else if x == 606 { return 6 }
+    else if x == 607 { return 7 }
+    else if x == 608 { return 8 }
+    else if x == 609 { return 9 }
+    else if x == 610 { return 10 }
+    else if x == 611 { return 11 }
+    else if x == 612 { return 12 }
+    else if x == 613 { return 13 }
+    else if x == 614 { return 14 }
+    else if x == 615 { return 15 }
+    else if x == 616 { return 16 }
+    else if x == 617 { return 17 }
+    else if x == 618 { return 18 }
+    else if x == 619 { return 19 }
+    else if x == 620 { return 20 }
+    else if x == 621 { return 21 }
+    else if x == 622 { return 22 }
+    else if x == 623 { return 23 }
+    else if x == 624 { return 24 }
+    else if x == 625 { return 25 }
+    else if x == 626 { return 26 }
+    else if x == 627 { return 27 }
+    else if x == 628 { return 28 }
+    else if x == 629 { return 29 }
+    else if x == 630 { return 30 }
+    else if x == 631 { return 31 }
+    else if x == 632 { return 32 }
+    else if x == 633 { return 33 }
+    else if x == 634 { return 34 }
+    else if x == 635 { return 35 }
+    else if x == 636 { return 36 }
+    else if x == 637 { return 37 }
+    else if x == 638 { return 38 }
+    else if x == 639 { return 39 }
+    else if x == 640 { return 40 }
+    else if x == 641 { return 41 }
+    else if x == 642 { return 42 }
+    else if x == 643 { return 43 }
+    else if x == 644 { return 44 }
+    else if x == 645 { return 45 }
+    else if x == 646 { return 46 }
+    else if x == 647 { return 47 }
+    else if x == 648 { return 48 }
+    else if x == 649 { return 49 }
+    else if x == 650 { return 50 }
+    else if x == 651 { return 51 }
+    else if x == 652 { return 52 }
+    else if x == 653 { return 53 }
+    else if x == 654 { return 54 }
+    else if x == 655 { return 55 }
+    else if x == 656 { return 56 }
+    else if x == 657 { return 57 }
+    else if x == 658 { return 58 }
+    else if x == 659 { return 59 }
+    else if x == 660 { return 60 }
+    else if x == 661 { return 61 }
+    else if x == 662 { return 62 }
+    else if x == 663 { return 63 }
+    else if x == 664 { return 64 }
+    else if x == 665 { return 65 }
+    else if x == 666 { return 66 }
+    else if x == 667 { return 67 }
+    else if x == 668 { return 68 }
+    else if x == 669 { return 69 }
+    else if x == 670 { return 70 }
+    else if x == 671 { return 71 }
+    else if x == 672 { return 72 }
+    else if x == 673 { return 73 }
+    else if x == 674 { return 74 }
+    else if x == 675 { return 75 }
+    else if x == 676 { return 76 }
+    else if x == 677 { return 77 }
+    else if x == 678 { return 78 }
+    else if x == 679 { return 79 }
+    else if x == 680 { return 80 }
+    else if x == 681 { return 81 }
+    else if x == 682 { return 82 }
+    else if x == 683 { return 83 }
+    else if x == 684 { return 84 }
+    else if x == 685 { return 85 }
+    else if x == 686 { return 86 }
+    else if x == 687 { return 87 }
+    else if x == 688 { return 88 }
+    else if x == 689 { return 89 }
+    else if x == 690 { return 90 }
+    else if x == 691 { return 91 }
+    else if x == 692 { return 92 }
+    else if x == 693 { return 93 }
+    else if x == 694 { return 94 }
+    else if x == 695 { return 95 }
+    else if x == 696 { return 96 }
+    else if x == 697 { return 97 }
+    else if x == 698 { return 98 }
+    else if x == 699 { return 99 }
+    else if x == 700 { return 0 }
+    else if x == 701 { return 1 }
+    else if x == 702 { return 2 }
+    else if x == 703 { return 3 }
+    else if x == 704 { return 4 }
+    else if x == 705 { return 5 }
+    else if x == 706 { return 6 }
+    else if x == 707 { return 7 }
+    else if x == 708 { return 8 }
+    else if x == 709 { return 9 }
+    else if x == 710 { return 10 }
+    else if x == 711 { return 11 }
+    else if x == 712 { return 12 }
+    else if x == 713 { return 13 }
+    else if x == 714 { return 14 }
+    else if x == 715 { return 15 }
+    else if x == 716 { return 16 }
+    else if x == 717 { return 17 }
+    else if x == 718 { return 18 }
+    else if x == 719 { return 19 }
+    else if x == 720 { return 20 }
+    else if x == 721 { return 21 }
+    else if x == 722 { return 22 }
+    else if x == 723 { return 23 }
+    else if x == 724 { return 24 }
+    else if x == 725 { return 25 }
+    else if x == 726 { return 26 }
+    else if x == 727 { return 27 }
+    else if x == 728 { return 28 }
+    else if x == 729 { return 29 }
+    else if x == 730 { return 30 }
+    else if x == 731 { return 31 }
+    else if x == 732 { return 32 }
+    else if x == 733 { return 33 }
+    else if x == 734 { return 34 }
+    else if x == 735 { return 35 }
+    else if x == 736 { return 36 }
+    else if x == 737 { return 37 }
+    else if x == 738 { return 38 }
+    else if x == 739 { return 39 }
+    else if x == 740 { return 40 }
+    else if x == 741 { return 41 }
+    else if x == 742 { return 42 }
+    else if x == 743 { return 43 }
+    else if x == 744 { return 44 }
+    else if x == 745 { return 45 }
+    else if x == 746 { return 46 }
+    else if x == 747 { return 47 }
+    else if x == 748 { return 48 }
+    else if x == 749 { return 49 }
+    else if x == 750 { return 50 }
+    else if x == 751 { return 51 }
+    else if x == 752 { return 52 }
+    else if x == 753 { return 53 }
+    else if x == 754 { return 54 }
+    else if x == 755 { return 55 }
+    else if x == 756 { return 56 }
+    else if x == 757 { return 57 }
+    else if x == 758 { return 58 }
+    else if x == 759 { return 59 }
+    else if x == 760 { return 60 }
+    else if x == 761 { return 61 }
+    else if x == 762 { return 62 }
+    else if x == 763 { return 63 }
+    else if x == 764 { return 64 }
+    else if x == 765 { return 65 }
+    else if x == 766 { return 66 }
+    else if x == 767 { return 67 }
+    else if x == 768 { return 68 }
+    else if x == 769 { return 69 }
+    else if x == 770 { return 70 }
+    else if x == 771 { return 71 }
+    else if x == 772 { return 72 }
+    else if x == 773 { return 73 }
+    else if x == 774 { return 74 }
+    else if x == 775 { return 75 }
+    else if x == 776 { return 76 }
+    else if x == 777 { return 77 }
+    else if x == 778 { return 78 }
+    else if x == 779 { return 79 }
+    else if x == 780 { return 80 }
+    else if x == 781 { return 81 }
+    else if x == 782 { return 82 }
+    else if x == 783 { return 83 }
+    else if x == 784 { return 84 }
+    else if x == 785 { return 85 }
+    else if x == 786 { return 86 }
+    else if x == 787 { return 87 }
+    else if x == 788 { return 88 }
+    else if x == 789 { return 89 }
+    else if x == 790 { return 90 }
+    else if x == 791 { return 91 }
+    else if x == 792 { return 92 }
+    else if x == 793 { return 93 }
+    else if x == 794 { return 94 }
+    else if x == 795 { return 95 }
+    else if x == 796 { return 96 }
+    else if x == 797 { return 97 }
+    else if x == 798 { return 98 }
+    else if x == 799 { return 99 }
+    else if x == 800 { return 0 }
+    else if x == 801 { return 1 }
+    else if x == 802 { return 2 }
+    else if x == 803 { return 3 }
+    else if x == 804 { return 4 }
+    else if x == 805 { return 5 }
+    else if x == 806 { return 6 }
+    else if x == 807 { return 7 }
+    else if x == 808 { return 8 }
+    else if x == 809 { return 9 }
+    else if x == 810 { return 10 }
+    else if x == 811 { return 11 }
+    else if x == 812 { return 12 }
+    else if x == 813 { return 13 }
+    else if x == 814 { return 14 }
+    else if x == 815 { return 15 }
+    else if x == 816 { return 16 }
+    else if x == 817 { return 17 }
+    else if x == 818 { return 18 }
+    else if x == 819 { return 19 }
+    else if x == 820 { return 20 }
+    else if x == 821 { return 21 }
+    else if x == 822 { return 22 }
+    else if x == 823 { return 23 }
+    else if x == 824 { return 24 }
+    else if x == 825 { return 25 }
+    else if x == 826 { return 26 }
+    else if x == 827 { return 27 }
+    else if x == 828 { return 28 }
+    else if x == 829 { return 29 }
+    else if x == 830 { return 30 }
+    else if x == 831 { return 31 }
+    else if x == 832 { return 32 }
+    else if x == 833 { return 33 }
+    else if x == 834 { return 34 }
+    else if x == 835 { return 35 }
+    else if x == 836 { return 36 }
+    else if x == 837 { return 37 }
+    else if x == 838 { return 38 }
+    else if x == 839 { return 39 }
+    else if x == 840 { return 40 }
+    else if x == 841 { return 41 }
+    else if x == 842 { return 42 }
+    else if x == 843 { return 43 }
+    else if x == 844 { return 44 }
+    else if x == 845 { return 45 }
+    else if x == 846 { return 46 }
+    else if x == 847 { return 47 }
+    else if x == 848 { return 48 }
+    else if x == 849 { return 49 }
+    else if x == 850 { return 50 }
+    else if x == 851 { return 51 }
+    else if x == 852 { return 52 }
+    else if x == 853 { return 53 }
+    else if x == 854 { return 54 }
+    else if x == 855 { return 55 }
+    else if x == 856 { return 56 }
+    else if x == 857 { return 57 }
+    else if x == 858 { return 58 }
+    else if x == 859 { return 59 }
+    else if x == 860 { return 60 }
+    else if x == 861 { return 61 }
+    else if x == 862 { return 62 }
+    else if x == 863 { return 63 }
+    else if x == 864 { return 64 }
+    else if x == 865 { return 65 }
+    else if x == 866 { return 66 }
+    else if x == 867 { return 67 }
+    else if x == 868 { return 68 }
+    else if x == 869 { return 69 }
+    else if x == 870 { return 70 }
+    else if x == 871 { return 71 }
+    else if x == 872 { return 72 }
+    else if x == 873 { return 73 }
+    else if x == 874 { return 74 }
+    else if x == 875 { return 75 }
+    else if x == 876 { return 76 }
+    else if x == 877 { return 77 }
+    else if x == 878 { return 78 }
+    else if x == 879 { return 79 }
+    else if x == 880 { return 80 }
+    else if x == 881 { return 81 }
+    else if x == 882 { return 82 }
+    else if x == 883 { return 83 }
+    else if x == 884 { return 84 }
+    else if x == 885 { return 85 }
+    else if x == 886 { return 86 }
+    else if x == 887 { return 87 }
+    else if x == 888 { return 88 }
+    else if x == 889 { return 89 }
+    else if x == 890 { return 90 }
+    else if x == 891 { return 91 }
+    else if x == 892 { return 92 }
+    else if x == 893 { return 93 }
+    else if x == 894 { return 94 }
+    else if x == 895 { return 95 }
+    else if x == 896 { return 96 }
+    else if x == 897 { return 97 }
+    else if x == 898 { return 98 }
+    else if x == 899 { return 99 }
+    else if x == 900 { return 0 }
+    else if x == 901 { return 1 }
+    else if x == 902 { return 2 }
+    else if x == 903 { return 3 }
+    else if x == 904 { return 4 }
+    else if x == 905 { return 5 }
+    else if x == 906 { return 6 }
+    else if x == 907 { return 7 }
+    else if x == 908 { return 8 }
+    else if x == 909 { return 9 }
+    else if x == 910 { return 10 }
+    else if x == 911 { return 11 }
+    else if x == 912 { return 12 }
+    else if x == 913 { return 13 }
+    else if x == 914 { return 14 }
+    else if x == 915 { return 15 }
+    else if x == 916 { return 16 }
+    else if x == 917 { return 17 }
+    else if x == 918 { return 18 }
+    else if x == 919 { return 19 }
+    else if x == 920 { return 20 }
+    else if x == 921 { return 21 }
+    else if x == 922 { return 22 }
+    else if x == 923 { return 23 }
+    else if x == 924 { return 24 }
+    else if x == 925 { return 25 }
+    else if x == 926 { return 26 }
+    else if x == 927 { return 27 }
+    else if x == 928 { return 28 }
+    else if x == 929 { return 29 }
+    else if x == 930 { return 30 }
+    else if x == 931 { return 31 }
+    else if x == 932 { return 32 }
+    else if x == 933 { return 33 }
+    else if x == 934 { return 34 }
+    else if x == 935 { return 35 }
+    else if x == 936 { return 36 }
+    else if x == 937 { return 37 }
+    else if x == 938 { return 38 }
+    else if x == 939 { return 39 }
+    else if x == 940 { return 40 }
+    else if x == 941 { return 41 }
+    else if x == 942 { return 42 }
+    else if x == 943 { return 43 }
+    else if x == 944 { return 44 }
+    else if x == 945 { return 45 }
+    else if x == 946 { return 46 }
+    else if x == 947 { return 47 }
+    else if x == 948 { return 48 }
+    else if x == 949 { return 49 }
+    else if x == 950 { return 50 }
+    else if x == 951 { return 51 }
+    else if x == 952 { return 52 }
+    else if x == 953 { return 53 }
+    else if x == 954 { return 54 }
+    else if x == 955 { return 55 }
+    else if x == 956 { return 56 }
+    else if x == 957 { return 57 }
+    else if x == 958 { return 58 }
+    else if x == 959 { return 59 }
+    else if x == 960 { return 60 }
+    else if x == 961 { return 61 }
+    else if x == 962 { return 62 }
+    else if x == 963 { return 63 }
+    else if x == 964 { return 64 }
+    else if x == 965 { return 65 }
+    else if x == 966 { return 66 }
+    else if x == 967 { return 67 }
+    else if x == 968 { return 68 }
+    else if x == 969 { return 69 }
+    else if x == 970 { return 70 }
+    else if x == 971 { return 71 }
+    else if x == 972 { return 72 }
+    else if x == 973 { return 73 }
+    else if x == 974 { return 74 }
+    else if x == 975 { return 75 }
+    else if x == 976 { return 76 }
+    else if x == 977 { return 77 }
+    else if x == 978 { return 78 }
+    else if x == 979 { return 79 }
+    else if x == 980 { return 80 }
+    else if x == 981 { return 81 }
+    else if x == 982 { return 82 }
+    else if x == 983 { return 83 }
+    else if x == 984 { return 84 }
+    else if x == 985 { return 85 }
+    else if x == 986 { return 86 }
+    else if x == 987 { return 87 }
+    else if x == 988 { return 88 }
+    else if x == 989 { return 89 }
+    else if x == 990 { return 90 }
+    else if x == 991 { return 91 }
+    else if x == 992 { return 92 }
+    else if x == 993 { return 93 }
+    else if x == 994 { return 94 }
+    else if x == 995 { return 95 }
+    else if x == 996 { return 96 }
+    else if x == 997 { return 97 }
+    else if x == 998 { return 98 }
+    else if x == 999 { return 99 }
+    else if x == 1000 { return 0 }
+    else if x == 1001 { return 1 }
+    else if x == 1002 { return 2 }
+    else if x == 1003 { return 3 }
+    else if x == 1004 { return 4 }
+    else if x == 1005 { return 5 }
+    else if x == 1006 { return 6 }
+    else if x == 1007 { return 7 }
+    else if x == 1008 { return 8 }
+    else if x == 1009 { return 9 }
+    else if x == 1010 { return 10 }
+    else if x == 1011 { return 11 }
+    else if x == 1012 { return 12 }
+    else if x == 1013 { return 13 }
+    else if x == 1014 { return 14 }
+    else if x == 1015 { return 15 }
+    else if x == 1016 { return 16 }
+    else if x == 1017 { return 17 }
+    else if x == 1018 { return 18 }
+    else if x == 1019 { return 19 }
+    else if x == 1020 { return 20 }
+    else if x == 1021 { return 21 }
+    else if x == 1022 { return 22 }
+    else if x == 1023 { return 23 }
+    else if x == 1024 { return 24 }
+    else if x == 1025 { return 25 }
+    else if x == 1026 { return 26 }
+    else if x == 1027 { return 27 }
+    else if x == 1028 { return 28 }
+    else if x == 1029 { return 29 }
+    else if x == 1030 { return 30 }
+    else if x == 1031 { return 31 }
+    else if x == 1032 { return 32 }
+    else if x == 1033 { return 33 }
+    else if x == 1034 { return 34 }
+    else if x == 1035 { return 35 }
+    else if x == 1036 { return 36 }
+    else if x == 1037 { return 37 }
+    else if x == 1038 { return 38 }
+    else if x == 1039 { return 39 }
+    else if x == 1040 { return 40 }
+    else if x == 1041 { return 41 }
+    else if x == 1042 { return 42 }
+    else if x == 1043 { return 43 }
+    else if x == 1044 { return 44 }
+    else if x == 1045 { return 45 }
+    else if x == 1046 { return 46 }
+    else if x == 1047 { return 47 }
+    else if x == 1048 { return 48 }
+    else if x == 1049 { return 49 }
+    else if x == 1050 { return 50 }
+    else if x == 1051 { return 51 }
+    else if x == 1052 { return 52 }
+    else if x == 1053 { return 53 }
+    else if x == 1054 { return 54 }
+    else if x == 1055 { return 55 }
+    else if x == 1056 { return 56 }
+    else if x == 1057 { return 57 }
+    else if x == 1058 { return 58 }
+    else if x == 1059 { return 59 }
+    else if x == 1060 { return 60 }
+    else if x == 1061 { return 61 }
+    else if x == 1062 { return 62 }
+    else if x == 1063 { return 63 }
+    else if x == 1064 { return 64 }
+    else if x == 1065 { return 65 }
+    else if x == 1066 { return 66 }
+    else if x == 1067 { return 67 }
+    else if x == 1068 { return 68 }
+    else if x == 1069 { return 69 }
+    else if x == 1070 { return 70 }
+    else if x == 1071 { return 71 }
+    else if x == 1072 { return 72 }
+    else if x == 1073 { return 73 }
+    else if x == 1074 { return 74 }
+    else if x == 1075 { return 75 }
+    else if x == 1076 { return 76 }
+    else if x == 1077 { return 77 }
+    else if x == 1078 { return 78 }
+    else if x == 1079 { return 79 }
+    else if x == 1080 { return 80 }
+    else if x == 1081 { return 81 }
+    else if x == 1082 { return 82 }
+    else if x == 1083 { return 83 }
+    else if x == 1084 { return 84 }
+    else if x == 1085 { return 85 }
+    else if x == 1086 { return 86 }
+    else if x == 1087 { return 87 }
+    else if x == 1088 { return 88 }
+    else if x == 1089 { return 89 }
+    else if x == 1090 { return 90 }
+    else if x == 1091 { return 91 }
+    else if x == 1092 { return 92 }
+    else if x == 1093 { return 93 }
+    else if x == 1094 { return 94 }
+    else if x == 1095 { return 95 }
+    else if x == 1096 { return 96 }
+    else if x == 1097 { return 97 }
+    else if x == 1098 { return 98 }
+    else if x == 1099 { return 99 }
+    else { return 0 - 1 }
+}
@@ -0,0 +1,3 @@
+f(int64 x) int64 {
+    return x + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1 * 2 + 3 - 4 * 5 + 6 - 7 * 1 + 2 - 3 * 4 + 5 - 6 * 7 + 1 - 2 * 3 + 4 - 5 * 6 + 7 - 1
+}
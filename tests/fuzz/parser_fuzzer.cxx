@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <parser.hxx>
+#include <error.hxx>
+
+#include <flex/FlexLexer.h>
+
+/*
+ * Fuzz harness for the lexer and parser.
+ *
+ * Besides crashes, an input fails when the time or the peak heap usage spent
+ * on it exceeds a fixed allowance plus a per-byte budget, which is how
+ * super-linear behaviour shows up.
+ *
+ * Built against libFuzzer when VSHARP_LIBFUZZER is defined. Otherwise it
+ * provides its own main() that runs every file (or directory of files) given
+ * on the command line, or stdin when there are none, which is what AFL and
+ * plain reproduction runs need.
+ */
+
+extern const std::string *Source;
+
+namespace
+{
+    constexpr double TimeBaseMs = 100.0;
+    constexpr double TimePerByteMs = 0.02;
+    constexpr size_t MemoryBase = 4u << 20;
+    constexpr size_t MemoryPerByte = 1024;
+
+    size_t liveBytes = 0;
+    size_t peakBytes = 0;
+    bool tracking = false;
+
+    // Every allocation carries its size in front so deallocation can update
+    // the live byte count without relying on sized delete.
+    constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+    void *allocate(size_t size)
+    {
+        auto *raw = static_cast<unsigned char *>(std::malloc(size + HeaderSize));
+        if (!raw)
+            throw std::bad_alloc();
+        *reinterpret_cast<size_t *>(raw) = size;
+        if (tracking)
+        {
+            liveBytes += size;
+            if (liveBytes > peakBytes)
+                peakBytes = liveBytes;
+        }
+        return raw + HeaderSize;
+    }
+
+    void deallocate(void *ptr) noexcept
+    {
+        if (!ptr)
+            return;
+        auto *raw = static_cast<unsigned char *>(ptr) - HeaderSize;
+        size_t size = *reinterpret_cast<size_t *>(raw);
+        if (tracking)
+            liveBytes = size > liveBytes ? 0 : liveBytes - size;
+        std::free(raw);
+    }
+
+    void parseInput(const std::string &input)
+    {
+        Source = &input;
+        currentFile = "<fuzz>";
+        column = 1;
+
+        try
+        {
+            std::istringstream ss(input);
+            yyFlexLexer lexer(&ss);
+            Parser parser(lexer, input);
+            ASTNodePtr ast = parser.parserProgram();
+        }
+        catch (const CompileError &)
+        {
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+void operator delete(void *ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { deallocate(ptr); }
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    Error::setThrowing(true);
+
+    std::string input(reinterpret_cast<const char *>(data), size);
+
+    liveBytes = 0;
+    peakBytes = 0;
+    tracking = true;
+    auto start = std::chrono::steady_clock::now();
+
+    parseInput(input);
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    tracking = false;
+
+    double timeBudget = TimeBaseMs + TimePerByteMs * size;
+    size_t memoryBudget = MemoryBase + MemoryPerByte * size;
+    if (elapsed > timeBudget)
+    {
+        std::fprintf(stderr, "parser_fuzzer: %zu byte input took %.1f ms (budget %.1f ms)\n", size, elapsed, timeBudget);
+        std::abort();
+    }
+    if (peakBytes > memoryBudget)
+    {
+        std::fprintf(stderr, "parser_fuzzer: %zu byte input peaked at %zu heap bytes (budget %zu)\n", size, peakBytes, memoryBudget);
+        std::abort();
+    }
+    return 0;
+}
+
+#ifndef VSHARP_LIBFUZZER
+static void runBytes(const std::string &bytes)
+{
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+}
+
+static void runFile(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    runBytes(bytes);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::string bytes((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        runBytes(bytes);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path))
+        {
+            for (const auto &entry : std::filesystem::directory_iterator(path))
+                if (entry.is_regular_file())
+                    runFile(entry.path());
+        }
+        else
+        {
+            runFile(path);
+        }
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <string>
+#include <hierarchy.hxx>
+
+#include "support.hxx"
+
+static ClassDeclNode *classNamed(ASTNode *program, const std::string &name)
+{
+    for (auto &child : static_cast<BlockNode *>(program)->children)
+        if (child->type == ASTNodeType::ClassDecl && static_cast<ClassDeclNode *>(child.get())->name == name)
+            return static_cast<ClassDeclNode *>(child.get());
+    fail(name, "missing class");
+    std::exit(1);
+}
+
+static Symbol *method(ASTNode *program, const std::string &cls, const std::string &name)
+{
+    for (auto &child : static_cast<BlockNode *>(classNamed(program, cls)->body.get())->children)
+        if (child->type == ASTNodeType::FunctionDecl && static_cast<FunctionDeclNode *>(child.get())->name == name)
+            return static_cast<FunctionDeclNode *>(child.get())->symbol;
+    fail(cls + "." + name, "missing method");
+    std::exit(1);
+}
+
+// Shape.area has two overrides; Square's subclass Tile inherits Square's.
+static const std::string Shapes = R"(class Shape {
+    public virtual area() int64 { return 0 }
+    public virtual sides() int64 { return 0 }
+    public describe() int64 { return area() * 10 + sides() }
+}
+class Square : Shape {
+    var side : int64 = 3
+    public override area() int64 { return side * side }
+    public override sides() int64 { return 4 }
+    public twice() int64 { return area() * 2 }
+}
+class Tile : Square {
+    public override sides() int64 { return 5 }
+}
+class Circle : Shape {
+    public override area() int64 { return 7 }
+}
+main() int64 {
+    return Square().describe() + Circle().area() + Tile().twice() + Tile().sides()
+}
+)";
+
+static void TestVtables()
+{
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(Shapes, symbols, types);
+    ClassHierarchy hierarchy;
+    hierarchy.build(ast.get(), *Source);
+
+    const Symbol *shape = classNamed(ast.get(), "Shape")->symbol;
+    const Symbol *square = classNamed(ast.get(), "Square")->symbol;
+    const Symbol *tile = classNamed(ast.get(), "Tile")->symbol;
+    Symbol *area = method(ast.get(), "Shape", "area");
+    Symbol *sides = method(ast.get(), "Shape", "sides");
+
+    // Overrides take the slot of the method they override.
+    expect(hierarchy.slot(area) == 0 && hierarchy.slot(sides) == 1, "TestVtables", "base slots not assigned in order");
+    expect(hierarchy.slot(method(ast.get(), "Square", "area")) == 0 && hierarchy.slot(method(ast.get(), "Tile", "sides")) == 1,
+           "TestVtables", "override did not reuse the inherited slot");
+    expect(hierarchy.slot(method(ast.get(), "Shape", "describe")) == -1, "TestVtables", "non-virtual method got a slot");
+    expect(hierarchy.vtable(shape).size() == 2 && hierarchy.vtable(tile).size() == 2 && hierarchy.hasVtable(tile),
+           "TestVtables", "vtable sizes differ across the hierarchy");
+
+    expect(hierarchy.implementation(tile, area) == method(ast.get(), "Square", "area"), "TestVtables",
+           "Tile does not inherit Square.area");
+    expect(hierarchy.implementation(tile, sides) == method(ast.get(), "Tile", "sides"), "TestVtables",
+           "Tile.sides not in Tile's vtable");
+
+    // Square and Tile share area but not sides; Shape has three areas.
+    expect(hierarchy.uniqueImplementation(square, area) == method(ast.get(), "Square", "area"), "TestVtables",
+           "area under Square is not unique");
+    expect(!hierarchy.uniqueImplementation(square, sides), "TestVtables", "sides under Square has two targets");
+    expect(!hierarchy.uniqueImplementation(shape, area), "TestVtables", "area under Shape has three targets");
+    std::cout << "[PASS] TestVtables\n";
+}
+
+static void TestDevirtualize()
+{
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(Shapes, symbols, types);
+    ClassHierarchy hierarchy;
+    hierarchy.build(ast.get(), *Source);
+
+    // Fresh receivers: Circle().area() and Tile().sides(). Inside Square,
+    // area() reaches Square.area only. describe() on Shape stays virtual.
+    size_t direct = devirtualize(ast.get(), hierarchy);
+    expect(direct == 3, "TestDevirtualize", std::to_string(direct) + " calls made direct");
+
+    Module module = compile(Shapes, 0);
+    expect(count(function(module, "Shape.describe"), Opcode::CallVirtual) == 2, "TestDevirtualize",
+           "calls on an unknown receiver were bound");
+    expect(count(function(module, "Square.twice"), Opcode::CallVirtual) == 0 && count(function(module, "main"), Opcode::CallVirtual) == 0,
+           "TestDevirtualize", "provably direct calls were left virtual");
+    expect(runVM(Shapes) == 94 + 7 + 18 + 5, "TestDevirtualize", "wrong result");
+    std::cout << "[PASS] TestDevirtualize\n";
+}
+
+static void TestOverrideDiagnostics()
+{
+    struct Case
+    {
+        const char *source;
+        const char *message;
+    };
+    const Case cases[] = {
+        {"class A {\n    public f() int64 { return 1 }\n}\nclass B : A {\n    public override f() int64 { return 2 }\n}\n",
+         "Method 'f' is marked override but overrides no virtual method"},
+        {"class A {\n    public virtual f(int64[x]) int64 { return x }\n}\nclass B : A {\n    public override f(int32[x]) int64 { return 2 }\n}\n",
+         "Method 'f' is marked override but overrides no virtual method"},
+        {"class A {\n    public virtual f() int64 { return 1 }\n}\nclass B : A {\n    public virtual f() int64 { return 2 }\n}\n",
+         "Method 'f' redeclares an inherited virtual method, mark it override"},
+        {"class A {\n    public virtual f() int64 { return 1 }\n}\nclass B : A {\n    public f() int64 { return 2 }\n}\n",
+         "Method 'f' hides an inherited virtual method, mark it override"},
+        {"class A {\n    public virtual f() int64 { return 1 }\n}\nclass B : A {\n}\nclass C : B {\n    public f() int64 { return 2 }\n}\n",
+         "Method 'f' hides an inherited virtual method, mark it override"},
+    };
+    for (const auto &c : cases)
+    {
+        std::string error = frontEndError(c.source);
+        expect(error == c.message, "TestOverrideDiagnostics", "expected \"" + std::string(c.message) + "\", got \"" + error + "\"");
+    }
+
+    // An overload with another signature neither overrides nor hides.
+    std::string overload = "class A {\n    public virtual f() int64 { return 1 }\n}\nclass B : A {\n    public f(int64[x]) int64 { return x }\n}\n";
+    expect(frontEndError(overload).empty(), "TestOverrideDiagnostics", "overload with a new signature rejected");
+    std::cout << "[PASS] TestOverrideDiagnostics\n";
+}
+
+int main()
+{
+    TestVtables();
+    TestDevirtualize();
+    TestOverrideDiagnostics();
+    return 0;
+}
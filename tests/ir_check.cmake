@@ -0,0 +1,46 @@
+# FileCheck-style IR test: compiles SOURCE at -O<LEVEL> with --emit-ir and
+# matches the IR against the `// CHECK-O<LEVEL>:` lines of SOURCE, in order.
+# A `// CHECK-O<LEVEL>-NEXT:` line must match the line right after the
+# previous match. Patterns are regular expressions matched within one line.
+#
+# usage: cmake -DVSHARP=<compiler> -DSOURCE=<file.vs> -DLEVEL=<n> -P ir_check.cmake
+
+execute_process(
+    COMMAND ${VSHARP} compile ${SOURCE} -O${LEVEL} --emit-ir --verify-ir
+    OUTPUT_VARIABLE ir
+    RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "-O${LEVEL}: compiling ${SOURCE} failed")
+endif()
+
+# Block comments in the IR hold semicolons, which would split list entries.
+string(REPLACE ";" "<semicolon>" lines "${ir}")
+string(REPLACE "\n" ";" lines "${lines}")
+list(LENGTH lines count)
+
+file(STRINGS ${SOURCE} checks REGEX "// CHECK-O${LEVEL}(-NEXT)?:")
+if(NOT checks)
+    message(FATAL_ERROR "${SOURCE} has no CHECK-O${LEVEL} lines")
+endif()
+
+set(at 0)
+foreach(check IN LISTS checks)
+    string(REGEX REPLACE "^.*// CHECK-O${LEVEL}(-NEXT)?: *" "" pattern "${check}")
+    string(FIND "${check}" "-NEXT:" next)
+    set(found OFF)
+    while(at LESS count)
+        list(GET lines ${at} text)
+        math(EXPR at "${at} + 1")
+        if(text MATCHES "${pattern}")
+            set(found ON)
+            break()
+        endif()
+        if(NOT next EQUAL -1)
+            break()
+        endif()
+    endwhile()
+    if(NOT found)
+        message(FATAL_ERROR "-O${LEVEL}: no match for '${check}' in:\n${ir}")
+    endif()
+endforeach()
@@ -0,0 +1,308 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <analysis.hxx>
+#include <dominators.hxx>
+
+#include "support.hxx"
+
+static int64_t branchTargets(BlockId onTrue, BlockId onFalse)
+{
+    return static_cast<int64_t>(onTrue) | static_cast<int64_t>(onFalse) << 32;
+}
+
+static void jump(Function &fn, BlockId from, BlockId to)
+{
+    fn.emit(from, Opcode::Jump, ValueType::Void, {}, to);
+    fn.addEdge(from, to);
+}
+
+static void branch(Function &fn, BlockId from, ValueId cond, BlockId onTrue, BlockId onFalse)
+{
+    fn.emit(from, Opcode::Branch, ValueType::Void, {cond}, branchTargets(onTrue, onFalse));
+    fn.addEdge(from, onTrue);
+    fn.addEdge(from, onFalse);
+}
+
+/*
+ * bb0 branches into both bb1 and bb2, which branch to each other, so the
+ * cycle has two entries and no header dominates the other block. bb4 is
+ * unreachable but jumps into the cycle.
+ *
+ *        bb0
+ *       /   \
+ *     bb1 <-> bb2
+ *      |
+ *     bb3      bb4 -> bb1
+ */
+static Function irreducible()
+{
+    Function fn;
+    fn.name = "irreducible";
+    fn.returnType = ValueType::I64;
+    fn.params = {ValueType::Bool};
+    for (int i = 0; i < 5; ++i)
+        fn.addBlock();
+
+    ValueId cond = fn.emit(0, Opcode::Param, ValueType::Bool, {}, 0);
+    branch(fn, 0, cond, 1, 2);
+    branch(fn, 1, cond, 2, 3);
+    jump(fn, 2, 1);
+    ValueId one = fn.emit(3, Opcode::Const, ValueType::I64, {}, 1);
+    fn.emit(3, Opcode::Return, ValueType::Void, {one});
+    jump(fn, 4, 1);
+    return fn;
+}
+
+static void TestIrreducibleDominators()
+{
+    Function fn = irreducible();
+    DominatorTree dom;
+    dom.compute(fn);
+
+    expect(dom.idom[0] == NoBlock && dom.idom[1] == 0 && dom.idom[2] == 0 && dom.idom[3] == 1, "TestIrreducibleDominators",
+           "wrong immediate dominators");
+    expect(!dom.dominates(1, 2) && !dom.dominates(2, 1), "TestIrreducibleDominators", "a cycle entry dominates the other");
+    expect(dom.dominates(0, 3) && dom.dominates(1, 3) && !dom.dominates(2, 3) && dom.dominates(3, 3), "TestIrreducibleDominators",
+           "wrong dominance of the exit");
+    expect(dom.rpo.size() == 4 && dom.rpo[0] == 0, "TestIrreducibleDominators", "reverse post-order is wrong");
+
+    // No back edge reaches a dominating header, so there is no natural loop.
+    LoopInfo loops;
+    loops.compute(fn, dom);
+    expect(loops.loops.empty() && loops.depth(1) == 0, "TestIrreducibleDominators", "irreducible cycle reported as a loop");
+
+    std::string message;
+    expect(verifyFunction(fn, dom, message), "TestIrreducibleDominators", message);
+    std::cout << "[PASS] TestIrreducibleDominators\n";
+}
+
+static void TestUnreachableBlocks()
+{
+    Function fn = irreducible();
+    DominatorTree dom;
+    dom.compute(fn);
+
+    // bb4 is a predecessor of bb1 but must not take part in its dominators.
+    expect(!dom.reachable(4) && dom.idom[4] == NoBlock && dom.order[4] == UINT32_MAX, "TestUnreachableBlocks",
+           "unreachable block has a place in the tree");
+    expect(!dom.dominates(4, 4) && !dom.dominates(0, 4) && !dom.dominates(4, 1), "TestUnreachableBlocks",
+           "unreachable block takes part in dominance");
+
+    // Removing it renumbers nothing before it and drops its edge into bb1.
+    removeUnreachableBlocks(fn);
+    dom.compute(fn);
+    expect(fn.blocks.size() == 4 && fn.blocks[1].preds.size() == 2, "TestUnreachableBlocks", "unreachable block not removed");
+    std::string message;
+    expect(verifyFunction(fn, dom, message), "TestUnreachableBlocks", message);
+
+    // A function whose only block is the entry.
+    Function single;
+    single.name = "single";
+    single.addBlock();
+    single.emit(0, Opcode::Return, ValueType::Void);
+    dom.compute(single);
+    expect(dom.rpo.size() == 1 && dom.dominates(0, 0) && dom.children[0].empty(), "TestUnreachableBlocks",
+           "single-block function");
+    std::cout << "[PASS] TestUnreachableBlocks\n";
+}
+
+static std::string verifyError(const Function &fn)
+{
+    DominatorTree dom;
+    dom.compute(fn);
+    std::string message;
+    return verifyFunction(fn, dom, message) ? "" : message;
+}
+
+static void TestVerifier()
+{
+    // %0 = param in bb0, which branches to bb1 (%2 = 1) and bb2 (%4 = 2);
+    // both jump to bb3, where %6 = phi and %7 returns it.
+    auto diamond = []
+    {
+        Function fn;
+        fn.name = "diamond";
+        fn.returnType = ValueType::I64;
+        fn.params = {ValueType::Bool};
+        for (int i = 0; i < 4; ++i)
+            fn.addBlock();
+        ValueId cond = fn.emit(0, Opcode::Param, ValueType::Bool, {}, 0);
+        branch(fn, 0, cond, 1, 2);
+        ValueId a = fn.emit(1, Opcode::Const, ValueType::I64, {}, 1);
+        jump(fn, 1, 3);
+        ValueId b = fn.emit(2, Opcode::Const, ValueType::I64, {}, 2);
+        jump(fn, 2, 3);
+        ValueId phi = fn.emit(3, Opcode::Phi, ValueType::I64, {a, 1, b, 2});
+        fn.emit(3, Opcode::Return, ValueType::Void, {phi});
+        return fn;
+    };
+    expect(verifyError(diamond()).empty(), "TestVerifier", "valid function rejected: " + verifyError(diamond()));
+
+    struct Case
+    {
+        void (*breakIt)(Function &fn);
+        const char *message;
+    };
+    const Case cases[] = {
+        {[](Function &fn) { fn.blocks[3].code.pop_back(); }, "diamond: bb3: block does not end in a terminator"},
+        {[](Function &fn) { fn.blocks[1].succs.push_back(2); }, "diamond: bb1: edge to bb2 is missing from its predecessors"},
+        {[](Function &fn) { fn.instrs[fn.terminator(1)].imm = 2; }, "diamond: bb1: successors do not match the terminator"},
+        {[](Function &fn) { fn.instrs[4].op = Opcode::Nop; }, "diamond: bb2: %4: removed instruction is still listed"},
+        {[](Function &fn) { fn.instrs[fn.blocks[3].code[0]].count = 2; }, "diamond: bb3: %6: phi does not have one operand per predecessor"},
+        {[](Function &fn) { fn.operands(6)[1] = 0; }, "diamond: bb3: %6: phi names bb0, which is not a predecessor"},
+        {[](Function &fn) { fn.operands(6)[0] = 4; }, "diamond: bb3: %6: use of %4 is not dominated by its definition"},
+        {[](Function &fn)
+         {
+             // Return the value of one arm directly from the join block.
+             fn.operands(fn.terminator(3))[0] = 2;
+         },
+         "diamond: bb3: %7: use of %2 is not dominated by its definition"},
+        {[](Function &fn)
+         {
+             // A use before its definition in the same block.
+             ValueId c = fn.emit(1, Opcode::Const, ValueType::I64, {}, 3);
+             auto &code = fn.blocks[1].code;
+             ValueId add = fn.emit(1, Opcode::Add, ValueType::I64, {c, c});
+             code.pop_back();
+             code.pop_back();
+             code.insert(code.begin(), {add, c});
+         },
+         "diamond: bb1: %9: use of %8 is not dominated by its definition"},
+    };
+    for (const auto &c : cases)
+    {
+        Function fn = diamond();
+        c.breakIt(fn);
+        std::string error = verifyError(fn);
+        expect(error == c.message, "TestVerifier", "expected \"" + std::string(c.message) + "\", got \"" + error + "\"");
+    }
+    std::cout << "[PASS] TestVerifier\n";
+}
+
+namespace Passes
+{
+    bool useDominators(Function &, FunctionAnalyses &analyses)
+    {
+        analyses.dominators();
+        return false;
+    }
+
+    bool useAll(Function &, FunctionAnalyses &analyses)
+    {
+        analyses.loops();
+        analyses.liveness();
+        return false;
+    }
+
+    bool changeCode(Function &, FunctionAnalyses &) { return true; }
+
+    bool changeModule(Module &, PassContext &) { return true; }
+
+    bool dropTerminator(Function &fn, FunctionAnalyses &)
+    {
+        fn.blocks.back().code.pop_back();
+        return true;
+    }
+}
+
+static void TestAnalysisCaching()
+{
+    Module module = compile("main() int64 {\n    return 1\n}\n", 0);
+    const uint64_t functions = module.functions.size();
+
+    PassManager passes(1);
+    passes.setTiming(true);
+    passes.add(FunctionPass{"use-dom", PreserveAll, Passes::useDominators});
+    passes.add(FunctionPass{"use-dom", PreserveAll, Passes::useDominators});
+    passes.add(FunctionPass{"use-all", PreserveAll, Passes::useAll});
+    passes.add(FunctionPass{"change-instructions", PreserveCFG, Passes::changeCode});
+    passes.add(FunctionPass{"use-all", PreserveAll, Passes::useAll});
+    passes.add(FunctionPass{"change-cfg", PreserveNone, Passes::changeCode});
+    passes.add(FunctionPass{"use-all", PreserveAll, Passes::useAll});
+    passes.add(ModulePass{"change-module", Passes::changeModule});
+    passes.add(FunctionPass{"use-dom", PreserveAll, Passes::useDominators});
+    passes.run(module);
+
+    // Per function: dominators are computed at the start, after change-cfg
+    // and after the module pass; loops survive change-instructions but
+    // liveness does not; loops and liveness each ask for the dominators.
+    const AnalysisStats &stats = passes.analysisStatistics();
+    auto check = [&](size_t analysis, uint64_t computed, uint64_t reused)
+    {
+        expect(stats.computed[analysis] == computed * functions && stats.reused[analysis] == reused * functions,
+               "TestAnalysisCaching",
+               std::string(Analysis::name(analysis)) + ": computed " + std::to_string(stats.computed[analysis]) +
+                   ", reused " + std::to_string(stats.reused[analysis]));
+    };
+    check(0, 3, 6);
+    check(1, 2, 1);
+    check(2, 3, 0);
+    std::cout << "[PASS] TestAnalysisCaching\n";
+}
+
+static void TestVerifyAfterPasses()
+{
+    Module module = compile("main() int64 {\n    return 1\n}\n", 0);
+    PassManager passes(1);
+    passes.setVerify(true);
+    passes.add(FunctionPass{"use-dom", PreserveAll, Passes::useDominators});
+    passes.add(FunctionPass{"drop-terminator", PreserveAll, Passes::dropTerminator});
+
+    std::string error;
+    try
+    {
+        passes.run(module);
+    }
+    catch (const std::runtime_error &e)
+    {
+        error = e.what();
+    }
+    expect(error.rfind("IR verification failed after drop-terminator: ", 0) == 0 &&
+               error.find("block does not end in a terminator") != std::string::npos,
+           "TestVerifyAfterPasses", "broken IR not caught: " + error);
+
+    // Every standard pipeline keeps the IR valid on a program with loops,
+    // calls, classes and a match.
+    std::string source = R"(class Counter {
+    var n : int64 = 0
+    public virtual add(int64 k) int64 {
+        n = n + k
+        return n
+    }
+}
+var g : int64 = 3
+step(int64 i) int64 {
+    match i % 4 {
+        0 { return 1 }
+        1, 2 { return g }
+        else { return 0 }
+    }
+}
+main() int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < 10; i = i + 1) {
+        if i % 3 == 0 {
+            total = total + step(i)
+        } else {
+            total = total + Counter().add(i)
+        }
+    }
+    return total
+}
+)";
+    for (unsigned level = 0; level <= 2; ++level)
+        compile(source, level);
+    expect(runVM(source) == 1 + 0 + 3 + 3 + 1 + 2 + 4 + 5 + 7 + 8, "TestVerifyAfterPasses", "wrong result");
+    std::cout << "[PASS] TestVerifyAfterPasses\n";
+}
+
+int main()
+{
+    TestIrreducibleDominators();
+    TestUnreachableBlocks();
+    TestVerifier();
+    TestAnalysisCaching();
+    TestVerifyAfterPasses();
+    return 0;
+}
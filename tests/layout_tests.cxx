@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "support.hxx"
+
+struct Layouts
+{
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast;
+    ClassHierarchy hierarchy;
+    LayoutEngine engine;
+
+    explicit Layouts(const std::string &source, const LayoutProfile *profile = nullptr)
+        : engine(profile, &hierarchy)
+    {
+        ast = analyze(source, symbols, types);
+        hierarchy.build(ast.get(), *Source);
+        engine.run(ast.get());
+    }
+
+    const TypeLayout &type(const std::string &name) const
+    {
+        for (const auto &layout : engine.layouts())
+            if (layout.decl->name == name)
+                return layout;
+        fail(name, "missing layout");
+        std::exit(1);
+    }
+
+    static uint64_t offset(const TypeLayout &layout, const std::string &field)
+    {
+        for (const auto &f : layout.fields)
+            if (f.decl->name == field)
+                return f.offset;
+        fail(layout.decl->name + "." + field, "missing field");
+        std::exit(1);
+    }
+
+    std::string print() const
+    {
+        FILE *out = tmpfile();
+        engine.print(out);
+        std::string text(static_cast<size_t>(ftell(out)), '\0');
+        rewind(out);
+        text.resize(fread(text.data(), 1, text.size(), out));
+        fclose(out);
+        return text;
+    }
+};
+
+static const std::string Mixed = R"(class Mixed {
+    var a : int8 = 1
+    var b : int64 = 2
+    var c : int16 = 3
+    static var s : int64 = 4
+    var d : int32 = 5
+    var e : boolean = true
+}
+)";
+
+static void TestFieldOrdering()
+{
+    Layouts layouts(Mixed);
+    const TypeLayout &mixed = layouts.type("Mixed");
+
+    // Declaration order would need 25 bytes plus padding to 32.
+    expect(mixed.fields.size() == 5, "TestFieldOrdering", "static field was given an instance slot");
+    expect(mixed.declarationSize == 32, "TestFieldOrdering", "declaration size " + std::to_string(mixed.declarationSize));
+    expect(mixed.size == 16 && mixed.align == 8 && mixed.padding == 0, "TestFieldOrdering",
+           "size " + std::to_string(mixed.size) + ", padding " + std::to_string(mixed.padding));
+    expect(Layouts::offset(mixed, "b") == 0 && Layouts::offset(mixed, "d") == 8 && Layouts::offset(mixed, "c") == 12 &&
+               Layouts::offset(mixed, "a") == 14 && Layouts::offset(mixed, "e") == 15,
+           "TestFieldOrdering", "fields not ordered by alignment");
+    expect(!mixed.hasVptr && !mixed.split, "TestFieldOrdering", "plain class got a vptr or a hot/cold split");
+
+    // The same offsets as `vsharp compile --emit-layout`.
+    std::string expected = "class Mixed: size 16, align 8, padding 0, straddling 0 (declaration order: 32)\n"
+                           "       0    8  b : int64\n"
+                           "       8    4  d : int32\n"
+                           "      12    2  c : int16\n"
+                           "      14    1  a : int8\n"
+                           "      15    1  e : boolean\n";
+    std::string printed = layouts.print();
+    expect(printed == expected, "TestFieldOrdering", "unexpected --emit-layout output:\n" + printed);
+    std::cout << "[PASS] TestFieldOrdering\n";
+}
+
+static void TestKeepOrder()
+{
+    Layouts layouts("[keep_order]\n" + Mixed);
+    const TypeLayout &mixed = layouts.type("Mixed");
+    expect(mixed.keepOrder && mixed.size == 32 && mixed.padding == 16, "TestKeepOrder",
+           "size " + std::to_string(mixed.size) + ", padding " + std::to_string(mixed.padding));
+    expect(Layouts::offset(mixed, "a") == 0 && Layouts::offset(mixed, "b") == 8 && Layouts::offset(mixed, "c") == 16 &&
+               Layouts::offset(mixed, "d") == 20 && Layouts::offset(mixed, "e") == 24,
+           "TestKeepOrder", "fields were reordered");
+
+    // A 16-byte string after seven int64 fields crosses the first cache line.
+    std::string wide = "[keep_order]\nclass Wide {\n";
+    for (int i = 0; i < 7; ++i)
+        wide += "    var f" + std::to_string(i) + " : int64 = 0\n";
+    wide += "    var name : string = \"\"\n}\n";
+    Layouts straddle(wide);
+    const TypeLayout &layout = straddle.type("Wide");
+    expect(layout.straddling == 1 && Layouts::offset(layout, "name") == 56, "TestKeepOrder", "straddling field not counted");
+    expect(straddle.print().find("name : string  straddles line 0") != std::string::npos, "TestKeepOrder",
+           "straddling field not reported");
+    std::cout << "[PASS] TestKeepOrder\n";
+}
+
+static void TestBaseAndVptr()
+{
+    std::string source = R"(class Base {
+    var x : int8 = 1
+    public virtual f() int64 { return 1 }
+}
+class Derived : Base {
+    var y : int64 = 2
+    var z : int8 = 3
+    public override f() int64 { return 2 }
+}
+class Plain {
+    var p : int8 = 1
+}
+)";
+    Layouts layouts(source);
+    const TypeLayout &base = layouts.type("Base");
+    const TypeLayout &derived = layouts.type("Derived");
+    expect(base.hasVptr && base.vptrOffset == 0 && Layouts::offset(base, "x") == 8 && base.size == 16, "TestBaseAndVptr",
+           "base layout wrong");
+    expect(base.padding == 7, "TestBaseAndVptr", "base padding " + std::to_string(base.padding));
+
+    // The base subobject is a prefix and the vptr is inherited, not repeated.
+    expect(derived.base == &base && derived.hasVptr && derived.vptrOffset == 0, "TestBaseAndVptr", "base not shared");
+    expect(Layouts::offset(derived, "y") == 16 && Layouts::offset(derived, "z") == 24 && derived.size == 32, "TestBaseAndVptr",
+           "derived fields not placed after the base");
+    expect(layouts.engine.fieldOffset(base.fields[0].decl) == 8, "TestBaseAndVptr",
+           "fieldOffset disagrees with the layout");
+
+    const TypeLayout &plain = layouts.type("Plain");
+    expect(!plain.hasVptr && plain.size == 1, "TestBaseAndVptr", "class without virtual methods got a vptr");
+    std::cout << "[PASS] TestBaseAndVptr\n";
+}
+
+static void TestHotColdProfile()
+{
+    std::string source = R"(class Node {
+    var a : int64 = 0
+    var b : int64 = 0
+    var c : int64 = 0
+    var d : int64 = 0
+}
+class Other {
+    var u : int8 = 0
+    var v : int64 = 0
+}
+)";
+    std::string path = scratchFile("vsharp_layout", ".prof");
+    std::ofstream(path) << "# field accesses\nNode.c 1000\nNode.b 10\nNode.a 200\nNode.c 100\n";
+
+    LayoutProfile profile;
+    expect(profile.load(path), "TestHotColdProfile", "cannot load profile");
+    std::remove(path.c_str());
+    expect(profile.count("Node", "c") == 1100 && profile.covers("Node") && !profile.covers("Other"), "TestHotColdProfile",
+           "profile counts not summed per field");
+
+    // b is under 1/HotFraction of c and d is never touched: both are cold.
+    Layouts layouts(source, &profile);
+    const TypeLayout &node = layouts.type("Node");
+    expect(node.split, "TestHotColdProfile", "no hot/cold split");
+    expect(Layouts::offset(node, "a") == 0 && Layouts::offset(node, "c") == 8 && Layouts::offset(node, "b") == 16 &&
+               Layouts::offset(node, "d") == 24,
+           "TestHotColdProfile", "hot fields not placed first");
+    expect(node.fields[0].hot && node.fields[1].hot && !node.fields[2].hot && !node.fields[3].hot, "TestHotColdProfile",
+           "wrong hot set");
+    expect(layouts.print().find("       0    8  a : int64  hot (200)") != std::string::npos, "TestHotColdProfile",
+           "hot field not reported");
+
+    // Types the profile does not mention keep the default ordering.
+    const TypeLayout &other = layouts.type("Other");
+    expect(!other.split && Layouts::offset(other, "v") == 0 && Layouts::offset(other, "u") == 8, "TestHotColdProfile",
+           "unprofiled type was split");
+
+    // [keep_order] wins over the profile.
+    Layouts kept("[keep_order]\n" + source, &profile);
+    expect(!kept.type("Node").split && Layouts::offset(kept.type("Node"), "b") == 8, "TestHotColdProfile",
+           "[keep_order] type was reordered");
+
+    LayoutProfile bad;
+    std::ofstream(path) << "Node 5\n";
+    expect(!bad.load(path), "TestHotColdProfile", "profile line without a field was accepted");
+    std::remove(path.c_str());
+    std::cout << "[PASS] TestHotColdProfile\n";
+}
+
+int main()
+{
+    TestFieldOrdering();
+    TestKeepOrder();
+    TestBaseAndVptr();
+    TestHotColdProfile();
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <jit.hxx>
+
+#include "support.hxx"
+
+struct Shape
+{
+    size_t switches, hashes, compares, splits;
+};
+
+/** @brief How f dispatches, before any pass has run */
+static Shape dispatch(const std::string &source)
+{
+    Module module = compile(source, 0);
+    const Function &f = function(module, "f");
+    return {count(f, Opcode::Switch), count(f, Opcode::Hash), count(f, Opcode::Eq), count(f, Opcode::Lt)};
+}
+
+/**
+ * @brief Appends a main that calls f with each argument, written as V#
+ * source, and returns how many results differ from the expected ones.
+ */
+static std::string withChecks(const std::string &source, const std::vector<std::pair<std::string, int>> &calls)
+{
+    std::string out = source + "main() int64 {\n    var wrong : int64 = 0\n";
+    for (const auto &[argument, expected] : calls)
+        out += "    if f(" + argument + ") != " + std::to_string(expected) + " { wrong = wrong + 1 }\n";
+    return out + "    return wrong\n}\n";
+}
+
+/** @brief Every call must match in the interpreter at each level and, where the JIT runs, in native code */
+static void expectResults(const std::string &source, const std::string &test)
+{
+    for (unsigned level : {0u, 1u, 2u})
+    {
+        Module module = compile(source, level);
+        BytecodeProgram program = compileBytecode(module);
+        VM vm(program);
+        int wrong = vm.run();
+        expect(wrong == 0, test, std::to_string(wrong) + " wrong results in the interpreter at -O" + std::to_string(level));
+    }
+#if VSHARP_JIT
+    Module module = compile(source, 1);
+    Jit jit(module, 1);
+    int wrong = jit.run();
+    expect(wrong == 0, test, std::to_string(wrong) + " wrong results in native code");
+#endif
+}
+
+static std::string number(int64_t value)
+{
+    return value < 0 ? "0 - " + std::to_string(-value) : std::to_string(value);
+}
+
+static void TestDenseRange()
+{
+    // Five cases over a span of six: one jump table, whose hole at 14 and
+    // both ends go to else.
+    std::string source = R"([noinline]
+f(int64[x]) int64 {
+    match x {
+        10 { return 1 }
+        11 { return 2 }
+        12, 13 { return 3 }
+        15 { return 4 }
+        else { return 9 }
+    }
+}
+)";
+    Shape d = dispatch(source);
+    expect(d.switches == 1 && d.compares == 0 && d.splits == 0 && d.hashes == 0, "TestDenseRange", "not a single jump table");
+
+    std::vector<std::pair<std::string, int>> calls = {{"10", 1}, {"11", 2}, {"12", 3}, {"13", 3}, {"14", 9}, {"15", 4},
+                                                      {"9", 9},  {"16", 9}, {"0", 9},  {"0 - 1", 9}, {"4000000000", 9}};
+    expectResults(withChecks(source, calls), "TestDenseRange");
+
+    // Bytes, with the patterns of one arm on one line.
+    std::string bytes = R"([noinline]
+f(byte[c]) int64 {
+    match c {
+        'a', 'b' { return 1 }
+        'c' { return 2 }
+        'e', 'f' { return 3 }
+    }
+    return 0
+}
+)";
+    d = dispatch(bytes);
+    expect(d.switches == 1 && d.compares == 0, "TestDenseRange", "bytes not dispatched through a table");
+    expectResults(withChecks(bytes, {{"'a'", 1}, {"'b'", 1}, {"'c'", 2}, {"'d'", 0}, {"'e'", 3}, {"'f'", 3}, {"'g'", 0}, {"'\\''", 0}, {"'\"'", 0}}),
+                  "TestDenseRange");
+    std::cout << "[PASS] TestDenseRange\n";
+}
+
+static void TestSparseSet()
+{
+    // Too spread out for a table: the seven cases split at the median into
+    // three and four, the four into two and two, and each part compares
+    // one by one.
+    std::string source = R"([noinline]
+f(int64[x]) int64 {
+    match x {
+        -40 { return 1 }
+        9 { return 2 }
+        100, 1000 { return 3 }
+        5000 { return 4 }
+        70000 { return 5 }
+        9000000000 { return 6 }
+        else { return 0 }
+    }
+}
+)";
+    Shape d = dispatch(source);
+    expect(d.switches == 0 && d.compares == 7 && d.splits == 2, "TestSparseSet",
+           std::to_string(d.compares) + " compares and " + std::to_string(d.splits) + " splits");
+
+    std::vector<std::pair<std::string, int>> calls;
+    const std::vector<std::pair<int64_t, int>> keys = {{-40, 1}, {9, 2}, {100, 3}, {1000, 3}, {5000, 4}, {70000, 5}, {9000000000, 6}};
+    for (const auto &[key, arm] : keys)
+    {
+        calls.push_back({number(key), arm});
+        calls.push_back({number(key - 1), 0});
+        calls.push_back({number(key + 1), 0});
+    }
+    calls.push_back({"0 - 9223372036854775807", 0});
+    expectResults(withChecks(source, calls), "TestSparseSet");
+
+    // A dense run in one half of a sparse set still gets its table.
+    std::string mixed = R"([noinline]
+f(int64[x]) int64 {
+    match x {
+        1 { return 1 }
+        2 { return 2 }
+        3 { return 3 }
+        4 { return 4 }
+        1000 { return 5 }
+        5000 { return 6 }
+        9000 { return 7 }
+        20000 { return 8 }
+    }
+    return 0
+}
+)";
+    d = dispatch(mixed);
+    expect(d.switches == 1 && d.compares == 4, "TestSparseSet", "dense half not dispatched through a table");
+    expectResults(withChecks(mixed, {{"0", 0}, {"1", 1}, {"4", 4}, {"5", 0}, {"999", 0}, {"1000", 5}, {"9000", 7}, {"20000", 8}, {"20001", 0}}),
+                  "TestSparseSet");
+    std::cout << "[PASS] TestSparseSet\n";
+}
+
+static void TestStrings()
+{
+    // Hashed to a slot, then confirmed with one compare per key. The empty
+    // string is a key like any other.
+    std::string source = R"([noinline]
+f(string[s]) int64 {
+    match s {
+        "" { return 1 }
+        "a", "ab" { return 2 }
+        "abc" { return 3 }
+        "ba" { return 4 }
+        "select", "Select" { return 5 }
+        "selects" { return 6 }
+        else { return 0 }
+    }
+}
+)";
+    Shape d = dispatch(source);
+    expect(d.hashes == 1 && d.switches == 1 && d.compares == 8, "TestStrings",
+           "not a perfect hash: " + std::to_string(d.compares) + " compares");
+
+    // Near misses: prefixes, extensions, other cases and reorderings of the keys.
+    std::vector<std::pair<std::string, int>> calls = {
+        {"\"\"", 1},     {"\"a\"", 2},     {"\"ab\"", 2},     {"\"abc\"", 3},  {"\"ba\"", 4},     {"\"select\"", 5},
+        {"\"Select\"", 5}, {"\"selects\"", 6}, {"\" \"", 0},    {"\"A\"", 0},    {"\"b\"", 0},      {"\"abd\"", 0},
+        {"\"abcd\"", 0},  {"\"ac\"", 0},     {"\"selec\"", 0},  {"\"SELECT\"", 0}, {"\"selectss\"", 0}, {"\"a\\n\"", 0}};
+    expectResults(withChecks(source, calls), "TestStrings");
+
+    // Under four keys the compares run in order without hashing.
+    std::string few = R"([noinline]
+f(string[s]) int64 {
+    match s {
+        "", "x" { return 1 }
+        "xy" { return 2 }
+    }
+    return 0
+}
+)";
+    d = dispatch(few);
+    expect(d.hashes == 0 && d.switches == 0 && d.compares == 3, "TestStrings", "few keys were hashed");
+    expectResults(withChecks(few, {{"\"\"", 1}, {"\"x\"", 1}, {"\"xy\"", 2}, {"\"y\"", 0}, {"\"xyz\"", 0}}), "TestStrings");
+    std::cout << "[PASS] TestStrings\n";
+}
+
+static void TestEnumeration()
+{
+    // Members count on from an explicit value: 0, 1, 5, 6.
+    std::string source = R"(enumeration Color { Red, Green, Blue = 5, Violet }
+[noinline]
+f(Color[c]) int64 {
+    match c {
+        Color.Red { return 1 }
+        Color.Green, Color.Blue { return 2 }
+        Color.Violet { return 3 }
+        else { return 0 }
+    }
+}
+)";
+    Shape d = dispatch(source);
+    expect(d.switches == 1 && d.compares == 0, "TestEnumeration", "enumerators not dispatched through a table");
+    expectResults(withChecks(source, {{"Color.Red", 1}, {"Color.Green", 2}, {"Color.Blue", 2}, {"Color.Violet", 3}, {"2", 0}, {"7", 0}}),
+                  "TestEnumeration");
+    std::cout << "[PASS] TestEnumeration\n";
+}
+
+static void TestElsePath()
+{
+    // Arms that fall through continue after the match, as does a value no
+    // arm takes when there is no else; else runs only when no arm matches.
+    std::string source = R"([noinline]
+f(int64[x]) int64 {
+    var r : int64 = 100
+    match x {
+        1 { r = r + 1 }
+        2, 3 { r = r + 2 }
+        4 { return 7 }
+        5 { }
+    }
+    match x % 1000 {
+        1 { r = r + 10 }
+        500 { r = r + 20 }
+        999 { r = r + 30 }
+        else { r = r + 1000 }
+    }
+    return r
+}
+)";
+    std::vector<std::pair<std::string, int>> calls = {{"1", 111},  {"2", 1102}, {"3", 1102},  {"4", 7},
+                                                      {"5", 1100}, {"6", 1100}, {"500", 120}, {"1999", 130},
+                                                      {"0", 1100}, {"1001", 110}};
+    expectResults(withChecks(source, calls), "TestElsePath");
+    std::cout << "[PASS] TestElsePath\n";
+}
+
+int main()
+{
+    TestDenseRange();
+    TestSparseSet();
+    TestStrings();
+    TestEnumeration();
+    TestElsePath();
+    return 0;
+}
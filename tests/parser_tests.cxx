@@ -0,0 +1,442 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <alias.hxx>
+#include <cli.hxx>
+#include <dumper.hxx>
+#include <visitor.hxx>
+
+#include "support.hxx"
+
+static std::string parseError(const std::string &source)
+{
+    Error::setThrowing(true);
+    std::string message;
+    try
+    {
+        parse(source);
+    }
+    catch (const CompileError &e)
+    {
+        message = e.message;
+    }
+    Error::setThrowing(false);
+    return message;
+}
+
+static std::string nested(const std::string &open, const std::string &inner, const std::string &close, int levels)
+{
+    std::string out;
+    for (int i = 0; i < levels; ++i)
+        out += open;
+    out += inner;
+    for (int i = 0; i < levels; ++i)
+        out += close;
+    return out;
+}
+
+static void TestLongElseIfChain()
+{
+    // Generated dispatchers: far past the nesting limit, but flat, and every
+    // pass walks the chain with loops.
+    std::string source = "[noinline]\nf(int64 x) int64 {\n    if x == 0 { return 0 }\n";
+    for (int i = 1; i < 30000; ++i)
+        source += "    else if x == " + std::to_string(i) + " { return " + std::to_string(i % 100) + " }\n";
+    source += "    else { return 0 - 1 }\n}\nmain() int64 {\n    return f(29999) + f(1234) + f(30000)\n}\n";
+
+    std::string error = frontEndError(source);
+    expect(error.empty(), "TestLongElseIfChain", "rejected: " + error);
+    for (unsigned level : {0u, 2u})
+        for (bool hashCons : {false, true})
+        {
+            BytecodeProgram program = compileBytecode(compile(source, level, hashCons));
+            VM vm(program);
+            expect(vm.run() == 99 + 34 - 1, "TestLongElseIfChain",
+                   "wrong arm taken at -O" + std::to_string(level) + (hashCons ? " with hash-consing" : ""));
+        }
+
+    // Text and S-expressions indent every arm further, so their size grows
+    // with the square of the chain; they get a shorter one.
+    std::string shortSource = "f(int64 x) int64 {\n    if x == 0 { return 0 }\n";
+    for (int i = 1; i < 2000; ++i)
+        shortSource += "    else if x == " + std::to_string(i) + " { return 1 }\n";
+    shortSource += "    return 2\n}\n";
+    for (DumpFormat format : {DumpFormat::Text, DumpFormat::Json, DumpFormat::SExpr})
+    {
+        FILE *out = tmpfile();
+        ASTDumper(out, format).dump(parse(format == DumpFormat::Json ? source : shortSource).get());
+        expect(ftell(out) > 0, "TestLongElseIfChain", "empty dump");
+        fclose(out);
+    }
+    std::cout << "[PASS] TestLongElseIfChain\n";
+}
+
+static void TestLongOperatorChain()
+{
+    // Generated sums and conditions: every pass walks the chain with loops,
+    // so its length costs no stack.
+    static const char *const terms[] = {" + a", " - b", " + b * 2", " + 3"};
+    std::string sum = "a";
+    for (int i = 0; i < 100000; ++i)
+        sum += terms[i % 4];
+    std::string all = "a > 0";
+    for (int i = 0; i < 20000; ++i)
+        all += " && a != " + std::to_string(1000000 + i);
+    std::string source = "[noinline]\nf(int64[a], int64[b]) int64 {\n    return " + sum + "\n}\n[noinline]\ng(int64[a]) boolean {\n    return " +
+                         all + "\n}\nmain() int64 {\n    var r : int64 = f(2, 1) - 150000\n    if g(5) { r = r + 10 }\n    return r\n}\n";
+
+    std::string error = frontEndError(source);
+    expect(error.empty(), "TestLongOperatorChain", "rejected: " + error);
+    for (unsigned level : {0u, 2u})
+        for (bool hashCons : {false, true})
+        {
+            BytecodeProgram program = compileBytecode(compile(source, level, hashCons));
+            VM vm(program);
+            expect(vm.run() == 12, "TestLongOperatorChain",
+                   "wrong result at -O" + std::to_string(level) + (hashCons ? " with hash-consing" : ""));
+        }
+
+    // Text and S-expressions indent every level of a chain, so their size
+    // grows with its square; they get a shorter one.
+    std::string shortSum = "a";
+    for (int i = 0; i < 3000; ++i)
+        shortSum += " + a";
+    std::string shortSource = "f(int64[a]) int64 {\n    return " + shortSum + "\n}\n";
+    for (DumpFormat format : {DumpFormat::Text, DumpFormat::Json, DumpFormat::SExpr})
+    {
+        FILE *out = tmpfile();
+        ASTDumper(out, format).dump(parse(format == DumpFormat::Json ? source : shortSource).get());
+        expect(ftell(out) > 0, "TestLongOperatorChain", "empty dump");
+        fclose(out);
+    }
+
+    // Chains print nested, as every other node does.
+    auto dump = [](DumpFormat format, const std::string &program)
+    {
+        FILE *out = tmpfile();
+        ASTDumper(out, format).dump(parse(program).get());
+        std::string text(static_cast<size_t>(ftell(out)), '\0');
+        rewind(out);
+        text.resize(fread(text.data(), 1, text.size(), out));
+        fclose(out);
+        return text;
+    };
+    std::string small = "main() int64 {\n    return 1 + 2 - 3 * 4\n}\n";
+    std::string text = dump(DumpFormat::Text, small);
+    expect(text.find("          BinaryExpr '-'\n            BinaryExpr '+'\n              Literal: 1\n              Literal: 2\n"
+                     "            BinaryExpr '*'\n              Literal: 3\n              Literal: 4\n") != std::string::npos,
+           "TestLongOperatorChain", "chain not printed nested:\n" + text);
+    std::string sexpr = dump(DumpFormat::SExpr, small);
+    expect(sexpr.find("(BinaryExpr -\n          (BinaryExpr +\n            (Literal int64 1)\n            (Literal int64 2))\n"
+                      "          (BinaryExpr *\n            (Literal int64 3)\n            (Literal int64 4)))") != std::string::npos,
+           "TestLongOperatorChain", "chain not printed nested:\n" + sexpr);
+    std::cout << "[PASS] TestLongOperatorChain\n";
+}
+
+static void TestLongMemberCallChain()
+{
+    // Methods cannot return class types yet, so the chain is rejected by the
+    // type checker, after being parsed, resolved and dumped without recursion.
+    std::string chain = "Counter()";
+    for (int i = 0; i < 100000; ++i)
+        chain += ".next()";
+    std::string source = "class Counter {\n    next() int64 {\n        return 1\n    }\n}\nmain() int64 {\n    return " + chain + "\n}\n";
+
+    std::string error = parseError(source);
+    expect(error.empty(), "TestLongMemberCallChain", "rejected: " + error);
+    expect(!frontEndError(source).empty(), "TestLongMemberCallChain", "call on int64 was accepted");
+    std::string shortChain = "Counter()";
+    for (int i = 0; i < 2000; ++i)
+        shortChain += ".next()";
+    std::string shortSource = "main() int64 {\n    return " + shortChain + "\n}\n";
+    for (DumpFormat format : {DumpFormat::Text, DumpFormat::Json, DumpFormat::SExpr})
+    {
+        FILE *out = tmpfile();
+        ASTDumper(out, format).dump(parse(format == DumpFormat::Json ? source : shortSource).get());
+        expect(ftell(out) > 0, "TestLongMemberCallChain", "empty dump");
+        fclose(out);
+    }
+    std::cout << "[PASS] TestLongMemberCallChain\n";
+}
+
+static void TestDeepNestingRejected()
+{
+    const std::string limit = "Nesting exceeds the limit of " + std::to_string(Parser::MaxNestingDepth) + " levels";
+    int levels = Parser::MaxNestingDepth + 10;
+
+    std::string parens = "main() int64 {\n    return " + nested("(", "1", ")", levels) + "\n}\n";
+    expect(frontEndError(parens) == limit, "TestDeepNestingRejected", "parentheses were accepted");
+
+    std::string ifs = "main() int64 {\n" + nested("if true { ", "return 1", " }\n", levels) + "    return 0\n}\n";
+    expect(frontEndError(ifs) == limit, "TestDeepNestingRejected", "nested ifs were accepted");
+
+    std::string classes = nested("class C {\n", "", "}\n", levels);
+    expect(frontEndError(classes) == limit, "TestDeepNestingRejected", "nested classes were accepted");
+
+    // Just under the limit still parses.
+    std::string shallow = "main() int64 {\n    return " + nested("(", "1", ")", Parser::MaxNestingDepth / 2) + "\n}\n";
+    expect(frontEndError(shallow).empty(), "TestDeepNestingRejected", "moderate nesting was rejected");
+    std::cout << "[PASS] TestDeepNestingRejected\n";
+}
+
+static void TestForParts()
+{
+    // Every part of the header is optional; a loop without a condition
+    // runs until a return.
+    std::string source = R"(count(int64[n]) int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) { total = total + 1 }
+    var j : int64 = 0
+    for (; j < n;) { j = j + 2 }
+    for (;;) { return total * 1000 + j }
+    return 0 - 1
+}
+main() int64 {
+    return count(0) * 1000000 + count(1) * 1000 + count(7)
+}
+)";
+    ASTNodePtr ast = parse(source);
+    const auto &count = static_cast<const FunctionDeclNode &>(*static_cast<const BlockNode &>(*ast).children[0]);
+    const auto &body = static_cast<const BlockNode &>(*count.body).children;
+    expect(body.size() == 6 && body[1]->type == ASTNodeType::ForExpr && body[3]->type == ASTNodeType::ForExpr &&
+               body[4]->type == ASTNodeType::ForExpr,
+           "TestForParts", "loops not parsed as statements of the body");
+
+    const auto &full = static_cast<const ForExprNode &>(*body[1]);
+    expect(full.init && full.init->type == ASTNodeType::VarDecl && full.condition && full.condition->type == ASTNodeType::BinaryExpr &&
+               full.step && full.step->type == ASTNodeType::AssignExpr && full.body,
+           "TestForParts", "wrong parts in a full header");
+    const auto &condition = static_cast<const ForExprNode &>(*body[3]);
+    expect(!condition.init && condition.condition && !condition.step, "TestForParts", "wrong parts with only a condition");
+    const auto &none = static_cast<const ForExprNode &>(*body[4]);
+    expect(!none.init && !none.condition && !none.step && none.body, "TestForParts", "wrong parts in an empty header");
+
+    // Trip counts 0, 1 and 7; j stops at the first even number not below n.
+    expect(runVM(source) == 0 * 1000000 + 1002 * 1000 + 7008, "TestForParts", "wrong result");
+
+    expect(!parseError("main() int64 {\n    for (var i : int64 = 0; i < 3) { }\n    return 0\n}\n").empty(), "TestForParts",
+           "header with one semicolon accepted");
+    std::cout << "[PASS] TestForParts\n";
+}
+
+static void TestHashConsLowersOnce()
+{
+    std::string source = R"(const k : int64 = 2
+f(int64 a, int64 b) int64 {
+    var x : int64 = a * b + k * 3
+    var y : int64 = a * b + k * 3
+    b = b + 1
+    return x + y + a * b
+}
+main() int64 {
+    return f(3, 4)
+}
+)";
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(source, symbols, types);
+    HashConsTable table;
+    table.intern(ast);
+    expect(table.sharedCount() == 4, "TestHashConsLowersOnce", std::to_string(table.sharedCount()) + " shared occurrences");
+
+    // Occurrences keep their own position and type.
+    auto *fn = static_cast<FunctionDeclNode *>(static_cast<BlockNode *>(ast.get())->children[1].get());
+    auto *body = static_cast<BlockNode *>(fn->body.get());
+    auto *y = static_cast<VarDeclNode *>(body->children[1].get());
+    expect(y->value->type == ASTNodeType::SharedExpr && y->value->line == 4 && y->value->resolvedType, "TestHashConsLowersOnce",
+           "shared occurrence lost its position or type");
+
+    // The second initializer reuses the first; a * b after b changes does not.
+    Module plain = compile(source, 0), shared = compile(source, 0, true);
+    expect(count(function(plain, "f"), Opcode::Mul) == 3, "TestHashConsLowersOnce", "unexpected multiplications without hash-consing");
+    expect(count(function(shared, "f"), Opcode::Mul) == 2, "TestHashConsLowersOnce", "shared subtree was lowered more than once");
+    expect(count(function(shared, "f"), Opcode::Const) < count(function(plain, "f"), Opcode::Const), "TestHashConsLowersOnce",
+           "folded subtree was not shared");
+
+    BytecodeProgram program = compileBytecode(shared);
+    VM vm(program);
+    expect(vm.run() == 51, "TestHashConsLowersOnce", "wrong result");
+
+    // Writing another local keeps both shared values; a call may write g,
+    // so only the part reading it is computed again.
+    std::string memory = R"(var g : int64 = 5
+bump() int64 {
+    g = g + 1
+    return 0
+}
+h(int64 a, int64 b) int64 {
+    var c : int64 = 0
+    var x : int64 = a * b + g
+    c = c + 1
+    var y : int64 = a * b + g
+    c = c + bump()
+    var z : int64 = a * b + g
+    return x * 10000 + y * 100 + z + c
+}
+main() int64 {
+    return h(2, 3)
+}
+)";
+    Module reused = compile(memory, 0, true);
+    const Function &h = function(reused, "h");
+    expect(count(h, Opcode::Mul) == 3 && count(h, Opcode::LoadGlobal) == 2, "TestHashConsLowersOnce",
+           std::to_string(count(h, Opcode::LoadGlobal)) + " loads of g after hash-consing");
+    BytecodeProgram memoryProgram = compileBytecode(reused);
+    VM memoryVM(memoryProgram);
+    expect(memoryVM.run() == 11 * 10000 + 11 * 100 + 12 + 1, "TestHashConsLowersOnce", "wrong result around a call");
+    std::cout << "[PASS] TestHashConsLowersOnce\n";
+}
+
+namespace
+{
+    /** @brief Counts the leaves it reaches, through shared subtrees too */
+    struct LeafCounter : ASTVisitor<LeafCounter>
+    {
+        size_t identifiers = 0, literals = 0;
+
+        void visitIdentifier(const IdentifierNode *) { ++identifiers; }
+        void visitLiteral(const LiteralNode *) { ++literals; }
+    };
+
+    /** @brief Lists operators in post-order, leaving the walk of chains to the default */
+    struct OperatorLister : ASTVisitor<OperatorLister>
+    {
+        std::string ops;
+
+        void visitBinaryNode(const BinaryExprNode *node) { ops += node->op; }
+    };
+
+    /** @brief A mutable visitor: it must say what shared subtrees mean to it */
+    struct SharedCounter : ASTVisitor<SharedCounter, void, false>
+    {
+        size_t shared = 0;
+
+        void visitSharedExpr(SharedExprNode *) { ++shared; }
+    };
+}
+
+static void TestVisitorOnSharedTree()
+{
+    std::string source = R"(f(int64 a, int64 b) int64 {
+    var x : int64 = a * b + 3
+    var y : int64 = a * b + 3
+    return x + y
+}
+)";
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr plain = analyze(source, symbols, types);
+    LeafCounter before;
+    before.visit(plain.get());
+
+    HashConsTable table;
+    table.intern(plain);
+    LeafCounter after;
+    after.visit(plain.get());
+    expect(after.identifiers == before.identifiers && after.literals == before.literals, "TestVisitorOnSharedTree",
+           std::to_string(after.identifiers) + " identifiers and " + std::to_string(after.literals) + " literals after hash-consing, " +
+               std::to_string(before.identifiers) + " and " + std::to_string(before.literals) + " before");
+
+    // The two initializers and the returned sum; the mutable visitor stops at each.
+    SharedCounter counter;
+    counter.visit(plain.get());
+    expect(counter.shared == 3, "TestVisitorOnSharedTree", std::to_string(counter.shared) + " shared subtrees visited");
+    std::cout << "[PASS] TestVisitorOnSharedTree\n";
+}
+
+static void TestVisitorBinaryNodes()
+{
+    // (((1 + 2) - (3 * (4 / 5))) + 6) * 7 after precedence: every spine node
+    // and every nested operator is reached, operands first.
+    OperatorLister lister;
+    lister.visit(parse("main() int64 {\n    return (1 + 2 - 3 * (4 / 5) + 6) * 7\n}\n").get());
+    expect(lister.ops == "+/*-+*", "TestVisitorBinaryNodes", "operators in order \"" + lister.ops + "\"");
+
+    // A long chain still costs no stack.
+    std::string sum = "a";
+    for (int i = 0; i < 100000; ++i)
+        sum += " + a";
+    OperatorLister chain;
+    chain.visit(parse("f(int64 a) int64 {\n    return " + sum + "\n}\n").get());
+    expect(chain.ops.size() == 100000, "TestVisitorBinaryNodes", std::to_string(chain.ops.size()) + " operators in a long chain");
+    std::cout << "[PASS] TestVisitorBinaryNodes\n";
+}
+
+static std::string tempFile(const std::string &stem, const std::string &extension, const std::string &contents)
+{
+    std::string path = scratchFile(stem, extension);
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+}
+
+static void TestAliasFileRoundTrip()
+{
+    AliasTable table;
+    expect(table.define("i32", Alias{AliasKind::Type, Type::Int32, TokenType::Identifier}) &&
+               table.define("enum", Alias{AliasKind::Keyword, Type::Void, TokenType::KwEnumeration}) &&
+               table.define("Color.Blue", Alias{AliasKind::Constant, Type::Int32, TokenType::Identifier, -7}),
+           "TestAliasFileRoundTrip", "define failed");
+
+    std::string path = tempFile("vsharp_aliases", ".vsa", "");
+    expect(table.save(path), "TestAliasFileRoundTrip", "save failed");
+
+    AliasTable loaded;
+    expect(loaded.load(path) && loaded.size() == table.size(), "TestAliasFileRoundTrip", "load failed");
+    const Alias *type = loaded.find("i32");
+    const Alias *keyword = loaded.find("enum");
+    const Alias *constant = loaded.find("Color.Blue");
+    expect(type && type->kind == AliasKind::Type && type->type == Type::Int32, "TestAliasFileRoundTrip", "type alias changed");
+    expect(keyword && keyword->kind == AliasKind::Keyword && keyword->keyword == TokenType::KwEnumeration,
+           "TestAliasFileRoundTrip", "keyword alias changed");
+    expect(constant && constant->kind == AliasKind::Constant && constant->value == -7, "TestAliasFileRoundTrip",
+           "enumerator changed");
+
+    // A truncated file is rejected rather than half-loaded.
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    AliasTable truncated;
+    expect(!truncated.load(path), "TestAliasFileRoundTrip", "truncated file was accepted");
+    std::remove(path.c_str());
+    std::cout << "[PASS] TestAliasFileRoundTrip\n";
+}
+
+static void TestPreludesAccumulate()
+{
+    std::string first = tempFile("vsharp_first", ".vs", "typedef int64 i64\nenumeration Color { Red, Green = 5 }\n");
+    std::string second = tempFile("vsharp_second", ".vs", "typedef i64 word\ndefine structure record\n");
+
+    // A saved table and a source prelude both add to what is already loaded.
+    AliasTable saved;
+    expect(loadPrelude(first, saved), "TestPreludesAccumulate", "cannot load first prelude");
+    std::string table = first + ".vsa";
+    expect(saved.save(table), "TestPreludesAccumulate", "cannot save first prelude");
+
+    AliasTable aliases;
+    expect(loadPrelude(table, aliases) && loadPrelude(second, aliases), "TestPreludesAccumulate", "cannot load preludes");
+    const Alias *green = aliases.find("Color.Green");
+    const Alias *word = aliases.find("word");
+    expect(aliases.find("i64") && green && green->value == 5, "TestPreludesAccumulate", "second prelude replaced the first");
+    expect(word && word->type == Type::Int64, "TestPreludesAccumulate", "second prelude could not use the first");
+    expect(aliases.find("record"), "TestPreludesAccumulate", "second prelude was not loaded");
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+    std::remove(table.c_str());
+    std::cout << "[PASS] TestPreludesAccumulate\n";
+}
+
+int main()
+{
+    TestLongElseIfChain();
+    TestLongOperatorChain();
+    TestLongMemberCallChain();
+    TestDeepNestingRejected();
+    TestForParts();
+    TestHashConsLowersOnce();
+    TestVisitorOnSharedTree();
+    TestVisitorBinaryNodes();
+    TestAliasFileRoundTrip();
+    TestPreludesAccumulate();
+    return 0;
+}
@@ -0,0 +1,478 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <string>
+#include <gvn.hxx>
+#include <inliner.hxx>
+#include <loops.hxx>
+
+#include "support.hxx"
+
+/** @brief Names of the functions fn still calls directly */
+static std::multiset<std::string> callees(const Module &module, const Function &fn)
+{
+    std::multiset<std::string> names;
+    for (const auto &block : fn.blocks)
+        for (ValueId v : block.code)
+            if (fn.instrs[v].op == Opcode::Call)
+                names.insert(module.functions[fn.instrs[v].imm].name);
+    return names;
+}
+
+/** @brief Runs the inliner alone on an unoptimized module, returning its remarks */
+static std::string inlineAlone(Module &module, int threshold, bool &changed)
+{
+    ThreadPool pool(1);
+    InlineOptions options;
+    options.threshold = threshold;
+    options.remarks = tmpfile();
+    changed = inlineCalls(module, pool, options);
+
+    std::string text(static_cast<size_t>(ftell(options.remarks)), '\0');
+    rewind(options.remarks);
+    text.resize(fread(text.data(), 1, text.size(), options.remarks));
+    fclose(options.remarks);
+    return text;
+}
+
+static const std::string Calls = R"([inline]
+big(int64[x]) int64 {
+    return x * x * x * x * x * x * x * x * x * x * x * x + x
+}
+[noinline]
+tiny(int64[x]) int64 {
+    return x + 1
+}
+small(int64[x]) int64 {
+    return x * 2
+}
+medium(int64[x]) int64 {
+    return x * 3 + x * 5 + x * 7 + x * 11 + x * 13 + x * 17
+}
+[inline]
+even(int64[n]) boolean {
+    if n == 0 { return true }
+    return odd(n - 1)
+}
+[inline]
+odd(int64[n]) boolean {
+    if n == 0 { return false }
+    return even(n - 1)
+}
+main() int64 {
+    var x : int64 = tiny(2)
+    var total : int64 = big(x) + small(x) + medium(x)
+    if even(10) { total = total + 1 }
+    return total
+}
+)";
+
+static void TestInlineAttributes()
+{
+    Module module = compile(Calls, 0);
+    bool changed = false;
+    inlineAlone(module, InlineOptions::SmallThreshold, changed);
+    expect(changed, "TestInlineAttributes", "nothing inlined");
+
+    // big is inlined despite its size, tiny is kept despite being cheap,
+    // small is under the -O1 threshold and medium is not. even is inlined,
+    // bringing its call to odd along.
+    std::multiset<std::string> expected = {"tiny", "medium", "odd"};
+    std::multiset<std::string> remaining = callees(module, function(module, "main"));
+    expect(remaining == expected, "TestInlineAttributes", "main still calls " + std::to_string(remaining.size()) + " functions");
+
+    // At the -O2 threshold medium goes too.
+    Module larger = compile(Calls, 0);
+    inlineAlone(larger, InlineOptions::LargeThreshold, changed);
+    expected = {"tiny", "odd"};
+    expect(callees(larger, function(larger, "main")) == expected, "TestInlineAttributes", "medium not inlined at the -O2 threshold");
+    expect(runVM(Calls) == 3 * 3 * 3 * 3 * 3 * 3 * 3 * 3 * 3 * 3 * 3 * 3 + 3 + 6 + 3 * 56 + 1, "TestInlineAttributes", "wrong result");
+    std::cout << "[PASS] TestInlineAttributes\n";
+}
+
+static void TestInlineRecursion()
+{
+    // even and odd form one component: [inline] does not override that, and
+    // neither inlines the other.
+    Module module = compile(Calls, 0);
+    bool changed = false;
+    inlineAlone(module, InlineOptions::LargeThreshold, changed);
+    expect(callees(module, function(module, "even")) == std::multiset<std::string>{"odd"} &&
+               callees(module, function(module, "odd")) == std::multiset<std::string>{"even"},
+           "TestInlineRecursion", "mutually recursive call inlined");
+
+    std::string self = "[inline]\nfact(int64[n]) int64 {\n    if n < 2 { return 1 }\n    return n * fact(n - 1)\n}\n"
+                       "main() int64 {\n    return fact(10) % 1000\n}\n";
+    Module recursive = compile(self, 0);
+    inlineAlone(recursive, InlineOptions::LargeThreshold, changed);
+    expect(callees(recursive, function(recursive, "fact")) == std::multiset<std::string>{"fact"}, "TestInlineRecursion",
+           "self-recursive call inlined");
+    // The call from main is outside the component, so it is inlined once.
+    expect(callees(recursive, function(recursive, "main")) == std::multiset<std::string>{"fact"}, "TestInlineRecursion",
+           "main's call not inlined exactly one level");
+    expect(runVM(self) == 3628800 % 1000, "TestInlineRecursion", "wrong result");
+    std::cout << "[PASS] TestInlineRecursion\n";
+}
+
+static void TestInlineRemarks()
+{
+    Module module = compile(Calls, 0);
+    bool changed = false;
+    std::string remarks = inlineAlone(module, InlineOptions::SmallThreshold, changed);
+
+    // One line per call considered, callees before their callers.
+    std::string expected = "remark: even:18: 'odd' not inlined: recursive call\n"
+                           "remark: odd:23: 'even' not inlined: recursive call\n"
+                           "remark: main:26: 'tiny' not inlined: marked noinline\n"
+                           "remark: main:27: 'big' inlined: marked inline\n"
+                           "remark: main:27: 'small' inlined: cost -1, threshold 8\n"
+                           "remark: main:27: 'medium' not inlined: cost 9 exceeds threshold 8\n"
+                           "remark: main:28: 'even' inlined: marked inline\n";
+    expect(remarks == expected, "TestInlineRemarks", "unexpected remarks:\n" + remarks);
+    std::cout << "[PASS] TestInlineRemarks\n";
+}
+
+/** @brief Runs global value numbering alone on an unoptimized module */
+static bool numberAlone(Module &module)
+{
+    ThreadPool pool(1);
+    return numberValues(module, pool);
+}
+
+static void TestGvnArithmetic()
+{
+    // The product is computed in the entry block and again, with its
+    // operands swapped, in each arm and at the join.
+    std::string source = R"([noinline]
+f(int64 a, int64 b, boolean c) int64 {
+    var x : int64 = a * b
+    var y : int64 = 0
+    if c {
+        y = a * b + 1
+    } else {
+        y = b * a + 2
+    }
+    return x + y + b * a
+}
+main() int64 {
+    return f(6, 7, true) * 1000 + f(6, 7, false)
+}
+)";
+    Module module = compile(source, 0);
+    expect(count(function(module, "f"), Opcode::Mul) == 4, "TestGvnArithmetic", "unexpected products before numbering");
+    expect(numberAlone(module), "TestGvnArithmetic", "nothing changed");
+    expect(count(function(module, "f"), Opcode::Mul) == 1, "TestGvnArithmetic",
+           std::to_string(count(function(module, "f"), Opcode::Mul)) + " products left");
+    expect(runVM(source) == (42 + 43 + 42) * 1000 + 42 + 44 + 42, "TestGvnArithmetic", "wrong result");
+    std::cout << "[PASS] TestGvnArithmetic\n";
+}
+
+static void TestGvnLoads()
+{
+    // g is read in the entry block and again in a block whose only
+    // predecessor is the entry, with nothing stored in between.
+    std::string source = R"(var g : int64 = 5
+[noinline]
+touch() int64 {
+    g = g + 1
+    return 0
+}
+[noinline]
+reuse(boolean c) int64 {
+    var x : int64 = g * 2
+    if c {
+        return g + x
+    }
+    return x
+}
+[noinline]
+afterCall() int64 {
+    var x : int64 = g
+    touch()
+    return g + x
+}
+[noinline]
+afterStore() int64 {
+    var x : int64 = g
+    g = x + 10
+    return g + x
+}
+main() int64 {
+    return reuse(true) * 10000 + afterCall() * 100 + afterStore()
+}
+)";
+    Module module = compile(source, 0);
+    numberAlone(module);
+    auto loads = [&](const char *name)
+    {
+        return count(function(module, name), Opcode::LoadGlobal);
+    };
+    expect(loads("reuse") == 1, "TestGvnLoads", std::to_string(loads("reuse")) + " loads of g left in reuse");
+    // A call or a store may change g, so the second load stays.
+    expect(loads("afterCall") == 2, "TestGvnLoads", "load reused across a call");
+    expect(loads("afterStore") == 2, "TestGvnLoads", "load reused across a store");
+    // g is 5 in reuse, 5 then 6 around the call, and 6 then 16 around the store.
+    expect(runVM(source) == 15 * 10000 + 11 * 100 + 22, "TestGvnLoads", "wrong result");
+    std::cout << "[PASS] TestGvnLoads\n";
+}
+
+static void TestGvnStringConcat()
+{
+    // Concatenation is not commutative: s + t and t + s stay apart, while
+    // a repeated s + t is shared.
+    std::string source = R"([noinline]
+join(string[s, t]) string {
+    var a : string = s + t
+    var b : string = t + s
+    return a + b + (s + t)
+}
+main() int64 {
+    if join("ab", "cd") == "abcdcdababcd" { return 1 }
+    return 0
+}
+)";
+    Module module = compile(source, 0);
+    numberAlone(module);
+    expect(count(function(module, "join"), Opcode::Add) == 4, "TestGvnStringConcat",
+           std::to_string(count(function(module, "join"), Opcode::Add)) + " concatenations left");
+    expect(runVM(source) == 1, "TestGvnStringConcat", "operands of a concatenation were swapped");
+    std::cout << "[PASS] TestGvnStringConcat\n";
+}
+
+/** @brief Whether control can come back to a block, that is, whether it is in a loop */
+static bool inLoop(const Function &fn, BlockId block)
+{
+    std::vector<bool> seen(fn.blocks.size(), false);
+    std::vector<BlockId> work(fn.blocks[block].succs.begin(), fn.blocks[block].succs.end());
+    while (!work.empty())
+    {
+        BlockId next = work.back();
+        work.pop_back();
+        if (next == block)
+            return true;
+        if (seen[next])
+            continue;
+        seen[next] = true;
+        work.insert(work.end(), fn.blocks[next].succs.begin(), fn.blocks[next].succs.end());
+    }
+    return false;
+}
+
+/** @brief Instructions of one opcode inside loops */
+static size_t countInLoops(const Function &fn, Opcode op)
+{
+    size_t n = 0;
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        if (inLoop(fn, b))
+            for (ValueId v : fn.blocks[b].code)
+                n += fn.instrs[v].op == op;
+    return n;
+}
+
+static size_t loopBlocks(const Function &fn)
+{
+    size_t n = 0;
+    for (BlockId b = 0; b < fn.blocks.size(); ++b)
+        n += inLoop(fn, b);
+    return n;
+}
+
+/** @brief Runs the loop optimizations alone on one function of an unoptimized module */
+static std::vector<std::string> loopsAlone(Module &module, const std::string &name, const LoopOptions &options, bool &changed)
+{
+    std::vector<std::string> remarks;
+    for (auto &fn : module.functions)
+        if (fn.name == name)
+            changed = optimizeLoops(fn, options, &remarks);
+    return remarks;
+}
+
+/** @brief Compiles a program at the given level and returns main's result from the VM */
+static int runAt(const std::string &source, unsigned optLevel)
+{
+    Module module = compile(source, optLevel);
+    BytecodeProgram program = compileBytecode(module);
+    VM vm(program);
+    return vm.run();
+}
+
+static void TestLoopInvariants()
+{
+    // a * b and scale do not change in sum's loop; spill stores scale, so
+    // its load stays.
+    std::string source = R"(var scale : int64 = 3
+[noinline]
+sum(int64 n, int64 a, int64 b) int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) {
+        total = total + a * b + scale
+    }
+    return total
+}
+[noinline]
+spill(int64[n]) int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) {
+        total = total + scale
+        scale = scale + 1
+    }
+    return total
+}
+main() int64 {
+    return sum(0, 3, 4) * 1000000 + sum(1, 3, 4) * 10000 + sum(7, 3, 4) * 10 + spill(3) % 10
+}
+)";
+    Module module = compile(source, 0);
+    const Function &sum = function(module, "sum");
+    expect(countInLoops(sum, Opcode::Mul) == 1 && countInLoops(sum, Opcode::LoadGlobal) == 1, "TestLoopInvariants",
+           "unexpected code in the loop before hoisting");
+    bool changed = false;
+    loopsAlone(module, "sum", {}, changed);
+    expect(changed, "TestLoopInvariants", "nothing changed");
+    expect(countInLoops(sum, Opcode::Mul) == 0, "TestLoopInvariants", "invariant product left in the loop");
+    expect(countInLoops(sum, Opcode::LoadGlobal) == 0, "TestLoopInvariants", "load of an unchanged global left in the loop");
+    expect(count(sum, Opcode::Mul) == 1 && count(sum, Opcode::LoadGlobal) == 1, "TestLoopInvariants", "hoisted code was duplicated");
+
+    loopsAlone(module, "spill", {}, changed);
+    expect(countInLoops(function(module, "spill"), Opcode::LoadGlobal) == 2, "TestLoopInvariants", "load of a stored global hoisted");
+
+    // Trip counts 0, 1 and 7 add 15 each time; spill adds 3 + 4 + 5.
+    expect(runVM(source) == 0 + 15 * 10000 + 105 * 10 + 2, "TestLoopInvariants", "wrong result");
+
+    // Without loops, dropping an unreachable block is still a change, which
+    // later passes must see to recompute their analyses.
+    Function flat;
+    flat.name = "flat";
+    flat.addBlock();
+    flat.emit(0, Opcode::Return, ValueType::Void);
+    flat.addBlock();
+    flat.emit(1, Opcode::Return, ValueType::Void);
+    changed = optimizeLoops(flat, {});
+    expect(changed && flat.blocks.size() == 1, "TestLoopInvariants", "unreachable block not reported as a change");
+    changed = optimizeLoops(flat, {});
+    expect(!changed, "TestLoopInvariants", "change reported for a function without loops or unreachable blocks");
+    std::cout << "[PASS] TestLoopInvariants\n";
+}
+
+static void TestInductionVariables()
+{
+    // i * 8 becomes a second induction variable stepping by 8. last's loop
+    // does nothing but count, so it goes and i is its final value.
+    std::string source = R"([noinline]
+scaled(int64[n]) int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) {
+        total = total + i * 8
+    }
+    return total
+}
+[noinline]
+last() int64 {
+    var i : int64 = 0
+    for (i = 4; i < 100; i = i + 3) { }
+    return i
+}
+[noinline]
+never() int64 {
+    var i : int64 = 0
+    for (i = 50; i < 10; i = i + 1) { }
+    return i
+}
+main() int64 {
+    return scaled(0) * 1000000 + scaled(1) * 100000 + scaled(7) * 100 + last() + never()
+}
+)";
+    Module module = compile(source, 0);
+    bool changed = false;
+    loopsAlone(module, "scaled", {}, changed);
+    const Function &scaled = function(module, "scaled");
+    expect(changed && countInLoops(scaled, Opcode::Mul) == 0, "TestInductionVariables", "product of the induction variable left in the loop");
+    expect(countInLoops(scaled, Opcode::Add) == 3, "TestInductionVariables",
+           std::to_string(countInLoops(scaled, Opcode::Add)) + " additions in the loop");
+
+    // Trip counts 32 and 0.
+    for (const char *name : {"last", "never"})
+    {
+        loopsAlone(module, name, {}, changed);
+        expect(changed && loopBlocks(function(module, name)) == 0, "TestInductionVariables", std::string("loop left in ") + name);
+    }
+    expect(runVM(source) == 0 + 0 + 168 * 100 + 100 + 50, "TestInductionVariables", "wrong result");
+    std::cout << "[PASS] TestInductionVariables\n";
+}
+
+static void TestLoopUnrolling()
+{
+    std::string source = R"([noinline]
+squares() int64 {
+    var t : int64 = 0
+    for (var i : int64 = 0; i < 10; i = i + 1) { t = t + i * i }
+    return t
+}
+[noinline]
+once() int64 {
+    var t : int64 = 5
+    for (var i : int64 = 0; i < 1; i = i + 1) { t = t * 3 }
+    return t
+}
+[noinline]
+long() int64 {
+    var t : int64 = 0
+    for (var i : int64 = 0; i < 17; i = i + 1) { t = t * 2 + i }
+    return t
+}
+[noinline]
+partial(int64[n]) int64 {
+    var t : int64 = 0
+    for (var i : int64 = 0; i < n; i = i + 1) { t = t * 2 + i }
+    return t
+}
+main() int64 {
+    return squares() + once() + long() + partial(0) + partial(1) * 10 + partial(7) * 100 + partial(10) * 10000
+}
+)";
+    Module module = compile(source, 0);
+    LoopOptions options;
+    options.fullUnroll = true;
+    options.unroll = LoopOptions::DefaultUnroll;
+    bool changed = false;
+
+    std::vector<std::string> remarks = loopsAlone(module, "squares", options, changed);
+    expect(changed && loopBlocks(function(module, "squares")) == 0, "TestLoopUnrolling", "short loop left");
+    expect(remarks == std::vector<std::string>{"remark: squares:4: loop unrolled completely: 10 iterations"}, "TestLoopUnrolling",
+           "unexpected remarks for squares");
+    remarks = loopsAlone(module, "once", options, changed);
+    expect(loopBlocks(function(module, "once")) == 0 && count(function(module, "once"), Opcode::Mul) == 1, "TestLoopUnrolling",
+           "single iteration not unrolled to one body");
+
+    // Over MaxFullUnroll iterations only the partial unroll applies.
+    remarks = loopsAlone(module, "long", options, changed);
+    expect(remarks == std::vector<std::string>{"remark: long:16: loop unrolled by 2"}, "TestLoopUnrolling", "unexpected remarks for long");
+
+    // Each copy keeps its exit test, so odd trip counts leave after the first.
+    const Function &partial = function(module, "partial");
+    size_t before = countInLoops(partial, Opcode::Add), tests = countInLoops(partial, Opcode::Lt);
+    remarks = loopsAlone(module, "partial", options, changed);
+    expect(remarks == std::vector<std::string>{"remark: partial:22: loop unrolled by 2"}, "TestLoopUnrolling",
+           "unexpected remarks for partial");
+    expect(countInLoops(partial, Opcode::Add) == 2 * before && countInLoops(partial, Opcode::Lt) == 2 * tests, "TestLoopUnrolling",
+           "body not copied once");
+
+    // 285, 15, and t(n) = 2t(n - 1) + n - 1 = 2^n - n - 1: 131054, then 0, 0, 120 and 1013.
+    int expected = 285 + 15 + 131054 + 0 + 0 + 120 * 100 + 1013 * 10000;
+    expect(runAt(source, 2) == expected && runVM(source) == expected, "TestLoopUnrolling", "wrong result");
+    std::cout << "[PASS] TestLoopUnrolling\n";
+}
+
+int main()
+{
+    TestInlineAttributes();
+    TestInlineRecursion();
+    TestInlineRemarks();
+    TestGvnArithmetic();
+    TestGvnLoads();
+    TestGvnStringConcat();
+    TestLoopInvariants();
+    TestInductionVariables();
+    TestLoopUnrolling();
+    return 0;
+}
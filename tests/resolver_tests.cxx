@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <symbols.hxx>
+
+#include "support.hxx"
+
+static BlockNode *bodyOf(ASTNode *node)
+{
+    if (node->type == ASTNodeType::ClassDecl)
+        return static_cast<BlockNode *>(static_cast<ClassDeclNode *>(node)->body.get());
+    return static_cast<BlockNode *>(static_cast<FunctionDeclNode *>(node)->body.get());
+}
+
+static void TestBlockScopes()
+{
+    std::string inner = "main() int64 {\n    if true {\n        var x : int64 = 1\n    }\n    return x\n}\n";
+    expect(frontEndError(inner) == "Undefined identifier 'x'", "TestBlockScopes", "block local visible after the block");
+
+    std::string loop = "main() int64 {\n    for (var i : int64 = 0; i < 3; i = i + 1) {\n    }\n    return i\n}\n";
+    expect(frontEndError(loop) == "Undefined identifier 'i'", "TestBlockScopes", "loop variable visible after the loop");
+
+    std::string arms = "main() int64 {\n    match 1 {\n        1 { var y : int64 = 2 }\n        else { return y }\n    }\n    return 0\n}\n";
+    expect(frontEndError(arms) == "Undefined identifier 'y'", "TestBlockScopes", "match arm local visible in another arm");
+
+    std::string duplicate = "main() int64 {\n    var x : int64 = 1\n    var x : int64 = 2\n    return x\n}\n";
+    expect(frontEndError(duplicate) == "Duplicate declaration of 'x'", "TestBlockScopes", "redeclaration in one scope accepted");
+    std::cout << "[PASS] TestBlockScopes\n";
+}
+
+static void TestShadowing()
+{
+    std::string source = R"(var x : int64 = 100
+main() int64 {
+    var x : int64 = 1
+    if true {
+        var x : int64 = 10
+        x = x + 5
+    }
+    return x
+}
+)";
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(source, symbols, types);
+    auto *program = static_cast<BlockNode *>(ast.get());
+    auto *global = static_cast<VarDeclNode *>(program->children[0].get());
+    BlockNode *body = bodyOf(program->children[1].get());
+    auto *local = static_cast<VarDeclNode *>(body->children[0].get());
+    auto *ret = static_cast<ReturnExprNode *>(body->children[2].get());
+    auto *use = static_cast<IdentifierNode *>(ret->expr.get());
+    expect(use->symbol == local->symbol && use->symbol != global->symbol, "TestShadowing", "return x bound to the wrong declaration");
+    expect(runVM(source) == 1, "TestShadowing", "assignment in the inner block changed the outer variable");
+
+    // Parameters are shadowed by nothing in the same scope.
+    std::string parameter = "f(int64 a) int64 {\n    var a : int64 = 2\n    return a\n}\n";
+    expect(frontEndError(parameter) == "Duplicate declaration of 'a'", "TestShadowing", "local redeclared a parameter");
+    std::cout << "[PASS] TestShadowing\n";
+}
+
+static void TestUndefinedNames()
+{
+    struct Case
+    {
+        const char *source;
+        const char *message;
+    };
+    std::vector<Case> cases = {
+        {"main() int64 {\n    return y\n}\n", "Undefined identifier 'y'"},
+        {"main() int64 {\n    return g()\n}\n", "Undefined function 'g'"},
+        {"main() int64 {\n    z = 1\n    return 0\n}\n", "Undefined variable 'z'"},
+        {"class B : Missing {\n}\n", "Undefined base class 'Missing'"},
+        {"class A : B {\n}\nclass B : A {\n}\n", "Class 'A' inherits from itself"},
+        {"const k : int64 = 1\nmain() int64 {\n    k = 2\n    return k\n}\n", "Cannot assign to constant 'k'"},
+        {"main() int64 {\n    main = 1\n    return 0\n}\n", "Cannot assign to 'main', it is not a variable"},
+        {"class C {\n    var n : int64 = 1\n    static s() int64 { return n }\n}\n", "Cannot access instance member 'n' from static function 's'"},
+    };
+    for (const auto &c : cases)
+    {
+        std::string error = frontEndError(c.source);
+        expect(error == c.message, "TestUndefinedNames", "expected \"" + std::string(c.message) + "\", got \"" + error + "\"");
+    }
+
+    // Functions and classes may be used before their declaration.
+    std::string forward = "main() int64 {\n    return later() + Late().v()\n}\nlater() int64 { return 1 }\nclass Late {\n    public v() int64 { return 2 }\n}\n";
+    expect(frontEndError(forward).empty(), "TestUndefinedNames", "forward reference rejected");
+    std::cout << "[PASS] TestUndefinedNames\n";
+}
+
+static void TestDuplicateSignatures()
+{
+    std::string functions = "f(int64[a]) int64 { return a }\nf(int64[b]) int64 { return b + 1 }\n";
+    expect(frontEndError(functions) == "'f' is already declared with this signature", "TestDuplicateSignatures",
+           "second f(int64) accepted");
+
+    // Static and instance methods share one overload set.
+    std::string methods = "class C {\n    test(int64[c, d]) int64 { return c }\n    public static test(int64[c, d]) int64 { return d }\n}\n";
+    expect(frontEndError(methods) == "'test' is already declared with this signature", "TestDuplicateSignatures",
+           "static method with an instance method's signature accepted");
+
+    std::string overloads = "f(int64[a]) int64 { return a }\nf(int32[a]) int64 { return 2 }\nf(int64[a, b]) int64 { return b }\n"
+                            "main() int64 {\n    var n : int32 = 1\n    return f(1) + f(n) * 10 + f(0, 100)\n}\n";
+    expect(frontEndError(overloads).empty(), "TestDuplicateSignatures", "distinct overloads rejected");
+    expect(runVM(overloads) == 121, "TestDuplicateSignatures", "wrong overload called");
+    std::cout << "[PASS] TestDuplicateSignatures\n";
+}
+
+static void TestBaseClassMembers()
+{
+    std::string source = R"(class A {
+    var base : int64 = 7
+    public twice() int64 { return base * 2 }
+}
+class B : A {
+    public get() int64 { return base + twice() }
+}
+main() int64 {
+    return B().get()
+}
+)";
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(source, symbols, types);
+    auto *program = static_cast<BlockNode *>(ast.get());
+    auto *a = static_cast<ClassDeclNode *>(program->children[0].get());
+    auto *field = static_cast<VarDeclNode *>(bodyOf(a)->children[0].get());
+    BlockNode *get = bodyOf(bodyOf(program->children[1].get())->children[0].get());
+    auto *sum = static_cast<BinaryExprNode *>(static_cast<ReturnExprNode *>(get->children[0].get())->expr.get());
+    expect(static_cast<IdentifierNode *>(sum->left.get())->symbol == field->symbol, "TestBaseClassMembers", "field not found in the base class");
+    expect(static_cast<CallExprNode *>(sum->right.get())->symbol->scope == a->symbol->members, "TestBaseClassMembers",
+           "method not found in the base class");
+    expect(runVM(source) == 21, "TestBaseClassMembers", "wrong result");
+    std::cout << "[PASS] TestBaseClassMembers\n";
+}
+
+int main()
+{
+    TestBlockScopes();
+    TestShadowing();
+    TestUndefinedNames();
+    TestDuplicateSignatures();
+    TestBaseClassMembers();
+    return 0;
+}
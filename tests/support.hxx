@@ -0,0 +1,161 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <bytecode.hxx>
+#include <error.hxx>
+#include <fold.hxx>
+#include <hashcons.hxx>
+#include <hierarchy.hxx>
+#include <layout.hxx>
+#include <lower.hxx>
+#include <parser.hxx>
+#include <passmanager.hxx>
+#include <resolver.hxx>
+#include <typecheck.hxx>
+#include <vm.hxx>
+
+#include <flex/FlexLexer.h>
+
+/*
+ * Helpers shared by the test programs in tests/. Each program is a plain
+ * executable whose test functions print [PASS] lines and exit non-zero on
+ * the first failure.
+ */
+
+extern const std::string *Source;
+
+inline void fail(const std::string &test, const std::string &msg)
+{
+    std::cerr << "[FAIL] " << test << ": " << msg << "\n";
+    std::exit(1);
+}
+
+inline void expect(bool cond, const std::string &test, const std::string &msg)
+{
+    if (!cond)
+        fail(test, msg);
+}
+
+/** @brief A path in the system's temporary directory that no other run of the tests uses */
+inline std::string scratchFile(const std::string &stem, const std::string &extension)
+{
+    static std::mt19937_64 random{std::random_device{}()};
+    static unsigned counter = 0;
+    std::string name = stem + "_" + std::to_string(random()) + "_" + std::to_string(counter++) + extension;
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/** @brief Parses a program; the source is kept alive for the rest of the run */
+inline ASTNodePtr parse(const std::string &source)
+{
+    static std::deque<std::string> sources;
+    sources.push_back(source);
+    Source = &sources.back();
+    currentFile = "<test>";
+    column = 1;
+
+    std::istringstream ss(sources.back());
+    yyFlexLexer lexer(&ss);
+    Parser parser(lexer, sources.back());
+    return parser.parserProgram();
+}
+
+/** @brief Runs the front end the way `vsharp compile` does, without folding */
+inline ASTNodePtr analyze(const std::string &source, SymbolTable &symbols, TypeInterner &types)
+{
+    ASTNodePtr ast = parse(source);
+    resolveNames(ast.get(), symbols, *Source);
+    checkTypes(ast.get(), symbols, types, *Source);
+    return ast;
+}
+
+/**
+ * @brief Returns the message of the first error the front end reports for
+ * a program, or an empty string when it is accepted.
+ */
+inline std::string frontEndError(const std::string &source)
+{
+    Error::setThrowing(true);
+    try
+    {
+        SymbolTable symbols;
+        TypeInterner types;
+        ASTNodePtr ast = analyze(source, symbols, types);
+        foldConstants(ast);
+        ClassHierarchy hierarchy;
+        hierarchy.build(ast.get(), *Source);
+    }
+    catch (const CompileError &e)
+    {
+        Error::setThrowing(false);
+        return e.message;
+    }
+    catch (const std::exception &e)
+    {
+        Error::setThrowing(false);
+        return e.what();
+    }
+    Error::setThrowing(false);
+    return "";
+}
+
+/** @brief Runs the `vsharp compile` pipeline up to optimized IR, verifying after each pass */
+inline Module compile(const std::string &source, unsigned optLevel, bool hashCons = false)
+{
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(source, symbols, types);
+    HashConsTable table;
+    if (hashCons)
+        table.intern(ast);
+    foldConstants(ast);
+    ClassHierarchy hierarchy;
+    hierarchy.build(ast.get(), *Source);
+    devirtualize(ast.get(), hierarchy);
+    LayoutEngine layouts(nullptr, &hierarchy);
+    layouts.run(ast.get());
+
+    Module module = lowerToIR(ast.get(), hierarchy, layouts, *Source);
+    PassManager passes(1);
+    passes.setVerify(true);
+    passes.addPipeline(optLevel);
+    passes.run(module);
+    return module;
+}
+
+inline const Function &function(const Module &module, const std::string &name)
+{
+    for (const auto &fn : module.functions)
+        if (fn.name == name)
+            return fn;
+    fail(name, "missing function");
+    std::exit(1);
+}
+
+inline uint32_t functionIndex(const Module &module, const std::string &name)
+{
+    return static_cast<uint32_t>(&function(module, name) - module.functions.data());
+}
+
+inline size_t count(const Function &fn, Opcode op)
+{
+    size_t n = 0;
+    for (const auto &block : fn.blocks)
+        for (ValueId v : block.code)
+            n += fn.instrs[v].op == op;
+    return n;
+}
+
+/** @brief Compiles a program at -O1 and returns main's result from the VM */
+inline int runVM(const std::string &source)
+{
+    Module module = compile(source, 1);
+    BytecodeProgram program = compileBytecode(module);
+    VM vm(program);
+    return vm.run();
+}
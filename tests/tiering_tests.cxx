@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <tiering.hxx>
+
+#include "support.hxx"
+
+struct TieredRun
+{
+    int result = 0;
+    double native = 0; /**< Milliseconds */
+    unsigned entered = 0;
+    std::string stats;
+};
+
+static TieredRun runTiered(const std::string &source, unsigned level, bool background, uint32_t threshold = 100)
+{
+    Module module = compile(source, level);
+    TierOptions options;
+    options.threshold = threshold;
+    options.background = background;
+    options.optLevel = level;
+
+    TieredRun run;
+    TieredRunner runner(module, options);
+    run.result = runner.run();
+
+    FILE *out = tmpfile();
+    runner.printStats(out);
+    run.stats.resize(static_cast<size_t>(ftell(out)));
+    rewind(out);
+    run.stats.resize(fread(run.stats.data(), 1, run.stats.size(), out));
+    fclose(out);
+
+    size_t at = run.stats.find("native: ");
+    if (at != std::string::npos)
+        run.native = std::stod(run.stats.substr(at + 8));
+    at = run.stats.find("entered at loop headers: ");
+    if (at != std::string::npos)
+        run.entered = static_cast<unsigned>(std::stoul(run.stats.substr(at + 25)));
+    return run;
+}
+
+/** @brief The tiered result must match the interpreter's, in both compilation modes and at -O1 and -O2 */
+static void expectTiered(const std::string &source, int expected, unsigned entered, const std::string &test)
+{
+    for (unsigned level : {1u, 2u})
+    {
+        expect(runVM(source) == expected, test, "interpreter disagrees with the expected result");
+        TieredRun sync = runTiered(source, level, false);
+        expect(sync.result == expected, test,
+               "-O" + std::to_string(level) + ": got " + std::to_string(sync.result) + ", expected " + std::to_string(expected));
+        expect(sync.entered == entered, test, "-O" + std::to_string(level) + ": entered at loop headers " + std::to_string(sync.entered) +
+                                                  " times, expected " + std::to_string(entered) + "\n" + sync.stats);
+
+        // The worker may finish after the loop; only the result is certain.
+        TieredRun background = runTiered(source, level, true);
+        expect(background.result == expected, test, "background -O" + std::to_string(level) + ": got " + std::to_string(background.result));
+    }
+}
+
+static void TestHotLoopCalledOnce()
+{
+    // main runs once, so only entering at the loop header gets it native.
+    std::string source = R"(main() int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < 3000000; i = i + 1) {
+        total = total + i % 7
+    }
+    return total % 1000
+}
+)";
+    expectTiered(source, 994, 1, "TestHotLoopCalledOnce");
+
+    TieredRun run = runTiered(source, 1, false);
+    expect(run.native > 0, "TestHotLoopCalledOnce", "no time spent in native code\n" + run.stats);
+    std::cout << "[PASS] TestHotLoopCalledOnce\n";
+}
+
+static void TestLiveValues()
+{
+    // Parameters, a float and values computed before the loop are live at
+    // the header; step is compiled lazily from the native loop.
+    std::string source = R"(var calls : int64 = 0
+[noinline]
+step(int64[x]) int64 {
+    calls = calls + 1
+    return x % 3
+}
+[noinline]
+scaled(int64 n, float64 scale) int64 {
+    var acc : float64 = 0.5
+    var above : int64 = 0
+    var offset : int64 = n / 1000
+    for (var i : int64 = 0; i < n; i = i + 1) {
+        acc = acc + scale
+        if acc > 1000.0 { above = above + offset + step(i) }
+    }
+    return above
+}
+main() int64 {
+    return scaled(10000, 0.25) % 100000 + calls % 100 * 100000
+}
+)";
+    // acc passes 1000 at i = 3998; the 6002 later iterations add 10 each,
+    // plus i % 3, which sums to 6002 over them.
+    expectTiered(source, 60020 + 6002 + 2 * 100000, 1, "TestLiveValues");
+    std::cout << "[PASS] TestLiveValues\n";
+}
+
+static void TestNestedLoops()
+{
+    // base is defined in the outer loop, so the inner header has no entry
+    // and the activation moves over at the outer header.
+    std::string source = R"(main() int64 {
+    var total : int64 = 0
+    for (var i : int64 = 0; i < 300; i = i + 1) {
+        var base : int64 = i * 2
+        for (var j : int64 = 0; j < 50; j = j + 1) {
+            total = total + base + j % 3
+        }
+    }
+    return total % 100000
+}
+)";
+    // Each row adds 50 * 2i, and j % 3 sums to 49 over it.
+    expectTiered(source, (100 * 299 * 300 / 2 + 49 * 300) % 100000, 1, "TestNestedLoops");
+
+    // A loop that returns from its body returns from the function.
+    std::string early = R"(main() int64 {
+    for (var i : int64 = 0; i < 100000000; i = i + 1) {
+        if i * i > 4000000 { return i }
+    }
+    return 0
+}
+)";
+    expectTiered(early, 2001, 1, "TestNestedLoops");
+    std::cout << "[PASS] TestNestedLoops\n";
+}
+
+static void TestIneligible()
+{
+    // Functions handling strings stay in the interpreter.
+    std::string source = R"(main() int64 {
+    var s : string = ""
+    var n : int64 = 0
+    for (var i : int64 = 0; i < 5000; i = i + 1) {
+        if s == "" { n = n + 1 }
+    }
+    return n
+}
+)";
+    expectTiered(source, 5000, 0, "TestIneligible");
+    TieredRun run = runTiered(source, 1, false);
+    expect(run.stats.find("tiered up: 0") != std::string::npos, "TestIneligible", "string function tiered up\n" + run.stats);
+    std::cout << "[PASS] TestIneligible\n";
+}
+
+static void TestDivisionByZero()
+{
+    // ratio is native by the time it divides by zero; the error must not change.
+    std::string source = R"([noinline]
+ratio(int64 a, int64 b) int64 {
+    return a / b
+}
+main() int64 {
+    var s : int64 = 0
+    for (var i : int64 = 1; i < 20000; i = i + 1) {
+        s = s + ratio(i, 3)
+    }
+    return ratio(s, 0)
+}
+)";
+    auto error = [](auto &&run)
+    {
+        try
+        {
+            run();
+        }
+        catch (const std::exception &e)
+        {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    std::string expected = "Runtime error in ratio: Division by zero";
+    expect(error([&] { runVM(source); }) == expected, "TestDivisionByZero", "interpreter disagrees with the expected error");
+
+    for (unsigned level : {1u, 2u})
+        for (bool background : {false, true})
+        {
+            Module module = compile(source, level);
+            TierOptions options;
+            options.threshold = 100;
+            options.background = background;
+            options.optLevel = level;
+            TieredRunner runner(module, options);
+            std::string got = error([&] { runner.run(); });
+            expect(got == expected, "TestDivisionByZero",
+                   std::string(background ? "background" : "sync") + " -O" + std::to_string(level) + ": \"" + got + "\"");
+            if (background)
+                continue;
+            FILE *out = tmpfile();
+            runner.printStats(out);
+            std::string stats(static_cast<size_t>(ftell(out)), '\0');
+            rewind(out);
+            stats.resize(fread(stats.data(), 1, stats.size(), out));
+            fclose(out);
+            expect(stats.find("  ratio ") != std::string::npos, "TestDivisionByZero", "ratio did not tier up\n" + stats);
+        }
+    std::cout << "[PASS] TestDivisionByZero\n";
+}
+
+int main()
+{
+    TestHotLoopCalledOnce();
+    TestLiveValues();
+    TestNestedLoops();
+    TestIneligible();
+    TestDivisionByZero();
+    return 0;
+}
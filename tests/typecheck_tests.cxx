@@ -0,0 +1,237 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <symbols.hxx>
+
+#include "support.hxx"
+
+namespace
+{
+    struct Case
+    {
+        const char *source;
+        const char *message; /**< Expected error, or null when the program is accepted */
+    };
+}
+
+static void checkCases(const std::string &test, const std::vector<Case> &cases)
+{
+    for (const auto &c : cases)
+    {
+        std::string error = frontEndError(c.source);
+        std::string expected = c.message ? c.message : "";
+        expect(error == expected, test, "expected \"" + expected + "\", got \"" + error + "\" for:\n" + c.source);
+    }
+}
+
+static void TestInternedTypes()
+{
+    TypeInterner types;
+    const TypeInfo *i64 = types.primitive(Type::Int64), *i32 = types.primitive(Type::Int32);
+    expect(i64 == types.primitive(Type::Int64) && i64 != i32, "TestInternedTypes", "primitive types are not unique");
+    expect(types.arrayOf(i64) == types.arrayOf(i64) && types.arrayOf(i64) != types.arrayOf(i32), "TestInternedTypes", "array types are not interned");
+    const TypeInfo *f = types.function(i64, {i64, i32});
+    expect(f == types.function(i64, {i64, i32}), "TestInternedTypes", "function types are not interned");
+    expect(f != types.function(i64, {i32, i64}) && f != types.function(i32, {i64, i32}), "TestInternedTypes", "distinct function types were merged");
+
+    // Every symbol and node of a program refers to the interner's types.
+    std::string source = "class P {\n    var x : int64 = 1\n}\nf(int64 a, int32 b) int64 { return a }\ng(int64 c, int32 d) int64 { return c }\n"
+                         "main() int64 {\n    var p : int64 = f(1, 2) + g(3, 4)\n    return p\n}\n";
+    SymbolTable symbols;
+    TypeInterner programTypes;
+    ASTNodePtr ast = analyze(source, symbols, programTypes);
+    size_t before = programTypes.size();
+    const Symbol *fs = nullptr, *gs = nullptr, *ps = nullptr;
+    for (const Symbol &symbol : symbols.symbols)
+    {
+        std::string_view name = symbols.name(&symbol);
+        if (name == "f")
+            fs = &symbol;
+        else if (name == "g")
+            gs = &symbol;
+        else if (name == "P")
+            ps = &symbol;
+    }
+    expect(fs && gs && fs->typeInfo == gs->typeInfo, "TestInternedTypes", "equal signatures have different types");
+    expect(ps && ps->typeInfo->kind == TypeKind::Class && programTypes.classType(ps, "P") == ps->typeInfo, "TestInternedTypes",
+           "class type is not unique");
+    expect(programTypes.size() == before, "TestInternedTypes", "looking a type up again created a new one");
+    std::cout << "[PASS] TestInternedTypes\n";
+}
+
+static void TestOverloadSelection()
+{
+    checkCases("TestOverloadSelection", {
+        // A single candidate lets literals adapt to its parameter types.
+        {"f(int8 a) int8 { return a }\nmain() int64 {\n    f(5)\n    return 0\n}\n", nullptr},
+        {"f(int8 a) int8 { return a }\nmain() int64 {\n    f(300)\n    return 0\n}\n", "Literal 300 does not fit in 'int8'"},
+        {"f(int64 a) int64 { return a }\nf(int32 a) int64 { return 2 }\nmain() int64 {\n    var n : int32 = 1\n    return f(n)\n}\n", nullptr},
+        {"f(int64 a) int64 { return a }\nmain() int64 {\n    return f(1, 2)\n}\n", "No overload of 'f' takes 2 argument(s)"},
+        {"f(int64 a) int64 { return a }\nf(int32 a) int64 { return 2 }\nmain() int64 {\n    var n : int16 = 1\n    return f(n)\n}\n",
+         "No overload of 'f' matches the argument types"},
+        {"f(int64 a) int64 { return a }\nmain() int64 {\n    return f(true)\n}\n", "Cannot use a value of type 'boolean' as argument 1 of 'f' of type 'int64'"},
+        {"class C {\n    public m() int64 { return 1 }\n}\nmain() int64 {\n    return C().n()\n}\n", "Class 'C' has no method 'n'"},
+        {"main() int64 {\n    var x : int64 = 1\n    return x.m()\n}\n", "Cannot call method 'm' on a value of type 'int64'"},
+    });
+
+    // The overload picked by argument types is the one that runs.
+    std::string source = "f(int64 a) int64 { return 1 }\nf(int32 a) int64 { return 2 }\nf(boolean a) int64 { return 3 }\n"
+                         "main() int64 {\n    var n : int32 = 1\n    return f(n) * 100 + f(true) * 10 + f(5)\n}\n";
+    expect(runVM(source) == 231, "TestOverloadSelection", "wrong overload called");
+    std::cout << "[PASS] TestOverloadSelection\n";
+}
+
+static void TestWidthRules()
+{
+    checkCases("TestWidthRules", {
+        {"main() int64 {\n    var x : int8 = 300\n    return 0\n}\n", "Literal 300 does not fit in 'int8'"},
+        {"main() int64 {\n    var x : uint8 = 255\n    var y : int8 = 127\n    return 0\n}\n", nullptr},
+        {"main() int64 {\n    var x : uint16 = 65536\n    return 0\n}\n", "Literal 65536 does not fit in 'uint16'"},
+        {"main() int64 {\n    var x : int8 = 1\n    var y : int64 = x\n    return y\n}\n",
+         "Cannot use a value of type 'int8' as the initializer of 'y' of type 'int64'"},
+        {"main() int64 {\n    var x : uint32 = 1\n    var y : int32 = 2\n    return 0\n}\nf(uint32 a, int32 b) boolean { return a < b }\n",
+         "Operand types 'uint32' and 'int32' do not match for '<'"},
+        {"main() int64 {\n    var x : int8 = 1\n    return x + 1000\n}\n", "Literal 1000 does not fit in 'int8'"},
+        {"main() int32 {\n    var x : int64 = 1\n    return x\n}\n", "Cannot use a value of type 'int64' as the result of 'main' of type 'int32'"},
+        {"main() int64 {\n    var f : float32 = 1.5\n    var d : float64 = f\n    return 0\n}\n",
+         "Cannot use a value of type 'float32' as the initializer of 'd' of type 'float64'"},
+        {"main() int64 {\n    var f : float64 = 1\n    return 0\n}\n", nullptr},
+        {"main() int64 {\n    var f : float64 = 2.5\n    var g : float64 = f % 2.0\n    return 0\n}\n", "Operator '%' requires integer operands, got 'float64'"},
+        {"main() int64 {\n    var b : byte = 1\n    return 0\n}\n", "Cannot use a value of type 'int64' as the initializer of 'b' of type 'byte'"},
+        {"main() int64 {\n    if 1 { return 1 }\n    return 0\n}\n", "Cannot use a value of type 'int64' as an if condition of type 'boolean'"},
+        {"main() int64 {\n    var s : string = \"a\" + \"b\"\n    return 0\n}\n", nullptr},
+        {"main() int64 {\n    var s : string = \"a\"\n    var t : string = s - s\n    return 0\n}\n", "Operator '-' requires numeric operands, got 'string'"},
+    });
+
+    // Literal-only arithmetic takes the width of its context and wraps there.
+    expect(runVM("main() uint8 {\n    var x : uint8 = 200 + 100\n    return x\n}\n") == 44, "TestWidthRules", "uint8 literal arithmetic did not wrap");
+    std::cout << "[PASS] TestWidthRules\n";
+}
+
+static void TestDuplicatePatterns()
+{
+    const char *already = "Pattern is already matched by an earlier arm";
+    checkCases("TestDuplicatePatterns", {
+        {"main() int64 {\n    match 3 {\n        1, 2 { return 1 }\n        2 { return 2 }\n    }\n    return 0\n}\n", already},
+        {"main() int64 {\n    match 3 {\n        1, 1 { return 1 }\n    }\n    return 0\n}\n", already},
+        {"f(string s) int64 {\n    match s {\n        \"a\" { return 1 }\n        \"b\", \"a\" { return 2 }\n    }\n    return 0\n}\n", already},
+        {"f(byte b) int64 {\n    match b {\n        'a' { return 1 }\n        'a' { return 2 }\n    }\n    return 0\n}\n", already},
+        // Patterns adapt to the subject, so 255 and -1 differ for int16 ...
+        {"f(int16 x) int64 {\n    match x {\n        255 { return 1 }\n        -1 { return 2 }\n    }\n    return 0\n}\n", nullptr},
+        // ... and must fit it.
+        {"f(uint8 x) int64 {\n    match x {\n        -1 { return 1 }\n    }\n    return 0\n}\n", "Literal -1 does not fit in 'uint8'"},
+        {"f(float64 x) int64 {\n    match x {\n        1 { return 1 }\n    }\n    return 0\n}\n", "Cannot match on a value of type 'float64'"},
+    });
+    std::cout << "[PASS] TestDuplicatePatterns\n";
+}
+
+static void TestNoUnaryMinus()
+{
+    // Negation is written as a subtraction; only match patterns and
+    // enumerator values take a sign.
+    checkCases("TestNoUnaryMinus", {
+        {"main() int64 {\n    return -1\n}\n", "Unexpected token in expression"},
+        {"main() int64 {\n    var x : int64 = 1\n    return 0 - x\n}\n", nullptr},
+        // Each operand must fit on its own, so the minimum needs two steps.
+        {"main() int64 {\n    var x : int8 = 0 - 128\n    return 0\n}\n", "Literal 128 does not fit in 'int8'"},
+        {"main() int64 {\n    var x : int8 = 0 - 127 - 1\n    return 0\n}\n", nullptr},
+    });
+    expect(runVM("main() uint8 {\n    var x : uint8 = 0 - 1\n    return x\n}\n") == 255, "TestNoUnaryMinus", "0 - 1 did not wrap in uint8");
+    expect(runVM("main() int64 {\n    var x : int64 = 5\n    return 10 + (0 - x)\n}\n") == 5, "TestNoUnaryMinus", "wrong result for 0 - x");
+    std::cout << "[PASS] TestNoUnaryMinus\n";
+}
+
+// Folds a program and returns the initializer of its first declaration.
+static const ASTNode *foldedInitializer(const std::string &source, ASTNodePtr &ast)
+{
+    SymbolTable symbols;
+    TypeInterner types;
+    ast = analyze(source, symbols, types);
+    foldConstants(ast);
+    return static_cast<VarDeclNode *>(static_cast<BlockNode *>(ast.get())->children[0].get())->value.get();
+}
+
+static void expectFolded(const std::string &type, const std::string &expr, const LiteralValue &expected)
+{
+    ASTNodePtr ast;
+    const ASTNode *value = foldedInitializer("const k : " + type + " = " + expr + "\n", ast);
+    expect(value->type == ASTNodeType::Literal, "TestFolding", type + " " + expr + " was not folded");
+    expect(static_cast<const LiteralNode *>(value)->value == expected, "TestFolding", type + " " + expr + " folded to the wrong value");
+}
+
+static void TestFoldingWraps()
+{
+    expectFolded("int8", "127 + 1", int8_t(INT8_MIN));
+    expectFolded("int8", "100 * 3", int8_t(44));
+    expectFolded("uint8", "255 + 1", uint8_t(0));
+    expectFolded("uint8", "0 - 1", uint8_t(UINT8_MAX));
+    expectFolded("int16", "32767 + 1", int16_t(INT16_MIN));
+    expectFolded("uint16", "0 - 1", uint16_t(UINT16_MAX));
+    expectFolded("int32", "2147483647 + 1", int32_t(INT32_MIN));
+    expectFolded("uint32", "4294967295 + 1", uint32_t(0));
+    expectFolded("int64", "9223372036854775807 + 1", int64_t(INT64_MIN));
+    expectFolded("uint64", "0 - 1", uint64_t(UINT64_MAX));
+    expectFolded("uint32", "0 - 7 / 2", uint32_t(0) - 3);
+    expectFolded("int32", "(0 - 7) / 2", int32_t(-3));
+    expectFolded("int32", "(0 - 7) % 2", int32_t(-1));
+
+    // The overflowing division wraps to the dividend, with remainder 0.
+    expectFolded("int64", "(0 - 9223372036854775807 - 1) / (0 - 1)", int64_t(INT64_MIN));
+    expectFolded("int64", "(0 - 9223372036854775807 - 1) % (0 - 1)", int64_t(0));
+    expectFolded("int8", "(0 - 127 - 1) / (0 - 1)", int8_t(INT8_MIN));
+    std::cout << "[PASS] TestFoldingWraps\n";
+}
+
+static void TestFoldingLeavesDivisionByZero()
+{
+    for (const char *expr : {"7 / 0", "7 % 0", "7 / (1 - 1)"})
+    {
+        ASTNodePtr ast;
+        const ASTNode *value = foldedInitializer(std::string("const k : int64 = ") + expr + "\n", ast);
+        expect(value->type == ASTNodeType::BinaryExpr, "TestFoldingLeavesDivisionByZero", std::string(expr) + " was folded");
+        auto *divisor = static_cast<const BinaryExprNode *>(value)->right.get();
+        expect(divisor->type == ASTNodeType::Literal, "TestFoldingLeavesDivisionByZero", std::string(expr) + ": divisor was not folded");
+    }
+    std::cout << "[PASS] TestFoldingLeavesDivisionByZero\n";
+}
+
+static void TestConstantCycles()
+{
+    // Fields are declared up front, so constants can refer to each other
+    // in a cycle; folding must terminate and leave the cycle alone.
+    std::string source = R"(class C {
+    const a : int64 = b + 1
+    const b : int64 = a + 1
+    const c : int64 = c * 2
+    const d : int64 = later + 1
+    const later : int64 = 40
+}
+)";
+    SymbolTable symbols;
+    TypeInterner types;
+    ASTNodePtr ast = analyze(source, symbols, types);
+    size_t folded = foldConstants(ast);
+    auto *cls = static_cast<ClassDeclNode *>(static_cast<BlockNode *>(ast.get())->children[0].get());
+    auto &fields = static_cast<BlockNode *>(cls->body.get())->children;
+    auto value = [&](size_t i) { return static_cast<VarDeclNode *>(fields[i].get())->value.get(); };
+    for (size_t i = 0; i < 3; ++i)
+        expect(value(i)->type == ASTNodeType::BinaryExpr, "TestConstantCycles", "a constant in a cycle was folded");
+    expect(value(3)->type == ASTNodeType::Literal && static_cast<const LiteralNode *>(value(3))->value == LiteralValue(int64_t(41)),
+           "TestConstantCycles", "forward reference was not propagated");
+    expect(folded == 2, "TestConstantCycles", std::to_string(folded) + " nodes folded");
+    std::cout << "[PASS] TestConstantCycles\n";
+}
+
+int main()
+{
+    TestInternedTypes();
+    TestOverloadSelection();
+    TestWidthRules();
+    TestDuplicatePatterns();
+    TestNoUnaryMinus();
+    TestFoldingWraps();
+    TestFoldingLeavesDivisionByZero();
+    TestConstantCycles();
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "support.hxx"
+
+static const Dispatch Modes[] = {Dispatch::Threaded, Dispatch::Switch};
+
+static const char *modeName(Dispatch mode)
+{
+    return mode == Dispatch::Threaded ? "threaded" : "switch";
+}
+
+/** @brief main's result under every dispatch mode, at -O0 and -O1 */
+static void expectRun(const std::string &source, int expected, const std::string &test)
+{
+    for (unsigned level : {0u, 1u})
+    {
+        Module module = compile(source, level);
+        BytecodeProgram program = compileBytecode(module);
+        for (Dispatch mode : Modes)
+        {
+            VM vm(program);
+            vm.setDispatch(mode);
+            int result = vm.run();
+            expect(result == expected, test,
+                   std::string(modeName(mode)) + " -O" + std::to_string(level) + ": got " + std::to_string(result) +
+                       ", expected " + std::to_string(expected));
+        }
+    }
+}
+
+/** @brief The message of the VMError main raises under a dispatch mode */
+static std::string runError(const BytecodeProgram &program, Dispatch mode, size_t stackSlots = VM::DefaultStackSlots)
+{
+    VM vm(program, stackSlots);
+    vm.setDispatch(mode);
+    try
+    {
+        vm.run();
+    }
+    catch (const VMError &e)
+    {
+        return e.what();
+    }
+    return "";
+}
+
+static uint64_t raw(int64_t value)
+{
+    return static_cast<uint64_t>(value);
+}
+
+static void TestWidths()
+{
+    // One function per type and operator, called with raw register values
+    // so that nothing is folded away.
+    const char *types[] = {"int8", "int16", "int32", "int64", "uint8", "uint16", "uint32", "uint64"};
+    std::string source;
+    for (const char *type : types)
+        for (auto [name, op] : {std::pair{"add", "+"}, {"sub", "-"}, {"mul", "*"}, {"div", "/"}, {"rem", "%"}})
+            source += std::string(name) + "_" + type + "(" + type + "[a, b]) " + type + " {\n    return a " + op + " b\n}\n";
+
+    struct Case
+    {
+        const char *function;
+        uint64_t a, b, result;
+    };
+    const Case cases[] = {
+        {"add_int8", 127, 1, raw(-128)},
+        {"sub_int8", raw(-128), 1, 127},
+        {"mul_int8", 16, 16, 0},
+        {"div_int8", raw(-128), raw(-1), raw(-128)},
+        {"rem_int8", raw(-128), raw(-1), 0},
+        {"div_int8", raw(-7), 2, raw(-3)},
+        {"rem_int8", raw(-7), 2, raw(-1)},
+        {"add_int16", 32767, 1, raw(-32768)},
+        {"mul_int16", 300, 300, 90000 - 65536},
+        {"mul_int16", 200, 200, raw(40000 - 65536)},
+        {"div_int16", raw(-32768), raw(-1), raw(-32768)},
+        {"add_int32", 2147483647, 1, raw(INT32_MIN)},
+        {"mul_int32", 65536, 65536, 0},
+        {"sub_int32", raw(INT32_MIN), 1, 2147483647},
+        {"div_int32", raw(INT32_MIN), raw(-1), raw(INT32_MIN)},
+        {"add_int64", raw(INT64_MAX), 1, raw(INT64_MIN)},
+        {"div_int64", raw(INT64_MIN), raw(-1), raw(INT64_MIN)},
+        {"rem_int64", raw(INT64_MIN), raw(-1), 0},
+        {"mul_int64", raw(-3), 7, raw(-21)},
+        {"add_uint8", 255, 1, 0},
+        {"sub_uint8", 0, 1, 255},
+        {"div_uint8", 200, 3, 66},
+        {"mul_uint16", 256, 256, 0},
+        {"sub_uint16", 0, 1, 65535},
+        {"add_uint32", 4294967295u, 1, 0},
+        {"rem_uint32", 4294967295u, 10, 5},
+        {"add_uint64", UINT64_MAX, 1, 0},
+        {"div_uint64", UINT64_MAX, 2, UINT64_MAX / 2},
+        {"rem_uint64", UINT64_MAX, 10, 5},
+    };
+
+    for (unsigned level : {0u, 2u})
+    {
+        Module module = compile(source, level);
+        BytecodeProgram program = compileBytecode(module);
+        for (Dispatch mode : Modes)
+        {
+            VM vm(program);
+            vm.setDispatch(mode);
+            for (const auto &c : cases)
+            {
+                uint64_t result = vm.call(functionIndex(module, c.function), {c.a, c.b});
+                expect(result == c.result, "TestWidths",
+                       std::string(c.function) + " under " + modeName(mode) + " -O" + std::to_string(level) + ": got " +
+                           std::to_string(static_cast<int64_t>(result)));
+            }
+        }
+    }
+    std::cout << "[PASS] TestWidths\n";
+}
+
+static void TestDivisionTraps()
+{
+    for (const char *type : {"int64", "uint64", "int8", "uint32"})
+    {
+        for (const char *op : {"/", "%"})
+        {
+            std::string source = std::string("[noinline]\nf(") + type + "[a, b]) " + type + " {\n    return a " + op + " b\n}\n" +
+                                 "main() int64 {\n    var x : " + type + " = f(7, 0)\n    return 1\n}\n";
+            BytecodeProgram program = compileBytecode(compile(source, 1));
+            for (Dispatch mode : Modes)
+            {
+                std::string error = runError(program, mode);
+                expect(error == "Runtime error in f: Division by zero", "TestDivisionTraps",
+                       std::string(type) + " " + op + " under " + modeName(mode) + ": \"" + error + "\"");
+            }
+        }
+    }
+
+    // A zero divisor on a path that is not taken does not trap.
+    expectRun("[noinline]\nf(int64[a, b]) int64 {\n    if b == 0 { return 0 }\n    return a / b\n}\n"
+              "main() int64 {\n    return f(9, 0) + f(9, 3)\n}\n",
+              3, "TestDivisionTraps");
+
+    // An unused quotient still traps at every level; one by a non-zero
+    // constant cannot, so it is dead code.
+    std::string unused = "[noinline]\nf(int64[a]) int64 {\n    var x : int64 = 5 / (a - a)\n    var y : int64 = a % 7\n    return 3\n}\n"
+                         "main() int64 {\n    return f(7)\n}\n";
+    for (unsigned level : {0u, 1u, 2u})
+    {
+        Module module = compile(unused, level);
+        if (level > 0)
+            expect(count(function(module, "f"), Opcode::Div) == 1 && count(function(module, "f"), Opcode::Rem) == 0, "TestDivisionTraps",
+                   "wrong divisions kept at -O" + std::to_string(level));
+        std::string error = runError(compileBytecode(module), Dispatch::Switch);
+        expect(error == "Runtime error in f: Division by zero", "TestDivisionTraps",
+               "unused division at -O" + std::to_string(level) + ": \"" + error + "\"");
+    }
+    std::cout << "[PASS] TestDivisionTraps\n";
+}
+
+static void TestCalls()
+{
+    std::string recursion = R"(fib(int64[n]) int64 {
+    if n < 2 { return n }
+    return fib(n - 1) + fib(n - 2)
+}
+isEven(int64[n]) boolean {
+    if n == 0 { return true }
+    return isOdd(n - 1)
+}
+isOdd(int64[n]) boolean {
+    if n == 0 { return false }
+    return isEven(n - 1)
+}
+sum(int64[a, b, c, d, e, f, g]) int64 {
+    return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7
+}
+main() int64 {
+    var parity : int64 = 0
+    if isEven(100) { parity = 1 }
+    if isOdd(7) { parity = parity + 2 }
+    return fib(15) % 100 + parity * 100 + sum(1, 1, 1, 1, 1, 1, 1) * 1000
+}
+)";
+    expectRun(recursion, 610 % 100 + 300 + 28000, "TestCalls");
+
+    std::string dispatch = R"(class Animal {
+    var legs : int64 = 4
+    public virtual sound() int64 { return 1 }
+    public describe() int64 { return sound() * 10 + legs }
+}
+class Bird : Animal {
+    public override sound() int64 { return legs + 5 }
+}
+main() int64 {
+    return Animal().describe() * 100 + Bird().describe()
+}
+)";
+    expectRun(dispatch, 14 * 100 + 94, "TestCalls");
+
+    // Unbounded recursion exhausts the register arena instead of the host stack.
+    std::string runaway = "down(int64[n]) int64 {\n    return down(n + 1) + 1\n}\nmain() int64 {\n    return down(0)\n}\n";
+    BytecodeProgram program = compileBytecode(compile(runaway, 0));
+    for (Dispatch mode : Modes)
+        expect(runError(program, mode, 4096) == "Runtime error in down: Stack overflow", "TestCalls",
+               std::string("no stack overflow under ") + modeName(mode));
+    std::cout << "[PASS] TestCalls\n";
+}
+
+static void TestGlobals()
+{
+    std::string source = R"(var counter : int64 = 10
+var small : uint8 = 250
+const step : int64 = 3
+bump() int64 {
+    counter = counter + step
+    small = small + 3
+    return counter
+}
+main() int64 {
+    bump()
+    bump()
+    var result : int64 = bump() * 1000
+    if small == 3 { result = result + 3 }
+    return result
+}
+)";
+    // The initializer runs first; small wraps past 255 on the way to 3.
+    expectRun(source, 19 * 1000 + 3, "TestGlobals");
+    std::cout << "[PASS] TestGlobals\n";
+}
+
+static void TestStrings()
+{
+    std::string source = R"(var greeting : string = "hello"
+[noinline]
+check(string[s]) int64 {
+    if s + "!" == greeting + "!" { return 1 }
+    if s == "" { return 2 }
+    if s != "hello " { return 3 }
+    return 4
+}
+main() int64 {
+    var empty : string = ""
+    return check("hello") * 1000 + check(empty + empty) * 100 + check("hell") * 10 + check("hello ")
+}
+)";
+    expectRun(source, 1234, "TestStrings");
+    std::cout << "[PASS] TestStrings\n";
+}
+
+int main()
+{
+    TestWidths();
+    TestDivisionTraps();
+    TestCalls();
+    TestGlobals();
+    TestStrings();
+    return 0;
+}